@@ -25,11 +25,13 @@
 // UPDATED FROM THE ORIGINAL VERSION USING THE RESULTS OF CLANG-TIDY
 //
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdint>
 #include <cstring> // memset.
 #include <limits>
+#include <utility>
 #include <vector>
 
 namespace unibn {
@@ -205,6 +207,17 @@ namespace unibn {
          **/
         template <typename Distance> int32_t findNeighbor(const PointT& query, double minDistance = -1) const;
 
+        /** @brief k-nearest neighbor queries, reporting the indices of the k closest points ordered by distance.
+         *
+         * Fewer than k indices are reported if the octree contains fewer points. The distances are returned as computed
+         * by the Distance, i.e. squared for the L2Distance.
+         **/
+        template <typename Distance>
+        void knnNeighbors(const PointT& query,
+                          uint32_t k,
+                          std::vector<uint32_t>& resultIndices,
+                          std::vector<double>& distances) const;
+
     protected:
         class Octant {
         public:
@@ -248,6 +261,14 @@ namespace unibn {
         bool findNeighbor(
             const Octant* octant, const PointT& query, double minDistance, double& maxDistance, int32_t& resultIndex) const;
 
+        /** @return true, if search finished, otherwise false. **/
+        template <typename Distance>
+        bool knnNeighbors(const Octant* octant,
+                          const PointT& query,
+                          uint32_t k,
+                          double& maxDistance,
+                          std::vector<std::pair<double, uint32_t>>& heap) const;
+
         template <typename Distance>
         void radiusNeighbors(const Octant* octant,
                              const PointT& query,
@@ -818,6 +839,102 @@ namespace unibn {
         return inside<Distance>(query, maxDistance, octant);
     }
 
+    template <typename PointT, typename ContainerT>
+    template <typename Distance>
+    void Octree<PointT, ContainerT>::knnNeighbors(const PointT& query,
+                                                  uint32_t k,
+                                                  std::vector<uint32_t>& resultIndices,
+                                                  std::vector<double>& distances) const {
+        resultIndices.clear();
+        distances.clear();
+        if(root_ == 0 || k == 0) {
+            return;
+        }
+
+        // max-heap of the k closest points found so far, the farthest of them on top
+        std::vector<std::pair<double, uint32_t>> heap;
+        heap.reserve(k + 1);
+        double maxDistance = std::numeric_limits<double>::infinity();
+        knnNeighbors<Distance>(root_, query, k, maxDistance, heap);
+
+        std::sort_heap(heap.begin(), heap.end());
+        resultIndices.reserve(heap.size());
+        distances.reserve(heap.size());
+        for(auto& entry : heap) {
+            distances.push_back(entry.first);
+            resultIndices.push_back(entry.second);
+        }
+    }
+
+    template <typename PointT, typename ContainerT>
+    template <typename Distance>
+    bool Octree<PointT, ContainerT>::knnNeighbors(const Octant* octant,
+                                                  const PointT& query,
+                                                  uint32_t k,
+                                                  double& maxDistance,
+                                                  std::vector<std::pair<double, uint32_t>>& heap) const {
+        const ContainerT& points = *data_;
+        // 1. first descend to leaf and check in leafs points, the search radius shrinks once k points are known.
+        if(octant->isLeaf) {
+            uint32_t idx = octant->start;
+            for(uint32_t i = 0; i < octant->size; ++i) {
+                const PointT& p = points[idx];
+                double dist = Distance::compute(query, p);
+                if(heap.size() < k || dist < heap.front().first) {
+                    heap.emplace_back(dist, idx);
+                    std::push_heap(heap.begin(), heap.end());
+                    if(heap.size() > k) {
+                        std::pop_heap(heap.begin(), heap.end());
+                        heap.pop_back();
+                    }
+                }
+                idx = successors_[idx];
+            }
+
+            if(heap.size() == k) {
+                maxDistance = Distance::sqrt(heap.front().first);
+            }
+            return inside<Distance>(query, maxDistance, octant);
+        }
+
+        // determine Morton code for each point...
+        uint32_t mortonCode = 0;
+        if(get<0>(query) > octant->x) {
+            mortonCode |= 1;
+        }
+        if(get<1>(query) > octant->y) {
+            mortonCode |= 2;
+        }
+        if(get<2>(query) > octant->z) {
+            mortonCode |= 4;
+        }
+
+        if(octant->child[mortonCode] != 0) {
+            if(knnNeighbors<Distance>(octant->child[mortonCode], query, k, maxDistance, heap)) {
+                return true;
+            }
+        }
+
+        // 2. check adjacent octants overlapping with the ball around the current k-th neighbor.
+        for(uint32_t c = 0; c < 8; ++c) {
+            if(c == mortonCode) {
+                continue;
+            }
+            if(octant->child[c] == 0) {
+                continue;
+            }
+            if(!overlaps<Distance>(query, maxDistance, Distance::sqr(maxDistance), octant->child[c])) {
+                continue;
+            }
+            if(knnNeighbors<Distance>(octant->child[c], query, k, maxDistance, heap)) {
+                return true; // early pruning
+            }
+        }
+
+        // all children have been checked...check if the ball of the k-th neighbor is inside the current octant...
+        return inside<Distance>(query, maxDistance, octant);
+    }
+
     template <typename PointT, typename ContainerT>
     template <typename Distance>
     bool Octree<PointT, ContainerT>::inside(const PointT& query, double radius, const Octant* octant) {
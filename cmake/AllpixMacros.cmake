@@ -47,8 +47,14 @@ MACRO(_allpix_module_define_common name)
 Create the header or provide the alternative class name as first argument")
     ENDIF()
 
-    # Define the library
-    ADD_LIBRARY(${${name}} SHARED "")
+    # Define the library, for the monolithic build the objects are linked into the executable and the module is registered
+    # under its name instead of being loaded from its library
+    IF(BUILD_MONOLITHIC AND NOT ALLPIX_MODULE_EXTERNAL)
+        ADD_LIBRARY(${${name}} OBJECT "")
+        TARGET_COMPILE_DEFINITIONS(${${name}} PRIVATE ALLPIX_MODULE_TYPE="${_allpix_module_dir}")
+    ELSE()
+        ADD_LIBRARY(${${name}} SHARED "")
+    ENDIF()
 
     # Add the current directory as include directory
     TARGET_INCLUDE_DIRECTORIES(${${name}} PRIVATE ${CMAKE_CURRENT_SOURCE_DIR})
@@ -66,8 +72,10 @@ Create the header or provide the alternative class name as first argument")
         SET_PROPERTY(SOURCE "${PROJECT_SOURCE_DIR}/src/core/module/dynamic_module_impl.cpp" APPEND PROPERTY OBJECT_DEPENDS "${CMAKE_CURRENT_SOURCE_DIR}/${_allpix_module_class}.hpp")
         SET_PROPERTY(SOURCE "${PROJECT_SOURCE_DIR}/src/core/module/Module.cpp" APPEND PROPERTY OBJECT_DEPENDS "${CMAKE_CURRENT_SOURCE_DIR}/${_allpix_module_class}.hpp")
 
-        # Add to the interface library for devices:
-        TARGET_LINK_LIBRARIES(Modules INTERFACE ${${name}})
+        # Add to the interface library for devices, the objects of the monolithic build are only linked into the executable
+        IF(NOT BUILD_MONOLITHIC)
+            TARGET_LINK_LIBRARIES(Modules INTERFACE ${${name}})
+        ENDIF()
     ENDIF()
 ENDMACRO()
 
@@ -109,12 +117,15 @@ ENDMACRO()
 
 # Provide default install target for the module
 MACRO(allpix_module_install name)
-    INSTALL(TARGETS ${name}
-        COMPONENT modules
-        EXPORT Allpix
-        RUNTIME DESTINATION bin
-        LIBRARY DESTINATION lib
-        ARCHIVE DESTINATION lib)
+    # The objects of the monolithic build are part of the executable
+    IF(NOT BUILD_MONOLITHIC OR ALLPIX_MODULE_EXTERNAL)
+        INSTALL(TARGETS ${name}
+            COMPONENT modules
+            EXPORT Allpix
+            RUNTIME DESTINATION bin
+            LIBRARY DESTINATION lib
+            ARCHIVE DESTINATION lib)
+    ENDIF()
 ENDMACRO()
 
 # Macro to set up Eigen3:: targets
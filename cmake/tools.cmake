@@ -150,3 +150,27 @@ FUNCTION(ADD_ALLPIX_TEST TEST)
     ENDIF()
 
 ENDFUNCTION()
+
+FUNCTION(ADD_ALLPIX_SCALING_TEST TEST MAX_WORKERS)
+    # Minimum parallel efficiency with the largest number of workers, relative to a single worker:
+    SET(EFFICIENCY 0)
+    FILE(STRINGS ${TEST} TESTEFFICIENCY REGEX "#EFFICIENCY ")
+    IF(TESTEFFICIENCY)
+        STRING(REPLACE "#EFFICIENCY " "" EFFICIENCY "${TESTEFFICIENCY}")
+    ENDIF()
+
+    ADD_TEST(NAME ${TEST}
+        WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}
+        COMMAND ${CMAKE_CURRENT_SOURCE_DIR}/run_scaling.sh "output/${TEST}" "${CMAKE_INSTALL_PREFIX}/bin/allpix" "${CMAKE_CURRENT_SOURCE_DIR}/${TEST}" ${MAX_WORKERS} ${EFFICIENCY}
+    )
+
+    # Add individual timeout criteria:
+    FILE(STRINGS ${TEST} TESTTIMEOUT REGEX "#TIMEOUT ")
+    IF(TESTTIMEOUT)
+        STRING(REPLACE "#TIMEOUT " "" TESTTIMEOUT "${TESTTIMEOUT}")
+        SET_TESTS_PROPERTIES(${TEST} PROPERTIES TIMEOUT "${TESTTIMEOUT}")
+    ENDIF()
+
+    # Scaling tests occupy all cores and should never run in parallel to other tests:
+    SET_TESTS_PROPERTIES(${TEST} PROPERTIES RUN_SERIAL TRUE)
+ENDFUNCTION()
@@ -0,0 +1,84 @@
+#!/bin/bash
+# Run a configuration with an increasing number of workers and write a table of the event rate, the speedup and the
+# parallel efficiency relative to a single worker, followed by the execution time of every module instantiation. Fails if
+# the parallel efficiency with the largest number of workers is below the minimum efficiency.
+#
+# Usage: run_scaling.sh <output directory> <executable> <configuration> <maximum workers> <minimum efficiency> [options]
+# Additional options are passed to the executable.
+
+ABSOLUTE_PATH="$( cd "$( dirname "${BASH_SOURCE}" )" && pwd )"
+
+# Load dependencies if run by the CI
+# FIXME: This is needed because of broken RPATH on Mac
+if [ -n "${CI}" ] && [ "$(uname)" == "Darwin" ]; then
+    source $ABSOLUTE_PATH/../../.gitlab/ci/init_mac.sh
+    source $ABSOLUTE_PATH/../../.gitlab/ci/load_deps.sh
+fi
+
+if [ "$#" -lt 5 ]; then
+    echo "Usage: $0 <output directory> <executable> <configuration> <maximum workers> <minimum efficiency> [options]"
+    exit 1
+fi
+OUTPUT=$1
+EXECUTABLE=$2
+CONFIGURATION=$3
+MAX_WORKERS=$4
+MIN_EFFICIENCY=$5
+shift 5
+
+# Double the number of workers up to the maximum, which is always included
+WORKERS=""
+for (( n = 1; n < MAX_WORKERS; n *= 2 )); do
+    WORKERS="$WORKERS $n"
+done
+WORKERS="$WORKERS $MAX_WORKERS"
+
+rm -rf $OUTPUT
+mkdir -p $OUTPUT
+cd $OUTPUT
+
+# Only the last line of the metrics is written at the end of the event loop, it covers the full loop without initialization
+TABLE="WORKERS|EVENTS/S|SPEEDUP|EFFICIENCY\n"
+MODULES=""
+for n in $WORKERS; do
+    mkdir -p workers_$n
+    ( cd workers_$n && $EXECUTABLE -c $CONFIGURATION -o experimental_multithreading=true -o workers=$n \
+        -o metrics_file=metrics.json -o metrics_interval=1000000s -o statistics_file=statistics.json "$@" > log.txt 2>&1 )
+    if [ $? -ne 0 ]; then
+        echo "Run with $n workers failed, see $OUTPUT/workers_$n/log.txt"
+        tail -n 20 workers_$n/log.txt
+        exit 1
+    fi
+
+    METRICS=$(tail -n 1 workers_$n/output/metrics.json)
+    TIME=$(echo "$METRICS" | sed 's/.*"time": \([^,]*\),.*/\1/')
+    EVENTS=$(echo "$METRICS" | sed 's/.*"events": \([^,]*\),.*/\1/')
+    RATE=$(awk -v events=$EVENTS -v time=$TIME 'BEGIN { printf "%.3f", (time > 0 ? events / time : 0) }')
+    if [ "$n" -eq 1 ]; then
+        BASE_RATE=$RATE
+    fi
+    SPEEDUP=$(awk -v rate=$RATE -v base=$BASE_RATE 'BEGIN { printf "%.2f", (base > 0 ? rate / base : 0) }')
+    EFFICIENCY=$(awk -v speedup=$SPEEDUP -v n=$n 'BEGIN { printf "%.2f", speedup / n }')
+    TABLE="$TABLE$n|$RATE|$SPEEDUP|$EFFICIENCY\n"
+
+    # Execution time of every module instantiation from the performance statistics
+    MODULES="$MODULES$(awk -v n=$n -F'"' '/"name":/ { name = $4 } /"execution_time":/ {
+        split($0, value, ": "); sub(",", "", value[2]); printf "%s|%s|%.3f\\n", n, name, value[2] }' \
+        workers_$n/output/statistics.json)"
+done
+
+# Align the columns of a table with the fields separated by "|", given the width of the second column
+format_table() {
+    awk -F'|' -v width=$1 '{ for(i = 1; i <= NF; ++i) { printf "%-*s", (i == NF ? 0 : (i == 2 ? width : 12)), $i }
+        printf "\n" }'
+}
+echo -ne "$TABLE" | format_table 12 | tee scaling.txt
+echo "" | tee -a scaling.txt
+echo -ne "WORKERS|MODULE|TIME [S]\n$MODULES" | format_table 40 | tee -a scaling.txt
+
+# Compare the parallel efficiency with the largest number of workers to the required minimum
+if awk -v efficiency=$EFFICIENCY -v minimum=$MIN_EFFICIENCY 'BEGIN { exit !(efficiency < minimum) }'; then
+    echo "Parallel efficiency of $EFFICIENCY with $MAX_WORKERS workers is below the minimum of $MIN_EFFICIENCY"
+    exit 1
+fi
+echo "Parallel efficiency of $EFFICIENCY with $MAX_WORKERS workers"
@@ -8,11 +8,15 @@
 
 #include "Allpix.hpp"
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <climits>
+#include <cstdlib>
 #include <fstream>
 #include <memory>
 #include <stdexcept>
+#include <string>
 #include <thread>
 #include <utility>
 
@@ -24,12 +28,42 @@
 #include "core/config/exceptions.h"
 #include "core/utils/file.h"
 #include "core/utils/log.h"
+#include "core/utils/numa.h"
 #include "core/utils/unit.h"
 
 #include "tools/units.h"
 
 using namespace allpix;
 
+/**
+ * The rank and the number of ranks are read from the environment variables set by the common MPI implementations and by
+ * the SLURM workload manager, in this order. Returns false if none of them are set.
+ */
+static bool get_process_rank(unsigned int& rank, unsigned int& size) {
+    std::array<std::pair<const char*, const char*>, 3> variables{{{"OMPI_COMM_WORLD_RANK", "OMPI_COMM_WORLD_SIZE"},
+                                                                  {"PMI_RANK", "PMI_SIZE"},
+                                                                  {"SLURM_PROCID", "SLURM_NTASKS"}}};
+    for(auto& variable : variables) {
+        const char* rank_env = std::getenv(variable.first);
+        const char* size_env = std::getenv(variable.second);
+        if(rank_env != nullptr && size_env != nullptr) {
+            rank = static_cast<unsigned int>(std::stoul(rank_env));
+            size = static_cast<unsigned int>(std::stoul(size_env));
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Time elapsed since a point in time
+ * @param start Point in time to measure from
+ * @return Elapsed time in seconds
+ */
+static long double seconds_since(std::chrono::steady_clock::time_point start) {
+    return static_cast<std::chrono::duration<long double>>(std::chrono::steady_clock::now() - start).count();
+}
+
 /**
  * This class will own the managers for the lifetime of the simulation. Will do early initialization:
  * - Configure the special header sections.
@@ -41,6 +75,8 @@ Allpix::Allpix(std::string config_file_name,
                const std::vector<std::string>& detector_options)
     : terminate_(false), has_run_(false), msg_(std::make_unique<Messenger>()), mod_mgr_(std::make_unique<ModuleManager>()),
       geo_mgr_(std::make_unique<GeometryManager>()) {
+    auto start = std::chrono::steady_clock::now();
+
     // Load the global configuration
     conf_mgr_ = std::make_unique<ConfigManager>(std::move(config_file_name),
                                                 std::initializer_list<std::string>({"Allpix", ""}),
@@ -63,6 +99,11 @@ Allpix::Allpix(std::string config_file_name,
         try {
             LogLevel log_level = Log::getLevelFromString(log_level_string);
             Log::setReportingLevel(log_level);
+            if(log_level > LogLevel::ALLPIX_LOG_LEVEL_MAX) {
+                LOG(WARNING) << "Log level \"" << log_level_string << "\" exceeds the highest log level "
+                             << Log::getStringFromLevel(LogLevel::ALLPIX_LOG_LEVEL_MAX)
+                             << " compiled into the framework, messages of higher levels are not shown";
+            }
         } catch(std::invalid_argument& e) {
             LOG(ERROR) << "Log level \"" << log_level_string
                        << "\" specified in the configuration is invalid, defaulting to INFO instead";
@@ -95,6 +136,7 @@ Allpix::Allpix(std::string config_file_name,
     // Wait for the first detailed messages until level and format are properly set
     LOG(TRACE) << "Global log level is set to " << log_level_string;
     LOG(TRACE) << "Global log format is set to " << log_format_string;
+    mod_mgr_->getStartupProfile().add(StartupProfile::Category::PHASE, "configuration", seconds_since(start));
 }
 
 /**
@@ -106,6 +148,8 @@ Allpix::Allpix(std::string config_file_name,
  */
 void Allpix::load() {
     LOG(TRACE) << "Loading Allpix";
+    auto& startup_profile = mod_mgr_->getStartupProfile();
+    auto start = std::chrono::steady_clock::now();
 
     // Fetch the global configuration
     Configuration& global_config = conf_mgr_->getGlobalConfiguration();
@@ -161,6 +205,35 @@ void Allpix::load() {
         directory = global_config.getPath("output_directory");
     }
 
+    // Simulate only the part of the event range assigned to this process if the run is distributed over several processes
+    if(global_config.get<bool>("split_events_by_rank", false)) {
+        unsigned int rank = 0, size = 1;
+        if(!get_process_rank(rank, size) || size == 0 || rank >= size) {
+            throw InvalidValueError(
+                global_config, "split_events_by_rank", "no valid process rank found in the environment of this process");
+        }
+        if(!global_config.has("random_seed")) {
+            throw InvalidValueError(global_config,
+                                    "split_events_by_rank",
+                                    "a random seed has to be configured to simulate the same events in all processes");
+        }
+
+        // Divide the events in consecutive ranges, the first ranks simulate one additional event if not evenly divisible
+        auto total_events = global_config.get<unsigned int>("number_of_events", 1u);
+        auto first_event = global_config.get<unsigned int>("first_event", 1u);
+        auto base_events = total_events / size;
+        auto extra_events = total_events % size;
+        first_event += rank * base_events + std::min(rank, extra_events);
+        auto number_of_events = base_events + (rank < extra_events ? 1 : 0);
+        global_config.set<unsigned int>("first_event", first_event);
+        global_config.set<unsigned int>("number_of_events", number_of_events);
+        LOG(STATUS) << "Process " << rank << " of " << size << " simulates " << number_of_events
+                    << " events starting from event " << first_event;
+
+        // Write the output of every process to its own directory
+        directory += "/rank_" + std::to_string(rank);
+    }
+
     // Use existing output directory if it exists
     bool create_output_dir = true;
     if(allpix::path_is_directory(directory)) {
@@ -197,12 +270,18 @@ void Allpix::load() {
     // Set the ROOT style
     set_style();
 
+    startup_profile.add(StartupProfile::Category::PHASE, "setup", seconds_since(start));
+
     // Load the geometry
+    start = std::chrono::steady_clock::now();
     geo_mgr_->load(conf_mgr_.get(), seeder_core);
+    startup_profile.add(StartupProfile::Category::PHASE, "geometry", seconds_since(start));
 
     // Load the modules from the configuration
     if(!terminate_) {
+        start = std::chrono::steady_clock::now();
         mod_mgr_->load(msg_.get(), conf_mgr_.get(), geo_mgr_.get(), seeder_modules);
+        startup_profile.add(StartupProfile::Category::PHASE, "module loading", seconds_since(start));
     } else {
         LOG(INFO) << "Skip loading modules because termination is requested";
     }
@@ -214,7 +293,9 @@ void Allpix::load() {
 void Allpix::init() {
     if(!terminate_) {
         LOG(TRACE) << "Initializing Allpix";
+        auto start = std::chrono::steady_clock::now();
         mod_mgr_->init();
+        mod_mgr_->getStartupProfile().add(StartupProfile::Category::PHASE, "initialization", seconds_since(start));
     } else {
         LOG(INFO) << "Skip initializing modules because termination is requested";
     }
@@ -225,6 +306,36 @@ void Allpix::init() {
 void Allpix::run() {
     if(!terminate_) {
         LOG(TRACE) << "Running Allpix";
+
+        // Back the field grids by huge pages if requested, before any copies of them are created
+        Configuration& global_config = conf_mgr_->getGlobalConfiguration();
+        auto start = std::chrono::steady_clock::now();
+        bool prepare_fields =
+            global_config.get<bool>("huge_pages", false) || global_config.get<bool>("replicate_fields", false);
+        if(global_config.get<bool>("huge_pages", false)) {
+            LOG(STATUS) << "Backing the field grids of all detectors by huge pages";
+            for(auto& detector : geo_mgr_->getDetectors()) {
+                detector->useHugePagesForFields();
+            }
+        }
+
+        // Replicate the field grids for every NUMA node if requested, to be read by the workers pinned to the node
+        if(global_config.get<bool>("replicate_fields", false)) {
+            if(!global_config.get<bool>("pin_workers", false)) {
+                LOG(WARNING) << "Replicating the fields requires pinned workers, ignoring";
+            } else {
+                auto nodes = get_numa_node_count();
+                LOG(STATUS) << "Replicating the field grids of all detectors for " << nodes << " NUMA node(s)";
+                for(auto& detector : geo_mgr_->getDetectors()) {
+                    detector->replicateFields(nodes);
+                }
+            }
+        }
+
+        if(prepare_fields) {
+            mod_mgr_->getStartupProfile().add(StartupProfile::Category::PHASE, "field preparation", seconds_since(start));
+        }
+
         mod_mgr_->run();
 
         // Set that we have run and want to finalize as well
@@ -233,6 +344,18 @@ void Allpix::run() {
         LOG(INFO) << "Skip running modules because termination is requested";
     }
 }
+/**
+ * Applies the options to the instance configurations and re-creates the instantiations from the first changed one onwards
+ */
+void Allpix::reconfigure(const std::vector<std::string>& module_options) {
+    if(!terminate_) {
+        LOG(TRACE) << "Reconfiguring Allpix";
+        auto changed = conf_mgr_->updateInstanceOptions(module_options);
+        mod_mgr_->reconfigure(msg_.get(), geo_mgr_.get(), changed);
+    } else {
+        LOG(INFO) << "Skip reconfiguring modules because termination is requested";
+    }
+}
 /**
  * Runs all modules Module::finalize() method linearly for every module
  */
@@ -61,6 +61,17 @@ namespace allpix {
          */
         void run();
 
+        /**
+         * @brief Change the configuration of module instantiations to run again in the same process
+         * @param module_options List of module options, in the same format as the options of the executable
+         * @warning Should be called after the \ref Allpix::init "init function" and before the next run
+         *
+         * The instantiation with the first changed configuration and all instantiations after it are finalized, created
+         * again and initialized. All instantiations before it are kept without initializing them again, such that for
+         * example the geometry, the fields and the Geant4 physics do not have to be rebuilt for every run of a scan.
+         */
+        void reconfigure(const std::vector<std::string>& module_options);
+
         /**
          * @brief Finalize all modules (post-run)
          * @warning Should be called after the \ref Allpix::run "run function"
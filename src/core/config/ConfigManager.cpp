@@ -11,6 +11,7 @@
 
 #include <algorithm>
 #include <fstream>
+#include <iterator>
 #include <string>
 #include <vector>
 
@@ -84,7 +85,8 @@ void ConfigManager::parse_detectors() {
     std::ifstream detector_file(detector_file_name);
     ConfigReader detector_reader(detector_file, detector_file_name);
     auto detector_configs = detector_reader.getConfigurations();
-    detector_configs_ = std::list<Configuration>(detector_configs.begin(), detector_configs.end());
+    detector_configs_ = std::list<Configuration>(std::make_move_iterator(detector_configs.begin()),
+                                                 std::make_move_iterator(detector_configs.end()));
 }
 
 /**
@@ -117,6 +119,29 @@ bool ConfigManager::loadModuleOptions(const std::vector<std::string>& options) {
     return optionsApplied;
 }
 
+/**
+ * The options are applied to the instance configurations by module name and by unique name of the instantiation, as when
+ * the instance configurations are added. Global options without a module name are ignored.
+ */
+std::set<std::string> ConfigManager::updateInstanceOptions(const std::vector<std::string>& options) {
+    OptionParser option_parser;
+    for(auto& option : options) {
+        option_parser.parseOption(option);
+    }
+
+    std::set<std::string> changed;
+    for(auto& name_config : instance_name_to_config_) {
+        auto& config = *name_config.second;
+        auto old_values = config.getAll();
+        option_parser.applyOptions(config.getName(), config);
+        option_parser.applyOptions(name_config.first, config);
+        if(config.getAll() != old_values) {
+            changed.insert(name_config.first);
+        }
+    }
+    return changed;
+}
+
 /**
  * Load all extra options that should be added on top of the detector configuration in the file. The options loaded here are
  * automatically applied to the detector instance when these are added later and will be taken into account when possibly
@@ -96,6 +96,12 @@ namespace allpix {
          * @note Instance configuration options are applied in \ref ConfigManager::addInstanceConfiguration instead
          */
         bool loadModuleOptions(const std::vector<std::string>& options);
+        /**
+         * @brief Apply module options to the instance configurations of the already created module instantiations
+         * @param options List of options to apply, in the same format as for \ref ConfigManager::loadModuleOptions
+         * @return Unique names of the instantiations with a configuration changed by the options
+         */
+        std::set<std::string> updateInstanceOptions(const std::vector<std::string>& options);
         /**
          * @brief Get all the detector configurations
          * @return Reference to list of detector configurations
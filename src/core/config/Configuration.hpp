@@ -14,6 +14,7 @@
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "core/utils/text.h"
@@ -23,6 +24,8 @@ namespace allpix {
 
     template <typename T> using Matrix = std::vector<std::vector<T>>;
 
+    template <typename T> class ConfigParameter;
+
     /**
      * @brief Generic configuration object storing keys
      *
@@ -84,6 +87,15 @@ namespace allpix {
          */
         template <typename T> T get(const std::string& key, const T& def) const;
 
+        /**
+         * @brief Get a typed handle to the value of a key, which is converted only once
+         * @param key Key to get value of
+         * @return Handle holding the value of the key in the type of the requested template parameter
+         * @note The handle is not updated if the key is changed afterwards, and should therefore only be requested after all
+         *       defaults have been set
+         */
+        template <typename T> ConfigParameter<T> getParameter(const std::string& key) const;
+
         /**
          * @brief Get values for a key containing an array
          * @param key Key to get values of
@@ -278,6 +290,50 @@ namespace allpix {
         using ConfigMap = std::map<std::string, std::string>;
         ConfigMap config_;
     };
+
+    /**
+     * @brief Typed value of a configuration key, converted once when the handle is created
+     *
+     * Every lookup of a key in the \ref Configuration searches the key and converts the stored string to the requested
+     * type. Values that are needed for every event or for every object should therefore be retrieved once, for example in
+     * the constructor of a module, using \ref Configuration::getParameter. The handle can be used like the value itself.
+     */
+    template <typename T> class ConfigParameter {
+    public:
+        /**
+         * @brief Construct an empty handle holding a default-constructed value
+         */
+        ConfigParameter() = default;
+
+        /**
+         * @brief Construct a handle by converting the value of a key
+         * @param config Configuration to get the value from
+         * @param key Key to get value of
+         */
+        ConfigParameter(const Configuration& config, std::string key)
+            : key_(std::move(key)), value_(config.get<T>(key_)) {}
+
+        /**
+         * @brief Get the value of the key
+         * @return Value converted to the type of the handle
+         */
+        const T& get() const { return value_; }
+
+        /**
+         * @brief Implicit conversion to the value of the key
+         */
+        operator const T&() const { return value_; } // NOLINT
+
+        /**
+         * @brief Get the name of the key
+         * @return Key of the value
+         */
+        const std::string& getKey() const { return key_; }
+
+    private:
+        std::string key_;
+        T value_{};
+    };
 } // namespace allpix
 
 // Include template members
@@ -40,6 +40,15 @@ namespace allpix {
         return def;
     }
 
+    /**
+     * @throws MissingKeyError If the requested key is not defined
+     * @throws InvalidKeyError If the conversion to the requested type did not succeed
+     * @throws InvalidKeyError If an overflow happened while converting the key
+     */
+    template <typename T> ConfigParameter<T> Configuration::getParameter(const std::string& key) const {
+        return ConfigParameter<T>(*this, key);
+    }
+
     /**
      * @throws MissingKeyError If the requested key is not defined
      * @throws InvalidKeyError If the conversion to the requested type did not succeed
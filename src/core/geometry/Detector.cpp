@@ -8,10 +8,13 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <Math/Rotation3D.h>
 #include <Math/Translation3D.h>
@@ -38,8 +41,10 @@ Detector::Detector(std::string name,
     }
 
     magnetic_field_on_ = false;
-    // Build the transformation matrix
+    // Build the transformation matrix and the pixel geometry
     build_transform();
+    build_pixel_table();
+    build_geometry();
 }
 
 /**
@@ -57,9 +62,12 @@ void Detector::set_model(std::shared_ptr<DetectorModel> model) {
     // Initialize the detector fields with the model parameters:
     electric_field_.set_model_parameters(model_->getSensorCenter(), model_->getSensorSize(), model_->getPixelSize());
     weighting_potential_.set_model_parameters(model_->getSensorCenter(), model_->getSensorSize(), model_->getPixelSize());
+    weighting_field_.set_model_parameters(model_->getSensorCenter(), model_->getSensorSize(), model_->getPixelSize());
     magnetic_field_on_ = false;
 
     build_transform();
+    build_pixel_table();
+    build_geometry();
 }
 void Detector::build_transform() {
     // Transform from locally centered to global coordinates
@@ -74,6 +82,11 @@ void Detector::build_transform() {
     ROOT::Math::Transform3D transform_local(translation_local);
     // Compute total transform local to global by first transforming local to locally centered and then to global coordinates
     transform_ = transform_center * transform_local.Inverse();
+
+    // Cache the inverse and the matrix components, such that they are not recomputed for every conversion
+    inverse_transform_ = transform_.Inverse();
+    transform_.GetComponents(transform_matrix_.begin());
+    inverse_transform_.GetComponents(inverse_transform_matrix_.begin());
 }
 
 std::string Detector::getName() const {
@@ -100,12 +113,50 @@ ROOT::Math::Rotation3D Detector::getOrientation() const {
  * The origin of the local frame is at the center of the first pixel in the middle of the sensor.
  */
 ROOT::Math::XYZPoint Detector::getLocalPosition(const ROOT::Math::XYZPoint& global_pos) const {
-    return transform_.Inverse()(global_pos);
+    return inverse_transform_(global_pos);
 }
 ROOT::Math::XYZPoint Detector::getGlobalPosition(const ROOT::Math::XYZPoint& local_pos) const {
     return transform_(local_pos);
 }
 
+std::vector<ROOT::Math::XYZPoint>
+Detector::getLocalPositions(const std::vector<ROOT::Math::XYZPoint>& global_positions) const {
+    return transform_positions(inverse_transform_matrix_, global_positions);
+}
+std::vector<ROOT::Math::XYZPoint>
+Detector::getGlobalPositions(const std::vector<ROOT::Math::XYZPoint>& local_positions) const {
+    return transform_positions(transform_matrix_, local_positions);
+}
+
+/**
+ * The coordinates are copied into separate arrays first, such that the transformation is applied in a loop without
+ * dependencies between the iterations which can be vectorized by the compiler.
+ */
+std::vector<ROOT::Math::XYZPoint> Detector::transform_positions(const std::array<double, 12>& matrix,
+                                                                const std::vector<ROOT::Math::XYZPoint>& positions) {
+    auto size = positions.size();
+    std::vector<double> x(size), y(size), z(size);
+    for(size_t i = 0; i < size; ++i) {
+        x[i] = positions[i].x();
+        y[i] = positions[i].y();
+        z[i] = positions[i].z();
+    }
+
+    std::vector<double> out_x(size), out_y(size), out_z(size);
+    for(size_t i = 0; i < size; ++i) {
+        out_x[i] = matrix[0] * x[i] + matrix[1] * y[i] + matrix[2] * z[i] + matrix[3];
+        out_y[i] = matrix[4] * x[i] + matrix[5] * y[i] + matrix[6] * z[i] + matrix[7];
+        out_z[i] = matrix[8] * x[i] + matrix[9] * y[i] + matrix[10] * z[i] + matrix[11];
+    }
+
+    std::vector<ROOT::Math::XYZPoint> transformed;
+    transformed.reserve(size);
+    for(size_t i = 0; i < size; ++i) {
+        transformed.emplace_back(out_x[i], out_y[i], out_z[i]);
+    }
+    return transformed;
+}
+
 /**
  * The definition of inside the sensor is determined by the detector model
  */
@@ -145,17 +196,71 @@ Pixel Detector::getPixel(unsigned int x, unsigned int y) const {
  * The pixel has internal information about the size and location specific for this detector
  */
 Pixel Detector::getPixel(const Pixel::Index& index) const {
-    auto size = model_->getPixelSize();
-
     // WARNING This relies on the origin of the local coordinate system
-    auto local_x = size.x() * index.x();
-    auto local_y = size.y() * index.y();
-    auto local_z = model_->getSensorCenter().z() - model_->getSensorSize().z() / 2.0;
+    auto local_x = pixel_size_.x() * index.x();
+    auto local_y = pixel_size_.y() * index.y();
+    auto local_center = ROOT::Math::XYZPoint(local_x, local_y, pixel_local_z_);
 
-    auto local_center = ROOT::Math::XYZPoint(local_x, local_y, local_z);
-    auto global_center = getGlobalPosition(local_center);
+    // Pixels outside of the grid are not tabulated and therefore transformed directly
+    if(index.x() >= pixel_columns_.size() || index.y() >= pixel_rows_.size()) {
+        return {index, local_center, getGlobalPosition(local_center), pixel_size_};
+    }
 
-    return {index, local_center, global_center, size};
+    // Sum the contributions in the same order as the transformation, such that the center is identical to the transformed
+    // local center
+    const auto& column = pixel_columns_[index.x()];
+    const auto& row = pixel_rows_[index.y()];
+    ROOT::Math::XYZPoint global_center(column[0] + row[0] + pixel_depth_[0] + transform_matrix_[3],
+                                       column[1] + row[1] + pixel_depth_[1] + transform_matrix_[7],
+                                       column[2] + row[2] + pixel_depth_[2] + transform_matrix_[11]);
+    return {index, local_center, global_center, pixel_size_};
+}
+
+/**
+ * The global center of a pixel is the sum of the rotated local coordinates plus the translation. The rotated x-coordinate
+ * only depends on the column and the rotated y-coordinate only on the row, both are therefore tabulated once per column and
+ * row, while the contribution of the z-coordinate is identical for all pixels. The translation is added last, as in the
+ * transformation itself.
+ */
+void Detector::build_pixel_table() {
+    pixel_size_ = model_->getPixelSize();
+    pixel_local_z_ = model_->getSensorCenter().z() - model_->getSensorSize().z() / 2.0;
+
+    auto number_of_pixels = model_->getNPixels();
+    pixel_columns_.resize(static_cast<size_t>(std::max(number_of_pixels.x(), 0)));
+    for(size_t x = 0; x < pixel_columns_.size(); ++x) {
+        auto local_x = pixel_size_.x() * static_cast<unsigned int>(x);
+        pixel_columns_[x] = {
+            {transform_matrix_[0] * local_x, transform_matrix_[4] * local_x, transform_matrix_[8] * local_x}};
+    }
+    pixel_rows_.resize(static_cast<size_t>(std::max(number_of_pixels.y(), 0)));
+    for(size_t y = 0; y < pixel_rows_.size(); ++y) {
+        auto local_y = pixel_size_.y() * static_cast<unsigned int>(y);
+        pixel_rows_[y] = {{transform_matrix_[1] * local_y, transform_matrix_[5] * local_y, transform_matrix_[9] * local_y}};
+    }
+    pixel_depth_ = {{transform_matrix_[2] * pixel_local_z_,
+                     transform_matrix_[6] * pixel_local_z_,
+                     transform_matrix_[10] * pixel_local_z_}};
+}
+
+void Detector::build_geometry() {
+    auto sensor_center = model_->getSensorCenter();
+    auto sensor_size = model_->getSensorSize();
+    geometry_.sensor_center = {{sensor_center.x(), sensor_center.y(), sensor_center.z()}};
+    geometry_.sensor_size = {{sensor_size.x(), sensor_size.y(), sensor_size.z()}};
+    for(size_t axis = 0; axis < 3; ++axis) {
+        geometry_.sensor_lower[axis] = geometry_.sensor_center[axis] - geometry_.sensor_size[axis] / 2.0;
+        geometry_.sensor_upper[axis] = geometry_.sensor_center[axis] + geometry_.sensor_size[axis] / 2.0;
+    }
+
+    auto number_of_pixels = model_->getNPixels();
+    auto implant_size = model_->getImplantSize();
+    geometry_.pixel_pitch = {{pixel_size_.x(), pixel_size_.y()}};
+    geometry_.number_of_pixels = {{number_of_pixels.x(), number_of_pixels.y()}};
+    geometry_.implant_half_size = {{std::fabs(implant_size.x() / 2), std::fabs(implant_size.y() / 2)}};
+
+    geometry_.local_to_global = transform_matrix_;
+    geometry_.global_to_local = inverse_transform_matrix_;
 }
 
 /**
@@ -174,6 +279,18 @@ ROOT::Math::XYZVector Detector::getElectricField(const ROOT::Math::XYZPoint& pos
     return electric_field_.get(pos);
 }
 
+/**
+ * The cursor refers to the electric field of this detector and yields the same values as the lookup in the detector.
+ */
+DetectorFieldCursor<ROOT::Math::XYZVector, 3> Detector::getElectricFieldCursor() const {
+    return DetectorFieldCursor<ROOT::Math::XYZVector, 3>(&electric_field_);
+}
+
+DetectorField<ROOT::Math::XYZVector, 3> Detector::deriveElectricFieldGrid(
+    const std::function<ROOT::Math::XYZVector(const ROOT::Math::XYZVector&)>& function) const {
+    return electric_field_.derive(function);
+}
+
 /**
  * The type of the electric field is set depending on the function used to apply it.
  */
@@ -188,8 +305,41 @@ void Detector::setElectricFieldGrid(const std::shared_ptr<std::vector<double>>&
                                     std::array<size_t, 3> dimensions,
                                     std::array<double, 2> scales,
                                     std::array<double, 2> offset,
-                                    std::pair<double, double> thickness_domain) {
-    electric_field_.setGrid(field, dimensions, scales, offset, thickness_domain);
+                                    std::pair<double, double> thickness_domain,
+                                    FieldInterpolation interpolation,
+                                    FieldPrecision precision,
+                                    FieldSymmetry symmetry,
+                                    FieldLayout layout,
+                                    double z_tolerance) {
+    electric_field_.setGrid(
+        field, dimensions, scales, offset, thickness_domain, interpolation, precision, symmetry, layout, z_tolerance);
+}
+
+/**
+ * @throws std::invalid_argument If the electric field dimensions are incorrect or the thickness domain is outside the sensor
+ */
+void Detector::setElectricFieldGrid(const std::shared_ptr<const double>& field,
+                                    size_t elements,
+                                    std::array<size_t, 3> dimensions,
+                                    std::array<double, 2> scales,
+                                    std::array<double, 2> offset,
+                                    std::pair<double, double> thickness_domain,
+                                    FieldInterpolation interpolation,
+                                    FieldPrecision precision,
+                                    FieldSymmetry symmetry,
+                                    FieldLayout layout,
+                                    double z_tolerance) {
+    electric_field_.setGrid(field,
+                            elements,
+                            dimensions,
+                            scales,
+                            offset,
+                            thickness_domain,
+                            interpolation,
+                            precision,
+                            symmetry,
+                            layout,
+                            z_tolerance);
 }
 
 void Detector::setElectricFieldFunction(FieldFunction<ROOT::Math::XYZVector> function,
@@ -198,6 +348,26 @@ void Detector::setElectricFieldFunction(FieldFunction<ROOT::Math::XYZVector> fun
     electric_field_.setFunction(std::move(function), thickness_domain, type);
 }
 
+void Detector::setElectricFieldLinear(const ROOT::Math::XYZVector& direction,
+                                      double offset,
+                                      double slope,
+                                      std::pair<double, double> thickness_domain,
+                                      FieldType type) {
+    electric_field_.setLinear(direction, offset, slope, thickness_domain, type);
+}
+
+void Detector::replicateFields(unsigned int nodes) {
+    electric_field_.replicatePerNode(nodes);
+    weighting_potential_.replicatePerNode(nodes);
+    weighting_field_.replicatePerNode(nodes);
+}
+
+void Detector::useHugePagesForFields() {
+    electric_field_.useHugePages();
+    weighting_potential_.useHugePages();
+    weighting_field_.useHugePages();
+}
+
 bool Detector::hasWeightingPotential() const {
     return weighting_potential_.isValid();
 }
@@ -218,6 +388,23 @@ double Detector::getWeightingPotential(const ROOT::Math::XYZPoint& pos, const Pi
     return weighting_potential_.getRelativeTo(pos, {local_x, local_y}, true);
 }
 
+/**
+ * All potentials of the matrix are retrieved in a single query, which is considerably faster than obtaining the potential
+ * for every pixel separately.
+ */
+void Detector::getWeightingPotential(const ROOT::Math::XYZPoint& pos,
+                                     int x,
+                                     int y,
+                                     size_t size_x,
+                                     size_t size_y,
+                                     std::vector<double>& potentials) const {
+    auto size = model_->getPixelSize();
+
+    // WARNING This relies on the origin of the local coordinate system
+    ROOT::Math::XYPoint reference(size.x() * x, size.y() * y);
+    weighting_potential_.getRelativeTo(pos, reference, size, size_x, size_y, potentials, true);
+}
+
 /**
  * The type of the weighting potential is set depending on the function used to apply it.
  */
@@ -233,8 +420,42 @@ void Detector::setWeightingPotentialGrid(const std::shared_ptr<std::vector<doubl
                                          std::array<size_t, 3> dimensions,
                                          std::array<double, 2> scales,
                                          std::array<double, 2> offset,
-                                         std::pair<double, double> thickness_domain) {
-    weighting_potential_.setGrid(potential, dimensions, scales, offset, thickness_domain);
+                                         std::pair<double, double> thickness_domain,
+                                         FieldInterpolation interpolation,
+                                         FieldPrecision precision,
+                                         FieldSymmetry symmetry,
+                                         FieldLayout layout,
+                                         double z_tolerance) {
+    weighting_potential_.setGrid(
+        potential, dimensions, scales, offset, thickness_domain, interpolation, precision, symmetry, layout, z_tolerance);
+}
+
+/**
+ * @throws std::invalid_argument If the weighting potential dimensions are incorrect or the thickness domain is outside the
+ * sensor
+ */
+void Detector::setWeightingPotentialGrid(const std::shared_ptr<const double>& potential,
+                                         size_t elements,
+                                         std::array<size_t, 3> dimensions,
+                                         std::array<double, 2> scales,
+                                         std::array<double, 2> offset,
+                                         std::pair<double, double> thickness_domain,
+                                         FieldInterpolation interpolation,
+                                         FieldPrecision precision,
+                                         FieldSymmetry symmetry,
+                                         FieldLayout layout,
+                                         double z_tolerance) {
+    weighting_potential_.setGrid(potential,
+                                 elements,
+                                 dimensions,
+                                 scales,
+                                 offset,
+                                 thickness_domain,
+                                 interpolation,
+                                 precision,
+                                 symmetry,
+                                 layout,
+                                 z_tolerance);
 }
 
 void Detector::setWeightingPotentialFunction(FieldFunction<double> function,
@@ -243,20 +464,137 @@ void Detector::setWeightingPotentialFunction(FieldFunction<double> function,
     weighting_potential_.setFunction(std::move(function), thickness_domain, type);
 }
 
+bool Detector::hasWeightingField() const {
+    return weighting_field_.isValid();
+}
+
+/**
+ * As for the weighting potential, the field is retrieved relative to the reference pixels and extrapolated along z.
+ */
+void Detector::getWeightingField(const ROOT::Math::XYZPoint& pos,
+                                 int x,
+                                 int y,
+                                 size_t size_x,
+                                 size_t size_y,
+                                 std::vector<ROOT::Math::XYZVector>& fields) const {
+    auto size = model_->getPixelSize();
+
+    // WARNING This relies on the origin of the local coordinate system
+    ROOT::Math::XYPoint reference(size.x() * x, size.y() * y);
+    weighting_field_.getRelativeTo(pos, reference, size, size_x, size_y, fields, true);
+}
+
+/**
+ * @throws std::invalid_argument If the weighting field dimensions are incorrect or the thickness domain is outside the
+ * sensor
+ */
+void Detector::setWeightingFieldGrid(const std::shared_ptr<std::vector<double>>& field,
+                                     std::array<size_t, 3> dimensions,
+                                     std::array<double, 2> scales,
+                                     std::array<double, 2> offset,
+                                     std::pair<double, double> thickness_domain,
+                                     FieldInterpolation interpolation,
+                                     FieldPrecision precision,
+                                     FieldSymmetry symmetry,
+                                     FieldLayout layout) {
+    weighting_field_.setGrid(
+        field, dimensions, scales, offset, thickness_domain, interpolation, precision, symmetry, layout);
+}
+
 bool Detector::hasMagneticField() const {
     return magnetic_field_on_;
 }
 
-// TODO Currently the magnetic field in the detector is fixed to the field vector at it's center position. Change in case a
-// field gradient is needed inside the sensor.
 void Detector::setMagneticField(ROOT::Math::XYZVector b_field) {
     magnetic_field_on_ = true;
     magnetic_field_ = std::move(b_field);
+    magnetic_field_grid_.clear();
 }
 
 /**
- * The magnetic field is evaluated for any sensor position.
+ * @throws std::invalid_argument If the number of bins is zero along any axis
+ *
+ * The grid covers the full sensor, the field values are stored at the center of every bin.
  */
+void Detector::setMagneticFieldGrid(const FieldFunction<ROOT::Math::XYZVector>& global_field, std::array<size_t, 3> bins) {
+    if(bins[0] == 0 || bins[1] == 0 || bins[2] == 0) {
+        throw std::invalid_argument("magnetic field grid requires at least one bin in every dimension");
+    }
+
+    auto sensor_center = model_->getSensorCenter();
+    auto sensor_size = model_->getSensorSize();
+    std::array<double, 3> center{{sensor_center.x(), sensor_center.y(), sensor_center.z()}};
+    std::array<double, 3> size{{sensor_size.x(), sensor_size.y(), sensor_size.z()}};
+    for(size_t i = 0; i < 3; ++i) {
+        magnetic_field_lower_[i] = center[i] - size[i] / 2.0;
+        magnetic_field_bin_scale_[i] = static_cast<double>(bins[i]) / size[i];
+    }
+    magnetic_field_bins_ = bins;
+
+    // Evaluate the global field at the bin centers and rotate it into the local frame
+    auto to_local = orientation_.Inverse();
+    std::vector<ROOT::Math::XYZVector> grid;
+    grid.reserve(bins[0] * bins[1] * bins[2]);
+    for(size_t x = 0; x < bins[0]; ++x) {
+        for(size_t y = 0; y < bins[1]; ++y) {
+            for(size_t z = 0; z < bins[2]; ++z) {
+                ROOT::Math::XYZPoint local_pos(magnetic_field_lower_[0] + (x + 0.5) / magnetic_field_bin_scale_[0],
+                                               magnetic_field_lower_[1] + (y + 0.5) / magnetic_field_bin_scale_[1],
+                                               magnetic_field_lower_[2] + (z + 0.5) / magnetic_field_bin_scale_[2]);
+                grid.push_back(to_local * global_field(getGlobalPosition(local_pos)));
+            }
+        }
+    }
+    magnetic_field_grid_ = std::move(grid);
+
+    magnetic_field_on_ = true;
+    magnetic_field_ = getMagneticField(sensor_center);
+}
+
+bool Detector::hasMagneticFieldGrid() const {
+    return !magnetic_field_grid_.empty();
+}
+
 ROOT::Math::XYZVector Detector::getMagneticField() const {
     return magnetic_field_;
 }
+
+/**
+ * The field is interpolated trilinearly between the bin centers of the grid. Positions outside the grid take the value at
+ * the closest bin center, such that the field is continuous at the sensor edges.
+ */
+ROOT::Math::XYZVector Detector::getMagneticField(const ROOT::Math::XYZPoint& local_pos) const {
+    if(magnetic_field_grid_.empty()) {
+        return magnetic_field_;
+    }
+
+    std::array<double, 3> pos{{local_pos.x(), local_pos.y(), local_pos.z()}};
+    std::array<size_t, 3> strides{{magnetic_field_bins_[1] * magnetic_field_bins_[2], magnetic_field_bins_[2], 1}};
+    std::array<size_t, 3> index{};
+    std::array<double, 3> fraction{};
+    for(size_t i = 0; i < 3; ++i) {
+        auto bin = (pos[i] - magnetic_field_lower_[i]) * magnetic_field_bin_scale_[i] - 0.5;
+        bin = std::min(std::max(bin, 0.0), static_cast<double>(magnetic_field_bins_[i] - 1));
+        index[i] = std::min(static_cast<size_t>(bin), (magnetic_field_bins_[i] > 1 ? magnetic_field_bins_[i] - 2 : 0));
+        fraction[i] = bin - static_cast<double>(index[i]);
+        // Axes with a single bin have no upper neighbor
+        if(magnetic_field_bins_[i] == 1) {
+            strides[i] = 0;
+        }
+    }
+
+    ROOT::Math::XYZVector field;
+    for(size_t corner = 0; corner < 8; ++corner) {
+        double weight = 1;
+        size_t offset = 0;
+        for(size_t i = 0; i < 3; ++i) {
+            auto upper = ((corner >> i) & 1u) != 0;
+            weight *= (upper ? fraction[i] : 1 - fraction[i]);
+            offset += (index[i] + (upper ? 1 : 0)) * strides[i];
+        }
+        if(weight != 0) {
+            field += weight * magnetic_field_grid_[offset];
+        }
+    }
+    return field;
+}
@@ -26,6 +26,7 @@
 
 #include "Detector.hpp"
 #include "DetectorField.hpp"
+#include "DetectorGeometry.hpp"
 #include "DetectorModel.hpp"
 
 #include "objects/Pixel.hpp"
@@ -89,12 +90,33 @@ namespace allpix {
          * @return Position in the global frame
          */
         ROOT::Math::XYZPoint getGlobalPosition(const ROOT::Math::XYZPoint& local_pos) const;
+        /**
+         * @brief Convert a list of global positions to positions in the detector frame
+         * @param global_positions Positions in the global frame
+         * @return Positions in the local frame, in the same order
+         */
+        std::vector<ROOT::Math::XYZPoint> getLocalPositions(const std::vector<ROOT::Math::XYZPoint>& global_positions) const;
+        /**
+         * @brief Convert a list of positions in the detector frame to global positions
+         * @param local_positions Positions in the local frame
+         * @return Positions in the global frame, in the same order
+         */
+        std::vector<ROOT::Math::XYZPoint> getGlobalPositions(const std::vector<ROOT::Math::XYZPoint>& local_positions) const;
 
         /**
          * @brief Returns if a local position is within the sensitive device
          * @return True if a local position is within the sensor, false otherwise
          */
         bool isWithinSensor(const ROOT::Math::XYZPoint& local_pos) const;
+        /**
+         * @brief Returns if a local position is within the sensitive device
+         * @param local_pos Position in the local frame, of any type with the accessors x(), y() and z() such as
+         *                  Eigen::Vector3d
+         * @return True if a local position is within the sensor, false otherwise
+         */
+        template <typename Point> bool isWithinSensor(const Point& local_pos) const {
+            return isWithinSensor(ROOT::Math::XYZPoint(local_pos.x(), local_pos.y(), local_pos.z()));
+        }
 
         /**
          * @brief Returns if a local position is within the pixel implant region of the sensitive device
@@ -130,6 +152,19 @@ namespace allpix {
          * @return Vector of the field at the queried point
          */
         ROOT::Math::XYZVector getElectricField(const ROOT::Math::XYZPoint& local_pos) const;
+        /**
+         * @brief Get a cursor to look up the electric field along the path of a single charge carrier
+         * @return Cursor caching the grid values of the last looked-up bin of the electric field
+         * @warning The cursor should only be used by a single thread and not outlive the detector
+         */
+        DetectorFieldCursor<ROOT::Math::XYZVector, 3> getElectricFieldCursor() const;
+        /**
+         * @brief Create a vector field on the grid of the electric field, computed from the electric field on its grid
+         * @param function Function computing the value of the new field from the electric field
+         * @return Field on the grid of the electric field, invalid if the electric field is not defined by a grid
+         */
+        DetectorField<ROOT::Math::XYZVector, 3>
+        deriveElectricFieldGrid(const std::function<ROOT::Math::XYZVector(const ROOT::Math::XYZVector&)>& function) const;
 
         /**
          * @brief Set the electric field in a single pixel in the detector using a grid
@@ -137,12 +172,46 @@ namespace allpix {
          * @param sizes The dimensions of the flat electric field array
          * @param scales Scaling factors for the field size, given in fractions of a pixel unit cell in x and y
          * @param thickness_domain Domain in local coordinates in the thickness direction where the field holds
+         * @param interpolation Method used to obtain the field between the grid points
+         * @param precision Precision used to store the grid values
+         * @param symmetry Mirror symmetry of the grid, which then only covers the reduced domain
+         * @param layout Memory layout used to store the grid values
+         * @param z_tolerance Relative deviation up to which planes of the grid along z are dropped, zero to keep all planes
          */
         void setElectricFieldGrid(const std::shared_ptr<std::vector<double>>& field,
                                   std::array<size_t, 3> sizes,
                                   std::array<double, 2> scales,
                                   std::array<double, 2> offset,
-                                  std::pair<double, double> thickness_domain);
+                                  std::pair<double, double> thickness_domain,
+                                  FieldInterpolation interpolation = FieldInterpolation::NEAREST,
+                                  FieldPrecision precision = FieldPrecision::DOUBLE,
+                                  FieldSymmetry symmetry = FieldSymmetry::NONE,
+                                  FieldLayout layout = FieldLayout::FLAT,
+                                  double z_tolerance = 0);
+        /**
+         * @brief Set the electric field in a single pixel in the detector using a grid stored in externally owned memory
+         * @param field Shared pointer to the first element of the flat array of the field vectors, e.g. in a mapped file
+         * @param elements Number of elements of the flat field array
+         * @param sizes The dimensions of the flat electric field array
+         * @param scales Scaling factors for the field size, given in fractions of a pixel unit cell in x and y
+         * @param thickness_domain Domain in local coordinates in the thickness direction where the field holds
+         * @param interpolation Method used to obtain the field between the grid points
+         * @param precision Precision used to store the grid values
+         * @param symmetry Mirror symmetry of the grid, which then only covers the reduced domain
+         * @param layout Memory layout used to store the grid values
+         * @param z_tolerance Relative deviation up to which planes of the grid along z are dropped, zero to keep all planes
+         */
+        void setElectricFieldGrid(const std::shared_ptr<const double>& field,
+                                  size_t elements,
+                                  std::array<size_t, 3> sizes,
+                                  std::array<double, 2> scales,
+                                  std::array<double, 2> offset,
+                                  std::pair<double, double> thickness_domain,
+                                  FieldInterpolation interpolation = FieldInterpolation::NEAREST,
+                                  FieldPrecision precision = FieldPrecision::DOUBLE,
+                                  FieldSymmetry symmetry = FieldSymmetry::NONE,
+                                  FieldLayout layout = FieldLayout::FLAT,
+                                  double z_tolerance = 0);
         /**
          * @brief Set the electric field in a single pixel using a function
          * @param function Function used to retrieve the electric field
@@ -152,6 +221,20 @@ namespace allpix {
         void setElectricFieldFunction(FieldFunction<ROOT::Math::XYZVector> function,
                                       std::pair<double, double> thickness_domain,
                                       FieldType type = FieldType::CUSTOM);
+        /**
+         * @brief Set the electric field in the sensor to a closed form depending only on the position along z
+         * @param direction Electric field for a unit magnitude, pointing along z
+         * @param offset Magnitude of the electric field at the local position z = 0
+         * @param slope Change of the magnitude of the electric field per unit of z
+         * @param thickness_domain Domain in local coordinates in the thickness direction where the field holds
+         * @param type Type of the electric field, either linear or constant
+         * @see DetectorField::setLinear
+         */
+        void setElectricFieldLinear(const ROOT::Math::XYZVector& direction,
+                                    double offset,
+                                    double slope,
+                                    std::pair<double, double> thickness_domain,
+                                    FieldType type = FieldType::LINEAR);
 
         /**
          * @brief Returns if the detector has a weighting potential in the sensor
@@ -173,17 +256,84 @@ namespace allpix {
          */
         double getWeightingPotential(const ROOT::Math::XYZPoint& local_pos, const Pixel::Index& reference) const;
 
+        /**
+         * @brief Get the weighting potential in the sensor at a local position for a matrix of pixels
+         * @param local_pos Position in the local frame
+         * @param x x-coordinate of the first pixel of the matrix, which can be outside the pixel grid
+         * @param y y-coordinate of the first pixel of the matrix, which can be outside the pixel grid
+         * @param size_x Number of pixels of the matrix along x
+         * @param size_y Number of pixels of the matrix along y
+         * @param potentials Vector to store the potentials in, the potential of pixel (x + i, y + j) is stored at position
+         *                   i * size_y + j
+         */
+        void getWeightingPotential(const ROOT::Math::XYZPoint& local_pos,
+                                   int x,
+                                   int y,
+                                   size_t size_x,
+                                   size_t size_y,
+                                   std::vector<double>& potentials) const;
+        /**
+         * @brief Get the weighting potential in the sensor at a local position for a matrix of pixels
+         * @param local_pos Position in the local frame, of any type with the accessors x(), y() and z() such as
+         *                  Eigen::Vector3d
+         * @param x x-coordinate of the first pixel of the matrix, which can be outside the pixel grid
+         * @param y y-coordinate of the first pixel of the matrix, which can be outside the pixel grid
+         * @param size_x Number of pixels of the matrix along x
+         * @param size_y Number of pixels of the matrix along y
+         * @param potentials Vector to store the potentials in, the potential of pixel (x + i, y + j) is stored at position
+         *                   i * size_y + j
+         */
+        template <typename Point>
+        void getWeightingPotential(
+            const Point& local_pos, int x, int y, size_t size_x, size_t size_y, std::vector<double>& potentials) const {
+            getWeightingPotential(
+                ROOT::Math::XYZPoint(local_pos.x(), local_pos.y(), local_pos.z()), x, y, size_x, size_y, potentials);
+        }
+
         /**
          * @brief Set the weighting potential in a single pixel in the detector using a grid
          * @param potential Flat array of the potential vectors (see detailed description)
          * @param sizes The dimensions of the flat weighting potential array
          * @param thickness_domain Domain in local coordinates in the thickness direction where the potential holds
+         * @param interpolation Method used to obtain the potential between the grid points
+         * @param precision Precision used to store the grid values
+         * @param symmetry Mirror symmetry of the grid, which then only covers the reduced domain
+         * @param layout Memory layout used to store the grid values
+         * @param z_tolerance Relative deviation up to which planes of the grid along z are dropped, zero to keep all planes
          */
         void setWeightingPotentialGrid(const std::shared_ptr<std::vector<double>>& potential,
                                        std::array<size_t, 3> sizes,
                                        std::array<double, 2> scales,
                                        std::array<double, 2> offset,
-                                       std::pair<double, double> thickness_domain);
+                                       std::pair<double, double> thickness_domain,
+                                       FieldInterpolation interpolation = FieldInterpolation::NEAREST,
+                                       FieldPrecision precision = FieldPrecision::DOUBLE,
+                                       FieldSymmetry symmetry = FieldSymmetry::NONE,
+                                       FieldLayout layout = FieldLayout::FLAT,
+                                       double z_tolerance = 0);
+        /**
+         * @brief Set the weighting potential in a single pixel using a grid stored in externally owned memory
+         * @param potential Shared pointer to the first element of the flat array of the potential, e.g. in a mapped file
+         * @param elements Number of elements of the flat potential array
+         * @param sizes The dimensions of the flat weighting potential array
+         * @param thickness_domain Domain in local coordinates in the thickness direction where the potential holds
+         * @param interpolation Method used to obtain the potential between the grid points
+         * @param precision Precision used to store the grid values
+         * @param symmetry Mirror symmetry of the grid, which then only covers the reduced domain
+         * @param layout Memory layout used to store the grid values
+         * @param z_tolerance Relative deviation up to which planes of the grid along z are dropped, zero to keep all planes
+         */
+        void setWeightingPotentialGrid(const std::shared_ptr<const double>& potential,
+                                       size_t elements,
+                                       std::array<size_t, 3> sizes,
+                                       std::array<double, 2> scales,
+                                       std::array<double, 2> offset,
+                                       std::pair<double, double> thickness_domain,
+                                       FieldInterpolation interpolation = FieldInterpolation::NEAREST,
+                                       FieldPrecision precision = FieldPrecision::DOUBLE,
+                                       FieldSymmetry symmetry = FieldSymmetry::NONE,
+                                       FieldLayout layout = FieldLayout::FLAT,
+                                       double z_tolerance = 0);
         /**
          * @brief Set the weighting potential in a single pixel using a function
          * @param function Function used to retrieve the weighting potential
@@ -194,12 +344,66 @@ namespace allpix {
                                            std::pair<double, double> thickness_domain,
                                            FieldType type = FieldType::CUSTOM);
 
+        /**
+         * @brief Returns if the detector has a weighting field in the sensor
+         * @return True if the detector has a weighting field, false otherwise
+         */
+        bool hasWeightingField() const;
+
+        /**
+         * @brief Get the weighting field in the sensor at a local position for a matrix of pixels
+         * @param local_pos Position in the local frame
+         * @param x x-coordinate of the first pixel of the matrix, which can be outside the pixel grid
+         * @param y y-coordinate of the first pixel of the matrix, which can be outside the pixel grid
+         * @param size_x Number of pixels of the matrix along x
+         * @param size_y Number of pixels of the matrix along y
+         * @param fields Vector to store the fields in, the field of pixel (x + i, y + j) is stored at position
+         *               i * size_y + j
+         */
+        void getWeightingField(const ROOT::Math::XYZPoint& local_pos,
+                               int x,
+                               int y,
+                               size_t size_x,
+                               size_t size_y,
+                               std::vector<ROOT::Math::XYZVector>& fields) const;
+
+        /**
+         * @brief Set the weighting field, the negative gradient of the weighting potential, using a grid
+         * @param field Flat array of the field vectors, with the same layout as the weighting potential grid
+         * @param sizes The dimensions of the flat weighting field array
+         * @param scales Extent of the field in x and y
+         * @param offset Offset of the field in x and y
+         * @param thickness_domain Domain in local coordinates in the thickness direction where the field holds
+         * @param interpolation Method used to obtain the field between the grid points
+         * @param precision Precision used to store the grid values
+         * @param symmetry Mirror symmetry of the grid, which then only covers the reduced domain
+         * @param layout Memory layout used to store the grid values
+         */
+        void setWeightingFieldGrid(const std::shared_ptr<std::vector<double>>& field,
+                                   std::array<size_t, 3> sizes,
+                                   std::array<double, 2> scales,
+                                   std::array<double, 2> offset,
+                                   std::pair<double, double> thickness_domain,
+                                   FieldInterpolation interpolation = FieldInterpolation::NEAREST,
+                                   FieldPrecision precision = FieldPrecision::DOUBLE,
+                                   FieldSymmetry symmetry = FieldSymmetry::NONE,
+                                   FieldLayout layout = FieldLayout::FLAT);
+
         /**
          * @brief Set the magnetic field in the detector
          * @param function Function used to retrieve the magnetic field
          * @param type Type of the magnetic field function used
          */
         void setMagneticField(ROOT::Math::XYZVector b_field);
+        /**
+         * @brief Set the magnetic field in the detector by caching a field in global coordinates in a local grid
+         * @param global_field Function returning the magnetic field at a position in the global frame
+         * @param bins Number of bins of the grid covering the sensor in x, y and z
+         *
+         * The global field is evaluated once at the center of every bin and rotated into the local frame, such that lookups
+         * of the field in the sensor do not require any coordinate transformation.
+         */
+        void setMagneticFieldGrid(const FieldFunction<ROOT::Math::XYZVector>& global_field, std::array<size_t, 3> bins);
 
         /**
          * @brief Returns if the detector has a magnetic field in the sensor
@@ -207,11 +411,46 @@ namespace allpix {
          */
         bool hasMagneticField() const;
         /**
-         * @brief Get the magnetic field in the sensor at a local position
-         * @param pos Position in the local frame
-         * @return Vector of the field at the queried point
+         * @brief Returns if the magnetic field in the sensor is stored in a grid and depends on the position
+         * @return True if the detector has a magnetic field grid, false if the field is constant or switched off
+         */
+        bool hasMagneticFieldGrid() const;
+        /**
+         * @brief Get the magnetic field in the sensor
+         * @return Vector of the constant field, or of the field at the sensor center if the field is stored in a grid
          */
         ROOT::Math::XYZVector getMagneticField() const;
+        /**
+         * @brief Get the magnetic field in the sensor at a local position
+         * @param local_pos Position in the local frame
+         * @return Vector of the field at the queried point, linearly interpolated between the bins of the grid
+         */
+        ROOT::Math::XYZVector getMagneticField(const ROOT::Math::XYZPoint& local_pos) const;
+        /**
+         * @brief Get the magnetic field in the sensor at a local position
+         * @param local_pos Position in the local frame, of any type with the accessors x(), y() and z() such as
+         *                  Eigen::Vector3d
+         * @return Vector of the field at the queried point, linearly interpolated between the bins of the grid
+         */
+        template <typename Point> ROOT::Math::XYZVector getMagneticField(const Point& local_pos) const {
+            return getMagneticField(ROOT::Math::XYZPoint(local_pos.x(), local_pos.y(), local_pos.z()));
+        }
+
+        /**
+         * @brief Store a separate copy of the electric and weighting field and potential grids for every NUMA node
+         * @param nodes Number of NUMA nodes of the system
+         *
+         * The copies are created by the first thread of every node reading a field, such that they are placed in the local
+         * memory of the node. This is only useful if the worker threads are pinned to the CPUs of the nodes.
+         */
+        void replicateFields(unsigned int nodes);
+
+        /**
+         * @brief Back the electric and weighting field and potential grids by huge pages
+         *
+         * Should be called before \ref replicateFields to allocate the copies in huge pages as well.
+         */
+        void useHugePagesForFields();
 
         /**
          * @brief Get the model of this detector
@@ -219,6 +458,14 @@ namespace allpix {
          */
         const std::shared_ptr<DetectorModel> getModel() const;
 
+        /**
+         * @brief Get the flattened geometry of this detector
+         * @return Descriptor of the sensor, the pixel grid and the transformations, filled when the model is assigned
+         *
+         * Should be preferred over the getters of the model in loops over charge carriers, as it avoids virtual calls.
+         */
+        const DetectorGeometry& getGeometry() const { return geometry_; }
+
         /**
          * @brief Fetch an external object linked to this detector
          * @param name Name of the external object
@@ -252,25 +499,66 @@ namespace allpix {
          */
         void build_transform();
 
+        /**
+         * @brief Tabulate the geometry of the pixels, such that the pixel objects are created without a transformation
+         */
+        void build_pixel_table();
+
+        /**
+         * @brief Fill the flattened geometry from the model and the transformations
+         */
+        void build_geometry();
+
+        /**
+         * @brief Apply an affine transformation to a list of positions
+         * @param matrix Row-major 3x4 matrix of the transformation, with the translation in the last column
+         * @param positions Positions to transform
+         * @return Transformed positions, in the same order
+         */
+        static std::vector<ROOT::Math::XYZPoint> transform_positions(const std::array<double, 12>& matrix,
+                                                                     const std::vector<ROOT::Math::XYZPoint>& positions);
+
         std::string name_;
         std::shared_ptr<DetectorModel> model_;
 
         ROOT::Math::XYZPoint position_;
         ROOT::Math::Rotation3D orientation_;
 
-        // Transform matrix from global to local coordinates
+        // Transform matrix from local to global coordinates and its inverse
         ROOT::Math::Transform3D transform_;
+        ROOT::Math::Transform3D inverse_transform_;
+        // Components of both transformations as flat 3x4 matrices for the conversion of lists of positions
+        std::array<double, 12> transform_matrix_{};
+        std::array<double, 12> inverse_transform_matrix_{};
+
+        // Size of the pixels, local z-coordinate of their centers and the contributions of every column, every row and the
+        // z-coordinate to the global centers of the pixels in the grid
+        ROOT::Math::XYVector pixel_size_;
+        double pixel_local_z_{};
+        std::vector<std::array<double, 3>> pixel_columns_;
+        std::vector<std::array<double, 3>> pixel_rows_;
+        std::array<double, 3> pixel_depth_{};
+
+        // Flattened geometry for the loops over charge carriers
+        DetectorGeometry geometry_;
 
         // Electric field
         DetectorField<ROOT::Math::XYZVector, 3> electric_field_;
 
         // Weighting potential
         DetectorField<double, 1> weighting_potential_;
+        DetectorField<ROOT::Math::XYZVector, 3> weighting_field_;
 
         // Magnetic field properties
         ROOT::Math::XYZVector magnetic_field_;
         bool magnetic_field_on_;
 
+        // Magnetic field grid in local coordinates, with the lower corner and the number of bins per unit length
+        std::vector<ROOT::Math::XYZVector> magnetic_field_grid_;
+        std::array<size_t, 3> magnetic_field_bins_{};
+        std::array<double, 3> magnetic_field_lower_{};
+        std::array<double, 3> magnetic_field_bin_scale_{};
+
         std::map<std::type_index, std::map<std::string, std::shared_ptr<void>>> external_objects_;
     };
 
@@ -29,4 +29,19 @@ namespace allpix {
      * Here, no inversion of the field components is required
      */
     template <> void flip_vector_components<double>(double&, bool, bool) {}
+
+    /*
+     * Vector field template specialization of helper function for storing the field components
+     */
+    template <>
+    void store_vector_components<ROOT::Math::XYZVector>(const ROOT::Math::XYZVector& vec, double* components) {
+        components[0] = vec.x();
+        components[1] = vec.y();
+        components[2] = vec.z();
+    }
+
+    /*
+     * Scalar field template specialization of helper function for storing the field components
+     */
+    template <> void store_vector_components<double>(const double& value, double* components) { components[0] = value; }
 } // namespace allpix
@@ -11,8 +11,17 @@
 #ifndef ALLPIX_DETECTOR_FIELD_H
 #define ALLPIX_DETECTOR_FIELD_H
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <tuple>
 #include <vector>
 
 #include <Math/Point2D.h>
@@ -20,6 +29,8 @@
 #include <Math/Vector2D.h>
 #include <Math/Vector3D.h>
 
+#include "core/utils/memory.h"
+#include "core/utils/numa.h"
 #include "objects/Pixel.hpp"
 #include "tools/ROOT.h"
 
@@ -36,6 +47,41 @@ namespace allpix {
         CUSTOM,   ///< Custom field function
     };
 
+    /**
+     * @brief Interpolation methods for field grids
+     */
+    enum class FieldInterpolation {
+        NEAREST = 0, ///< Value of the nearest grid point
+        LINEAR,      ///< Trilinear interpolation between the surrounding grid points
+    };
+
+    /**
+     * @brief Precision used to store the values of field grids
+     */
+    enum class FieldPrecision {
+        DOUBLE = 0, ///< Values are stored as double precision floating point numbers
+        FLOAT,      ///< Values are stored as single precision floating point numbers
+        INT16,      ///< Values are quantised to 16-bit integers with a common scale factor for the full grid
+    };
+
+    /**
+     * @brief Mirror symmetries of field grids within the field extent
+     */
+    enum class FieldSymmetry {
+        NONE = 0, ///< The grid covers the full extent of the field
+        HALF_X,   ///< The grid covers the half with positive x, the field is mirrored at the center along x
+        HALF_Y,   ///< The grid covers the half with positive y, the field is mirrored at the center along y
+        QUARTER,  ///< The grid covers the quadrant with positive x and y, the field is mirrored along x and y
+    };
+
+    /**
+     * @brief Memory layouts of field grids
+     */
+    enum class FieldLayout {
+        FLAT = 0, ///< Flat array ordered by x, y and z, with z as the fastest changing index
+        TILED,    ///< Array of tiles of 4x4x4 bins ordered by x, y and z, keeping neighboring bins close in memory
+    };
+
     /**
      * @brief Functor returning the field at a given position
      * @param pos Position in local coordinates at which the field should be evaluated
@@ -50,6 +96,69 @@ namespace allpix {
      */
     template <typename T> void flip_vector_components(T& field, bool x, bool y);
 
+    /**
+     * @brief Helper function to store the components of a field value in a flat array
+     * @param field Field value, templated to support vector fields and scalar fields
+     * @param components Pointer to the array to store the components in
+     */
+    template <typename T> void store_vector_components(const T& field, double* components);
+
+    template <typename T, size_t N> class DetectorFieldCursor;
+
+    /**
+     * @brief Copies of a field grid for every NUMA node, each created by the first thread of the node reading the field
+     *
+     * The copy of a node is allocated and written by a thread running on the node, such that the operating system places it
+     * in the local memory of the node. Threads not pinned to a node use the copy of the first node.
+     */
+    class FieldReplicas {
+    public:
+        /**
+         * @brief Prepare the copies of a field grid, without copying the field yet
+         * @param field Pointer to the first element of the field grid
+         * @param bytes Size of the field grid in bytes
+         * @param nodes Number of NUMA nodes
+         * @param huge_pages Back the copies by huge pages
+         */
+        FieldReplicas(std::shared_ptr<const void> field, size_t bytes, unsigned int nodes, bool huge_pages)
+            : field_(std::move(field)), bytes_(bytes), huge_pages_(huge_pages), replicas_(nodes), storage_(nodes) {
+            for(auto& replica : replicas_) {
+                replica.store(nullptr);
+            }
+        }
+
+        /**
+         * @brief Get the copy of the field grid for the node of the calling thread, creating it on first use
+         * @return Pointer to the first element of the copy
+         */
+        const void* get() {
+            auto node = get_thread_numa_node();
+            if(node >= replicas_.size()) {
+                return field_.get();
+            }
+            const auto* replica = replicas_[node].load(std::memory_order_acquire);
+            if(replica == nullptr) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                replica = replicas_[node].load(std::memory_order_relaxed);
+                if(replica == nullptr) {
+                    storage_[node] = allocate_large_memory(bytes_, huge_pages_);
+                    std::memcpy(storage_[node].get(), field_.get(), bytes_);
+                    replica = storage_[node].get();
+                    replicas_[node].store(replica, std::memory_order_release);
+                }
+            }
+            return replica;
+        }
+
+    private:
+        std::shared_ptr<const void> field_;
+        size_t bytes_;
+        bool huge_pages_;
+        std::vector<std::atomic<const void*>> replicas_;
+        std::vector<std::shared_ptr<void>> storage_;
+        std::mutex mutex_;
+    };
+
     /**
      * @brief Field instance of a detector
      *
@@ -58,6 +167,7 @@ namespace allpix {
      */
     template <typename T, size_t N = 3> class DetectorField {
         friend class Detector;
+        friend class DetectorFieldCursor<T, N>;
 
     public:
         /**
@@ -69,7 +179,9 @@ namespace allpix {
          * @brief Check if the field is valid and either a field grid or a field function is configured
          * @return Boolean indicating field validity
          */
-        bool isValid() const { return function_ || (dimensions_[0] != 0 && dimensions_[1] != 0 && dimensions_[2] != 0); };
+        bool isValid() const {
+            return closed_form_ || function_ || (dimensions_[0] != 0 && dimensions_[1] != 0 && dimensions_[2] != 0);
+        };
 
         /**
          * @brief Return the type of field
@@ -95,6 +207,24 @@ namespace allpix {
                         const ROOT::Math::XYPoint& reference,
                         const bool extrapolate_z = false) const;
 
+        /**
+         * @brief Get the values of the field at a position provided in local coordinates for a matrix of references
+         * @param local_pos Position in the local frame
+         * @param reference First reference position of the matrix, x and y coordinate only
+         * @param pitch Distance between neighboring reference positions in x and y
+         * @param size_x Number of reference positions along x
+         * @param size_y Number of reference positions along y
+         * @param values Vector to store the values in, ordered by the reference along x first and along y second
+         * @param extrapolate_z Extrapolate the field along z when outside the defined region
+         */
+        void getRelativeTo(const ROOT::Math::XYZPoint& local_pos,
+                           const ROOT::Math::XYPoint& reference,
+                           const ROOT::Math::XYVector& pitch,
+                           size_t size_x,
+                           size_t size_y,
+                           std::vector<T>& values,
+                           const bool extrapolate_z = false) const;
+
         /**
          * @brief Set the field in the detector using a grid
          * @param field Flat array of the field
@@ -102,12 +232,95 @@ namespace allpix {
          * @param scales The actual physical extent of the field in each direction in x and y
          * @param offset Offset of the field in x and y, given in physical units
          * @param thickness_domain Domain in local coordinates in the thickness direction where the field holds
+         * @param interpolation Method used to obtain the field between the grid points
+         * @param precision Precision used to store the field values
+         * @param symmetry Mirror symmetry of the field, the grid only covers the reduced domain of a symmetric field
+         * @param layout Memory layout used to store the grid, the field is copied if it differs from the flat layout
+         * @param z_tolerance Maximum deviation relative to the largest field value with which planes of the grid along z are
+         *                    replaced by the interpolation between their neighbors, zero to store all planes
          */
         void setGrid(std::shared_ptr<std::vector<double>> field,
                      std::array<size_t, 3> dimensions,
                      std::array<double, 2> scales,
                      std::array<double, 2> offset,
-                     std::pair<double, double> thickness_domain);
+                     std::pair<double, double> thickness_domain,
+                     FieldInterpolation interpolation = FieldInterpolation::NEAREST,
+                     FieldPrecision precision = FieldPrecision::DOUBLE,
+                     FieldSymmetry symmetry = FieldSymmetry::NONE,
+                     FieldLayout layout = FieldLayout::FLAT,
+                     double z_tolerance = 0);
+
+        /**
+         * @brief Set the field in the detector using a grid stored in externally owned memory
+         * @param field Shared pointer to the first element of the flat field array, e.g. in a memory-mapped file
+         * @param elements Number of elements of the flat field array
+         * @param dimensions The dimensions of the flat field array
+         * @param scales The actual physical extent of the field in each direction in x and y
+         * @param offset Offset of the field in x and y, given in physical units
+         * @param thickness_domain Domain in local coordinates in the thickness direction where the field holds
+         * @param interpolation Method used to obtain the field between the grid points
+         * @param precision Precision used to store the field values, the field is copied if it differs from double
+         * @param symmetry Mirror symmetry of the field, the grid only covers the reduced domain of a symmetric field
+         * @param layout Memory layout used to store the grid, the field is copied if it differs from the flat layout
+         * @param z_tolerance Maximum deviation relative to the largest field value with which planes of the grid along z are
+         *                    replaced by the interpolation between their neighbors, zero to store all planes
+         */
+        void setGrid(std::shared_ptr<const double> field,
+                     size_t elements,
+                     std::array<size_t, 3> dimensions,
+                     std::array<double, 2> scales,
+                     std::array<double, 2> offset,
+                     std::pair<double, double> thickness_domain,
+                     FieldInterpolation interpolation = FieldInterpolation::NEAREST,
+                     FieldPrecision precision = FieldPrecision::DOUBLE,
+                     FieldSymmetry symmetry = FieldSymmetry::NONE,
+                     FieldLayout layout = FieldLayout::FLAT,
+                     double z_tolerance = 0);
+
+        /**
+         * @brief Return the precision used to store the field grid
+         * @return Precision of the stored field values
+         */
+        FieldPrecision getPrecision() const { return precision_; }
+
+        /**
+         * @brief Store a separate copy of the field grid for every NUMA node, to be read by the threads pinned to the node
+         * @param nodes Number of NUMA nodes, the field is not replicated for a single node
+         *
+         * The copies are created by the first thread of every node reading the field. Fields defined by a function and
+         * fields set afterwards are not replicated. The copies are backed by huge pages if \ref useHugePages was called
+         * before.
+         */
+        void replicatePerNode(unsigned int nodes) {
+            replicas_ =
+                (nodes > 1 && field_ != nullptr ? std::make_shared<FieldReplicas>(field_, field_bytes_, nodes, huge_pages_)
+                                                : nullptr);
+        }
+
+        /**
+         * @brief Back the field grid by huge pages, reducing the misses of the TLB for lookups spread over large grids
+         *
+         * The kernel is advised to back the existing grid by transparent huge pages in place, as the grid may be shared with
+         * other detectors. Copies created afterwards by \ref replicatePerNode are allocated in huge pages directly.
+         */
+        void useHugePages() {
+            huge_pages_ = true;
+            if(field_ != nullptr) {
+                advise_huge_pages(field_.get(), field_bytes_);
+            }
+        }
+        /**
+         * @brief Create a field on the same grid, with the values computed from the values of this field at the grid points
+         * @param function Function computing the value of the new field from the value of this field at a grid point
+         * @return Field with the same grid storing the computed values in double precision, or an invalid field if
+         *         this field is not defined by a grid
+         *
+         * For grids of symmetric fields, the function should commute with the mirroring of the vector components, as for
+         * example a scaling of the vector by a function of its magnitude. Between the grid points, the computed values are
+         * interpolated in the same way as the values of this field.
+         */
+        DetectorField derive(const std::function<T(const T&)>& function) const;
+
         /**
          * @brief Set the field in the detector using a function
          * @param function Function used to calculate the field
@@ -118,6 +331,24 @@ namespace allpix {
                          std::pair<double, double> thickness_domain,
                          FieldType type = FieldType::CUSTOM);
 
+        /**
+         * @brief Set the field in the detector to a closed form depending only on the position along z
+         * @param direction Value of the field for a unit magnitude, for vector fields only pointing along z
+         * @param offset Magnitude of the field at the local position z = 0
+         * @param slope Change of the magnitude of the field per unit of z
+         * @param thickness_domain Domain in local coordinates in the thickness direction where the field holds
+         * @param type Type of the field, either linear or constant
+         *
+         * The field is given by the direction multiplied with the magnitude offset + slope * z, which is limited to positive
+         * values such that the field vanishes outside of a depleted region. The field is evaluated inline on every lookup,
+         * independent of the pixel pitch, without calling a field function or converting the position to a field replica.
+         */
+        void setLinear(T direction,
+                       double offset,
+                       double slope,
+                       std::pair<double, double> thickness_domain,
+                       FieldType type = FieldType::LINEAR);
+
     private:
         /**
          * @brief Set the relevant parameters from the detector model this field is used for
@@ -134,6 +365,15 @@ namespace allpix {
             model_initialized_ = true;
         }
 
+        /**
+         * @brief Helper function to evaluate the closed form of linear and constant fields
+         * @param z Position along z in local coordinates, within the thickness domain
+         * @return Value(s) of the field at the queried point
+         */
+        T get_closed_form(double z) const {
+            return closed_form_direction_ * std::max(0., closed_form_offset_ + closed_form_slope_ * z);
+        }
+
         /**
          * @brief Helper function to retrieve the return type from a calculated index of the field data vector
          * @param offset The calculated global index to start from
@@ -141,23 +381,204 @@ namespace allpix {
          */
         template <std::size_t... I> auto get_impl(size_t offset, std::index_sequence<I...>) const;
 
+        /**
+         * @brief Helper function to retrieve the field grid, or its copy for the NUMA node of the calling thread
+         * @return Pointer to the first element of the field grid
+         */
+        const void* get_field_data() const { return replicas_ == nullptr ? field_.get() : replicas_->get(); }
+
+        /**
+         * @brief Helper function to calculate the index in the flat field vector from the bin indices
+         * @param x_ind Bin index along x
+         * @param y_ind Bin index along y
+         * @param z_ind Bin index along z
+         * @return Index of the first component of the field in the flat field vector
+         */
+        size_t get_index(size_t x_ind, size_t y_ind, size_t z_ind) const {
+            if(layout_ == FieldLayout::TILED) {
+                return get_tiled_index(x_ind, y_ind, z_ind);
+            }
+            return x_ind * grid_dimensions_[1] * grid_dimensions_[2] * N + y_ind * grid_dimensions_[2] * N + z_ind * N;
+        }
+
+        /**
+         * @brief Helper function to read the value(s) of a bin, which are interpolated between the neighboring stored planes
+         * along z if the plane of the bin has been dropped
+         * @param x_ind Bin index along x
+         * @param y_ind Bin index along y
+         * @param z_ind Bin index along z
+         * @return Value(s) of the field in the bin
+         */
+        T get_value(size_t x_ind, size_t y_ind, size_t z_ind) const {
+            if(z_lower_.empty()) {
+                return get_impl(get_index(x_ind, y_ind, z_ind), std::make_index_sequence<N>{});
+            }
+
+            // Look up the stored plane at or below the bin in the coarse index
+            auto lower = z_lower_[z_ind];
+            auto value = get_impl(get_index(x_ind, y_ind, lower), std::make_index_sequence<N>{});
+            if(z_planes_[lower] == z_ind) {
+                return value;
+            }
+            auto weight = static_cast<double>(z_ind - z_planes_[lower]) /
+                          static_cast<double>(z_planes_[lower + 1] - z_planes_[lower]);
+            return value * (1. - weight) +
+                   get_impl(get_index(x_ind, y_ind, lower + 1), std::make_index_sequence<N>{}) * weight;
+        }
+
+        /**
+         * @brief Helper function to calculate the index in the tiled field array from the bin indices
+         * @param x_ind Bin index along x
+         * @param y_ind Bin index along y
+         * @param z_ind Bin index along z
+         * @return Index of the first component of the field in the tiled field array
+         */
+        size_t get_tiled_index(size_t x_ind, size_t y_ind, size_t z_ind) const {
+            auto tile =
+                ((x_ind >> tile_shift_[0]) * tiles_[1] + (y_ind >> tile_shift_[1])) * tiles_[2] + (z_ind >> tile_shift_[2]);
+            auto bin = ((((x_ind & tile_mask_[0]) << tile_shift_[1]) | (y_ind & tile_mask_[1])) << tile_shift_[2]) |
+                       (z_ind & tile_mask_[2]);
+            return ((tile << tile_bits_) | bin) * N;
+        }
+
+        /**
+         * @brief Helper function to reorder a flat field array into tiles, padding incomplete tiles at the edges
+         * @param field Pointer to the first element of the flat field array
+         * @return Pair of the shared pointer to the first element of the tiled array and its number of elements
+         */
+        std::pair<std::shared_ptr<const double>, size_t> set_tiled_layout(const double* field);
+
+        /**
+         * @brief Helper function to drop the planes of a flat field array along z which are reproduced by the interpolation
+         * between the remaining planes within the given tolerance
+         * @param field Pointer to the first element of the flat field array
+         * @param elements Number of elements of the flat field array
+         * @param tolerance Maximum deviation relative to the largest absolute field value
+         * @return Pair of the shared pointer to the first element of the reduced array and its number of elements, or a null
+         *         pointer if all planes are kept
+         */
+        std::pair<std::shared_ptr<const double>, size_t>
+        set_adaptive_planes(const double* field, size_t elements, double tolerance);
+
+        /**
+         * @brief Helper function to convert a distance from the center of the field to a position in units of bins
+         * @param dist Distance from the center of the field along the axis
+         * @param axis Axis of the distance, either 0 for x or 1 for y
+         * @param mirror Set to true if the position was mirrored into the domain covered by the grid of a symmetric field
+         * @return Position along the axis in units of bins
+         */
+        double get_bin_position(double dist, size_t axis, bool& mirror) const;
+
+        /**
+         * @brief Helper function to convert a distance from the center of the field to a position in units of bins, for axes
+         * along which the grid has more than one bin
+         * @param dist Distance from the center of the field along the axis
+         * @param axis Axis of the distance, either 0 for x or 1 for y
+         * @param mirror Set to true if the position was mirrored into the domain covered by the grid of a symmetric field
+         * @return Position along the axis in units of bins
+         */
+        double get_grid_position(double dist, size_t axis, bool& mirror) const {
+            if(mirrored_[axis]) {
+                mirror = (dist < 0);
+                return static_cast<double>(dimensions_[axis]) * 2.0 * std::fabs(dist) / scales_[axis];
+            }
+            return static_cast<double>(dimensions_[axis]) * (dist + scales_[axis] / 2.0) / scales_[axis];
+        }
+
+        /**
+         * @brief Helper function to interpolate the field linearly between the eight surrounding grid points
+         * @tparam X False if the grid has a single bin along x, such that only one neighbor is read along x
+         * @tparam Y False if the grid has a single bin along y, such that only one neighbor is read along y
+         * @param x_pos Position along x in units of bins
+         * @param y_pos Position along y in units of bins
+         * @param z_pos Position along z in units of bins
+         * @return Interpolated value(s) of the field
+         */
+        template <bool X = true, bool Y = true> T get_interpolated(double x_pos, double y_pos, double z_pos) const;
+
         /**
          * @brief Helper function to calculate the field index based on the distance from its center and to return the values
          * @param dist Distance from the center of the field to obtain the values for, given in local coordinates
          * @param extrapolate_z Switch to either extrapolate the field along z when outside the grid or return zero
          * @return Value(s) of the field at the queried point
          */
-        T get_field_from_grid(const ROOT::Math::XYZPoint& dist, const bool extrapolate_z = false) const;
+        T get_field_from_grid(const ROOT::Math::XYZPoint& dist, const bool extrapolate_z = false) const {
+            return (this->*grid_lookup_)(dist.x(), dist.y(), dist.z(), extrapolate_z);
+        }
+
+        /**
+         * @brief Lookup kernel of the grid at a distance from its center, specialised for the axes with more than one bin
+         * @tparam X False if the grid has a single bin along x, such that the distance along x is ignored
+         * @tparam Y False if the grid has a single bin along y, such that the distance along y is ignored
+         * @param dist_x Distance from the center of the field along x
+         * @param dist_y Distance from the center of the field along y
+         * @param dist_z Position along z in local coordinates
+         * @param extrapolate_z Switch to either extrapolate the field along z when outside the grid or return zero
+         * @return Value(s) of the field at the queried point
+         */
+        template <bool X, bool Y> T lookup_grid(double dist_x, double dist_y, double dist_z, bool extrapolate_z) const;
+
+        /**
+         * @brief Kernel of \ref get for field grids, specialised for the axes with more than one bin
+         * @tparam X False if the grid has a single bin along x, such that the position in the replica along x is not needed
+         * @tparam Y False if the grid has a single bin along y, such that the position in the replica along y is not needed
+         * @param pos Position in the local frame
+         * @return Value(s) of the field at the queried point
+         */
+        template <bool X, bool Y> T get_grid(const ROOT::Math::XYZPoint& pos) const;
+
+        /**
+         * @brief Helper function to select the kernels matching the dimensions of the grid
+         */
+        void set_grid_kernels();
+
+        /**
+         * @brief Helper function to convert the field values to the requested reduced storage precision
+         * @param field Pointer to the first element of the flat field array
+         * @param elements Number of elements of the flat field array
+         * @param precision Precision to store the field values with
+         */
+        void set_reduced_precision(const double* field, size_t elements, FieldPrecision precision);
 
         /**
          * Field properties
          * * Dimensions of the field map (bins in x, y, z)
          * * Scale of the field in x and y direction, defaults to 1, 1, i.e. to one full pixel cell
          * * Offset of the field from the pixel edge, e.g. when using fields centered at a pixel corner instead of the center
+         * * Axes along which the grid only covers the positive half of the field and is mirrored at the field center
          */
         std::array<size_t, 3> dimensions_{};
         std::array<double_t, 2> scales_{{1., 1.}};
         std::array<double_t, 2> offset_{{0., 0.}};
+        std::array<bool, 2> mirrored_{{false, false}};
+
+        /**
+         * Adaptive resolution along z
+         * * Dimensions of the stored grid, which only differ from the field dimensions along z if planes have been dropped
+         * * Bin index along z of every stored plane, empty if all planes are stored
+         * * Coarse index holding the stored plane at or below every bin along z, such that lookups remain constant in time
+         */
+        std::array<size_t, 3> grid_dimensions_{};
+        std::vector<size_t> z_planes_;
+        std::vector<size_t> z_lower_;
+
+        /**
+         * Lookup kernels of the grid, selected when the grid is set depending on the axes with more than one bin, such that
+         * the common fields depending only on z, or on x and z, skip the computations along the other axes
+         */
+        T (DetectorField::*grid_get_)(const ROOT::Math::XYZPoint&) const = nullptr;
+        T (DetectorField::*grid_lookup_)(double, double, double, bool) const = nullptr;
+
+        /**
+         * Tiling of the grid
+         * * Number of tiles along x, y and z, where axes with a single bin use tiles of one bin
+         * * Logarithm of the tile size along each axis, the mask of the bin index within the tile and the sum of logarithms
+         */
+        FieldLayout layout_{FieldLayout::FLAT};
+        std::array<size_t, 3> tiles_{};
+        std::array<size_t, 3> tile_shift_{};
+        std::array<size_t, 3> tile_mask_{};
+        size_t tile_bits_{};
 
         /**
          * Field definition
@@ -165,17 +586,35 @@ namespace allpix {
          * returning the value at each position given in local coordinates. The field is valid within the thickness domain
          * specified, the configured type is stored to allow additional checks in the modules requesting the field.
          *
-         * In case of using a field grid, the field is stored as a large flat array. If the sizes are denoted as X_SIZE, Y_
-         * SIZE and Z_SIZE, respectively, and each position (x, y, z) has N indices, the element position of the i-th field
-         * component in the flat field vector can be calculated as:
+         * In case of using a field grid, the field is stored as a large flat array, which is either owned by a vector or by
+         * external memory such as a memory-mapped file. If the sizes are denoted as X_SIZE, Y_SIZE and Z_SIZE, respectively,
+         * and each position (x, y, z) has N indices, the element position of the i-th field component in the flat field
+         * vector can be calculated as:
          *
          *   field_i(x, y, z) =  x * Y_SIZE* Z_SIZE * N + y * Z_SIZE * + z * N + i
+         *
+         * The elements are stored with the configured precision and widened to double when read. Quantised grids store
+         * integers which are multiplied with a common scale factor.
          */
-        std::shared_ptr<std::vector<double>> field_;
+        std::shared_ptr<const void> field_;
+        size_t field_bytes_{};
+        std::shared_ptr<FieldReplicas> replicas_;
+        bool huge_pages_{};
+        FieldPrecision precision_{FieldPrecision::DOUBLE};
+        double quantisation_scale_{1.};
         std::pair<double, double> thickness_domain_{};
         FieldType type_{FieldType::NONE};
+        FieldInterpolation interpolation_{FieldInterpolation::NEAREST};
         FieldFunction<T> function_;
 
+        /*
+         * Closed form of linear and constant fields, evaluated instead of the field function if set
+         */
+        bool closed_form_{};
+        T closed_form_direction_{};
+        double closed_form_offset_{};
+        double closed_form_slope_{};
+
         /*
          * Relevant parameters from the detector model for this field
          */
@@ -184,6 +623,61 @@ namespace allpix {
         ROOT::Math::XYZVector sensor_size_{};
         bool model_initialized_{};
     };
+
+    /**
+     * @brief Accessor of a detector field for the consecutive lookups along the path of a single charge carrier
+     *
+     * Consecutive positions on the path of a charge carrier are mostly located in the same bin of a field grid. The cursor
+     * keeps the grid values of the last bin, the value of the bin itself for the nearest-neighbor lookup and the values of
+     * the eight surrounding grid points for the linear interpolation, such that these are only read again from the grid
+     * when the position moves to another bin. The returned values are identical to the ones of \ref DetectorField::get.
+     * Fields defined by a function are evaluated directly. A cursor should only be used by a single thread, and the field
+     * should not be changed while the cursor is in use.
+     */
+    template <typename T, size_t N = 3> class DetectorFieldCursor {
+    public:
+        /**
+         * @brief Construct a cursor for the given field
+         * @param field Field to look up the values in, should outlive the cursor
+         */
+        explicit DetectorFieldCursor(const DetectorField<T, N>* field) : field_(field) {}
+
+        /**
+         * @brief Get the field value in the sensor at a position provided in local coordinates
+         * @param local_pos Position in the local frame, of any type with the accessors x(), y() and z() such as
+         *                  ROOT::Math::XYZPoint or Eigen::Vector3d
+         * @return Value(s) of the field at the queried point
+         */
+        template <typename Point> T get(const Point& local_pos) {
+            return get(local_pos.x(), local_pos.y(), local_pos.z());
+        }
+
+        /**
+         * @brief Get the field value in the sensor at a position provided by its local coordinates
+         * @param x Coordinate along x in the local frame
+         * @param y Coordinate along y in the local frame
+         * @param z Coordinate along z in the local frame
+         * @return Value(s) of the field at the queried point
+         */
+        T get(double x, double y, double z);
+
+    private:
+        /**
+         * @brief Helper function to look up the value in the grid, reusing the values of the last bin if possible
+         * @param x Distance from the center of the field along x
+         * @param y Distance from the center of the field along y
+         * @param z Position along z in local coordinates
+         * @return Value(s) of the field at the queried point
+         */
+        T get_from_grid(double x, double y, double z);
+
+        const DetectorField<T, N>* field_;
+
+        // Indices of the last bin, or of the lower surrounding grid points for the interpolation, and their grid values
+        std::array<int, 3> cached_bin_{};
+        bool cache_valid_{};
+        std::array<T, 8> cached_values_{};
+    };
 } // namespace allpix
 
 // Include template members
@@ -39,50 +39,235 @@ namespace allpix {
                 return {};
             }
 
-            // Calculate the field from the configured function:
-            ret_val = function_(ROOT::Math::XYZPoint(x, y, z));
+            // Calculate the field from the closed form or the configured function:
+            ret_val = closed_form_ ? get_closed_form(z) : function_(ROOT::Math::XYZPoint(x, y, z));
         }
 
         return ret_val;
     }
 
+    /**
+     * The values for all references of the matrix are calculated in a single pass, such that the position along z is only
+     * converted once and the positions along x only once per column of the matrix. The result is identical to calling
+     * getRelativeTo for every reference separately.
+     */
+    template <typename T, size_t N>
+    void DetectorField<T, N>::getRelativeTo(const ROOT::Math::XYZPoint& pos,
+                                            const ROOT::Math::XYPoint& ref,
+                                            const ROOT::Math::XYVector& pitch,
+                                            size_t size_x,
+                                            size_t size_y,
+                                            std::vector<T>& values,
+                                            const bool extrapolate_z) const {
+        values.assign(size_x * size_y, T{});
+        if(type_ == FieldType::NONE) {
+            return;
+        }
+
+        if(type_ != FieldType::GRID) {
+            // Check if we need to extrapolate along the z axis or if is inside thickness domain:
+            auto z = pos.z();
+            if(extrapolate_z) {
+                z = std::max(thickness_domain_.first, std::min(z, thickness_domain_.second));
+            } else if(z < thickness_domain_.first || thickness_domain_.second < z) {
+                return;
+            }
+
+            // The closed form does not depend on the reference:
+            if(closed_form_) {
+                values.assign(size_x * size_y, get_closed_form(z));
+                return;
+            }
+
+            // Calculate the field from the configured function for every reference:
+            for(size_t i = 0; i < size_x; ++i) {
+                auto x = pos.x() - ref.x() - static_cast<double>(i) * pitch.x();
+                for(size_t j = 0; j < size_y; ++j) {
+                    auto y = pos.y() - ref.y() - static_cast<double>(j) * pitch.y();
+                    values[i * size_y + j] = function_(ROOT::Math::XYZPoint(x, y, z));
+                }
+            }
+            return;
+        }
+
+        // Compute the position along z in units of bins, which is shared by all references
+        auto z_pos = static_cast<double>(dimensions_[2]) * (pos.z() - thickness_domain_.first) /
+                     (thickness_domain_.second - thickness_domain_.first);
+        auto z_ind = static_cast<int>(std::floor(z_pos));
+        if(extrapolate_z) {
+            z_ind = std::max(0, std::min(z_ind, static_cast<int>(dimensions_[2]) - 1));
+            z_pos = std::max(0., std::min(z_pos, static_cast<double>(dimensions_[2])));
+        } else if(z_ind < 0 || z_ind >= static_cast<int>(dimensions_[2])) {
+            return;
+        }
+
+        for(size_t i = 0; i < size_x; ++i) {
+            // Compute the position along x in units of bins
+            bool mirror_x = false;
+            auto x_pos = get_bin_position(pos.x() - ref.x() - static_cast<double>(i) * pitch.x(), 0, mirror_x);
+            auto x_ind = static_cast<int>(std::floor(x_pos));
+            if(x_ind < 0 || x_ind >= static_cast<int>(dimensions_[0])) {
+                continue;
+            }
+
+            for(size_t j = 0; j < size_y; ++j) {
+                bool mirror_y = false;
+                auto y_pos = get_bin_position(pos.y() - ref.y() - static_cast<double>(j) * pitch.y(), 1, mirror_y);
+                auto y_ind = static_cast<int>(std::floor(y_pos));
+                if(y_ind < 0 || y_ind >= static_cast<int>(dimensions_[1])) {
+                    continue;
+                }
+
+                auto& value = values[i * size_y + j];
+                if(interpolation_ == FieldInterpolation::LINEAR) {
+                    value = get_interpolated(x_pos, y_pos, z_pos);
+                } else {
+                    value = get_value(static_cast<size_t>(x_ind), static_cast<size_t>(y_ind), static_cast<size_t>(z_ind));
+                }
+                flip_vector_components(value, mirror_x, mirror_y);
+            }
+        }
+    }
+
     // Maps the field indices onto the range of -d/2 < x < d/2, where d is the scale of the field in coordinate x.
     // This means, {x,y,z} = (0,0,0) is in the center of the field.
     template <typename T, size_t N>
-    T DetectorField<T, N>::get_field_from_grid(const ROOT::Math::XYZPoint& dist, const bool extrapolate_z) const {
-        // Compute indices
-        // If the number of bins in x or y is 1, the field is assumed to be 2-dimensional and the respective index
-        // is forced to zero. This circumvents that the field size in the respective dimension would otherwise be zero
-        // clang-format off
-        auto x_ind = (dimensions_[0] == 1 ? 0
-                                          : static_cast<int>(std::floor(static_cast<double>(dimensions_[0]) *
-                                                                        (dist.x() + scales_[0] / 2.0) / scales_[0])));
-        auto y_ind = (dimensions_[1] == 1 ? 0
-                                          : static_cast<int>(std::floor(static_cast<double>(dimensions_[1]) *
-                                                                        (dist.y() + scales_[1] / 2.0) / scales_[1])));
-        auto z_ind = static_cast<int>(std::floor(static_cast<double>(dimensions_[2]) * (dist.z() - thickness_domain_.first) /
-                                                 (thickness_domain_.second - thickness_domain_.first)));
-        // clang-format on
-
-        // Check for indices within the field map
-        if(x_ind < 0 || x_ind >= static_cast<int>(dimensions_[0]) || y_ind < 0 ||
-           y_ind >= static_cast<int>(dimensions_[1])) {
-            return {};
+    template <bool X, bool Y>
+    T DetectorField<T, N>::lookup_grid(double dist_x, double dist_y, double dist_z, bool extrapolate_z) const {
+        // Compute the position in units of bins and the indices, checking for indices within the field map. Along axes with
+        // a single bin, the position is fixed to zero
+        bool mirror_x = false;
+        bool mirror_y = false;
+        double x_pos = 0;
+        double y_pos = 0;
+        int x_ind = 0;
+        int y_ind = 0;
+        if(X) {
+            x_pos = get_grid_position(dist_x, 0, mirror_x);
+            x_ind = static_cast<int>(std::floor(x_pos));
+            if(x_ind < 0 || x_ind >= static_cast<int>(dimensions_[0])) {
+                return {};
+            }
         }
+        if(Y) {
+            y_pos = get_grid_position(dist_y, 1, mirror_y);
+            y_ind = static_cast<int>(std::floor(y_pos));
+            if(y_ind < 0 || y_ind >= static_cast<int>(dimensions_[1])) {
+                return {};
+            }
+        }
+        auto z_pos = static_cast<double>(dimensions_[2]) * (dist_z - thickness_domain_.first) /
+                     (thickness_domain_.second - thickness_domain_.first);
+        auto z_ind = static_cast<int>(std::floor(z_pos));
 
         // Check if we need to extrapolate along the z axis:
         if(extrapolate_z) {
             // TODO When moving to C++17, this can be replaced with std::clamp()
             z_ind = std::max(0, std::min(z_ind, static_cast<int>(dimensions_[2]) - 1));
+            z_pos = std::max(0., std::min(z_pos, static_cast<double>(dimensions_[2])));
         } else if(z_ind < 0 || z_ind >= static_cast<int>(dimensions_[2])) {
             return {};
         }
 
-        // Compute total index
-        size_t tot_ind = static_cast<size_t>(x_ind) * dimensions_[1] * dimensions_[2] * N +
-                         static_cast<size_t>(y_ind) * dimensions_[2] * N + static_cast<size_t>(z_ind) * N;
+        T ret_val;
+        if(interpolation_ == FieldInterpolation::LINEAR) {
+            ret_val = get_interpolated<X, Y>(x_pos, y_pos, z_pos);
+        } else {
+            ret_val = get_value(static_cast<size_t>(x_ind), static_cast<size_t>(y_ind), static_cast<size_t>(z_ind));
+        }
+
+        // Flip the vector components if the position was mirrored into the domain of a symmetric grid
+        if(mirror_x || mirror_y) {
+            flip_vector_components(ret_val, mirror_x, mirror_y);
+        }
+        return ret_val;
+    }
 
-        return get_impl(tot_ind, std::make_index_sequence<N>{});
+    /**
+     * Grids with a single bin along x or y are fields depending only on z, or only on x and z or y and z. The kernels of
+     * these grids skip all computations along the axes with a single bin.
+     */
+    template <typename T, size_t N> void DetectorField<T, N>::set_grid_kernels() {
+        auto grid_x = (dimensions_[0] > 1);
+        auto grid_y = (dimensions_[1] > 1);
+        if(grid_x && grid_y) {
+            grid_get_ = &DetectorField::get_grid<true, true>;
+            grid_lookup_ = &DetectorField::lookup_grid<true, true>;
+        } else if(grid_x) {
+            grid_get_ = &DetectorField::get_grid<true, false>;
+            grid_lookup_ = &DetectorField::lookup_grid<true, false>;
+        } else if(grid_y) {
+            grid_get_ = &DetectorField::get_grid<false, true>;
+            grid_lookup_ = &DetectorField::lookup_grid<false, true>;
+        } else {
+            grid_get_ = &DetectorField::get_grid<false, false>;
+            grid_lookup_ = &DetectorField::lookup_grid<false, false>;
+        }
+    }
+
+    /**
+     * If the number of bins along the axis is 1, the field is assumed to be 2-dimensional and the position is forced to
+     * zero. This circumvents that the field size in the respective dimension would otherwise be zero. For grids mirrored
+     * along the axis, the grid spans from the field center to its positive edge and negative distances are mirrored.
+     */
+    template <typename T, size_t N>
+    double DetectorField<T, N>::get_bin_position(double dist, size_t axis, bool& mirror) const {
+        mirror = false;
+        if(dimensions_[axis] == 1) {
+            return 0.;
+        }
+        return get_grid_position(dist, axis, mirror);
+    }
+
+    /**
+     * The field values are assumed to be located at the centers of the bins. Between the outermost bin centers and the edges
+     * of the field, the value of the outermost bin is used. For 2-dimensional fields, the single bin along the missing
+     * dimension is the only neighbor and has the full weight. At the mirror plane of a symmetric grid, the lower neighbor is
+     * the mirror image of the first bin, such that the interpolation is identical to the one of the full grid. The kernels
+     * for axes with a single bin only read one neighbor along these axes, which yields the same sum as the general kernel.
+     */
+    template <typename T, size_t N>
+    template <bool X, bool Y>
+    T DetectorField<T, N>::get_interpolated(double x_pos, double y_pos, double z_pos) const {
+        // Find the two neighboring bins along every axis, the weight of the upper one and if the lower one is mirrored
+        auto neighbors = [](double pos, size_t bins, bool mirrored) {
+            if(bins == 1) {
+                return std::make_tuple(std::array<size_t, 2>{{0, 0}}, 0., false);
+            }
+            auto center = pos - 0.5;
+            auto lower = std::floor(center);
+            auto weight = center - lower;
+            auto max_ind = static_cast<double>(bins) - 1;
+            std::array<size_t, 2> indices{{static_cast<size_t>(std::max(0., std::min(lower, max_ind))),
+                                           static_cast<size_t>(std::max(0., std::min(lower + 1, max_ind)))}};
+            return std::make_tuple(indices, weight, mirrored && lower < 0);
+        };
+        auto x_nb = (X ? neighbors(x_pos, dimensions_[0], mirrored_[0]) : neighbors(0., 1, false));
+        auto y_nb = (Y ? neighbors(y_pos, dimensions_[1], mirrored_[1]) : neighbors(0., 1, false));
+        auto z_nb = neighbors(z_pos, dimensions_[2], false);
+
+        // Sum the values of the up to eight surrounding grid points weighted by their distance
+        T ret_val{};
+        for(size_t i = 0; i < (X ? 2 : 1); ++i) {
+            auto x_weight = (i == 0 ? 1. - std::get<1>(x_nb) : std::get<1>(x_nb));
+            auto x_mirror = (i == 0 && std::get<2>(x_nb));
+            for(size_t j = 0; j < (Y ? 2 : 1); ++j) {
+                auto y_weight = (j == 0 ? 1. - std::get<1>(y_nb) : std::get<1>(y_nb));
+                auto y_mirror = (j == 0 && std::get<2>(y_nb));
+                for(size_t k = 0; k < 2; ++k) {
+                    auto weight = x_weight * y_weight * (k == 0 ? 1. - std::get<1>(z_nb) : std::get<1>(z_nb));
+                    if(weight == 0) {
+                        continue;
+                    }
+                    auto value = get_value(std::get<0>(x_nb)[i], std::get<0>(y_nb)[j], std::get<0>(z_nb)[k]);
+                    if(x_mirror || y_mirror) {
+                        flip_vector_components(value, x_mirror, y_mirror);
+                    }
+                    ret_val += value * weight;
+                }
+            }
+        }
+        return ret_val;
     }
 
     /**
@@ -94,6 +279,16 @@ namespace allpix {
         if(type_ == FieldType::NONE) {
             return {};
         }
+        if(type_ == FieldType::GRID) {
+            return (this->*grid_get_)(pos);
+        }
+        if(closed_form_) {
+            // Linear and constant fields only depend on z and are symmetric under the flipping at the replica boundaries
+            if(pos.z() < thickness_domain_.first || thickness_domain_.second < pos.z()) {
+                return {};
+            }
+            return get_closed_form(pos.z());
+        }
 
         // Shift the coordinates by the offset configured for the field:
         auto x = pos.x() + offset_[0];
@@ -117,25 +312,195 @@ namespace allpix {
             y *= -1;
         }
 
-        // Compute using the grid or a function depending on the setting
-        T ret_val;
-        if(type_ == FieldType::GRID) {
-            ret_val = get_field_from_grid(ROOT::Math::XYZPoint(x, y, z));
-        } else {
-            // Check if inside the thickness domain
-            if(z < thickness_domain_.first || thickness_domain_.second < z) {
-                return {};
-            }
+        // Check if inside the thickness domain
+        if(z < thickness_domain_.first || thickness_domain_.second < z) {
+            return {};
+        }
+
+        // Calculate the field from the configured function:
+        auto ret_val = function_(ROOT::Math::XYZPoint(x, y, z));
 
-            // Calculate the field from the configured function:
-            ret_val = function_(ROOT::Math::XYZPoint(x, y, z));
+        // Flip vector if necessary
+        flip_vector_components(ret_val, replica_x % 2, replica_y % 2);
+        return ret_val;
+    }
+
+    /**
+     * The conversion to the replica frame is identical to the one of \ref DetectorField::get for functions. Along axes with
+     * a single bin, the position in the replica frame is not used by the lookup, only the parity of the replica is required
+     * to flip the vector components of vector fields. Scalar fields skip the replica computation along these axes entirely.
+     */
+    template <typename T, size_t N>
+    template <bool X, bool Y>
+    T DetectorField<T, N>::get_grid(const ROOT::Math::XYZPoint& pos) const {
+        constexpr bool vector_field = (N > 1);
+
+        // Shift the coordinates by the offset configured for the field and convert to the replica frame:
+        // WARNING This relies on the origin of the local coordinate system
+        int replica_x = 0;
+        int replica_y = 0;
+        double x = 0;
+        double y = 0;
+        if(X || vector_field) {
+            x = pos.x() + offset_[0];
+            replica_x = static_cast<int>(std::floor((x + 0.5 * pixel_size_.x()) / scales_[0]));
+            if(X) {
+                x -= (replica_x + 0.5) * scales_[0] - 0.5 * pixel_size_.x();
+                if((replica_x % 2) == 1) {
+                    x *= -1;
+                }
+            }
+        }
+        if(Y || vector_field) {
+            y = pos.y() + offset_[1];
+            replica_y = static_cast<int>(std::floor((y + 0.5 * pixel_size_.y()) / scales_[1]));
+            if(Y) {
+                y -= (replica_y + 0.5) * scales_[1] - 0.5 * pixel_size_.y();
+                if((replica_y % 2) == 1) {
+                    y *= -1;
+                }
+            }
         }
 
+        auto ret_val = lookup_grid<X, Y>(x, y, pos.z(), false);
+
         // Flip vector if necessary
+        if(vector_field) {
+            flip_vector_components(ret_val, replica_x % 2, replica_y % 2);
+        }
+        return ret_val;
+    }
+
+    /**
+     * The conversion to the replica frame is identical to the one of \ref DetectorField::get, only the lookup in the grid
+     * reuses the values of the last bin. The coordinates are passed on by value, such that no point object is constructed
+     * for the lookup in the grid.
+     */
+    template <typename T, size_t N> T DetectorFieldCursor<T, N>::get(double x, double y, double z) {
+        if(field_->type_ != FieldType::GRID) {
+            return field_->get(ROOT::Math::XYZPoint(x, y, z));
+        }
+
+        // Shift the coordinates by the offset configured for the field:
+        x += field_->offset_[0];
+        y += field_->offset_[1];
+
+        // Compute corresponding field replica coordinates and convert to the replica frame:
+        const auto& pixel_size = field_->pixel_size_;
+        const auto& scales = field_->scales_;
+        auto replica_x = static_cast<int>(std::floor((x + 0.5 * pixel_size.x()) / scales[0]));
+        auto replica_y = static_cast<int>(std::floor((y + 0.5 * pixel_size.y()) / scales[1]));
+        x -= (replica_x + 0.5) * scales[0] - 0.5 * pixel_size.x();
+        y -= (replica_y + 0.5) * scales[1] - 0.5 * pixel_size.y();
+
+        // Do flipping if necessary
+        if((replica_x % 2) == 1) {
+            x *= -1;
+        }
+        if((replica_y % 2) == 1) {
+            y *= -1;
+        }
+
+        auto ret_val = get_from_grid(x, y, z);
         flip_vector_components(ret_val, replica_x % 2, replica_y % 2);
         return ret_val;
     }
 
+    /**
+     * The bin positions, weights and the order of the summation are the same as for the lookup in the field itself, such
+     * that the values are bit-identical. The grid points of the interpolation are cached with the mirroring of the lower
+     * neighbors already applied, as it only depends on the bin indices.
+     */
+    template <typename T, size_t N> T DetectorFieldCursor<T, N>::get_from_grid(double x, double y, double z) {
+        const auto& dimensions = field_->dimensions_;
+        const auto& thickness_domain = field_->thickness_domain_;
+
+        // Compute the position in units of bins
+        bool mirror_x = false;
+        bool mirror_y = false;
+        auto x_pos = field_->get_bin_position(x, 0, mirror_x);
+        auto y_pos = field_->get_bin_position(y, 1, mirror_y);
+        auto z_pos = static_cast<double>(dimensions[2]) * (z - thickness_domain.first) /
+                     (thickness_domain.second - thickness_domain.first);
+
+        // Compute indices and check if they are within the field map
+        auto x_ind = static_cast<int>(std::floor(x_pos));
+        auto y_ind = static_cast<int>(std::floor(y_pos));
+        auto z_ind = static_cast<int>(std::floor(z_pos));
+        if(x_ind < 0 || x_ind >= static_cast<int>(dimensions[0]) || y_ind < 0 || y_ind >= static_cast<int>(dimensions[1]) ||
+           z_ind < 0 || z_ind >= static_cast<int>(dimensions[2])) {
+            return {};
+        }
+
+        T ret_val{};
+        if(field_->interpolation_ == FieldInterpolation::LINEAR) {
+            // Lower neighboring grid points and the weights of the upper ones
+            std::array<double, 3> centers{{x_pos - 0.5, y_pos - 0.5, z_pos - 0.5}};
+            std::array<double, 3> lower{{std::floor(centers[0]), std::floor(centers[1]), std::floor(centers[2])}};
+            std::array<int, 3> bin{
+                {static_cast<int>(lower[0]), static_cast<int>(lower[1]), static_cast<int>(lower[2])}};
+
+            // Read the eight surrounding grid points if the position moved to another bin
+            if(!cache_valid_ || bin != cached_bin_) {
+                std::array<std::array<size_t, 2>, 3> indices{};
+                for(size_t axis = 0; axis < 3; ++axis) {
+                    auto max_ind = static_cast<double>(dimensions[axis]) - 1;
+                    indices[axis] = {{static_cast<size_t>(std::max(0., std::min(lower[axis], max_ind))),
+                                      static_cast<size_t>(std::max(0., std::min(lower[axis] + 1, max_ind)))}};
+                }
+                auto lower_mirror_x = field_->mirrored_[0] && dimensions[0] > 1 && lower[0] < 0;
+                auto lower_mirror_y = field_->mirrored_[1] && dimensions[1] > 1 && lower[1] < 0;
+                for(size_t i = 0; i < 2; ++i) {
+                    for(size_t j = 0; j < 2; ++j) {
+                        for(size_t k = 0; k < 2; ++k) {
+                            auto& value = cached_values_[i * 4 + j * 2 + k];
+                            value = field_->get_value(indices[0][i], indices[1][j], indices[2][k]);
+                            if((i == 0 && lower_mirror_x) || (j == 0 && lower_mirror_y)) {
+                                flip_vector_components(value, i == 0 && lower_mirror_x, j == 0 && lower_mirror_y);
+                            }
+                        }
+                    }
+                }
+                cached_bin_ = bin;
+                cache_valid_ = true;
+            }
+
+            // Sum the values of the eight surrounding grid points weighted by their distance, where the single bin along an
+            // axis without grid dimension has the full weight
+            std::array<double, 3> weights{};
+            for(size_t axis = 0; axis < 3; ++axis) {
+                weights[axis] = (dimensions[axis] > 1 ? centers[axis] - lower[axis] : 0.);
+            }
+            for(size_t i = 0; i < 2; ++i) {
+                auto x_weight = (i == 0 ? 1. - weights[0] : weights[0]);
+                for(size_t j = 0; j < 2; ++j) {
+                    auto y_weight = (j == 0 ? 1. - weights[1] : weights[1]);
+                    for(size_t k = 0; k < 2; ++k) {
+                        auto weight = x_weight * y_weight * (k == 0 ? 1. - weights[2] : weights[2]);
+                        if(weight == 0) {
+                            continue;
+                        }
+                        ret_val += cached_values_[i * 4 + j * 2 + k] * weight;
+                    }
+                }
+            }
+        } else {
+            // Read the value of the bin if the position moved to another bin
+            std::array<int, 3> bin{{x_ind, y_ind, z_ind}};
+            if(!cache_valid_ || bin != cached_bin_) {
+                cached_values_[0] =
+                    field_->get_value(static_cast<size_t>(x_ind), static_cast<size_t>(y_ind), static_cast<size_t>(z_ind));
+                cached_bin_ = bin;
+                cache_valid_ = true;
+            }
+            ret_val = cached_values_[0];
+        }
+
+        // Flip the vector components if the position was mirrored into the domain of a symmetric grid
+        flip_vector_components(ret_val, mirror_x, mirror_y);
+        return ret_val;
+    }
+
     /**
      * Woohoo, template magic! Using an index_sequence to construct the templated return type with a variable number of
      * elements from the flat field vector, e.g. 3 for a vector field and 1 for a scalar field. Using a braced-init-list
@@ -144,7 +509,15 @@ namespace allpix {
     template <typename T, size_t N>
     template <std::size_t... I>
     auto DetectorField<T, N>::get_impl(size_t offset, std::index_sequence<I...>) const {
-        return T{(*field_)[offset + I]...};
+        if(precision_ == FieldPrecision::FLOAT) {
+            const auto* data = static_cast<const float*>(get_field_data());
+            return T{static_cast<double>(data[offset + I])...};
+        } else if(precision_ == FieldPrecision::INT16) {
+            const auto* data = static_cast<const int16_t*>(get_field_data());
+            return T{quantisation_scale_ * data[offset + I]...};
+        }
+        const auto* data = static_cast<const double*>(get_field_data());
+        return T{data[offset + I]...};
     }
 
     /**
@@ -153,18 +526,57 @@ namespace allpix {
     template <typename T, size_t N> FieldType DetectorField<T, N>::getType() const { return type_; }
 
     /**
-     * @throws std::invalid_argument If the field dimensions are incorrect or the thickness domain is outside the sensor
+     * The field vector is kept alive by the aliasing shared pointer to its first element.
      */
     template <typename T, size_t N>
     void DetectorField<T, N>::setGrid(std::shared_ptr<std::vector<double>> field, // NOLINT
                                       std::array<size_t, 3> dimensions,
                                       std::array<double, 2> scales,
                                       std::array<double, 2> offset,
-                                      std::pair<double, double> thickness_domain) {
+                                      std::pair<double, double> thickness_domain,
+                                      FieldInterpolation interpolation,
+                                      FieldPrecision precision,
+                                      FieldSymmetry symmetry,
+                                      FieldLayout layout,
+                                      double z_tolerance) {
+        auto elements = field->size();
+        std::shared_ptr<const double> data(field, field->data());
+        setGrid(std::move(data),
+                elements,
+                dimensions,
+                scales,
+                offset,
+                std::move(thickness_domain),
+                interpolation,
+                precision,
+                symmetry,
+                layout,
+                z_tolerance);
+    }
+
+    /**
+     * Planes along z are dropped first on the flat array of double precision values, such that the tolerance holds
+     * independently of the configured precision. The remaining planes are then reordered into tiles and converted to the
+     * storage precision.
+     *
+     * @throws std::invalid_argument If the field dimensions are incorrect or the thickness domain is outside the sensor
+     */
+    template <typename T, size_t N>
+    void DetectorField<T, N>::setGrid(std::shared_ptr<const double> field, // NOLINT
+                                      size_t elements,
+                                      std::array<size_t, 3> dimensions,
+                                      std::array<double, 2> scales,
+                                      std::array<double, 2> offset,
+                                      std::pair<double, double> thickness_domain,
+                                      FieldInterpolation interpolation,
+                                      FieldPrecision precision,
+                                      FieldSymmetry symmetry,
+                                      FieldLayout layout,
+                                      double z_tolerance) {
         if(!model_initialized_) {
             throw std::invalid_argument("field not initialized with detector model parameters");
         }
-        if(dimensions[0] * dimensions[1] * dimensions[2] * N != field->size()) {
+        if(dimensions[0] * dimensions[1] * dimensions[2] * N != elements) {
             throw std::invalid_argument("field does not match the given dimensions");
         }
         if(thickness_domain.first + 1e-9 < sensor_center_.z() - sensor_size_.z() / 2.0 ||
@@ -174,21 +586,244 @@ namespace allpix {
         if(thickness_domain.first >= thickness_domain.second) {
             throw std::invalid_argument("end of thickness domain is before begin");
         }
+        if(z_tolerance < 0) {
+            throw std::invalid_argument("tolerance for dropping planes along z cannot be negative");
+        }
 
-        field_ = std::move(field);
         dimensions_ = dimensions;
         scales_ = scales;
         offset_ = offset;
+        mirrored_ = {{symmetry == FieldSymmetry::HALF_X || symmetry == FieldSymmetry::QUARTER,
+                      symmetry == FieldSymmetry::HALF_Y || symmetry == FieldSymmetry::QUARTER}};
+
+        grid_dimensions_ = dimensions;
+        z_planes_.clear();
+        z_lower_.clear();
+        if(z_tolerance > 0) {
+            auto adaptive = set_adaptive_planes(field.get(), elements, z_tolerance);
+            if(adaptive.first != nullptr) {
+                std::tie(field, elements) = adaptive;
+            }
+        }
+
+        layout_ = FieldLayout::FLAT;
+        if(layout == FieldLayout::TILED) {
+            std::tie(field, elements) = set_tiled_layout(field.get());
+        }
+
+        if(precision == FieldPrecision::DOUBLE) {
+            field_ = std::move(field);
+            precision_ = precision;
+            quantisation_scale_ = 1.;
+        } else {
+            set_reduced_precision(field.get(), elements, precision);
+        }
+        field_bytes_ = elements * (precision_ == FieldPrecision::FLOAT   ? sizeof(float)
+                                   : precision_ == FieldPrecision::INT16 ? sizeof(int16_t)
+                                                                         : sizeof(double));
+        replicas_ = nullptr;
 
         thickness_domain_ = std::move(thickness_domain);
+        interpolation_ = interpolation;
+        set_grid_kernels();
+        closed_form_ = false;
         type_ = FieldType::GRID;
     }
 
+    /**
+     * Tiles span four bins along every axis with more than one bin. The bins of incomplete tiles at the upper edges of the
+     * grid are padded with zeros, which are never accessed.
+     */
+    template <typename T, size_t N>
+    std::pair<std::shared_ptr<const double>, size_t> DetectorField<T, N>::set_tiled_layout(const double* field) {
+        tile_bits_ = 0;
+        size_t tiled_bins = 1;
+        for(size_t axis = 0; axis < 3; ++axis) {
+            tile_shift_[axis] = (grid_dimensions_[axis] > 1 ? 2 : 0);
+            tile_mask_[axis] = (size_t(1) << tile_shift_[axis]) - 1;
+            tiles_[axis] = (grid_dimensions_[axis] + tile_mask_[axis]) >> tile_shift_[axis];
+            tile_bits_ += tile_shift_[axis];
+            tiled_bins *= tiles_[axis] << tile_shift_[axis];
+        }
+
+        auto data = std::make_shared<std::vector<double>>(tiled_bins * N);
+        for(size_t x = 0; x < grid_dimensions_[0]; ++x) {
+            for(size_t y = 0; y < grid_dimensions_[1]; ++y) {
+                for(size_t z = 0; z < grid_dimensions_[2]; ++z) {
+                    auto flat_index = ((x * grid_dimensions_[1] + y) * grid_dimensions_[2] + z) * N;
+                    std::copy(field + flat_index, field + flat_index + N, data->data() + get_tiled_index(x, y, z));
+                }
+            }
+        }
+        layout_ = FieldLayout::TILED;
+
+        auto elements = data->size();
+        return std::make_pair(std::shared_ptr<const double>(data, data->data()), elements);
+    }
+
+    /**
+     * The planes are selected greedily from the lower end of the grid: starting from the last stored plane, the distance to
+     * the next stored plane is doubled as long as all planes in between are reproduced by the linear interpolation, and the
+     * largest valid distance is then found by bisection. Since the interpolation along z is linear between the planes, the
+     * deviation within the dropped planes is bounded by the one at their bin centers. The first and the last plane are
+     * always stored.
+     */
+    template <typename T, size_t N>
+    std::pair<std::shared_ptr<const double>, size_t>
+    DetectorField<T, N>::set_adaptive_planes(const double* field, size_t elements, double tolerance) {
+        auto planes = dimensions_[2];
+        auto columns = dimensions_[0] * dimensions_[1];
+        if(planes < 3) {
+            return {};
+        }
+
+        double max_value = 0.;
+        for(size_t i = 0; i < elements; ++i) {
+            max_value = std::max(max_value, std::fabs(field[i]));
+        }
+        auto max_deviation = tolerance * max_value;
+
+        // Check if all planes between two planes are reproduced by the interpolation between them
+        auto reproduced = [&](size_t first, size_t last) {
+            for(size_t column = 0; column < columns; ++column) {
+                const double* values = field + column * planes * N;
+                for(size_t z = first + 1; z < last; ++z) {
+                    auto weight = static_cast<double>(z - first) / static_cast<double>(last - first);
+                    for(size_t i = 0; i < N; ++i) {
+                        auto interpolated = values[first * N + i] * (1. - weight) + values[last * N + i] * weight;
+                        if(std::fabs(values[z * N + i] - interpolated) > max_deviation) {
+                            return false;
+                        }
+                    }
+                }
+            }
+            return true;
+        };
+
+        std::vector<size_t> stored{0};
+        while(stored.back() < planes - 1) {
+            auto first = stored.back();
+            size_t valid = first + 1;
+            size_t invalid = planes;
+            for(size_t distance = 2;; distance *= 2) {
+                auto last = std::min(first + distance, planes - 1);
+                if(last <= valid) {
+                    break;
+                }
+                if(!reproduced(first, last)) {
+                    invalid = last;
+                    break;
+                }
+                valid = last;
+            }
+            while(invalid < planes && invalid - valid > 1) {
+                auto middle = (valid + invalid) / 2;
+                if(reproduced(first, middle)) {
+                    valid = middle;
+                } else {
+                    invalid = middle;
+                }
+            }
+            stored.push_back(valid);
+        }
+        if(stored.size() == planes) {
+            return {};
+        }
+
+        // Copy the stored planes and build the coarse index from every bin to the stored plane at or below
+        auto data = std::make_shared<std::vector<double>>(columns * stored.size() * N);
+        for(size_t column = 0; column < columns; ++column) {
+            for(size_t plane = 0; plane < stored.size(); ++plane) {
+                const double* values = field + (column * planes + stored[plane]) * N;
+                std::copy(values, values + N, data->data() + (column * stored.size() + plane) * N);
+            }
+        }
+        z_lower_.resize(planes);
+        for(size_t plane = 0, z = 0; z < planes; ++z) {
+            if(plane + 1 < stored.size() && stored[plane + 1] <= z) {
+                ++plane;
+            }
+            z_lower_[z] = plane;
+        }
+        z_planes_ = std::move(stored);
+        grid_dimensions_[2] = z_planes_.size();
+
+        auto reduced_elements = data->size();
+        return std::make_pair(std::shared_ptr<const double>(data, data->data()), reduced_elements);
+    }
+
+    /**
+     * The field values are copied into a newly allocated array, the original field is not referenced anymore afterwards. For
+     * quantised storage, the scale is chosen such that the largest absolute value of the field maps to the largest integer.
+     */
+    template <typename T, size_t N>
+    void DetectorField<T, N>::set_reduced_precision(const double* field, size_t elements, FieldPrecision precision) {
+        if(precision == FieldPrecision::FLOAT) {
+            auto data = std::make_shared<std::vector<float>>(field, field + elements);
+            field_ = std::shared_ptr<const void>(data, data->data());
+            quantisation_scale_ = 1.;
+        } else {
+            double max_value = 0.;
+            for(size_t i = 0; i < elements; ++i) {
+                max_value = std::max(max_value, std::fabs(field[i]));
+            }
+            quantisation_scale_ = (max_value > 0. ? max_value / std::numeric_limits<int16_t>::max() : 1.);
+
+            auto data = std::make_shared<std::vector<int16_t>>(elements);
+            for(size_t i = 0; i < elements; ++i) {
+                (*data)[i] = static_cast<int16_t>(std::lround(field[i] / quantisation_scale_));
+            }
+            field_ = std::shared_ptr<const void>(data, data->data());
+        }
+        precision_ = precision;
+    }
+
+    /**
+     * The function is applied to all stored grid points, including the padding of tiled grids, such that the derived field
+     * keeps the layout and the adaptive planes along z of this field.
+     */
+    template <typename T, size_t N>
+    DetectorField<T, N> DetectorField<T, N>::derive(const std::function<T(const T&)>& function) const {
+        if(type_ != FieldType::GRID) {
+            return {};
+        }
+
+        auto element_size = (precision_ == FieldPrecision::FLOAT   ? sizeof(float)
+                             : precision_ == FieldPrecision::INT16 ? sizeof(int16_t)
+                                                                   : sizeof(double));
+        auto elements = field_bytes_ / element_size;
+        auto data = std::make_shared<std::vector<double>>(elements);
+        for(size_t offset = 0; offset + N <= elements; offset += N) {
+            store_vector_components(function(get_impl(offset, std::make_index_sequence<N>{})), data->data() + offset);
+        }
+
+        DetectorField<T, N> derived(*this);
+        derived.field_ = std::shared_ptr<const void>(data, data->data());
+        derived.field_bytes_ = elements * sizeof(double);
+        derived.replicas_ = nullptr;
+        derived.precision_ = FieldPrecision::DOUBLE;
+        derived.quantisation_scale_ = 1.;
+        return derived;
+    }
+
     template <typename T, size_t N>
     void
     DetectorField<T, N>::setFunction(FieldFunction<T> function, std::pair<double, double> thickness_domain, FieldType type) {
         thickness_domain_ = std::move(thickness_domain);
         function_ = std::move(function);
+        closed_form_ = false;
+        type_ = type;
+    }
+
+    template <typename T, size_t N>
+    void DetectorField<T, N>::setLinear(
+        T direction, double offset, double slope, std::pair<double, double> thickness_domain, FieldType type) {
+        thickness_domain_ = std::move(thickness_domain);
+        function_ = nullptr;
+        closed_form_ = true;
+        closed_form_direction_ = direction;
+        closed_form_offset_ = offset;
+        closed_form_slope_ = slope;
         type_ = type;
     }
 } // namespace allpix
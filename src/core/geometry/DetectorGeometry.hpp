@@ -0,0 +1,101 @@
+/**
+ * @file
+ * @brief Flattened geometry of a detector for the loops over charge carriers
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_DETECTOR_GEOMETRY_H
+#define ALLPIX_DETECTOR_GEOMETRY_H
+
+#include <array>
+#include <cmath>
+
+namespace allpix {
+    /**
+     * @brief Immutable copy of the geometry of a detector in plain arrays
+     *
+     * The descriptor holds the properties of the detector model which are needed for every charge carrier, such as the
+     * sensor bounds, the pixel pitch and the number of pixels, together with the transformations between the local and the
+     * global frame. It is filled once when the model is assigned to the \ref Detector, such that loops over charge carriers
+     * neither call the virtual getters of the \ref DetectorModel nor construct vectors of ROOT for every carrier. All
+     * coordinates are given in the local frame of the detector, in which the center of the first pixel is the origin.
+     */
+    struct DetectorGeometry {
+        // Center, size and the lower and upper corner of the sensor
+        std::array<double, 3> sensor_center{};
+        std::array<double, 3> sensor_size{};
+        std::array<double, 3> sensor_lower{};
+        std::array<double, 3> sensor_upper{};
+
+        // Pitch and number of pixels in x and y
+        std::array<double, 2> pixel_pitch{};
+        std::array<int, 2> number_of_pixels{};
+
+        // Half of the absolute size of the implants in x and y
+        std::array<double, 2> implant_half_size{};
+
+        // Row-major 3x4 matrices from the local to the global frame and back, with the translation in the last column
+        std::array<double, 12> local_to_global{};
+        std::array<double, 12> global_to_local{};
+
+        /**
+         * @brief Get the local z-coordinate of the surface of the sensor with the implants
+         * @return Upper z-coordinate of the sensor
+         */
+        double implantSurface() const { return sensor_upper[2]; }
+
+        /**
+         * @brief Check if a local position is within the sensor
+         * @param x Local x-coordinate
+         * @param y Local y-coordinate
+         * @param z Local z-coordinate
+         * @return True if the position is within the bounds of the sensor, including its surfaces
+         */
+        bool isWithinSensor(double x, double y, double z) const {
+            return x >= sensor_lower[0] && x <= sensor_upper[0] && y >= sensor_lower[1] && y <= sensor_upper[1] &&
+                   z >= sensor_lower[2] && z <= sensor_upper[2];
+        }
+
+        /**
+         * @brief Get the index of the nearest pixel in x
+         * @param x Local x-coordinate
+         * @return Column of the pixel whose center is closest, can be outside of the pixel grid
+         */
+        int nearestColumn(double x) const { return static_cast<int>(std::round(x / pixel_pitch[0])); }
+
+        /**
+         * @brief Get the index of the nearest pixel in y
+         * @param y Local y-coordinate
+         * @return Row of the pixel whose center is closest, can be outside of the pixel grid
+         */
+        int nearestRow(double y) const { return static_cast<int>(std::round(y / pixel_pitch[1])); }
+
+        /**
+         * @brief Check if a pixel index is part of the pixel grid
+         * @param column Column of the pixel
+         * @param row Row of the pixel
+         * @return True if the pixel exists
+         */
+        bool isWithinPixelGrid(int column, int row) const {
+            return column >= 0 && column < number_of_pixels[0] && row >= 0 && row < number_of_pixels[1];
+        }
+
+        /**
+         * @brief Check if a local position is above or below the implant of a pixel
+         * @param x Local x-coordinate
+         * @param y Local y-coordinate
+         * @param column Column of the pixel
+         * @param row Row of the pixel
+         * @return True if the offset from the center of the pixel is within the implant
+         */
+        bool isWithinImplant(double x, double y, int column, int row) const {
+            return std::fabs(x - column * pixel_pitch[0]) <= implant_half_size[0] &&
+                   std::fabs(y - row * pixel_pitch[1]) <= implant_half_size[1];
+        }
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_DETECTOR_GEOMETRY_H */
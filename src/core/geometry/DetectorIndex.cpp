@@ -0,0 +1,233 @@
+/**
+ * @file
+ * @brief Implementation of the spatial index of the detectors
+ *
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "DetectorIndex.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+using namespace allpix;
+
+// Maximum number of detectors in a leaf of the hierarchy
+static constexpr size_t max_leaf_size = 2;
+
+// Check if a point is within a box given by its minimum and maximum coordinates
+static bool contains(const std::array<double, 6>& box, const ROOT::Math::XYZPoint& point) {
+    return point.x() >= box[0] && point.y() >= box[1] && point.z() >= box[2] && point.x() <= box[3] &&
+           point.y() <= box[4] && point.z() <= box[5];
+}
+
+/**
+ * The local box of every detector is the box of its model, of which the eight corners are transformed to the global frame to
+ * obtain the axis-aligned bounding box used in the hierarchy.
+ */
+DetectorIndex::DetectorIndex(const std::vector<std::shared_ptr<Detector>>& detectors) {
+    entries_.reserve(detectors.size());
+    for(auto& detector : detectors) {
+        auto model = detector->getModel();
+        auto center = model->getGeometricalCenter();
+        auto half_size = model->getSize() / 2.0;
+
+        Entry entry;
+        entry.detector = detector;
+        entry.order = entries_.size();
+        entry.local_box = {{center.x() - half_size.x(),
+                            center.y() - half_size.y(),
+                            center.z() - half_size.z(),
+                            center.x() + half_size.x(),
+                            center.y() + half_size.y(),
+                            center.z() + half_size.z()}};
+
+        entry.global_box = {{std::numeric_limits<double>::max(),
+                             std::numeric_limits<double>::max(),
+                             std::numeric_limits<double>::max(),
+                             std::numeric_limits<double>::lowest(),
+                             std::numeric_limits<double>::lowest(),
+                             std::numeric_limits<double>::lowest()}};
+        for(size_t corner = 0; corner < 8; ++corner) {
+            ROOT::Math::XYZPoint local_corner(entry.local_box[(corner & 1) != 0 ? 3 : 0],
+                                              entry.local_box[(corner & 2) != 0 ? 4 : 1],
+                                              entry.local_box[(corner & 4) != 0 ? 5 : 2]);
+            auto global_corner = detector->getGlobalPosition(local_corner);
+            std::array<double, 3> coordinates{{global_corner.x(), global_corner.y(), global_corner.z()}};
+            for(size_t axis = 0; axis < 3; ++axis) {
+                entry.global_box[axis] = std::min(entry.global_box[axis], coordinates[axis]);
+                entry.global_box[axis + 3] = std::max(entry.global_box[axis + 3], coordinates[axis]);
+            }
+        }
+        entries_.push_back(std::move(entry));
+    }
+
+    if(!entries_.empty()) {
+        nodes_.reserve(2 * entries_.size());
+        build(0, entries_.size());
+    }
+}
+
+/**
+ * The left child of an inner node directly follows the node, such that only the index of the right child is stored.
+ */
+size_t DetectorIndex::build(size_t first, size_t count) {
+    auto index = nodes_.size();
+    nodes_.push_back(Node());
+
+    // Bounding box of all entries in the range
+    Box box = entries_[first].global_box;
+    for(size_t idx = first + 1; idx < first + count; ++idx) {
+        for(size_t axis = 0; axis < 3; ++axis) {
+            box[axis] = std::min(box[axis], entries_[idx].global_box[axis]);
+            box[axis + 3] = std::max(box[axis + 3], entries_[idx].global_box[axis + 3]);
+        }
+    }
+
+    if(count <= max_leaf_size) {
+        nodes_[index] = Node{box, first, count, 0};
+        return index;
+    }
+
+    // Split at the median of the centers along the longest axis of the box
+    size_t split_axis = 0;
+    for(size_t axis = 1; axis < 3; ++axis) {
+        if(box[axis + 3] - box[axis] > box[split_axis + 3] - box[split_axis]) {
+            split_axis = axis;
+        }
+    }
+    auto begin = entries_.begin() + static_cast<std::ptrdiff_t>(first);
+    auto middle = begin + static_cast<std::ptrdiff_t>(count / 2);
+    std::nth_element(begin, middle, begin + static_cast<std::ptrdiff_t>(count), [&](const Entry& lhs, const Entry& rhs) {
+        return lhs.global_box[split_axis] + lhs.global_box[split_axis + 3] <
+               rhs.global_box[split_axis] + rhs.global_box[split_axis + 3];
+    });
+
+    build(first, count / 2);
+    auto right = build(first + count / 2, count - count / 2);
+    nodes_[index] = Node{box, 0, 0, right};
+    return index;
+}
+
+std::vector<std::shared_ptr<Detector>> DetectorIndex::findDetectors(const ROOT::Math::XYZPoint& global_pos) const {
+    std::vector<const Entry*> found;
+    std::vector<size_t> stack;
+    if(!nodes_.empty()) {
+        stack.push_back(0);
+    }
+    while(!stack.empty()) {
+        const auto& node = nodes_[stack.back()];
+        auto index = stack.back();
+        stack.pop_back();
+        if(!contains(node.box, global_pos)) {
+            continue;
+        }
+        if(node.count == 0) {
+            stack.push_back(node.right);
+            stack.push_back(index + 1);
+            continue;
+        }
+        for(size_t idx = node.first; idx < node.first + node.count; ++idx) {
+            const auto& entry = entries_[idx];
+            if(contains(entry.global_box, global_pos) &&
+               contains(entry.local_box, entry.detector->getLocalPosition(global_pos))) {
+                found.push_back(&entry);
+            }
+        }
+    }
+
+    // Keep the order of the original list of detectors
+    std::sort(found.begin(), found.end(), [](const Entry* lhs, const Entry* rhs) { return lhs->order < rhs->order; });
+    std::vector<std::shared_ptr<Detector>> result;
+    result.reserve(found.size());
+    for(auto* entry : found) {
+        result.push_back(entry->detector);
+    }
+    return result;
+}
+
+/**
+ * The transformation to the local frame is affine, such that the fraction of the segment at which a box is entered is the
+ * same in the global and the local frame.
+ */
+std::vector<std::shared_ptr<Detector>> DetectorIndex::findDetectors(const ROOT::Math::XYZPoint& start,
+                                                                    const ROOT::Math::XYZPoint& end) const {
+    std::vector<std::pair<double, const Entry*>> found;
+    std::vector<size_t> stack;
+    if(!nodes_.empty()) {
+        stack.push_back(0);
+    }
+    double entry_fraction = 0;
+    while(!stack.empty()) {
+        const auto& node = nodes_[stack.back()];
+        auto index = stack.back();
+        stack.pop_back();
+        if(!intersect(node.box, start, end, entry_fraction)) {
+            continue;
+        }
+        if(node.count == 0) {
+            stack.push_back(node.right);
+            stack.push_back(index + 1);
+            continue;
+        }
+        for(size_t idx = node.first; idx < node.first + node.count; ++idx) {
+            const auto& entry = entries_[idx];
+            if(intersect(entry.global_box, start, end, entry_fraction) &&
+               intersect(entry.local_box,
+                         entry.detector->getLocalPosition(start),
+                         entry.detector->getLocalPosition(end),
+                         entry_fraction)) {
+                found.emplace_back(entry_fraction, &entry);
+            }
+        }
+    }
+
+    // Order by the distance at which the detectors are entered, keeping the original order for equal distances
+    std::sort(found.begin(), found.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first < rhs.first || (lhs.first == rhs.first && lhs.second->order < rhs.second->order);
+    });
+    std::vector<std::shared_ptr<Detector>> result;
+    result.reserve(found.size());
+    for(auto& fraction_entry : found) {
+        result.push_back(fraction_entry.second->detector);
+    }
+    return result;
+}
+
+/**
+ * Uses the slab method, clipping the segment to the range between the two planes of the box along every axis. Segments
+ * parallel to an axis only intersect if their coordinate along this axis is within the box.
+ */
+bool DetectorIndex::intersect(const Box& box,
+                              const ROOT::Math::XYZPoint& start,
+                              const ROOT::Math::XYZPoint& end,
+                              double& entry) {
+    std::array<double, 3> origin{{start.x(), start.y(), start.z()}};
+    std::array<double, 3> direction{{end.x() - start.x(), end.y() - start.y(), end.z() - start.z()}};
+
+    double t_min = 0, t_max = 1;
+    for(size_t axis = 0; axis < 3; ++axis) {
+        if(direction[axis] == 0) {
+            if(origin[axis] < box[axis] || origin[axis] > box[axis + 3]) {
+                return false;
+            }
+            continue;
+        }
+        auto t_low = (box[axis] - origin[axis]) / direction[axis];
+        auto t_high = (box[axis + 3] - origin[axis]) / direction[axis];
+        if(t_low > t_high) {
+            std::swap(t_low, t_high);
+        }
+        t_min = std::max(t_min, t_low);
+        t_max = std::min(t_max, t_high);
+        if(t_min > t_max) {
+            return false;
+        }
+    }
+    entry = t_min;
+    return true;
+}
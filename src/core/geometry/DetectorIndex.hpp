@@ -0,0 +1,109 @@
+/**
+ * @file
+ * @brief Spatial index of the detectors in the global geometry
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_DETECTOR_INDEX_H
+#define ALLPIX_DETECTOR_INDEX_H
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <Math/Point3D.h>
+
+#include "Detector.hpp"
+
+namespace allpix {
+    /**
+     * @brief Bounding volume hierarchy over the boxes of all detectors
+     *
+     * Every detector is covered by the box of its model, centered around the geometrical center of the model with the size
+     * of the model. The hierarchy is built from the axis-aligned bounding boxes of these boxes in the global frame,
+     * splitting the detectors at the median along the longest axis of every node. Queries descend only into the nodes whose
+     * bounding box is hit, and the candidates found in the leaves are tested exactly against their box in the local frame.
+     * Points and segments are thus resolved in logarithmic time in the number of detectors.
+     *
+     * The index is immutable after construction, such that it can be queried by multiple threads concurrently.
+     */
+    class DetectorIndex {
+    public:
+        /**
+         * @brief Construct an empty index
+         */
+        DetectorIndex() = default;
+
+        /**
+         * @brief Build the index over a list of detectors
+         * @param detectors Detectors to index, which should all have a model assigned
+         */
+        explicit DetectorIndex(const std::vector<std::shared_ptr<Detector>>& detectors);
+
+        /**
+         * @brief Get all detectors whose box contains a point
+         * @param global_pos Position in the global frame
+         * @return Detectors containing the point, in the order of the list the index was built from
+         */
+        std::vector<std::shared_ptr<Detector>> findDetectors(const ROOT::Math::XYZPoint& global_pos) const;
+
+        /**
+         * @brief Get all detectors whose box is crossed by a segment
+         * @param start Start point of the segment in the global frame
+         * @param end End point of the segment in the global frame
+         * @return Detectors crossed by the segment, ordered by the distance from the start point at which they are entered
+         */
+        std::vector<std::shared_ptr<Detector>> findDetectors(const ROOT::Math::XYZPoint& start,
+                                                             const ROOT::Math::XYZPoint& end) const;
+
+    private:
+        using Box = std::array<double, 6>;
+
+        /**
+         * @brief Node of the hierarchy, either with two children or a range of entries
+         */
+        struct Node {
+            Box box;
+            size_t first;
+            size_t count;
+            size_t right;
+        };
+
+        /**
+         * @brief Detector with its bounding box in the global frame and its box in the local frame
+         */
+        struct Entry {
+            std::shared_ptr<Detector> detector;
+            size_t order;
+            Box global_box;
+            Box local_box;
+        };
+
+        /**
+         * @brief Recursively build the node covering a range of entries
+         * @param first First entry of the range
+         * @param count Number of entries in the range
+         * @return Index of the created node
+         */
+        size_t build(size_t first, size_t count);
+
+        /**
+         * @brief Intersect a segment with a box
+         * @param box Box to intersect with
+         * @param start Start point of the segment
+         * @param end End point of the segment
+         * @param entry Fraction of the segment at which the box is entered, if it is intersected
+         * @return True if the segment intersects the box
+         */
+        static bool
+        intersect(const Box& box, const ROOT::Math::XYZPoint& start, const ROOT::Math::XYZPoint& end, double& entry);
+
+        std::vector<Entry> entries_;
+        std::vector<Node> nodes_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_DETECTOR_INDEX_H */
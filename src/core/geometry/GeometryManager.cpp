@@ -45,9 +45,14 @@ void GeometryManager::load(ConfigManager* conf_manager, std::mt19937_64& seeder)
     std::mt19937_64 random_generator;
     random_generator.seed(seeder());
 
+    // Reserve the containers for all defined detectors at once, they are commonly auto-generated in large numbers
+    auto& detector_configs = conf_manager->getDetectorConfigurations();
+    detectors_.reserve(detectors_.size() + detector_configs.size());
+    detectors_by_name_.reserve(detectors_by_name_.size() + detector_configs.size());
+
     // Loop over all defined detectors
     LOG(DEBUG) << "Loading detectors";
-    for(auto& detector_section : conf_manager->getDetectorConfigurations()) {
+    for(auto& detector_section : detector_configs) {
         LOG(DEBUG) << "Detector " << detector_section.getName() << ":";
 
         // Calculate possible detector misalignment to be added
@@ -95,8 +100,20 @@ void GeometryManager::load(ConfigManager* conf_manager, std::mt19937_64& seeder)
         auto detector = std::shared_ptr<Detector>(new Detector(detector_section.getName(), position, orientation));
         addDetector(detector);
 
+        // Only keep the parameters which specialize the model, instead of a copy of the full detector configuration
+        Configuration model_section(detector_section.getName(), detector_section.getFilePath());
+        for(auto& key_value : detector_section.getAll()) {
+            auto& key = key_value.first;
+            // Skip all internal parameters
+            if(key == "type" || key == "position" || key == "orientation_mode" || key == "orientation") {
+                continue;
+            }
+            model_section.setText(key, key_value.second);
+        }
+
         // Add a link to the detector to add the model later
-        nonresolved_models_[detector_section.get<std::string>("type")].emplace_back(detector_section, detector.get());
+        nonresolved_models_[detector_section.get<std::string>("type")].emplace_back(std::move(model_section),
+                                                                                    detector.get());
     }
 
     // Load the list of standard model paths
@@ -247,11 +264,10 @@ void GeometryManager::addModel(std::shared_ptr<DetectorModel> model) {
     }
 
     LOG(TRACE) << "Registering new model " << model->getType();
-    if(model_names_.find(model->getType()) != model_names_.end()) {
+    if(!models_by_name_.emplace(model->getType(), model).second) {
         throw DetectorModelExistsError(model->getType());
     }
 
-    model_names_.insert(model->getType());
     models_.push_back(std::move(model));
 }
 
@@ -259,7 +275,7 @@ bool GeometryManager::needsModel(const std::string& name) const {
     return nonresolved_models_.find(name) != nonresolved_models_.end();
 }
 bool GeometryManager::hasModel(const std::string& name) const {
-    return model_names_.find(name) != model_names_.end();
+    return models_by_name_.find(name) != models_by_name_.end();
 }
 
 std::vector<std::shared_ptr<DetectorModel>> GeometryManager::getModels() const {
@@ -269,13 +285,11 @@ std::vector<std::shared_ptr<DetectorModel>> GeometryManager::getModels() const {
  * @throws InvalidDetectorError If a model with this name does not exist
  */
 std::shared_ptr<DetectorModel> GeometryManager::getModel(const std::string& name) const {
-    // FIXME: this is not a very nice way to implement this
-    for(auto& model : models_) {
-        if(model->getType() == name) {
-            return model;
-        }
+    auto model_iter = models_by_name_.find(name);
+    if(model_iter == models_by_name_.end()) {
+        throw allpix::InvalidModelError(name);
     }
-    throw allpix::InvalidModelError(name);
+    return model_iter->second;
 }
 
 /**
@@ -299,16 +313,15 @@ void GeometryManager::addDetector(std::shared_ptr<Detector> detector) {
         throw DetectorInvalidNameError(detector->getName());
     }
 
-    if(detector_names_.find(detector->getName()) != detector_names_.end()) {
+    if(!detectors_by_name_.emplace(detector->getName(), detector).second) {
         throw DetectorExistsError(detector->getName());
     }
 
-    detector_names_.insert(detector->getName());
     detectors_.push_back(std::move(detector));
 }
 
 bool GeometryManager::hasDetector(const std::string& name) const {
-    return detector_names_.find(name) != detector_names_.end();
+    return detectors_by_name_.find(name) != detectors_by_name_.end();
 }
 
 std::vector<std::shared_ptr<Detector>> GeometryManager::getDetectors() {
@@ -326,13 +339,11 @@ std::shared_ptr<Detector> GeometryManager::getDetector(const std::string& name)
         close_geometry();
     }
 
-    // FIXME: this is not a very nice way to implement this
-    for(auto& detector : detectors_) {
-        if(detector->getName() == name) {
-            return detector;
-        }
+    auto detector_iter = detectors_by_name_.find(name);
+    if(detector_iter == detectors_by_name_.end()) {
+        throw allpix::InvalidDetectorError(name);
     }
-    throw allpix::InvalidDetectorError(name);
+    return detector_iter->second;
 }
 /**
  * @throws InvalidDetectorError If not a single detector with this type exists
@@ -355,6 +366,36 @@ std::vector<std::shared_ptr<Detector>> GeometryManager::getDetectorsByType(const
     return result;
 }
 
+std::vector<std::shared_ptr<Detector>> GeometryManager::getDetectorsAt(const ROOT::Math::XYZPoint& global_pos) {
+    if(!closed_) {
+        close_geometry();
+    }
+
+    return detector_index_.findDetectors(global_pos);
+}
+
+/**
+ * Sensors of different detectors are not expected to overlap, the first detector in the order they were added is returned
+ * otherwise.
+ */
+std::shared_ptr<Detector> GeometryManager::getSensorDetectorAt(const ROOT::Math::XYZPoint& global_pos) {
+    for(auto& detector : getDetectorsAt(global_pos)) {
+        if(detector->isWithinSensor(detector->getLocalPosition(global_pos))) {
+            return detector;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<std::shared_ptr<Detector>> GeometryManager::getDetectorsAlong(const ROOT::Math::XYZPoint& start,
+                                                                          const ROOT::Math::XYZPoint& end) {
+    if(!closed_) {
+        close_geometry();
+    }
+
+    return detector_index_.findDetectors(start, end);
+}
+
 void GeometryManager::load_models() {
     LOG(TRACE) << "Loading remaining default models";
 
@@ -440,7 +481,8 @@ std::shared_ptr<DetectorModel> GeometryManager::parse_config(const std::string&
 /*
  * After closing the geometry new parts of the geometry cannot be added anymore. All the models for the detectors in the
  * configuration are resolved to requested type (and an error is thrown if this is not possible). Also if a parameter is
- * specialized in the detector config a copy of the model is created with those specialized settings.
+ * specialized in the detector config a copy of the model is created with those specialized settings. Detectors of the same
+ * type specializing the same parameters with the same values share a single copy of the model.
  */
 void GeometryManager::close_geometry() {
     LOG(TRACE) << "Starting geometry closing procedure";
@@ -448,44 +490,50 @@ void GeometryManager::close_geometry() {
     // Load all standard models
     load_models();
 
-    // Try to resolve the missing models
+    // Try to resolve the missing models, sharing a specialized model between all detectors with the same settings
+    std::map<std::string, std::shared_ptr<DetectorModel>> specialized_models;
+    size_t resolved_detectors = 0;
     for(auto& detectors_types : nonresolved_models_) {
+        auto base_model = getModel(detectors_types.first);
         for(auto& config_detector : detectors_types.second) {
+            auto& config = config_detector.first;
+            auto model = base_model;
+
             // Create a new model if one of the core model parameters is changed in the detector configuration
-            auto config = config_detector.first;
-            auto model = getModel(detectors_types.first);
-
-            // Get the configuration of the model
-            Configuration new_config("");
-            auto model_configs = model->getConfigurations();
-
-            // Add all non internal parameters to the config for a specialized model
-            for(auto& key_value : config.getAll()) {
-                auto key = key_value.first;
-                // Skip all internal parameters
-                if(key == "type" || key == "position" || key == "orientation_mode" || key == "orientation") {
-                    continue;
+            if(config.countSettings() != 0) {
+                // Identify the specialization by the type and the sorted list of changed parameters
+                std::string specialization = detectors_types.first;
+                for(auto& key_value : config.getAll()) {
+                    specialization += '\n' + key_value.first + '=' + key_value.second;
                 }
-                // Add the extra parameter to the new overwritten config
-                new_config.setText(key, key_value.second);
-            }
 
-            // Create new model if needed
-            if(new_config.countSettings() != 0) {
-                ConfigReader reader;
-                // Add the new configuration first to overwrite
-                reader.addConfiguration(std::move(new_config));
-                // Then add the original configuration
-                for(auto& model_config : model_configs) {
-                    reader.addConfiguration(std::move(model_config));
+                auto& specialized_model = specialized_models[specialization];
+                if(specialized_model == nullptr) {
+                    // Add the new configuration first to overwrite, then add the original configuration
+                    ConfigReader reader;
+                    Configuration new_config("");
+                    for(auto& key_value : config.getAll()) {
+                        new_config.setText(key_value.first, key_value.second);
+                    }
+                    reader.addConfiguration(std::move(new_config));
+                    for(auto& model_config : base_model->getConfigurations()) {
+                        reader.addConfiguration(std::move(model_config));
+                    }
+
+                    specialized_model = parse_config(detectors_types.first, reader);
                 }
-
-                model = parse_config(detectors_types.first, reader);
+                model = specialized_model;
             }
 
             config_detector.second->set_model(model);
+            ++resolved_detectors;
         }
     }
+    LOG(DEBUG) << "Resolved the models of " << resolved_detectors << " detector(s) using " << specialized_models.size()
+               << " specialized model(s)";
+
+    // Build the spatial index over the final geometry of all detectors
+    detector_index_ = DetectorIndex(detectors_);
 
     closed_ = true;
     LOG(TRACE) << "Closed geometry";
@@ -14,11 +14,13 @@
 #include <random>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <Math/Vector3D.h>
 
 #include "Detector.hpp"
+#include "DetectorIndex.hpp"
 #include "DetectorModel.hpp"
 #include "core/config/ConfigManager.hpp"
 #include "core/config/ConfigReader.hpp"
@@ -32,6 +34,7 @@ namespace allpix {
         NONE = 0, ///< No magnetic field is simulated
         CONSTANT, ///< Constant magnetic field (mostly for testing)
         CUSTOM,   ///< Custom magnetic field function
+        GRID,     ///< Magnetic field defined by a grid in global coordinates
     };
 
     using MagneticFieldFunction = std::function<ROOT::Math::XYZVector(const ROOT::Math::XYZPoint&)>;
@@ -183,6 +186,31 @@ namespace allpix {
          */
         std::vector<std::shared_ptr<Detector>> getDetectorsByType(const std::string& type);
 
+        /**
+         * @brief Get all detectors whose volume contains a point
+         * @param global_pos Position in the global frame
+         * @return Detectors with the point inside the box of their model, in the order they were added
+         * @note The detectors are looked up in a spatial index, in logarithmic time in the number of detectors
+         */
+        std::vector<std::shared_ptr<Detector>> getDetectorsAt(const ROOT::Math::XYZPoint& global_pos);
+
+        /**
+         * @brief Get the detector whose sensor contains a point
+         * @param global_pos Position in the global frame
+         * @return Detector with the point inside its sensor, or a null pointer if the point is outside of all sensors
+         */
+        std::shared_ptr<Detector> getSensorDetectorAt(const ROOT::Math::XYZPoint& global_pos);
+
+        /**
+         * @brief Get all detectors whose volume is crossed by a segment
+         * @param start Start point of the segment in the global frame
+         * @param end End point of the segment in the global frame
+         * @return Detectors crossed by the segment, ordered by the distance from the start point at which they are entered
+         * @note The detectors are looked up in a spatial index, in logarithmic time in the number of detectors
+         */
+        std::vector<std::shared_ptr<Detector>> getDetectorsAlong(const ROOT::Math::XYZPoint& start,
+                                                                 const ROOT::Math::XYZPoint& end);
+
         /**
          * @brief Set the magnetic field in the volume
          * @param function Function used to retrieve the magnetic field
@@ -228,11 +256,13 @@ namespace allpix {
 
         std::vector<std::string> model_paths_;
         std::vector<std::shared_ptr<DetectorModel>> models_;
-        std::set<std::string> model_names_;
+        std::unordered_map<std::string, std::shared_ptr<DetectorModel>> models_by_name_;
 
+        // Detectors without a model, with the settings of their configuration which specialize the model of their type
         std::map<std::string, std::vector<std::pair<Configuration, Detector*>>> nonresolved_models_;
         std::vector<std::shared_ptr<Detector>> detectors_;
-        std::set<std::string> detector_names_;
+        std::unordered_map<std::string, std::shared_ptr<Detector>> detectors_by_name_;
+        DetectorIndex detector_index_;
 
         MagneticFieldType magnetic_field_type_{MagneticFieldType::NONE};
         MagneticFieldFunction magnetic_field_function_;
@@ -34,3 +34,18 @@ std::shared_ptr<const Detector> BaseMessage::getDetector() const {
 std::vector<std::reference_wrapper<Object>> BaseMessage::getObjectArray() {
     throw MessageWithoutObjectException(typeid(*this));
 }
+
+size_t BaseMessage::getObjectCount() const {
+    return 0;
+}
+
+/**
+ * @throws MessageWithoutObjectException If this method is not overridden
+ */
+Object& BaseMessage::getObject(size_t) {
+    throw MessageWithoutObjectException(typeid(*this));
+}
+
+size_t BaseMessage::getMemorySize() const {
+    return sizeof(*this);
+}
@@ -11,6 +11,7 @@
 #ifndef ALLPIX_MESSAGE_H
 #define ALLPIX_MESSAGE_H
 
+#include <mutex>
 #include <vector>
 
 #include "core/geometry/Detector.hpp"
@@ -24,6 +25,8 @@ namespace allpix {
      * instantiating a version of the Message class should be preferred.
      */
     class BaseMessage {
+        friend class Messenger;
+
     public:
         /**
          * @brief Essential virtual destructor
@@ -53,6 +56,25 @@ namespace allpix {
          */
         virtual std::vector<std::reference_wrapper<Object>> getObjectArray();
 
+        /**
+         * @brief Get the number of objects stored in this message, to iterate over them with \ref getObject
+         * @return Number of objects
+         */
+        virtual size_t getObjectCount() const;
+
+        /**
+         * @brief Get a single object stored in this message without creating a list of all objects
+         * @param index Index of the object, should be smaller than the number of objects
+         * @return Reference to the object
+         */
+        virtual Object& getObject(size_t index);
+
+        /**
+         * @brief Get the memory held by this message
+         * @return Size of the message in bytes
+         */
+        virtual size_t getMemorySize() const;
+
     protected:
         /**
          * @brief Construct a general message not linked to a detector
@@ -64,14 +86,57 @@ namespace allpix {
          */
         explicit BaseMessage(std::shared_ptr<const Detector> detector);
 
+        /**
+         * @brief Get the number of modules this message has been dispatched to
+         * @return Number of receivers, zero if the message has not been dispatched yet
+         */
+        size_t getReceiverCount() const { return receivers_; }
+
     private:
         std::shared_ptr<const Detector> detector_;
+        size_t receivers_{};
+    };
+
+    /**
+     * @brief Pool of object lists recycled between messages of the same type
+     *
+     * Every message returns the list of its objects to this pool when it is destroyed. The objects are destructed, but the
+     * allocated memory of the list is kept, such that modules creating a new list of objects using \ref acquire do not
+     * need to allocate memory again once the simulation reached a steady state. All methods are thread-safe.
+     */
+    template <typename T> class MessageStorage {
+    public:
+        /**
+         * @brief Get an empty list of objects, reusing the memory of a released list if available
+         * @return Empty list of objects
+         */
+        static std::vector<T> acquire();
+
+        /**
+         * @brief Return a list of objects to the pool after destructing all objects in it
+         * @param data List of objects to recycle
+         */
+        static void release(std::vector<T>&& data);
+
+    private:
+        /**
+         * @brief Get the pool for this type of objects
+         * @return Reference to the single pool of this type
+         */
+        static MessageStorage& get_instance();
+
+        // Maximum number of lists kept in the pool to limit the memory retained after large events
+        static constexpr size_t max_buffers_{64};
+
+        std::mutex mutex_;
+        std::vector<std::vector<T>> buffers_;
     };
 
     /**
      * @brief Generic class for all messages
      *
-     * An instantiation of this class should the preferred way to send objects
+     * An instantiation of this class should the preferred way to send objects. The list of objects is returned to the
+     * \ref MessageStorage when the message is destroyed.
      */
     template <typename T> class Message : public BaseMessage {
     public:
@@ -87,17 +152,62 @@ namespace allpix {
          */
         Message(std::vector<T> data, const std::shared_ptr<const Detector>& detector);
 
+        /**
+         * @brief Recycle the list of objects in the \ref MessageStorage
+         */
+        ~Message() override;
+
+        ///@{
+        /**
+         * @brief Use default copy and move behaviour
+         */
+        Message(const Message&) = default;
+        Message& operator=(const Message&) = default;
+
+        Message(Message&&) noexcept = default;
+        Message& operator=(Message&&) noexcept = default;
+        ///@}
+
         /**
          * @brief Get a reference to the data in this message
          */
         const std::vector<T>& getData() const;
 
+        /**
+         * @brief Take the data out of this message to modify it, without copying if possible
+         * @return List of data objects, moved out of the message if it has no other receiver and copied otherwise
+         * @warning After the data has been moved out, the message is empty and the objects only live as long as the
+         *          returned list. Objects of later messages should therefore not refer to them, unless the list is
+         *          dispatched again in a new message.
+         */
+        std::vector<T> takeData();
+
         /**
          * @brief Get data as list of objects if the contents can be converted
          * @return Data as list of object references (throws if not possible)
          */
         std::vector<std::reference_wrapper<Object>> getObjectArray() override;
 
+        /**
+         * @brief Get the number of data objects stored in this message
+         * @return Number of objects
+         */
+        size_t getObjectCount() const override;
+
+        /**
+         * @brief Get a single data object as base object if the contents can be converted
+         * @param index Index of the object, should be smaller than the number of objects
+         * @return Reference to the object (throws if not possible)
+         */
+        Object& getObject(size_t index) override;
+
+        /**
+         * @brief Get the memory held by this message, including the allocated capacity of the list of objects
+         * @return Size of the message in bytes
+         * @note Memory allocated by the objects themselves, for example for lists of positions, is not included
+         */
+        size_t getMemorySize() const override;
+
     private:
         /**
          * @brief Returns object array for messages containing objects
@@ -113,6 +223,18 @@ namespace allpix {
         std::vector<std::reference_wrapper<Object>>
         get_object_array(typename std::enable_if<!std::is_base_of<Object, U>::value>::type* = nullptr);
 
+        /**
+         * @brief Returns a single object for messages containing objects
+         */
+        template <typename U = T>
+        Object& get_object(size_t index, typename std::enable_if<std::is_base_of<Object, U>::value>::type* = nullptr);
+
+        /**
+         * @brief Throws error if message does not contain object
+         */
+        template <typename U = T>
+        Object& get_object(size_t index, typename std::enable_if<!std::is_base_of<Object, U>::value>::type* = nullptr);
+
         std::vector<T> data_;
     };
 } // namespace allpix
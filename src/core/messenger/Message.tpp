@@ -11,13 +11,71 @@
 #include "exceptions.h"
 
 namespace allpix {
+    template <typename T> MessageStorage<T>& MessageStorage<T>::get_instance() {
+        static MessageStorage<T> instance;
+        return instance;
+    }
+
+    template <typename T> std::vector<T> MessageStorage<T>::acquire() {
+        auto& storage = get_instance();
+        std::lock_guard<std::mutex> lock(storage.mutex_);
+        if(storage.buffers_.empty()) {
+            return std::vector<T>();
+        }
+
+        auto data = std::move(storage.buffers_.back());
+        storage.buffers_.pop_back();
+        return data;
+    }
+
+    /**
+     * Lists without allocated memory are dropped directly, as well as all lists released while the pool is full.
+     */
+    template <typename T> void MessageStorage<T>::release(std::vector<T>&& data) {
+        data.clear();
+        if(data.capacity() == 0) {
+            return;
+        }
+
+        auto& storage = get_instance();
+        std::lock_guard<std::mutex> lock(storage.mutex_);
+        if(storage.buffers_.size() < max_buffers_) {
+            storage.buffers_.push_back(std::move(data));
+        }
+    }
+
     template <typename T> Message<T>::Message(std::vector<T> data) : BaseMessage(), data_(std::move(data)) {}
     template <typename T>
     Message<T>::Message(std::vector<T> data, const std::shared_ptr<const Detector>& detector)
         : BaseMessage(detector), data_(std::move(data)) {}
 
+    template <typename T> Message<T>::~Message() { MessageStorage<T>::release(std::move(data_)); }
+
     template <typename T> const std::vector<T>& Message<T>::getData() const { return data_; }
 
+    /**
+     * Only a message which has been dispatched to at most one module can be emptied, as otherwise other receivers would
+     * observe the change. Copies are created from a list of the \ref MessageStorage to reuse its memory.
+     */
+    template <typename T> std::vector<T> Message<T>::takeData() {
+        if(getReceiverCount() <= 1) {
+            auto data = std::move(data_);
+            data_.clear();
+            return data;
+        }
+        auto data = MessageStorage<T>::acquire();
+        data.assign(data_.begin(), data_.end());
+        return data;
+    }
+
+    template <typename T> size_t Message<T>::getObjectCount() const { return data_.size(); }
+
+    template <typename T> Object& Message<T>::getObject(size_t index) { return get_object(index); }
+
+    template <typename T> size_t Message<T>::getMemorySize() const {
+        return sizeof(Message<T>) + data_.capacity() * sizeof(T);
+    }
+
     /**
      * Chooses between internal \ref get_object_array implementations dependent on the type of the object (if it drives from
      * \ref allpix::Object).
@@ -47,4 +105,19 @@ namespace allpix {
     Message<T>::get_object_array(typename std::enable_if<!std::is_base_of<Object, U>::value>::type*) {
         throw MessageWithoutObjectException(typeid(*this));
     }
+
+    template <typename T>
+    template <typename U>
+    Object& Message<T>::get_object(size_t index, typename std::enable_if<std::is_base_of<Object, U>::value>::type*) {
+        return data_[index];
+    }
+    /**
+     * @throws MessageWithoutObjectException Always (but this method is only used if this message does not contain types
+     * derived from \ref allpix::Object.
+     */
+    template <typename T>
+    template <typename U>
+    Object& Message<T>::get_object(size_t, typename std::enable_if<!std::is_base_of<Object, U>::value>::type*) {
+        throw MessageWithoutObjectException(typeid(*this));
+    }
 } // namespace allpix
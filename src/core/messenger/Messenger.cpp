@@ -10,13 +10,18 @@
 
 #include "Messenger.hpp"
 
+#include <algorithm>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <typeindex>
+#include <vector>
 
 #include "Message.hpp"
+#include "core/module/Event.hpp"
 #include "core/module/Module.hpp"
+#include "core/module/exceptions.h"
 #include "core/utils/log.h"
 #include "core/utils/type.h"
 #include "delegates.h"
@@ -32,120 +37,205 @@ Messenger::~Messenger() {
 }
 #endif
 
-// Check if the detectors match for the message and the delegate
-static bool check_send(BaseMessage* message, BaseDelegate* delegate) {
-    if(delegate->getDetector() != nullptr &&
-       (message->getDetector() == nullptr || delegate->getDetector()->getName() != message->getDetector()->getName())) {
-        return false;
-    }
-    return true;
-}
-
 /**
- * Messages should be bound during construction, so this function only gives useful information outside the constructor
+ * Detectors are identified by their address, as messages are bound to the detectors of the geometry manager. Messages bound
+ * to another object are matched by the name of the detector, as done for the listeners when resolving the routes.
  */
-bool Messenger::hasReceiver(Module* source, const std::shared_ptr<BaseMessage>& message) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    const BaseMessage* inst = message.get();
-    std::type_index type_idx = typeid(*inst);
-
-    // Get the name of the output message
-    auto name = source->get_configuration().get<std::string>("output");
-
-    // Check if a normal specific listener exists
-    for(auto& delegate : delegates_[type_idx][name]) {
-        if(check_send(message.get(), delegate.get())) {
-            return true;
-        }
+const Messenger::RouteList& Messenger::DetectorRoutes::get(const BaseMessage* message) const {
+    if(detectors.empty()) {
+        return common;
     }
-    // Check if a normal generic listener exists
-    for(auto& delegate : delegates_[type_idx]["*"]) {
-        if(check_send(message.get(), delegate.get())) {
-            return true;
-        }
+    auto detector = message->getDetector();
+    if(detector == nullptr) {
+        return common;
     }
-    // Check if a base message specific listener exists
-    for(auto& delegate : delegates_[typeid(BaseMessage)][name]) {
-        if(check_send(message.get(), delegate.get())) {
-            return true;
-        }
+    auto iter = detectors.find(detector.get());
+    if(iter != detectors.end()) {
+        return iter->second;
     }
-    // Check if a base message generic listener exists
-    for(auto& delegate : delegates_[typeid(BaseMessage)]["*"]) {
-        if(check_send(message.get(), delegate.get())) {
-            return true;
+    for(auto& detector_routes : detectors) {
+        if(detector_routes.first->getName() == detector->getName()) {
+            return detector_routes.second;
         }
     }
+    return common;
+}
 
-    return false;
+/**
+ * Messages should be bound during construction, so this function only gives useful information outside the constructor
+ */
+bool Messenger::hasReceiver(Module* source, const std::shared_ptr<BaseMessage>& message) {
+    const BaseMessage* inst = message.get();
+    return !get_routing_table()->get(typeid(*inst)).get(source->output_name_).get(inst).empty();
 }
 
 /**
- * Send messages to all specific listeners and also to all generic listeners (listening to all incoming messages)
+ * @throws InvalidModuleActionException If the message is dispatched outside an event
+ *
+ * Send messages to all specific listeners and also to all generic listeners (listening to all incoming messages). The
+ * messages are stored in the event and only forwarded to the receiving module right before it is run for this event. The
+ * receivers are looked up in the read-only routing table, such that no lock is needed to dispatch a message.
  */
-void Messenger::dispatch_message(Module* source, const std::shared_ptr<BaseMessage>& message, std::string name) {
-    std::lock_guard<std::mutex> lock(mutex_);
+void Messenger::dispatch_message(Module* source,
+                                 const std::shared_ptr<BaseMessage>& message,
+                                 const std::string& name,
+                                 Event* event) {
+    if(event == nullptr) {
+        throw InvalidModuleActionException("Module " + source->getUniqueName() +
+                                           " cannot dispatch a message outside of an event or without passing the event");
+    }
 
     // Get the name of the output message
-    if(name == "-") {
-        name = source->get_configuration().get<std::string>("output");
-    }
+    const std::string& message_name = (name == "-" ? source->output_name_ : name);
 
-    bool send = false;
+    // Create type identifier from the typeid
+    const BaseMessage* inst = message.get();
+    std::type_index type_idx = typeid(*inst);
+    assert(typeid(BaseMessage) != type_idx);
 
-    // Send to specific listeners
-    send = dispatch_message(source, message, name, name) || send;
+    // Update the statistics of the dispatching module, in total and per type of message
+    auto bytes = message->getMemorySize();
+    ++source->messages_dispatched_;
+    source->message_bytes_dispatched_ += bytes;
+    source->statistics_.getCounter("message_bytes_dispatched:" + allpix::demangle(type_idx.name())) += bytes;
+    Event::dispatched_bytes_ += bytes;
+    event->add_message_bytes(bytes);
 
-    // Send to generic listeners
-    send = dispatch_message(source, message, name, "*") || send;
+    // Send to specific listeners and generic listeners, the routes only contain the listeners accepting the detector
+    const auto& routes = get_routing_table()->get(type_idx).get(message_name).get(inst);
+    message->receivers_ = routes.size();
+    if(source->record_receivers_) {
+        std::lock_guard<std::mutex> lock(source->receivers_mutex_);
+        source->dispatched_messages_ = true;
+        for(const auto& route : routes) {
+            source->message_receivers_.insert(route.delegate);
+        }
+    }
+    for(const auto& route : routes) {
+        LOG(TRACE) << "Sending message " << allpix::demangle(type_idx.name()) << " from " << source->getUniqueName()
+                   << " to " << (route.generic ? "generic listener " : "") << route.delegate->getUniqueName();
+        event->store_message(route.delegate, message, message_name);
+    }
 
     // Display a TRACE log message if the message is send to no receiver
-    if(!send) {
-        const BaseMessage* inst = message.get();
-        LOG(TRACE) << "Dispatched message " << allpix::demangle(typeid(*inst).name()) << " from " << source->getUniqueName()
+    if(routes.empty()) {
+        LOG(TRACE) << "Dispatched message " << allpix::demangle(type_idx.name()) << " from " << source->getUniqueName()
                    << " has no receivers!";
     }
 
-    // Save a copy of the sent message
-    sent_messages_.emplace_back(message);
+    // Save a copy of the sent message in the event
+    event->keep_message(message);
 }
 
 /**
- * Messages are only dispatched to delegates listening to the exact same type and the exact same name.
+ * The table is published through an atomic pointer, such that only the construction of the table after the delegates have
+ * changed requires the lock. Delegates should therefore not be added or removed while events are processed.
  */
-bool Messenger::dispatch_message(Module* source,
-                                 const std::shared_ptr<BaseMessage>& message,
-                                 const std::string& name,
-                                 const std::string& id) {
-    bool send = false;
+const Messenger::RoutingTable* Messenger::get_routing_table() {
+    auto* table = routing_table_.load(std::memory_order_acquire);
+    if(table != nullptr) {
+        return table;
+    }
 
-    // Create type identifier from the typeid
-    const BaseMessage* inst = message.get();
-    std::type_index type_idx = typeid(*inst);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(routing_table_storage_ == nullptr) {
+        routing_table_storage_ = build_routing_table();
+        routing_table_.store(routing_table_storage_.get(), std::memory_order_release);
+    }
+    return routing_table_storage_.get();
+}
 
-    // Send messages only to their specific listeners
-    for(auto& delegate : delegates_[type_idx][id]) {
-        if(check_send(message.get(), delegate.get())) {
-            LOG(TRACE) << "Sending message " << allpix::demangle(type_idx.name()) << " from " << source->getUniqueName()
-                       << " to " << delegate->getUniqueName();
-            delegate->process(message, name);
-            send = true;
+std::unique_ptr<Messenger::RoutingTable> Messenger::build_routing_table() const {
+    static const std::list<std::unique_ptr<BaseDelegate>> no_delegates;
+    auto find_delegates = [&](const std::type_index& type, const std::string& id) -> const decltype(no_delegates)& {
+        auto type_iter = delegates_.find(type);
+        if(type_iter == delegates_.end()) {
+            return no_delegates;
         }
-    }
+        auto id_iter = type_iter->second.find(id);
+        return id_iter != type_iter->second.end() ? id_iter->second : no_delegates;
+    };
+    auto add_routes = [&](RouteList& routes, const std::type_index& type, const std::string& id, bool generic) {
+        for(auto& delegate : find_delegates(type, id)) {
+            routes.push_back({delegate.get(), generic});
+        }
+    };
 
-    // Dispatch to base message listeners
-    assert(typeid(BaseMessage) != typeid(*inst));
-    for(auto& delegate : delegates_[typeid(BaseMessage)][id]) {
-        if(check_send(message.get(), delegate.get())) {
-            LOG(TRACE) << "Sending message " << allpix::demangle(type_idx.name()) << " from " << source->getUniqueName()
-                       << " to generic listener " << delegate->getUniqueName();
-            delegate->process(message, name);
-            send = true;
+    // Split the routes into the common routes and the routes of every detector with listeners bound to it
+    auto resolve_detectors = [](const RouteList& routes) {
+        DetectorRoutes resolved;
+        for(auto& route : routes) {
+            const auto& detectors = route.delegate->getDetectors();
+            if(detectors.empty()) {
+                resolved.common.push_back(route);
+            }
+            for(auto& detector : detectors) {
+                resolved.detectors.emplace(detector.get(), RouteList());
+            }
+        }
+        for(auto& detector_routes : resolved.detectors) {
+            for(auto& route : routes) {
+                const auto& detectors = route.delegate->getDetectors();
+                if(detectors.empty() || std::any_of(detectors.begin(), detectors.end(), [&](const auto& detector) {
+                       return detector->getName() == detector_routes.first->getName();
+                   })) {
+                    detector_routes.second.push_back(route);
+                }
+            }
+        }
+        return resolved;
+    };
+
+    const std::type_index base_idx = typeid(BaseMessage);
+    auto build_type_routes = [&](const std::type_index& type) {
+        RoutingTable::TypeRoutes type_routes;
+
+        // Collect all names listened to for this type, either directly or through the base message
+        std::vector<std::string> names;
+        for(auto type_idx : {type, base_idx}) {
+            auto type_iter = delegates_.find(type_idx);
+            if(type_iter == delegates_.end()) {
+                continue;
+            }
+            for(auto& id : type_iter->second) {
+                if(id.first != "*" && !id.second.empty()) {
+                    names.push_back(id.first);
+                }
+            }
+        }
+
+        // Routes without specific listeners only contain the listeners ignoring the name
+        RouteList unnamed;
+        add_routes(unnamed, type, "*", false);
+        add_routes(unnamed, base_idx, "*", true);
+        for(auto& name : names) {
+            if(type_routes.named.find(name) != type_routes.named.end()) {
+                continue;
+            }
+            RouteList routes;
+            add_routes(routes, type, name, false);
+            add_routes(routes, base_idx, name, true);
+            routes.insert(routes.end(), unnamed.begin(), unnamed.end());
+            type_routes.named.emplace(name, resolve_detectors(routes));
+        }
+        type_routes.unnamed = resolve_detectors(unnamed);
+        return type_routes;
+    };
+
+    auto table = std::make_unique<RoutingTable>();
+    for(auto& type : delegates_) {
+        if(type.first != base_idx) {
+            table->types.emplace(type.first, build_type_routes(type.first));
         }
     }
+    // Types without own listeners use the same lookup with an unused type
+    table->base = build_type_routes(typeid(void));
+    return table;
+}
 
-    return send;
+void Messenger::invalidate_routing_table() {
+    routing_table_.store(nullptr, std::memory_order_release);
+    routing_table_storage_.reset();
 }
 
 void Messenger::add_delegate(const std::type_info& message_type, Module* module, std::unique_ptr<BaseDelegate> delegate) {
@@ -160,6 +250,7 @@ void Messenger::add_delegate(const std::type_info& message_type, Module* module,
     }
 
     // Register delegate internally
+    invalidate_routing_table();
     delegates_[std::type_index(message_type)][message_name].push_back(std::move(delegate));
     auto delegate_iter = --delegates_[std::type_index(message_type)][message_name].end();
     delegate_to_iterator_.emplace(delegate_iter->get(),
@@ -179,6 +270,7 @@ void Messenger::remove_delegate(BaseDelegate* delegate) {
     if(iter == delegate_to_iterator_.end()) {
         throw std::out_of_range("delegate not found in listeners");
     }
+    invalidate_routing_table();
     delegates_[std::get<0>(iter->second)][std::get<1>(iter->second)].erase(std::get<2>(iter->second));
     delegate_to_iterator_.erase(iter);
 }
@@ -11,13 +11,18 @@
 #ifndef ALLPIX_MESSENGER_H
 #define ALLPIX_MESSENGER_H
 
+#include <atomic>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <typeindex>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "Message.hpp"
+#include "core/module/Event.hpp"
 #include "core/module/Module.hpp"
 #include "delegates.h"
 
@@ -29,6 +34,14 @@ namespace allpix {
      *
      * Dispatches messages from modules to other listening modules. There are various way to receive the messages using
      * \ref Delegates. Messages are only send to modules listening to the exact same type of message.
+     *
+     * Dispatched messages are stored in the \ref Event they belong to. Before a module is run for an event, the messages
+     * for its delegates are forwarded from the event to the module. Modules supporting parallelization bind to messages
+     * without a member variable and fetch them from the event instead, to allow processing multiple events concurrently.
+     *
+     * Delegates are only expected to be added and removed while modules are constructed or destroyed. On the first dispatch
+     * the registered delegates are frozen into a read-only routing table, such that dispatching messages from concurrently
+     * running modules does not require any locking.
      */
     class Messenger {
         friend class Module;
@@ -100,6 +113,40 @@ namespace allpix {
         template <typename T, typename R>
         void bindMulti(T* receiver, std::vector<std::shared_ptr<R>> T::*member, MsgFlags flags = MsgFlags::NONE);
 
+        /**
+         * @brief Binds to a single message kept in the event, to be retrieved with \ref Messenger::fetchMessage
+         * @param receiver Receiving module
+         * @param flags Message configuration flags
+         * @note This binding should be used by all modules that support parallelization
+         */
+        template <typename R, typename T> void bindSingle(T* receiver, MsgFlags flags = MsgFlags::NONE);
+
+        /**
+         * @brief Binds to a list of messages kept in the event, to be retrieved with \ref Messenger::fetchMultiMessage
+         * @param receiver Receiving module
+         * @param flags Message configuration flags
+         * @note This binding should be used by all modules that support parallelization
+         */
+        template <typename R, typename T> void bindMulti(T* receiver, MsgFlags flags = MsgFlags::NONE);
+
+        /**
+         * @brief Fetch the single message of a given type received by a module in an event
+         * @param module Receiving module
+         * @param event Event to fetch the message from
+         * @return Received message or a null pointer if no message of this type has been received
+         * @throws UnexpectedMessageException If more than one message of the type has been received (not thrown if the
+         *         \ref MsgFlags::ALLOW_OVERWRITE "ALLOW_OVERWRITE" flag is passed, returning the last message instead)
+         */
+        template <typename R> std::shared_ptr<R> fetchMessage(Module* module, Event* event);
+
+        /**
+         * @brief Fetch all messages of a given type received by a module in an event
+         * @param module Receiving module
+         * @param event Event to fetch the messages from
+         * @return List of received messages (empty if no message of this type has been received)
+         */
+        template <typename R> std::vector<std::shared_ptr<R>> fetchMultiMessage(Module* module, Event* event);
+
         /**
          * @brief Check if a specific message has a receiver
          * @param source Module that will send the message
@@ -119,9 +166,16 @@ namespace allpix {
         void dispatchMessage(Module* source, std::shared_ptr<T> message, const std::string& name = "-");
 
         /**
-         * @brief Removes the list of sent messages, clearing them from memory if not otherwise used
+         * @brief Dispatches a message in a given event
+         * @param source Module dispatching the message
+         * @param message Pointer to the message to dispatch
+         * @param event Event the message belongs to
+         * @param name Optional message name (defaults to - indicating that it should dispatch to the module output
+         * parameter)
+         * @note Modules supporting parallelization should always pass the event they are processing explicitly
          */
-        inline void clearMessages() { sent_messages_.clear(); }
+        template <typename T>
+        void dispatchMessage(Module* source, std::shared_ptr<T> message, Event* event, const std::string& name = "-");
 
     private:
         /**
@@ -144,20 +198,88 @@ namespace allpix {
          * @param source Dispatching module
          * @param message Message to dispatch
          * @param name Message name (- indicates to use module output parameter)
+         * @param event Event to store the message in
          */
-        void dispatch_message(Module* source, const std::shared_ptr<BaseMessage>& message, std::string name);
+        void dispatch_message(Module* source,
+                              const std::shared_ptr<BaseMessage>& message,
+                              const std::string& name,
+                              Event* event);
 
         /**
-         * @brief Dispatch base message to the exact delegates
-         * @param source Dispatching module
-         * @param message Message to dispatch
-         * @param name Name of the message
-         * @param id Identifier to dispatch to (either the name or '*' to dispatch to all)
+         * @brief Delegate a message is routed to, together with the information if it listens to the base message
          */
-        bool dispatch_message(Module* source,
-                              const std::shared_ptr<BaseMessage>& message,
-                              const std::string& name,
-                              const std::string& id);
+        struct Route {
+            BaseDelegate* delegate;
+            bool generic;
+        };
+        using RouteList = std::vector<Route>;
+
+        /**
+         * @brief Routes of a message type and name, resolved for every detector with listeners bound to it
+         */
+        struct DetectorRoutes {
+            // Routes of messages without a detector or bound to a detector without own listeners
+            RouteList common;
+            // Routes of messages bound to a detector with own listeners, including the common routes
+            std::unordered_map<const Detector*, RouteList> detectors;
+
+            /**
+             * @brief Get the routes of a message depending on the detector it is bound to
+             * @param message Message to route
+             * @return List of routes the message should be sent to
+             */
+            const RouteList& get(const BaseMessage* message) const;
+        };
+
+        /**
+         * @brief Read-only routing table derived from the registered delegates
+         *
+         * Every route list contains the specific listeners, the base message listeners for the name, the listeners ignoring
+         * the name and the base message listeners ignoring the name, in the order the messages are dispatched to them. The
+         * listeners bound to a detector are only contained in the route lists of this detector.
+         */
+        struct RoutingTable {
+            struct TypeRoutes {
+                std::map<std::string, DetectorRoutes> named;
+                DetectorRoutes unnamed;
+
+                const DetectorRoutes& get(const std::string& name) const {
+                    if(named.empty()) {
+                        return unnamed;
+                    }
+                    auto iter = named.find(name);
+                    return iter != named.end() ? iter->second : unnamed;
+                }
+            };
+
+            // Routes for every message type with own listeners and fallback routes for all other types
+            std::unordered_map<std::type_index, TypeRoutes> types;
+            TypeRoutes base;
+
+            const TypeRoutes& get(const std::type_index& type) const {
+                auto iter = types.find(type);
+                return iter != types.end() ? iter->second : base;
+            }
+        };
+
+        /**
+         * @brief Get the routing table, building it from the registered delegates if it does not exist yet
+         * @return Pointer to the current routing table
+         */
+        const RoutingTable* get_routing_table();
+
+        /**
+         * @brief Build the routing table from the registered delegates
+         * @return Newly constructed routing table
+         * @warning Should only be called while holding the mutex
+         */
+        std::unique_ptr<RoutingTable> build_routing_table() const;
+
+        /**
+         * @brief Discard the current routing table after the registered delegates changed
+         * @warning Should only be called while holding the mutex
+         */
+        void invalidate_routing_table();
 
         using DelegateMap = std::map<std::type_index, std::map<std::string, std::list<std::unique_ptr<BaseDelegate>>>>;
         using DelegateIteratorMap =
@@ -166,7 +288,10 @@ namespace allpix {
 
         DelegateMap delegates_;
         DelegateIteratorMap delegate_to_iterator_;
-        std::vector<std::shared_ptr<BaseMessage>> sent_messages_;
+
+        // Routing table used for dispatching, only replaced while the delegates change
+        std::unique_ptr<RoutingTable> routing_table_storage_;
+        std::atomic<const RoutingTable*> routing_table_{nullptr};
 
         mutable std::mutex mutex_;
     };
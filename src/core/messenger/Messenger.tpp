@@ -9,10 +9,20 @@
  */
 
 namespace allpix {
+    /**
+     * The message is stored in the event currently processed by the dispatching module. This is only unambiguous for
+     * modules that do not support parallelization, all other modules should pass their event explicitly.
+     */
     template <typename T>
     void Messenger::dispatchMessage(Module* source, std::shared_ptr<T> message, const std::string& name) {
         static_assert(std::is_base_of<BaseMessage, T>::value, "Dispatched message should inherit from Message class");
-        dispatch_message(source, std::static_pointer_cast<BaseMessage>(message), name);
+        dispatch_message(source, std::static_pointer_cast<BaseMessage>(message), name, source->current_event_);
+    }
+
+    template <typename T>
+    void Messenger::dispatchMessage(Module* source, std::shared_ptr<T> message, Event* event, const std::string& name) {
+        static_assert(std::is_base_of<BaseMessage, T>::value, "Dispatched message should inherit from Message class");
+        dispatch_message(source, std::static_pointer_cast<BaseMessage>(message), name, event);
     }
 
     template <typename T>
@@ -55,4 +65,66 @@ namespace allpix {
         auto delegate = std::make_unique<VectorBindDelegate<T, R>>(flags, receiver, member);
         add_delegate(typeid(R), receiver, std::move(delegate));
     }
+
+    template <typename R, typename T> void Messenger::bindSingle(T* receiver, MsgFlags flags) {
+        static_assert(std::is_base_of<Module, T>::value, "Receiver should have Module as a base class");
+        static_assert(std::is_base_of<BaseMessage, R>::value, "Bound message should be derived from the Message class");
+
+        auto delegate = std::make_unique<EventDelegate<T>>(flags, receiver);
+        add_delegate(typeid(R), receiver, std::move(delegate));
+    }
+
+    template <typename R, typename T> void Messenger::bindMulti(T* receiver, MsgFlags flags) {
+        static_assert(std::is_base_of<Module, T>::value, "Receiver should have Module as a base class");
+        static_assert(std::is_base_of<BaseMessage, R>::value, "Bound messages should be derived from the Message class");
+
+        auto delegate = std::make_unique<EventDelegate<T>>(flags, receiver);
+        add_delegate(typeid(R), receiver, std::move(delegate));
+    }
+
+    /**
+     * Only messages of the exact requested type are returned, messages received by generic listeners of the module are
+     * ignored if they are of another type.
+     */
+    template <typename R> std::shared_ptr<R> Messenger::fetchMessage(Module* module, Event* event) {
+        static_assert(std::is_base_of<BaseMessage, R>::value, "Fetched message should be derived from the Message class");
+
+        std::shared_ptr<R> message;
+        for(auto& delegate : module->delegates_) {
+            if(delegate.first != this) {
+                continue;
+            }
+            for(auto& stored_message : event->get_messages(delegate.second)) {
+                const BaseMessage* inst = stored_message.first.get();
+                if(typeid(*inst) != typeid(R)) {
+                    continue;
+                }
+
+                // Raise an error if the message is overwritten (unless it is allowed)
+                if(message != nullptr && (delegate.second->getFlags() & MsgFlags::ALLOW_OVERWRITE) == MsgFlags::NONE) {
+                    throw UnexpectedMessageException(module->getUniqueName(), typeid(R));
+                }
+                message = std::static_pointer_cast<R>(stored_message.first);
+            }
+        }
+        return message;
+    }
+
+    template <typename R> std::vector<std::shared_ptr<R>> Messenger::fetchMultiMessage(Module* module, Event* event) {
+        static_assert(std::is_base_of<BaseMessage, R>::value, "Fetched messages should be derived from the Message class");
+
+        std::vector<std::shared_ptr<R>> messages;
+        for(auto& delegate : module->delegates_) {
+            if(delegate.first != this) {
+                continue;
+            }
+            for(auto& stored_message : event->get_messages(delegate.second)) {
+                const BaseMessage* inst = stored_message.first.get();
+                if(typeid(*inst) == typeid(R)) {
+                    messages.push_back(std::static_pointer_cast<R>(stored_message.first));
+                }
+            }
+        }
+        return messages;
+    }
 } // namespace allpix
@@ -19,6 +19,7 @@
 #include <cassert>
 #include <memory>
 #include <typeinfo>
+#include <vector>
 
 #include "Message.hpp"
 #include "core/geometry/Detector.hpp"
@@ -119,10 +120,10 @@ namespace allpix {
         MsgFlags getFlags() const { return flags_; }
 
         /**
-         * @brief Get the detector bound to a delegate
-         * @return Linked detector
+         * @brief Get the detectors bound to a delegate
+         * @return Linked detectors, empty if the delegate accepts messages of all detectors
          */
-        virtual std::shared_ptr<Detector> getDetector() const = 0;
+        virtual const std::vector<std::shared_ptr<Detector>>& getDetectors() const = 0;
 
         /**
          * @brief Get the unique identifier for the bound object
@@ -137,6 +138,15 @@ namespace allpix {
          */
         virtual void process(std::shared_ptr<BaseMessage> msg, std::string name) = 0;
 
+        /**
+         * @brief Check if the messages for this delegate are only kept in the event
+         * @return True if the messages are only stored in the event, false if they are forwarded to the module
+         *
+         * Messages for event-local delegates are never processed by the delegate itself, but fetched by the module from the
+         * event. This allows modules to process multiple events at the same time.
+         */
+        virtual bool isEventLocal() const { return false; }
+
         /**
          * @brief Reset the delegate and set it not satisfied again
          */
@@ -175,11 +185,12 @@ namespace allpix {
         std::string getUniqueName() override { return obj_->getUniqueName(); }
 
         /**
-         * @brief Get the detector bound to this module
+         * @brief Get the detectors bound to this module
          *
-         * Returns the bound detector for detector modules and a null pointer for unique modules
+         * Returns the bound detector for detector modules, all bound detectors for multi-detector modules and an empty list
+         * for unique modules
          */
-        std::shared_ptr<Detector> getDetector() const override { return obj_->getDetector(); }
+        const std::vector<std::shared_ptr<Detector>>& getDetectors() const override { return obj_->getDetectors(); }
 
     protected:
         T* obj_;
@@ -224,6 +235,37 @@ namespace allpix {
         std::vector<std::shared_ptr<BaseMessage>> messages_;
     };
 
+    /**
+     * @ingroup Delegates
+     * @brief Delegate keeping the messages in the event, to be fetched by the module while processing that event
+     *
+     * The delegate does not write to the module itself, such that the module can safely run multiple events at the same
+     * time. Messages are retrieved using \ref Messenger::fetchMessage or \ref Messenger::fetchMultiMessage.
+     */
+    template <typename T> class EventDelegate : public ModuleDelegate<T> {
+    public:
+        /**
+         * @brief Construct an event delegate for the given module
+         * @param flags Messenger flags
+         * @param obj Module object this delegate should operate on
+         */
+        EventDelegate(MsgFlags flags, T* obj) : ModuleDelegate<T>(flags, obj) {}
+
+        /**
+         * @brief Messages of this delegate are always stored in the event
+         * @return Always true
+         */
+        bool isEventLocal() const override { return true; }
+
+        /**
+         * @brief Messages are never processed by this delegate, as they are only stored in the event
+         */
+        void process(std::shared_ptr<BaseMessage>, std::string) override {
+            // The messenger should never forward messages to an event-local delegate
+            assert(false);
+        }
+    };
+
     /**
      * @ingroup Delegates
      * @brief Delegate for invoking a function in the module
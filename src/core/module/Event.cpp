@@ -0,0 +1,79 @@
+/**
+ * @file
+ * @brief Implementation of the event
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "Event.hpp"
+
+using namespace allpix;
+
+thread_local std::mt19937_64* Event::module_random_engine_{nullptr};
+thread_local uint64_t Event::dispatched_bytes_{0};
+std::atomic<uint64_t> Event::buffered_message_bytes_{0};
+
+Event::Event(unsigned int number, uint64_t seed) : number_(number), seed_(seed) {
+    std::seed_seq seed_seq({seed});
+    random_engine_.seed(seed_seq);
+}
+
+void Event::store_message(const BaseDelegate* delegate,
+                          const std::shared_ptr<BaseMessage>& message,
+                          const std::string& name) {
+    std::lock_guard<std::mutex> lock(messages_mutex_);
+    delegate_messages_[delegate].emplace_back(message, name);
+}
+
+/**
+ * A reference to a static empty list is returned if no messages are stored for the delegate, to avoid inserting entries. The
+ * returned list is not modified anymore, as all modules dispatching to the delegate have finished before it is fetched.
+ */
+const Event::MessageList& Event::get_messages(const BaseDelegate* delegate) const {
+    static const MessageList empty_list;
+    std::lock_guard<std::mutex> lock(messages_mutex_);
+    auto iter = delegate_messages_.find(delegate);
+    if(iter == delegate_messages_.end()) {
+        return empty_list;
+    }
+    return iter->second;
+}
+
+void Event::keep_message(const std::shared_ptr<BaseMessage>& message) {
+    if(release_early_) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(messages_mutex_);
+    sent_messages_.emplace_back(message);
+}
+
+/**
+ * Erasing the list of one delegate does not invalidate the lists of other delegates, which may be fetched at the same time.
+ */
+void Event::release_messages(const BaseDelegate* delegate) {
+    MessageList messages;
+    {
+        std::lock_guard<std::mutex> lock(messages_mutex_);
+        auto iter = delegate_messages_.find(delegate);
+        if(iter == delegate_messages_.end()) {
+            return;
+        }
+        messages = std::move(iter->second);
+        delegate_messages_.erase(iter);
+    }
+    // Messages without other consumers are destructed here, outside of the lock
+}
+
+void Event::add_message_bytes(uint64_t bytes) {
+    message_bytes_ += bytes;
+    buffered_message_bytes_ += bytes;
+}
+
+uint64_t Event::release_message_bytes() {
+    auto bytes = message_bytes_.exchange(0);
+    buffered_message_bytes_ -= bytes;
+    return bytes;
+}
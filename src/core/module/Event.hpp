@@ -0,0 +1,166 @@
+/**
+ * @file
+ * @brief Definition of the event holding all state of a single event
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_EVENT_H
+#define ALLPIX_EVENT_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace allpix {
+    class BaseDelegate;
+    class BaseMessage;
+
+    /**
+     * @brief State of a single event processed by the framework
+     *
+     * Every event owns its own random engine and its own storage of the messages dispatched during the event. This allows
+     * the \ref ModuleManager to process multiple events at the same time, because no information of an event is kept in the
+     * \ref Messenger or in the delegates. The storage of the messages is protected by a mutex, as multiple modules can run
+     * for the same event at the same time when the dataflow scheduling of the \ref ModuleManager is enabled.
+     */
+    class Event {
+        friend class ModuleManager;
+        friend class Messenger;
+        friend class Module;
+
+    public:
+        /**
+         * @brief Construct an event
+         * @param number Number of the event in the event sequence (starts at 1)
+         * @param seed Seed for the random engine of this event
+         */
+        Event(unsigned int number, uint64_t seed);
+
+        /// @{
+        /**
+         * @brief Copying an event is not allowed
+         */
+        Event(const Event&) = delete;
+        Event& operator=(const Event&) = delete;
+        /// @}
+
+        /// @{
+        /**
+         * @brief Disallow move behaviour (the messages refer to the delegates of this event)
+         */
+        Event(Event&&) = delete;
+        Event& operator=(Event&&) = delete;
+        /// @}
+
+        /**
+         * @brief Use default destructor (releases all messages dispatched during this event)
+         */
+        ~Event() = default;
+
+        /**
+         * @brief Get the number of this event
+         * @return Number of the event in the event sequence (starts at 1)
+         */
+        unsigned int getNumber() const { return number_; }
+
+        /**
+         * @brief Get the random engine of this event
+         * @return Reference to the random engine seeded for this event
+         *
+         * With the dataflow scheduling of the \ref ModuleManager every module instantiation receives its own engine for the
+         * event, as multiple modules can run for the same event at the same time.
+         * @note This engine should be used by all modules that support parallelization to ensure reproducible results
+         *       independent of the number of workers
+         */
+        std::mt19937_64& getRandomEngine() {
+            return module_random_engine_ != nullptr ? *module_random_engine_ : random_engine_;
+        }
+
+        /**
+         * @brief Get the next number from the random engine of this event
+         * @return Random number
+         */
+        uint64_t getRandomNumber() { return getRandomEngine()(); }
+
+    private:
+        using MessageList = std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>>;
+
+        /**
+         * @brief Store a message dispatched in this event for a delegate
+         * @param delegate Delegate the message is meant for
+         * @param message Message to store
+         * @param name Name of the message
+         */
+        void
+        store_message(const BaseDelegate* delegate, const std::shared_ptr<BaseMessage>& message, const std::string& name);
+
+        /**
+         * @brief Get all messages stored in this event for a delegate
+         * @param delegate Delegate to fetch the messages for
+         * @return List of messages and their names (empty if no message has been received)
+         */
+        const MessageList& get_messages(const BaseDelegate* delegate) const;
+
+        /**
+         * @brief Keep a message dispatched in this event alive until the end of the event
+         * @param message Message to keep
+         * @note Messages are not kept if they are released early, see \ref release_messages
+         */
+        void keep_message(const std::shared_ptr<BaseMessage>& message);
+
+        /**
+         * @brief Release all messages stored in this event for a delegate
+         * @param delegate Delegate whose module has finished this event
+         *
+         * If messages are released early, the lists of the delegates hold the only references of the event to a message,
+         * such that the number of lists containing a message is the number of its consumers that have not run yet. The
+         * message is freed as soon as the last of these consumers has finished.
+         */
+        void release_messages(const BaseDelegate* delegate);
+
+        /**
+         * @brief Account the memory of a message dispatched in this event
+         * @param bytes Memory of the message in bytes
+         */
+        void add_message_bytes(uint64_t bytes);
+
+        /**
+         * @brief Remove the memory of all messages of this event from the memory of all buffered events
+         * @return Memory of the messages dispatched in this event in bytes
+         * @note Should be called once when the event is finished
+         */
+        uint64_t release_message_bytes();
+
+        unsigned int number_;
+        uint64_t seed_;
+        // Set if a module rejected this event, all following modules are skipped
+        std::atomic<bool> aborted_{false};
+        std::mt19937_64 random_engine_;
+        // Engine of the module instantiation executed by this thread, replacing the engine of the event if set
+        static thread_local std::mt19937_64* module_random_engine_;
+        // Bytes of the messages dispatched by the module instantiation executed by this thread
+        static thread_local uint64_t dispatched_bytes_;
+        // Bytes of the messages dispatched in this event and in all events that are not finished yet
+        std::atomic<uint64_t> message_bytes_{0};
+        static std::atomic<uint64_t> buffered_message_bytes_;
+        // Time spent by all module instantiations in this event, in nanoseconds
+        std::atomic<uint64_t> module_time_ns_{0};
+
+        std::map<const BaseDelegate*, MessageList> delegate_messages_;
+        std::vector<std::shared_ptr<BaseMessage>> sent_messages_;
+        // Release the messages after their last consumer has run instead of keeping them until the end of the event
+        bool release_early_{};
+        mutable std::mutex messages_mutex_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_EVENT_H */
@@ -24,7 +24,15 @@ using namespace allpix;
 
 Module::Module(Configuration& config) : Module(config, nullptr) {}
 Module::Module(Configuration& config, std::shared_ptr<Detector> detector)
-    : config_(config), detector_(std::move(detector)) {}
+    : config_(config), random_stream_key_(config.get<uint64_t>("_seed", 0)), detector_(std::move(detector)),
+      output_name_(config.get<std::string>("output", "")) {
+    if(detector_ != nullptr) {
+        detectors_.push_back(detector_);
+    }
+}
+Module::Module(Configuration& config, std::vector<std::shared_ptr<Detector>> detectors)
+    : config_(config), random_stream_key_(config.get<uint64_t>("_seed", 0)), detectors_(std::move(detectors)),
+      output_name_(config.get<std::string>("output", "")) {}
 /**
  * @note The remove_delegate can throw in theory, but this should never happen in practice
  */
@@ -60,6 +68,13 @@ std::shared_ptr<Detector> Module::getDetector() const {
     return detector_;
 }
 
+/**
+ * Multi-detector modules are linked to all their detectors but do not have a single linked detector
+ */
+const std::vector<std::shared_ptr<Detector>>& Module::getDetectors() const {
+    return detectors_;
+}
+
 /**
  * @throws ModuleError If the file cannot be accessed (or created if it did not yet exist)
  * @throws InvalidModuleActionException If this method is called from the constructor with the global flag false
@@ -118,6 +133,8 @@ std::string Module::createOutputFile(const std::string& path, bool global, bool
     if(delete_file) {
         allpix::remove_file(file);
     }
+    std::lock_guard<std::mutex> lock(output_files_mutex_);
+    output_files_.insert(file);
     return file;
 }
 
@@ -137,6 +154,14 @@ uint64_t Module::getRandomSeed() {
     return random_generator_();
 }
 
+/**
+ * The engine is derived from the seed of the event, which only depends on the global seed and the event number, and from
+ * the seed of this module instantiation. Every index yields an independent stream of random numbers.
+ */
+CounterRandomEngine Module::getRandomStream(Event* event, uint64_t index) const {
+    return CounterRandomEngine(event->seed_, random_stream_key_).split(index);
+}
+
 /**
  * @throws InvalidModuleActionException If the thread pool is accessed outside the run-method
  * @warning Any multithreaded task should be carefully checked to ensure it is thread-safe
@@ -195,6 +220,24 @@ void Module::enable_parallelization() {
     parallelize_ = true;
 }
 
+bool Module::canInitializeInParallel() {
+    return parallel_initialization_;
+}
+void Module::enable_parallel_initialization() {
+    parallel_initialization_ = true;
+}
+
+bool Module::canFinalizeInParallel() {
+    return parallel_finalization_;
+}
+void Module::enable_parallel_finalization() {
+    parallel_finalization_ = true;
+}
+
+StatisticsCounter& Module::get_counter(const std::string& name) {
+    return statistics_.getCounter(name);
+}
+
 Configuration& Module::get_configuration() {
     return config_;
 }
@@ -209,16 +252,36 @@ ModuleIdentifier Module::get_identifier() const {
 void Module::add_delegate(Messenger* messenger, BaseDelegate* delegate) {
     delegates_.emplace_back(messenger, delegate);
 }
+void Module::forward_messages(Event* event) {
+    for(auto& delegate : delegates_) {
+        if(delegate.second->isEventLocal()) {
+            continue;
+        }
+        for(auto& message : event->get_messages(delegate.second)) {
+            delegate.second->process(message.first, message.second);
+        }
+    }
+}
 void Module::reset_delegates() {
     for(auto& delegate : delegates_) {
-        delegate.first->clearMessages();
-        delegate.second->reset();
+        if(!delegate.second->isEventLocal()) {
+            delegate.second->reset();
+        }
     }
 }
-bool Module::check_delegates() {
+void Module::release_messages(Event* event) {
+    for(auto& delegate : delegates_) {
+        event->release_messages(delegate.second);
+    }
+}
+/**
+ * A delegate is satisfied if it is not required or if the event holds at least one message for it
+ */
+bool Module::check_delegates(Event* event) {
     for(auto& delegate : delegates_) {
         // Return false if any delegate is not satisfied
-        if(!delegate.second->isSatisfied()) {
+        if((delegate.second->getFlags() & MsgFlags::REQUIRED) != MsgFlags::NONE &&
+           event->get_messages(delegate.second).empty()) {
             return false;
         }
     }
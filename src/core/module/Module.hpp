@@ -10,19 +10,26 @@
 #ifndef ALLPIX_MODULE_H
 #define ALLPIX_MODULE_H
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <random>
+#include <set>
 #include <string>
 #include <vector>
 
 #include <TDirectory.h>
 
+#include "Event.hpp"
 #include "ModuleIdentifier.hpp"
+#include "Statistics.hpp"
 #include "ThreadPool.hpp"
 #include "core/config/ConfigManager.hpp"
 #include "core/config/Configuration.hpp"
 #include "core/geometry/Detector.hpp"
 #include "core/messenger/delegates.h"
+#include "core/utils/log.h"
+#include "core/utils/prng.h"
 #include "exceptions.h"
 
 namespace allpix {
@@ -37,7 +44,7 @@ namespace allpix {
      * The module base is the core of the modular framework. All modules should be descendants of this class. The base class
      * defines the methods the children can implement:
      * - Module::init(): for initializing the module at the start
-     * - Module::run(unsigned int): for doing the job of every module for every event
+     * - Module::run(Event*): for doing the job of every module for every event
      * - Module::finalize(): for finalizing the module at the end
      *
      * The module class also provides a few utility methods and stores internal data of instantations. The internal data is
@@ -61,6 +68,18 @@ namespace allpix {
          *          \ref InvalidModuleStateException will be raised if the module failed to so.
          */
         explicit Module(Configuration& config, std::shared_ptr<Detector> detector);
+        /**
+         * @brief Base constructor for multi-detector modules
+         * @param config Configuration for this module
+         * @param detectors Detectors bound to this single instantiation
+         * @warning Multi-detector modules should not forget to forward their detectors to the base constructor. An
+         *          \ref InvalidModuleStateException will be raised if the module failed to so.
+         *
+         * Detector modules can optionally provide a constructor taking the list of detectors instead of a single detector.
+         * If the module is configured with the multi_detector parameter, a single instantiation is then created for all
+         * detectors it is bound to, which receives the messages of all of them.
+         */
+        explicit Module(Configuration& config, std::vector<std::shared_ptr<Detector>> detectors);
         /**
          * @brief Essential virtual destructor.
          *
@@ -90,6 +109,13 @@ namespace allpix {
          */
         std::shared_ptr<Detector> getDetector() const;
 
+        /**
+         * @brief Get all detectors linked to this module
+         * @return The linked detector of a detector module, all detectors of a multi-detector module and an empty list for
+         *         unique modules
+         */
+        const std::vector<std::shared_ptr<Detector>>& getDetectors() const;
+
         /**
          * @brief Get the unique name of this module
          * @return Unique name
@@ -112,6 +138,17 @@ namespace allpix {
          */
         uint64_t getRandomSeed();
 
+        /**
+         * @brief Get a counter-based random engine for an independent unit of work in an event
+         * @param event Event the random numbers are drawn for
+         * @param index Index of the unit of work in the event, for example the index of a deposit
+         * @return Random engine keyed by the seed of the event, this module instantiation and the index
+         *
+         * Contrary to the random engine of the event, the random numbers do not depend on the order in which the units of
+         * work are processed. This allows to split the work of a single event over multiple threads with identical results.
+         */
+        CounterRandomEngine getRandomStream(Event* event, uint64_t index) const;
+
         /**
          * @brief Get thread pool to submit asynchronous tasks to
          */
@@ -132,9 +169,31 @@ namespace allpix {
         /**
          * @brief Returns if parallelization of this module is enabled
          * @return True if parallelization is enabled, false otherwise (the default)
+         *
+         * Modules with parallelization enabled can be run for multiple events at the same time. All other modules are run
+         * for one event at the time, in the order of the event sequence.
          */
         bool canParallelize();
 
+        /**
+         * @brief Returns if the initialization of this module can run in parallel to other modules
+         * @return True if parallel initialization is enabled, false otherwise (the default)
+         *
+         * If parallel initialization is requested, consecutive modules with parallel initialization enabled are initialized
+         * at the same time. All other modules are initialized on their own, in the order of the configuration.
+         */
+        bool canInitializeInParallel();
+
+        /**
+         * @brief Returns if the finalization of this module can run in parallel to other modules
+         * @return True if parallel finalization is enabled, false otherwise (the default)
+         *
+         * If parallel finalization is requested, consecutive modules with parallel finalization enabled are finalized at the
+         * same time and write their ROOT objects to a dedicated file. All other modules are finalized on their own, in the
+         * order of the configuration.
+         */
+        bool canFinalizeInParallel();
+
         /**
          * @brief Initialize the module before the event sequence
          *
@@ -150,7 +209,32 @@ namespace allpix {
          */
         // TODO [doc] Start the sequence at 0 instead of 1?
         virtual void run(unsigned int event_num) { (void)event_num; }
-        //
+
+        /**
+         * @brief Execute the function of the module for a given event
+         * @param event Event to process, holding the received messages and the random engine of this event
+         *
+         * Calls \ref run(unsigned int) with the event number if not overloaded. Modules supporting parallelization should
+         * overload this method and only use the event to fetch and dispatch messages and to generate random numbers.
+         */
+        virtual void run(Event* event) { run(event->getNumber()); }
+
+        /**
+         * @brief Execute the function of the module for a batch of events at once
+         * @param events Events to process, ordered by their event number
+         *
+         * Only called for modules with parallelization enabled whose configuration sets `batch_events`. The framework
+         * collects the events in flight reaching the module and passes them at once, such that their data can be processed
+         * together, for example to fill wide vector units or accelerators. The messages of every event are fetched from and
+         * dispatched to that event as in \ref run(Event*), which is called for every event if not overloaded.
+         * @note Aborting the event from this method aborts all events of the batch
+         */
+        virtual void runBatch(const std::vector<Event*>& events) {
+            for(auto* event : events) {
+                run(event);
+            }
+        }
+
         /**
          * @brief Finalize the module after the event sequence
          * @note Useful to have before destruction to allow for raising exceptions
@@ -162,9 +246,38 @@ namespace allpix {
     protected:
         /**
          * @brief Enable parallelization for this module
+         *
+         * By enabling parallelization the module promises that its \ref run(Event*) method can be executed for multiple
+         * events at the same time. Only event-local message bindings should be used and all random numbers should be taken
+         * from the random engine of the event.
          */
         void enable_parallelization();
 
+        /**
+         * @brief Enable parallel initialization for this module
+         *
+         * By enabling parallel initialization the module promises that its \ref init() method does not depend on other
+         * modules with parallel initialization enabled and only modifies the state of the module and its detector.
+         */
+        void enable_parallel_initialization();
+
+        /**
+         * @brief Enable parallel finalization for this module
+         *
+         * By enabling parallel finalization the module promises that its \ref finalize() method only writes ROOT objects to
+         * its own ROOT directory and only modifies the state of the module, such that it can run at the same time as the
+         * finalization of other modules.
+         */
+        void enable_parallel_finalization();
+
+        /**
+         * @brief Get a named counter of this module, which is reported in the statistics file at the end of the run
+         * @param name Name of the counter
+         * @return Reference to the counter, which can be incremented directly or used with a \ref ScopedTimer
+         * @note The lookup of the counter is not free, the reference should be retrieved once and stored by the module
+         */
+        StatisticsCounter& get_counter(const std::string& name);
+
         /**
          * @brief Get the module configuration for internal use
          * @return Configuration of the module
@@ -212,22 +325,75 @@ namespace allpix {
          * @param delegate Delegate object
          */
         void add_delegate(Messenger* messenger, BaseDelegate* delegate);
+        /**
+         * @brief Forward the messages stored in the event to the delegates bound to the module
+         * @param event Event holding the messages
+         * @note Event-local delegates are skipped, as their messages are fetched directly from the event
+         */
+        void forward_messages(Event* event);
         /**
          * @brief Resets messenger delegates after every event
          */
         void reset_delegates();
         /**
-         * @brief Check if all delegates are satisfied
+         * @brief Release the messages stored in the event for the delegates bound to the module
+         * @param event Event holding the messages
          */
-        bool check_delegates();
+        void release_messages(Event* event);
+        /**
+         * @brief Check if all delegates are satisfied in an event
+         * @param event Event holding the messages
+         */
+        bool check_delegates(Event* event);
         std::vector<std::pair<Messenger*, BaseDelegate*>> delegates_;
 
+        // Event currently processed by this module (only set for modules without parallelization)
+        Event* current_event_{nullptr};
+
         bool initialized_random_generator_{false};
         std::mt19937_64 random_generator_;
+        uint64_t random_stream_key_;
 
         std::shared_ptr<Detector> detector_;
+        std::vector<std::shared_ptr<Detector>> detectors_;
 
         bool parallelize_{false};
+        bool parallel_initialization_{false};
+        bool parallel_finalization_{false};
+
+        // Performance statistics of this instantiation
+        ModuleStatistics statistics_;
+        StatisticsCounter& messages_dispatched_{statistics_.getCounter("messages_dispatched")};
+        StatisticsCounter& message_bytes_dispatched_{statistics_.getCounter("message_bytes_dispatched")};
+        StatisticsCounter& message_bytes_event_peak_{statistics_.getCounter("message_bytes_event_peak")};
+
+        // Name of the dispatched messages, cached to avoid configuration lookups while dispatching
+        std::string output_name_;
+
+        // Delegates receiving the messages dispatched by this module, only recorded until the module graph is analyzed
+        std::atomic<bool> record_receivers_{false};
+        bool dispatched_messages_{false};
+        std::set<const BaseDelegate*> message_receivers_;
+        std::mutex receivers_mutex_;
+
+        // Output files created by this instantiation, to determine the size of its output at the end of the run
+        std::set<std::string> output_files_;
+        std::mutex output_files_mutex_;
+
+        // Skip this instantiation for all following events, as none of its messages reaches any other module
+        std::atomic<bool> skipped_{false};
+
+        // Settings for running this instantiation in every event, prepared before the event loop to avoid lookups per event
+        struct Execution {
+            std::string section_name;
+            bool set_log_level{false};
+            LogLevel log_level{};
+            bool set_log_format{false};
+            LogFormat log_format{};
+            bool check_delegates{false};
+            bool reset_delegates{false};
+            unsigned int batch_events{1};
+        } execution_;
     };
 
 } // namespace allpix
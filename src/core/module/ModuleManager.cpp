@@ -11,28 +11,44 @@
 #include "ModuleManager.hpp"
 
 #include <dlfcn.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <future>
+#include <iomanip>
+#include <iterator>
 #include <limits>
 #include <random>
 #include <set>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
-#include <TProcessID.h>
 #include <TSystem.h>
 
 #include "core/config/ConfigManager.hpp"
+#include "core/config/ConfigReader.hpp"
 #include "core/config/Configuration.hpp"
 #include "core/config/exceptions.h"
 #include "core/geometry/GeometryManager.hpp"
 #include "core/messenger/Messenger.hpp"
+#include "core/module/StaticModules.hpp"
+#include "core/utils/allocations.h"
+#include "core/utils/annotation.h"
 #include "core/utils/file.h"
 #include "core/utils/log.h"
+#include "core/utils/numa.h"
+#include "core/utils/unit.h"
+#include "objects/Object.hpp"
 
 // Common prefix for all modules
 // TODO [doc] Should be provided by the build system
@@ -41,9 +57,84 @@
 // These should point to the function defined in dynamic_module_impl.cpp
 #define ALLPIX_GENERATOR_FUNCTION "allpix_module_generator"
 #define ALLPIX_UNIQUE_FUNCTION "allpix_module_is_unique"
+#define ALLPIX_MULTI_GENERATOR_FUNCTION "allpix_module_multi_generator"
 
 using namespace allpix;
 
+std::map<std::string, StaticModule>& allpix::static_modules() {
+    static std::map<std::string, StaticModule> modules;
+    return modules;
+}
+
+/**
+ * @brief Get an interface function of a module
+ * @param library Handle of the library of the module, or its entry in the registry of static modules in the monolithic build
+ * @param symbol Name of the interface function
+ * @return Pointer to the function, or a null pointer if it does not exist
+ */
+static void* get_module_function(void* library, const char* symbol) {
+#ifdef ALLPIX_MONOLITHIC
+    auto* module = static_cast<StaticModule*>(library);
+    if(std::strcmp(symbol, ALLPIX_GENERATOR_FUNCTION) == 0) {
+        return module->generator;
+    }
+    if(std::strcmp(symbol, ALLPIX_MULTI_GENERATOR_FUNCTION) == 0) {
+        return module->multi_generator;
+    }
+    return module->is_unique;
+#else
+    return dlsym(library, symbol);
+#endif
+}
+
+/**
+ * @brief Resident memory of the process from the number of pages in its status
+ * @return Resident memory in bytes, zero if not available
+ */
+static uint64_t resident_memory() {
+    std::ifstream statm("/proc/self/statm");
+    uint64_t total_pages = 0, resident_pages = 0;
+    if(statm >> total_pages >> resident_pages) {
+        return resident_pages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    }
+    return 0;
+}
+
+/**
+ * @brief Largest resident memory of the process since its start
+ * @return Peak resident memory in bytes, zero if not available
+ */
+static uint64_t peak_resident_memory() {
+    rusage usage{};
+    if(getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    // The peak is given in kilobytes on all other systems
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+/**
+ * @brief Format a number of bytes for display with a binary prefix
+ * @param bytes Number of bytes
+ * @return Number of bytes in the largest unit with a value of at least one
+ */
+static std::string bytes_to_size(uint64_t bytes) {
+    std::array<const char*, 5> units{{"B", "kiB", "MiB", "GiB", "TiB"}};
+    auto size = static_cast<double>(bytes);
+    size_t unit = 0;
+    while(size >= 1024 && unit + 1 < units.size()) {
+        size /= 1024;
+        ++unit;
+    }
+    std::ostringstream stream;
+    stream << std::setprecision(3) << size << units[unit];
+    return stream.str();
+}
+
 ModuleManager::ModuleManager() : terminate_(false) {}
 
 /**
@@ -77,12 +168,33 @@ void ModuleManager::load(Messenger* messenger,
     modules_file_->cd();
 
     // Loop through all non-global configurations
+    auto null_writers = global_config.get<bool>("benchmark_null_writers", false);
     for(auto& config : configs) {
+        // Writers are not loaded if they should be replaced by null sinks for a benchmark
+        auto name = config.getName();
+        if(null_writers && name.size() > 6 && name.compare(name.size() - 6, 6, "Writer") == 0) {
+            LOG(STATUS) << "Not loading writer module " << name << " for the benchmark";
+            continue;
+        }
+
         // Load library for each module. Libraries are named (by convention + CMAKE) libAllpixModule Name.suffix
         std::string lib_name = std::string(ALLPIX_MODULE_PREFIX).append(config.getName()).append(SHARED_LIBRARY_SUFFIX);
         LOG_PROGRESS(STATUS, "LOAD_LOOP") << "Loading module " << config.getName();
 
         void* lib = nullptr;
+        auto library_start = std::chrono::steady_clock::now();
+        bool library_loaded = (loaded_libraries_.count(lib_name) != 0);
+#ifdef ALLPIX_MONOLITHIC
+        // All modules are linked into the executable, no further libraries can be loaded
+        auto static_module = static_modules().find(config.getName());
+        if(static_module == static_modules().end()) {
+            LOG(ERROR) << "Module is not linked into this executable" << std::endl
+                       << " - Did you enable the module during building? " << std::endl
+                       << " - Did you spell the module name correctly (case-sensitive)? ";
+            throw allpix::DynamicLibraryError(config.getName());
+        }
+        lib = &static_module->second;
+#else
         bool load_error = false;
         dlerror();
         if(loaded_libraries_.count(lib_name) == 0) {
@@ -168,12 +280,19 @@ void ModuleManager::load(Messenger* messenger,
 
             throw allpix::DynamicLibraryError(config.getName());
         }
+#endif
         // Remember that this library was loaded
         loaded_libraries_[lib_name] = lib;
+        if(!library_loaded) {
+            startup_profile_.add(
+                StartupProfile::Category::LIBRARY,
+                lib_name,
+                static_cast<std::chrono::duration<long double>>(std::chrono::steady_clock::now() - library_start).count());
+        }
 
         // Check if this module is produced once, or once per detector
         bool unique = true;
-        void* uniqueFunction = dlsym(loaded_libraries_[lib_name], ALLPIX_UNIQUE_FUNCTION);
+        void* uniqueFunction = get_module_function(loaded_libraries_[lib_name], ALLPIX_UNIQUE_FUNCTION);
 
         // If the unique function was not found, throw an error
         if(uniqueFunction == nullptr) {
@@ -186,6 +305,7 @@ void ModuleManager::load(Messenger* messenger,
         // Add the global internal parameters to the configuration
         std::string global_dir = gSystem->pwd();
         config.set<std::string>("_global_dir", global_dir);
+        config.set<bool>("_multithreading", global_config.get<bool>("experimental_multithreading", false));
 
         // Set default input and output name
         config.setDefault<std::string>("input", "");
@@ -237,6 +357,9 @@ void ModuleManager::load(Messenger* messenger,
         }
     }
     LOG_PROGRESS(STATUS, "LOAD_LOOP") << "Loaded " << configs.size() << " modules";
+
+    // Draw the seed for the event seeder after all module seeds, to keep the module seeds unchanged
+    event_seed_ = seeder();
 }
 
 /**
@@ -269,7 +392,7 @@ std::pair<ModuleIdentifier, Module*> ModuleManager::create_unique_modules(
     ModuleIdentifier identifier(module_name, identifier_str, 0);
 
     // Get the generator function for this module
-    void* generator = dlsym(library, ALLPIX_GENERATOR_FUNCTION);
+    void* generator = get_module_function(library, ALLPIX_GENERATOR_FUNCTION);
     // If the generator function was not found, throw an error
     if(generator == nullptr) {
         LOG(ERROR) << "Module library is invalid or outdated: required interface function not found!";
@@ -310,6 +433,9 @@ std::pair<ModuleIdentifier, Module*> ModuleManager::create_unique_modules(
     // Update execution time
     auto end = std::chrono::steady_clock::now();
     module_execution_time_[module] += static_cast<std::chrono::duration<long double>>(end - start).count();
+    startup_profile_.add(StartupProfile::Category::CONSTRUCTION,
+                         identifier.getUniqueName(),
+                         static_cast<std::chrono::duration<long double>>(end - start).count());
 
     // Set the module directory afterwards to catch invalid access in constructor
     module->get_configuration().set<std::string>("_output_dir", output_dir);
@@ -322,7 +448,8 @@ std::pair<ModuleIdentifier, Module*> ModuleManager::create_unique_modules(
  * @throws InvalidModuleStateException If the module fails to forward the detector to the base class
  *
  * For detector modules multiple instantiations may be created per section. An instantiation is created for every detector if
- * no selection parameters are provided. Otherwise instantiations are created for every linked detector name and type.
+ * no selection parameters are provided. Otherwise instantiations are created for every linked detector name and type. If the
+ * multi_detector parameter is set, a single instantiation is created for all selected detectors instead.
  */
 std::vector<std::pair<ModuleIdentifier, Module*>> ModuleManager::create_detector_modules(
     void* library, Configuration& config, Messenger* messenger, GeometryManager* geo_manager, std::mt19937_64& seeder) {
@@ -341,7 +468,7 @@ std::vector<std::pair<ModuleIdentifier, Module*>> ModuleManager::create_detector
     }
 
     // Open the library and get the module generator function
-    void* generator = dlsym(library, ALLPIX_GENERATOR_FUNCTION);
+    void* generator = get_module_function(library, ALLPIX_GENERATOR_FUNCTION);
     // If the generator function was not found, throw an error
     if(generator == nullptr) {
         LOG(ERROR) << "Module library is invalid or outdated: required interface function not found!";
@@ -396,6 +523,17 @@ std::vector<std::pair<ModuleIdentifier, Module*>> ModuleManager::create_detector
         }
     }
 
+    // Create a single instantiation for all selected detectors if requested
+    if(config.get<bool>("multi_detector", false)) {
+        std::vector<std::shared_ptr<Detector>> detectors;
+        auto priority = std::numeric_limits<int>::max();
+        for(auto& instance : instantiations) {
+            detectors.push_back(instance.first);
+            priority = std::min(priority, instance.second.getPriority());
+        }
+        return {create_multi_detector_module(library, config, messenger, detectors, priority, seeder)};
+    }
+
     // Construct instantiations from the list of requests
     std::vector<std::pair<ModuleIdentifier, Module*>> module_list;
     for(auto& instance : instantiations) {
@@ -430,6 +568,9 @@ std::vector<std::pair<ModuleIdentifier, Module*>> ModuleManager::create_detector
         // Update execution time
         auto end = std::chrono::steady_clock::now();
         module_execution_time_[module] += static_cast<std::chrono::duration<long double>>(end - start).count();
+        startup_profile_.add(StartupProfile::Category::CONSTRUCTION,
+                             instance.second.getUniqueName(),
+                             static_cast<std::chrono::duration<long double>>(end - start).count());
 
         // Set the module directory afterwards to catch invalid access in constructor
         module->get_configuration().set<std::string>("_output_dir", output_dir);
@@ -448,37 +589,136 @@ std::vector<std::pair<ModuleIdentifier, Module*>> ModuleManager::create_detector
     return module_list;
 }
 
+/**
+ * @throws InvalidValueError If the module does not support multiple detectors in a single instantiation
+ * @throws InvalidModuleStateException If the module fails to forward the detectors to the base class
+ *
+ * The instantiation is identified like a unique module, as it is not bound to a single detector. Its priority is the highest
+ * priority of the selection of its detectors, such that it replaces instantiations of the same module selected in a less
+ * specific way.
+ */
+std::pair<ModuleIdentifier, Module*>
+ModuleManager::create_multi_detector_module(void* library,
+                                            Configuration& config,
+                                            Messenger* messenger,
+                                            const std::vector<std::shared_ptr<Detector>>& detectors,
+                                            int priority,
+                                            std::mt19937_64& seeder) {
+    std::string module_name = config.getName();
+
+    // Create the identifier
+    std::string identifier_str;
+    if(!config.get<std::string>("input").empty()) {
+        identifier_str += config.get<std::string>("input");
+    }
+    if(!config.get<std::string>("output").empty()) {
+        if(!identifier_str.empty()) {
+            identifier_str += "_";
+        }
+        identifier_str += config.get<std::string>("output");
+    }
+    ModuleIdentifier identifier(module_name, identifier_str, priority);
+
+    // Get the generator function for multiple detectors, which is missing for libraries built before it was introduced
+    void* generator = get_module_function(library, ALLPIX_MULTI_GENERATOR_FUNCTION);
+    if(generator == nullptr) {
+        throw InvalidValueError(config, "multi_detector", "module library does not support multi-detector instantiations");
+    }
+    auto module_generator =
+        reinterpret_cast<Module* (*)(Configuration&, Messenger*, std::vector<std::shared_ptr<Detector>>)>( // NOLINT
+            generator);
+
+    // Create and add module instance config
+    Configuration& instance_config = conf_manager_->addInstanceConfiguration(identifier, config);
+
+    // Specialize instance configuration
+    instance_config.set<uint64_t>("_seed", seeder());
+    std::string output_dir;
+    output_dir = instance_config.get<std::string>("_global_dir");
+    output_dir += "/";
+    std::string path_mod_name = identifier.getUniqueName();
+    std::replace(path_mod_name.begin(), path_mod_name.end(), ':', '_');
+    output_dir += path_mod_name;
+
+    LOG(DEBUG) << "Creating multi-detector instantiation " << identifier.getUniqueName() << " for " << detectors.size()
+               << " detectors";
+
+    // Get current time
+    auto start = std::chrono::steady_clock::now();
+    // Set the log section header
+    std::string old_section_name = Log::getSection();
+    std::string section_name = "C:";
+    section_name += identifier.getUniqueName();
+    Log::setSection(section_name);
+    // Set module specific log settings
+    auto old_settings = set_module_before(identifier.getUniqueName(), instance_config);
+    // Build module
+    Module* module = module_generator(instance_config, messenger, detectors);
+    // Reset log
+    Log::setSection(old_section_name);
+    set_module_after(old_settings);
+    if(module == nullptr) {
+        throw InvalidValueError(config, "multi_detector", "module does not support multi-detector instantiations");
+    }
+    // Update execution time
+    auto end = std::chrono::steady_clock::now();
+    module_execution_time_[module] += static_cast<std::chrono::duration<long double>>(end - start).count();
+    startup_profile_.add(StartupProfile::Category::CONSTRUCTION,
+                         identifier.getUniqueName(),
+                         static_cast<std::chrono::duration<long double>>(end - start).count());
+
+    // Set the module directory afterwards to catch invalid access in constructor
+    module->get_configuration().set<std::string>("_output_dir", output_dir);
+
+    // Check if the module called the correct base class constructor
+    if(module->getDetectors() != detectors) {
+        throw InvalidModuleStateException(
+            "Module " + module_name +
+            " does not call the correct base Module constructor: the provided detectors should be forwarded");
+    }
+
+    return std::make_pair(identifier, module);
+}
+
+// Helpers to read the module specific log settings from the configuration of the module
+static LogLevel get_log_level(const Configuration& config) {
+    auto log_level_string = config.get<std::string>("log_level");
+    std::transform(log_level_string.begin(), log_level_string.end(), log_level_string.begin(), ::toupper);
+    try {
+        return Log::getLevelFromString(log_level_string);
+    } catch(std::invalid_argument& e) {
+        throw InvalidValueError(config, "log_level", e.what());
+    }
+}
+static LogFormat get_log_format(const Configuration& config) {
+    auto log_format_string = config.get<std::string>("log_format");
+    std::transform(log_format_string.begin(), log_format_string.end(), log_format_string.begin(), ::toupper);
+    try {
+        return Log::getFormatFromString(log_format_string);
+    } catch(std::invalid_argument& e) {
+        throw InvalidValueError(config, "log_format", e.what());
+    }
+}
+
 // Helper functions to set the module specific log settings if necessary
 std::tuple<LogLevel, LogFormat> ModuleManager::set_module_before(const std::string&, const Configuration& config) {
     // Set new log level if necessary
     LogLevel prev_level = Log::getReportingLevel();
     if(config.has("log_level")) {
-        auto log_level_string = config.get<std::string>("log_level");
-        std::transform(log_level_string.begin(), log_level_string.end(), log_level_string.begin(), ::toupper);
-        try {
-            LogLevel log_level = Log::getLevelFromString(log_level_string);
-            if(log_level != prev_level) {
-                LOG(TRACE) << "Local log level is set to " << log_level_string;
-                Log::setReportingLevel(log_level);
-            }
-        } catch(std::invalid_argument& e) {
-            throw InvalidValueError(config, "log_level", e.what());
+        LogLevel log_level = get_log_level(config);
+        if(log_level != prev_level) {
+            LOG(TRACE) << "Local log level is set to " << Log::getStringFromLevel(log_level);
+            Log::setReportingLevel(log_level);
         }
     }
 
     // Set new log format if necessary
     LogFormat prev_format = Log::getFormat();
     if(config.has("log_format")) {
-        auto log_format_string = config.get<std::string>("log_format");
-        std::transform(log_format_string.begin(), log_format_string.end(), log_format_string.begin(), ::toupper);
-        try {
-            LogFormat log_format = Log::getFormatFromString(log_format_string);
-            if(log_format != prev_format) {
-                LOG(TRACE) << "Local log format is set to " << log_format_string;
-                Log::setFormat(log_format);
-            }
-        } catch(std::invalid_argument& e) {
-            throw InvalidValueError(config, "log_format", e.what());
+        LogFormat log_format = get_log_format(config);
+        if(log_format != prev_format) {
+            LOG(TRACE) << "Local log format is set to " << Log::getStringFromFormat(log_format);
+            Log::setFormat(log_format);
         }
     }
 
@@ -502,79 +742,297 @@ void ModuleManager::set_module_after(std::tuple<LogLevel, LogFormat> prev) {
     }
 }
 
+/**
+ * The configuration lookups and the parsing of the log settings, as well as the construction of the section header, are
+ * done once before the event loop. Delegates are only checked and reset in every event if the module has any delegate
+ * requiring it.
+ */
+void ModuleManager::prepare_execution(Module* module) {
+    auto& execution = module->execution_;
+    const auto& config = module->get_configuration();
+
+    execution.section_name = "R:" + module->get_identifier().getUniqueName();
+    execution.set_log_level = config.has("log_level");
+    if(execution.set_log_level) {
+        execution.log_level = get_log_level(config);
+    }
+    execution.set_log_format = config.has("log_format");
+    if(execution.set_log_format) {
+        execution.log_format = get_log_format(config);
+    }
+
+    execution.check_delegates = false;
+    execution.reset_delegates = false;
+    for(auto& delegate : module->delegates_) {
+        execution.check_delegates |= ((delegate.second->getFlags() & MsgFlags::REQUIRED) != MsgFlags::NONE);
+        execution.reset_delegates |= !delegate.second->isEventLocal();
+    }
+
+    // Only modules with parallelization can process multiple events at once, as they fetch their messages from the events
+    execution.batch_events = config.get<unsigned int>("batch_events", 1u);
+    if(execution.batch_events == 0) {
+        throw InvalidValueError(config, "batch_events", "number of events per batch should be strictly positive");
+    }
+    if(execution.batch_events > 1 && !module->canParallelize()) {
+        LOG(WARNING) << "Module " << module->getUniqueName()
+                     << " does not support parallelization, running events one by one instead of in batches";
+        execution.batch_events = 1;
+    }
+}
+
 /**
  * Sets the section header and logging settings before executing the  \ref Module::init() function.
- *  \ref Module::reset_delegates() "Resets" the delegates and the logging after initialization.
+ *  \ref Module::reset_delegates() "Resets" the delegates and the logging after initialization. If parallel initialization
+ * is enabled, consecutive module instantiations which support it are initialized at the same time by a thread pool, while
+ * all other module instantiations act as barriers and are initialized on their own in the configured order.
  */
 void ModuleManager::init() {
     auto start_time = std::chrono::steady_clock::now();
-    LOG_PROGRESS(STATUS, "INIT_LOOP") << "Initializing " << modules_.size() << " module instantiations";
-    for(auto& module : modules_) {
-        LOG_PROGRESS(TRACE, "INIT_LOOP") << "Initializing " << module->get_identifier().getUniqueName();
+    Configuration& global_config = conf_manager_->getGlobalConfiguration();
 
-        // Pass the config manager to this instance
-        module->set_config_manager(conf_manager_);
+    // Create a thread pool for the initialization if requested
+    std::unique_ptr<ThreadPool> thread_pool;
+    if(global_config.get<bool>("parallel_initialization", false)) {
+        if(global_config.get<bool>("experimental_multithreading", false)) {
+            thread_pool = create_phase_thread_pool("initialization");
+        } else {
+            LOG(WARNING) << "Parallel initialization requires multithreading to be enabled, ignoring";
+        }
+    }
 
-        // Create main ROOT directory for this module class if it does not exists yet
-        LOG(TRACE) << "Creating and accessing ROOT directory";
-        std::string module_name = module->get_configuration().getName();
-        auto directory = modules_file_->GetDirectory(module_name.c_str());
-        if(directory == nullptr) {
-            directory = modules_file_->mkdir(module_name.c_str());
-            if(directory == nullptr) {
-                throw RuntimeError("Cannot create or access overall ROOT directory for module " + module_name);
+    // The dedicated ROOT files of the instantiations finalized in parallel are created with their directories
+    parallel_finalization_ = global_config.get<bool>("parallel_finalization", false);
+    if(parallel_finalization_ && !global_config.get<bool>("experimental_multithreading", false)) {
+        LOG(WARNING) << "Parallel finalization requires multithreading to be enabled, ignoring";
+        parallel_finalization_ = false;
+    }
+
+    LOG_PROGRESS(STATUS, "INIT_LOOP") << "Initializing " << modules_.size() << " module instantiations";
+    for(auto iter = modules_.begin(); iter != modules_.end();) {
+        // Select either a single module or all consecutive modules which can be initialized in parallel
+        auto batch_end = std::next(iter);
+        if(thread_pool != nullptr && (*iter)->canInitializeInParallel()) {
+            while(batch_end != modules_.end() && (*batch_end)->canInitializeInParallel()) {
+                ++batch_end;
             }
         }
-        directory->cd();
 
-        // Create local directory for this instance
-        TDirectory* local_directory = nullptr;
-        if(module->get_identifier().getIdentifier().empty()) {
-            local_directory = directory;
+        // Prepare all modules of the batch sequentially, as creating directories in the same file is not thread-safe
+        for(auto module_iter = iter; module_iter != batch_end; ++module_iter) {
+            prepare_module_init(module_iter->get());
+        }
+
+        if(std::next(iter) == batch_end) {
+            init_module(iter->get());
         } else {
-            local_directory = directory->mkdir(module->get_identifier().getIdentifier().c_str());
-            if(local_directory == nullptr) {
-                throw RuntimeError("Cannot create or access local ROOT directory for module " + module->getUniqueName());
+            LOG(DEBUG) << "Initializing " << std::distance(iter, batch_end) << " module instantiations in parallel";
+            ThreadPool::TaskGroup group;
+            std::vector<std::future<void>> tasks;
+            for(auto module_iter = iter; module_iter != batch_end; ++module_iter) {
+                tasks.push_back(thread_pool->submit(group, [this, module = module_iter->get()]() { init_module(module); }));
+            }
+
+            // Help initializing and wait for all modules of the batch, rethrowing the first exception in module order
+            thread_pool->wait_for(group);
+            for(auto& task : tasks) {
+                task.get();
             }
         }
+        iter = batch_end;
+    }
+    LOG_PROGRESS(STATUS, "INIT_LOOP") << "Initialized " << modules_.size() << " module instantiations";
+    auto end_time = std::chrono::steady_clock::now();
+    total_time_ += static_cast<std::chrono::duration<long double>>(end_time - start_time).count();
+}
 
-        // Change to the directory and save it in the module
-        local_directory->cd();
-        module->set_ROOT_directory(local_directory);
+std::unique_ptr<ThreadPool> ModuleManager::create_phase_thread_pool(const std::string& phase) {
+    Configuration& global_config = conf_manager_->getGlobalConfiguration();
+    auto threads_num = global_config.get<unsigned int>("workers", std::max(std::thread::hardware_concurrency(), 1u));
+    if(threads_num == 0) {
+        throw InvalidValueError(global_config, "workers", "number of workers should be strictly more than zero");
+    }
+    LOG(STATUS) << "Parallel " << phase << " of module instantiations enabled - using " << threads_num
+                << " worker threads.";
+    auto init_function = [log_level = Log::getReportingLevel(), log_format = Log::getFormat()]() {
+        // Initialize the threads to the same log level and format as the master setting
+        Log::setReportingLevel(log_level);
+        Log::setFormat(log_format);
+    };
+    return std::make_unique<ThreadPool>(threads_num, init_function);
+}
 
-        // Get current time
+/**
+ * All instantiations after the first changed one are re-created as well, as they might depend on the output of the changed
+ * instantiation. The instantiations before it are kept together with everything they initialized, such as the geometry,
+ * the fields and the Geant4 physics. Re-created instantiations are finalized first to write their output, and constructed
+ * again from the same library and with their updated instance configuration.
+ */
+void ModuleManager::reconfigure(Messenger* messenger, GeometryManager* geo_manager, const std::set<std::string>& changed) {
+    auto first_changed = std::find_if(modules_.begin(), modules_.end(), [&](const std::unique_ptr<Module>& module) {
+        return changed.find(module->getUniqueName()) != changed.end();
+    });
+    if(first_changed == modules_.end()) {
+        LOG(INFO) << "Configuration of all module instantiations unchanged, keeping all instantiations";
+        return;
+    }
+    LOG(STATUS) << "Re-creating " << std::distance(first_changed, modules_.end())
+                << " module instantiations starting from " << (*first_changed)->getUniqueName();
+
+    for(auto iter = first_changed; iter != modules_.end(); ++iter) {
+        auto& module = *iter;
+        finalize_module(module.get());
+
+        auto identifier = module->get_identifier();
+        auto& config = module->get_configuration();
+        auto detector = module->getDetector();
+        auto detectors = module->getDetectors();
+        std::string lib_name = std::string(ALLPIX_MODULE_PREFIX).append(config.getName()).append(SHARED_LIBRARY_SUFFIX);
+        void* generator = get_module_function(loaded_libraries_.at(lib_name), ALLPIX_GENERATOR_FUNCTION);
+        void* multi_generator = get_module_function(loaded_libraries_.at(lib_name), ALLPIX_MULTI_GENERATOR_FUNCTION);
+
+        // Destroy the previous instantiation first to remove its message bindings
+        module_execution_time_.erase(module.get());
+        module_next_event_.erase(module.get());
+        module.reset();
+
+        LOG(DEBUG) << "Re-creating instantiation " << identifier.getUniqueName();
         auto start = std::chrono::steady_clock::now();
-        // Set init module section header
         std::string old_section_name = Log::getSection();
-        std::string section_name = "I:";
-        section_name += module->get_identifier().getUniqueName();
-        Log::setSection(section_name);
-        // Set module specific settings
-        auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration());
-        // Change to our ROOT directory
-        module->getROOTDirectory()->cd();
-        // Init module
-        module->init();
-        // Reset delegates
-        LOG(TRACE) << "Resetting messages";
-        module->reset_delegates();
-        // Reset logging
+        Log::setSection("C:" + identifier.getUniqueName());
+        auto old_settings = set_module_before(identifier.getUniqueName(), config);
+        if(detector == nullptr && !detectors.empty()) {
+            auto module_generator =
+                reinterpret_cast<Module* (*)(Configuration&, Messenger*, std::vector<std::shared_ptr<Detector>>)>( // NOLINT
+                    multi_generator);
+            module.reset(module_generator(config, messenger, detectors));
+        } else if(detector == nullptr) {
+            auto module_generator =
+                reinterpret_cast<Module* (*)(Configuration&, Messenger*, GeometryManager*)>(generator); // NOLINT
+            module.reset(module_generator(config, messenger, geo_manager));
+        } else {
+            auto module_generator =
+                reinterpret_cast<Module* (*)(Configuration&, Messenger*, std::shared_ptr<Detector>)>(generator); // NOLINT
+            module.reset(module_generator(config, messenger, detector));
+        }
         Log::setSection(old_section_name);
         set_module_after(old_settings);
-        // Update execution time
         auto end = std::chrono::steady_clock::now();
         module_execution_time_[module.get()] += static_cast<std::chrono::duration<long double>>(end - start).count();
+
+        module->set_identifier(identifier);
     }
-    LOG_PROGRESS(STATUS, "INIT_LOOP") << "Initialized " << modules_.size() << " module instantiations";
-    auto end_time = std::chrono::steady_clock::now();
-    total_time_ += static_cast<std::chrono::duration<long double>>(end_time - start_time).count();
+
+    // Initialize the new instantiations in order, as modules might depend on the initialization of earlier ones
+    for(auto iter = first_changed; iter != modules_.end(); ++iter) {
+        prepare_module_init(iter->get());
+        init_module(iter->get());
+    }
+}
+
+void ModuleManager::prepare_module_init(Module* module) {
+    LOG_PROGRESS(TRACE, "INIT_LOOP") << "Initializing " << module->get_identifier().getUniqueName();
+
+    // Pass the config manager to this instance
+    module->set_config_manager(conf_manager_);
+
+    // Instantiations finalized in parallel write to a dedicated file, as a single ROOT file cannot be written concurrently
+    std::string module_name = module->get_configuration().getName();
+    TFile* file = modules_file_.get();
+    if(parallel_finalization_ && module->canFinalizeInParallel()) {
+        auto& module_file = module_files_[module->getUniqueName()];
+        if(module_file == nullptr) {
+            std::string path = modules_file_->GetName();
+            path = path.substr(0, path.size() - 5) + "_" + module_name;
+            if(!module->get_identifier().getIdentifier().empty()) {
+                path += "_" + module->get_identifier().getIdentifier();
+            }
+            path = allpix::add_file_extension(path, "root");
+            if(allpix::path_is_file(path)) {
+                if(conf_manager_->getGlobalConfiguration().get<bool>("deny_overwrite", false)) {
+                    throw RuntimeError("Overwriting of existing ROOT file " + path + " denied");
+                }
+                LOG(WARNING) << "ROOT file " << path << " exists and will be overwritten.";
+                allpix::remove_file(path);
+            }
+            module_file = std::make_unique<TFile>(path.c_str(), "RECREATE");
+            if(module_file->IsZombie()) {
+                throw RuntimeError("Cannot create ROOT file " + path + " for module " + module->getUniqueName());
+            }
+            LOG(DEBUG) << "Writing ROOT objects of " << module->getUniqueName() << " to dedicated file " << path;
+        }
+        file = module_file.get();
+    }
+
+    // Create main ROOT directory for this module class if it does not exists yet
+    LOG(TRACE) << "Creating and accessing ROOT directory";
+    auto directory = file->GetDirectory(module_name.c_str());
+    if(directory == nullptr) {
+        directory = file->mkdir(module_name.c_str());
+        if(directory == nullptr) {
+            throw RuntimeError("Cannot create or access overall ROOT directory for module " + module_name);
+        }
+    }
+    directory->cd();
+
+    // Create local directory for this instance
+    TDirectory* local_directory = nullptr;
+    if(module->get_identifier().getIdentifier().empty()) {
+        local_directory = directory;
+    } else {
+        // The directory already exists if the instantiation is initialized again after a reconfiguration
+        local_directory = directory->GetDirectory(module->get_identifier().getIdentifier().c_str());
+        if(local_directory == nullptr) {
+            local_directory = directory->mkdir(module->get_identifier().getIdentifier().c_str());
+        }
+        if(local_directory == nullptr) {
+            throw RuntimeError("Cannot create or access local ROOT directory for module " + module->getUniqueName());
+        }
+    }
+
+    // Change to the directory and save it in the module
+    local_directory->cd();
+    module->set_ROOT_directory(local_directory);
+}
+
+void ModuleManager::init_module(Module* module) {
+    // Get current time
+    auto start = std::chrono::steady_clock::now();
+    // Set init module section header
+    std::string old_section_name = Log::getSection();
+    std::string section_name = "I:";
+    section_name += module->get_identifier().getUniqueName();
+    Log::setSection(section_name);
+    // Set module specific settings
+    auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration());
+    // Change to our ROOT directory
+    module->getROOTDirectory()->cd();
+    // Init module, annotated for external profilers with the section name
+    {
+        PROFILER_RANGE(section_name.c_str());
+        module->init();
+    }
+    // Reset delegates
+    LOG(TRACE) << "Resetting messages";
+    module->reset_delegates();
+    // Reset logging
+    Log::setSection(old_section_name);
+    set_module_after(old_settings);
+    // Update execution time
+    auto end = std::chrono::steady_clock::now();
+    startup_profile_.add(StartupProfile::Category::INITIALIZATION,
+                         module->get_identifier().getUniqueName(),
+                         static_cast<std::chrono::duration<long double>>(end - start).count());
+    std::lock_guard<std::mutex> lock(time_mutex_);
+    module_execution_time_[module] += static_cast<std::chrono::duration<long double>>(end - start).count();
 }
 
 /**
- * Initializes the thread pool for excuting multiple modules and module tasks in parallel. The run for a module is skipped if
- * its delegates are not \ref Module::check_delegates() "satisfied". Sets the section header and logging settings before
- * executing the \ref Module::run() function. \ref Module::reset_delegates() "Resets" the delegates and the logging after
- * initialization
+ * Initializes the thread pool for processing multiple events in parallel. Every event runs all module instantiations in
+ * their configured order. Modules with parallelization enabled can be executed for several events at the same time, all
+ * other modules are executed for one event at the time in order of the event sequence.
+ * The random seed of every event is drawn from a dedicated seeder in the order of the event sequence, ensuring reproducible
+ * results independent of the number of workers. Runs starting at a later event skip the seeds of all previous events, such
+ * that every event of a run split into several ranges is simulated identically to the same event of a single run.
  */
 void ModuleManager::run() {
     Configuration& global_config = conf_manager_->getGlobalConfiguration();
@@ -589,131 +1047,1215 @@ void ModuleManager::run() {
             throw InvalidValueError(global_config, "workers", "number of workers should be strictly more than zero");
         }
         LOG(WARNING) << "Experimental multithreading enabled - using " << threads_num << " worker threads.";
-        --threads_num;
+
+        // Limit the number of events in flight to bound the memory usage
+        auto buffer_per_worker = global_config.get<unsigned int>("buffer_per_worker", 4);
+        if(buffer_per_worker == 0) {
+            throw InvalidValueError(global_config,
+                                    "buffer_per_worker",
+                                    "number of buffered events per worker should be strictly more than zero");
+        }
+        max_buffered_events_ = threads_num * buffer_per_worker;
+
+        // Replace the limit derived from the number of workers if a maximum number of events in flight is given
+        if(global_config.has("max_buffered_events")) {
+            max_buffered_events_ = global_config.get<unsigned int>("max_buffered_events");
+            if(max_buffered_events_ == 0) {
+                throw InvalidValueError(global_config,
+                                        "max_buffered_events",
+                                        "maximum number of buffered events should be strictly more than zero");
+            }
+        }
     } else {
         // Default to no additional thread without multithreading
         threads_num = 0;
+        max_buffered_events_ = 1;
     }
 
-    // Creates the thread pool
-    LOG(DEBUG) << "Initializing thread pool with " << threads_num << " additional thread(s)";
-    std::vector<Module*> module_list;
+    // Schedule the module instantiations of every event as tasks ordered by their dependencies if requested
+    bool dataflow_scheduling = global_config.get<bool>("dataflow_scheduling", false);
+    if(dataflow_scheduling && threads_num == 0) {
+        LOG(WARNING) << "Dataflow scheduling requires multithreading to be enabled, ignoring";
+        dataflow_scheduling = false;
+    }
+    if(dataflow_scheduling) {
+        LOG(WARNING) << "Experimental dataflow scheduling of module instantiations enabled";
+        build_dependencies();
+    }
+
+    // Prefer running the module instantiations on the same worker in every event if requested
+    auto module_affinity = global_config.get<std::string>("module_affinity", "none");
+    if(module_affinity != "none" && module_affinity != "module" && module_affinity != "detector") {
+        throw InvalidValueError(global_config, "module_affinity", "affinity should be 'none', 'module' or 'detector'");
+    }
+    module_workers_.clear();
+    if(module_affinity != "none") {
+        if(dataflow_scheduling) {
+            assign_module_workers(module_affinity == "detector", threads_num);
+        } else {
+            LOG(WARNING) << "Module affinity requires dataflow scheduling, ignoring";
+        }
+    }
+
+    // Soft limit of the memory of the messages of all events in flight, no new event is started while it is exceeded
+    max_buffered_memory_ = global_config.get<uint64_t>("max_buffered_memory", 0) * 1024 * 1024;
+    if(max_buffered_memory_ > 0) {
+        LOG(INFO) << "Delaying new events while the messages of the buffered events exceed "
+                  << bytes_to_size(max_buffered_memory_);
+    }
+
+    // Check that modules with parallelization enabled do not bind messages to member variables
     for(auto& module : modules_) {
-        module_list.emplace_back(module.get());
+        if(!module->canParallelize()) {
+            continue;
+        }
+        for(auto& delegate : module->delegates_) {
+            if(!delegate.second->isEventLocal()) {
+                throw InvalidModuleStateException("Module " + module->getUniqueName() +
+                                                  " enables parallelization but binds messages to member variables");
+            }
+        }
     }
+
+    // Creates the thread pool
+    LOG(DEBUG) << "Initializing thread pool with " << threads_num << " thread(s)";
     auto init_function = [log_level = Log::getReportingLevel(), log_format = Log::getFormat()]() {
         // Initialize the threads to the same log level and format as the master setting
         Log::setReportingLevel(log_level);
         Log::setFormat(log_format);
     };
-    std::shared_ptr<ThreadPool> thread_pool = std::make_shared<ThreadPool>(threads_num, module_list, init_function);
+    auto pin_workers = global_config.get<bool>("pin_workers", false);
+    if(pin_workers && threads_num > 0) {
+        LOG(STATUS) << "Pinning worker threads to CPUs, system with " << get_numa_node_count() << " NUMA node(s)";
+    }
+    std::shared_ptr<ThreadPool> thread_pool = std::make_shared<ThreadPool>(threads_num, init_function, pin_workers);
     for(auto& module : modules_) {
         module->set_thread_pool(thread_pool);
+        prepare_execution(module.get());
+
+        // Batches of events are only collected by the event loop with multiple workers executing all modules of an event
+        auto& execution = module->execution_;
+        if(execution.batch_events > 1 && (threads_num == 0 || dataflow_scheduling)) {
+            LOG(WARNING) << "Batches of events of " << module->getUniqueName()
+                         << " require multithreading without dataflow scheduling, running events one by one";
+            execution.batch_events = 1;
+        } else if(execution.batch_events > 1) {
+            LOG(INFO) << "Running " << module->getUniqueName() << " for batches of " << execution.batch_events << " events";
+            if(execution.batch_events > max_buffered_events_) {
+                LOG(WARNING) << "Batches of " << module->getUniqueName() << " are larger than the " << max_buffered_events_
+                             << " events in flight and will not be filled";
+            }
+        }
     }
 
-    // Loop over all the events
-    auto start_time = std::chrono::steady_clock::now();
+    // Reset the state of the event sequence
     global_config.setDefault<unsigned int>("number_of_events", 1u);
+    global_config.setDefault<unsigned int>("first_event", 1u);
+    if(global_config.has("resume_from_checkpoint")) {
+        resume_from_checkpoint(global_config, global_config.getPath("resume_from_checkpoint", true));
+    }
     auto number_of_events = global_config.get<unsigned int>("number_of_events");
-    for(unsigned int i = 0; i < number_of_events; ++i) {
-        // Check for termination
-        if(terminate_) {
-            LOG(INFO) << "Interrupting event loop after " << i << " events because of request to terminate";
-            number_of_events = i;
-            global_config.set<unsigned int>("number_of_events", i);
-            break;
+    auto first_event = global_config.get<unsigned int>("first_event");
+    if(first_event == 0) {
+        throw InvalidValueError(global_config, "first_event", "events are numbered starting from one");
+    }
+    // Extend the run by the warm-up events of a benchmark, the timed events start after these
+    unsigned int benchmark_event = 0;
+    unsigned int warmup_events = 0;
+    if(global_config.has("benchmark_events")) {
+        auto benchmark_events = global_config.get<unsigned int>("benchmark_events");
+        warmup_events = global_config.get<unsigned int>("benchmark_warmup_events", 10u);
+        if(benchmark_events == 0) {
+            throw InvalidValueError(global_config, "benchmark_events", "number of timed events should be strictly positive");
         }
-
-        LOG_PROGRESS(STATUS, "EVENT_LOOP") << "Running event " << (i + 1) << " of " << number_of_events;
-
-        // Get object count for linking objects in current event
-        auto save_id = TProcessID::GetObjectCount();
-
-        std::string module_name;
-        if(!modules_.empty()) {
-            module_name = modules_.front()->get_identifier().getName();
+        if(benchmark_events > std::numeric_limits<unsigned int>::max() - warmup_events) {
+            throw InvalidValueError(global_config, "benchmark_warmup_events", "too many warm-up events");
         }
-        for(auto& module : modules_) {
-            // Execute all remaining jobs in the thread pool when switching to a new module type
-            if(module->get_identifier().getName() != module_name) {
-                module_name = module->get_identifier().getName();
-                thread_pool->execute_all();
-            }
-
-            auto execute_module = [module = module.get(), event_num = i + 1, this, number_of_events]() {
-                LOG_PROGRESS(TRACE, "EVENT_LOOP") << "Running event " << event_num << " of " << number_of_events << " ["
-                                                  << module->get_identifier().getUniqueName() << "]";
-                // Check if module is satisfied to run
-                if(!module->check_delegates()) {
-                    LOG(TRACE) << "Not all required messages are received for " << module->get_identifier().getUniqueName()
-                               << ", skipping module!";
-                    return;
-                }
-
-                // Get current time
-                auto start = std::chrono::steady_clock::now();
-                // Set run module section header
-                std::string old_section_name = Log::getSection();
-                std::string section_name = "R:";
-                section_name += module->get_identifier().getUniqueName();
-                Log::setSection(section_name);
-                // Set module specific settings
-                auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration());
-                // Change to ROOT directory is not thread safe, only do this for module without parallelization support
-                if(!module->canParallelize()) {
-                    // DEPRECATED: Switching to the directory should be removed, but can break current modules
-                    module->getROOTDirectory()->cd();
-                }
-                // Run module
-                try {
-                    module->run(event_num);
-                } catch(EndOfRunException& e) {
-                    // Terminate if the module threw the EndOfRun request exception:
-                    LOG(WARNING) << "Request to terminate:" << std::endl << e.what();
-                    terminate_ = true;
-                }
-                // Reset logging
-                Log::setSection(old_section_name);
-                set_module_after(old_settings);
-                // Update execution time
-                auto end = std::chrono::steady_clock::now();
-                module_execution_time_[module] += static_cast<std::chrono::duration<long double>>(end - start).count();
-            };
-
-            if(module->canParallelize()) {
-                // Submit the module function
-                thread_pool->submit_module_function(execute_module);
-            } else {
-                // Finish thread pool
-                thread_pool->execute_all();
-                // Execute current module
-                execute_module();
-            }
+        number_of_events = warmup_events + benchmark_events;
+        global_config.set<unsigned int>("number_of_events", number_of_events);
+        LOG(STATUS) << "Benchmarking " << benchmark_events << " events after " << warmup_events << " warm-up events";
+    }
+    // Only simulate a sample of the events and project the cost of the full run from these
+    estimate_total_events_ = 0;
+    estimate_event_time_.clear();
+    estimate_event_bytes_.clear();
+    if(global_config.has("estimate_events")) {
+        auto estimate_events = global_config.get<unsigned int>("estimate_events");
+        if(estimate_events == 0) {
+            throw InvalidValueError(
+                global_config, "estimate_events", "number of sampled events should be strictly positive");
         }
-
-        // Finish executing the last remaining tasks
-        thread_pool->execute_all();
-
-        // Resetting delegates
-        for(auto& module : modules_) {
-            LOG(TRACE) << "Resetting messages";
-            module->reset_delegates();
+        if(global_config.has("benchmark_events")) {
+            throw InvalidValueError(global_config, "estimate_events", "cannot estimate the cost of a benchmark");
         }
-
-        // Reset object count for next event
-        TProcessID::SetObjectCount(save_id);
+        estimate_total_events_ = number_of_events;
+        number_of_events = std::min(number_of_events, estimate_events);
+        global_config.set<unsigned int>("number_of_events", number_of_events);
+        estimate_event_time_.reserve(number_of_events);
+        estimate_event_bytes_.reserve(number_of_events);
+        LOG(STATUS) << "Estimating the cost of " << estimate_total_events_ << " events from a sample of " << number_of_events
+                    << " events";
+    }
+    if(number_of_events > std::numeric_limits<unsigned int>::max() - first_event + 1) {
+        throw InvalidValueError(global_config, "number_of_events", "last event exceeds the largest event number");
+    }
+    auto end_event = first_event + number_of_events - 1;
+    if(global_config.has("benchmark_events")) {
+        benchmark_event = first_event + warmup_events;
+    }
+    if(first_event > 1) {
+        LOG(STATUS) << "Simulating events " << first_event << " to " << end_event << " of a run split into event ranges";
     }
-    LOG_PROGRESS(STATUS, "EVENT_LOOP") << "Finished run of " << number_of_events << " events";
-    auto end_time = std::chrono::steady_clock::now();
-    total_time_ += static_cast<std::chrono::duration<long double>>(end_time - start_time).count();
-
-    // Remove pool from modules, wait for the threads to finish and destroy pool
-    LOG(TRACE) << "Destroying thread pool";
     for(auto& module : modules_) {
-        module->set_thread_pool(nullptr);
+        module_next_event_[module.get()] = first_event;
+    }
+    last_event_ = end_event;
+    buffered_events_ = 0;
+    started_events_ = 0;
+    starting_events_ = true;
+    batches_.clear();
+    batch_exception_ = nullptr;
+    throttled_events_ = 0;
+    abort_ = false;
+    parked_modules_.clear();
+    std::mt19937_64 event_seeder(event_seed_);
+    event_seeder.discard(first_event - 1);
+
+    // Write checkpoints of the events finished in order of the event sequence if requested
+    checkpoint_file_.clear();
+    if(global_config.has("checkpoint_file")) {
+        checkpoint_file_ = std::string(gSystem->pwd()) + "/" + global_config.get<std::string>("checkpoint_file");
+        checkpoint_interval_ = global_config.get<unsigned int>("checkpoint_interval", 1000u);
+        if(checkpoint_interval_ == 0) {
+            throw InvalidValueError(
+                global_config, "checkpoint_interval", "number of events between checkpoints should be strictly positive");
+        }
+        LOG(STATUS) << "Writing checkpoint every " << checkpoint_interval_ << " events to file " << checkpoint_file_;
+    }
+    checkpoint_event_ = first_event - 1;
+    checkpoint_written_event_ = checkpoint_event_;
+    checkpoint_last_event_ = end_event;
+    checkpoint_seed_ = global_config.get<uint64_t>("random_seed");
+    finished_events_.clear();
+    finished_event_count_ = 0;
+    aborted_events_ = 0;
+
+    // Select the Monte Carlo truth kept in the history of all objects created in the events
+    auto mc_truth = global_config.get<std::string>("mc_truth", "full");
+    std::transform(mc_truth.begin(), mc_truth.end(), mc_truth.begin(), ::tolower);
+    if(mc_truth == "full") {
+        Object::setMCTruth(Object::MCTruth::FULL);
+    } else if(mc_truth == "primaries") {
+        Object::setMCTruth(Object::MCTruth::PRIMARIES);
+    } else if(mc_truth == "none") {
+        Object::setMCTruth(Object::MCTruth::NONE);
+    } else {
+        throw InvalidValueError(global_config, "mc_truth", "level should be 'full', 'primaries' or 'none'");
+    }
+    if(mc_truth != "full") {
+        LOG(INFO) << "Storing Monte Carlo truth of level '" << mc_truth << "' in the history of all objects";
+    }
+
+    // Record the receivers of all messages until the first event is finished to find modules without consumers
+    skip_unused_modules_ = global_config.get<bool>("skip_unused_modules", false);
+    analysis_event_ = first_event;
+    for(auto& module : modules_) {
+        std::lock_guard<std::mutex> lock(module->receivers_mutex_);
+        module->dispatched_messages_ = false;
+        module->message_receivers_.clear();
+        module->skipped_ = false;
+        module->record_receivers_ = true;
+    }
+    measure_resident_memory_ = global_config.get<bool>("measure_resident_memory", false);
+    release_messages_early_ = global_config.get<bool>("release_messages_early", false);
+    if(release_messages_early_) {
+        LOG(INFO) << "Releasing messages as soon as all their receivers have finished the event";
+    }
+
+    // Record the execution of all modules and tasks of the thread pool if requested
+    tracer_.reset();
+    std::string trace_path;
+    if(global_config.has("trace_file")) {
+        trace_path = std::string(gSystem->pwd()) + "/" + global_config.get<std::string>("trace_file");
+        tracer_ = std::make_unique<Tracer>();
+        thread_pool->tracer_ = tracer_.get();
+        LOG(STATUS) << "Recording trace of the event loop to file " << trace_path;
+    }
+
+    // Write log messages from a background thread while events are processed by multiple workers
+    if(threads_num > 0) {
+        Log::setAsynchronous(true);
+    }
+
+    // Loop over all the events
+    auto start_time = std::chrono::steady_clock::now();
+    unsigned int submitted_events = 0;
+
+    // Append the metrics of the event loop to a file from a background thread if requested, the thread is stopped when
+    // leaving the event loop, also if it is left by an exception
+    auto stop_metrics = [this](std::thread* metrics_thread) {
+        {
+            std::lock_guard<std::mutex> lock(metrics_mutex_);
+            metrics_stop_ = true;
+        }
+        metrics_condition_.notify_all();
+        metrics_thread->join();
+        delete metrics_thread;
+    };
+    std::unique_ptr<std::thread, decltype(stop_metrics)> metrics_thread(nullptr, stop_metrics);
+    if(global_config.has("metrics_file")) {
+        auto metrics_path = std::string(gSystem->pwd()) + "/" + global_config.get<std::string>("metrics_file");
+        auto metrics_interval = global_config.get<double>("metrics_interval", Units::get(10.0, "s"));
+        if(!(metrics_interval > 0)) {
+            throw InvalidValueError(global_config, "metrics_interval", "time between metrics should be strictly positive");
+        }
+        std::ofstream metrics_file(metrics_path, std::ios_base::app);
+        if(!metrics_file) {
+            throw RuntimeError("Cannot write metrics file " + metrics_path);
+        }
+        LOG(STATUS) << "Appending metrics every " << Units::display(metrics_interval, {"s", "ms"}) << " to file "
+                    << metrics_path;
+
+        metrics_stop_ = false;
+        std::chrono::duration<double> interval(metrics_interval / Units::get(1.0, "s"));
+        metrics_thread.reset(new std::thread([this, file = std::move(metrics_file), interval]() mutable {
+            write_metrics(file, interval);
+        }));
+    }
+    // End the startup with the first event and show where its time has been spent if requested
+    startup_profile_.markFirstEvent();
+    if(global_config.get<bool>("print_startup_profile", false)) {
+        startup_profile_.print(10);
+    }
+
+    // Sample different limits of the events in flight during the first events if requested, keeping the fastest one
+    std::vector<unsigned int> tune_limits;
+    std::vector<double> tune_rates;
+    unsigned int tune_events = 0;
+    if(global_config.get<bool>("auto_tune", false)) {
+        tune_events = global_config.get<unsigned int>("auto_tune_events", 50u);
+        if(tune_events == 0) {
+            throw InvalidValueError(
+                global_config, "auto_tune_events", "number of events per sampled setting should be strictly positive");
+        }
+        // Powers of two below the number of workers restrict the number of busy workers, larger limits add lookahead
+        for(unsigned int limit = 1; limit < threads_num; limit *= 2) {
+            tune_limits.push_back(limit);
+        }
+        for(unsigned int factor : {1u, 2u, 4u}) {
+            tune_limits.push_back(factor * threads_num);
+        }
+        if(threads_num == 0) {
+            LOG(WARNING) << "Auto-tuning requires multithreading to be enabled, ignoring";
+            tune_limits.clear();
+        } else if(benchmark_event != 0) {
+            LOG(WARNING) << "Auto-tuning cannot be combined with a benchmark, ignoring";
+            tune_limits.clear();
+        } else if(static_cast<uint64_t>(tune_events) * tune_limits.size() >= number_of_events) {
+            LOG(WARNING) << "Auto-tuning requires more than " << tune_events * tune_limits.size() << " events, ignoring";
+            tune_limits.clear();
+        } else {
+            LOG(STATUS) << "Auto-tuning the number of events in flight over the first "
+                        << tune_events * tune_limits.size() << " events";
+        }
+    }
+    auto tune_start = std::chrono::steady_clock::now();
+
+    ThreadPool::TaskGroup events;
+    BenchmarkSnapshot benchmark_start;
+    for(unsigned int i = first_event; i <= end_event; ++i) {
+        // Check for termination
+        if(terminate_) {
+            break;
+        }
+
+        // Measure the event rate of the previous setting and continue with the next one, or select the fastest one
+        if(!tune_limits.empty() && (i - first_event) % tune_events == 0) {
+            auto sample = (i - first_event) / tune_events;
+            if(sample > 0) {
+                wait_for_events(*thread_pool, events, end_event);
+                auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - tune_start).count();
+                tune_rates.push_back(elapsed > 0 ? tune_events / elapsed : 0.);
+                LOG(INFO) << "Auto-tuning: " << tune_limits[sample - 1] << " events in flight processed "
+                          << tune_rates.back() << " events/s";
+            }
+            if(sample < tune_limits.size()) {
+                max_buffered_events_ = tune_limits[sample];
+                tune_start = std::chrono::steady_clock::now();
+            } else {
+                auto best = static_cast<size_t>(
+                    std::distance(tune_rates.begin(), std::max_element(tune_rates.begin(), tune_rates.end())));
+                max_buffered_events_ = tune_limits[best];
+                LOG(STATUS) << "Auto-tuning selected " << max_buffered_events_ << " events in flight with "
+                            << tune_rates[best] << " events/s, set max_buffered_events to reuse this setting";
+                tune_limits.clear();
+            }
+        }
+
+        // Finish the warm-up events before starting the timed events of a benchmark
+        if(i == benchmark_event) {
+            wait_for_events(*thread_pool, events, end_event);
+            benchmark_start = benchmark_snapshot();
+            AllocationCounter::setEnabled(true);
+        }
+
+        // Wait until there is room for another event in flight
+        {
+            std::unique_lock<std::mutex> lock(event_mutex_);
+            if(buffered_events_ < max_buffered_events_ && !can_start_event()) {
+                ++throttled_events_;
+            }
+            event_condition_.wait(lock, [this]() { return can_start_event() || abort_; });
+            if(abort_) {
+                break;
+            }
+            ++buffered_events_;
+            ++started_events_;
+        }
+
+        LOG_PROGRESS(STATUS, "EVENT_LOOP") << "Running event " << i << " of " << end_event;
+
+        // Seed of the event is always drawn in order of the event sequence
+        auto event_function =
+            [this, &thread_pool, &events, dataflow_scheduling, event_num = i, seed = event_seeder(), end_event]() {
+                if(dataflow_scheduling) {
+                    run_event_dataflow(*thread_pool, event_num, seed, end_event);
+                } else {
+                    auto event = std::make_shared<Event>(event_num, seed);
+                    event->release_early_ = release_messages_early_;
+                    run_event(*thread_pool, events, event, modules_.begin(), end_event);
+                }
+            };
+        ++submitted_events;
+
+        if(threads_num == 0) {
+            // Execute the event directly
+            event_function();
+        } else {
+            // Submit the event to the workers
+            thread_pool->submit_event(events, i, event_function);
+        }
+    }
+
+    // Finish executing the last remaining events and drop all events which are still parked after an abort
+    {
+        std::lock_guard<std::mutex> lock(event_mutex_);
+        starting_events_ = false;
+    }
+    wait_for_events(*thread_pool, events, end_event);
+    parked_modules_.clear();
+    batches_.clear();
+    metrics_thread.reset();
+    Log::setAsynchronous(false);
+    if(batch_exception_) {
+        std::rethrow_exception(batch_exception_);
+    }
+    if(benchmark_start.valid) {
+        report_benchmark(benchmark_start, warmup_events);
+    } else if(benchmark_event > 0) {
+        LOG(WARNING) << "Benchmark interrupted during the warm-up events, no timed events to report";
+    }
+
+    // Write the trace after all tasks are finished, as every thread records without locking
+    if(tracer_ != nullptr) {
+        thread_pool->tracer_ = nullptr;
+        tracer_->write(trace_path);
+        tracer_.reset();
+        LOG(DEBUG) << "Wrote trace of the event loop to file " << trace_path;
+    }
+
+    // Store the last checkpoint to be able to resume after a request to terminate
+    if(!checkpoint_file_.empty()) {
+        std::lock_guard<std::mutex> lock(event_mutex_);
+        write_checkpoint();
+    }
+
+    // Update the number of events if the run was interrupted
+    if(terminate_) {
+        number_of_events = std::min(submitted_events, last_event_.load() - first_event + 1);
+        LOG(INFO) << "Interrupting event loop after " << number_of_events << " events because of request to terminate";
+        global_config.set<unsigned int>("number_of_events", number_of_events);
+    }
+    LOG_PROGRESS(STATUS, "EVENT_LOOP") << "Finished run of " << number_of_events << " events";
+    if(aborted_events_ > 0) {
+        LOG(STATUS) << "Skipped the remaining modules of " << aborted_events_ << " aborted events";
+    }
+    if(throttled_events_ > 0) {
+        LOG(INFO) << "Delayed the start of " << throttled_events_
+                  << " events because the memory of the buffered messages exceeded the limit";
+    }
+    std::string skipped_modules;
+    for(auto& module : modules_) {
+        module->record_receivers_ = false;
+        if(module->skipped_) {
+            skipped_modules += (skipped_modules.empty() ? "" : ", ") + module->getUniqueName();
+        }
+    }
+    if(!skipped_modules.empty()) {
+        LOG(STATUS) << "Skipped module instantiations without used messages: " << skipped_modules;
+    }
+    auto end_time = std::chrono::steady_clock::now();
+    total_time_ += static_cast<std::chrono::duration<long double>>(end_time - start_time).count();
+
+    // Remove pool from modules, wait for the threads to finish and destroy pool
+    LOG(TRACE) << "Destroying thread pool";
+    for(auto& module : modules_) {
+        module->set_thread_pool(nullptr);
+    }
+    thread_pool.reset();
+    assert(thread_pool.use_count() == 0);
+}
+
+/**
+ * Modules without parallelization are executed in order of the event sequence. If such a module has not finished the
+ * previous event yet, the remainder of this event is parked and the worker is released to process other events. The event
+ * is resubmitted by the previous event as soon as it releases the module, such that events flow through the sequential
+ * modules like through the stages of a pipeline. All events after an event in which the end of the run has been requested
+ * are discarded.
+ */
+void ModuleManager::run_event(ThreadPool& thread_pool,
+                              ThreadPool::TaskGroup& events,
+                              const std::shared_ptr<Event>& event,
+                              ModuleList::iterator module_iter,
+                              unsigned int number_of_events) {
+    auto number = event->getNumber();
+
+    try {
+        for(; module_iter != modules_.end(); ++module_iter) {
+            auto* module = module_iter->get();
+            bool sequential = !module->canParallelize();
+
+            // Park the remainder of the event if the module is not available for this event yet
+            if(sequential) {
+                std::lock_guard<std::mutex> lock(event_mutex_);
+                if(module_next_event_[module] != number && !abort_ && number <= last_event_) {
+                    parked_modules_[module][number] = [this, &thread_pool, &events, event, module_iter, number_of_events]() {
+                        thread_pool.submit_event(events, event->getNumber(), [=, &thread_pool, &events]() {
+                            run_event(thread_pool, events, event, module_iter, number_of_events);
+                        });
+                    };
+                    return;
+                }
+            }
+            // Discard the remainder of this event if the run was ended earlier
+            if(abort_ || number > last_event_) {
+                break;
+            }
+
+            // Collect the event in the batch of the module, the event completing the batch runs it for all of its events
+            if(module->execution_.batch_events > 1) {
+                std::unique_lock<std::mutex> lock(event_mutex_);
+                auto& batch = batches_[module];
+                ++batch.reached;
+                bool collected = (!event->aborted_ && !module->skipped_);
+                if(collected) {
+                    auto next_iter = std::next(module_iter);
+                    batch.events.emplace_back(event, [this, &thread_pool, &events, event, next_iter, number_of_events]() {
+                        thread_pool.submit_event(events, event->getNumber(), [=, &thread_pool, &events]() {
+                            run_event(thread_pool, events, event, next_iter, number_of_events);
+                        });
+                    });
+                }
+                if(batch_ready(module)) {
+                    auto ready = std::move(batch.events);
+                    batch.events.clear();
+                    lock.unlock();
+                    run_batch(module, std::move(ready), number_of_events);
+                } else {
+                    lock.unlock();
+                }
+                if(collected) {
+                    return;
+                }
+                if(release_messages_early_) {
+                    module->release_messages(event.get());
+                }
+                continue;
+            }
+
+            // Skip the modules after a module aborted the event, sequential modules are still released in order
+            if(!event->aborted_ && !module->skipped_) {
+                run_module(module, *event, number_of_events);
+            }
+            // Free the messages of which this module was the last receiver, also if the module has been skipped
+            if(release_messages_early_) {
+                module->release_messages(event.get());
+            }
+
+            // Release the module for the next event
+            if(sequential) {
+                release_module(module, number);
+            }
+        }
+    } catch(...) {
+        // Release all other events waiting for a module and stop the event loop
+        std::lock_guard<std::mutex> lock(event_mutex_);
+        abort_ = true;
+        --buffered_events_;
+        event->release_message_bytes();
+        resume_discarded_events();
+        event_condition_.notify_all();
+        throw;
+    }
+
+    // Signal that another event can be started
+    std::lock_guard<std::mutex> lock(event_mutex_);
+    if(!abort_ && number <= last_event_) {
+        finish_event(*event);
+    }
+    --buffered_events_;
+    event->release_message_bytes();
+    event_condition_.notify_all();
+}
+
+/**
+ * Every module instantiation is submitted as a task as soon as all module instantiations it depends on have finished this
+ * event. Sequential modules which are not yet available for this event are not waited for, instead the task is parked and
+ * resubmitted by the previous event when it releases the module. This ensures that no task of the pool ever blocks. The
+ * thread of the event only waits for parked modules when no other task of the event is left, such that the oldest event in
+ * progress can always continue. Modules are skipped, but still released, for events after the end of the run.
+ */
+void ModuleManager::run_event_dataflow(ThreadPool& thread_pool,
+                                       unsigned int number,
+                                       uint64_t seed,
+                                       unsigned int number_of_events) {
+    Event event(number, seed);
+    event.release_early_ = release_messages_early_;
+
+    // Number of unfinished dependencies of every module instantiation, and the total number of unfinished instantiations
+    std::vector<std::atomic<unsigned int>> remaining(module_order_.size());
+    for(size_t idx = 0; idx < module_order_.size(); ++idx) {
+        remaining[idx] = static_cast<unsigned int>(module_dependencies_[idx].size());
+    }
+    std::atomic<size_t> unfinished{module_order_.size()};
+
+    // Every module instantiation gets its own random engine, as the modules of this event can run at the same time
+    std::vector<std::mt19937_64> random_engines(module_order_.size());
+    for(size_t idx = 0; idx < module_order_.size(); ++idx) {
+        std::seed_seq seed_seq({seed, static_cast<uint64_t>(idx)});
+        random_engines[idx].seed(seed_seq);
+    }
+    bool resumed = false;
+    std::exception_ptr exception_ptr;
+
+    ThreadPool::TaskGroup tasks;
+    std::function<void(size_t)> run_node;
+    auto submit_node = [&](size_t idx) {
+        if(module_workers_.empty()) {
+            thread_pool.submit(tasks, run_node, idx);
+        } else {
+            thread_pool.submit_to(tasks, module_workers_[idx], run_node, idx);
+        }
+    };
+    run_node = [&](size_t idx) {
+        auto* module = module_order_[idx];
+        bool sequential = !module->canParallelize();
+
+        // Park the module if it has not finished the previous event yet
+        if(sequential) {
+            std::lock_guard<std::mutex> lock(event_mutex_);
+            if(module_next_event_[module] != number) {
+                parked_modules_[module][number] = [&, idx]() {
+                    resumed = true;
+                    submit_node(idx);
+                };
+                return;
+            }
+        }
+
+        try {
+            if(!abort_ && number <= last_event_ && !event.aborted_ && !module->skipped_) {
+                run_module(module, event, number_of_events, &random_engines[idx]);
+            }
+            if(release_messages_early_) {
+                module->release_messages(&event);
+            }
+        } catch(...) {
+            // Store the first exception of this event and skip all remaining modules of all events
+            std::lock_guard<std::mutex> lock(event_mutex_);
+            if(!exception_ptr) {
+                exception_ptr = std::current_exception();
+            }
+            abort_ = true;
+        }
+
+        // Release the module for the next event and submit all dependent modules which are now ready
+        if(sequential) {
+            release_module(module, number);
+        }
+        for(auto dependent : module_dependents_[idx]) {
+            if(--remaining[dependent] == 0) {
+                submit_node(dependent);
+            }
+        }
+        if(--unfinished == 0) {
+            std::lock_guard<std::mutex> lock(event_mutex_);
+            event_condition_.notify_all();
+        }
+    };
+
+    // Start all modules without dependencies and wait until all modules have finished
+    for(size_t idx = 0; idx < module_order_.size(); ++idx) {
+        if(remaining[idx] == 0) {
+            submit_node(idx);
+        }
+    }
+    while(unfinished > 0) {
+        thread_pool.wait_for(tasks);
+
+        // All submitted tasks are done, wait for parked modules to be resubmitted
+        std::unique_lock<std::mutex> lock(event_mutex_);
+        event_condition_.wait(lock, [&]() { return unfinished == 0 || resumed; });
+        resumed = false;
+    }
+
+    // Signal that another event can be started and propagate exceptions
+    std::lock_guard<std::mutex> lock(event_mutex_);
+    if(!exception_ptr && !abort_ && number <= last_event_) {
+        finish_event(event);
+    }
+    --buffered_events_;
+    event.release_message_bytes();
+    event_condition_.notify_all();
+    if(exception_ptr) {
+        std::rethrow_exception(exception_ptr);
+    }
+}
+
+/**
+ * A detector module only receives messages of its own detector. It can therefore only depend on the unique modules and the
+ * modules of the same detector executed before it, assuming that detector modules only dispatch messages for their own
+ * detector. Multi-detector modules are treated likewise for all of their detectors. Unique modules can receive messages for
+ * all detectors and depend on all modules executed before them.
+ */
+void ModuleManager::build_dependencies() {
+    module_order_.clear();
+    for(auto& module : modules_) {
+        module_order_.push_back(module.get());
+    }
+
+    module_dependencies_.assign(module_order_.size(), {});
+    module_dependents_.assign(module_order_.size(), {});
+    for(size_t idx = 0; idx < module_order_.size(); ++idx) {
+        const auto& detectors = module_order_[idx]->getDetectors();
+        for(size_t prev = 0; prev < idx; ++prev) {
+            const auto& prev_detectors = module_order_[prev]->getDetectors();
+            if(!detectors.empty() && !prev_detectors.empty() &&
+               std::none_of(detectors.begin(), detectors.end(), [&](const std::shared_ptr<Detector>& detector) {
+                   return std::any_of(prev_detectors.begin(),
+                                      prev_detectors.end(),
+                                      [&](const std::shared_ptr<Detector>& prev_detector) {
+                                          return detector->getName() == prev_detector->getName();
+                                      });
+               })) {
+                continue;
+            }
+            module_dependencies_[idx].push_back(prev);
+            module_dependents_[prev].push_back(idx);
+        }
+        LOG(DEBUG) << "Module " << module_order_[idx]->get_identifier().getUniqueName() << " depends on "
+                   << module_dependencies_[idx].size() << " previous module instantiation(s)";
+    }
+}
+
+/**
+ * Instantiations are distributed over the workers round-robin in the order of execution. With the affinity per detector, all
+ * instantiations of a detector share the worker assigned to the detector, while unique modules are not bound to any worker.
+ * Consecutive workers are pinned to the CPUs of the same NUMA node, such that the data of a detector stays on its node.
+ */
+void ModuleManager::assign_module_workers(bool per_detector, unsigned int workers) {
+    std::map<std::string, unsigned int> detector_workers;
+    unsigned int next_worker = 0;
+    module_workers_.assign(module_order_.size(), workers);
+    for(size_t idx = 0; idx < module_order_.size(); ++idx) {
+        const auto& detectors = module_order_[idx]->getDetectors();
+        if(!per_detector) {
+            module_workers_[idx] = next_worker++ % workers;
+        } else if(!detectors.empty()) {
+            auto iter = detector_workers.emplace(detectors.front()->getName(), next_worker % workers);
+            if(iter.second) {
+                ++next_worker;
+            }
+            module_workers_[idx] = iter.first->second;
+        }
+        if(module_workers_[idx] < workers) {
+            LOG(DEBUG) << "Module " << module_order_[idx]->get_identifier().getUniqueName() << " prefers worker "
+                       << module_workers_[idx];
+        }
+    }
+    LOG(INFO) << "Running the module instantiations " << (per_detector ? "of every detector " : "")
+              << "preferably on the same worker";
+}
+
+/**
+ * The check of the delegates, the forwarding of the messages and the reset of the delegates are only done for modules
+ * without parallelization, as modules with parallelization fetch their messages directly from the event.
+ */
+void ModuleManager::run_module(Module* module,
+                               Event& event,
+                               unsigned int number_of_events,
+                               std::mt19937_64* random_engine) {
+    bool sequential = !module->canParallelize();
+    auto number = event.getNumber();
+    const auto& execution = module->execution_;
+
+    LOG_PROGRESS(TRACE, "EVENT_LOOP") << "Running event " << number << " of " << number_of_events << " ["
+                                      << module->get_identifier().getUniqueName() << "]";
+
+    // Check if module is satisfied to run
+    if(execution.check_delegates && !module->check_delegates(&event)) {
+        LOG(TRACE) << "Not all required messages are received for " << module->get_identifier().getUniqueName()
+                   << ", skipping module!";
+        return;
+    }
+
+    // Get current time
+    auto start = std::chrono::steady_clock::now();
+    // Set run module section header, keeping the previous header to restore it afterwards
+    std::string old_section_name = execution.section_name;
+    Log::swapSection(old_section_name);
+    // Set module specific settings
+    LogLevel old_level = Log::getReportingLevel();
+    if(execution.set_log_level && execution.log_level != old_level) {
+        Log::setReportingLevel(execution.log_level);
+    }
+    LogFormat old_format = Log::getFormat();
+    if(execution.set_log_format && execution.log_format != old_format) {
+        Log::setFormat(execution.log_format);
+    }
+    if(sequential) {
+        // DEPRECATED: Switching to the directory should be removed, but can break current modules
+        module->getROOTDirectory()->cd();
+        // Forward the messages of this event to the module
+        module->current_event_ = &event;
+        module->forward_messages(&event);
+    }
+    // Run module, using the engine of the instantiation as random engine of the event if provided
+    auto* old_random_engine = Event::module_random_engine_;
+    if(random_engine != nullptr) {
+        Event::module_random_engine_ = random_engine;
+    }
+    // Count the bytes dispatched by this module separately, as the thread can execute other modules while it waits for tasks
+    auto old_dispatched_bytes = Event::dispatched_bytes_;
+    Event::dispatched_bytes_ = 0;
+    auto start_memory = (measure_resident_memory_ ? resident_memory() : 0);
+    auto run_start = std::chrono::steady_clock::now();
+    try {
+        PROFILER_EVENT_RANGE(execution.section_name.c_str(), number);
+        module->run(&event);
+        Event::module_random_engine_ = old_random_engine;
+    } catch(EndOfRunException& e) {
+        Event::module_random_engine_ = old_random_engine;
+        // Terminate if the module threw the EndOfRun request exception:
+        LOG(WARNING) << "Request to terminate:" << std::endl << e.what();
+        std::lock_guard<std::mutex> lock(event_mutex_);
+        last_event_ = std::min(last_event_.load(), number);
+        terminate_ = true;
+        resume_discarded_events();
+        event_condition_.notify_all();
+    } catch(AbortEventException& e) {
+        Event::module_random_engine_ = old_random_engine;
+        // Skip all following modules for this event only
+        LOG(DEBUG) << "Aborting event " << number << ":" << std::endl << e.what();
+        event.aborted_ = true;
+        ++aborted_events_;
+    } catch(...) {
+        Event::module_random_engine_ = old_random_engine;
+        Event::dispatched_bytes_ = old_dispatched_bytes;
+        throw;
+    }
+    auto run_end = std::chrono::steady_clock::now();
+    auto event_bytes = Event::dispatched_bytes_;
+    Event::dispatched_bytes_ = old_dispatched_bytes;
+    if(update_maximum(module->message_bytes_event_peak_, event_bytes)) {
+        LOG(DEBUG) << "Largest event so far of " << module->get_identifier().getUniqueName() << ": event " << number
+                   << " with " << bytes_to_size(event_bytes) << " of dispatched messages";
+    }
+    if(measure_resident_memory_) {
+        // Only increases are accounted, with multiple workers they include the memory allocated by concurrent modules
+        auto end_memory = resident_memory();
+        auto increase = (end_memory > start_memory ? end_memory - start_memory : 0);
+        module->statistics_.getCounter("resident_memory_increase") += increase;
+        update_maximum(module->statistics_.getCounter("resident_memory_increase_peak"), increase);
+    }
+    if(sequential) {
+        // Reset the delegates for the next event
+        if(execution.reset_delegates) {
+            LOG(TRACE) << "Resetting messages";
+            module->reset_delegates();
+        }
+        module->current_event_ = nullptr;
+    }
+    // Reset logging
+    Log::swapSection(old_section_name);
+    if(Log::getReportingLevel() != old_level) {
+        Log::setReportingLevel(old_level);
+    }
+    if(Log::getFormat() != old_format) {
+        Log::setFormat(old_format);
+    }
+    // Update execution time and the time spent by the framework around the module
+    auto end = std::chrono::steady_clock::now();
+    auto duration = static_cast<std::chrono::duration<long double>>(end - start).count();
+    module->statistics_.addEventTime(duration);
+    framework_overhead_ns_ += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>((end - start) - (run_end - run_start)).count());
+    ++module_executions_;
+    if(tracer_ != nullptr) {
+        tracer_->span(module->get_identifier().getUniqueName(), "module", number, start, end);
+    }
+    event.module_time_ns_ +=
+        static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    std::lock_guard<std::mutex> lock(time_mutex_);
+    module_execution_time_[module] += duration;
+}
+
+/**
+ * The module is run for all events of the batch which have not been discarded in the meantime. Afterwards, the remainder of
+ * every event of the batch is submitted again, including the discarded events which finish directly. Exceptions are stored
+ * instead of being thrown, as the remainders of the other events of the batch would otherwise never be submitted.
+ */
+void ModuleManager::run_batch(Module* module,
+                              std::vector<std::pair<std::shared_ptr<Event>, std::function<void()>>> batch,
+                              unsigned int number_of_events) {
+    const auto& execution = module->execution_;
+
+    std::vector<Event*> batch_events;
+    for(auto& entry : batch) {
+        auto* event = entry.first.get();
+        if(!abort_ && event->getNumber() <= last_event_ && (!execution.check_delegates || module->check_delegates(event))) {
+            batch_events.push_back(event);
+        }
+    }
+    std::sort(batch_events.begin(), batch_events.end(), [](const Event* lhs, const Event* rhs) {
+        return lhs->getNumber() < rhs->getNumber();
+    });
+
+    if(!batch_events.empty()) {
+        auto first_number = batch_events.front()->getNumber();
+        auto last_number = batch_events.back()->getNumber();
+        LOG_PROGRESS(TRACE, "EVENT_LOOP") << "Running events " << first_number << " to " << last_number << " of "
+                                          << number_of_events << " as batch of " << batch_events.size() << " events ["
+                                          << module->get_identifier().getUniqueName() << "]";
+
+        auto start = std::chrono::steady_clock::now();
+        std::string old_section_name = execution.section_name;
+        Log::swapSection(old_section_name);
+        LogLevel old_level = Log::getReportingLevel();
+        if(execution.set_log_level && execution.log_level != old_level) {
+            Log::setReportingLevel(execution.log_level);
+        }
+        LogFormat old_format = Log::getFormat();
+        if(execution.set_log_format && execution.log_format != old_format) {
+            Log::setFormat(execution.log_format);
+        }
+        auto old_dispatched_bytes = Event::dispatched_bytes_;
+        try {
+            PROFILER_EVENT_RANGE(execution.section_name.c_str(), first_number);
+            module->runBatch(batch_events);
+        } catch(EndOfRunException& e) {
+            // Terminate after the last event of the batch
+            LOG(WARNING) << "Request to terminate:" << std::endl << e.what();
+            std::lock_guard<std::mutex> lock(event_mutex_);
+            last_event_ = std::min(last_event_.load(), last_number);
+            terminate_ = true;
+            resume_discarded_events();
+            event_condition_.notify_all();
+        } catch(AbortEventException& e) {
+            // Skip all following modules for all events of the batch
+            LOG(DEBUG) << "Aborting events " << first_number << " to " << last_number << ":" << std::endl << e.what();
+            for(auto* event : batch_events) {
+                event->aborted_ = true;
+            }
+            aborted_events_ += static_cast<unsigned int>(batch_events.size());
+        } catch(...) {
+            // Keep the first exception and discard all remaining events
+            std::lock_guard<std::mutex> lock(event_mutex_);
+            if(!batch_exception_) {
+                batch_exception_ = std::current_exception();
+            }
+            abort_ = true;
+            resume_discarded_events();
+            event_condition_.notify_all();
+        }
+        Event::dispatched_bytes_ = old_dispatched_bytes;
+        Log::swapSection(old_section_name);
+        if(Log::getReportingLevel() != old_level) {
+            Log::setReportingLevel(old_level);
+        }
+        if(Log::getFormat() != old_format) {
+            Log::setFormat(old_format);
+        }
+
+        // Share the execution time equally between the events of the batch
+        auto end = std::chrono::steady_clock::now();
+        auto duration = static_cast<std::chrono::duration<long double>>(end - start).count();
+        auto event_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) /
+                        batch_events.size();
+        for(auto* event : batch_events) {
+            module->statistics_.addEventTime(duration / static_cast<long double>(batch_events.size()));
+            event->module_time_ns_ += event_ns;
+        }
+        ++module_executions_;
+        if(tracer_ != nullptr) {
+            tracer_->span(module->get_identifier().getUniqueName(), "module", first_number, start, end);
+        }
+        std::lock_guard<std::mutex> lock(time_mutex_);
+        module_execution_time_[module] += duration;
+    }
+
+    // Continue all events of the batch with the next module
+    for(auto& entry : batch) {
+        if(release_messages_early_) {
+            module->release_messages(entry.first.get());
+        }
+        entry.second();
+    }
+}
+
+/**
+ * A batch is run as soon as it is full. A batch which is not full yet is also run if all events started so far have reached
+ * the module and the event loop cannot start another event before one of the collected events is finished, as the batch
+ * would otherwise wait forever.
+ */
+bool ModuleManager::batch_ready(Module* module) {
+    auto& batch = batches_[module];
+    if(batch.events.empty()) {
+        return false;
+    }
+    return batch.events.size() >= module->execution_.batch_events ||
+           (batch.reached == started_events_ && !can_start_event());
+}
+
+/**
+ * A single event can always be started, as the memory of the messages is only released when an event is finished
+ */
+bool ModuleManager::can_start_event() const {
+    if(!starting_events_ || buffered_events_ >= max_buffered_events_) {
+        return false;
+    }
+    return max_buffered_memory_ == 0 || buffered_events_ == 0 || Event::buffered_message_bytes_ < max_buffered_memory_;
+}
+
+/**
+ * Events collected in a batch are not tasks of the pool, such that the pool can be idle while batches are still waiting for
+ * further events, for example if the run has been interrupted. These batches are run as tasks until no event is left.
+ */
+void ModuleManager::wait_for_events(ThreadPool& thread_pool, ThreadPool::TaskGroup& events, unsigned int number_of_events) {
+    thread_pool.wait_for(events);
+    while(true) {
+        std::vector<std::pair<Module*, std::vector<std::pair<std::shared_ptr<Event>, std::function<void()>>>>> pending;
+        {
+            std::lock_guard<std::mutex> lock(event_mutex_);
+            for(auto& batch : batches_) {
+                if(!batch.second.events.empty()) {
+                    pending.emplace_back(batch.first, std::move(batch.second.events));
+                    batch.second.events.clear();
+                }
+            }
+        }
+        if(pending.empty()) {
+            return;
+        }
+        for(auto& batch : pending) {
+            auto priority = batch.second.front().first->getNumber();
+            thread_pool.submit_event(
+                events, priority, [this, module = batch.first, ready = std::move(batch.second), number_of_events]() {
+                    run_batch(module, ready, number_of_events);
+                });
+        }
+        thread_pool.wait_for(events);
+    }
+}
+
+/**
+ * A module parked by the next event in the dataflow scheduling is resubmitted directly
+ */
+void ModuleManager::release_module(Module* module, unsigned int number) {
+    std::lock_guard<std::mutex> lock(event_mutex_);
+    ++module_next_event_[module];
+
+    auto& parked = parked_modules_[module];
+    auto next = parked.find(number + 1);
+    if(next != parked.end()) {
+        auto resume = std::move(next->second);
+        parked.erase(next);
+        resume();
+    }
+    event_condition_.notify_all();
+}
+
+/**
+ * Events can finish out of order when processed by multiple workers. The checkpoint only covers the events up to the first
+ * one which is not finished yet, such that all events after the checkpoint still have to be simulated when resuming.
+ */
+void ModuleManager::finish_event(const Event& event) {
+    auto number = event.number_;
+    ++finished_event_count_;
+    if(estimate_total_events_ > 0) {
+        estimate_event_time_.push_back(static_cast<long double>(event.module_time_ns_) * 1e-9l);
+        estimate_event_bytes_.push_back(static_cast<long double>(event.message_bytes_));
+    }
+    if(number == analysis_event_) {
+        analyze_receivers();
+    }
+    if(checkpoint_file_.empty()) {
+        return;
+    }
+    finished_events_.insert(number);
+    while(!finished_events_.empty() && *finished_events_.begin() == checkpoint_event_ + 1) {
+        finished_events_.erase(finished_events_.begin());
+        ++checkpoint_event_;
+    }
+    if(checkpoint_event_ - checkpoint_written_event_ >= checkpoint_interval_) {
+        write_checkpoint();
+    }
+}
+
+/**
+ * A module is used if it did not dispatch any message in the analyzed event, as it is either a sink like a writer or it has
+ * no messages to send in this event, or if any of its messages is received by a used module. All other modules only produce
+ * messages which never reach a used module, directly or through other modules.
+ */
+void ModuleManager::analyze_receivers() {
+    std::map<const BaseDelegate*, Module*> delegate_modules;
+    for(auto& module : modules_) {
+        for(auto& delegate : module->delegates_) {
+            delegate_modules[delegate.second] = module.get();
+        }
+    }
+
+    // Stop recording and mark all modules as used from which a module without dispatched messages can be reached
+    std::set<Module*> used;
+    std::map<Module*, std::set<Module*>> receivers;
+    for(auto& module : modules_) {
+        std::lock_guard<std::mutex> lock(module->receivers_mutex_);
+        module->record_receivers_ = false;
+        if(!module->dispatched_messages_) {
+            used.insert(module.get());
+        }
+        for(auto* delegate : module->message_receivers_) {
+            auto iter = delegate_modules.find(delegate);
+            if(iter != delegate_modules.end()) {
+                receivers[module.get()].insert(iter->second);
+            }
+        }
+        module->message_receivers_.clear();
+    }
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(auto& module : receivers) {
+            if(used.find(module.first) != used.end()) {
+                continue;
+            }
+            for(auto* receiver : module.second) {
+                if(used.find(receiver) != used.end()) {
+                    used.insert(module.first);
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    for(auto& module : modules_) {
+        if(used.find(module.get()) != used.end()) {
+            continue;
+        }
+        if(skip_unused_modules_) {
+            LOG(WARNING) << "Messages of " << module->getUniqueName() << " are not received by any used module, skipping "
+                         << "it for all following events";
+            module->skipped_ = true;
+        } else {
+            LOG(WARNING) << "Messages of " << module->getUniqueName() << " are not received by any used module";
+        }
+    }
+}
+
+/**
+ * The checkpoint is written to a temporary file which replaces the previous checkpoint afterwards, such that a run killed
+ * while writing always leaves a complete checkpoint behind.
+ */
+void ModuleManager::write_checkpoint() {
+    auto temporary_file = checkpoint_file_ + ".tmp";
+    {
+        std::ofstream file(temporary_file);
+        file << "# Allpix Squared checkpoint, resume with resume_from_checkpoint = \"" << checkpoint_file_ << "\"\n"
+             << "[Checkpoint]\n"
+             << "random_seed = " << checkpoint_seed_ << "\n"
+             << "last_event = " << checkpoint_last_event_ << "\n"
+             << "finished_event = " << checkpoint_event_ << "\n";
+        if(!file) {
+            LOG(WARNING) << "Cannot write checkpoint file " << temporary_file;
+            return;
+        }
+    }
+    if(std::rename(temporary_file.c_str(), checkpoint_file_.c_str()) != 0) {
+        LOG(WARNING) << "Cannot replace checkpoint file " << checkpoint_file_;
+        return;
+    }
+    checkpoint_written_event_ = checkpoint_event_;
+    LOG(DEBUG) << "Wrote checkpoint after event " << checkpoint_event_;
+}
+
+/**
+ * The event seeds only depend on the number of the event, resuming therefore simulates the remaining events identically to
+ * the interrupted run as long as the configuration and the random seed are not changed.
+ */
+void ModuleManager::resume_from_checkpoint(Configuration& global_config, const std::string& path) {
+    std::ifstream file(path);
+    ConfigReader reader(file, path);
+    auto checkpoints = reader.getConfigurations("checkpoint");
+    if(checkpoints.size() != 1) {
+        throw InvalidValueError(global_config, "resume_from_checkpoint", "file does not contain a single checkpoint");
+    }
+    auto& checkpoint = checkpoints.front();
+    if(checkpoint.get<uint64_t>("random_seed") != global_config.get<uint64_t>("random_seed")) {
+        throw InvalidValueError(
+            global_config, "resume_from_checkpoint", "random seed of the checkpoint differs from the configured seed");
+    }
+
+    auto finished_event = checkpoint.get<unsigned int>("finished_event");
+    auto last_event = checkpoint.get<unsigned int>("last_event");
+    if(finished_event > last_event) {
+        throw InvalidValueError(checkpoint, "finished_event", "finished event is beyond the last event of the run");
+    }
+    global_config.set<unsigned int>("first_event", finished_event + 1);
+    global_config.set<unsigned int>("number_of_events", last_event - finished_event);
+    LOG(STATUS) << "Resuming run after event " << finished_event << " of checkpoint " << path;
+}
+
+/**
+ * Parked events are resumed early if they are discarded, as the modules they are waiting for may never be released by the
+ * previous event. Resumed events either discard their remaining modules or park again if they still have to run.
+ */
+void ModuleManager::resume_discarded_events() {
+    for(auto& module : parked_modules_) {
+        auto& parked = module.second;
+        for(auto iter = parked.begin(); iter != parked.end();) {
+            if(abort_ || iter->first > last_event_) {
+                auto resume = std::move(iter->second);
+                iter = parked.erase(iter);
+                resume();
+            } else {
+                ++iter;
+            }
+        }
+    }
+    // Events collected in a batch are resumed likewise, the batch is run later for the remaining events
+    for(auto& module : batches_) {
+        auto& collected = module.second.events;
+        for(auto iter = collected.begin(); iter != collected.end();) {
+            if(abort_ || iter->first->getNumber() > last_event_) {
+                auto resume = std::move(iter->second);
+                iter = collected.erase(iter);
+                resume();
+            } else {
+                ++iter;
+            }
+        }
     }
-    thread_pool.reset();
-    assert(thread_pool.use_count() == 0);
 }
 
 static std::string seconds_to_time(long double seconds) {
@@ -742,35 +2284,90 @@ static std::string seconds_to_time(long double seconds) {
  * Sets the section header and logging settings before executing the  \ref Module::finalize() function. Reset the logging
  * after finalization. No method will be called after finalizing the module (except the destructor).
  */
+void ModuleManager::finalize_module(Module* module) {
+    LOG_PROGRESS(TRACE, "FINALIZE_LOOP") << "Finalizing " << module->get_identifier().getUniqueName();
+
+    // Get current time
+    auto start = std::chrono::steady_clock::now();
+    // Set finalize module section header
+    std::string old_section_name = Log::getSection();
+    std::string section_name = "F:";
+    section_name += module->get_identifier().getUniqueName();
+    Log::setSection(section_name);
+    // Set module specific settings
+    auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration());
+    // Change to our ROOT directory
+    module->getROOTDirectory()->cd();
+    // Finalize module
+    {
+        PROFILER_RANGE(section_name.c_str());
+        module->finalize();
+    }
+    // Remove the pointer to the ROOT directory after finalizing
+    module->set_ROOT_directory(nullptr);
+    // Remove the config manager
+    module->set_config_manager(nullptr);
+    // Reset logging
+    Log::setSection(old_section_name);
+    set_module_after(old_settings);
+    // Update execution time
+    auto end = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(time_mutex_);
+    module_execution_time_[module] += static_cast<std::chrono::duration<long double>>(end - start).count();
+}
+
+/**
+ * If parallel finalization is enabled, consecutive module instantiations which support it are finalized at the same time by
+ * a thread pool, each writing to and closing its dedicated ROOT file. All other module instantiations act as barriers and
+ * are finalized on their own in the configured order, writing to the main ROOT file.
+ */
 void ModuleManager::finalize() {
     auto start_time = std::chrono::steady_clock::now();
     LOG_PROGRESS(TRACE, "FINALIZE_LOOP") << "Finalizing module instantiations";
-    for(auto& module : modules_) {
-        LOG_PROGRESS(TRACE, "FINALIZE_LOOP") << "Finalizing " << module->get_identifier().getUniqueName();
 
-        // Get current time
-        auto start = std::chrono::steady_clock::now();
-        // Set finalize module section header
-        std::string old_section_name = Log::getSection();
-        std::string section_name = "F:";
-        section_name += module->get_identifier().getUniqueName();
-        Log::setSection(section_name);
-        // Set module specific settings
-        auto old_settings = set_module_before(module->get_identifier().getUniqueName(), module->get_configuration());
-        // Change to our ROOT directory
-        module->getROOTDirectory()->cd();
-        // Finalize module
-        module->finalize();
-        // Remove the pointer to the ROOT directory after finalizing
-        module->set_ROOT_directory(nullptr);
-        // Remove the config manager
-        module->set_config_manager(nullptr);
-        // Reset logging
-        Log::setSection(old_section_name);
-        set_module_after(old_settings);
-        // Update execution time
-        auto end = std::chrono::steady_clock::now();
-        module_execution_time_[module.get()] += static_cast<std::chrono::duration<long double>>(end - start).count();
+    // Only instantiations with a dedicated ROOT file can be finalized in parallel
+    auto in_parallel = [this](const std::unique_ptr<Module>& module) {
+        return module_files_.find(module->getUniqueName()) != module_files_.end();
+    };
+    auto finalize_function = [this](Module* module) {
+        finalize_module(module);
+        auto file = module_files_.find(module->getUniqueName());
+        if(file != module_files_.end()) {
+            file->second->Close();
+        }
+    };
+    std::unique_ptr<ThreadPool> thread_pool;
+    if(std::any_of(modules_.begin(), modules_.end(), in_parallel)) {
+        thread_pool = create_phase_thread_pool("finalization");
+    }
+
+    for(auto iter = modules_.begin(); iter != modules_.end();) {
+        // Select either a single module or all consecutive modules which can be finalized in parallel
+        auto batch_end = std::next(iter);
+        if(in_parallel(*iter)) {
+            while(batch_end != modules_.end() && in_parallel(*batch_end)) {
+                ++batch_end;
+            }
+        }
+
+        if(std::next(iter) == batch_end) {
+            finalize_function(iter->get());
+        } else {
+            LOG(DEBUG) << "Finalizing " << std::distance(iter, batch_end) << " module instantiations in parallel";
+            ThreadPool::TaskGroup group;
+            std::vector<std::future<void>> tasks;
+            for(auto module_iter = iter; module_iter != batch_end; ++module_iter) {
+                tasks.push_back(thread_pool->submit(
+                    group, [&finalize_function, module = module_iter->get()]() { finalize_function(module); }));
+            }
+
+            // Help finalizing and wait for all modules of the batch, rethrowing the first exception in module order
+            thread_pool->wait_for(group);
+            for(auto& task : tasks) {
+                task.get();
+            }
+        }
+        iter = batch_end;
     }
     // Close module ROOT file
     modules_file_->Close();
@@ -791,6 +2388,17 @@ void ModuleManager::finalize() {
                 << slowest_module;
     for(auto& module : modules_) {
         LOG(INFO) << " Module " << module->getUniqueName() << " took " << module_execution_time_[module.get()] << " seconds";
+        if(module->message_bytes_dispatched_ > 0) {
+            LOG(INFO) << " Module " << module->getUniqueName() << " dispatched "
+                      << bytes_to_size(module->message_bytes_dispatched_) << " of messages, at most "
+                      << bytes_to_size(module->message_bytes_event_peak_) << " in a single event";
+        }
+    }
+
+    if(module_executions_ > 0) {
+        LOG(INFO) << "Framework overhead of " << std::round(static_cast<double>(framework_overhead_ns_) / module_executions_)
+                  << " ns per module execution in the event loop, " << seconds_to_time(framework_overhead_ns_ * 1e-9l)
+                  << " in total";
     }
 
     Configuration& global_config = conf_manager_->getGlobalConfiguration();
@@ -801,6 +2409,262 @@ void ModuleManager::finalize() {
 
     LOG(STATUS) << "Average processing time is \x1B[1m" << processing_time << " ms/event\x1B[0m, event generation at \x1B[1m"
                 << std::round(global_config.get<double>("number_of_events") / total_time_) << " Hz\x1B[0m";
+
+    if(estimate_total_events_ > 0) {
+        report_estimate();
+    }
+
+    // Write the performance statistics of all modules if requested
+    if(global_config.has("statistics_file")) {
+        auto path = std::string(gSystem->pwd()) + "/" + global_config.get<std::string>("statistics_file");
+        write_statistics(path);
+    }
+}
+
+ModuleManager::BenchmarkSnapshot ModuleManager::benchmark_snapshot() {
+    BenchmarkSnapshot snapshot;
+    snapshot.valid = true;
+    snapshot.time = std::chrono::steady_clock::now();
+    snapshot.finished_events = finished_event_count_;
+    for(auto& module : modules_) {
+        snapshot.output_bytes[module.get()] = output_file_bytes(module.get());
+    }
+    std::lock_guard<std::mutex> lock(time_mutex_);
+    snapshot.module_time = module_execution_time_;
+    return snapshot;
+}
+
+uint64_t ModuleManager::output_file_bytes(Module* module) {
+    uint64_t bytes = 0;
+    std::lock_guard<std::mutex> lock(module->output_files_mutex_);
+    for(auto& file : module->output_files_) {
+        struct stat file_status {};
+        if(stat(file.c_str(), &file_status) == 0) {
+            bytes += static_cast<uint64_t>(file_status.st_size);
+        }
+    }
+    return bytes;
+}
+
+/**
+ * The steady-state rates are computed from the difference to the snapshot taken after the warm-up events. The allocations
+ * are only counted if the global allocation functions of the executable report to the AllocationCounter, and the peak
+ * resident memory includes the warm-up events and the initialization. The output rate of a module follows from the growth of
+ * its output files during the timed events relative to its own processing time, such that writers can be compared
+ * independently of the cost of the simulation. Data still buffered by the writers is not included, which is negligible if
+ * the timed events are long compared to the buffers.
+ */
+void ModuleManager::report_benchmark(const BenchmarkSnapshot& start, unsigned int warmup_events) {
+    auto end = benchmark_snapshot();
+    auto allocations = AllocationCounter::getCount();
+    AllocationCounter::setEnabled(false);
+
+    auto events = end.finished_events - start.finished_events;
+    auto seconds = static_cast<std::chrono::duration<double>>(end.time - start.time).count();
+    if(events == 0) {
+        LOG(WARNING) << "Benchmark interrupted before finishing any of the timed events";
+        return;
+    }
+
+    std::stringstream allocations_event;
+    if(AllocationCounter::isInstalled()) {
+        allocations_event << std::round(static_cast<double>(allocations) / events) << " allocations/event";
+    } else {
+        allocations_event << "allocations not counted";
+    }
+    LOG(STATUS) << "Benchmark of " << events << " events after " << warmup_events << " warm-up events: \x1B[1m"
+                << std::round(events / std::max(seconds, 1e-9)) << " events/s\x1B[0m, " << allocations_event.str()
+                << ", peak resident memory of " << bytes_to_size(peak_resident_memory());
+    auto module_time = [](const BenchmarkSnapshot& snapshot, Module* module) {
+        auto iter = snapshot.module_time.find(module);
+        return (iter != snapshot.module_time.end() ? iter->second : 0.0l);
+    };
+    for(auto& module : modules_) {
+        auto time = module_time(end, module.get()) - module_time(start, module.get());
+        std::stringstream output;
+        auto end_bytes = end.output_bytes[module.get()];
+        auto bytes = end_bytes - std::min(end_bytes, start.output_bytes.at(module.get()));
+        if(bytes > 0) {
+            output << ", wrote " << bytes_to_size(bytes) << " at "
+                   << bytes_to_size(static_cast<uint64_t>(static_cast<long double>(bytes) / std::max(time, 1e-9l))) << "/s";
+        }
+        LOG(STATUS) << " Module " << module->getUniqueName() << " took " << std::round(1e9l * time / events)
+                    << " ns/event (" << std::round(events / std::max(time, 1e-9l)) << " events/s)" << output.str();
+    }
+}
+
+/**
+ * The events of the sample are the first events of the full run, which are independent of each other as every event is
+ * seeded separately. The totals are projected linearly from the mean of the sample, the confidence intervals at 95% follow
+ * from the standard deviation of the time and the message bytes of the single events of the sample, including the correction
+ * for sampling without replacement from the finite number of events of the run. The size of the output files is assumed to
+ * grow linearly with the number of events, which overestimates files dominated by a fixed part like histograms. The peak
+ * resident memory is not scaled, as the number of events held in memory is bounded independently of the number of events.
+ */
+void ModuleManager::report_estimate() {
+    auto samples = estimate_event_time_.size();
+    if(samples < 2) {
+        LOG(WARNING) << "Too few events finished to estimate the cost of the full run";
+        return;
+    }
+    auto scale = static_cast<long double>(estimate_total_events_) / samples;
+
+    // Projected total with the half width of its confidence interval at 95%
+    auto project = [&](const std::vector<long double>& values) {
+        long double sum = 0, sum_squares = 0;
+        for(auto value : values) {
+            sum += value;
+            sum_squares += value * value;
+        }
+        auto mean = sum / samples;
+        auto variance = std::max(0.0l, (sum_squares - samples * mean * mean) / (samples - 1));
+        auto correction = std::max(0.0l, 1 - static_cast<long double>(samples) / estimate_total_events_);
+        auto error = 1.96l * std::sqrt(variance * correction / samples) * estimate_total_events_;
+        return std::make_pair(mean * estimate_total_events_, error);
+    };
+    auto time = project(estimate_event_time_);
+    auto bytes = project(estimate_event_bytes_);
+    LOG(STATUS) << "Estimated cost of " << estimate_total_events_ << " events from a sample of " << samples
+                << " events: \x1B[1m" << seconds_to_time(time.first) << " +/- " << seconds_to_time(time.second)
+                << " of module time\x1B[0m, " << bytes_to_size(static_cast<uint64_t>(bytes.first)) << " +/- "
+                << bytes_to_size(static_cast<uint64_t>(bytes.second)) << " of messages, peak resident memory of "
+                << bytes_to_size(peak_resident_memory());
+
+    uint64_t output_bytes = 0;
+    for(auto& module : modules_) {
+        std::stringstream counters;
+        for(auto& counter : module->statistics_.getCounterValues()) {
+            auto suffix = std::string("_peak");
+            auto& name = counter.first;
+            if(counter.second == 0 ||
+               (name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)) {
+                continue;
+            }
+            counters << ", " << name << " of " << std::round(static_cast<long double>(counter.second) / samples)
+                     << "/event";
+        }
+        auto module_output_bytes = output_file_bytes(module.get());
+        if(module_output_bytes > 0) {
+            counters << ", " << bytes_to_size(static_cast<uint64_t>(module_output_bytes * scale)) << " of output files";
+        }
+        output_bytes += module_output_bytes;
+        LOG(STATUS) << " Module " << module->getUniqueName() << " would take "
+                    << seconds_to_time(module->statistics_.getMeanEventTime() * estimate_total_events_) << counters.str();
+    }
+    if(output_bytes > 0) {
+        LOG(STATUS) << "Estimated size of all output files is "
+                    << bytes_to_size(static_cast<uint64_t>(output_bytes * scale));
+    }
+}
+
+/**
+ * The statistics are written in the JSON format, containing the total time of the run, the number of finished events, the
+ * peak resident memory of the process in bytes, the time to the first event with all entries of the startup profile and for
+ * every module instantiation the execution time, the number of events it has been run for, the mean, median and 99th
+ * percentile of the processing time per event and the values of all counters of the module. All times are given in seconds.
+ */
+void ModuleManager::write_statistics(const std::string& path) {
+    std::ofstream file(path);
+    if(!file) {
+        throw RuntimeError("Cannot write statistics file " + path);
+    }
+    LOG(STATUS) << "Writing performance statistics to file " << path;
+
+    file << "{" << std::endl;
+    file << "  \"total_time\": " << total_time_ << "," << std::endl;
+    file << "  \"events\": " << finished_event_count_.load() << "," << std::endl;
+    file << "  \"peak_resident_memory\": " << peak_resident_memory() << "," << std::endl;
+    file << "  \"time_to_first_event\": " << startup_profile_.getTimeToFirstEvent() << "," << std::endl;
+    file << "  \"startup\": [";
+    std::array<const char*, 4> categories{{"phase", "library", "construction", "initialization"}};
+    bool first_entry = true;
+    for(auto& entry : startup_profile_.getEntries()) {
+        file << (first_entry ? "" : ",") << std::endl;
+        first_entry = false;
+        file << "    {\"category\": \"" << categories[static_cast<size_t>(entry.category)] << "\", \"name\": \""
+             << entry.name << "\", \"time\": " << entry.time << "}";
+    }
+    file << std::endl << "  ]," << std::endl;
+    file << "  \"modules\": [";
+    bool first_module = true;
+    for(auto& module : modules_) {
+        auto& statistics = module->statistics_;
+        file << (first_module ? "" : ",") << std::endl;
+        first_module = false;
+
+        file << "    {" << std::endl;
+        file << "      \"name\": \"" << module->getUniqueName() << "\"," << std::endl;
+        file << "      \"execution_time\": " << module_execution_time_[module.get()] << "," << std::endl;
+        file << "      \"events\": " << statistics.getEventCount() << "," << std::endl;
+        file << "      \"event_time_mean\": " << statistics.getMeanEventTime() << "," << std::endl;
+        file << "      \"event_time_p50\": " << statistics.getEventTimePercentile(0.5) << "," << std::endl;
+        file << "      \"event_time_p99\": " << statistics.getEventTimePercentile(0.99) << "," << std::endl;
+        file << "      \"counters\": {";
+        bool first_counter = true;
+        for(auto& counter : statistics.getCounterValues()) {
+            file << (first_counter ? "" : ",") << std::endl;
+            first_counter = false;
+            file << "        \"" << counter.first << "\": " << counter.second;
+        }
+        file << (first_counter ? "" : "\n      ") << "}" << std::endl;
+        file << "    }";
+    }
+    file << std::endl << "  ]" << std::endl << "}" << std::endl;
+}
+
+/**
+ * Every line of the metrics file is a JSON object with the time since the start of the event loop, the number of finished
+ * events, the event rate and the share of the execution time spent in every module instantiation during the last interval,
+ * the number of events in flight and the resident memory of the process in bytes. All times are given in seconds.
+ */
+void ModuleManager::write_metrics(std::ofstream& file, std::chrono::duration<double> interval) {
+    auto start_time = std::chrono::steady_clock::now();
+    auto last_time = start_time;
+    unsigned int last_events = 0;
+    std::map<Module*, long double> last_execution_time;
+    {
+        std::lock_guard<std::mutex> lock(time_mutex_);
+        last_execution_time = module_execution_time_;
+    }
+
+    std::unique_lock<std::mutex> lock(metrics_mutex_);
+    bool stop = false;
+    while(!stop) {
+        stop = metrics_condition_.wait_for(lock, interval, [this]() { return metrics_stop_; });
+
+        auto now = std::chrono::steady_clock::now();
+        auto events = finished_event_count_.load();
+        auto elapsed = std::chrono::duration<double>(now - last_time).count();
+        unsigned int buffered_events = 0;
+        {
+            std::lock_guard<std::mutex> event_lock(event_mutex_);
+            buffered_events = buffered_events_;
+        }
+
+        file << "{\"time\": " << std::chrono::duration<double>(now - start_time).count() << ", \"events\": " << events
+             << ", \"event_rate\": " << (elapsed > 0 ? (events - last_events) / elapsed : 0.)
+             << ", \"buffered_events\": " << buffered_events << ", \"resident_memory\": " << resident_memory()
+             << ", \"module_time_share\": {";
+        {
+            std::lock_guard<std::mutex> time_lock(time_mutex_);
+            long double interval_time = 0;
+            for(auto& module : modules_) {
+                interval_time += module_execution_time_[module.get()] - last_execution_time[module.get()];
+            }
+            bool first_module = true;
+            for(auto& module : modules_) {
+                auto module_time = module_execution_time_[module.get()] - last_execution_time[module.get()];
+                file << (first_module ? "" : ", ") << "\"" << module->getUniqueName()
+                     << "\": " << (interval_time > 0 ? module_time / interval_time : 0.L);
+                first_module = false;
+            }
+            last_execution_time = module_execution_time_;
+        }
+        file << "}}\n" << std::flush;
+
+        last_time = now;
+        last_events = events;
+    }
 }
 
 /**
@@ -11,17 +11,26 @@
 #define ALLPIX_MODULE_MANAGER_H
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <functional>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <random>
+#include <set>
 
 #include <TDirectory.h>
 #include <TFile.h>
 
 #include "Module.hpp"
+#include "Statistics.hpp"
 #include "ThreadPool.hpp"
+#include "Tracer.hpp"
 #include "core/config/Configuration.hpp"
 #include "core/utils/log.h"
 
@@ -90,6 +99,15 @@ namespace allpix {
          */
         void run();
 
+        /**
+         * @brief Re-create the module instantiations from the first one with a changed configuration onwards
+         * @param messenger Pointer to the messenger to pass to the new instantiations
+         * @param geo_manager Pointer to the geometry manager to pass to the new instantiations
+         * @param changed Unique names of the instantiations with a changed configuration
+         * @warning Should be called after the \ref ModuleManager::init "init function" and before the next run
+         */
+        void reconfigure(Messenger* messenger, GeometryManager* geo_manager, const std::set<std::string>& changed);
+
         /**
          * @brief Finalize all modules after the event sequence
          * @warning Should be called after the \ref ModuleManager::init "run function"
@@ -102,6 +120,12 @@ namespace allpix {
          */
         void terminate();
 
+        /**
+         * @brief Get the profile of the startup, to which the framework adds the time of its own phases
+         * @return Reference to the startup profile started at the creation of the module manager
+         */
+        StartupProfile& getStartupProfile() { return startup_profile_; }
+
     private:
         /**
          * @brief Create unique modules
@@ -127,6 +151,48 @@ namespace allpix {
         std::vector<std::pair<ModuleIdentifier, Module*>>
         create_detector_modules(void*, Configuration&, Messenger*, GeometryManager*, std::mt19937_64& seeder);
 
+        /**
+         * @brief Create a single detector module for multiple detectors
+         * @param library Void pointer to the loaded library
+         * @param config Configuration of the module
+         * @param messenger Pointer to the messenger
+         * @param detectors Detectors selected for the module
+         * @param priority Priority of the selection of the detectors
+         * @param seeder Seeder used to construct the PRNG of the modules
+         * @return The multi-detector module together with its identifier
+         */
+        std::pair<ModuleIdentifier, Module*> create_multi_detector_module(void*,
+                                                                          Configuration&,
+                                                                          Messenger*,
+                                                                          const std::vector<std::shared_ptr<Detector>>&,
+                                                                          int priority,
+                                                                          std::mt19937_64& seeder);
+
+        /**
+         * @brief Create a thread pool for the initialization or finalization of module instantiations in parallel
+         * @param phase Name of the phase to report
+         * @return Thread pool with the configured number of workers
+         */
+        std::unique_ptr<ThreadPool> create_phase_thread_pool(const std::string& phase);
+
+        /**
+         * @brief Prepare a module instantiation for its initialization and create its ROOT directory
+         * @param module Module instantiation to prepare
+         */
+        void prepare_module_init(Module* module);
+
+        /**
+         * @brief Initialize a single module instantiation
+         * @param module Module instantiation to initialize
+         */
+        void init_module(Module* module);
+
+        /**
+         * @brief Finalize a single module instantiation and detach it from its ROOT directory and the config manager
+         * @param module Module instantiation to finalize
+         */
+        void finalize_module(Module* module);
+
         /**
          * @brief Set module specific log setting before running init/run/finalize
          */
@@ -136,7 +202,188 @@ namespace allpix {
          */
         void set_module_after(std::tuple<LogLevel, LogFormat> prev);
 
+        /**
+         * @brief Prepare the section header, the log settings and the delegate checks used to run a module in every event
+         * @param module Module instantiation to prepare
+         */
+        void prepare_execution(Module* module);
+
         using ModuleList = std::list<std::unique_ptr<Module>>;
+
+        /**
+         * @brief Run the module instantiations for a single event, starting at the given instantiation
+         * @param thread_pool Thread pool to resubmit the event to after it has been parked
+         * @param events Group of all events of the run
+         * @param event Event to run the modules for
+         * @param module_iter First module instantiation to run for the event
+         * @param number_of_events Number of the last event of the run (only used for logging)
+         */
+        void run_event(ThreadPool& thread_pool,
+                       ThreadPool::TaskGroup& events,
+                       const std::shared_ptr<Event>& event,
+                       ModuleList::iterator module_iter,
+                       unsigned int number_of_events);
+
+        /**
+         * @brief Run all module instantiations for a single event as tasks ordered by their dependencies
+         * @param thread_pool Thread pool to submit the module instantiations to
+         * @param number Number of the event in the event sequence
+         * @param seed Seed for the random engine of the event
+         * @param number_of_events Number of the last event of the run (only used for logging)
+         */
+        void run_event_dataflow(ThreadPool& thread_pool, unsigned int number, uint64_t seed, unsigned int number_of_events);
+
+        /**
+         * @brief Derive the dependencies between the module instantiations from the delivery rules of the messages
+         */
+        void build_dependencies();
+
+        /**
+         * @brief Assign a preferred worker to every module instantiation for the dataflow scheduling
+         * @param per_detector True if all instantiations of a detector should share the same worker
+         * @param workers Number of workers of the thread pool
+         */
+        void assign_module_workers(bool per_detector, unsigned int workers);
+
+        /**
+         * @brief Run a single module instantiation for an event
+         * @param module Module instantiation to run
+         * @param event Event to run the module for
+         * @param number_of_events Number of the last event of the run (only used for logging)
+         * @param random_engine Optional random engine of the module instantiation for this event
+         */
+        void run_module(Module* module,
+                        Event& event,
+                        unsigned int number_of_events,
+                        std::mt19937_64* random_engine = nullptr);
+
+        /**
+         * @brief Run a module instantiation for a batch of events and continue these events afterwards
+         * @param module Module instantiation to run
+         * @param batch Events of the batch with the functions submitting the remainder of every event
+         * @param number_of_events Number of the last event of the run (only used for logging)
+         *
+         * Exceptions are not propagated, the first one is stored and rethrown by the event loop after the run is aborted.
+         */
+        void run_batch(Module* module,
+                       std::vector<std::pair<std::shared_ptr<Event>, std::function<void()>>> batch,
+                       unsigned int number_of_events);
+
+        /**
+         * @brief Check if a batch of events should be run
+         * @param module Module instantiation collecting the batch
+         * @return True if the batch is full or if no further event can reach the module before one of the batch finishes
+         * @warning Should only be called while holding the event mutex
+         */
+        bool batch_ready(Module* module);
+
+        /**
+         * @brief Check if the event loop can start another event
+         * @return True if the limits of the number and the message memory of the buffered events are not reached
+         * @warning Should only be called while holding the event mutex
+         */
+        bool can_start_event() const;
+
+        /**
+         * @brief Wait until all submitted events are finished, running the batches still waiting for events
+         * @param thread_pool Thread pool processing the events
+         * @param events Group of all events of the run
+         * @param number_of_events Number of the last event of the run (only used for logging)
+         */
+        void wait_for_events(ThreadPool& thread_pool, ThreadPool::TaskGroup& events, unsigned int number_of_events);
+
+        /**
+         * @brief Release a module without parallelization for the next event
+         * @param module Module instantiation to release
+         * @param number Number of the event the module has finished
+         */
+        void release_module(Module* module, unsigned int number);
+
+        /**
+         * @brief Mark an event as finished and write a checkpoint if enough consecutive events have finished since the last
+         * @param event Finished event
+         * @warning Should only be called while holding the event mutex
+         */
+        void finish_event(const Event& event);
+
+        /**
+         * @brief Find the module instantiations whose messages are not received by any used module in the analyzed event,
+         * and skip them for all following events if requested
+         * @warning Should only be called while holding the event mutex
+         */
+        void analyze_receivers();
+
+        /**
+         * @brief Write the checkpoint of the events finished so far to the checkpoint file
+         * @warning Should only be called while holding the event mutex
+         */
+        void write_checkpoint();
+
+        /**
+         * @brief Continue an interrupted run after the last event of its checkpoint
+         * @param global_config Global configuration, updated with the remaining event range
+         * @param path Path of the checkpoint file to read
+         */
+        void resume_from_checkpoint(Configuration& global_config, const std::string& path);
+
+        /**
+         * @brief Resume all parked events which are discarded after an abort or a request to terminate
+         * @warning Should only be called while holding the event mutex
+         */
+        void resume_discarded_events();
+
+        /**
+         * @brief Write the performance statistics of all module instantiations to a file
+         * @param path Path of the file to write
+         */
+        void write_statistics(const std::string& path);
+
+        /**
+         * @brief Append the metrics of the running event loop to a file at a fixed interval until requested to stop
+         * @param file Output stream of the metrics file, lines are appended
+         * @param interval Time between two lines of metrics
+         *
+         * Executed by a separate thread while the events are processed, writes a last line when stopping.
+         */
+        void write_metrics(std::ofstream& file, std::chrono::duration<double> interval);
+
+        /**
+         * @brief State of the event loop at the start and at the end of the timed events of a benchmark
+         */
+        struct BenchmarkSnapshot {
+            bool valid{};
+            std::chrono::steady_clock::time_point time;
+            unsigned int finished_events{};
+            std::map<Module*, long double> module_time;
+            std::map<Module*, uint64_t> output_bytes;
+        };
+
+        /**
+         * @brief Take a snapshot of the finished events and the execution time of every module
+         * @return Snapshot of the current state of the event loop
+         */
+        BenchmarkSnapshot benchmark_snapshot();
+
+        /**
+         * @brief Get the current size of all output files created by a module
+         * @param module Module to get the size of the output files for
+         * @return Total size of the output files in bytes
+         */
+        static uint64_t output_file_bytes(Module* module);
+
+        /**
+         * @brief Report the steady-state performance of the timed events of a benchmark and stop counting allocations
+         * @param start Snapshot taken after the warm-up events
+         * @param warmup_events Number of warm-up events before the timed events
+         */
+        void report_benchmark(const BenchmarkSnapshot& start, unsigned int warmup_events);
+
+        /**
+         * @brief Report the cost of the full run projected from the simulated sample of events
+         * @warning Should only be called after finalizing the modules, such that their output files are complete
+         */
+        void report_estimate();
+
         using IdentifierToModuleMap = std::map<ModuleIdentifier, ModuleList::iterator>;
 
         ModuleList modules_;
@@ -145,10 +392,89 @@ namespace allpix {
         ConfigManager* conf_manager_;
 
         std::unique_ptr<TFile> modules_file_;
+        // Dedicated ROOT files of the instantiations finalized in parallel, by their unique name
+        bool parallel_finalization_{};
+        std::map<std::string, std::unique_ptr<TFile>> module_files_;
 
         std::map<Module*, long double> module_execution_time_;
+        std::mutex time_mutex_;
         long double total_time_{};
 
+        // Time spent in the startup until the first event
+        StartupProfile startup_profile_;
+
+        // Time spent by the framework around running the modules in the event loop
+        std::atomic<uint64_t> framework_overhead_ns_{};
+        std::atomic<uint64_t> module_executions_{};
+
+        // State of the event sequence shared between all workers
+        uint64_t event_seed_{};
+        std::map<Module*, unsigned int> module_next_event_;
+        unsigned int buffered_events_{};
+        unsigned int max_buffered_events_{};
+        unsigned int started_events_{};
+        bool starting_events_{};
+        // Soft limit of the memory of the messages of all buffered events, and the number of events delayed by it
+        uint64_t max_buffered_memory_{};
+        std::atomic<unsigned int> throttled_events_{};
+        std::atomic<unsigned int> last_event_{};
+        std::atomic<bool> abort_{false};
+        std::mutex event_mutex_;
+        std::condition_variable event_condition_;
+
+        // Checkpoints of the events finished in the order of the event sequence, to resume an interrupted run
+        std::string checkpoint_file_;
+        unsigned int checkpoint_interval_{};
+        unsigned int checkpoint_event_{};
+        unsigned int checkpoint_written_event_{};
+        unsigned int checkpoint_last_event_{};
+        uint64_t checkpoint_seed_{};
+        std::set<unsigned int> finished_events_;
+
+        // Metrics of the running event loop, appended to a file at a fixed interval
+        std::atomic<unsigned int> finished_event_count_{};
+        bool metrics_stop_{};
+        std::mutex metrics_mutex_;
+        std::condition_variable metrics_condition_;
+
+        // Number of events rejected by a module in the current run
+        std::atomic<unsigned int> aborted_events_{};
+
+        // Event after which the receivers of the dispatched messages are analyzed, and if unused modules are skipped
+        unsigned int analysis_event_{};
+        bool skip_unused_modules_{};
+
+        // Measure the increase of the resident memory during the execution of every module
+        bool measure_resident_memory_{};
+
+        // Release the messages of an event as soon as all modules receiving them have finished the event
+        bool release_messages_early_{};
+
+        // Number of events of the full run whose cost is estimated from the simulated events, and the module time and the
+        // message bytes of every finished event of the sample
+        unsigned int estimate_total_events_{};
+        std::vector<long double> estimate_event_time_;
+        std::vector<long double> estimate_event_bytes_;
+
+        // Tracer recording the execution in all threads if a trace of the event loop is requested
+        std::unique_ptr<Tracer> tracer_;
+
+        // Events waiting for a module without parallelization, and the dependencies between the module instantiations for
+        // the dataflow scheduling indexed in order of execution
+        std::map<Module*, std::map<unsigned int, std::function<void()>>> parked_modules_;
+        // Events collected by module instantiations running batches of events, and the number of events which reached them
+        struct Batch {
+            std::vector<std::pair<std::shared_ptr<Event>, std::function<void()>>> events;
+            unsigned int reached{};
+        };
+        std::map<Module*, Batch> batches_;
+        std::exception_ptr batch_exception_;
+        std::vector<Module*> module_order_;
+        std::vector<std::vector<size_t>> module_dependencies_;
+        std::vector<std::vector<size_t>> module_dependents_;
+        // Preferred worker of every module instantiation in order of execution, empty if the instantiations have no affinity
+        std::vector<unsigned int> module_workers_;
+
         std::map<std::string, void*> loaded_libraries_;
 
         std::atomic<bool> terminate_;
@@ -0,0 +1,61 @@
+/**
+ * @file
+ * @brief Registry of the modules linked into the executable in the monolithic build
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_STATIC_MODULES_H
+#define ALLPIX_STATIC_MODULES_H
+
+#include <map>
+#include <string>
+
+namespace allpix {
+    /**
+     * @brief Interface functions of a module linked into the executable, replacing the symbols of its library
+     *
+     * The functions are the ones defined in dynamic_module_impl.cpp, which are looked up with dlsym if the module is loaded
+     * from its library instead.
+     */
+    struct StaticModule {
+        void* is_unique{};
+        void* generator{};
+        void* multi_generator{};
+    };
+
+    /**
+     * @brief Get the registry of all modules linked into the executable
+     * @return Interface functions of the modules by the name of the module
+     *
+     * The registry is filled during the static initialization of the executable and is empty if the modules are built as
+     * separate libraries.
+     */
+    std::map<std::string, StaticModule>& static_modules();
+
+    /**
+     * @brief Registration of a module in the registry of the modules linked into the executable
+     *
+     * A single instance is defined for every module by dynamic_module_impl.cpp in the monolithic build.
+     */
+    class StaticModuleRegistration {
+    public:
+        /**
+         * @brief Add the module to the registry
+         * @param name Name of the module, as used in the configuration
+         * @param is_unique Function returning if the module is unique
+         * @param generator Function instantiating the module
+         * @param multi_generator Function instantiating a detector module for multiple detectors, not set for unique modules
+         */
+        StaticModuleRegistration(const std::string& name,
+                                 void* is_unique,
+                                 void* generator,
+                                 void* multi_generator = nullptr) {
+            static_modules()[name] = StaticModule{is_unique, generator, multi_generator};
+        }
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_STATIC_MODULES_H */
@@ -0,0 +1,131 @@
+/**
+ * @file
+ * @brief Implementation of the performance statistics of module instantiations
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "Statistics.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+#include "core/utils/log.h"
+#include "core/utils/unit.h"
+
+using namespace allpix;
+
+/**
+ * The elements of a std::map are never moved, such that references to the counters stay valid when new counters are added.
+ */
+StatisticsCounter& ModuleStatistics::getCounter(const std::string& name) {
+    std::lock_guard<std::mutex> lock(counter_mutex_);
+    return counters_[name];
+}
+
+std::map<std::string, uint64_t> ModuleStatistics::getCounterValues() const {
+    std::lock_guard<std::mutex> lock(counter_mutex_);
+    std::map<std::string, uint64_t> values;
+    for(auto& counter : counters_) {
+        values.emplace(counter.first, counter.second.load());
+    }
+    return values;
+}
+
+/**
+ * The first bin contains all events faster than the lower edge of the histogram, the last bin all events slower than the
+ * upper edge of the histogram. The total time is accumulated in nanoseconds.
+ */
+void ModuleStatistics::addEventTime(long double seconds) {
+    auto position = std::floor((std::log10(std::max(seconds, 1e-12l)) - min_exponent_) * bins_per_decade_);
+    auto bin = static_cast<size_t>(std::max(0.0l, std::min(position + 1, static_cast<long double>(number_of_bins_ - 1))));
+    ++event_time_bins_[bin];
+    ++event_count_;
+    total_event_time_ += static_cast<uint64_t>(std::llround(seconds * 1e9l));
+}
+
+long double ModuleStatistics::getMeanEventTime() const {
+    auto count = event_count_.load();
+    if(count == 0) {
+        return 0;
+    }
+    return static_cast<long double>(total_event_time_.load()) / 1e9l / static_cast<long double>(count);
+}
+
+long double ModuleStatistics::getEventTimePercentile(double fraction) const {
+    auto count = event_count_.load();
+    auto target = static_cast<uint64_t>(std::ceil(std::max(0.0, std::min(fraction, 1.0)) * static_cast<double>(count)));
+
+    uint64_t accumulated = 0;
+    size_t bin = 0;
+    for(; bin < number_of_bins_ - 1; ++bin) {
+        accumulated += event_time_bins_[bin].load();
+        if(accumulated >= target && accumulated > 0) {
+            break;
+        }
+    }
+
+    // Return the upper edge of the bin, the overflow bin has no upper edge and is reported with its lower edge
+    auto edge = std::min(bin, number_of_bins_ - 2);
+    return std::pow(10.0l, min_exponent_ + static_cast<long double>(edge) / bins_per_decade_);
+}
+
+void StartupProfile::add(Category category, std::string name, long double seconds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.push_back({category, std::move(name), seconds});
+}
+
+void StartupProfile::markFirstEvent() {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(time_to_first_event_ == 0) {
+        time_to_first_event_ = static_cast<std::chrono::duration<long double>>(now - start_).count();
+    }
+}
+
+std::vector<StartupProfile::Entry> StartupProfile::getEntries() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_;
+}
+
+long double StartupProfile::getTimeToFirstEvent() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return time_to_first_event_;
+}
+
+/**
+ * The phases are shown in the order they have been recorded, the libraries and instantiations are sorted by decreasing time
+ * to show the slowest ones first.
+ */
+void StartupProfile::print(size_t max_entries) const {
+    auto entries = getEntries();
+    auto display = [](long double seconds) {
+        return Units::display(Units::get(static_cast<double>(seconds), "s"), {"ms", "s"});
+    };
+    LOG(STATUS) << "Startup profile, first event started after " << display(getTimeToFirstEvent()) << ":";
+
+    std::array<const char*, 4> descriptions{{"Phase", "Loaded library", "Constructed", "Initialized"}};
+    for(size_t category = 0; category < descriptions.size(); ++category) {
+        std::vector<Entry> selected;
+        for(auto& entry : entries) {
+            if(static_cast<size_t>(entry.category) == category) {
+                selected.push_back(entry);
+            }
+        }
+        if(static_cast<Category>(category) != Category::PHASE) {
+            std::stable_sort(
+                selected.begin(), selected.end(), [](const Entry& a, const Entry& b) { return a.time > b.time; });
+            if(selected.size() > max_entries) {
+                selected.resize(max_entries);
+            }
+        }
+        for(auto& entry : selected) {
+            LOG(STATUS) << " " << descriptions[category] << " " << entry.name << " in " << display(entry.time);
+        }
+    }
+}
@@ -0,0 +1,218 @@
+/**
+ * @file
+ * @brief Definition of the performance statistics collected for every module instantiation
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_MODULE_STATISTICS_H
+#define ALLPIX_MODULE_STATISTICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace allpix {
+    /**
+     * @brief Counter used by modules to count operations or to accumulate time
+     */
+    using StatisticsCounter = std::atomic<uint64_t>;
+
+    /**
+     * @brief Raise a counter holding a maximum to a new value if it exceeds the current value
+     * @param counter Counter holding the maximum
+     * @param value Value to compare to the maximum
+     * @return True if the counter has been raised to the value
+     */
+    inline bool update_maximum(StatisticsCounter& counter, uint64_t value) {
+        auto current = counter.load();
+        while(value > current) {
+            if(counter.compare_exchange_weak(current, value)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Timer adding the time elapsed during its lifetime in nanoseconds to a counter
+     *
+     * The counter is only updated when the timer is destroyed, such that the timer can be placed at the beginning of a scope
+     * to measure the time spent in this scope.
+     */
+    class ScopedTimer {
+    public:
+        /**
+         * @brief Start the timer
+         * @param counter Counter to add the elapsed time to
+         */
+        explicit ScopedTimer(StatisticsCounter& counter) : counter_(counter), start_(std::chrono::steady_clock::now()) {}
+
+        /**
+         * @brief Stop the timer and add the elapsed time to the counter
+         */
+        ~ScopedTimer() {
+            auto elapsed = std::chrono::steady_clock::now() - start_;
+            counter_ += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+
+        /// @{
+        /**
+         * @brief Copying or moving a timer is not allowed
+         */
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+        ScopedTimer(ScopedTimer&&) = delete;
+        ScopedTimer& operator=(ScopedTimer&&) = delete;
+        /// @}
+
+    private:
+        StatisticsCounter& counter_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    /**
+     * @brief Performance statistics of a single module instantiation
+     *
+     * Holds the named counters of a module and a histogram of the time spent in every event. The histogram uses
+     * logarithmic bins, allowing to estimate percentiles of the event processing time with constant memory usage. All
+     * methods are thread-safe.
+     */
+    class ModuleStatistics {
+    public:
+        /**
+         * @brief Get a counter by its name, creating it if it does not exist yet
+         * @param name Name of the counter
+         * @return Reference to the counter, which stays valid for the lifetime of the statistics
+         * @note Looking up a counter requires a lock, so the reference should be stored if it is used frequently
+         */
+        StatisticsCounter& getCounter(const std::string& name);
+
+        /**
+         * @brief Get the current values of all counters
+         * @return Map of the counter names to their values
+         */
+        std::map<std::string, uint64_t> getCounterValues() const;
+
+        /**
+         * @brief Add the processing time of an event
+         * @param seconds Time spent in the event, in seconds
+         */
+        void addEventTime(long double seconds);
+
+        /**
+         * @brief Get the number of events that have been recorded
+         * @return Number of events
+         */
+        uint64_t getEventCount() const { return event_count_; }
+
+        /**
+         * @brief Get the mean processing time per event
+         * @return Mean time in seconds (zero if no events have been recorded)
+         */
+        long double getMeanEventTime() const;
+
+        /**
+         * @brief Estimate a percentile of the processing time per event
+         * @param fraction Fraction of events with a shorter processing time, between 0 and 1
+         * @return Upper edge of the histogram bin containing the percentile, in seconds
+         */
+        long double getEventTimePercentile(double fraction) const;
+
+    private:
+        // Logarithmic binning from one microsecond up to 10000 seconds, with an additional underflow and overflow bin
+        static constexpr int bins_per_decade_{10};
+        static constexpr int min_exponent_{-6};
+        static constexpr int decades_{10};
+        static constexpr size_t number_of_bins_{static_cast<size_t>(bins_per_decade_ * decades_) + 2};
+
+        std::array<std::atomic<uint64_t>, number_of_bins_> event_time_bins_{};
+        std::atomic<uint64_t> event_count_{};
+        std::atomic<uint64_t> total_event_time_{};
+
+        mutable std::mutex counter_mutex_;
+        std::map<std::string, StatisticsCounter> counters_;
+    };
+
+    /**
+     * @brief Wall-clock time spent in the phases of the startup until the first event
+     *
+     * Records the time of the phases of the framework, of loading every module library and of the construction and the
+     * initialization of every module instantiation. The profile starts when it is created, such that the time to the first
+     * event covers everything after the creation of the framework. All methods are thread-safe.
+     */
+    class StartupProfile {
+    public:
+        /**
+         * @brief Part of the startup an entry belongs to
+         */
+        enum class Category {
+            PHASE = 0,      ///< Phase of the framework, such as loading the geometry
+            LIBRARY,        ///< Loading of a module library
+            CONSTRUCTION,   ///< Construction of a module instantiation
+            INITIALIZATION, ///< Initialization of a module instantiation
+        };
+
+        /**
+         * @brief Time spent in a single part of the startup
+         */
+        struct Entry {
+            Category category;
+            std::string name;
+            long double time;
+        };
+
+        /**
+         * @brief Start the profile
+         */
+        StartupProfile() : start_(std::chrono::steady_clock::now()) {}
+
+        /**
+         * @brief Add the time spent in a part of the startup
+         * @param category Category of the part
+         * @param name Name of the phase, library or module instantiation
+         * @param seconds Time spent, in seconds
+         */
+        void add(Category category, std::string name, long double seconds);
+
+        /**
+         * @brief Record the start of the first event, ending the startup
+         */
+        void markFirstEvent();
+
+        /**
+         * @brief Get all entries in the order they have been added
+         * @return List of entries
+         */
+        std::vector<Entry> getEntries() const;
+
+        /**
+         * @brief Get the time from the start of the profile until the first event
+         * @return Time in seconds, zero if no event has been started yet
+         */
+        long double getTimeToFirstEvent() const;
+
+        /**
+         * @brief Log the startup profile, with the entries of every category sorted by decreasing time
+         * @param max_entries Maximum number of entries shown per category of the module libraries and instantiations
+         */
+        void print(size_t max_entries) const;
+
+    private:
+        std::chrono::steady_clock::time_point start_;
+        long double time_to_first_event_{};
+
+        mutable std::mutex mutex_;
+        std::vector<Entry> entries_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_MODULE_STATISTICS_H */
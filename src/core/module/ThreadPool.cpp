@@ -10,161 +10,251 @@
 
 #include "ThreadPool.hpp"
 
-#include "Module.hpp"
+#include <tuple>
+
+#include "Tracer.hpp"
+#include "core/utils/numa.h"
 
 using namespace allpix;
 
+thread_local ThreadPool* ThreadPool::current_pool_{nullptr};
+thread_local size_t ThreadPool::current_queue_{0};
+thread_local uint64_t ThreadPool::current_priority_{0};
+std::atomic<unsigned int> ThreadPool::thread_count_{0};
+
+/**
+ * The comparison is inverted, as the standard heap algorithms move the largest element to the top of the heap
+ */
+bool ThreadPool::task_order(const ThreadPool::Task& lhs, const ThreadPool::Task& rhs) {
+    return std::tie(lhs.priority, lhs.sequence) > std::tie(rhs.priority, rhs.sequence);
+}
+
 /**
- * The threads are created in an exception-safe way and all of them will be destroyed when creation of one fails
+ * The threads are created in an exception-safe way and all of them will be destroyed when creation of one fails. One queue
+ * is created for every worker and an additional queue for the tasks submitted by threads outside of the pool.
  */
-ThreadPool::ThreadPool(unsigned int num_threads,
-                       const std::vector<Module*>& modules,
-                       const std::function<void()>& worker_init_function) {
+ThreadPool::ThreadPool(unsigned int num_threads, const std::function<void()>& worker_init_function, bool pin_threads) {
+    for(unsigned int i = 0u; i <= num_threads; ++i) {
+        queues_.push_back(std::make_unique<TaskQueue>());
+    }
+    thread_count_ = num_threads;
+
+    // Assign the CPUs to the workers, consecutive workers share a node as long as the CPUs are numbered by node
+    auto cpus = (pin_threads ? get_available_cpus() : std::vector<unsigned int>());
+    for(unsigned int i = 0u; i < num_threads && !cpus.empty(); ++i) {
+        worker_cpus_.push_back(cpus[i % cpus.size()]);
+    }
+
     // Create threads
     try {
         for(unsigned int i = 0u; i < num_threads; ++i) {
-            threads_.emplace_back(&ThreadPool::worker, this, worker_init_function);
+            threads_.emplace_back(&ThreadPool::worker, this, i, worker_init_function);
         }
     } catch(...) {
         destroy();
         throw;
     }
+}
 
-    // Add module module queues
-    for(auto& module : modules) {
-        // Default constructs a queue for all modules
-        // NOTE: this is the only valid method due to SafeTask not being movable
-        task_queues_[module];
-    }
-    run_cnt_ = 0;
+ThreadPool::~ThreadPool() {
+    destroy();
 }
 
-void ThreadPool::submit_module_function(std::function<void()> module_function) {
-    module_queue_.push(std::make_unique<std::packaged_task<void()>>(std::move(module_function)));
-    all_queue_.push(&module_queue_);
+unsigned int ThreadPool::threadNum() {
+    return current_pool_ != nullptr ? static_cast<unsigned int>(current_queue_) : thread_count_.load();
 }
 
-ThreadPool::~ThreadPool() {
-    destroy();
+unsigned int ThreadPool::threadCount() {
+    return thread_count_ + 1;
+}
+
+void ThreadPool::submit_event(TaskGroup& group, uint64_t priority, std::function<void()> function) {
+    ++group.pending_;
+    if(tracer_ != nullptr) {
+        tracer_->instant("submit event", "thread_pool", priority);
+    }
+    Task task{priority, sequence_++, &group, std::move(function), true};
+    {
+        std::lock_guard<std::mutex> lock{event_queue_.mutex};
+        event_queue_.heap.push_back(std::move(task));
+        std::push_heap(event_queue_.heap.begin(), event_queue_.heap.end(), task_order);
+    }
+
+    // Only workers can start events, all idle threads are woken up to make sure one of the workers receives the event
+    {
+        std::lock_guard<std::mutex> lock{idle_mutex_};
+        ++queued_events_;
+    }
+    idle_condition_.notify_all();
 }
 
 /**
- * @warning This function does not wait for the all the running tasks to finish
- * @warning The module running this function is responsible for handling exceptions in the function called
- *
- * Should always be run by the thread spawning tasks, to ensure the task can be completed when there are no other threads
- * available to execute them.
+ * The task inherits the priority of the task executed by the calling thread, such that all tasks spawned by an event have
+ * the priority of the event. Tasks for a specific worker are marked as affine, which prevents other workers from stealing
+ * them while the worker is idle.
  */
-bool ThreadPool::execute(Module* module) {
-    // Run tasks until the queue is empty
-    Task task{nullptr};
-    while(task_queues_.at(module).pop(task, false)) {
-        // Execute task
-        (*task)();
-        // Fetch the future to propagate exceptions
-        task->get_future().get();
-    }
-    return task_queues_.at(module).isValid();
+void ThreadPool::push_task(TaskGroup& group, std::function<void()> function, size_t worker) {
+    ++group.pending_;
+    if(tracer_ != nullptr) {
+        tracer_->instant("submit task", "thread_pool", current_priority_);
+    }
+    bool affine = (worker < threads_.size());
+    auto& queue = (affine ? *queues_[worker] : (current_pool_ == this ? *queues_[current_queue_] : *queues_.back()));
+    push(queue, Task{current_priority_, sequence_++, &group, std::move(function), false, affine});
+}
+
+void ThreadPool::push(TaskQueue& queue, Task task) {
+    bool affine = task.affine;
+    {
+        std::lock_guard<std::mutex> lock{queue.mutex};
+        queue.heap.push_back(std::move(task));
+        std::push_heap(queue.heap.begin(), queue.heap.end(), task_order);
+    }
+
+    // Any thread can execute the task, waking up a single one is sufficient unless it should be the owner of the queue
+    {
+        std::lock_guard<std::mutex> lock{idle_mutex_};
+        ++queued_tasks_;
+    }
+    if(affine) {
+        idle_condition_.notify_all();
+    } else {
+        idle_condition_.notify_one();
+    }
+}
+
+bool ThreadPool::pop(TaskQueue& queue, Task& task, bool steal) {
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    if(queue.heap.empty()) {
+        return false;
+    }
+    if(steal && queue.heap.front().affine && queue.owner_idle) {
+        // The owner has been woken up and takes the task itself
+        return false;
+    }
+    std::pop_heap(queue.heap.begin(), queue.heap.end(), task_order);
+    task = std::move(queue.heap.back());
+    queue.heap.pop_back();
+    return true;
 }
 
 /**
- * Run by the \ref ModuleManager to ensure all tasks and modules are completed before moving to the next instantiations.
- * Besides waiting for the queue to empty this will also wait for all the tasks to be completed. If an exception is
- * thrown by another thread, the exception will be propagated to the main thread by this function.
+ * The own queue is checked first, followed by the queues of all other workers in a round-robin fashion. New events are
+ * only started if no other task is available, such that the tasks of events in progress are finished first.
  */
-bool ThreadPool::execute_all() {
-    while(true) {
-        // Run tasks until the queue is empty
-        SafeQueue<Task>* queue_ptr;
-        while(all_queue_.pop(queue_ptr, false)) {
-            Task task{nullptr};
-            if(queue_ptr->pop(task, false)) {
-                try {
-                    // Execute task
-                    (*task)();
-                    // Fetch the future to propagate exceptions
-                    task->get_future().get();
-                } catch(...) {
-                    // Check if the first exception thrown
-                    if(has_exception_.test_and_set()) {
-                        // Check if the first exception thrown
-                        exception_ptr_ = std::current_exception();
-                        // Invalidate the queue to terminate other threads
-                        all_queue_.invalidate();
-                    }
-                }
-            }
+bool ThreadPool::fetch(Task& task, bool start_events) {
+    auto own_queue = (current_pool_ == this ? current_queue_ : queues_.size() - 1);
+    for(size_t i = 0; i < queues_.size(); ++i) {
+        if(pop(*queues_[(own_queue + i) % queues_.size()], task, i > 0)) {
+            --queued_tasks_;
+            return true;
         }
+    }
+    if(start_events && pop(event_queue_, task)) {
+        --queued_events_;
+        return true;
+    }
+    return false;
+}
 
-        // Wait for the threads to complete their task, continue helping if a new task was pushed
-        std::unique_lock<std::mutex> lock{run_mutex_};
-        run_condition_.wait(lock, [this]() { return !all_queue_.empty() || run_cnt_ == 0; });
-
-        // Only stop when both the queue is empty and the run count is zero
-        if(all_queue_.empty() && run_cnt_ == 0) {
-            break;
+/**
+ * Exceptions thrown by the task are stored in its group, only the first exception of every group is kept. The function is
+ * released before the task is marked as finished, to destroy all state captured by the task before the group is released.
+ */
+void ThreadPool::execute(Task& task) {
+    auto previous_priority = current_priority_;
+    current_priority_ = task.priority;
+    auto* group = task.group;
+    auto start = (tracer_ != nullptr ? Tracer::Clock::now() : Tracer::Clock::time_point());
+    try {
+        task.function();
+    } catch(...) {
+        if(!group->has_exception_.test_and_set()) {
+            group->exception_ptr_ = std::current_exception();
         }
     }
-
-    // If exception has been thrown, destroy pool and propagate it
-    if(exception_ptr_) {
-        destroy();
-        Log::setSection("");
-        std::rethrow_exception(exception_ptr_);
+    if(tracer_ != nullptr) {
+        tracer_->span(task.event ? "event" : "task", "thread_pool", task.priority, start, Tracer::Clock::now());
     }
+    task.function = nullptr;
+    current_priority_ = previous_priority;
 
-    return all_queue_.isValid();
+    // Wake up the threads waiting for the group if this was the last task, the group should not be accessed afterwards
+    if(group->pending_.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock{idle_mutex_};
+        idle_condition_.notify_all();
+    }
 }
 
 /**
- * If an exception is thrown by a module, the first exception is saved to propagate in the main thread
+ * If a task of the group has thrown an exception, the first exception is rethrown after all tasks of the group finished
  */
-void ThreadPool::worker(const std::function<void()>& init_function) {
+void ThreadPool::wait_for(TaskGroup& group) {
+    auto start = (tracer_ != nullptr ? Tracer::Clock::now() : Tracer::Clock::time_point());
+    while(group.pending_ > 0) {
+        // Help executing tasks, but never start a new event as it could wait for the event of the calling thread
+        Task task;
+        if(fetch(task, false)) {
+            execute(task);
+            continue;
+        }
+
+        // Sleep until the group is finished or a new task is available
+        std::unique_lock<std::mutex> lock{idle_mutex_};
+        set_idle(true);
+        idle_condition_.wait(lock, [this, &group]() { return group.pending_ == 0 || queued_tasks_ > 0; });
+        set_idle(false);
+    }
+    if(tracer_ != nullptr) {
+        tracer_->span("wait_for", "thread_pool", current_priority_, start, Tracer::Clock::now());
+    }
+
+    if(group.exception_ptr_) {
+        std::rethrow_exception(group.exception_ptr_);
+    }
+}
+
+void ThreadPool::worker(size_t index, const std::function<void()>& init_function) {
+    current_pool_ = this;
+    current_queue_ = index;
+
     // Initialize the worker
+    if(index < worker_cpus_.size()) {
+        pin_thread_to_cpu(worker_cpus_[index]);
+    }
     init_function();
 
-    // Safe lambda to increase the atomic run count
-    auto increase_run_cnt_func = [this]() { ++run_cnt_; };
-
     // Continue running until the thread pool is finished
     while(!done_) {
-        SafeQueue<Task>* queue_ptr;
-        if(all_queue_.pop(queue_ptr, true, increase_run_cnt_func)) {
-            Task task{nullptr};
-            if(queue_ptr->pop(task, false)) {
-                // Try to run task
-                try {
-                    // Execute task
-                    (*task)();
-                    // Fetch the future to propagate exceptions
-                    task->get_future().get();
-                } catch(...) {
-                    // Check if the first exception thrown
-                    if(has_exception_.test_and_set()) {
-                        // Save first exception
-                        exception_ptr_ = std::current_exception();
-                        // Invalidate the queue to terminate other threads
-                        all_queue_.invalidate();
-                    }
-                }
-            }
-
-            // Propagate that the task has been finished
-            std::lock_guard<std::mutex> lock{run_mutex_};
-            --run_cnt_;
-            run_condition_.notify_all();
+        Task task;
+        if(fetch(task, true)) {
+            execute(task);
+            continue;
         }
+
+        // Sleep until new work is available
+        std::unique_lock<std::mutex> lock{idle_mutex_};
+        set_idle(true);
+        idle_condition_.wait(lock, [this]() { return done_ || queued_tasks_ > 0 || queued_events_ > 0; });
+        set_idle(false);
     }
 }
 
-void ThreadPool::destroy() {
-    done_ = true;
+void ThreadPool::set_idle(bool idle) {
+    if(current_pool_ == this) {
+        queues_[current_queue_]->owner_idle = idle;
+    }
+}
 
-    all_queue_.invalidate();
-    module_queue_.invalidate();
-    for(auto& queue : task_queues_) {
-        queue.second.invalidate();
+/**
+ * Tasks which have not been started yet are discarded
+ */
+void ThreadPool::destroy() {
+    {
+        std::lock_guard<std::mutex> lock{idle_mutex_};
+        done_ = true;
     }
+    idle_condition_.notify_all();
 
     for(auto& thread : threads_) {
         if(thread.joinable()) {
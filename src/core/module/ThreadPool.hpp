@@ -13,94 +13,79 @@
 
 #include <algorithm>
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <exception>
 #include <functional>
 #include <future>
-#include <map>
 #include <memory>
-#include <queue>
+#include <mutex>
 #include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
-#include <iostream>
-
 namespace allpix {
-    class Module;
+    class Tracer;
 
     /**
-     * @brief Pool of threads where module tasks can be submitted to
+     * @brief Pool of threads where events and module tasks can be submitted to
+     *
+     * Every worker owns a queue of tasks. Tasks submitted from a worker are added to its own queue, while idle workers
+     * steal tasks from the queues of other workers. Every task carries a priority, which is inherited from the task that
+     * submitted it, such that the tasks of older events are executed first. The events submitted by the \ref ModuleManager
+     * are kept in a separate queue and are only started by idle workers, never by a thread waiting for a group of tasks.
      */
     class ThreadPool {
         friend class ModuleManager;
 
     public:
         /**
-         * @brief Internal thread-safe queue
+         * @brief Group of tasks which can be waited for together
+         *
+         * A group should outlive all tasks submitted to it, which is guaranteed by waiting for the group with \ref
+         * ThreadPool::wait_for before it is destroyed.
          */
-        template <typename T> class SafeQueue {
-        public:
-            /**
-             * @brief Default constructor, initializes empty queue
-             */
-            SafeQueue() = default;
-
-            /**
-             * @brief Erases the queue and release waiting threads on destruction
-             */
-            ~SafeQueue();
-
-            /**
-             * @brief Get the top value in the safe queue
-             * @param out Reference where the value at the top of the queue will be written to
-             * @param wait If the method should wait for new tasks or should exit (defaults to wait)
-             * @param func Optional function to execute before releasing the queue mutex if pop was successful
-             * @return True if a task was acquired or false if pop was exited for another reason
-             */
-            bool pop(T& out, bool wait = true, const std::function<void()>& func = nullptr);
-
-            /**
-             * @brief Push a new value onto the safe queue
-             * @param value Value to push to the queue
-             */
-            void push(T value);
+        class TaskGroup {
+            friend class ThreadPool;
 
+        public:
             /**
-             * @brief Return if the queue is in a valid state
-             * @return True if the queue is valid, false if \ref SafeQueue::invalidate has been called
+             * @brief Construct an empty group
              */
-            bool isValid() const;
+            TaskGroup() = default;
 
+            /// @{
             /**
-             * @brief Return if the queue is empty or not
-             * @return True if the queue is empty, false otherwise
+             * @brief Copying or moving a group is not allowed
              */
-            bool empty() const;
+            TaskGroup(const TaskGroup&) = delete;
+            TaskGroup& operator=(const TaskGroup&) = delete;
+            TaskGroup(TaskGroup&&) = delete;
+            TaskGroup& operator=(TaskGroup&&) = delete;
+            /// @}
 
             /**
-             * @brief Invalidate the queue
+             * @brief Use default destructor
              */
-            void invalidate();
+            ~TaskGroup() = default;
 
         private:
-            std::atomic_bool valid_{true};
-            mutable std::mutex mutex_;
-            std::queue<T> queue_;
-            std::condition_variable condition_;
+            std::atomic<unsigned int> pending_{0};
+            std::atomic_flag has_exception_ = ATOMIC_FLAG_INIT;
+            std::exception_ptr exception_ptr_{nullptr};
         };
 
         /**
          * @brief Construct thread pool with provided number of threads
          * @param num_threads Number of threads in the pool
-         * @param modules List of module instantiations to create a task queue for
          * @param worker_init_function Function run by all the workers to initialize
-         * @warning Only module instantiations that are registered in this constructor can spawn tasks
+         * @param pin_threads Pin every worker to a single CPU, such that it stays on the same NUMA node
+         *
+         * Pinned workers are distributed over the CPUs available to the process in increasing order, wrapping around if
+         * there are more workers than CPUs.
          */
-        explicit ThreadPool(unsigned int num_threads,
-                            const std::vector<Module*>& modules,
-                            const std::function<void()>& worker_init_function);
+        ThreadPool(unsigned int num_threads, const std::function<void()>& worker_init_function, bool pin_threads = false);
 
         /// @{
         /**
@@ -116,63 +101,171 @@ namespace allpix {
         ~ThreadPool();
 
         /**
-         * @brief Submit a job from a module to be run by the thread pool
-         * @param module Module the task belongs to
+         * @brief Submit a task to be run by the thread pool
+         * @param group Group the task belongs to
          * @param func Function to execute by the pool
          * @param args Parameters to pass to the function
-         * @warning The thread submitting task should always call the \ref ThreadPool::execute method to prevent a lock when
-         *          there are no threads available
+         * @return Future holding the result of the function or the exception it has thrown
+         * @warning The thread submitting tasks should always call \ref ThreadPool::wait_for to prevent a lock when there are
+         *          no threads available
          */
-        template <typename Func, typename... Args> auto submit(Module* module, Func&& func, Args&&... args);
+        template <typename Func, typename... Args> auto submit(TaskGroup& group, Func&& func, Args&&... args);
 
         /**
-         * @brief Execute jobs from the module queue until all module tasks are finished or an interrupt happened
-         * @param module Module to run tasks for
-         * @return True if module task queue finished, false if stopped for other reason
+         * @brief Submit a task to be run preferably by a given worker
+         * @param group Group the task belongs to
+         * @param worker Index of the worker the task is added to, tasks for any other index are added as by \ref submit
+         * @param func Function to execute by the pool
+         * @param args Parameters to pass to the function
+         * @return Future holding the result of the function or the exception it has thrown
+         *
+         * The task is added to the queue of the given worker, such that repeated tasks operating on the same data are
+         * executed by the same worker and find the data in its caches. Other workers only steal the task while the given
+         * worker is busy, to balance the load.
+         */
+        template <typename Func, typename... Args>
+        auto submit_to(TaskGroup& group, unsigned int worker, Func&& func, Args&&... args);
+
+        /**
+         * @brief Wait until all tasks of a group are finished, executing pending tasks in the meantime
+         * @param group Group to wait for
+         *
+         * The waiting thread executes the tasks of its own queue and steals tasks from the other workers, but never starts
+         * a new event.
+         */
+        void wait_for(TaskGroup& group);
+
+        /**
+         * @brief Index of the calling thread among the threads executing tasks of the most recently created thread pool
+         * @return Index of the worker, or the number of workers for any thread outside of the pool
+         */
+        static unsigned int threadNum();
+
+        /**
+         * @brief Number of threads executing tasks of the most recently created thread pool
+         * @return Number of workers plus one for the thread outside of the pool waiting for the tasks
          */
-        bool execute(Module* module);
+        static unsigned int threadCount();
 
     private:
         /**
-         * @brief Function to run a single event for a module by the \ref ModuleManager
-         * @param module_function Function to execute (should call the run-method of the module)
-         * @warning This method can only be called by the \ref ModuleManager
+         * @brief Single task with its priority and the group it belongs to
          */
-        void submit_module_function(std::function<void()> module_function);
+        struct Task {
+            uint64_t priority{};
+            uint64_t sequence{};
+            TaskGroup* group{};
+            std::function<void()> function;
+            bool event{};
+            bool affine{};
+        };
 
         /**
-         * @brief Execute jobs from the queue until all tasks and modules are finished or an interrupt happened
-         * @return True if module task queue finished, false if stopped for other reason
+         * @brief Order of the tasks in the queues (lowest priority value first, then in order of submission)
+         * @return True if the first task should be executed after the second task
+         */
+        static bool task_order(const Task& lhs, const Task& rhs);
+
+        /**
+         * @brief Queue of tasks ordered by priority and submission order, protected by its own mutex
+         */
+        struct TaskQueue {
+            std::mutex mutex;
+            std::vector<Task> heap;
+            // Set while the owning worker sleeps, such that it is woken up for its affine tasks instead of them being stolen
+            std::atomic_bool owner_idle{false};
+        };
+
+        /**
+         * @brief Submit an event to be run by the thread pool
+         * @param group Group of all events of the run
+         * @param priority Priority of the event, lower values are executed first (for example the event number)
+         * @param function Function to execute (should call the run-method of all modules for the event)
          * @warning This method can only be called by the \ref ModuleManager
          */
-        bool execute_all();
+        void submit_event(TaskGroup& group, uint64_t priority, std::function<void()> function);
+
+        /**
+         * @brief Add a task to the queue of the calling worker, or to the queue of external threads
+         * @param group Group the task belongs to
+         * @param function Function to execute
+         * @param worker Index of the worker whose queue the task should be added to instead, if it belongs to the pool
+         */
+        void push_task(TaskGroup& group, std::function<void()> function, size_t worker = SIZE_MAX);
 
         /**
-         * @brief Constantly running internal function each thread uses to acquire work items from the queue.
+         * @brief Add a task to a queue and wake up an idle thread
+         * @param queue Queue to add the task to
+         * @param task Task to add
+         */
+        void push(TaskQueue& queue, Task task);
+
+        /**
+         * @brief Remove the task with the highest priority from a queue
+         * @param queue Queue to take the task from
+         * @param task Reference where the task is written to
+         * @param steal True if the queue is owned by another worker, which keeps its affine tasks while it is idle
+         * @return True if a task was taken, false if the queue is empty
+         */
+        static bool pop(TaskQueue& queue, Task& task, bool steal = false);
+
+        /**
+         * @brief Fetch the next task from the own queue, from the queue of another worker or optionally a new event
+         * @param task Reference where the task is written to
+         * @param start_events True if new events can be started
+         * @return True if a task was fetched, false if no task is available
+         */
+        bool fetch(Task& task, bool start_events);
+
+        /**
+         * @brief Execute a task and mark it as finished in its group
+         * @param task Task to execute
+         */
+        void execute(Task& task);
+
+        /**
+         * @brief Constantly running internal function each thread uses to acquire work items from the queues
+         * @param index Index of the queue owned by this worker
          * @param init_function Function to initialize the relevant thread_local variables
          */
-        void worker(const std::function<void()>& init_function);
+        void worker(size_t index, const std::function<void()>& init_function);
 
         /**
-         * @brief Invalidate all queues and joins all running threads when the pool is destroyed.
+         * @brief Mark the queue of the calling worker as owned by an idle or a busy worker
+         * @param idle True if the worker is about to sleep, false if it continues executing tasks
+         */
+        void set_idle(bool idle);
+
+        /**
+         * @brief Stop all workers and join the threads when the pool is destroyed
          */
         void destroy();
 
-        using Task = std::unique_ptr<std::packaged_task<void()>>;
+        // Queues of all workers, the last queue is used by threads outside of the pool
+        std::vector<std::unique_ptr<TaskQueue>> queues_;
+        TaskQueue event_queue_;
 
+        std::atomic<uint64_t> sequence_{0};
+        std::atomic<size_t> queued_tasks_{0};
+        std::atomic<size_t> queued_events_{0};
         std::atomic_bool done_{false};
+        std::mutex idle_mutex_;
+        std::condition_variable idle_condition_;
 
-        SafeQueue<SafeQueue<Task>*> all_queue_;
-        SafeQueue<Task> module_queue_;
-        std::map<Module*, SafeQueue<Task>> task_queues_;
-
-        std::atomic<unsigned int> run_cnt_;
-        mutable std::mutex run_mutex_;
-        std::condition_variable run_condition_;
         std::vector<std::thread> threads_;
+        // CPUs the workers are pinned to, empty if the workers are not pinned
+        std::vector<unsigned int> worker_cpus_;
+
+        // Tracer recording the execution of all tasks if enabled, set by the ModuleManager before submitting any event
+        Tracer* tracer_{};
+
+        // Number of workers of the most recently created pool
+        static std::atomic<unsigned int> thread_count_;
 
-        std::atomic_flag has_exception_;
-        std::exception_ptr exception_ptr_{nullptr};
+        // Pool and queue of the calling thread and priority of the task currently executed by this thread
+        static thread_local ThreadPool* current_pool_;
+        static thread_local size_t current_queue_;
+        static thread_local uint64_t current_priority_;
     };
 } // namespace allpix
 
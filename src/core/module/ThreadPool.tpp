@@ -9,72 +9,30 @@
  */
 
 namespace allpix {
-    template <typename Func, typename... Args> auto ThreadPool::submit(Module* module, Func&& func, Args&&... args) {
+    template <typename Func, typename... Args>
+    auto ThreadPool::submit(TaskGroup& group, Func&& func, Args&&... args) {
         // Bind the arguments to the tasks
         auto bound_task = std::bind(std::forward<Func>(func), std::forward<Args>(args)...);
 
-        // Construct packaged task with correct return type
+        // Construct packaged task with correct return type, shared to allow storing it in a copyable function
         using PackagedTask = std::packaged_task<decltype(bound_task())()>;
-        PackagedTask task(bound_task);
+        auto task = std::make_shared<PackagedTask>(std::move(bound_task));
 
-        // Get future and wrapper to add to vector
-        auto future = task.get_future();
-        auto task_function = [task = std::move(task)]() mutable { task(); };
-        task_queues_.at(module).push(std::make_unique<std::packaged_task<void()>>(std::move(task_function)));
-        all_queue_.push(&task_queues_.at(module));
+        // Get future and add the task to the queue of this thread
+        auto future = task->get_future();
+        push_task(group, [task]() { (*task)(); });
         return future;
     }
 
-    template <typename T> ThreadPool::SafeQueue<T>::~SafeQueue() { invalidate(); }
-
-    /*
-     * Block until a value is available if the wait parameter is set to true. The wait exits when the queue is invalidated.
-     */
-    template <typename T> bool ThreadPool::SafeQueue<T>::pop(T& out, bool wait, const std::function<void()>& func) {
-        // Lock the mutex
-        std::unique_lock<std::mutex> lock{mutex_};
-        if(wait) {
-            // Wait for new item in the queue (unlocks the mutex while waiting)
-            condition_.wait(lock, [this]() { return !queue_.empty() || !valid_; });
-        }
-        // Check for empty and valid queue
-        if(queue_.empty() || !valid_) {
-            return false;
-        }
-
-        // Pop the queue and optionally execute the mutex protected function
-        out = std::move(queue_.front());
-        queue_.pop();
-        if(func != nullptr) {
-            func();
-        }
-        return true;
-    }
-
-    template <typename T> void ThreadPool::SafeQueue<T>::push(T value) {
-        std::lock_guard<std::mutex> lock{mutex_};
-        queue_.push(std::move(value));
-        condition_.notify_one();
-    }
-
-    template <typename T> bool ThreadPool::SafeQueue<T>::isValid() const {
-        std::lock_guard<std::mutex> lock{mutex_};
-        return valid_;
-    }
-
-    template <typename T> bool ThreadPool::SafeQueue<T>::empty() const {
-        std::lock_guard<std::mutex> lock{mutex_};
-        return !valid_ || queue_.empty();
-    }
+    template <typename Func, typename... Args>
+    auto ThreadPool::submit_to(TaskGroup& group, unsigned int worker, Func&& func, Args&&... args) {
+        auto bound_task = std::bind(std::forward<Func>(func), std::forward<Args>(args)...);
+        using PackagedTask = std::packaged_task<decltype(bound_task())()>;
+        auto task = std::make_shared<PackagedTask>(std::move(bound_task));
 
-    /*
-     * Used to ensure no conditions are being waited for in pop when a thread or the application is trying to exit. The queue
-     * is invalid after calling this method and it is an error to continue using a queue after this method has been called.
-     */
-    template <typename T> void ThreadPool::SafeQueue<T>::invalidate() {
-        std::lock_guard<std::mutex> lock{mutex_};
-        std::queue<T>().swap(queue_);
-        valid_ = false;
-        condition_.notify_all();
+        // Add the task to the queue of the requested worker
+        auto future = task->get_future();
+        push_task(group, [task]() { (*task)(); }, worker);
+        return future;
     }
 } // namespace allpix
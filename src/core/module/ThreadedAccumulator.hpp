@@ -0,0 +1,138 @@
+/**
+ * @file
+ * @brief Statistics accumulated by multiple threads without locking, merged at the end of the run
+ *
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_THREADED_ACCUMULATOR_H
+#define ALLPIX_THREADED_ACCUMULATOR_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "ThreadPool.hpp"
+
+namespace allpix {
+    namespace detail {
+        /**
+         * @brief Merge a container such as std::set or std::map by inserting all elements of the other container
+         * @param total Container to merge into
+         * @param part Container to merge
+         */
+        template <typename T>
+        auto accumulate(T& total, const T& part, int) -> decltype(total.insert(part.begin(), part.end()), void()) {
+            total.insert(part.begin(), part.end());
+        }
+        /**
+         * @brief Merge an array by adding all elements individually
+         * @param total Array to merge into
+         * @param part Array to merge
+         */
+        template <typename T, std::size_t N> void accumulate(std::array<T, N>& total, const std::array<T, N>& part, int) {
+            for(std::size_t i = 0; i < N; ++i) {
+                total[i] += part[i];
+            }
+        }
+        /**
+         * @brief Merge any other type, such as counters and sums, by adding it
+         * @param total Value to merge into
+         * @param part Value to merge
+         */
+        template <typename T> void accumulate(T& total, const T& part, long) { total += part; }
+    } // namespace detail
+
+    /**
+     * @brief Statistic with a separate value for every thread of the thread pool, merged when the statistic is read
+     *
+     * Every thread updates its own value, which is created on first use and placed on its own cache line, such that
+     * counters, sums and sets of the modules can be updated from parallel events without any atomic operation or lock. The
+     * values of all threads are combined into the total by \ref merge, which should be called in the finalization. Numbers
+     * are merged by adding them, arrays by adding their elements and containers providing an insert method for a range of
+     * elements, such as std::set, by inserting the elements of all threads.
+     */
+    template <typename T> class ThreadedAccumulator {
+    public:
+        /**
+         * @brief Construct the accumulator
+         * @param initial Value all threads start from, also used as the initial value of the total
+         */
+        explicit ThreadedAccumulator(T initial = T()) : initial_(initial), total_(std::move(initial)) {}
+
+        /// @{
+        /**
+         * @brief Copying or moving an accumulator is not allowed
+         */
+        ThreadedAccumulator(const ThreadedAccumulator&) = delete;
+        ThreadedAccumulator& operator=(const ThreadedAccumulator&) = delete;
+        ThreadedAccumulator(ThreadedAccumulator&&) = delete;
+        ThreadedAccumulator& operator=(ThreadedAccumulator&&) = delete;
+        /// @}
+
+        /**
+         * @brief Use default destructor
+         */
+        ~ThreadedAccumulator() = default;
+
+        /**
+         * @brief Value of the calling thread, created from the initial value on first use
+         * @return Reference to the value of the calling thread, which can be updated without synchronization
+         * @warning Should only be called while the events are processed, as the number of threads is only known then
+         */
+        T& local() {
+            std::call_once(slots_created_, [this]() { slots_.resize(ThreadPool::threadCount()); });
+            auto index = ThreadPool::threadNum();
+            if(index >= slots_.size()) {
+                // Only threads of the thread pool have a slot, anything else has to use the total
+                return total_;
+            }
+
+            auto& slot = slots_[index];
+            if(slot == nullptr) {
+                slot = std::make_unique<Slot>(initial_);
+            }
+            return slot->value;
+        }
+
+        /**
+         * @brief Add the values of all threads to the total
+         * @return Reference to the total
+         * @warning Should only be called after all events are finished, as no thread is allowed to update meanwhile
+         */
+        const T& merge() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for(auto& slot : slots_) {
+                if(slot != nullptr) {
+                    detail::accumulate(total_, slot->value, 0);
+                    slot.reset();
+                }
+            }
+            return total_;
+        }
+
+    private:
+        /**
+         * @brief Value of a single thread, aligned to avoid sharing a cache line with the values of other threads
+         */
+        struct alignas(64) Slot {
+            explicit Slot(const T& initial) : value(initial) {}
+            T value;
+        };
+
+        T initial_;
+        T total_;
+
+        std::once_flag slots_created_;
+        std::vector<std::unique_ptr<Slot>> slots_;
+        std::mutex mutex_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_THREADED_ACCUMULATOR_H */
@@ -0,0 +1,133 @@
+/**
+ * @file
+ * @brief Histogram filled by multiple threads without locking, merged at the end of the run
+ *
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_THREADED_HISTOGRAM_H
+#define ALLPIX_THREADED_HISTOGRAM_H
+
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "ThreadPool.hpp"
+
+namespace allpix {
+    namespace detail {
+        /**
+         * @brief Detach a histogram from its directory, for histograms attached to directories such as ROOT's TH1
+         * @param histogram Histogram to detach
+         */
+        template <typename T>
+        auto detach_histogram(T* histogram, int) -> decltype(histogram->SetDirectory(nullptr), void()) {
+            histogram->SetDirectory(nullptr);
+        }
+        /**
+         * @brief Histograms not attached to directories, such as ROOT's THnSparse, do not need to be detached
+         */
+        template <typename T> void detach_histogram(T*, long) {}
+    } // namespace detail
+
+    /**
+     * @brief ROOT histogram with a separate copy for every thread of the thread pool, similar to ROOT's TThreadedObject
+     *
+     * The histogram created at construction is attached to the current directory and is the one which should be written.
+     * Every thread filling the histogram receives its own empty copy on first use, detached from any directory. The copies
+     * are added to the original histogram and released by \ref merge, which should be called in the finalization before the
+     * histogram is written or drawn. The histogram type should provide the Clone, Reset and Add methods of ROOT's TH1 or
+     * THnSparse, and the SetDirectory method if it is attached to directories.
+     */
+    template <typename T> class ThreadedHistogram {
+    public:
+        /**
+         * @brief Construct a histogram with the given arguments, as the histogram type itself would be constructed
+         * @param args Arguments of the histogram constructor
+         *
+         * The histogram is created in the current directory, like any other ROOT histogram.
+         */
+        template <typename... Args>
+        explicit ThreadedHistogram(Args&&... args) : histogram_(new T(std::forward<Args>(args)...)) {}
+
+        /// @{
+        /**
+         * @brief Copying or moving a threaded histogram is not allowed
+         */
+        ThreadedHistogram(const ThreadedHistogram&) = delete;
+        ThreadedHistogram& operator=(const ThreadedHistogram&) = delete;
+        ThreadedHistogram(ThreadedHistogram&&) = delete;
+        ThreadedHistogram& operator=(ThreadedHistogram&&) = delete;
+        /// @}
+
+        /**
+         * @brief Use default destructor, the original histogram is owned by its directory
+         */
+        ~ThreadedHistogram() = default;
+
+        /**
+         * @brief Histogram of the calling thread, created as an empty copy of the original histogram on first use
+         * @return Pointer to the histogram of the calling thread
+         * @warning Should only be called while the events are processed, as the number of threads is only known then
+         */
+        T* get() {
+            std::call_once(slots_created_, [this]() { slots_.resize(ThreadPool::threadCount()); });
+            auto index = ThreadPool::threadNum();
+            if(index >= slots_.size()) {
+                // Only threads of the thread pool have a slot, anything else has to use the original histogram
+                return histogram_;
+            }
+
+            auto& slot = slots_[index];
+            if(slot == nullptr) {
+                // Cloning accesses the global state of ROOT and is therefore serialized
+                std::lock_guard<std::mutex> lock(mutex_);
+                slot.reset(static_cast<T*>(histogram_->Clone()));
+                detail::detach_histogram(slot.get(), 0);
+                slot->Reset();
+            }
+            return slot.get();
+        }
+
+        /**
+         * @brief Fill the histogram of the calling thread
+         * @param args Arguments of the Fill method of the histogram
+         */
+        template <typename... Args> void Fill(Args&&... args) { get()->Fill(std::forward<Args>(args)...); }
+
+        /**
+         * @brief Add the histograms of all threads to the original histogram
+         * @return Pointer to the original histogram
+         * @warning Should only be called after all events are finished, as no thread is allowed to fill meanwhile
+         */
+        T* merge() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for(auto& slot : slots_) {
+                if(slot != nullptr) {
+                    histogram_->Add(slot.get());
+                    slot.reset();
+                }
+            }
+            return histogram_;
+        }
+
+        /**
+         * @brief Access the original histogram, which only holds the entries of all threads after \ref merge
+         * @return Pointer to the original histogram
+         */
+        T* operator->() const { return histogram_; }
+
+    private:
+        T* histogram_{};
+
+        std::once_flag slots_created_;
+        std::vector<std::unique_ptr<T>> slots_;
+        std::mutex mutex_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_THREADED_HISTOGRAM_H */
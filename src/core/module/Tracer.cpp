@@ -0,0 +1,76 @@
+/**
+ * @file
+ * @brief Implementation of the tracer recording the execution of modules and tasks in the event loop
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "Tracer.hpp"
+
+#include <fstream>
+
+#include "ThreadPool.hpp"
+#include "core/utils/exceptions.h"
+
+using namespace allpix;
+
+/**
+ * One buffer is created for every worker and one for the thread outside of the pool waiting for the tasks
+ */
+Tracer::Tracer() : start_time_(Clock::now()), buffers_(ThreadPool::threadCount()) {}
+
+std::vector<Tracer::Entry>* Tracer::buffer() {
+    auto index = ThreadPool::threadNum();
+    return index < buffers_.size() ? &buffers_[index] : nullptr;
+}
+
+void Tracer::span(
+    const std::string& name, const char* category, uint64_t event, Clock::time_point start, Clock::time_point end) {
+    auto* entries = buffer();
+    if(entries != nullptr) {
+        entries->push_back({name, category, event, start, end, false});
+    }
+}
+
+void Tracer::instant(const std::string& name, const char* category, uint64_t event) {
+    auto* entries = buffer();
+    if(entries != nullptr) {
+        auto now = Clock::now();
+        entries->push_back({name, category, event, now, now, true});
+    }
+}
+
+/**
+ * Spans are written as complete events and instants as thread-scoped instant events, all times are given in microseconds
+ * since the construction of the tracer. Every thread is named after its index in the pool, the last thread is the one
+ * outside of the pool which submits the events.
+ */
+void Tracer::write(const std::string& path) const {
+    std::ofstream file(path);
+    if(!file) {
+        throw RuntimeError("Cannot write trace file " + path);
+    }
+
+    auto microseconds = [this](Clock::time_point time) {
+        return std::chrono::duration<double, std::micro>(time - start_time_).count();
+    };
+
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    for(size_t thread = 0; thread < buffers_.size(); ++thread) {
+        file << (thread == 0 ? "" : ",") << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << thread
+             << ", \"args\": {\"name\": \"" << (thread + 1 < buffers_.size() ? "worker " + std::to_string(thread) : "main")
+             << "\"}}";
+        for(auto& entry : buffers_[thread]) {
+            file << ",\n{\"name\": \"" << entry.name << "\", \"cat\": \"" << entry.category << "\", \"ph\": \""
+                 << (entry.instant ? "i\", \"s\": \"t" : "X") << "\", \"ts\": " << microseconds(entry.start);
+            if(!entry.instant) {
+                file << ", \"dur\": " << microseconds(entry.end) - microseconds(entry.start);
+            }
+            file << ", \"pid\": 0, \"tid\": " << thread << ", \"args\": {\"event\": " << entry.event << "}}";
+        }
+    }
+    file << "\n]}\n";
+}
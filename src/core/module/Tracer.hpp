@@ -0,0 +1,89 @@
+/**
+ * @file
+ * @brief Definition of the tracer recording the execution of modules and tasks in the event loop
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_MODULE_TRACER_H
+#define ALLPIX_MODULE_TRACER_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace allpix {
+    /**
+     * @brief Recorder of the time spans and instants of the execution in every thread, written in the trace event format
+     *
+     * Every thread of the thread pool records into its own buffer without locking, identified by the index of the calling
+     * thread in the pool. The trace can be written as JSON in the trace event format of Chrome, which is displayed by the
+     * trace viewer of Chrome (chrome://tracing) and by Perfetto (https://ui.perfetto.dev).
+     */
+    class Tracer {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Construct a tracer for the threads of the most recently created thread pool
+         */
+        Tracer();
+
+        /**
+         * @brief Record a time span executed by the calling thread
+         * @param name Name of the span
+         * @param category Category of the span, should be a string literal
+         * @param event Number of the event the span belongs to
+         * @param start Start time of the span
+         * @param end End time of the span
+         */
+        void span(const std::string& name,
+                  const char* category,
+                  uint64_t event,
+                  Clock::time_point start,
+                  Clock::time_point end);
+
+        /**
+         * @brief Record an instant of the calling thread at the current time
+         * @param name Name of the instant
+         * @param category Category of the instant, should be a string literal
+         * @param event Number of the event the instant belongs to
+         */
+        void instant(const std::string& name, const char* category, uint64_t event);
+
+        /**
+         * @brief Write all recorded spans and instants to a file in the trace event format
+         * @param path Path of the file to write
+         * @warning Should only be called when no thread records anymore
+         */
+        void write(const std::string& path) const;
+
+    private:
+        /**
+         * @brief Single recorded span or instant, instants have the same start and end time
+         */
+        struct Entry {
+            std::string name;
+            const char* category{};
+            uint64_t event{};
+            Clock::time_point start;
+            Clock::time_point end;
+            bool instant{};
+        };
+
+        /**
+         * @brief Buffer of the calling thread
+         * @return Pointer to the buffer, or a null pointer if the thread does not execute tasks of the thread pool
+         */
+        std::vector<Entry>* buffer();
+
+        Clock::time_point start_time_;
+        std::vector<std::vector<Entry>> buffers_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_MODULE_TRACER_H */
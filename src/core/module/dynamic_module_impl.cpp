@@ -6,6 +6,10 @@
  * - ALLPIX_MODULE_NAME: name of the module
  * - ALLPIX_MODULE_HEADER: name of the header defining the module
  * - ALLPIX_MODULE_UNIQUE: true if the module is unique, false otherwise
+ * - ALLPIX_MODULE_TYPE: name of the module as used in the configuration, only for the monolithic build
+ *
+ * In the monolithic build, where all modules are linked into the executable, the functions are local to the module and are
+ * added to the registry of static modules instead of being exported by the library.
  *
  * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
  * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
@@ -19,18 +23,51 @@
 
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "core/config/Configuration.hpp"
 #include "core/geometry/Detector.hpp"
 #include "core/utils/log.h"
 
+#ifdef ALLPIX_MONOLITHIC
+#include "core/module/StaticModules.hpp"
+#endif
+
 #include ALLPIX_MODULE_HEADER
 
 namespace allpix {
     class Messenger;
     class GeometryManager;
 
+#if !ALLPIX_MODULE_UNIQUE || defined(DOXYGEN)
+    namespace {
+        /**
+         * @brief Instantiates a multi-detector module if it provides a constructor taking the list of detectors
+         * @return Instantiation of the module
+         */
+        template <typename T>
+        auto allpix_create_multi_detector(Configuration& config,
+                                          Messenger* messenger,
+                                          std::vector<std::shared_ptr<Detector>> detectors,
+                                          int) -> decltype(new T(config, messenger, std::move(detectors))) {
+            return new T(config, messenger, std::move(detectors)); // NOLINT
+        }
+        /**
+         * @brief Fallback for modules without a constructor taking the list of detectors
+         * @return Null pointer as the module cannot be instantiated for multiple detectors
+         */
+        template <typename T>
+        Module* allpix_create_multi_detector(Configuration&, Messenger*, std::vector<std::shared_ptr<Detector>>, long) {
+            return nullptr;
+        }
+    } // namespace
+#endif
+
+#ifndef ALLPIX_MONOLITHIC
     extern "C" {
+#else
+    namespace {
+#endif
     /**
      * @brief Returns the type of the Module it is linked to
      *
@@ -77,8 +114,43 @@ namespace allpix {
         return static_cast<Module*>(module);
     }
 
+    /**
+     * @brief Instantiates a single detector module for multiple detectors
+     * @param config Configuration for this module
+     * @param messenger Pointer to the Messenger (guarenteed to be valid until the module is destructed)
+     * @param detectors Pointers to all Detector objects this module is bound to
+     * @return Instantiation of the module, or a null pointer if the module does not support multiple detectors
+     *
+     * Internal method for the dynamic loading in the ModuleManager. Forwards the supplied arguments to the constructor of
+     * the module taking the list of detectors if it exists.
+     */
+    Module* allpix_module_multi_generator(Configuration& config,
+                                          Messenger* messenger,
+                                          std::vector<std::shared_ptr<Detector>> detectors);
+    Module* allpix_module_multi_generator(Configuration& config,
+                                          Messenger* messenger,
+                                          std::vector<std::shared_ptr<Detector>> detectors) {
+        return allpix_create_multi_detector<ALLPIX_MODULE_NAME>(config, messenger, std::move(detectors), 0);
+    }
+
     // Returns that is a detector module
     bool allpix_module_is_unique() { return false; }
 #endif
     }
+
+#ifdef ALLPIX_MONOLITHIC
+    // Register the module in the executable
+#if ALLPIX_MODULE_UNIQUE
+    static const StaticModuleRegistration
+        allpix_module_registration(ALLPIX_MODULE_TYPE,
+                                   reinterpret_cast<void*>(&allpix_module_is_unique),  // NOLINT
+                                   reinterpret_cast<void*>(&allpix_module_generator)); // NOLINT
+#else
+    static const StaticModuleRegistration
+        allpix_module_registration(ALLPIX_MODULE_TYPE,
+                                   reinterpret_cast<void*>(&allpix_module_is_unique),        // NOLINT
+                                   reinterpret_cast<void*>(&allpix_module_generator),        // NOLINT
+                                   reinterpret_cast<void*>(&allpix_module_multi_generator)); // NOLINT
+#endif
+#endif
 } // namespace allpix
@@ -121,6 +121,23 @@ namespace allpix {
         // TODO [doc] the module itself is missing
         explicit EndOfRunException(std::string reason) { error_message_ = std::move(reason); }
     };
+
+    /**
+     * @ingroup Exceptions
+     * @brief Exception for modules to reject the current event
+     * @note Non-fatal error used to skip all following modules for the current event only.
+     *
+     * This error can be raised by modules if the current event does not contain anything of interest, for example because
+     * no charge has been deposited in a detector. The event loop continues with the next events.
+     */
+    class AbortEventException : public RuntimeError {
+    public:
+        /**
+         * @brief Constructs request to abort the current event with a description
+         * @param reason Text explaining the reason of the rejection of the event
+         */
+        explicit AbortEventException(std::string reason) { error_message_ = std::move(reason); }
+    };
 } // namespace allpix
 
 #endif /* ALLPIX_MODULE_EXCEPTIONS_H */
@@ -0,0 +1,65 @@
+/**
+ * @file
+ * @brief Implementation of the counter of the memory allocations
+ *
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "allocations.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+using namespace allpix;
+
+namespace {
+    // Count of a group of threads, aligned to a cache line
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> count{0};
+    };
+
+    constexpr size_t shard_count = 64;
+    std::array<Shard, shard_count> shards;
+    std::atomic<size_t> next_shard{0};
+
+    std::atomic<bool> installed{false};
+    std::atomic<bool> enabled{false};
+} // namespace
+
+void AllocationCounter::install() {
+    installed = true;
+}
+
+bool AllocationCounter::isInstalled() {
+    return installed;
+}
+
+void AllocationCounter::setEnabled(bool enable) {
+    if(enable) {
+        for(auto& shard : shards) {
+            shard.count.store(0, std::memory_order_relaxed);
+        }
+    }
+    enabled = enable;
+}
+
+uint64_t AllocationCounter::getCount() {
+    uint64_t total = 0;
+    for(auto& shard : shards) {
+        total += shard.count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void AllocationCounter::record() noexcept {
+    if(!enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    // The shard is assigned on the first counted allocation of the thread, which does not allocate itself
+    thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % shard_count;
+    shards[shard].count.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,57 @@
+/**
+ * @file
+ * @brief Counter of the memory allocations of the process
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_ALLOCATIONS_H
+#define ALLPIX_ALLOCATIONS_H
+
+#include <cstdint>
+
+namespace allpix {
+
+    /**
+     * @brief Counter of the allocations done through the global operator new
+     *
+     * The counter relies on the executable replacing the global allocation functions, which report every allocation by
+     * calling \ref record and mark the counter as installed. Allocations are only counted while the counting is enabled,
+     * otherwise recording amounts to a single load. Every thread counts in its own cache line to avoid contention between
+     * the workers.
+     */
+    class AllocationCounter {
+    public:
+        /**
+         * @brief Mark the counter as installed, to be called by executables replacing the global allocation functions
+         */
+        static void install();
+
+        /**
+         * @brief Check if the allocations are reported to the counter
+         * @return True if the global allocation functions have been replaced by the executable
+         */
+        static bool isInstalled();
+
+        /**
+         * @brief Enable or disable the counting, enabling resets the count
+         * @param enable If allocations should be counted
+         */
+        static void setEnabled(bool enable);
+
+        /**
+         * @brief Get the number of allocations since the counting has been enabled
+         * @return Number of counted allocations of all threads
+         */
+        static uint64_t getCount();
+
+        /**
+         * @brief Record a single allocation, called by the replaced global allocation functions
+         */
+        static void record() noexcept;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_ALLOCATIONS_H */
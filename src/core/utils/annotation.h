@@ -0,0 +1,109 @@
+/**
+ * @file
+ * @brief Annotation of ranges of the execution for external profilers, which is removed at compile time if disabled
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * The annotations are compiled in by setting the CMake option PROFILING_ANNOTATIONS to NVTX, for NVIDIA Nsight Systems,
+ * or to ITT, for Intel VTune. Otherwise the macros expand to nothing and their arguments are never evaluated.
+ */
+
+#ifndef ALLPIX_ANNOTATION_H
+#define ALLPIX_ANNOTATION_H
+
+#include <cstdint>
+
+#if defined(ALLPIX_ANNOTATE_NVTX)
+#include <nvtx3/nvToolsExt.h>
+#elif defined(ALLPIX_ANNOTATE_ITT)
+#include <ittnotify.h>
+#endif
+
+namespace allpix {
+#if defined(ALLPIX_ANNOTATE_NVTX) || defined(ALLPIX_ANNOTATE_ITT)
+    /**
+     * @brief Range of the execution of the calling thread shown by the profiler, from construction to destruction
+     */
+    class AnnotatedRange {
+    public:
+        /**
+         * @brief Begin the range
+         * @param name Name of the range, which is copied by the profiler
+         * @param event Number of the event the range belongs to, attached to the range if not zero
+         */
+        explicit AnnotatedRange(const char* name, uint64_t event = 0) {
+#if defined(ALLPIX_ANNOTATE_NVTX)
+            nvtxEventAttributes_t attributes{};
+            attributes.version = NVTX_VERSION;
+            attributes.size = NVTX_EVENT_ATTRIB_STRUCT_SIZE;
+            attributes.messageType = NVTX_MESSAGE_TYPE_ASCII;
+            attributes.message.ascii = name;
+            if(event != 0) {
+                attributes.payloadType = NVTX_PAYLOAD_TYPE_UNSIGNED_INT64;
+                attributes.payload.ullValue = event;
+            }
+            nvtxRangePushEx(&attributes);
+#else
+            __itt_task_begin(domain(), __itt_null, __itt_null, __itt_string_handle_create(name));
+            if(event != 0) {
+                static auto* event_key = __itt_string_handle_create("event");
+                __itt_metadata_add(domain(), __itt_null, event_key, __itt_metadata_u64, 1, &event);
+            }
+#endif
+        }
+
+        /**
+         * @brief End the range
+         */
+        ~AnnotatedRange() {
+#if defined(ALLPIX_ANNOTATE_NVTX)
+            nvtxRangePop();
+#else
+            __itt_task_end(domain());
+#endif
+        }
+
+        /// @{
+        /**
+         * @brief Copying or moving the range is not allowed
+         */
+        AnnotatedRange(const AnnotatedRange&) = delete;
+        AnnotatedRange& operator=(const AnnotatedRange&) = delete;
+        AnnotatedRange(AnnotatedRange&&) = delete;
+        AnnotatedRange& operator=(AnnotatedRange&&) = delete;
+        /// @}
+
+#if defined(ALLPIX_ANNOTATE_ITT)
+    private:
+        static __itt_domain* domain() {
+            static auto* domain = __itt_domain_create("allpix");
+            return domain;
+        }
+#endif
+    };
+
+#endif
+} // namespace allpix
+
+#if defined(ALLPIX_ANNOTATE_NVTX) || defined(ALLPIX_ANNOTATE_ITT)
+#define ALLPIX_ANNOTATION_CONCAT_IMPL(a, b) a##b
+#define ALLPIX_ANNOTATION_CONCAT(a, b) ALLPIX_ANNOTATION_CONCAT_IMPL(a, b)
+
+/**
+ * @brief Annotate the remainder of the enclosing scope as a range with the given name
+ */
+#define PROFILER_RANGE(name) allpix::AnnotatedRange ALLPIX_ANNOTATION_CONCAT(annotated_range_, __LINE__)(name)
+
+/**
+ * @brief Annotate the remainder of the enclosing scope as a range with the given name, belonging to the given event
+ */
+#define PROFILER_EVENT_RANGE(name, event)                                                                                   \
+    allpix::AnnotatedRange ALLPIX_ANNOTATION_CONCAT(annotated_range_, __LINE__)(name, event)
+#else
+#define PROFILER_RANGE(name)
+#define PROFILER_EVENT_RANGE(name, event)
+#endif
+
+#endif /* ALLPIX_ANNOTATION_H */
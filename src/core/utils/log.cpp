@@ -13,6 +13,7 @@
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <ctime>
 #include <exception>
 #include <iomanip>
 #include <iostream>
@@ -30,6 +31,13 @@ std::string DefaultLogger::last_identifier_;
 std::string DefaultLogger::last_message_;
 // Mutex to guard output writing
 std::mutex DefaultLogger::write_mutex_;
+// Queue and background thread for asynchronous writing
+std::vector<std::pair<std::string, std::string>> DefaultLogger::queue_;
+bool DefaultLogger::asynchronous_{false};
+bool DefaultLogger::writing_{false};
+std::mutex DefaultLogger::queue_mutex_;
+std::condition_variable DefaultLogger::queue_condition_;
+std::thread DefaultLogger::writer_thread_;
 
 /**
  * The logger will save the number of uncaught exceptions during construction to compare that with the number of exceptions
@@ -38,9 +46,9 @@ std::mutex DefaultLogger::write_mutex_;
 DefaultLogger::DefaultLogger() : exception_count_(get_uncaught_exceptions(true)) {}
 
 /**
- * The output is written to the streams as soon as the logger gets out-of-scope and desctructed. The destructor checks
- * specifically if an exception is thrown while output is written to the stream. In that case the log stream will not be
- * forwarded to the output streams and the message will be discarded.
+ * The output is written to the streams as soon as the logger gets out-of-scope and desctructed, or queued for the writer
+ * thread in asynchronous mode. The destructor checks specifically if an exception is thrown while output is written to the
+ * stream. In that case the log stream will not be forwarded to the output streams and the message will be discarded.
  */
 DefaultLogger::~DefaultLogger() {
     // Check if an exception is thrown while adding output to the stream
@@ -64,12 +72,29 @@ DefaultLogger::~DefaultLogger() {
         } while((start_pos = out.find('\n', start_pos)) != std::string::npos);
     }
 
+    // Queue the message if writing asynchronously, but wait until fatal messages are written
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        if(asynchronous_) {
+            queue_.emplace_back(std::move(out), identifier_);
+            queue_condition_.notify_all();
+            if(level_ == LogLevel::FATAL) {
+                queue_condition_.wait(lock, []() { return queue_.empty() && !writing_; });
+            }
+            return;
+        }
+    }
+
+    write(std::move(out), identifier_);
+}
+
+void DefaultLogger::write(std::string out, const std::string& identifier) {
     // Lock the mutex to guard last identifier usage
     std::unique_lock<std::mutex> lock(write_mutex_);
 
     // Add extra spaces if necessary
     size_t extra_spaces = 0;
-    if(!identifier_.empty() && last_identifier_ == identifier_) {
+    if(!identifier.empty() && last_identifier_ == identifier) {
         // Put carriage return for process logs
         out = '\r' + out;
 
@@ -81,7 +106,7 @@ DefaultLogger::~DefaultLogger() {
         // End process log and continue normal logging
         out = '\n' + out;
     }
-    last_identifier_ = identifier_;
+    last_identifier_ = identifier;
 
     // Save last message
     last_message_ = out;
@@ -93,7 +118,7 @@ DefaultLogger::~DefaultLogger() {
     }
 
     // Add final newline if not a progress log
-    if(identifier_.empty()) {
+    if(identifier.empty()) {
         out += '\n';
     }
 
@@ -127,11 +152,61 @@ DefaultLogger::~DefaultLogger() {
     lock.unlock();
 }
 
+/**
+ * Progress messages directly followed by a message with the same identifier are skipped, as they would be overwritten
+ * immediately. All remaining messages are written before the thread stops.
+ */
+void DefaultLogger::write_loop() {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    while(true) {
+        queue_condition_.wait(lock, []() { return !queue_.empty() || !asynchronous_; });
+        if(queue_.empty()) {
+            break;
+        }
+
+        // Take all queued messages and write them without holding the queue lock
+        std::vector<std::pair<std::string, std::string>> messages;
+        messages.swap(queue_);
+        writing_ = true;
+        lock.unlock();
+        for(size_t i = 0; i < messages.size(); ++i) {
+            const auto& identifier = messages[i].second;
+            if(!identifier.empty() && i + 1 < messages.size() && messages[i + 1].second == identifier) {
+                continue;
+            }
+            write(std::move(messages[i].first), identifier);
+        }
+        lock.lock();
+        writing_ = false;
+        queue_condition_.notify_all();
+    }
+}
+
+void DefaultLogger::setAsynchronous(bool asynchronous) {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    if(asynchronous == asynchronous_) {
+        return;
+    }
+    asynchronous_ = asynchronous;
+    if(asynchronous) {
+        writer_thread_ = std::thread(&DefaultLogger::write_loop);
+        return;
+    }
+
+    // Stop the writer thread after it has written all queued messages
+    queue_condition_.notify_all();
+    lock.unlock();
+    writer_thread_.join();
+}
+
 /**
  * @warning No other log message should be send after this method
  * @note Does not close the streams
  */
 void DefaultLogger::finish() {
+    // Write all queued messages
+    setAsynchronous(false);
+
     // Lock the mutex to guard output writing
     std::lock_guard<std::mutex> lock(write_mutex_);
 
@@ -163,6 +238,8 @@ void DefaultLogger::finish() {
  */
 std::ostringstream&
 DefaultLogger::getStream(LogLevel level, const std::string& file, const std::string& function, uint32_t line) {
+    level_ = level;
+
     // Add date in all except short format
     if(get_format() != LogFormat::SHORT) {
         os << "\x1B[1m"; // BOLD
@@ -365,6 +442,9 @@ void DefaultLogger::setSection(std::string section) {
 std::string DefaultLogger::getSection() {
     return get_section();
 }
+void DefaultLogger::swapSection(std::string& section) {
+    get_section().swap(section);
+}
 
 /**
  * The date is returned in the hh:mm:ss.ms format
@@ -375,7 +455,10 @@ std::string DefaultLogger::get_current_date() {
     auto in_time_t = std::chrono::system_clock::to_time_t(now);
 
     std::stringstream ss;
-    ss << std::put_time(std::localtime(&in_time_t), "%X");
+    // Use the reentrant version, as messages are formatted by multiple threads at the same time
+    std::tm local_time{};
+    localtime_r(&in_time_t, &local_time);
+    ss << std::put_time(&local_time, "%X");
 
     auto seconds_from_epoch = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch());
     auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch() - seconds_from_epoch).count();
@@ -14,11 +14,14 @@
 #define __func__ __FUNCTION__
 #endif
 
+#include <condition_variable>
 #include <cstring>
 #include <mutex>
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 namespace allpix {
@@ -111,6 +114,16 @@ namespace allpix {
          */
         static void finish();
 
+        /**
+         * @brief Enable or disable writing the messages to the streams from a background thread
+         * @param asynchronous True to write asynchronously, false to write every message as soon as it is finished
+         *
+         * In asynchronous mode, finished messages are only added to a queue, such that threads logging at the same time do
+         * not wait for each other to write to the streams. Disabling the mode writes all queued messages before returning.
+         * Fatal messages are always written before the logging thread continues.
+         */
+        static void setAsynchronous(bool asynchronous);
+
         /**
          * @brief Get the reporting level for logging
          * @return The current log level
@@ -184,6 +197,11 @@ namespace allpix {
          * @return Header used
          */
         static std::string getSection();
+        /**
+         * @brief Exchange the current section header with another one without copying either of them
+         * @param header Header to use from now on, replaced by the previously used header
+         */
+        static void swapSection(std::string& header);
 
     private:
         /**
@@ -198,6 +216,18 @@ namespace allpix {
          */
         std::string get_current_date();
 
+        /**
+         * @brief Write a finished message to all streams
+         * @param out Formatted message
+         * @param identifier Identifier of the process stream or empty for a normal log message
+         */
+        static void write(std::string out, const std::string& identifier);
+
+        /**
+         * @brief Constantly running function of the background thread writing the queued messages
+         */
+        static void write_loop();
+
         /**
          * @brief Return if a stream is likely a terminal screen (supporting colors etc.)
          * @return True if the stream is terminal, false otherwise
@@ -211,6 +241,8 @@ namespace allpix {
         int exception_count_{};
         // Saved value of the length of the header indent
         unsigned int indent_count_{};
+        // Level of the message
+        LogLevel level_{LogLevel::INFO};
 
         // Internal methods to store static values
         static std::string& get_section();
@@ -224,6 +256,14 @@ namespace allpix {
         static std::string last_identifier_;
 
         static std::mutex write_mutex_;
+
+        // Queue of messages and their identifiers for asynchronous writing
+        static std::vector<std::pair<std::string, std::string>> queue_;
+        static bool asynchronous_;
+        static bool writing_;
+        static std::mutex queue_mutex_;
+        static std::condition_variable queue_condition_;
+        static std::thread writer_thread_;
     };
 
     using Log = DefaultLogger;
@@ -233,18 +273,37 @@ namespace allpix {
  */
 #define __FILE_NAME__ (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
 
+/**
+ * @brief Highest log level compiled into the framework, all messages of higher levels are removed at compile time
+ * @note Set through the LOG_LEVEL_MAX option of CMake
+ */
+#ifndef ALLPIX_LOG_LEVEL_MAX
+#define ALLPIX_LOG_LEVEL_MAX TRACE
+#endif
+
+/**
+ * @brief Check if messages of a log level should be written
+ * @param level The log level to check
+ *
+ * The first comparison is a constant expression, such that the compiler removes the message and the evaluation of all its
+ * arguments if the level is not compiled in. Otherwise the arguments are only evaluated if the message is written.
+ */
+#define LOG_ENABLED(level)                                                                                                  \
+    (allpix::LogLevel::level <= allpix::LogLevel::ALLPIX_LOG_LEVEL_MAX &&                                                   \
+     allpix::LogLevel::level <= allpix::Log::getReportingLevel() && !allpix::Log::getStreams().empty())
+
 /**
  * @brief Execute a block only if the reporting level is high enough
  * @param level The minimum log level
  */
-#define IFLOG(level) if(allpix::LogLevel::level <= allpix::Log::getReportingLevel() && !allpix::Log::getStreams().empty())
+#define IFLOG(level) if(LOG_ENABLED(level))
 
 /**
  * @brief Create a logging stream if the reporting level is high enough
  * @param level The log level of the stream
  */
 #define LOG(level)                                                                                                          \
-    if(allpix::LogLevel::level <= allpix::Log::getReportingLevel() && !allpix::Log::getStreams().empty())                   \
+    if(LOG_ENABLED(level))                                                                                                  \
     allpix::Log().getStream(                                                                                                \
         allpix::LogLevel::level, __FILE_NAME__, std::string(static_cast<const char*>(__func__)), __LINE__)
 
@@ -254,7 +313,7 @@ namespace allpix {
  * @param identifier Identifier for this stream to determine overwrites
  */
 #define LOG_PROGRESS(level, identifier)                                                                                     \
-    if(allpix::LogLevel::level <= allpix::Log::getReportingLevel() && !allpix::Log::getStreams().empty())                   \
+    if(LOG_ENABLED(level))                                                                                                  \
     allpix::Log().getProcessStream(                                                                                         \
         identifier, allpix::LogLevel::level, __FILE_NAME__, std::string(static_cast<const char*>(__func__)), __LINE__)
 
@@ -281,7 +340,7 @@ namespace allpix {
 #define LOG_N(level, max_log_count)                                                                                         \
     GENERATE_LOG_VAR(max_log_count);                                                                                        \
     if(GET_LOG_VARIABLE(max_log_count) != 0 && GET_LOG_VARIABLE(max_log_count)-- != 0)                                      \
-        if(allpix::LogLevel::level <= allpix::Log::getReportingLevel() && !allpix::Log::getStreams().empty())               \
+        if(LOG_ENABLED(level))                                                                                              \
     allpix::Log().getStream(                                                                                                \
         allpix::LogLevel::level, __FILE_NAME__, std::string(static_cast<const char*>(__func__)), __LINE__)                  \
         << std::string(GET_LOG_VARIABLE(max_log_count) == 0 ? "[further messages will be suppressed] " : "")
@@ -0,0 +1,103 @@
+/**
+ * @file
+ * @brief Allocation of large memory blocks backed by huge pages
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_MEMORY_H
+#define ALLPIX_MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+#include <sys/mman.h>
+
+#if defined(__linux__) && !defined(MADV_COLLAPSE)
+// Synchronous collapse into transparent huge pages, available since Linux 6.1 but not yet defined by all C libraries
+#define MADV_COLLAPSE 25
+#endif
+
+namespace allpix {
+
+    /**
+     * @brief Size of the huge pages large memory blocks are aligned to
+     */
+    constexpr size_t huge_page_size = size_t(1) << 21;
+
+    /**
+     * @brief Allocate a large block of memory, optionally backed by huge pages to reduce the misses of the TLB
+     * @param bytes Size of the block in bytes
+     * @param huge_pages Back the block by huge pages if available
+     * @return Shared pointer to the block, which is released when the last copy of the pointer is destroyed
+     * @throws std::bad_alloc If the memory cannot be allocated
+     *
+     * Explicit huge pages reserved by the system administrator are used if enough are available. Otherwise the block is
+     * allocated with regular pages and the kernel is advised to back it by transparent huge pages, which is silently ignored
+     * if these are disabled. The block is aligned to the size of a huge page and initialized to zero.
+     */
+    inline std::shared_ptr<void> allocate_large_memory(size_t bytes, bool huge_pages) {
+        auto length = (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+        if(length == 0) {
+            length = huge_page_size;
+        }
+
+        void* address = MAP_FAILED; // NOLINT
+#ifdef MAP_HUGETLB
+        if(huge_pages) {
+            address = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+#endif
+        if(address == MAP_FAILED) { // NOLINT
+            // Reserve an additional huge page to align the block, the excess is returned afterwards
+            auto* reserved =
+                ::mmap(nullptr, length + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(reserved == MAP_FAILED) { // NOLINT
+                throw std::bad_alloc();
+            }
+            auto begin = reinterpret_cast<uintptr_t>(reserved); // NOLINT
+            auto aligned = (begin + huge_page_size - 1) / huge_page_size * huge_page_size;
+            if(aligned > begin) {
+                ::munmap(reserved, aligned - begin);
+            }
+            ::munmap(reinterpret_cast<void*>(aligned + length), begin + huge_page_size - aligned); // NOLINT
+            address = reinterpret_cast<void*>(aligned);                                           // NOLINT
+#ifdef MADV_HUGEPAGE
+            if(huge_pages) {
+                ::madvise(address, length, MADV_HUGEPAGE);
+            }
+#endif
+        }
+        return std::shared_ptr<void>(address, [length](void* ptr) { ::munmap(ptr, length); });
+    }
+
+    /**
+     * @brief Advise the kernel to back existing memory by transparent huge pages
+     * @param address Beginning of the memory
+     * @param bytes Size of the memory in bytes
+     *
+     * Only the huge pages fully contained in the memory are affected. The pages already in use are collapsed into huge
+     * pages immediately where supported by the kernel, otherwise in the background. The advice is silently ignored if
+     * transparent huge pages are disabled or the memory is not anonymous.
+     */
+    inline void advise_huge_pages(const void* address, size_t bytes) {
+        auto start = reinterpret_cast<uintptr_t>(address); // NOLINT
+        auto begin = (start + huge_page_size - 1) / huge_page_size * huge_page_size;
+        auto end = (start + bytes) / huge_page_size * huge_page_size;
+        if(end <= begin) {
+            return;
+        }
+#ifdef MADV_HUGEPAGE
+        ::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE); // NOLINT
+#endif
+#ifdef MADV_COLLAPSE
+        ::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_COLLAPSE); // NOLINT
+#endif
+    }
+} // namespace allpix
+
+#endif /* ALLPIX_MEMORY_H */
@@ -0,0 +1,110 @@
+/**
+ * @file
+ * @brief Implementation of the utilities for systems with non-uniform memory access
+ *
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "numa.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "text.h"
+
+using namespace allpix;
+
+namespace {
+    thread_local unsigned int current_numa_node{0};
+
+    /**
+     * @brief Read the NUMA topology of the system from sysfs, where every node lists its CPUs as ranges like "0-7,16-23"
+     * @return Map of the CPU indices to the index of their node, empty if the topology is not available
+     */
+    std::map<unsigned int, unsigned int> read_cpu_nodes() {
+        std::map<unsigned int, unsigned int> cpu_nodes;
+        for(unsigned int node = 0;; ++node) {
+            std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string line;
+            if(!cpulist || !std::getline(cpulist, line)) {
+                break;
+            }
+            for(const auto& range : split<std::string>(trim(line), ",")) {
+                auto bounds = split<unsigned int>(range, "-");
+                if(bounds.empty()) {
+                    continue;
+                }
+                for(auto cpu = bounds.front(); cpu <= bounds.back(); ++cpu) {
+                    cpu_nodes[cpu] = node;
+                }
+            }
+        }
+        return cpu_nodes;
+    }
+
+    /**
+     * @brief Topology of the system, read once on first use
+     */
+    const std::map<unsigned int, unsigned int>& cpu_nodes() {
+        static const std::map<unsigned int, unsigned int> topology = read_cpu_nodes();
+        return topology;
+    }
+} // namespace
+
+std::vector<unsigned int> allpix::get_available_cpus() {
+    std::vector<unsigned int> cpus;
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if(sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+        for(unsigned int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if(CPU_ISSET(cpu, &cpu_set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return cpus;
+}
+
+unsigned int allpix::get_numa_node_count() {
+    unsigned int nodes = 1;
+    for(const auto& cpu_node : cpu_nodes()) {
+        nodes = std::max(nodes, cpu_node.second + 1);
+    }
+    return nodes;
+}
+
+unsigned int allpix::get_cpu_numa_node(unsigned int cpu) {
+    auto node = cpu_nodes().find(cpu);
+    return (node != cpu_nodes().end() ? node->second : 0);
+}
+
+bool allpix::pin_thread_to_cpu(unsigned int cpu) {
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    if(pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0) {
+        current_numa_node = get_cpu_numa_node(cpu);
+        return true;
+    }
+#else
+    (void)cpu;
+#endif
+    return false;
+}
+
+unsigned int allpix::get_thread_numa_node() {
+    return current_numa_node;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file
+ * @brief Utilities to place threads and memory on the nodes of systems with non-uniform memory access
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_NUMA_H
+#define ALLPIX_NUMA_H
+
+#include <vector>
+
+namespace allpix {
+
+    /**
+     * @brief Get the CPUs the calling process is allowed to run on
+     * @return List of CPU indices in increasing order, empty if the affinity cannot be determined on this system
+     */
+    std::vector<unsigned int> get_available_cpus();
+
+    /**
+     * @brief Get the number of NUMA nodes of the system
+     * @return Number of nodes, one if the topology cannot be determined on this system
+     */
+    unsigned int get_numa_node_count();
+
+    /**
+     * @brief Get the NUMA node a CPU belongs to
+     * @param cpu Index of the CPU
+     * @return Index of the node, zero if the topology cannot be determined on this system
+     */
+    unsigned int get_cpu_numa_node(unsigned int cpu);
+
+    /**
+     * @brief Pin the calling thread to a single CPU and record the NUMA node of the CPU for the thread
+     * @param cpu Index of the CPU
+     * @return True if the thread has been pinned, false if pinning is not supported or failed
+     */
+    bool pin_thread_to_cpu(unsigned int cpu);
+
+    /**
+     * @brief Get the NUMA node of the calling thread
+     * @return Index of the node the thread has been pinned to, zero for threads which have not been pinned
+     *
+     * Memory allocated and first written by a thread is placed on the node of the thread by the operating system, such that
+     * data read by the threads of a node can be copied to the local memory of the node by one of them.
+     */
+    unsigned int get_thread_numa_node();
+} // namespace allpix
+
+#endif /* ALLPIX_NUMA_H */
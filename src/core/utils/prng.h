@@ -0,0 +1,131 @@
+/**
+ * @file
+ * @brief Counter-based pseudo random number engine
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_PRNG_H
+#define ALLPIX_PRNG_H
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace allpix {
+
+    /**
+     * @brief Counter-based random engine using the Philox4x32-10 bijection
+     *
+     * Every random number is computed directly from a key and a counter, without any state carried from one number to the
+     * next apart from the counter itself. Engines with different keys or streams yield independent sequences, such that a
+     * separate engine can be created cheaply for every independent unit of work, for example every deposit in an event.
+     * The results are then identical regardless of how the work is distributed over threads. The engine satisfies the
+     * requirements of a UniformRandomBitGenerator and can be used with all distributions of the standard library.
+     *
+     * The algorithm is described in J. K. Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC11 (2011).
+     */
+    class CounterRandomEngine {
+    public:
+        using result_type = uint64_t;
+
+        /**
+         * @brief Construct an engine for a stream of random numbers
+         * @param key Key of the engine, typically derived from a seed
+         * @param stream Index of the stream for this key
+         */
+        explicit CounterRandomEngine(uint64_t key, uint64_t stream = 0) : key_(key), stream_(stream) {}
+
+        /**
+         * @brief Create an independent engine for a sub-stream of this stream
+         * @param index Index of the sub-stream
+         * @return Engine keyed by the key and stream of this engine, starting at the beginning of the sub-stream
+         *
+         * Splitting can be applied repeatedly to derive engines for a hierarchy of units of work, for example per module
+         * instance, per event and per deposit. The position of this engine in its stream does not affect the result.
+         */
+        CounterRandomEngine split(uint64_t index) const { return CounterRandomEngine(mix(key_ ^ mix(stream_)), index); }
+
+        /**
+         * @brief Get the next random number of the stream
+         * @return Uniformly distributed 64 bit random number
+         */
+        result_type operator()() {
+            auto block = index_ / 2;
+            if(!buffer_valid_ || block != buffer_block_) {
+                generate_block(block);
+            }
+            return buffer_[index_++ % 2];
+        }
+
+        /**
+         * @brief Skip a number of random numbers in constant time
+         * @param count Number of random numbers to skip
+         */
+        void discard(uint64_t count) { index_ += count; }
+
+        /**
+         * @brief Smallest value returned by the engine
+         */
+        static constexpr result_type min() { return std::numeric_limits<result_type>::min(); }
+
+        /**
+         * @brief Largest value returned by the engine
+         */
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    private:
+        /**
+         * @brief Compute a block of two random numbers from the key, the stream and the block counter
+         * @param block Counter of the block within the stream
+         */
+        void generate_block(uint64_t block) {
+            std::array<uint32_t, 4> ctr{{static_cast<uint32_t>(block),
+                                         static_cast<uint32_t>(block >> 32),
+                                         static_cast<uint32_t>(stream_),
+                                         static_cast<uint32_t>(stream_ >> 32)}};
+            uint32_t key0 = static_cast<uint32_t>(key_);
+            uint32_t key1 = static_cast<uint32_t>(key_ >> 32);
+            for(int round = 0; round < 10; ++round) {
+                auto product0 = static_cast<uint64_t>(0xD2511F53u) * ctr[0];
+                auto product1 = static_cast<uint64_t>(0xCD9E8D57u) * ctr[2];
+                ctr = {{static_cast<uint32_t>(product1 >> 32) ^ ctr[1] ^ key0,
+                        static_cast<uint32_t>(product1),
+                        static_cast<uint32_t>(product0 >> 32) ^ ctr[3] ^ key1,
+                        static_cast<uint32_t>(product0)}};
+                key0 += 0x9E3779B9u;
+                key1 += 0xBB67AE85u;
+            }
+            buffer_[0] = (static_cast<uint64_t>(ctr[1]) << 32) | ctr[0];
+            buffer_[1] = (static_cast<uint64_t>(ctr[3]) << 32) | ctr[2];
+            buffer_block_ = block;
+            buffer_valid_ = true;
+        }
+
+        /**
+         * @brief Mix the bits of a value to derive keys of split engines (finalizer of SplitMix64)
+         */
+        static uint64_t mix(uint64_t value) {
+            value ^= value >> 30;
+            value *= 0xbf58476d1ce4e5b9ULL;
+            value ^= value >> 27;
+            value *= 0x94d049bb133111ebULL;
+            value ^= value >> 31;
+            return value;
+        }
+
+        uint64_t key_;
+        uint64_t stream_;
+        // Index of the next random number in the stream
+        uint64_t index_{};
+
+        // Last computed block, every block yields two random numbers
+        std::array<uint64_t, 2> buffer_{};
+        uint64_t buffer_block_{};
+        bool buffer_valid_{false};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_PRNG_H */
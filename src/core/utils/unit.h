@@ -16,8 +16,6 @@
 #include <string>
 #include <utility>
 
-// TODO [doc] Check if this class can be constexpressed?
-
 namespace allpix {
 
     /**
@@ -132,6 +130,60 @@ namespace allpix {
     private:
         static std::map<std::string, UnitType> unit_map_;
     };
+
+    /**
+     * @brief Compile-time constants of the framework units, registered with the unit system by \ref allpix::register_units
+     *
+     * Values in a particular unit are converted to the base units by multiplying with the constant of that unit and back by
+     * dividing by it. Contrary to the string-based access of \ref Units, the conversion can be folded by the compiler and
+     * should therefore be preferred in code executed for every event.
+     */
+    namespace units {
+        // Length
+        constexpr double nm = 1e-6;
+        constexpr double um = 1e-3;
+        constexpr double mm = 1;
+        constexpr double cm = 1e1;
+        constexpr double dm = 1e2;
+        constexpr double m = 1e3;
+        constexpr double km = 1e6;
+
+        // Time
+        constexpr double ps = 1e-3;
+        constexpr double ns = 1;
+        constexpr double us = 1e3;
+        constexpr double ms = 1e6;
+        constexpr double s = 1e9;
+
+        // Temperature
+        constexpr double K = 1;
+
+        // Energy
+        constexpr double eV = 1e-6;
+        constexpr double keV = 1e-3;
+        constexpr double MeV = 1;
+        constexpr double GeV = 1e3;
+
+        // Charge
+        constexpr double e = 1;
+        constexpr double ke = 1e3;
+        constexpr double fC = 1 / 1.602176634e-4;
+        constexpr double C = 1 / 1.602176634e-19;
+
+        // Voltage, fixed by the units of energy and charge
+        constexpr double mV = 1e-9;
+        constexpr double V = 1e-6;
+        constexpr double kV = 1e-3;
+
+        // Magnetic field
+        constexpr double T = 1e-3;
+        constexpr double mT = 1e-6;
+
+        // Angles
+        constexpr double deg = 3.14159265358979323846 / 180.0;
+        constexpr double rad = 1;
+        constexpr double mrad = 1e-3;
+    } // namespace units
 } // namespace allpix
 
 // Include template definitions
@@ -11,14 +11,17 @@
 #include <atomic>
 #include <csignal>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <memory>
+#include <new>
 #include <string>
 #include <utility>
 
 #include "core/Allpix.hpp"
 #include "core/config/ConfigManager.hpp"
 #include "core/geometry/GeometryManager.hpp"
+#include "core/utils/allocations.h"
 #include "core/utils/exceptions.h"
 
 #include "core/utils/log.h"
@@ -32,6 +35,41 @@ void interrupt_handler(int);
 std::unique_ptr<Allpix> apx;
 std::atomic<bool> apx_ready{false};
 
+/**
+ * @brief Global allocation function reporting every allocation to the counter used by the benchmark mode
+ *
+ * Behaves like the default allocation function, the array and non-throwing versions forward to it by default.
+ */
+void* operator new(std::size_t size) {
+    AllocationCounter::record();
+    while(true) {
+        void* ptr = std::malloc(size == 0 ? 1 : size); // NOLINT
+        if(ptr != nullptr) {
+            return ptr;
+        }
+        auto handler = std::get_new_handler();
+        if(handler == nullptr) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+void operator delete(void* ptr) noexcept {
+    std::free(ptr); // NOLINT
+}
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr); // NOLINT
+}
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr); // NOLINT
+}
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr); // NOLINT
+}
+
 /**
  * @brief Handle user abort (CTRL+\) which should stop the framework immediately
  * @note This handler is actually not fully reliable (but otherwise crashing is okay...)
@@ -71,6 +109,9 @@ void clean() {
  * @brief Main function running the application
  */
 int main(int argc, const char* argv[]) {
+    // The global allocation functions of this executable report to the allocation counter
+    AllocationCounter::install();
+
     // Add cout as the default logging stream
     Log::addStream(std::cout);
 
@@ -125,6 +166,15 @@ int main(int argc, const char* argv[]) {
             module_options.emplace_back(std::string(argv[++i]));
         } else if(strcmp(argv[i], "-g") == 0 && (i + 1 < argc)) {
             detector_options.emplace_back(std::string(argv[++i]));
+        } else if(strcmp(argv[i], "--benchmark") == 0 && (i + 1 < argc)) {
+            // Benchmark options are passed as framework parameters, such that they can be used with any configuration
+            module_options.emplace_back("benchmark_events=" + std::string(argv[++i]));
+        } else if(strcmp(argv[i], "--warmup") == 0 && (i + 1 < argc)) {
+            module_options.emplace_back("benchmark_warmup_events=" + std::string(argv[++i]));
+        } else if(strcmp(argv[i], "--null-writers") == 0) {
+            module_options.emplace_back("benchmark_null_writers=true");
+        } else if(strcmp(argv[i], "--estimate") == 0 && (i + 1 < argc)) {
+            module_options.emplace_back("estimate_events=" + std::string(argv[++i]));
         } else {
             LOG(ERROR) << "Unrecognized command line argument \"" << argv[i] << "\"";
             print_help = true;
@@ -145,6 +195,10 @@ int main(int argc, const char* argv[]) {
         std::cout << "  -o <option>  extra module configuration option(s) to pass" << std::endl;
         std::cout << "  -g <option>  extra detector configuration options(s) to pass" << std::endl;
         std::cout << "  -v <level>   verbosity level, overwriting the global level" << std::endl;
+        std::cout << "  --benchmark <events>  time the given number of events after the warm-up events" << std::endl;
+        std::cout << "  --warmup <events>     number of untimed warm-up events of the benchmark" << std::endl;
+        std::cout << "  --null-writers        do not load the writer modules, to benchmark without output" << std::endl;
+        std::cout << "  --estimate <events>   estimate the cost of the run from the given number of events" << std::endl;
         std::cout << "  --version    print version information and quit" << std::endl;
         std::cout << std::endl;
         std::cout << "For more help, please see <https://cern.ch/allpix-squared>" << std::endl;
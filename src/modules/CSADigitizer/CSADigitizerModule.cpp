@@ -0,0 +1,246 @@
+/**
+ * @file
+ * @brief Implementation of the digitization module simulating the pulse shaping of a charge-sensitive amplifier
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "CSADigitizerModule.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <utility>
+
+#include "core/module/exceptions.h"
+#include "core/utils/log.h"
+#include "core/utils/unit.h"
+
+using namespace allpix;
+
+CSADigitizerModule::CSADigitizerModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector)
+    : Module(config, std::move(detector)), messenger_(messenger) {
+    // Enable parallelization of this module if multithreading is enabled
+    enable_parallelization();
+
+    // Set defaults for config variables
+    config_.setDefault<double>("rise_time_constant", Units::get(1, "ns"));
+    config_.setDefault<double>("feedback_time_constant", Units::get(20, "ns"));
+    config_.setDefault<double>("amplification", Units::get(10, "mV/ke"));
+    config_.setDefault<double>("integration_time", Units::get(200, "ns"));
+    config_.setDefault<double>("threshold", Units::get(10, "mV"));
+    config_.setDefault<double>("sigma_noise", Units::get(0.1, "mV"));
+    config_.setDefault<double>("clock_bin_toa", Units::get(1, "ns"));
+    config_.setDefault<double>("clock_bin_tot", Units::get(1, "ns"));
+    config_.setDefault<std::string>("signal", "tot");
+    config_.setDefault<bool>("output_plots", false);
+    config_.setDefault<int>("output_plots_bins", 100);
+
+    // Copy some variables from configuration to avoid lookups
+    rise_time_constant_ = config_.get<double>("rise_time_constant");
+    feedback_time_constant_ = config_.get<double>("feedback_time_constant");
+    amplification_ = config_.get<double>("amplification");
+    integration_time_ = config_.get<double>("integration_time");
+    threshold_ = config_.get<double>("threshold");
+    sigma_noise_ = config_.get<double>("sigma_noise");
+    clock_bin_toa_ = config_.get<double>("clock_bin_toa");
+    clock_bin_tot_ = config_.get<double>("clock_bin_tot");
+    output_plots_ = config_.get<bool>("output_plots");
+
+    auto signal = config_.get<std::string>("signal");
+    std::transform(signal.begin(), signal.end(), signal.begin(), ::tolower);
+    if(signal != "tot" && signal != "amplitude") {
+        throw InvalidValueError(config_, "signal", "signal should be 'tot' or 'amplitude'");
+    }
+    store_amplitude_ = (signal == "amplitude");
+
+    // Require PixelCharge message for single detector
+    messenger_->bindSingle<PixelChargeMessage>(this, MsgFlags::REQUIRED);
+}
+
+void CSADigitizerModule::init() {
+    if(rise_time_constant_ < 0) {
+        throw InvalidValueError(config_, "rise_time_constant", "rise time constant cannot be negative");
+    }
+    if(feedback_time_constant_ <= 0) {
+        throw InvalidValueError(config_, "feedback_time_constant", "feedback time constant should be positive");
+    }
+    if(integration_time_ <= 0) {
+        throw InvalidValueError(config_, "integration_time", "integration time should be positive");
+    }
+    if(clock_bin_toa_ <= 0) {
+        throw InvalidValueError(config_, "clock_bin_toa", "clock period should be positive");
+    }
+    if(clock_bin_tot_ <= 0) {
+        throw InvalidValueError(config_, "clock_bin_tot", "clock period should be positive");
+    }
+    LOG(INFO) << "Amplifying pulses with rise time constant " << Units::display(rise_time_constant_, {"ps", "ns"})
+              << " and feedback time constant " << Units::display(feedback_time_constant_, {"ns", "us"})
+              << ", integrating for " << Units::display(integration_time_, {"ns", "us"});
+
+    if(output_plots_) {
+        LOG(TRACE) << "Creating output plots";
+        auto nbins = config_.get<int>("output_plots_bins");
+        auto integration_time = static_cast<double>(Units::convert(integration_time_, "ns"));
+        h_amplitude_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "amplitude",
+            "amplitude of the amplified signal;|amplitude| [mV];pixels",
+            nbins,
+            0,
+            static_cast<double>(Units::convert(10 * std::fabs(threshold_), "mV")));
+        h_toa_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "time_of_arrival", "time of arrival;ToA [ns];pixels", nbins, 0, integration_time);
+        h_tot_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "time_over_threshold", "time over threshold;ToT [ns];pixels", nbins, 0, integration_time);
+    }
+}
+
+/**
+ * The impulse response of the amplifier with the rise time constant \f$\tau_r\f$ and the feedback time constant
+ * \f$\tau_f\f$ is \f$A \frac{\tau_f}{\tau_f - \tau_r} (e^{-t/\tau_f} - e^{-t/\tau_r})\f$, which approaches the
+ * amplification \f$A\f$ for fast rise times. For equal time constants the limit \f$A \frac{t}{\tau} e^{-t/\tau}\f$ is used.
+ */
+std::vector<double> CSADigitizerModule::sample_impulse_response(double binning, size_t bins) const {
+    std::vector<double> response(bins);
+    for(size_t bin = 0; bin < bins; ++bin) {
+        auto time = binning * static_cast<double>(bin);
+        if(rise_time_constant_ == feedback_time_constant_) {
+            response[bin] = amplification_ * time / feedback_time_constant_ * std::exp(-time / feedback_time_constant_);
+        } else if(rise_time_constant_ == 0) {
+            response[bin] = amplification_ * std::exp(-time / feedback_time_constant_);
+        } else {
+            response[bin] = amplification_ * feedback_time_constant_ / (feedback_time_constant_ - rise_time_constant_) *
+                            (std::exp(-time / feedback_time_constant_) - std::exp(-time / rise_time_constant_));
+        }
+    }
+    return response;
+}
+
+/**
+ * The transform of the impulse response only depends on the binning of the pulses and is computed once for every binning,
+ * shared by all events processed concurrently.
+ */
+std::shared_ptr<const FFTConvolution> CSADigitizerModule::get_convolution(double binning) {
+    std::lock_guard<std::mutex> lock(convolutions_mutex_);
+    auto iter = convolutions_.find(binning);
+    if(iter != convolutions_.end()) {
+        return iter->second;
+    }
+
+    auto bins = static_cast<size_t>(std::ceil(integration_time_ / binning));
+    LOG(DEBUG) << "Transforming impulse response for pulses with binning " << Units::display(binning, {"ps", "ns"})
+               << " over " << bins << " bins";
+    auto convolution = std::make_shared<const FFTConvolution>(sample_impulse_response(binning, bins), bins);
+    convolutions_[binning] = convolution;
+    return convolution;
+}
+
+/**
+ * All pulses of the event are amplified with the same transform of the impulse response, two pulses per transform. The
+ * signals of all pixels are compared to the threshold in a single pass over all bins before the edges are located.
+ */
+void CSADigitizerModule::run(Event* event) {
+    auto pixel_message = messenger_->fetchMessage<PixelChargeMessage>(this, event);
+    const auto& pixel_charges = pixel_message->getData();
+    if(pixel_charges.empty()) {
+        return;
+    }
+
+    // All pulses need to be sampled with the same binning
+    double binning = 0;
+    for(const auto& pixel_charge : pixel_charges) {
+        const auto& pulse = pixel_charge.getPulse();
+        if(pulse.getPulse().empty()) {
+            throw ModuleError("Pixel charge without pulse received, the pulses should be provided by a transfer module "
+                              "such as PulseTransfer");
+        }
+        if(binning == 0) {
+            binning = pulse.getBinning();
+        } else if(pulse.getBinning() != binning) {
+            throw ModuleError("Pulses of the pixels have different binnings");
+        }
+    }
+    auto convolution = get_convolution(binning);
+
+    // Amplify the pulses of all pixels
+    std::vector<std::vector<double>> signals(pixel_charges.size());
+    std::vector<double> unused;
+    for(size_t idx = 0; idx < pixel_charges.size(); idx += 2) {
+        if(idx + 1 < pixel_charges.size()) {
+            convolution->convolve(pixel_charges[idx].getPulse().getPulse(),
+                                  &pixel_charges[idx + 1].getPulse().getPulse(),
+                                  signals[idx],
+                                  signals[idx + 1]);
+        } else {
+            convolution->convolve(pixel_charges[idx].getPulse().getPulse(), nullptr, signals[idx], unused);
+        }
+    }
+
+    // Add the electronics noise and digitize the signals, negative thresholds are crossed from above
+    auto hits = MessageStorage<PixelHit>::acquire();
+    std::normal_distribution<double> noise(0, sigma_noise_);
+    const double sign = (threshold_ < 0 ? -1 : 1);
+    const double threshold = sign * threshold_;
+    std::vector<char> above;
+    for(size_t idx = 0; idx < pixel_charges.size(); ++idx) {
+        const auto& pixel_charge = pixel_charges[idx];
+        auto& signal = signals[idx];
+        if(sigma_noise_ > 0) {
+            for(auto& value : signal) {
+                value += noise(event->getRandomEngine());
+            }
+        }
+
+        above.resize(signal.size());
+        double amplitude = 0;
+        for(size_t bin = 0; bin < signal.size(); ++bin) {
+            above[bin] = static_cast<char>(sign * signal[bin] > threshold);
+            amplitude = std::max(amplitude, sign * signal[bin]);
+        }
+
+        auto rising = std::find(above.begin(), above.end(), 1);
+        if(rising == above.end()) {
+            LOG(DEBUG) << "Pixel " << pixel_charge.getIndex() << " below threshold, amplitude "
+                       << Units::display(sign * amplitude, {"mV", "V"});
+            continue;
+        }
+        auto falling = std::find(rising, above.end(), 0);
+
+        // Quantize the time of arrival and the time over threshold to the respective clocks
+        auto toa = std::ceil(binning * static_cast<double>(rising - above.begin()) / clock_bin_toa_) * clock_bin_toa_;
+        auto tot_cycles = std::ceil(binning * static_cast<double>(falling - rising) / clock_bin_tot_);
+        LOG(DEBUG) << "Pixel " << pixel_charge.getIndex() << " with amplitude "
+                   << Units::display(sign * amplitude, {"mV", "V"}) << ", ToA " << Units::display(toa, {"ns", "us"})
+                   << " and ToT of " << tot_cycles << " clock cycles";
+        if(output_plots_) {
+            h_amplitude_->Fill(static_cast<double>(Units::convert(amplitude, "mV")));
+            h_toa_->Fill(static_cast<double>(Units::convert(toa, "ns")));
+            h_tot_->Fill(static_cast<double>(Units::convert(tot_cycles * clock_bin_tot_, "ns")));
+        }
+
+        hits.emplace_back(pixel_charge.getPixel(), toa, (store_amplitude_ ? sign * amplitude : tot_cycles), &pixel_charge);
+    }
+
+    // Output summary and update statistics
+    LOG(INFO) << "Digitized " << hits.size() << " pixel hits";
+    total_pixels_ += pixel_charges.size();
+    total_hits_ += hits.size();
+
+    if(!hits.empty()) {
+        // Create and dispatch hit message
+        auto hits_message = std::make_shared<PixelHitMessage>(std::move(hits), getDetector());
+        messenger_->dispatchMessage(this, hits_message, event);
+    }
+}
+
+void CSADigitizerModule::finalize() {
+    if(output_plots_) {
+        h_amplitude_->merge()->Write();
+        h_toa_->merge()->Write();
+        h_tot_->merge()->Write();
+    }
+    LOG(INFO) << "Digitized " << total_hits_ << " pixel hits from the pulses of " << total_pixels_ << " pixels";
+}
@@ -0,0 +1,102 @@
+/**
+ * @file
+ * @brief Definition of the digitization module simulating the pulse shaping of a charge-sensitive amplifier
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_CSA_DIGITIZER_MODULE_H
+#define ALLPIX_CSA_DIGITIZER_MODULE_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <TH1D.h>
+
+#include "core/config/Configuration.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Module.hpp"
+#include "core/module/ThreadedHistogram.hpp"
+
+#include "objects/PixelCharge.hpp"
+#include "objects/PixelHit.hpp"
+
+#include "tools/fft.h"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to simulate the front-end response to the pulses of the induced charge
+     * @note This module supports parallelization
+     *
+     * The pulse of every pixel is convolved with the impulse response of a charge-sensitive amplifier using fast Fourier
+     * transforms. The time of arrival and the time over threshold are determined from the amplified signal.
+     */
+    class CSADigitizerModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this detector-specific module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param detector Pointer to the detector for this module instance
+         */
+        CSADigitizerModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector);
+
+        /**
+         * @brief Initialize the impulse response and the optional histograms
+         */
+        void init() override;
+
+        /**
+         * @brief Amplify the pulses of all pixels and digitize them
+         * @param event Pointer to the event to process
+         */
+        void run(Event* event) override;
+
+        /**
+         * @brief Write the histograms and a statistical summary
+         */
+        void finalize() override;
+
+    private:
+        /**
+         * @brief Get the convolution with the impulse response for pulses of the given binning
+         * @param binning Width of the bins of the pulses
+         * @return Convolution with the impulse response, created the first time the binning is encountered
+         */
+        std::shared_ptr<const FFTConvolution> get_convolution(double binning);
+
+        /**
+         * @brief Sample the impulse response of the amplifier
+         * @param binning Width of the bins to sample the response in
+         * @param bins Number of bins to sample
+         * @return Output voltage of the amplifier for a unit charge at the start of the first bin
+         */
+        std::vector<double> sample_impulse_response(double binning, size_t bins) const;
+
+        Messenger* messenger_;
+
+        // Parameters of the amplifier response and of the digitization
+        double rise_time_constant_{}, feedback_time_constant_{}, amplification_{};
+        double integration_time_{}, threshold_{}, sigma_noise_{}, clock_bin_toa_{}, clock_bin_tot_{};
+        bool store_amplitude_{}, output_plots_{};
+
+        // Convolutions with the impulse response by the binning of the pulses
+        std::map<double, std::shared_ptr<const FFTConvolution>> convolutions_;
+        std::mutex convolutions_mutex_;
+
+        // Statistics
+        std::atomic<unsigned long long> total_pixels_{}, total_hits_{};
+
+        // Output histograms
+        std::unique_ptr<ThreadedHistogram<TH1D>> h_amplitude_, h_toa_, h_tot_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_CSA_DIGITIZER_MODULE_H */
@@ -24,6 +24,7 @@
 #include <Eigen/Core>
 
 #include "objects/PixelCharge.hpp"
+#include "objects/PixelIndexMap.hpp"
 
 using namespace allpix;
 
@@ -39,9 +40,14 @@ CapacitiveTransferModule::CapacitiveTransferModule(Configuration& config,
     config_.setDefault("cross_coupling", 1);
     config_.setDefault("nominal_gap", 0.0);
     config_.setDefault("minimum_gap", config_.get<double>("nominal_gap"));
+    config_.setDefault("max_depth_distance", Units::get(5.0, "um"));
+
+    // Cache parameters used for every propagated charge
+    max_depth_distance_ = config_.getParameter<double>("max_depth_distance");
+    cross_coupling_ = config_.getParameter<int>("cross_coupling");
 
     // Require propagated deposits for single detector
-    messenger->bindSingle(this, &CapacitiveTransferModule::propagated_message_, MsgFlags::REQUIRED);
+    messenger->bindSingle<PropagatedChargeMessage>(this, MsgFlags::REQUIRED);
 }
 
 void CapacitiveTransferModule::init() {
@@ -53,6 +59,8 @@ void CapacitiveTransferModule::init() {
         relative_coupling = config_.getMatrix<double>("coupling_matrix");
         max_row = static_cast<unsigned int>(relative_coupling.size());
         max_col = static_cast<unsigned int>(relative_coupling[0].size());
+        matrix_rows = max_row;
+        matrix_cols = max_col;
 
         if(config_.get<bool>("output_plots")) {
             LOG(TRACE) << "Creating output plots";
@@ -157,7 +165,7 @@ void CapacitiveTransferModule::init() {
         }
         matrix_cols = 3;
         matrix_rows = 3;
-        if(config_.get<int>("cross_coupling") == 1) {
+        if(cross_coupling_ == 1) {
             max_col = 3;
             max_row = 3;
         } else {
@@ -260,99 +268,129 @@ void CapacitiveTransferModule::init() {
             "Capacitive coupling was not defined. Please, check the README file for configuration options or use "
             "the SimpleTransfer module.");
     }
+
+    build_coupling_table();
+}
+
+/**
+ * The coupling factors only depend on the position of the coupled pixel relative to the pixel the charge is collected at,
+ * and for capacitance scans on the gap at the coupled pixel. They are therefore calculated once for all pixels, such that
+ * transferring a charge only requires to look up the factors of its neighbors.
+ */
+void CapacitiveTransferModule::build_coupling_table() {
+    auto center_row = static_cast<int>(matrix_rows / 2);
+    auto center_col = static_cast<int>(matrix_cols / 2);
+
+    // Elements of the coupling matrix used for the transfer, only the central element without cross-coupling
+    std::vector<std::array<unsigned int, 2>> elements;
+    if(cross_coupling_ == 0) {
+        elements.push_back({{static_cast<unsigned int>(center_row), static_cast<unsigned int>(center_col)}});
+    } else {
+        for(unsigned int row = 0; row < max_row; row++) {
+            for(unsigned int col = 0; col < max_col; col++) {
+                elements.push_back({{row, col}});
+            }
+        }
+    }
+
+    coupling_offsets_.clear();
+    for(auto& element : elements) {
+        coupling_offsets_.push_back(
+            {{static_cast<int>(element[1]) - center_col, static_cast<int>(element[0]) - center_row}});
+    }
+
+    coupling_table_.clear();
+    pixel_dependent_coupling_ = config_.has("coupling_scan_file");
+    if(pixel_dependent_coupling_) {
+        auto pixel_grid = model_->getNPixels();
+        coupling_table_.reserve(static_cast<size_t>(pixel_grid.x()) * static_cast<size_t>(pixel_grid.y()) *
+                                elements.size());
+        for(int y = 0; y < pixel_grid.y(); y++) {
+            for(int x = 0; x < pixel_grid.x(); x++) {
+                // Gap between the sensor and the chip at the coupled pixel:
+                Eigen::Vector3d pixel_point(x * model_->getPixelSize().x(), y * model_->getPixelSize().y(), 0);
+                auto local_gap = static_cast<double>(Units::convert(plane.projection(pixel_point)[2], "um"));
+
+                for(auto& element : elements) {
+                    coupling_table_.push_back(capacitances[element[0] * 3 + element[1]]->Eval(local_gap, nullptr, "S") *
+                                              normalization);
+                }
+            }
+        }
+    } else {
+        for(auto& element : elements) {
+            auto row = element[0];
+            auto col = element[1];
+            coupling_table_.push_back(config_.has("coupling_file") ? relative_coupling[col][row]
+                                                                   : relative_coupling[max_row - row - 1][col]);
+        }
+    }
+    LOG(DEBUG) << "Calculated " << coupling_table_.size() << " coupling factors for " << coupling_offsets_.size()
+               << " coupled pixels";
 }
 
-void CapacitiveTransferModule::run(unsigned int) {
+void CapacitiveTransferModule::run(Event* event) {
+    auto propagated_message = messenger_->fetchMessage<PropagatedChargeMessage>(this, event);
 
     // Find corresponding pixels for all propagated charges
     LOG(TRACE) << "Transferring charges to pixels";
     unsigned int transferred_charges_count = 0;
-    std::map<Pixel::Index, std::pair<double, std::vector<const PropagatedCharge*>>> pixel_map;
-    for(auto& propagated_charge : propagated_message_->getData()) {
+    PixelIndexMap<std::pair<double, std::vector<const PropagatedCharge*>>> pixel_map;
+    const auto& geometry = detector_->getGeometry();
+    for(auto& propagated_charge : propagated_message->getData()) {
         auto position = propagated_charge.getLocalPosition();
         // Ignore if outside depth range of implant
-        if(std::fabs(position.z() - (model_->getSensorCenter().z() + model_->getSensorSize().z() / 2.0)) >
-           config_.get<double>("max_depth_distance")) {
+        if(std::fabs(position.z() - geometry.implantSurface()) > max_depth_distance_) {
             LOG(DEBUG) << "Skipping set of " << propagated_charge.getCharge() << " propagated charges at "
                        << propagated_charge.getLocalPosition() << " because their local position is not in implant range";
             continue;
         }
 
         // Find the nearest pixel
-        auto xpixel = static_cast<int>(std::round(position.x() / model_->getPixelSize().x()));
-        auto ypixel = static_cast<int>(std::round(position.y() / model_->getPixelSize().y()));
+        auto xpixel = geometry.nearestColumn(position.x());
+        auto ypixel = geometry.nearestRow(position.y());
         LOG(DEBUG) << "Hit at pixel " << xpixel << ", " << ypixel;
 
-        Pixel::Index pixel_index;
-        double neighbour_charge = 0;
-        double ccpd_factor = 0;
-
-        Eigen::Vector3d pixel_point;
-        Eigen::Vector3d pixel_projection;
-
-        for(size_t row = 0; row < max_row; row++) {
-            for(size_t col = 0; col < max_col; col++) {
-                if(config_.get<int>("cross_coupling") == 0) {
-                    col = static_cast<size_t>(std::floor(matrix_cols / 2));
-                    row = static_cast<size_t>(std::floor(matrix_rows / 2));
-                }
+        for(size_t element = 0; element < coupling_offsets_.size(); element++) {
+            auto x = xpixel + coupling_offsets_[element][0];
+            auto y = ypixel + coupling_offsets_[element][1];
 
-                // Ignore if out of pixel grid
-                if((xpixel + static_cast<int>(col - static_cast<size_t>(std::floor(matrix_cols / 2)))) < 0 ||
-                   (xpixel + static_cast<int>(col - static_cast<size_t>(std::floor(matrix_cols / 2)))) >=
-                       model_->getNPixels().x() ||
-                   (ypixel + static_cast<int>(row - static_cast<size_t>(std::floor(matrix_rows / 2)))) < 0 ||
-                   (ypixel + static_cast<int>(row - static_cast<size_t>(std::floor(matrix_rows / 2)))) >=
-                       model_->getNPixels().y()) {
-                    LOG(DEBUG) << "Skipping set of propagated charges at " << propagated_charge.getLocalPosition()
-                               << " because their nearest pixel (" << xpixel << "," << ypixel
-                               << ") is outside the pixel matrix";
-                    continue;
-                }
-
-                pixel_index =
-                    Pixel::Index(static_cast<unsigned int>(xpixel + static_cast<int>(col) - std::floor(matrix_cols / 2)),
-                                 static_cast<unsigned int>(ypixel + static_cast<int>(row) - std::floor(matrix_rows / 2)));
-
-                if(config_.has("coupling_scan_file")) {
-                    double local_x = pixel_index.x() * model_->getPixelSize().x();
-                    double local_y = pixel_index.y() * model_->getPixelSize().y();
-                    pixel_point = Eigen::Vector3d(local_x, local_y, 0);
-                    pixel_projection = plane.projection(pixel_point);
-                    pixel_gap = pixel_projection[2];
-
-                    ccpd_factor = capacitances[row * 3 + col]->Eval(
-                                      static_cast<double>(Units::convert(pixel_gap, "um")), nullptr, "S") *
-                                  normalization;
-                } else if(config_.has("coupling_file")) {
-                    ccpd_factor = relative_coupling[col][row];
-                } else if(config_.has("coupling_matrix")) {
-                    ccpd_factor = relative_coupling[max_row - row - 1][col];
-                } else {
-                    ccpd_factor = 1;
-                    LOG(ERROR) << "This shouldn't happen. Transferring 100% of detected charge";
-                }
-
-                // Update statistics
-                unique_pixels_.insert(pixel_index);
+            // Ignore if out of pixel grid
+            if(!geometry.isWithinPixelGrid(x, y)) {
+                LOG(DEBUG) << "Skipping set of propagated charges at " << propagated_charge.getLocalPosition()
+                           << " because their nearest pixel (" << xpixel << "," << ypixel
+                           << ") is outside the pixel matrix";
+                continue;
+            }
+            Pixel::Index pixel_index(static_cast<unsigned int>(x), static_cast<unsigned int>(y));
+
+            // Look up the coupling factor, stored per coupled pixel for capacitance scans
+            auto table_index = element;
+            if(pixel_dependent_coupling_) {
+                auto pixel_number =
+                    static_cast<size_t>(y) * static_cast<size_t>(geometry.number_of_pixels[0]) + static_cast<size_t>(x);
+                table_index += pixel_number * coupling_offsets_.size();
+            }
+            auto ccpd_factor = coupling_table_[table_index];
 
-                transferred_charges_count += static_cast<unsigned int>(propagated_charge.getCharge() * ccpd_factor);
-                neighbour_charge = propagated_charge.getCharge() * ccpd_factor;
+            // Update statistics
+            auto neighbour_charge = propagated_charge.getCharge() * ccpd_factor;
+            transferred_charges_count += static_cast<unsigned int>(neighbour_charge);
 
-                LOG(DEBUG) << "Set of " << propagated_charge.getCharge() * ccpd_factor << " charges brought to neighbour "
-                           << col << "," << row << " pixel " << pixel_index << "with cross-coupling of " << ccpd_factor * 100
-                           << "%";
+            LOG(DEBUG) << "Set of " << neighbour_charge << " charges brought to neighbour " << coupling_offsets_[element][0]
+                       << "," << coupling_offsets_[element][1] << " pixel " << pixel_index << "with cross-coupling of "
+                       << ccpd_factor * 100 << "%";
 
-                // Add the pixel the list of hit pixels
-                pixel_map[pixel_index].first += neighbour_charge;
-                pixel_map[pixel_index].second.emplace_back(&propagated_charge);
-            }
+            // Add the pixel the list of hit pixels
+            auto& pixel = pixel_map[pixel_index];
+            pixel.first += neighbour_charge;
+            pixel.second.emplace_back(&propagated_charge);
         }
     }
 
     // Create pixel charges
     LOG(TRACE) << "Combining charges at same pixel";
-    std::vector<PixelCharge> pixel_charges;
+    auto pixel_charges = MessageStorage<PixelCharge>::acquire();
     for(auto& pixel_index_charge : pixel_map) {
         double charge = pixel_index_charge.second.first;
 
@@ -365,15 +403,21 @@ void CapacitiveTransferModule::run(unsigned int) {
     // Writing summary and update statistics
     LOG(INFO) << "Transferred " << transferred_charges_count << " charges to " << pixel_map.size() << " pixels";
     total_transferred_charges_ += transferred_charges_count;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        for(auto& pixel_index_charge : pixel_map) {
+            unique_pixels_.insert(pixel_index_charge.first);
+        }
+    }
 
     // Dispatch message of pixel charges
     auto pixel_message = std::make_shared<PixelChargeMessage>(pixel_charges, detector_);
-    messenger_->dispatchMessage(this, pixel_message);
+    messenger_->dispatchMessage(this, pixel_message, event);
 }
 
 void CapacitiveTransferModule::finalize() {
     // Print statistics
-    LOG(INFO) << "Transferred total of " << total_transferred_charges_ << " charges to " << unique_pixels_.size()
+    LOG(INFO) << "Transferred total of " << total_transferred_charges_.load() << " charges to " << unique_pixels_.size()
               << " different pixels";
 
     if(config_.get<bool>("output_plots")) {
@@ -5,8 +5,12 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <array>
+#include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -56,8 +60,9 @@ namespace allpix {
 
         /**
          * @brief Transfer the propagated charges to the pixels and its neighbours
+         * @param event Pointer to the event to process
          */
-        void run(unsigned int) override;
+        void run(Event* event) override;
 
         /**
          * @brief Display statistical summary
@@ -70,12 +75,10 @@ namespace allpix {
         std::shared_ptr<Detector> detector_;
         std::shared_ptr<DetectorModel> model_;
 
-        // Message containing the propagated charges
-        std::shared_ptr<PropagatedChargeMessage> propagated_message_;
-
         // Statistical information
-        unsigned int total_transferred_charges_{};
+        std::atomic<unsigned int> total_transferred_charges_{};
         std::set<Pixel::Index> unique_pixels_;
+        std::mutex stats_mutex_;
 
         // Matrix to store cross-coupling values
         std::vector<std::vector<double>> relative_coupling;
@@ -91,9 +94,25 @@ namespace allpix {
 
         int cross_coupling;
 
+        // Configuration parameters used for every propagated charge
+        ConfigParameter<double> max_depth_distance_;
+        ConfigParameter<int> cross_coupling_;
+
         void getCapacitanceScan(TFile* root_file);
         TGraph* capacitances[9];
 
+        /**
+         * @brief Fill the table of coupling factors for all elements of the coupling matrix, and for every pixel of the
+         * detector when using a capacitance scan
+         */
+        void build_coupling_table();
+
+        // Offsets of the coupled pixels and their coupling factors, the factors are stored per pixel if they depend on the
+        // gap between sensor and chip
+        std::vector<std::array<int, 2>> coupling_offsets_;
+        std::vector<double> coupling_table_;
+        bool pixel_dependent_coupling_{false};
+
         Eigen::Hyperplane<double, 3> plane;
 
         double center[2] = {0.0, 0.0};
@@ -12,14 +12,35 @@
 #include <Math/RotationZYX.h>
 
 #include <fstream>
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "core/utils/file.h"
 #include "core/utils/log.h"
 
 using namespace allpix;
 
+namespace {
+    /**
+     * @brief Store an object in the next unused element of a pool, only allocating a new element if all are in use
+     * @param pool Pool of objects owned by the module
+     * @param write_list List of objects written in the current event, of which the size is the number of used elements
+     * @param object Object to store
+     */
+    template <typename T>
+    void store_in_pool(std::vector<std::unique_ptr<T>>& pool, std::vector<T*>& write_list, T&& object) {
+        auto index = write_list.size();
+        if(index < pool.size()) {
+            *pool[index] = std::move(object);
+        } else {
+            pool.push_back(std::make_unique<T>(std::move(object)));
+        }
+        write_list.push_back(pool[index].get());
+    }
+} // namespace
+
 CorryvreckanWriterModule::CorryvreckanWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geoManager)
     : Module(config), messenger_(messenger), geometryManager_(geoManager) {
 
@@ -60,6 +81,8 @@ void CorryvreckanWriterModule::init() {
     // Create trees:
     LOG(TRACE) << "Booking event tree";
     event_tree_ = std::make_unique<TTree>("Event", (std::string("Tree of Events").c_str()));
+    event_storage_ = std::make_unique<corryvreckan::Event>();
+    event_ = event_storage_.get();
     event_tree_->Bronch("global", "corryvreckan::Event", &event_);
 
     LOG(TRACE) << "Booking pixel tree";
@@ -70,6 +93,21 @@ void CorryvreckanWriterModule::init() {
         mcparticle_tree_ = std::make_unique<TTree>("MCParticle", (std::string("Tree of MCParticles").c_str()));
     }
 
+    // Create the branches of all detectors, such that every event writes the same branches
+    for(auto& detector : geometryManager_->getDetectors()) {
+        auto detector_name = detector->getName();
+        write_list_px_[detector_name] = new std::vector<corryvreckan::Pixel*>();
+        pixel_tree_->Bronch(
+            detector_name.c_str(), std::string("std::vector<corryvreckan::Pixel*>").c_str(), &write_list_px_[detector_name]);
+
+        if(output_mc_truth_) {
+            write_list_mcp_[detector_name] = new std::vector<corryvreckan::MCParticle*>();
+            mcparticle_tree_->Bronch(detector_name.c_str(),
+                                     std::string("std::vector<corryvreckan::MCParticle*>").c_str(),
+                                     &write_list_mcp_[detector_name]);
+        }
+    }
+
     // Initialise the time
     time_ = 0;
 }
@@ -79,63 +117,30 @@ void CorryvreckanWriterModule::run(unsigned int event) {
 
     LOG(TRACE) << "Processing event " << event;
 
-    // Create and store a new Event:
-    event_ = new corryvreckan::Event(time_, time_ + 5);
+    // Store the Event, reusing the object of the branch:
+    *event_ = corryvreckan::Event(time_, time_ + 5);
     LOG(DEBUG) << "Defining event for Corryvreckan: [" << Units::display(event_->start(), {"ns", "um"}) << ","
                << Units::display(event_->end(), {"ns", "um"}) << "]";
     event_tree_->Fill();
 
-    // Events start with 1, pre-filling only with empty events before:
-    event--;
-
     // Loop through all received messages
     for(auto& message : pixel_messages_) {
 
         auto detector_name = message->getDetector()->getName();
         LOG(DEBUG) << "Received " << message->getData().size() << " pixel hits from detector " << detector_name;
 
-        if(write_list_px_.find(detector_name) == write_list_px_.end()) {
-            write_list_px_[detector_name] = new std::vector<corryvreckan::Pixel*>();
-            pixel_tree_->Bronch(detector_name.c_str(),
-                                std::string("std::vector<corryvreckan::Pixel*>").c_str(),
-                                &write_list_px_[detector_name]);
-
-            if(event > 0) {
-                LOG(DEBUG) << "Pre-filling new branch " << detector_name << " of corryvreckan::Pixel with " << event
-                           << " empty events";
-                auto* branch = pixel_tree_->GetBranch(detector_name.c_str());
-                for(unsigned int i = 0; i < event; ++i) {
-                    branch->Fill();
-                }
-            }
-        }
-
-        if(output_mc_truth_ && write_list_mcp_.find(detector_name) == write_list_mcp_.end()) {
-            write_list_mcp_[detector_name] = new std::vector<corryvreckan::MCParticle*>();
-            mcparticle_tree_->Bronch(detector_name.c_str(),
-                                     std::string("std::vector<corryvreckan::MCParticle*>").c_str(),
-                                     &write_list_mcp_[detector_name]);
-
-            if(event > 0) {
-
-                LOG(DEBUG) << "Pre-filling new branch " << detector_name << " of corryvreckan::MCParticle with " << event
-                           << " empty events";
-                auto* branch = mcparticle_tree_->GetBranch(detector_name.c_str());
-                for(unsigned int i = 0; i < event; ++i) {
-                    branch->Fill();
-                }
-            }
-        }
-
         // Fill the branch vector
+        auto& write_list_px = *write_list_px_[detector_name];
+        auto& pixel_pool = pixel_pool_[detector_name];
         for(auto& apx_pixel : message->getData()) {
-            auto corry_pixel = new corryvreckan::Pixel(detector_name,
-                                                       static_cast<int>(apx_pixel.getPixel().getIndex().X()),
-                                                       static_cast<int>(apx_pixel.getPixel().getIndex().Y()),
-                                                       static_cast<int>(apx_pixel.getSignal()),
-                                                       apx_pixel.getSignal(),
-                                                       event_->start());
-            write_list_px_[detector_name]->push_back(corry_pixel);
+            store_in_pool(pixel_pool,
+                          write_list_px,
+                          corryvreckan::Pixel(detector_name,
+                                              static_cast<int>(apx_pixel.getPixel().getIndex().X()),
+                                              static_cast<int>(apx_pixel.getPixel().getIndex().Y()),
+                                              static_cast<int>(apx_pixel.getSignal()),
+                                              apx_pixel.getSignal(),
+                                              event_->start()));
 
             // If writing MC truth then also write out associated particle info
             if(!output_mc_truth_) {
@@ -146,12 +151,13 @@ void CorryvreckanWriterModule::run(unsigned int event) {
             auto mcp = apx_pixel.getMCParticles();
             LOG(DEBUG) << "Received " << mcp.size() << " Monte Carlo particles from pixel hit";
             for(auto& particle : mcp) {
-                auto mcParticle = new corryvreckan::MCParticle(detector_name,
-                                                               particle->getParticleID(),
-                                                               particle->getLocalStartPoint(),
-                                                               particle->getLocalEndPoint(),
-                                                               event_->start());
-                write_list_mcp_[detector_name]->push_back(mcParticle);
+                store_in_pool(mcparticle_pool_[detector_name],
+                              *write_list_mcp_[detector_name],
+                              corryvreckan::MCParticle(detector_name,
+                                                       particle->getParticleID(),
+                                                       particle->getLocalStartPoint(),
+                                                       particle->getLocalEndPoint(),
+                                                       event_->start()));
             }
         }
     }
@@ -164,19 +170,11 @@ void CorryvreckanWriterModule::run(unsigned int event) {
         mcparticle_tree_->Fill();
     }
 
-    // Clear the current write lists
+    // Clear the current write lists, the objects are kept in the pools for the next event
     for(auto& index_data : write_list_px_) {
-        for(auto& pixel : (*index_data.second)) {
-            delete pixel;
-        }
         index_data.second->clear();
     }
-
-    // Clear the current write lists
     for(auto& index_data : write_list_mcp_) {
-        for(auto& mcp : (*index_data.second)) {
-            delete mcp;
-        }
         index_data.second->clear();
     }
 
@@ -7,7 +7,10 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "core/config/Configuration.hpp"
 #include "core/geometry/GeometryManager.hpp"
@@ -75,11 +78,16 @@ namespace allpix {
         std::vector<std::string> dut_;
 
         std::unique_ptr<TTree> event_tree_;
+        std::unique_ptr<corryvreckan::Event> event_storage_;
         corryvreckan::Event* event_{};
 
         std::unique_ptr<TTree> pixel_tree_;
         std::unique_ptr<TTree> mcparticle_tree_;
         std::map<std::string, std::vector<corryvreckan::Pixel*>*> write_list_px_;
         std::map<std::string, std::vector<corryvreckan::MCParticle*>*> write_list_mcp_;
+
+        // Objects written in previous events, reused for the following events to avoid allocating them again
+        std::map<std::string, std::vector<std::unique_ptr<corryvreckan::Pixel>>> pixel_pool_;
+        std::map<std::string, std::vector<std::unique_ptr<corryvreckan::MCParticle>>> mcparticle_pool_;
     };
 } // namespace allpix
@@ -44,6 +44,7 @@ namespace corryvreckan {
         explicit Object(double timestamp);
         Object(std::string detectorID, double timestamp);
         Object(const Object&);
+        Object& operator=(const Object&);
 
         /**
          * @brief Required virtual destructor
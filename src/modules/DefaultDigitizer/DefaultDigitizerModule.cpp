@@ -12,6 +12,9 @@
 #include "core/utils/unit.h"
 #include "tools/ROOT.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include <TFile.h>
 #include <TH1D.h>
 #include <TProfile.h>
@@ -23,17 +26,12 @@ using namespace allpix;
 DefaultDigitizerModule::DefaultDigitizerModule(Configuration& config,
                                                Messenger* messenger,
                                                std::shared_ptr<Detector> detector)
-    : Module(config, std::move(detector)), messenger_(messenger), pixel_message_(nullptr) {
+    : Module(config, std::move(detector)), messenger_(messenger) {
     // Enable parallelization of this module if multithreading is enabled
     enable_parallelization();
 
-    // Require PixelCharge message for single detector
-    messenger_->bindSingle(this, &DefaultDigitizerModule::pixel_message_, MsgFlags::REQUIRED);
-
-    // Seed the random generator with the global seed
-    random_generator_.seed(getRandomSeed());
-
     // Set defaults for config variables
+    config_.setDefault<bool>("full_matrix", false);
     config_.setDefault<int>("electronics_noise", Units::get(110, "e"));
     config_.setDefault<double>("gain", 1.0);
     config_.setDefault<double>("gain_smearing", 0.0);
@@ -49,19 +47,56 @@ DefaultDigitizerModule::DefaultDigitizerModule(Configuration& config,
     config_.setDefault<bool>("output_plots", false);
     config_.setDefault<int>("output_plots_scale", Units::get(30, "ke"));
     config_.setDefault<int>("output_plots_bins", 100);
+
+    // Cache parameters used for every pixel
+    output_plots_ = config_.getParameter<bool>("output_plots");
+    electronics_noise_ = config_.getParameter<unsigned int>("electronics_noise");
+    gain_ = config_.getParameter<double>("gain");
+    gain_smearing_ = config_.getParameter<double>("gain_smearing");
+    threshold_ = config_.getParameter<unsigned int>("threshold");
+    threshold_smearing_ = config_.getParameter<unsigned int>("threshold_smearing");
+    adc_resolution_ = config_.getParameter<int>("adc_resolution");
+    adc_smearing_ = config_.getParameter<unsigned int>("adc_smearing");
+    adc_offset_ = config_.getParameter<double>("adc_offset");
+    adc_slope_ = config_.getParameter<double>("adc_slope");
+    allow_zero_adc_ = config_.getParameter<bool>("allow_zero_adc");
+    full_matrix_ = config_.getParameter<bool>("full_matrix");
+
+    // Require PixelCharge message for single detector, unless noise is simulated for all pixels of the matrix
+    messenger_->bindSingle<PixelChargeMessage>(this, (full_matrix_ ? MsgFlags::NONE : MsgFlags::REQUIRED));
 }
 
 void DefaultDigitizerModule::init() {
     // Conversion to ADC units requested:
-    if(config_.get<int>("adc_resolution") > 31) {
+    if(adc_resolution_ > 31) {
         throw InvalidValueError(config_, "adc_resolution", "precision higher than 31bit is not possible");
     }
-    if(config_.get<int>("adc_resolution") > 0) {
-        LOG(INFO) << "Converting charge to ADC units, ADC resolution: " << config_.get<int>("adc_resolution")
-                  << "bit, max. value " << ((1 << config_.get<int>("adc_resolution")) - 1);
+    if(adc_resolution_ > 0) {
+        LOG(INFO) << "Converting charge to ADC units, ADC resolution: " << adc_resolution_.get() << "bit, max. value "
+                  << ((1 << adc_resolution_) - 1);
     }
 
-    if(config_.get<bool>("output_plots")) {
+    // Probability of a pixel without charge to pass the threshold, and the parameters to sample the noise hits
+    if(full_matrix_) {
+        auto amplified_noise = gain_ * electronics_noise_;
+        auto width = std::hypot(amplified_noise, static_cast<double>(threshold_smearing_));
+        if(width > 0) {
+            noise_probability_ = std::erfc(threshold_ / width / std::sqrt(2.)) / 2;
+            noise_fraction_ = amplified_noise * amplified_noise / (width * width);
+            noise_conditional_width_ = amplified_noise * threshold_smearing_ / width;
+        } else {
+            noise_probability_ = (threshold_ > 0 ? 0 : 1);
+        }
+        noise_width_ = width;
+        LOG(INFO) << "Simulating noise hits for all pixels of the matrix, probability of a noise hit is "
+                  << noise_probability_;
+
+        if(gain_smearing_ > 0) {
+            LOG(WARNING) << "Gain smearing is not applied to noise hits of pixels without collected charge";
+        }
+    }
+
+    if(output_plots_) {
         LOG(TRACE) << "Creating output plots";
 
         // Plot axis are in kilo electrons - convert from framework units!
@@ -81,8 +116,8 @@ void DefaultDigitizerModule::init() {
             "pixelcharge_adc_smeared", "pixel charge after ADC smearing;pixel charge [ke];pixels", nbins, 0, maximum);
 
         // Create final pixel charge plot with different axis, depending on whether ADC simulation is enabled or not
-        if(config_.get<int>("adc_resolution") > 0) {
-            int adcbins = (1 << config_.get<int>("adc_resolution"));
+        if(adc_resolution_ > 0) {
+            int adcbins = (1 << adc_resolution_);
             h_pxq_adc = new TH1D("pixelcharge_adc", "pixel charge after ADC;pixel charge [ADC];pixels", adcbins, 0, adcbins);
             h_calibration = new TH2D("charge_adc_calibration",
                                      "calibration curve of pixel charge to ADC units;pixel charge [ke];pixel charge [ADC]",
@@ -98,48 +133,75 @@ void DefaultDigitizerModule::init() {
     }
 }
 
-void DefaultDigitizerModule::run(unsigned int) {
+void DefaultDigitizerModule::run(Event* event) {
+    auto pixel_message = messenger_->fetchMessage<PixelChargeMessage>(this, event);
+
+    // Digitize the pixels, buffering the values for the histograms to fill them at once
+    auto hits = MessageStorage<PixelHit>::acquire();
+    HistogramBuffer histograms;
+    if(full_matrix_) {
+        digitize_full_matrix(pixel_message.get(), event, hits, histograms);
+    } else {
+        digitize_pixels(*pixel_message, event, hits, histograms);
+    }
+    if(output_plots_) {
+        fill_histograms(histograms);
+    }
+
+    // Output summary and update statistics
+    LOG(INFO) << "Digitized " << hits.size() << " pixel hits";
+    total_hits_ += hits.size();
+
+    if(!hits.empty()) {
+        // Create and dispatch hit message
+        auto hits_message = std::make_shared<PixelHitMessage>(std::move(hits), getDetector());
+        messenger_->dispatchMessage(this, hits_message, event);
+    }
+}
+
+void DefaultDigitizerModule::digitize_pixels(const PixelChargeMessage& pixel_message,
+                                             Event* event,
+                                             std::vector<PixelHit>& hits,
+                                             HistogramBuffer& histograms) {
     // Loop through all pixels with charges
-    std::vector<PixelHit> hits;
-    for(auto& pixel_charge : pixel_message_->getData()) {
+    for(auto& pixel_charge : pixel_message.getData()) {
         auto pixel = pixel_charge.getPixel();
         auto pixel_index = pixel.getIndex();
         auto charge = static_cast<double>(pixel_charge.getCharge());
 
         LOG(DEBUG) << "Received pixel " << pixel_index << ", charge " << Units::display(charge, "e");
-        if(config_.get<bool>("output_plots")) {
-            h_pxq->Fill(charge / 1e3);
+        if(output_plots_) {
+            histograms.pxq.push_back(charge / 1e3);
         }
 
         // Add electronics noise from Gaussian:
-        std::normal_distribution<double> el_noise(0, config_.get<unsigned int>("electronics_noise"));
-        charge += el_noise(random_generator_);
+        std::normal_distribution<double> el_noise(0, electronics_noise_);
+        charge += el_noise(event->getRandomEngine());
 
         LOG(DEBUG) << "Charge with noise: " << Units::display(charge, "e");
-        if(config_.get<bool>("output_plots")) {
-            h_pxq_noise->Fill(charge / 1e3);
+        if(output_plots_) {
+            histograms.pxq_noise.push_back(charge / 1e3);
         }
 
         // Smear the gain factor, Gaussian distribution around "gain" with width "gain_smearing"
-        std::normal_distribution<double> gain_smearing(config_.get<double>("gain"), config_.get<double>("gain_smearing"));
-        double gain = gain_smearing(random_generator_);
-        if(config_.get<bool>("output_plots")) {
-            h_gain->Fill(gain);
+        std::normal_distribution<double> gain_smearing(gain_, gain_smearing_);
+        double gain = gain_smearing(event->getRandomEngine());
+        if(output_plots_) {
+            histograms.gain.push_back(gain);
         }
 
         // Apply the gain to the charge:
         charge *= gain;
         LOG(DEBUG) << "Charge after amplifier (gain): " << Units::display(charge, "e");
-        if(config_.get<bool>("output_plots")) {
-            h_pxq_gain->Fill(charge / 1e3);
+        if(output_plots_) {
+            histograms.pxq_gain.push_back(charge / 1e3);
         }
 
         // Smear the threshold, Gaussian distribution around "threshold" with width "threshold_smearing"
-        std::normal_distribution<double> thr_smearing(config_.get<unsigned int>("threshold"),
-                                                      config_.get<unsigned int>("threshold_smearing"));
-        double threshold = thr_smearing(random_generator_);
-        if(config_.get<bool>("output_plots")) {
-            h_thr->Fill(threshold / 1e3);
+        std::normal_distribution<double> thr_smearing(threshold_, threshold_smearing_);
+        double threshold = thr_smearing(event->getRandomEngine());
+        if(output_plots_) {
+            histograms.thr.push_back(threshold / 1e3);
         }
 
         // Discard charges below threshold:
@@ -150,58 +212,299 @@ void DefaultDigitizerModule::run(unsigned int) {
         }
 
         LOG(DEBUG) << "Passed threshold: " << Units::display(charge, "e") << " > " << Units::display(threshold, "e");
-        if(config_.get<bool>("output_plots")) {
-            h_pxq_thr->Fill(charge / 1e3);
+        if(output_plots_) {
+            histograms.pxq_thr.push_back(charge / 1e3);
         }
 
         // Simulate ADC if resolution set to more than 0bit
-        if(config_.get<int>("adc_resolution") > 0) {
+        if(adc_resolution_ > 0) {
             // temporarily store old charge for histogramming:
             auto original_charge = charge;
 
             // Add ADC smearing:
-            std::normal_distribution<double> adc_smearing(0, config_.get<unsigned int>("adc_smearing"));
-            charge += adc_smearing(random_generator_);
-            if(config_.get<bool>("output_plots")) {
-                h_pxq_adc_smear->Fill(charge / 1e3);
+            std::normal_distribution<double> adc_smearing(0, adc_smearing_);
+            charge += adc_smearing(event->getRandomEngine());
+            if(output_plots_) {
+                histograms.pxq_adc_smear.push_back(charge / 1e3);
             }
             LOG(DEBUG) << "Smeared for simulating limited ADC sensitivity: " << Units::display(charge, "e");
 
-            // Convert to ADC units and precision, make sure ADC count is at least 1:
-            charge = static_cast<double>(std::max(
-                std::min(static_cast<int>((config_.get<double>("adc_offset") + charge) / config_.get<double>("adc_slope")),
-                         (1 << config_.get<int>("adc_resolution")) - 1),
-                (config_.get<bool>("allow_zero_adc") ? 0 : 1)));
+            // Convert to ADC units and precision:
+            charge = convert_to_adc(charge);
             LOG(DEBUG) << "Charge converted to ADC units: " << charge;
 
-            if(config_.get<bool>("output_plots")) {
-                h_calibration->Fill(original_charge / 1e3, charge);
-                h_pxq_adc->Fill(charge);
+            if(output_plots_) {
+                histograms.calibration.push_back(original_charge / 1e3);
+                histograms.pxq_adc.push_back(charge);
             }
         } else {
             // Fill the final pixel charge
-            if(config_.get<bool>("output_plots")) {
-                h_pxq_adc->Fill(charge / 1e3);
+            if(output_plots_) {
+                histograms.pxq_adc.push_back(charge / 1e3);
             }
         }
 
         // Add the hit to the hitmap
         hits.emplace_back(pixel, 0, charge, &pixel_charge);
     }
+}
 
-    // Output summary and update statistics
-    LOG(INFO) << "Digitized " << hits.size() << " pixel hits";
-    total_hits_ += hits.size();
+/**
+ * The charges of the pixels with collected charge are stored in a contiguous array. All random numbers for these pixels
+ * are drawn in bulk from a single standard normal distribution before the noise, gain and threshold are applied in simple
+ * loops over the arrays. The noise hits of all other pixels are sampled afterwards with \ref sample_noise_hits.
+ */
+void DefaultDigitizerModule::digitize_full_matrix(const PixelChargeMessage* pixel_message,
+                                                  Event* event,
+                                                  std::vector<PixelHit>& hits,
+                                                  HistogramBuffer& histograms) {
+    // Collect the charges of all pixels with charge
+    std::vector<const PixelCharge*> pixel_charges;
+    if(pixel_message != nullptr) {
+        for(auto& pixel_charge : pixel_message->getData()) {
+            pixel_charges.push_back(&pixel_charge);
+        }
+    }
+    auto n_charged = pixel_charges.size();
+    std::vector<double> charges(n_charged);
+    for(size_t i = 0; i < n_charged; ++i) {
+        charges[i] = static_cast<double>(pixel_charges[i]->getCharge());
+    }
+    if(output_plots_) {
+        for(auto charge : charges) {
+            histograms.pxq.push_back(charge / 1e3);
+        }
+    }
 
-    if(!hits.empty()) {
-        // Create and dispatch hit message
-        auto hits_message = std::make_shared<PixelHitMessage>(std::move(hits), getDetector());
-        messenger_->dispatchMessage(this, hits_message);
+    // Draw the electronics noise, the gain and the threshold of all pixels with charge
+    std::normal_distribution<double> gauss(0, 1);
+    auto draw = [&](double mean, double width) {
+        std::vector<double> values(n_charged);
+        for(auto& value : values) {
+            value = gauss(event->getRandomEngine());
+        }
+        for(auto& value : values) {
+            value = mean + width * value;
+        }
+        return values;
+    };
+    auto noise = draw(0, electronics_noise_);
+    auto gains = draw(gain_, gain_smearing_);
+    auto thresholds = draw(threshold_, threshold_smearing_);
+
+    // Apply noise and gain
+    for(size_t i = 0; i < n_charged; ++i) {
+        charges[i] += noise[i];
+    }
+    if(output_plots_) {
+        for(auto charge : charges) {
+            histograms.pxq_noise.push_back(charge / 1e3);
+        }
+        histograms.gain = gains;
+    }
+    for(size_t i = 0; i < n_charged; ++i) {
+        charges[i] *= gains[i];
+    }
+    if(output_plots_) {
+        for(size_t i = 0; i < n_charged; ++i) {
+            histograms.pxq_gain.push_back(charges[i] / 1e3);
+            histograms.thr.push_back(thresholds[i] / 1e3);
+        }
+    }
+
+    // Select the pixels above threshold
+    std::vector<size_t> selected;
+    for(size_t i = 0; i < n_charged; ++i) {
+        if(charges[i] >= thresholds[i]) {
+            selected.push_back(i);
+        }
+    }
+    LOG(DEBUG) << selected.size() << " of " << n_charged << " pixels with charge passed the threshold";
+
+    std::vector<double> signals(selected.size());
+    for(size_t i = 0; i < selected.size(); ++i) {
+        signals[i] = charges[selected[i]];
+    }
+    apply_adc(signals, event, histograms);
+
+    // Add the hits to the hitmap
+    for(size_t i = 0; i < selected.size(); ++i) {
+        auto* pixel_charge = pixel_charges[selected[i]];
+        hits.emplace_back(pixel_charge->getPixel(), 0, signals[i], pixel_charge);
+    }
+
+    // Add the noise hits of all pixels without charge
+    sample_noise_hits(pixel_charges, event, hits, histograms);
+}
+
+/**
+ * A pixel without collected charge passes the threshold if the amplified noise is above the smeared threshold. The
+ * difference between both is normal distributed, such that every pixel passes with the same probability calculated in
+ * \ref init. The pixels above threshold are found by drawing the distance to the next pixel above threshold from a
+ * geometric distribution, and the pixels with collected charge are skipped. For every pixel above threshold, the difference
+ * is drawn from the tail of its distribution and the pixel charge is drawn from its conditional distribution.
+ */
+void DefaultDigitizerModule::sample_noise_hits(const std::vector<const PixelCharge*>& pixel_charges,
+                                               Event* event,
+                                               std::vector<PixelHit>& hits,
+                                               HistogramBuffer& histograms) {
+    if(noise_probability_ <= 0) {
+        return;
+    }
+
+    auto pixel_grid = getDetector()->getModel()->getNPixels();
+    auto n_columns = static_cast<size_t>(pixel_grid.x());
+    auto n_pixels = n_columns * static_cast<size_t>(pixel_grid.y());
+
+    // Sorted indices of the pixels with collected charge, which have been digitized already
+    std::vector<size_t> charged_pixels;
+    for(auto* pixel_charge : pixel_charges) {
+        auto pixel_index = pixel_charge->getPixel().getIndex();
+        charged_pixels.push_back(static_cast<size_t>(pixel_index.y()) * n_columns + static_cast<size_t>(pixel_index.x()));
+    }
+    std::sort(charged_pixels.begin(), charged_pixels.end());
+
+    // Skip the pixels below threshold, drawing the number of skipped pixels from a geometric distribution
+    std::uniform_real_distribution<double> uniform(0, 1);
+    auto log_complement = std::log1p(-noise_probability_);
+    auto skip = [&]() {
+        if(noise_probability_ >= 1) {
+            return 0.;
+        }
+        return std::floor(std::log1p(-uniform(event->getRandomEngine())) / log_complement);
+    };
+
+    std::vector<size_t> noisy_pixels;
+    auto charged_pixel = charged_pixels.begin();
+    for(auto index = skip(); index < static_cast<double>(n_pixels); index += 1 + skip()) {
+        auto pixel = static_cast<size_t>(index);
+        while(charged_pixel != charged_pixels.end() && *charged_pixel < pixel) {
+            ++charged_pixel;
+        }
+        if(charged_pixel == charged_pixels.end() || *charged_pixel != pixel) {
+            noisy_pixels.push_back(pixel);
+        }
+    }
+
+    // Draw the difference between charge and threshold above zero and the charge given this difference
+    std::normal_distribution<double> gauss(0, 1);
+    auto threshold = static_cast<double>(threshold_);
+    std::vector<double> signals(noisy_pixels.size());
+    for(auto& signal : signals) {
+        auto difference = -threshold + noise_width_ * sample_normal_tail(threshold / noise_width_, event);
+        signal = noise_fraction_ * (difference + threshold) + noise_conditional_width_ * gauss(event->getRandomEngine());
+    }
+    LOG(DEBUG) << signals.size() << " pixels without charge passed the threshold";
+
+    apply_adc(signals, event, histograms);
+
+    // Add the noise hits to the hitmap, they do not refer to a PixelCharge object
+    for(size_t i = 0; i < noisy_pixels.size(); ++i) {
+        auto x = static_cast<unsigned int>(noisy_pixels[i] % n_columns);
+        auto y = static_cast<unsigned int>(noisy_pixels[i] / n_columns);
+        hits.emplace_back(getDetector()->getPixel(x, y), 0, signals[i], nullptr);
+    }
+}
+
+/**
+ * Uses the rejection sampling with a shifted exponential distribution from C. P. Robert, "Simulation of truncated normal
+ * variables", Statistics and Computing 5 (1995) 121, which is efficient for all non-negative bounds. Without a width of
+ * the distribution, the bound itself is returned.
+ */
+double DefaultDigitizerModule::sample_normal_tail(double bound, Event* event) const {
+    if(!std::isfinite(bound)) {
+        return 0;
+    }
+
+    std::uniform_real_distribution<double> uniform(0, 1);
+    auto alpha = (bound + std::sqrt(bound * bound + 4)) / 2;
+    while(true) {
+        auto value = bound - std::log1p(-uniform(event->getRandomEngine())) / alpha;
+        if(uniform(event->getRandomEngine()) <= std::exp(-(value - alpha) * (value - alpha) / 2)) {
+            return value;
+        }
+    }
+}
+
+/**
+ * Applies the ADC smearing and conversion to all signals if the ADC is simulated and adds the values to the histograms
+ */
+void DefaultDigitizerModule::apply_adc(std::vector<double>& signals, Event* event, HistogramBuffer& histograms) {
+    if(output_plots_) {
+        for(auto signal : signals) {
+            histograms.pxq_thr.push_back(signal / 1e3);
+        }
+    }
+
+    // Simulate ADC if resolution set to more than 0bit
+    if(adc_resolution_ > 0) {
+        if(output_plots_) {
+            for(auto signal : signals) {
+                histograms.calibration.push_back(signal / 1e3);
+            }
+        }
+
+        std::normal_distribution<double> gauss(0, 1);
+        std::vector<double> adc_noise(signals.size());
+        for(auto& value : adc_noise) {
+            value = gauss(event->getRandomEngine());
+        }
+        for(size_t i = 0; i < signals.size(); ++i) {
+            signals[i] += adc_smearing_ * adc_noise[i];
+        }
+        if(output_plots_) {
+            for(auto signal : signals) {
+                histograms.pxq_adc_smear.push_back(signal / 1e3);
+            }
+        }
+        for(auto& signal : signals) {
+            signal = convert_to_adc(signal);
+        }
+        if(output_plots_) {
+            histograms.pxq_adc.insert(histograms.pxq_adc.end(), signals.begin(), signals.end());
+        }
+    } else if(output_plots_) {
+        for(auto signal : signals) {
+            histograms.pxq_adc.push_back(signal / 1e3);
+        }
+    }
+}
+
+/**
+ * The ADC value is at least one unless zero values are allowed
+ */
+double DefaultDigitizerModule::convert_to_adc(double charge) const {
+    return static_cast<double>(
+        std::max(std::min(static_cast<int>((adc_offset_ + charge) / adc_slope_), (1 << adc_resolution_) - 1),
+                 (allow_zero_adc_ ? 0 : 1)));
+}
+
+void DefaultDigitizerModule::fill_histograms(const HistogramBuffer& histograms) {
+    auto fill = [](TH1D* histogram, const std::vector<double>& values) {
+        if(!values.empty()) {
+            histogram->FillN(static_cast<Int_t>(values.size()), values.data(), nullptr);
+        }
+    };
+
+    std::lock_guard<std::mutex> lock(histogram_mutex_);
+    fill(h_pxq, histograms.pxq);
+    fill(h_pxq_noise, histograms.pxq_noise);
+    fill(h_gain, histograms.gain);
+    fill(h_pxq_gain, histograms.pxq_gain);
+    fill(h_thr, histograms.thr);
+    fill(h_pxq_thr, histograms.pxq_thr);
+    fill(h_pxq_adc_smear, histograms.pxq_adc_smear);
+    fill(h_pxq_adc, histograms.pxq_adc);
+    if(!histograms.calibration.empty()) {
+        h_calibration->FillN(static_cast<Int_t>(histograms.calibration.size()),
+                             histograms.calibration.data(),
+                             histograms.pxq_adc.data(),
+                             nullptr);
     }
 }
 
 void DefaultDigitizerModule::finalize() {
-    if(config_.get<bool>("output_plots")) {
+    if(output_plots_) {
         // Write histograms
         LOG(TRACE) << "Writing output plots to file";
         h_pxq->Write();
@@ -212,11 +515,11 @@ void DefaultDigitizerModule::finalize() {
         h_pxq_thr->Write();
         h_pxq_adc->Write();
 
-        if(config_.get<int>("adc_resolution") > 0) {
+        if(adc_resolution_ > 0) {
             h_pxq_adc_smear->Write();
             h_calibration->Write();
         }
     }
 
-    LOG(INFO) << "Digitized " << total_hits_ << " pixel hits in total";
+    LOG(INFO) << "Digitized " << total_hits_.load() << " pixel hits in total";
 }
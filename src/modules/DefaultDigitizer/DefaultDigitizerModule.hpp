@@ -10,15 +10,19 @@
 #ifndef ALLPIX_DEFAULT_DIGITIZER_MODULE_H
 #define ALLPIX_DEFAULT_DIGITIZER_MODULE_H
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <random>
 #include <string>
+#include <vector>
 
 #include "core/config/Configuration.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "core/module/Module.hpp"
 
 #include "objects/PixelCharge.hpp"
+#include "objects/PixelHit.hpp"
 
 #include <TH1D.h>
 #include <TH2D.h>
@@ -50,8 +54,9 @@ namespace allpix {
 
         /**
          * @brief Simulate digitization process
+         * @param event Pointer to the event to process
          */
-        void run(unsigned int) override;
+        void run(Event* event) override;
 
         /**
          * @brief Finalize and write optional histograms
@@ -59,17 +64,97 @@ namespace allpix {
         void finalize() override;
 
     private:
-        std::mt19937_64 random_generator_;
+        /**
+         * @brief Values of one event to be filled into the output histograms
+         */
+        struct HistogramBuffer {
+            std::vector<double> pxq, pxq_noise, gain, pxq_gain, thr, pxq_thr, pxq_adc_smear, pxq_adc, calibration;
+        };
+
+        /**
+         * @brief Digitize the pixel charges one by one
+         * @param pixel_message Message with the pixel charges
+         * @param event Pointer to the event to process
+         * @param hits List the pixel hits are added to
+         * @param histograms Buffer of the values to fill into the histograms
+         */
+        void digitize_pixels(const PixelChargeMessage& pixel_message,
+                             Event* event,
+                             std::vector<PixelHit>& hits,
+                             HistogramBuffer& histograms);
+
+        /**
+         * @brief Digitize all pixels of the matrix, drawing the random numbers for all pixels with charge at once
+         * @param pixel_message Message with the pixel charges, can be a null pointer if no charge has been collected
+         * @param event Pointer to the event to process
+         * @param hits List the pixel hits are added to
+         * @param histograms Buffer of the values to fill into the histograms
+         */
+        void digitize_full_matrix(const PixelChargeMessage* pixel_message,
+                                  Event* event,
+                                  std::vector<PixelHit>& hits,
+                                  HistogramBuffer& histograms);
+
+        /**
+         * @brief Sample the noise hits above threshold of all pixels without collected charge
+         * @param pixel_charges Pixels with collected charge, which are not considered
+         * @param event Pointer to the event to process
+         * @param hits List the noise hits are added to
+         * @param histograms Buffer of the values to fill into the histograms
+         *
+         * The cost is proportional to the number of noise hits and not to the number of pixels of the matrix.
+         */
+        void sample_noise_hits(const std::vector<const PixelCharge*>& pixel_charges,
+                               Event* event,
+                               std::vector<PixelHit>& hits,
+                               HistogramBuffer& histograms);
+
+        /**
+         * @brief Draw a value from the tail of the standard normal distribution above a bound
+         * @param bound Lower bound of the values, should not be negative
+         * @param event Pointer to the event providing the random engine
+         * @return Value above the bound
+         */
+        double sample_normal_tail(double bound, Event* event) const;
+
+        /**
+         * @brief Simulate the ADC for a list of signals above threshold
+         * @param signals Signals to convert, replaced by the ADC values if the ADC is simulated
+         * @param event Pointer to the event to process
+         * @param histograms Buffer of the values to fill into the histograms
+         */
+        void apply_adc(std::vector<double>& signals, Event* event, HistogramBuffer& histograms);
+
+        /**
+         * @brief Convert a charge to ADC units
+         * @param charge Charge after ADC smearing
+         * @return Value in ADC units, clamped to the range of the ADC
+         */
+        double convert_to_adc(double charge) const;
+
+        /**
+         * @brief Fill the values of one event into the output histograms
+         * @param histograms Buffer of the values to fill
+         */
+        void fill_histograms(const HistogramBuffer& histograms);
 
         Messenger* messenger_;
 
-        // Input message with the charges on the pixels
-        std::shared_ptr<PixelChargeMessage> pixel_message_;
+        // Configuration parameters used for every pixel
+        ConfigParameter<bool> output_plots_, allow_zero_adc_, full_matrix_;
+        ConfigParameter<unsigned int> electronics_noise_, threshold_, threshold_smearing_, adc_smearing_;
+        ConfigParameter<double> gain_, gain_smearing_, adc_offset_, adc_slope_;
+        ConfigParameter<int> adc_resolution_;
+
+        // Probability of a noise hit in a pixel without charge, width of the difference between noise and threshold, and
+        // the fraction and width of the noise given this difference
+        double noise_probability_{}, noise_width_{}, noise_fraction_{}, noise_conditional_width_{};
 
         // Statistics
-        unsigned long long total_hits_{};
+        std::atomic<unsigned long long> total_hits_{};
 
         // Output histograms
+        std::mutex histogram_mutex_;
         TH1D *h_pxq{}, *h_pxq_noise{}, *h_gain{}, *h_pxq_gain{}, *h_thr{}, *h_pxq_thr{}, *h_pxq_adc_smear{}, *h_pxq_adc{};
         TH2D* h_calibration{};
     };
@@ -10,19 +10,35 @@
 
 #include "DepositionGeant4Module.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
 #include <limits>
+#include <sstream>
 #include <string>
 #include <utility>
 
+#include <unistd.h>
+
 #include <G4EmParameters.hh>
 #include <G4HadronicProcessStore.hh>
 #include <G4LogicalVolume.hh>
+#include <G4MTRunManager.hh>
+#include <G4Material.hh>
 #include <G4PhysListFactory.hh>
+#include <G4ProductionCuts.hh>
+#include <G4Region.hh>
+#include <G4RegionStore.hh>
 #include <G4RadioactiveDecayPhysics.hh>
 #include <G4RunManager.hh>
 #include <G4StepLimiterPhysics.hh>
 #include <G4UImanager.hh>
 #include <G4UserLimits.hh>
+#include <G4Version.hh>
+#include <Randomize.hh>
 
 #include "G4FieldManager.hh"
 #include "G4TransportationManager.hh"
@@ -31,14 +47,18 @@
 #include "core/config/exceptions.h"
 #include "core/geometry/GeometryManager.hpp"
 #include "core/module/exceptions.h"
+#include "core/utils/annotation.h"
+#include "core/utils/file.h"
 #include "core/utils/log.h"
 #include "objects/DepositedCharge.hpp"
 #include "tools/ROOT.h"
 #include "tools/geant4.h"
 
 #include "GeneratorActionG4.hpp"
+#include "MagneticFieldG4.hpp"
 #include "SensitiveDetectorActionG4.hpp"
 #include "SetTrackInfoUserHookG4.hpp"
+#include "WorkerRunManagerG4.hpp"
 
 #define G4_NUM_SEEDS 10
 
@@ -48,7 +68,7 @@ using namespace allpix;
  * Includes the particle source point to the geometry using \ref GeometryManager::addPoint.
  */
 DepositionGeant4Module::DepositionGeant4Module(Configuration& config, Messenger* messenger, GeometryManager* geo_manager)
-    : Module(config), messenger_(messenger), geo_manager_(geo_manager), last_event_num_(1), run_manager_g4_(nullptr) {
+    : Module(config), messenger_(messenger), geo_manager_(geo_manager), run_manager_g4_(nullptr) {
     // Create user limits for maximum step length in the sensor
     user_limits_ = std::make_unique<G4UserLimits>(config_.get<double>("max_step_length", Units::get(1.0, "um")));
 
@@ -85,6 +105,18 @@ DepositionGeant4Module::DepositionGeant4Module(Configuration& config, Messenger*
 
     // Add the particle source position to the geometry
     geo_manager_->addPoint(config_.get<ROOT::Math::XYZPoint>("source_position", ROOT::Math::XYZPoint()));
+
+    // Deposit the events in parallel if the framework runs multithreaded
+#ifdef G4MULTITHREADED
+    multithreading_ = config_.get<bool>("_multithreading", false);
+    if(multithreading_) {
+        enable_parallelization();
+    }
+#else
+    if(config_.get<bool>("_multithreading", false)) {
+        LOG(WARNING) << "Geant4 has been built without multithreading support, charges are deposited sequentially";
+    }
+#endif
 }
 
 /**
@@ -96,6 +128,9 @@ void DepositionGeant4Module::init() {
     if(run_manager_g4_ == nullptr) {
         throw ModuleError("Cannot deposit charges using Geant4 without a Geant4 geometry builder");
     }
+    if(multithreading_ && dynamic_cast<G4MTRunManager*>(run_manager_g4_) == nullptr) {
+        throw ModuleError("Cannot deposit charges in parallel without the multithreaded Geant4 run manager");
+    }
 
     // Suppress all output from G4
     SUPPRESS_STREAM(G4cout);
@@ -114,9 +149,12 @@ void DepositionGeant4Module::init() {
             if(logical_volume == nullptr) {
                 throw ModuleError("Detector " + detector->getName() + " has no sensitive device (broken Geant4 geometry)");
             }
-            // Create region
-            G4Region* region = new G4Region(detector->getName() + "_sensor_region");
-            region->AddRootLogicalVolume(logical_volume.get());
+            // Use the sensor region defined by the geometry builder, or create it if not available
+            auto region = detector->getExternalObject<G4Region>("sensor_region");
+            if(region == nullptr) {
+                region = std::shared_ptr<G4Region>(new G4Region(detector->getName() + "_sensor_region"), [](G4Region*) {});
+                region->AddRootLogicalVolume(logical_volume.get());
+            }
 
             auto pai_model = config_.get<std::string>("pai_model", "pai");
             auto lcase_model = pai_model;
@@ -191,6 +229,55 @@ void DepositionGeant4Module::init() {
     }
     ui_g4->ApplyCommand("/run/setCut " + std::to_string(production_cut));
 
+    // Set dedicated production cuts in the sensors and the passive material of the detectors, taking the value from the
+    // detector model if defined there and from the module configuration otherwise
+    auto set_region_cut = [&](const std::shared_ptr<Detector>& detector, const std::string& region_name) {
+        auto key = region_name + "_range_cut";
+        auto model_configs = detector->getModel()->getConfigurations();
+        double region_cut = 0;
+        if(!model_configs.empty() && model_configs.front().has(key)) {
+            region_cut = model_configs.front().get<double>(key);
+        } else if(config_.has(key)) {
+            region_cut = config_.get<double>(key);
+        } else {
+            return;
+        }
+
+        auto region = detector->getExternalObject<G4Region>(region_name + "_region");
+        if(region == nullptr) {
+            throw ModuleError("Detector " + detector->getName() + " has no " + region_name +
+                              " region (broken Geant4 geometry)");
+        }
+        auto* cuts = new G4ProductionCuts();
+        cuts->SetProductionCut(region_cut);
+        region->SetProductionCuts(cuts);
+        LOG(DEBUG) << "Setting G4 production cut in " << region_name << " region of detector \"" << detector->getName()
+                   << "\" to " << Units::display(region_cut, {"mm", "um"});
+    };
+    for(auto& detector : geo_manager_->getDetectors()) {
+        set_region_cut(detector, "sensor");
+        set_region_cut(detector, "passive");
+    }
+
+    // Retrieve the physics tables from the cache if they have been stored for the same physics list, cuts and materials
+    if(config_.has("physics_table_cache")) {
+        physics_table_description_ = describe_physics_tables(production_cut);
+        std::stringstream key;
+        key << std::hex << std::setw(16) << std::setfill('0') << std::hash<std::string>()(physics_table_description_);
+        physics_table_directory_ = config_.getPath("physics_table_cache") + "/" + key.str();
+
+        std::ifstream description_file(physics_table_directory_ + "/description.txt");
+        std::string stored_description((std::istreambuf_iterator<char>(description_file)), std::istreambuf_iterator<char>());
+        if(path_is_directory(physics_table_directory_) && stored_description == physics_table_description_) {
+            LOG(INFO) << "Retrieving G4 physics tables from cache " << physics_table_directory_;
+            ui_g4->ApplyCommand("/run/particle/retrievePhysicsTable " + physics_table_directory_);
+        } else {
+            LOG(INFO) << "G4 physics tables not found in cache, storing them in " << physics_table_directory_
+                      << " after the first event";
+            store_physics_tables_ = true;
+        }
+    }
+
     // Initialize the physics list
     LOG(TRACE) << "Initializing physics processes";
     run_manager_g4_->SetUserInitialization(physicsList);
@@ -199,37 +286,44 @@ void DepositionGeant4Module::init() {
     // Initialize the full run manager to ensure correct state flags
     run_manager_g4_->Initialize();
 
-    // Build particle generator
-    LOG(TRACE) << "Constructing particle source";
-    auto generator = new GeneratorActionG4(config_);
-    run_manager_g4_->SetUserAction(generator);
-
-    track_info_manager_ = std::make_unique<TrackInfoManager>();
-
-    // Default value chosen to ensure proper gamma generation for Cs137 decay
-    auto decay_cutoff_time = config_.get<double>("decay_cutoff_time", 2.21e+11);
-
-    // User hook to store additional information at track initialization and termination as well as custom track ids
-    auto userTrackIDHook = new SetTrackInfoUserHookG4(track_info_manager_.get(), decay_cutoff_time);
-    run_manager_g4_->SetUserAction(userTrackIDHook);
+    number_of_particles_ = config_.get<unsigned int>("number_of_particles", 1);
+
+    // Selection of the tracks stored as MCTrack objects
+    auto truth_depth = config_.get<std::string>("mc_truth_depth", "sensor");
+    std::transform(truth_depth.begin(), truth_depth.end(), truth_depth.begin(), ::tolower);
+    if(truth_depth == "sensor") {
+        truth_depth_ = TrackInfoManager::TruthDepth::SENSOR;
+    } else if(truth_depth == "primary") {
+        truth_depth_ = TrackInfoManager::TruthDepth::PRIMARY;
+    } else if(truth_depth == "none") {
+        truth_depth_ = TrackInfoManager::TruthDepth::NONE;
+    } else {
+        throw InvalidValueError(
+            config_, "mc_truth_depth", "Invalid truth depth, only 'sensor', 'primary' and 'none' are supported.");
+    }
 
-    if(geo_manager_->hasMagneticField()) {
-        MagneticFieldType magnetic_field_type_ = geo_manager_->getMagneticFieldType();
+    // Process all events in a single Geant4 run instead of starting a new run for every event
+    persistent_run_ = config_.get<bool>("persistent_run", false);
 
-        if(magnetic_field_type_ == MagneticFieldType::CONSTANT) {
-            ROOT::Math::XYZVector b_field = geo_manager_->getMagneticField(ROOT::Math::XYZPoint(0., 0., 0.));
-            G4MagneticField* magField = new G4UniformMagField(G4ThreeVector(b_field.x(), b_field.y(), b_field.z()));
-            G4FieldManager* globalFieldMgr = G4TransportationManager::GetTransportationManager()->GetFieldManager();
-            globalFieldMgr->SetDetectorField(magField);
-            globalFieldMgr->CreateChordFinder(magField);
-        } else {
-            throw ModuleError("Magnetic field enabled, but not constant. This can't be handled by this module yet.");
-        }
+    // Reseed the Geant4 engine in every event from the event number, such that every event can be reproduced on its own
+    reseed_every_event_ = config_.get<bool>("reseed_every_event", false);
+    if(reseed_every_event_) {
+        LOG(DEBUG) << "Reseeding the Geant4 random engine in every event from the seed of the event";
     }
 
+    // Default value chosen to ensure proper gamma generation for Cs137 decay
+    decay_cutoff_time_ = config_.get<double>("decay_cutoff_time", 2.21e+11);
+
     // Get the creation energy for charge (default is silicon electron hole pair energy)
-    auto charge_creation_energy = config_.get<double>("charge_creation_energy", Units::get(3.64, "eV"));
-    auto fano_factor = config_.get<double>("fano_factor", 0.115);
+    charge_creation_energy_ = config_.get<double>("charge_creation_energy", Units::get(3.64, "eV"));
+    fano_factor_ = config_.get<double>("fano_factor", 0.115);
+
+    // Merging of consecutive steps of a track into a single deposit, disabled by default
+    merge_deposits_distance_ = config_.get<double>("merge_deposits_distance", 0);
+    merge_deposits_time_ = config_.get<double>("merge_deposits_time", std::numeric_limits<double>::max());
+    if(merge_deposits_distance_ < 0) {
+        throw InvalidValueError(config_, "merge_deposits_distance", "merging distance cannot be negative");
+    }
 
     // Prepare seeds for Geant4:
     // NOTE Assumes this is the only Geant4 module using random numbers
@@ -241,8 +335,7 @@ void DepositionGeant4Module::init() {
         }
     }
 
-    // Loop through all detectors and set the sensitive detector action that handles the particle passage
-    bool useful_deposition = false;
+    // Loop through all detectors to find the ones handling the particle passage
     for(auto& detector : geo_manager_->getDetectors()) {
         // Do not add sensitive detector for detectors that have no listeners for the deposited charges
         // FIXME Probably the MCParticle has to be checked as well
@@ -252,11 +345,7 @@ void DepositionGeant4Module::init() {
                       << " because there is no listener for its output";
             continue;
         }
-        useful_deposition = true;
 
-        // Get model of the sensitive device
-        auto sensitive_detector_action = new SensitiveDetectorActionG4(
-            this, detector, messenger_, track_info_manager_.get(), charge_creation_energy, fano_factor, getRandomSeed());
         auto logical_volume = detector->getExternalObject<G4LogicalVolume>("sensor_log");
         if(logical_volume == nullptr) {
             throw ModuleError("Detector " + detector->getName() + " has no sensitive device (broken Geant4 geometry)");
@@ -264,10 +353,7 @@ void DepositionGeant4Module::init() {
 
         // Apply the user limits to this element
         logical_volume->SetUserLimits(user_limits_.get());
-
-        // Add the sensitive detector action
-        logical_volume->SetSensitiveDetector(sensitive_detector_action);
-        sensors_.push_back(sensitive_detector_action);
+        deposition_detectors_.push_back(detector);
 
         // If requested, prepare output plots
         if(config_.get<bool>("output_plots")) {
@@ -278,11 +364,20 @@ void DepositionGeant4Module::init() {
             int nbins = 5 * maximum;
 
             // Create histograms if needed
-            std::string plot_name = "deposited_charge_" + sensitive_detector_action->getName();
-            charge_per_event_[sensitive_detector_action->getName()] =
+            std::string plot_name = "deposited_charge_" + detector->getName();
+            charge_per_event_[detector->getName()] =
                 new TH1D(plot_name.c_str(), "deposited charge per event;deposited charge [ke];events", nbins, 0, maximum);
         }
     }
+    bool useful_deposition = !deposition_detectors_.empty();
+
+    if(multithreading_) {
+        // The worker run managers are created by the framework threads when they deposit their first event
+        LOG(INFO) << "Depositing charges with one Geant4 worker run manager per framework thread";
+        next_thread_id_ = dynamic_cast<G4MTRunManager*>(run_manager_g4_)->GetNumberOfThreads();
+    } else {
+        thread_states_[std::thread::id()] = create_thread_state(run_manager_g4_);
+    }
 
     if(!useful_deposition) {
         LOG(ERROR) << "Not a single listener for deposited charges, module is useless!";
@@ -301,42 +396,272 @@ void DepositionGeant4Module::init() {
     RELEASE_STREAM(G4cout);
 }
 
-void DepositionGeant4Module::run(unsigned int event_num) {
+/**
+ * The particle source, the user hooks and the magnetic field are thread-local objects in Geant4, as are the sensitive
+ * detectors assigned to the logical volumes, so all of them have to be created on the thread processing the events.
+ */
+std::unique_ptr<DepositionGeant4Module::ThreadState> DepositionGeant4Module::create_thread_state(G4RunManager* run_manager) {
+    auto state = std::make_unique<ThreadState>();
+    state->run_manager = run_manager;
+
+    // Build particle generator
+    LOG(TRACE) << "Constructing particle source";
+    auto generator = new GeneratorActionG4(config_);
+    run_manager->SetUserAction(generator);
+
+    state->track_info_manager = std::make_unique<TrackInfoManager>(truth_depth_);
+
+    // User hook to store additional information at track initialization and termination as well as custom track ids
+    auto userTrackIDHook = new SetTrackInfoUserHookG4(state->track_info_manager.get(), decay_cutoff_time_);
+    run_manager->SetUserAction(userTrackIDHook);
+
+    if(geo_manager_->hasMagneticField()) {
+        MagneticFieldType magnetic_field_type_ = geo_manager_->getMagneticFieldType();
+
+        if(magnetic_field_type_ == MagneticFieldType::CONSTANT) {
+            ROOT::Math::XYZVector b_field = geo_manager_->getMagneticField(ROOT::Math::XYZPoint(0., 0., 0.));
+            G4MagneticField* magField = new G4UniformMagField(G4ThreeVector(b_field.x(), b_field.y(), b_field.z()));
+            G4FieldManager* globalFieldMgr = G4TransportationManager::GetTransportationManager()->GetFieldManager();
+            globalFieldMgr->SetDetectorField(magField);
+            globalFieldMgr->CreateChordFinder(magField);
+        } else if(magnetic_field_type_ == MagneticFieldType::GRID) {
+            // The field grid is defined in global coordinates and can be evaluated directly during the stepping
+            auto function = [geo_manager = geo_manager_](const ROOT::Math::XYZPoint& pos) {
+                return geo_manager->getMagneticField(pos);
+            };
+            G4MagneticField* magField = new MagneticFieldG4(function);
+            G4FieldManager* globalFieldMgr = G4TransportationManager::GetTransportationManager()->GetFieldManager();
+            globalFieldMgr->SetDetectorField(magField);
+            globalFieldMgr->CreateChordFinder(magField);
+        } else {
+            throw ModuleError("Magnetic field enabled, but not constant. This can't be handled by this module yet.");
+        }
+    }
+
+    // Set the sensitive detector action that handles the particle passage
+    for(auto& detector : deposition_detectors_) {
+        auto sensitive_detector_action = new SensitiveDetectorActionG4(this,
+                                                                       detector,
+                                                                       messenger_,
+                                                                       state->track_info_manager.get(),
+                                                                       charge_creation_energy_,
+                                                                       fano_factor_,
+                                                                       getRandomSeed(),
+                                                                       merge_deposits_distance_,
+                                                                       merge_deposits_time_);
+        auto logical_volume = detector->getExternalObject<G4LogicalVolume>("sensor_log");
+        logical_volume->SetSensitiveDetector(sensitive_detector_action);
+        state->sensors.push_back(sensitive_detector_action);
+    }
+
+    return state;
+}
+
+DepositionGeant4Module::ThreadState* DepositionGeant4Module::get_thread_state() {
+    std::lock_guard<std::mutex> lock(thread_states_mutex_);
+    if(!multithreading_) {
+        return thread_states_[std::thread::id()].get();
+    }
+
+    auto& state = thread_states_[std::this_thread::get_id()];
+#ifdef G4MULTITHREADED
+    if(state == nullptr) {
+        // NOTE The worker run manager is never deleted, as it has to be destroyed on the thread it belongs to
+        LOG(DEBUG) << "Creating Geant4 worker run manager with thread identifier " << next_thread_id_;
+        state = create_thread_state(WorkerRunManagerG4::createForThread(next_thread_id_++));
+    }
+#endif
+    return state.get();
+}
+
+/**
+ * In multithreaded mode the Geant4 random engine of the thread and the Fano fluctuations are reseeded from the random
+ * engine of the event, such that the result does not depend on the thread the event is processed on. If reseeding in every
+ * event is requested, the seeds are instead drawn from the random stream of this module for the event, which only depends
+ * on the global seed and the event number. The result of an event then neither depends on the previous events nor on the
+ * random numbers drawn by other modules in the same event.
+ */
+void DepositionGeant4Module::run(Event* event) {
+    auto* state = get_thread_state();
+
+    auto reseed = [&](auto& random_engine) {
+        // Seeds for the Geant4 engine have to be non-zero, the list is terminated by a zero
+        std::array<long, G4_NUM_SEEDS + 1> seeds{};
+        for(size_t i = 0; i < G4_NUM_SEEDS; ++i) {
+            seeds[i] = static_cast<long>(random_engine() % (INT_MAX - 1) + 1);
+        }
+        G4Random::setTheSeeds(seeds.data());
+        for(auto& sensor : state->sensors) {
+            sensor->setRandomSeed(random_engine());
+        }
+    };
+    if(reseed_every_event_) {
+        auto random_stream = getRandomStream(event, 0);
+        reseed(random_stream);
+    } else if(multithreading_) {
+        reseed(event->getRandomEngine());
+    }
+
     // Suppress output stream if not in debugging mode
     IFLOG(DEBUG);
     else {
         SUPPRESS_STREAM(G4cout);
     }
 
-    // Start a single event from the beam
-    LOG(TRACE) << "Enabling beam";
-    run_manager_g4_->BeamOn(static_cast<int>(config_.get<unsigned int>("number_of_particles", 1)));
-    last_event_num_ = event_num;
+    if(persistent_run_) {
+        // Process the particles of this event as the next events of the open run
+        if(!state->run_started) {
+            start_persistent_run(state);
+        }
+        LOG(TRACE) << "Processing " << number_of_particles_ << " Geant4 event(s) in the persistent run";
+        PROFILER_EVENT_RANGE("DepositionGeant4::ProcessOneEvent", event->getNumber());
+        for(unsigned int i = 0; i < number_of_particles_; ++i) {
+            state->run_manager->ProcessOneEvent(state->next_event_id++);
+            state->run_manager->TerminateOneEvent();
+        }
+    } else {
+        // Start a single event from the beam
+        LOG(TRACE) << "Enabling beam";
+        PROFILER_EVENT_RANGE("DepositionGeant4::BeamOn", event->getNumber());
+        state->run_manager->BeamOn(static_cast<int>(number_of_particles_));
+    }
+    ++number_of_events_;
+
+    // The physics tables have been built by processing the event and can be added to the cache
+    if(store_physics_tables_) {
+        std::call_once(physics_tables_stored_, [&]() { store_physics_tables(state->run_manager); });
+    }
 
     // Release the stream (if it was suspended)
     RELEASE_STREAM(G4cout);
 
-    track_info_manager_->createMCTracks();
+    state->track_info_manager->createMCTracks();
 
     // Dispatch the necessary messages
-    for(auto& sensor : sensors_) {
-        sensor->dispatchMessages();
+    for(auto& sensor : state->sensors) {
+        sensor->dispatchMessages(event);
 
         // Fill output plots if requested:
         if(config_.get<bool>("output_plots")) {
-            double charge = static_cast<double>(Units::convert(sensor->getDepositedCharge(), "ke"));
+            double charge = sensor->getDepositedCharge() / units::ke;
+            std::lock_guard<std::mutex> lock(histogram_mutex_);
             charge_per_event_[sensor->getName()]->Fill(charge);
         }
     }
 
-    track_info_manager_->dispatchMessage(this, messenger_);
-    track_info_manager_->resetTrackInfoManager();
+    state->track_info_manager->dispatchMessage(this, messenger_, event);
+    state->track_info_manager->resetTrackInfoManager();
+}
+
+/**
+ * Performs the steps of G4RunManager::BeamOn up to the event loop, such that the run initialization and the checks of the
+ * physics tables are only done once per thread instead of for every event.
+ */
+void DepositionGeant4Module::start_persistent_run(ThreadState* state) {
+    auto* run_manager = state->run_manager;
+    if(!run_manager->ConfirmBeamOnCondition()) {
+        throw ModuleError("Geant4 run manager is not ready to start a run");
+    }
+
+    LOG(DEBUG) << "Starting persistent Geant4 run on thread " << std::this_thread::get_id();
+    auto events = std::numeric_limits<G4int>::max();
+    run_manager->SetNumberOfEventsToBeProcessed(events);
+    run_manager->ConstructScoringWorlds();
+    run_manager->RunInitialization();
+    run_manager->InitializeEventLoop(events);
+
+    state->run_started = true;
+    state->run_thread = std::this_thread::get_id();
+}
+
+/**
+ * The description contains the Geant4 version, the physics list with the optional PAI model, the production cuts of all
+ * regions and the properties of all materials, which together determine the content of the physics tables.
+ */
+std::string DepositionGeant4Module::describe_physics_tables(double production_cut) const {
+    std::stringstream description;
+    description << std::setprecision(std::numeric_limits<double>::max_digits10);
+    description << "geant4 " << G4VERSION_NUMBER << "\n";
+    description << "physics_list " << config_.get<std::string>("physics_list") << "\n";
+    if(config_.get<bool>("enable_pai", false)) {
+        description << "pai_model " << config_.get<std::string>("pai_model", "pai") << "\n";
+    }
+    description << "range_cut " << production_cut << "\n";
+
+    for(auto* region : *G4RegionStore::GetInstance()) {
+        auto* cuts = region->GetProductionCuts();
+        if(cuts == nullptr) {
+            continue;
+        }
+        description << "region " << region->GetName();
+        for(auto& cut : cuts->GetProductionCuts()) {
+            description << " " << cut;
+        }
+        description << "\n";
+    }
+
+    for(auto* material : *G4Material::GetMaterialTable()) {
+        description << "material " << material->GetName() << " " << material->GetDensity() << " "
+                    << material->GetTemperature() << " " << material->GetPressure();
+        for(size_t i = 0; i < material->GetNumberOfElements(); ++i) {
+            description << " " << material->GetElement(static_cast<G4int>(i))->GetName() << " "
+                        << material->GetFractionVector()[i];
+        }
+        description << "\n";
+    }
+    return description.str();
+}
+
+/**
+ * The tables are first written to a directory unique to this process, which is then renamed to the cache directory. This
+ * ensures that simultaneous jobs sharing the cache never retrieve incomplete tables.
+ */
+void DepositionGeant4Module::store_physics_tables(G4RunManager* run_manager) {
+    auto temporary_directory = physics_table_directory_ + ".tmp" + std::to_string(getpid());
+    try {
+        create_directories(temporary_directory);
+        auto* physics_list = const_cast<G4VUserPhysicsList*>(run_manager->GetUserPhysicsList()); // NOLINT
+        if(!physics_list->StorePhysicsTable(temporary_directory)) {
+            throw std::invalid_argument("Geant4 failed to store the tables");
+        }
+        std::ofstream description_file(temporary_directory + "/description.txt");
+        description_file << physics_table_description_;
+        description_file.close();
+
+        if(std::rename(temporary_directory.c_str(), physics_table_directory_.c_str()) != 0) {
+            // Another job has stored the same tables in the meantime
+            remove_path(temporary_directory);
+        }
+        LOG(INFO) << "Stored G4 physics tables in cache " << physics_table_directory_;
+    } catch(std::invalid_argument& e) {
+        LOG(WARNING) << "Cannot store G4 physics tables in cache " << physics_table_directory_ << ": " << e.what();
+        if(path_is_directory(temporary_directory)) {
+            remove_path(temporary_directory);
+        }
+    }
 }
 
 void DepositionGeant4Module::finalize() {
+    // Terminate the persistent runs, which is only possible on the thread they were started on
+    for(auto& state : thread_states_) {
+        if(!state.second->run_started) {
+            continue;
+        }
+        if(state.second->run_thread == std::this_thread::get_id()) {
+            state.second->run_manager->TerminateEventLoop();
+            state.second->run_manager->RunTermination();
+            state.second->run_started = false;
+        } else {
+            LOG(DEBUG) << "Persistent Geant4 run of thread " << state.second->run_thread
+                       << " not terminated as it is owned by another thread";
+        }
+    }
+
     size_t total_charges = 0;
-    for(auto& sensor : sensors_) {
-        total_charges += sensor->getTotalDepositedCharge();
+    for(auto& state : thread_states_) {
+        for(auto& sensor : state.second->sensors) {
+            total_charges += sensor->getTotalDepositedCharge();
+        }
     }
 
     if(config_.get<bool>("output_plots")) {
@@ -348,10 +673,11 @@ void DepositionGeant4Module::finalize() {
     }
 
     // Print summary or warns if module did not output any charges
-    if(!sensors_.empty() && total_charges > 0 && last_event_num_ > 0) {
-        size_t average_charge = total_charges / sensors_.size() / last_event_num_;
-        LOG(INFO) << "Deposited total of " << total_charges << " charges in " << sensors_.size() << " sensor(s) (average of "
-                  << average_charge << " per sensor for every event)";
+    auto number_of_sensors = deposition_detectors_.size();
+    if(number_of_sensors > 0 && total_charges > 0 && number_of_events_ > 0) {
+        size_t average_charge = total_charges / number_of_sensors / number_of_events_;
+        LOG(INFO) << "Deposited total of " << total_charges << " charges in " << number_of_sensors
+                  << " sensor(s) (average of " << average_charge << " per sensor for every event)";
     } else {
         LOG(WARNING) << "No charges deposited";
     }
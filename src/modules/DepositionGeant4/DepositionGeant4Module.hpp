@@ -10,8 +10,13 @@
 #ifndef ALLPIX_SIMPLE_DEPOSITION_MODULE_H
 #define ALLPIX_SIMPLE_DEPOSITION_MODULE_H
 
+#include <atomic>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "core/config/Configuration.hpp"
 #include "core/geometry/GeometryManager.hpp"
@@ -53,8 +58,9 @@ namespace allpix {
 
         /**
          * @brief Deposit charges for a single event
+         * @param event Event to deposit the charges for
          */
-        void run(unsigned int) override;
+        void run(Event* event) override;
 
         /**
          * @brief Display statistical summary
@@ -62,17 +68,87 @@ namespace allpix {
         void finalize() override;
 
     private:
-        Messenger* messenger_;
-        GeometryManager* geo_manager_;
+        /**
+         * @brief Geant4 objects handling the deposition on a single thread
+         */
+        struct ThreadState {
+            // Run manager processing the events of this thread
+            G4RunManager* run_manager{};
+            // The track manager which this module uses to assign custom track IDs and manage & create MCTracks
+            std::unique_ptr<TrackInfoManager> track_info_manager;
+            // Handling of the charge deposition in all the sensitive devices
+            std::vector<SensitiveDetectorActionG4*> sensors;
+            // Geant4 run kept open over all events if persistent runs are enabled
+            bool run_started{false};
+            std::thread::id run_thread;
+            int next_event_id{};
+        };
+
+        /**
+         * @brief Create the particle source, user hooks, magnetic field and sensitive detectors for a run manager
+         * @param run_manager Run manager of the calling thread
+         * @return State of the deposition on the calling thread
+         */
+        std::unique_ptr<ThreadState> create_thread_state(G4RunManager* run_manager);
+
+        /**
+         * @brief Get the state of the deposition on the calling thread
+         * @return Pointer to the state, which is created together with a worker run manager on first use if multithreaded
+         */
+        ThreadState* get_thread_state();
 
-        // The track manager which this module uses to assign custom track IDs and manage & create MCTracks
-        std::unique_ptr<TrackInfoManager> track_info_manager_;
+        /**
+         * @brief Start a single Geant4 run on the calling thread, from which all subsequent events are processed
+         * @param state State of the deposition on the calling thread
+         */
+        void start_persistent_run(ThreadState* state);
+
+        /**
+         * @brief Describe the physics list, the production cuts and the materials the physics tables are built for
+         * @param production_cut Default production cut of the world
+         * @return Description of the physics tables, identical for all runs which can share the same tables
+         */
+        std::string describe_physics_tables(double production_cut) const;
 
-        // Handling of the charge deposition in all the sensitive devices
-        std::vector<SensitiveDetectorActionG4*> sensors_;
+        /**
+         * @brief Store the physics tables built by a run manager in the cache directory
+         * @param run_manager Run manager which has built its physics tables by processing an event
+         */
+        void store_physics_tables(G4RunManager* run_manager);
+
+        Messenger* messenger_;
+        GeometryManager* geo_manager_;
 
-        // Number of the last event
-        unsigned int last_event_num_;
+        // Deposition state of every thread (a single state with the default thread identifier if not multithreaded)
+        std::map<std::thread::id, std::unique_ptr<ThreadState>> thread_states_;
+        std::mutex thread_states_mutex_;
+
+        // Events are deposited by one Geant4 worker run manager per thread of the framework
+        bool multithreading_{false};
+        int next_thread_id_{};
+
+        // Detectors with listeners for the deposited charges
+        std::vector<std::shared_ptr<Detector>> deposition_detectors_;
+
+        // Number of processed events
+        std::atomic<unsigned int> number_of_events_{};
+
+        // Parameters of the particle passage cached from the configuration
+        unsigned int number_of_particles_{};
+        bool persistent_run_{};
+        bool reseed_every_event_{};
+        TrackInfoManager::TruthDepth truth_depth_{TrackInfoManager::TruthDepth::SENSOR};
+        double decay_cutoff_time_{};
+        double charge_creation_energy_{};
+        double fano_factor_{};
+        double merge_deposits_distance_{};
+        double merge_deposits_time_{};
+
+        // Cache of the physics tables, the tables are stored after the first event if not yet available
+        std::string physics_table_directory_;
+        std::string physics_table_description_;
+        bool store_physics_tables_{false};
+        std::once_flag physics_tables_stored_;
 
         // Class holding the limits for the step size
         std::unique_ptr<G4UserLimits> user_limits_;
@@ -82,6 +158,7 @@ namespace allpix {
 
         // Vector of histogram pointers for debugging plots
         std::map<std::string, TH1D*> charge_per_event_;
+        std::mutex histogram_mutex_;
     };
 } // namespace allpix
 
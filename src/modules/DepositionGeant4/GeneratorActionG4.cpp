@@ -10,6 +10,8 @@
 
 #include "GeneratorActionG4.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <memory>
 #include <regex>
@@ -18,7 +20,9 @@
 #include <G4IonTable.hh>
 #include <G4ParticleDefinition.hh>
 #include <G4ParticleTable.hh>
+#include <G4RandomDirection.hh>
 #include <G4RunManager.hh>
+#include <Randomize.hh>
 #include <G4UImanager.hh>
 #include <core/module/exceptions.h>
 
@@ -109,6 +113,12 @@ GeneratorActionG4::GeneratorActionG4(const Configuration& config)
             single_source->GetAngDist()->SetBeamSigmaInAngX(divergence.x());
             single_source->GetAngDist()->SetBeamSigmaInAngY(divergence.y());
 
+            beam_size_ = config.get<double>("beam_size", 0);
+            beam_divergence_ = divergence;
+            beam_direction_ = direction.unit();
+            angref1_ = angref1.unit();
+            angref2_ = angref2.unit();
+
         } else if(source_type == "sphere") {
 
             // Set position parameters
@@ -144,6 +154,7 @@ GeneratorActionG4::GeneratorActionG4(const Configuration& config)
 
             // Set angle distribution parameters
             single_source->GetAngDist()->SetAngDistType("iso");
+            isotropic_ = true;
 
         } else {
 
@@ -184,6 +195,8 @@ GeneratorActionG4::GeneratorActionG4(const Configuration& config)
             particle->SetPDGLifeTime(0.);
 
             single_source->SetParticleCharge(std::get<2>(isotope));
+            particle_charge_ = std::get<2>(isotope);
+            has_particle_charge_ = true;
 
             // Warn about non-zero source energy:
             if(config.get<double>("source_energy") > 0) {
@@ -199,6 +212,8 @@ GeneratorActionG4::GeneratorActionG4(const Configuration& config)
                 particle = G4IonTable::GetIonTable()->GetIon(
                     allpix::from_string<int>(ion[1]), allpix::from_string<int>(ion[2]), allpix::from_string<double>(ion[4]));
                 single_source->SetParticleCharge(allpix::from_string<int>(ion[3]));
+                particle_charge_ = allpix::from_string<int>(ion[3]);
+                has_particle_charge_ = true;
             } else {
                 throw InvalidValueError(config, "particle_type", "cannot parse parameters for ion.");
             }
@@ -221,12 +236,68 @@ GeneratorActionG4::GeneratorActionG4(const Configuration& config)
         single_source->GetEneDist()->SetEnergyDisType("Gauss");
         single_source->GetEneDist()->SetMonoEnergy(config.get<double>("source_energy"));
         single_source->GetEneDist()->SetBeamSigmaInE(config.get<double>("source_energy_spread", 0.));
+
+        // Replace the general particle source by a particle gun for beams and point sources if requested
+        if(config.get<bool>("particle_gun", false)) {
+            if(source_type == "beam" || source_type == "point") {
+                LOG(INFO) << "Using particle gun for " << source_type << " source";
+                source_position_ = config.get<G4ThreeVector>("source_position");
+                energy_ = config.get<double>("source_energy");
+                energy_spread_ = config.get<double>("source_energy_spread", 0.);
+
+                particle_gun_ = std::make_unique<G4ParticleGun>(1);
+                particle_gun_->SetParticleDefinition(particle);
+                if(has_particle_charge_) {
+                    particle_gun_->SetParticleCharge(particle_charge_);
+                }
+                particle_gun_->SetParticleTime(0.0);
+            } else {
+                LOG(WARNING) << "Particle gun is only available for beam and point sources, using the general particle "
+                                "source instead";
+            }
+        }
     }
 }
 
 /**
- * Called automatically for every event
+ * Called automatically for every event. The particle gun samples the same distributions as the general particle source:
+ * the beam spot is Gaussian in x and y of the global frame around the source position, the angles of the beam are
+ * Gaussian around the beam direction in the reference axes perpendicular to it, point sources emit isotropically, and the
+ * energy follows a Gaussian truncated at zero.
  */
 void GeneratorActionG4::GeneratePrimaries(G4Event* event) {
-    particle_source_->GeneratePrimaryVertex(event);
+    if(particle_gun_ == nullptr) {
+        particle_source_->GeneratePrimaryVertex(event);
+        return;
+    }
+
+    auto position = source_position_;
+    G4ThreeVector direction;
+    if(isotropic_) {
+        direction = G4RandomDirection();
+    } else {
+        if(beam_size_ > 0) {
+            position += G4ThreeVector(G4RandGauss::shoot(0., beam_size_), G4RandGauss::shoot(0., beam_size_), 0.);
+        }
+        direction = beam_direction_;
+        if(beam_divergence_.x() > 0 || beam_divergence_.y() > 0) {
+            auto angle_x = G4RandGauss::shoot(0., beam_divergence_.x());
+            auto angle_y = G4RandGauss::shoot(0., beam_divergence_.y());
+            auto theta = std::sqrt(angle_x * angle_x + angle_y * angle_y);
+            if(theta > 0) {
+                direction = std::cos(theta) * beam_direction_ -
+                            std::sin(theta) / theta * (angle_x * angref1_ + angle_y * angref2_);
+            }
+        }
+    }
+
+    auto energy = energy_;
+    if(energy_spread_ > 0) {
+        energy = std::max(0., G4RandGauss::shoot(energy_, energy_spread_));
+    }
+
+    particle_gun_->SetParticlePosition(position);
+    particle_gun_->SetParticleMomentumDirection(direction);
+    particle_gun_->SetParticleEnergy(energy);
+    particle_gun_->GeneratePrimaryVertex(event);
 }
@@ -14,6 +14,7 @@
 
 #include <G4GeneralParticleSource.hh>
 #include <G4ParticleDefinition.hh>
+#include <G4ParticleGun.hh>
 #include <G4SDManager.hh>
 #include <G4ThreeVector.hh>
 #include <G4TwoVector.hh>
@@ -24,6 +25,9 @@
 namespace allpix {
     /**
      * @brief Generates the particles in every event
+     *
+     * Beams and point sources can be generated by a particle gun instead of the general particle source, sampling the
+     * position, direction and energy of every particle directly from the same distributions.
      */
     class GeneratorActionG4 : public G4VUserPrimaryGeneratorAction {
     public:
@@ -40,6 +44,16 @@ namespace allpix {
 
     private:
         std::unique_ptr<G4GeneralParticleSource> particle_source_;
+
+        // Particle gun replacing the general particle source for beams and point sources if requested
+        std::unique_ptr<G4ParticleGun> particle_gun_;
+        bool isotropic_{};
+        double particle_charge_{};
+        bool has_particle_charge_{};
+        double energy_{}, energy_spread_{};
+        double beam_size_{};
+        G4TwoVector beam_divergence_;
+        G4ThreeVector source_position_, beam_direction_, angref1_, angref2_;
     };
 } // namespace allpix
 
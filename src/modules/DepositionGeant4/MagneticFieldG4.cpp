@@ -0,0 +1,20 @@
+/**
+ * @file
+ * @brief Implements a Geant4 magnetic field evaluating the magnetic field function of the geometry manager
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "MagneticFieldG4.hpp"
+
+using namespace allpix;
+
+void MagneticFieldG4::GetFieldValue(const G4double point[4], G4double* field) const {
+    auto b_field = function_(ROOT::Math::XYZPoint(point[0], point[1], point[2]));
+    field[0] = b_field.x();
+    field[1] = b_field.y();
+    field[2] = b_field.z();
+}
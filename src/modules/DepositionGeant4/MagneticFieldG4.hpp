@@ -0,0 +1,49 @@
+/**
+ * @file
+ * @brief Defines a Geant4 magnetic field evaluating the magnetic field function of the geometry manager
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef MagneticFieldG4_H
+#define MagneticFieldG4_H 1
+
+#include <utility>
+
+#include "G4MagneticField.hh"
+
+#include "core/geometry/GeometryManager.hpp"
+
+namespace allpix {
+    /**
+     * @brief Magnetic field for the Geant4 stepping, looked up from a function in global coordinates
+     */
+    class MagneticFieldG4 : public G4MagneticField {
+    public:
+        /**
+         * @brief Constructor taking the magnetic field function
+         * @param function Function returning the magnetic field at a position in the global frame
+         */
+        explicit MagneticFieldG4(MagneticFieldFunction function) : function_(std::move(function)){};
+
+        /**
+         * @brief Default destructor
+         */
+        ~MagneticFieldG4() override = default;
+
+        /**
+         * @brief Get the magnetic field at a point in the global frame
+         * @param point Global position and time of the point
+         * @param field Array to store the three components of the magnetic field in
+         */
+        void GetFieldValue(const G4double point[4], G4double* field) const override;
+
+    private:
+        MagneticFieldFunction function_;
+    };
+
+} // namespace allpix
+#endif /* MagneticFieldG4_H */
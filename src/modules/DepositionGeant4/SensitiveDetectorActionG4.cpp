@@ -11,6 +11,7 @@
 #include "SensitiveDetectorActionG4.hpp"
 #include "TrackInfoG4.hpp"
 
+#include <cmath>
 #include <memory>
 
 #include "G4DecayTable.hh"
@@ -39,10 +40,12 @@ SensitiveDetectorActionG4::SensitiveDetectorActionG4(Module* module,
                                                      TrackInfoManager* track_info_manager,
                                                      double charge_creation_energy,
                                                      double fano_factor,
-                                                     uint64_t random_seed)
+                                                     uint64_t random_seed,
+                                                     double merge_distance,
+                                                     double merge_time)
     : G4VSensitiveDetector("SensitiveDetector_" + detector->getName()), module_(module), detector_(detector),
       messenger_(msg), track_info_manager_(track_info_manager), charge_creation_energy_(charge_creation_energy),
-      fano_factor_(fano_factor) {
+      fano_factor_(fano_factor), merge_distance_(merge_distance), merge_time_(merge_time) {
 
     // Add the sensor to the internal sensitive detector manager
     G4SDManager* sd_man_g4 = G4SDManager::GetSDMpointer();
@@ -58,16 +61,13 @@ G4bool SensitiveDetectorActionG4::ProcessHits(G4Step* step, G4TouchableHistory*)
     G4StepPoint* preStepPoint = step->GetPreStepPoint();
     G4StepPoint* postStepPoint = step->GetPostStepPoint();
 
-    // Get Transportaion Matrix
-    G4TouchableHandle theTouchable = step->GetPreStepPoint()->GetTouchableHandle();
-
     // Put the charge deposit in the middle of the step
     G4ThreeVector mid_pos = (preStepPoint->GetPosition() + postStepPoint->GetPosition()) / 2;
     double mid_time = (preStepPoint->GetGlobalTime() + postStepPoint->GetGlobalTime()) / 2;
 
     // Calculate the charge deposit at a local position
-    auto deposit_position = detector_->getLocalPosition(static_cast<ROOT::Math::XYZPoint>(mid_pos));
-    auto deposit_position_g4 = theTouchable->GetHistory()->GetTopTransform().TransformPoint(mid_pos);
+    auto global_deposit_position = static_cast<ROOT::Math::XYZPoint>(mid_pos);
+    auto deposit_position = detector_->getLocalPosition(global_deposit_position);
 
     // Calculate number of electron hole pairs produced, taking into acocunt fluctuations between ionization and lattice
     // excitations via the Fano factor. We assume Gaussian statistics here.
@@ -75,12 +75,8 @@ G4bool SensitiveDetectorActionG4::ProcessHits(G4Step* step, G4TouchableHistory*)
     std::normal_distribution<double> charge_fluctuation(mean_charge, std::sqrt(mean_charge * fano_factor_));
     auto charge = charge_fluctuation(random_generator_);
 
-    auto deposit_position_g4loc =
-        ROOT::Math::XYZPoint(deposit_position_g4.x() + detector_->getModel()->getSensorCenter().x(),
-                             deposit_position_g4.y() + detector_->getModel()->getSensorCenter().y(),
-                             deposit_position_g4.z() + detector_->getModel()->getSensorCenter().z());
-
-    const auto userTrackInfo = dynamic_cast<TrackInfoG4*>(step->GetTrack()->GetUserInformation());
+    // Every track is assigned its information by the user hook, the type is therefore known
+    const auto* userTrackInfo = static_cast<const TrackInfoG4*>(step->GetTrack()->GetUserInformation());
     if(userTrackInfo == nullptr) {
         throw ModuleError("No track information attached to track.");
     }
@@ -88,25 +84,60 @@ G4bool SensitiveDetectorActionG4::ProcessHits(G4Step* step, G4TouchableHistory*)
     auto parentTrackID = userTrackInfo->getParentID();
 
     // Save begin point when track is seen for the first time
-    if(track_begin_.find(trackID) == track_begin_.end()) {
+    if(static_cast<size_t>(trackID) >= track_index_.size()) {
+        track_index_.resize(static_cast<size_t>(trackID) + 1, -1);
+    }
+    auto& track_index = track_index_[static_cast<size_t>(trackID)];
+    if(track_index < 0) {
         track_info_manager_->setTrackInfoToBeStored(trackID);
         auto start_position = detector_->getLocalPosition(static_cast<ROOT::Math::XYZPoint>(preStepPoint->GetPosition()));
-        track_begin_.emplace(trackID, start_position);
-        track_parents_.emplace(trackID, parentTrackID);
-        track_time_.emplace(trackID, mid_time);
-        track_pdg_.emplace(trackID, step->GetTrack()->GetDynamicParticle()->GetPDGcode());
+        track_index = static_cast<int>(tracks_.size());
+        tracks_.push_back({trackID,
+                           parentTrackID,
+                           step->GetTrack()->GetDynamicParticle()->GetPDGcode(),
+                           mid_time,
+                           start_position,
+                           start_position});
     }
 
     // Update current end point with the current last step
     auto end_position = detector_->getLocalPosition(static_cast<ROOT::Math::XYZPoint>(postStepPoint->GetPosition()));
-    track_end_[trackID] = end_position;
+    tracks_[static_cast<size_t>(track_index)].end = end_position;
 
     // Add new deposit if the charge is more than zero
     if(charge == 0) {
         return false;
     }
 
-    auto global_deposit_position = detector_->getGlobalPosition(deposit_position);
+    // Merge with the last deposit if it belongs to the same track and started close enough to this step
+    auto charge_count = static_cast<unsigned int>(charge);
+    auto weight = static_cast<double>(charge_count);
+    if(merge_distance_ > 0 && !deposit_to_id_.empty() && deposit_to_id_.back() == trackID &&
+       merge_charge_ + charge_count > 0 && (deposit_position - merge_origin_).R() <= merge_distance_ &&
+       std::fabs(mid_time - merge_origin_time_) <= merge_time_) {
+        merge_charge_ += charge_count;
+        merge_position_sum_ += weight * static_cast<ROOT::Math::XYZVector>(deposit_position);
+        merge_time_sum_ += weight * mid_time;
+
+        // Replace the electron and hole of the last deposit by the charge-weighted mean of all merged steps
+        auto merged_position = ROOT::Math::XYZPoint(merge_position_sum_ / static_cast<double>(merge_charge_));
+        auto merged_time = merge_time_sum_ / static_cast<double>(merge_charge_);
+        auto global_merged_position = detector_->getGlobalPosition(merged_position);
+        deposits_.pop_back();
+        deposits_.pop_back();
+        deposits_.emplace_back(merged_position, global_merged_position, CarrierType::ELECTRON, merge_charge_, merged_time);
+        deposits_.emplace_back(merged_position, global_merged_position, CarrierType::HOLE, merge_charge_, merged_time);
+
+        LOG(DEBUG) << "Merged deposit of " << charge << " charges at " << Units::display(deposit_position, {"mm", "um"})
+                   << " into deposit of " << merge_charge_ << " charges at "
+                   << Units::display(merged_position, {"mm", "um"}) << " in " << detector_->getName();
+        return true;
+    }
+    merge_origin_ = deposit_position;
+    merge_origin_time_ = mid_time;
+    merge_charge_ = charge_count;
+    merge_position_sum_ = weight * static_cast<ROOT::Math::XYZVector>(deposit_position);
+    merge_time_sum_ = weight * mid_time;
 
     // Deposit electron
     deposits_.emplace_back(deposit_position, global_deposit_position, CarrierType::ELECTRON, charge, mid_time);
@@ -120,10 +151,19 @@ G4bool SensitiveDetectorActionG4::ProcessHits(G4Step* step, G4TouchableHistory*)
                << " locally on " << Units::display(deposit_position, {"mm", "um"}) << " in " << detector_->getName()
                << " after " << Units::display(mid_time, {"ns", "ps"});
 
-    LOG(DEBUG) << "Geant4 transformation to local: " << Units::display(deposit_position_g4loc, {"mm", "um"});
-    if((deposit_position_g4loc - deposit_position).mag2() > 0.001) {
-        LOG(ERROR) << "Difference G4 to internal: "
-                   << Units::display((deposit_position_g4loc - deposit_position), {"mm", "um"});
+    // Cross-check the internal transformation with the one of the sensor volume, which is the same for all its steps
+    if(!sensor_transform_checked_) {
+        auto deposit_position_g4 =
+            preStepPoint->GetTouchableHandle()->GetHistory()->GetTopTransform().TransformPoint(mid_pos);
+        auto deposit_position_g4loc =
+            ROOT::Math::XYZPoint(deposit_position_g4.x(), deposit_position_g4.y(), deposit_position_g4.z()) +
+            static_cast<ROOT::Math::XYZVector>(detector_->getModel()->getSensorCenter());
+        LOG(DEBUG) << "Geant4 transformation to local: " << Units::display(deposit_position_g4loc, {"mm", "um"});
+        if((deposit_position_g4loc - deposit_position).mag2() > 0.001) {
+            LOG(ERROR) << "Difference G4 to internal: "
+                       << Units::display((deposit_position_g4loc - deposit_position), {"mm", "um"});
+        }
+        sensor_transform_checked_ = true;
     }
     return true;
 }
@@ -140,52 +180,48 @@ unsigned int SensitiveDetectorActionG4::getDepositedCharge() {
     return deposited_charge_;
 }
 
-void SensitiveDetectorActionG4::dispatchMessages() {
-    // Create the mc particles
-    std::vector<MCParticle> mc_particles;
-    for(auto& track_id_point : track_begin_) {
-        auto track_id = track_id_point.first;
-        auto local_begin = track_id_point.second;
-
-        ROOT::Math::XYZPoint end_point;
-        auto local_end = track_end_.at(track_id);
-        auto pdg_code = track_pdg_.at(track_id);
-        auto track_time = track_time_.at(track_id);
-
-        auto global_begin = detector_->getGlobalPosition(local_begin);
-        auto global_end = detector_->getGlobalPosition(local_end);
-        mc_particles.emplace_back(local_begin, global_begin, local_end, global_end, pdg_code, track_time);
-        mc_particles.back().setTrack(track_info_manager_->findMCTrack(track_id));
-        id_to_particle_[track_id] = mc_particles.size() - 1;
-
-        LOG(DEBUG) << "Found MC particle " << pdg_code << " crossing detector " << detector_->getName() << " from "
-                   << Units::display(local_begin, {"mm", "um"}) << " to " << Units::display(local_end, {"mm", "um"})
-                   << " (local coordinates) at " << Units::display(track_time, {"us", "ns", "ps"});
+void SensitiveDetectorActionG4::setRandomSeed(uint64_t random_seed) {
+    random_generator_.seed(random_seed);
+}
+
+void SensitiveDetectorActionG4::dispatchMessages(Event* event) {
+    // Create the mc particles in the order of their track id
+    auto mc_particles = MessageStorage<MCParticle>::acquire();
+    mc_particles.reserve(tracks_.size());
+    for(size_t track_id = 0; track_id < track_index_.size(); ++track_id) {
+        auto& index = track_index_[track_id];
+        if(index < 0) {
+            continue;
+        }
+        const auto& track = tracks_[static_cast<size_t>(index)];
+
+        auto global_begin = detector_->getGlobalPosition(track.begin);
+        auto global_end = detector_->getGlobalPosition(track.end);
+        mc_particles.emplace_back(track.begin, global_begin, track.end, global_end, track.pdg_code, track.time);
+        mc_particles.back().setTrack(track_info_manager_->findMCTrack(track.id));
+        index = static_cast<int>(mc_particles.size() - 1);
+
+        LOG(DEBUG) << "Found MC particle " << track.pdg_code << " crossing detector " << detector_->getName() << " from "
+                   << Units::display(track.begin, {"mm", "um"}) << " to " << Units::display(track.end, {"mm", "um"})
+                   << " (local coordinates) at " << Units::display(track.time, {"us", "ns", "ps"});
     }
 
-    for(auto& track_parent : track_parents_) {
-        auto track_id = track_parent.first;
-        auto parent_id = track_parent.second;
-        if(id_to_particle_.find(parent_id) == id_to_particle_.end()) {
+    for(auto& track : tracks_) {
+        auto parent_id = static_cast<size_t>(track.parent_id);
+        if(parent_id >= track_index_.size() || track_index_[parent_id] < 0) {
             // Skip tracks without direct parents with deposits
             // FIXME: Geant4 does not allow for an easy way retrieve the whole hierarchy
             continue;
         }
-        auto track_idx = id_to_particle_.at(track_id);
-        auto parent_idx = id_to_particle_.at(parent_id);
+        auto track_idx = static_cast<size_t>(track_index_[static_cast<size_t>(track.id)]);
+        auto parent_idx = static_cast<size_t>(track_index_[parent_id]);
         mc_particles.at(track_idx).setParent(&mc_particles.at(parent_idx));
     }
 
     // Send the mc particle information
     auto mc_particle_message = std::make_shared<MCParticleMessage>(std::move(mc_particles), detector_);
-    messenger_->dispatchMessage(module_, mc_particle_message);
+    messenger_->dispatchMessage(module_, mc_particle_message, event);
 
-    // Clear track data for the next event
-    track_parents_.clear();
-    track_begin_.clear();
-    track_end_.clear();
-    track_pdg_.clear();
-    track_time_.clear();
 
     // Send a deposit message if we have any deposits
     unsigned int charges = 0;
@@ -199,22 +235,24 @@ void SensitiveDetectorActionG4::dispatchMessages() {
         // Match deposit with mc particle if possible
         for(size_t i = 0; i < deposits_.size(); ++i) {
             auto track_id = deposit_to_id_.at(i);
-            deposits_.at(i).setMCParticle(&mc_particle_message->getData().at(id_to_particle_.at(track_id)));
+            auto particle_idx = static_cast<size_t>(track_index_.at(static_cast<size_t>(track_id)));
+            deposits_.at(i).setMCParticle(&mc_particle_message->getData().at(particle_idx));
         }
 
         // Create a new charge deposit message
         auto deposit_message = std::make_shared<DepositedChargeMessage>(std::move(deposits_), detector_);
 
         // Dispatch the message
-        messenger_->dispatchMessage(module_, deposit_message);
+        messenger_->dispatchMessage(module_, deposit_message, event);
     }
     // Store the number of charge carriers:
     deposited_charge_ = charges;
 
     // Clear deposits for next event
-    deposits_ = std::vector<DepositedCharge>();
+    deposits_ = MessageStorage<DepositedCharge>::acquire();
 
-    // Clear link tables for next event
+    // Clear track data and link tables for next event
+    tracks_.clear();
+    track_index_.clear();
     deposit_to_id_.clear();
-    id_to_particle_.clear();
 }
@@ -11,6 +11,7 @@
 #define ALLPIX_SIMPLE_DEPOSITION_MODULE_SENSITIVE_DETECTOR_ACTION_H
 
 #include <memory>
+#include <vector>
 
 #include <G4VSensitiveDetector.hh>
 #include <G4WrapperProcess.hh>
@@ -37,6 +38,8 @@ namespace allpix {
          * @param charge_creation_energy Energy needed per deposited charge
          * @param fano_factor Fano factor for fluctuations in the energy fraction going into e/h pair creation
          * @param random_seed Seed for the random number generator for Fano fluctuations
+         * @param merge_distance Maximum distance of steps of a track merged into a single deposit (zero to disable merging)
+         * @param merge_time Maximum time difference of steps of a track merged into a single deposit
          */
         SensitiveDetectorActionG4(Module* module,
                                   const std::shared_ptr<Detector>& detector,
@@ -44,7 +47,9 @@ namespace allpix {
                                   TrackInfoManager* track_info_manager,
                                   double charge_creation_energy,
                                   double fano_factor,
-                                  uint64_t random_seed);
+                                  uint64_t random_seed,
+                                  double merge_distance = 0,
+                                  double merge_time = 0);
 
         /**
          * @brief Get total number of charges deposited in the sensitive device bound to this action
@@ -70,10 +75,17 @@ namespace allpix {
          */
         G4bool ProcessHits(G4Step* step, G4TouchableHistory* history) override;
 
+        /**
+         * @brief Reseed the random number generator for Fano fluctuations
+         * @param random_seed New seed for the random number generator
+         */
+        void setRandomSeed(uint64_t random_seed);
+
         /**
          * @brief Send the MCParticle and DepositedCharge messages
+         * @param event Event the messages belong to
          */
-        void dispatchMessages();
+        void dispatchMessages(Event* event);
 
     private:
         // Instantatiation of the deposition module
@@ -86,9 +98,23 @@ namespace allpix {
         double charge_creation_energy_;
         double fano_factor_;
 
+        // Whether the Geant4 transformation of the sensor volume has been compared to the one of the detector
+        bool sensor_transform_checked_{false};
+
         // Random number generator for e/h pair creation fluctuation
         std::mt19937_64 random_generator_;
 
+        // Maximum distance and time difference to the first step of a deposit for merging the following steps into it
+        double merge_distance_;
+        double merge_time_;
+
+        // First step, total charge and charge-weighted sums of the positions and times of the last deposit
+        ROOT::Math::XYZPoint merge_origin_;
+        double merge_origin_time_{};
+        unsigned int merge_charge_{};
+        ROOT::Math::XYZVector merge_position_sum_;
+        double merge_time_sum_{};
+
         // Statistics of total and per-event deposited charge
         unsigned int total_deposited_charge_{};
         unsigned int deposited_charge_{};
@@ -96,21 +122,26 @@ namespace allpix {
         // Set of deposited charges in this event
         std::vector<DepositedCharge> deposits_;
 
-        // List of begin points for tracks
-        std::map<int, ROOT::Math::XYZPoint> track_begin_;
-        // List of end points for tracks
-        std::map<int, ROOT::Math::XYZPoint> track_end_;
-        // Parent of all mc tracks
-        std::map<int, int> track_parents_;
-        // PDG code of the tracks
-        std::map<int, int> track_pdg_;
-        // Arrival timestamp of the tracks
-        std::map<int, double> track_time_;
+        /**
+         * @brief Information about a track passing through this sensor
+         */
+        struct TrackData {
+            int id;
+            int parent_id;
+            int pdg_code;
+            double time;
+            ROOT::Math::XYZPoint begin;
+            ROOT::Math::XYZPoint end;
+        };
+
+        // Tracks passing through this sensor in the order of their first step
+        std::vector<TrackData> tracks_;
+        // Index in #tracks_ for every custom track id (negative if the track did not pass), replaced by the index of the
+        // mc particle when the messages are dispatched
+        std::vector<int> track_index_;
 
         // Map from deposit index to track id
         std::vector<int> deposit_to_id_;
-        // Map from track id to mc particle index
-        std::map<int, size_t> id_to_particle_;
     };
 } // namespace allpix
 
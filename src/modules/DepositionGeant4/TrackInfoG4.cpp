@@ -15,12 +15,11 @@ using namespace allpix;
 
 TrackInfoG4::TrackInfoG4(int custom_track_id, int parent_track_id, const G4Track* const aTrack)
     : custom_track_id_(custom_track_id), parent_track_id_(parent_track_id) {
-    auto G4Process = aTrack->GetCreatorProcess();
-    origin_g4_process_type_ = (G4Process != nullptr) ? G4Process->GetProcessType() : -1;
+    origin_g4_process_ = aTrack->GetCreatorProcess();
+    origin_g4_process_type_ = (origin_g4_process_ != nullptr) ? origin_g4_process_->GetProcessType() : -1;
     particle_id_ = aTrack->GetDynamicParticle()->GetPDGcode();
     start_point_ = static_cast<ROOT::Math::XYZPoint>(aTrack->GetPosition());
-    origin_g4_vol_name_ = aTrack->GetVolume()->GetName();
-    origin_g4_process_name_ = (G4Process != nullptr) ? static_cast<std::string>(G4Process->GetProcessName()) : "none";
+    origin_g4_volume_ = aTrack->GetVolume();
     initial_kin_E_ = aTrack->GetKineticEnergy();
     initial_tot_E_ = aTrack->GetTotalEnergy();
 }
@@ -73,9 +72,9 @@ double TrackInfoG4::getTotalEnergyFinal() const {
 }
 
 std::string TrackInfoG4::getOriginatingVolumeName() const {
-    return origin_g4_vol_name_;
+    return origin_g4_volume_->GetName();
 }
 
 std::string TrackInfoG4::getCreationProcessName() const {
-    return origin_g4_process_name_;
+    return (origin_g4_process_ != nullptr) ? static_cast<std::string>(origin_g4_process_->GetProcessName()) : "none";
 }
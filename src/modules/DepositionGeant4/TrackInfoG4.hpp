@@ -125,10 +125,10 @@ namespace allpix {
         ROOT::Math::XYZPoint start_point_{};
         // End point of track (in mm)
         ROOT::Math::XYZPoint end_point_{};
-        // Geant4 volume in which the track was created
-        std::string origin_g4_vol_name_{};
-        // Name of Geant4 process which created this track
-        std::string origin_g4_process_name_{};
+        // Geant4 volume in which the track was created, the name is only retrieved if the track is stored
+        const G4VPhysicalVolume* origin_g4_volume_{};
+        // Geant4 process which created this track, the name is only retrieved if the track is stored
+        const G4VProcess* origin_g4_process_{};
         // Initial kinetic energy (MeV)
         double initial_kin_E_{};
         // Initial total energy (MeV)
@@ -11,37 +11,53 @@
 
 using namespace allpix;
 
-TrackInfoManager::TrackInfoManager() : counter_(1) {}
+namespace {
+    // Assign a value to an element of a list indexed by track id, growing the list if needed
+    template <typename T> void assign_indexed(std::vector<T>& list, int index, T value, T fill) {
+        auto idx = static_cast<size_t>(index);
+        if(idx >= list.size()) {
+            list.resize(idx + 1, fill);
+        }
+        list[idx] = value;
+    }
+} // namespace
+
+TrackInfoManager::TrackInfoManager(TruthDepth depth) : counter_(1), depth_(depth) {}
 
 std::unique_ptr<TrackInfoG4> TrackInfoManager::makeTrackInfo(const G4Track* const track) {
     auto custom_id = counter_++;
     auto G4ParentID = track->GetParentID();
-    auto parent_track_id = G4ParentID == 0 ? G4ParentID : g4_to_custom_id_.at(G4ParentID);
-    g4_to_custom_id_[track->GetTrackID()] = custom_id;
-    track_id_to_parent_id_[custom_id] = parent_track_id;
+    auto parent_track_id = G4ParentID == 0 ? G4ParentID : g4_to_custom_id_.at(static_cast<size_t>(G4ParentID));
+    assign_indexed(g4_to_custom_id_, track->GetTrackID(), custom_id, 0);
+    assign_indexed(track_id_to_parent_id_, custom_id, parent_track_id, 0);
     return std::make_unique<TrackInfoG4>(custom_id, parent_track_id, track);
 }
 
 void TrackInfoManager::setTrackInfoToBeStored(int track_id) {
-    auto element = std::find(to_store_track_ids_.begin(), to_store_track_ids_.end(), track_id);
-    // If track id is not present we add it, otherwise skip as we only need each track once
-    if(element == to_store_track_ids_.end()) {
-        to_store_track_ids_.emplace_back(track_id);
+    if(depth_ == TruthDepth::NONE) {
+        return;
+    }
+    if(depth_ == TruthDepth::PRIMARY && track_id_to_parent_id_.at(static_cast<size_t>(track_id)) != 0) {
+        return;
     }
+    // Every track only needs to be flagged once
+    assign_indexed<char>(to_store_track_ids_, track_id, 1, 0);
 }
 
 void TrackInfoManager::storeTrackInfo(std::unique_ptr<TrackInfoG4> the_track_info) {
-    auto track_id = the_track_info->getID();
-    auto element = std::find(to_store_track_ids_.begin(), to_store_track_ids_.end(), track_id);
-    if(element != to_store_track_ids_.end()) {
+    auto track_id = static_cast<size_t>(the_track_info->getID());
+    if(track_id < to_store_track_ids_.size() && to_store_track_ids_[track_id] != 0) {
         stored_track_infos_.push_back(std::move(the_track_info));
-        to_store_track_ids_.erase(element);
+        to_store_track_ids_[track_id] = 0;
     }
 }
 
+/**
+ * The lists are cleared without releasing their memory, such that it is reused for the next event
+ */
 void TrackInfoManager::resetTrackInfoManager() {
     counter_ = 1;
-    stored_tracks_.clear();
+    stored_tracks_ = MessageStorage<MCTrack>::acquire();
     to_store_track_ids_.clear();
     g4_to_custom_id_.clear();
     track_id_to_parent_id_.clear();
@@ -50,7 +66,7 @@ void TrackInfoManager::resetTrackInfoManager() {
     id_to_track_.clear();
 }
 
-void TrackInfoManager::dispatchMessage(Module* module, Messenger* messenger) {
+void TrackInfoManager::dispatchMessage(Module* module, Messenger* messenger, Event* event) {
     setAllTrackParents();
     IFLOG(DEBUG) {
         LOG(DEBUG) << "Dispatching " << stored_tracks_.size() << " MCTrack(s) from TrackInfoManager::dispatchMessage()";
@@ -60,15 +76,19 @@ void TrackInfoManager::dispatchMessage(Module* module, Messenger* messenger) {
         }
     }
     auto mc_track_message = std::make_shared<MCTrackMessage>(std::move(stored_tracks_));
-    messenger->dispatchMessage(module, mc_track_message);
+    messenger->dispatchMessage(module, mc_track_message, event);
 }
 
 MCTrack const* TrackInfoManager::findMCTrack(int track_id) const {
-    auto it = id_to_track_.find(track_id);
-    return (it == id_to_track_.end()) ? nullptr : &stored_tracks_.at(it->second);
+    auto idx = static_cast<size_t>(track_id);
+    if(track_id < 0 || idx >= id_to_track_.size() || id_to_track_[idx] < 0) {
+        return nullptr;
+    }
+    return &stored_tracks_.at(static_cast<size_t>(id_to_track_[idx]));
 }
 
 void TrackInfoManager::createMCTracks() {
+    stored_tracks_.reserve(stored_track_infos_.size());
     for(auto& track_info : stored_track_infos_) {
         stored_tracks_.emplace_back(track_info->getStartPoint(),
                                     track_info->getEndPoint(),
@@ -81,7 +101,7 @@ void TrackInfoManager::createMCTracks() {
                                     track_info->getTotalEnergyInitial(),
                                     track_info->getTotalEnergyFinal());
 
-        id_to_track_[track_info->getID()] = stored_tracks_.size() - 1;
+        assign_indexed(id_to_track_, track_info->getID(), static_cast<long>(stored_tracks_.size() - 1), -1L);
         stored_track_ids_.emplace_back(track_info->getID());
     }
 }
@@ -89,7 +109,7 @@ void TrackInfoManager::createMCTracks() {
 void TrackInfoManager::setAllTrackParents() {
     for(size_t ix = 0; ix < stored_track_ids_.size(); ++ix) {
         auto track_id = stored_track_ids_[ix];
-        auto parent_id = track_id_to_parent_id_[track_id];
+        auto parent_id = track_id_to_parent_id_.at(static_cast<size_t>(track_id));
         stored_tracks_[ix].setParent(findMCTrack(parent_id));
     }
 }
@@ -11,7 +11,8 @@
 #ifndef TrackInfoManager_H
 #define TrackInfoManager_H 1
 
-#include <map>
+#include <memory>
+#include <vector>
 
 #include "G4Track.hh"
 #include "TrackInfoG4.hpp"
@@ -26,9 +27,19 @@ namespace allpix {
     class TrackInfoManager {
     public:
         /**
-         * @brief Default constructor
+         * @brief Selection of the tracks which are stored as MCTrack objects
          */
-        TrackInfoManager();
+        enum class TruthDepth {
+            NONE = 0, ///< No tracks are stored
+            PRIMARY,  ///< Only primary tracks which passed through a sensitive detector are stored
+            SENSOR,   ///< All tracks which passed through a sensitive detector are stored
+        };
+
+        /**
+         * @brief Constructor
+         * @param depth Selection of the tracks to store
+         */
+        explicit TrackInfoManager(TruthDepth depth = TruthDepth::SENSOR);
 
         /**
          * @brief Factory method for TrackInfoG4 instances
@@ -52,7 +63,8 @@ namespace allpix {
          * @brief Will register a track id to be stored
          * @param track_id The id of the track to be stored
          *
-         * The track itself will have to be provided via @see storeTrackInfo once finished
+         * The track itself will have to be provided via @see storeTrackInfo once finished. Tracks not selected by the
+         * truth depth of this manager are ignored.
          */
         void setTrackInfoToBeStored(int track_id);
 
@@ -69,8 +81,9 @@ namespace allpix {
          * @brief Dispatch the stored tracks as a MCTrackMessage
          * @param module The module which is responsible for dispatching the message
          * @param messenger The messenger used to dispatch it
+         * @param event The event the tracks belong to
          */
-        void dispatchMessage(Module* module, Messenger* messenger);
+        void dispatchMessage(Module* module, Messenger* messenger, Event* event);
 
         /**
          * @brief Populate the #stored_tracks_ with MCTrack objects
@@ -97,20 +110,22 @@ namespace allpix {
 
         // Counter to store highest assigned track id
         int counter_{};
-        // Geant4 id to custom id translation
-        std::map<int, int> g4_to_custom_id_{};
-        // Custom id to custom parent id tracking
-        std::map<int, int> track_id_to_parent_id_{};
-        // List of track ids to be stored if they are provided via #storeTrackInfo
-        std::vector<int> to_store_track_ids_;
+        // Selection of the tracks to store
+        TruthDepth depth_;
+        // Geant4 id to custom id translation, indexed by the Geant4 track id
+        std::vector<int> g4_to_custom_id_;
+        // Custom parent id of every track, indexed by the custom track id
+        std::vector<int> track_id_to_parent_id_;
+        // Flags for the tracks to be stored if they are provided via #storeTrackInfo, indexed by the custom track id
+        std::vector<char> to_store_track_ids_;
         // The TrackInfoG4 instances which are handed over to this track manager
         std::vector<std::unique_ptr<TrackInfoG4>> stored_track_infos_;
         // The MCTrack vector which is dispatched via #dispatchMessage
         std::vector<MCTrack> stored_tracks_;
         // Ids ins same order as tracks stored in #stored_tracks_
         std::vector<int> stored_track_ids_;
-        // Id to index in #stored_tracks_ for easier handling
-        std::map<int, size_t> id_to_track_;
+        // Index in #stored_tracks_ for every custom track id, negative if the track is not stored
+        std::vector<long> id_to_track_;
     };
 } // namespace allpix
 #endif /* TrackInfoManager_H */
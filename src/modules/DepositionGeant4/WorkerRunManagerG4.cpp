@@ -0,0 +1,80 @@
+/**
+ * @file
+ * @brief Implements a Geant4 worker run manager driven directly by the threads of the framework
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "WorkerRunManagerG4.hpp"
+
+#ifdef G4MULTITHREADED
+
+#include <G4Event.hh>
+#include <G4MTRunManager.hh>
+#include <G4Threading.hh>
+#include <G4UImanager.hh>
+#include <G4UserWorkerThreadInitialization.hh>
+#include <G4VUserPhysicsList.hh>
+#include <G4VUserPrimaryGeneratorAction.hh>
+#include <G4WorkerThread.hh>
+
+using namespace allpix;
+
+/**
+ * Follows the setup done by G4MTRunManagerKernel::StartThread for the threads spawned by Geant4, without entering the loop
+ * waiting for requests of the master.
+ */
+WorkerRunManagerG4* WorkerRunManagerG4::createForThread(int thread_id) {
+    auto* master_run_manager = G4MTRunManager::GetMasterRunManager();
+
+    // Register the calling thread as Geant4 worker, creating the thread-local output and UI manager
+    G4Threading::G4SetThreadId(thread_id);
+    G4UImanager::GetUIpointer()->SetUpForAThread(thread_id);
+
+    // Create a thread-local random engine of the same type as the master engine
+    master_run_manager->GetUserWorkerThreadInitialization()->SetupRNGEngine(master_run_manager->getMasterRandomEngine());
+
+    // Share the geometry and the physics tables of the master
+    G4WorkerThread::BuildGeometryAndPhysicsVector();
+
+    auto* run_manager = new WorkerRunManagerG4();
+    run_manager->G4RunManager::SetUserInitialization(
+        const_cast<G4VUserDetectorConstruction*>(master_run_manager->GetUserDetectorConstruction())); // NOLINT
+    run_manager->SetUserInitialization(const_cast<G4VUserPhysicsList*>(master_run_manager->GetUserPhysicsList())); // NOLINT
+    run_manager->Initialize();
+
+    // Apply the commands issued on the master before it was initialized
+    G4UImanager* ui_g4 = G4UImanager::GetUIpointer();
+    for(auto& command : master_run_manager->GetCommandStack()) {
+        ui_g4->ApplyCommand(command);
+    }
+
+    return run_manager;
+}
+
+G4Event* WorkerRunManagerG4::GenerateEvent(G4int) {
+    if(numberOfEventProcessed >= numberOfEventToBeProcessed || runAborted) {
+        eventLoopOnGoing = false;
+        return nullptr;
+    }
+
+    // NOTE The random engine of this thread is seeded by the caller before starting the run
+    auto* event = new G4Event(numberOfEventProcessed);
+    userPrimaryGeneratorAction->GeneratePrimaries(event);
+    return event;
+}
+
+void WorkerRunManagerG4::InitializeEventLoop(G4int n_event, const char* macro_file, G4int n_select) {
+    G4WorkerRunManager::InitializeEventLoop(n_event, macro_file, n_select);
+    eventLoopOnGoing = true;
+}
+
+void WorkerRunManagerG4::RunTermination() {
+    // Skip G4WorkerRunManager::RunTermination, which merges the run and waits for all Geant4 workers to finish
+    G4RunManager::RunTermination();
+}
+
+#endif /* G4MULTITHREADED */
@@ -0,0 +1,69 @@
+/**
+ * @file
+ * @brief Defines a Geant4 worker run manager driven directly by the threads of the framework
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_SIMPLE_DEPOSITION_MODULE_WORKER_RUN_MANAGER_H
+#define ALLPIX_SIMPLE_DEPOSITION_MODULE_WORKER_RUN_MANAGER_H
+
+#include <G4Types.hh>
+
+#ifdef G4MULTITHREADED
+
+#include <G4WorkerRunManager.hh>
+
+namespace allpix {
+    /**
+     * @brief Worker run manager processing events on the calling thread instead of a thread spawned by Geant4
+     *
+     * The master G4MTRunManager normally distributes the events and their seeds to worker threads it owns. Here the events
+     * are distributed by the framework instead: every framework thread running the deposition creates its own worker run
+     * manager, which shares the geometry and physics tables of the master and is seeded explicitly for every event. The
+     * synchronization with the master at the end of every run is skipped, as the master does not process any events.
+     */
+    class WorkerRunManagerG4 : public G4WorkerRunManager {
+    public:
+        /**
+         * @brief Create and initialize a worker run manager for the calling thread
+         * @param thread_id Geant4 identifier of the calling thread, has to be unique over all workers
+         * @return Pointer to the worker run manager, which is valid until the end of the calling thread
+         * @warning Should only be called after the master G4MTRunManager has been initialized
+         */
+        static WorkerRunManagerG4* createForThread(int thread_id);
+
+        /**
+         * @brief Generate the next event of the run without requesting seeds from the master
+         * @param i_event Unused, the events are counted by the worker itself
+         * @return Generated event or a null pointer if all events of the run have been processed
+         */
+        G4Event* GenerateEvent(G4int i_event) override;
+
+        /**
+         * @brief Initialize the event loop and mark it as ongoing
+         * @param n_event Number of events to process in the run
+         * @param macro_file Macro file to execute for every event
+         * @param n_select Number of events for which the macro is executed
+         *
+         * Marking the loop as ongoing allows to process events with ProcessOneEvent without entering DoEventLoop, which is
+         * used to keep a single run open over all events of the framework.
+         */
+        void InitializeEventLoop(G4int n_event, const char* macro_file = nullptr, G4int n_select = -1) override;
+
+        /**
+         * @brief Terminate the run without merging its results into the run of the master
+         */
+        void RunTermination() override;
+
+    private:
+        WorkerRunManagerG4() = default;
+    };
+} // namespace allpix
+
+#endif /* G4MULTITHREADED */
+
+#endif /* ALLPIX_SIMPLE_DEPOSITION_MODULE_WORKER_RUN_MANAGER_H */
@@ -0,0 +1,357 @@
+/**
+ * @file
+ * @brief Implementation of a module to record deposits to a library and to replay them from it
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "DepositionLibraryModule.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <cereal/types/array.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+
+#include "core/utils/file.h"
+#include "core/utils/log.h"
+#include "objects/DepositedCharge.hpp"
+#include "objects/MCParticle.hpp"
+#include "objects/MCTrack.hpp"
+
+using namespace allpix;
+
+namespace {
+    // Identifier and version of the library format written at the start of every file
+    const std::string library_magic = "Allpix Squared deposit library";
+    constexpr std::uint32_t library_version = 1;
+
+    template <typename T> std::array<double, 3> to_array(const T& point) { return {{point.x(), point.y(), point.z()}}; }
+    ROOT::Math::XYZPoint to_point(const std::array<double, 3>& array) {
+        return ROOT::Math::XYZPoint(array[0], array[1], array[2]);
+    }
+} // namespace
+
+DepositionLibraryModule::DepositionLibraryModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr)
+    : Module(config), messenger_(messenger), geo_mgr_(geo_mgr) {
+    // Set default values for the library
+    config_.setDefault("file_name", "deposits");
+    config_.setDefault("sampling", "sequential");
+    config_.setDefault("shift_range", ROOT::Math::XYZVector());
+
+    // Read the mode of the module
+    auto mode = config_.get<std::string>("mode");
+    std::transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
+    if(mode == "record") {
+        mode_ = LibraryMode::RECORD;
+    } else if(mode == "replay") {
+        mode_ = LibraryMode::REPLAY;
+    } else {
+        throw InvalidValueError(config_, "mode", "Invalid library mode, only 'record' and 'replay' are supported.");
+    }
+
+    // Read the sampling of the library events
+    auto sampling = config_.get<std::string>("sampling");
+    std::transform(sampling.begin(), sampling.end(), sampling.begin(), ::tolower);
+    if(sampling == "sequential") {
+        sampling_ = SamplingMode::SEQUENTIAL;
+    } else if(sampling == "random") {
+        sampling_ = SamplingMode::RANDOM;
+    } else {
+        throw InvalidValueError(
+            config_, "sampling", "Invalid sampling of the library, only 'sequential' and 'random' are supported.");
+    }
+
+    shift_range_ = config_.get<ROOT::Math::XYZVector>("shift_range");
+    if(shift_range_.x() < 0 || shift_range_.y() < 0 || shift_range_.z() < 0) {
+        throw InvalidValueError(config_, "shift_range", "shift range cannot be negative");
+    }
+
+    if(mode_ == LibraryMode::RECORD) {
+        // Bind to all deposits and particles of all detectors and to the tracks of the event
+        messenger_->bindMulti<DepositedChargeMessage>(this, MsgFlags::OPTIONAL);
+        messenger_->bindMulti<MCParticleMessage>(this, MsgFlags::OPTIONAL);
+        messenger_->bindSingle<MCTrackMessage>(this, MsgFlags::OPTIONAL);
+    } else {
+        // The library is only read during replay, which allows to replay multiple events at the same time
+        enable_parallelization();
+    }
+}
+
+void DepositionLibraryModule::init() {
+    if(mode_ == LibraryMode::RECORD) {
+        // Create the library file and write the header
+        auto file_name = createOutputFile(allpix::add_file_extension(config_.get<std::string>("file_name"), "apd"), true);
+        output_file_ = std::make_unique<std::ofstream>(file_name, std::ios::out | std::ios::binary);
+        if(!output_file_->good()) {
+            throw ModuleError("Cannot open deposit library file '" + file_name + "' for writing");
+        }
+        output_archive_ = std::make_unique<cereal::PortableBinaryOutputArchive>(*output_file_);
+        (*output_archive_)(library_magic, library_version);
+        LOG(STATUS) << "Recording deposits to library " << file_name;
+        return;
+    }
+
+    // Read all events of the library
+    auto file_name = config_.getPathWithExtension("file_name", "apd", true);
+    std::ifstream file(file_name, std::ios::in | std::ios::binary);
+    if(!file.good()) {
+        throw InvalidValueError(config_, "file_name", "cannot open deposit library file");
+    }
+    try {
+        cereal::PortableBinaryInputArchive archive(file);
+        std::string magic;
+        std::uint32_t version = 0;
+        archive(magic, version);
+        if(magic != library_magic || version != library_version) {
+            throw InvalidValueError(config_, "file_name", "file is not a deposit library of a supported version");
+        }
+
+        bool has_event = false;
+        archive(has_event);
+        while(has_event) {
+            EventRecord record;
+            archive(record);
+            library_.push_back(std::move(record));
+            archive(has_event);
+        }
+    } catch(cereal::Exception& e) {
+        throw InvalidValueError(config_, "file_name", "deposit library is truncated or corrupted: " + std::string(e.what()));
+    }
+    if(library_.empty()) {
+        throw InvalidValueError(config_, "file_name", "deposit library does not contain any event");
+    }
+
+    // Find all detectors referred to by the library
+    for(auto& record : library_) {
+        for(auto& detector_record : record.detectors) {
+            if(detectors_.find(detector_record.name) != detectors_.end()) {
+                continue;
+            }
+            if(!geo_mgr_->hasDetector(detector_record.name)) {
+                throw InvalidValueError(
+                    config_, "file_name", "deposit library contains unknown detector '" + detector_record.name + "'");
+            }
+            detectors_[detector_record.name] = geo_mgr_->getDetector(detector_record.name);
+        }
+    }
+
+    LOG(STATUS) << "Read " << library_.size() << " events for " << detectors_.size() << " detector(s) from deposit library "
+                << file_name;
+}
+
+void DepositionLibraryModule::run(Event* event) {
+    if(mode_ == LibraryMode::RECORD) {
+        record_event(event);
+        return;
+    }
+
+    // Select the library event to replay
+    size_t index = 0;
+    if(sampling_ == SamplingMode::SEQUENTIAL) {
+        index = (event->getNumber() - 1) % library_.size();
+    } else {
+        index = std::uniform_int_distribution<size_t>(0, library_.size() - 1)(event->getRandomEngine());
+    }
+
+    // Draw the offset of the event within the configured range
+    auto random_shift = [&](double range) {
+        return range > 0 ? std::uniform_real_distribution<double>(-range / 2, range / 2)(event->getRandomEngine()) : 0.;
+    };
+    auto shift_x = random_shift(shift_range_.x());
+    auto shift_y = random_shift(shift_range_.y());
+    auto shift_z = random_shift(shift_range_.z());
+    ROOT::Math::XYZVector shift(shift_x, shift_y, shift_z);
+
+    LOG(DEBUG) << "Replaying library event " << index << " shifted by " << Units::display(shift, {"um", "mm"});
+    replay_event(event, library_[index], shift);
+}
+
+void DepositionLibraryModule::record_event(Event* event) {
+    EventRecord record;
+
+    // Store all tracks, indexed by their position in the message
+    std::unordered_map<const MCTrack*, std::int64_t> track_index;
+    auto track_message = messenger_->fetchMessage<MCTrackMessage>(this, event);
+    if(track_message != nullptr) {
+        const auto& tracks = track_message->getData();
+        for(size_t i = 0; i < tracks.size(); ++i) {
+            track_index[&tracks[i]] = static_cast<std::int64_t>(i);
+        }
+        for(const auto& track : tracks) {
+            auto parent = track_index.find(track.getParent());
+            record.tracks.push_back({to_array(track.getStartPoint()),
+                                     to_array(track.getEndPoint()),
+                                     track.getOriginatingVolumeName(),
+                                     track.getCreationProcessName(),
+                                     track.getCreationProcessType(),
+                                     track.getParticleID(),
+                                     {{track.getKineticEnergyInitial(),
+                                       track.getKineticEnergyFinal(),
+                                       track.getTotalEnergyInitial(),
+                                       track.getTotalEnergyFinal()}},
+                                     parent != track_index.end() ? parent->second : -1});
+        }
+    }
+
+    // Store the particles of every detector, indexed by their position in the message of the detector
+    std::unordered_map<const MCParticle*, std::pair<size_t, std::int64_t>> particle_index;
+    for(const auto& message : messenger_->fetchMultiMessage<MCParticleMessage>(this, event)) {
+        DetectorRecord detector_record;
+        detector_record.name = message->getDetector()->getName();
+        const auto& particles = message->getData();
+        for(size_t i = 0; i < particles.size(); ++i) {
+            particle_index[&particles[i]] = std::make_pair(record.detectors.size(), static_cast<std::int64_t>(i));
+        }
+        for(const auto& particle : particles) {
+            // Parents are only kept within the same detector
+            auto parent = particle_index.find(particle.getParent());
+            auto track = track_index.find(particle.getTrack());
+            detector_record.particles.push_back(
+                {to_array(particle.getGlobalStartPoint()),
+                 to_array(particle.getGlobalEndPoint()),
+                 particle.getParticleID(),
+                 particle.getTime(),
+                 (parent != particle_index.end() && parent->second.first == record.detectors.size() ? parent->second.second
+                                                                                                    : -1),
+                 track != track_index.end() ? track->second : -1});
+        }
+        record.detectors.push_back(std::move(detector_record));
+    }
+
+    // Store the deposits with the detector of the particle they originate from
+    for(const auto& message : messenger_->fetchMultiMessage<DepositedChargeMessage>(this, event)) {
+        auto name = message->getDetector()->getName();
+        auto detector_record = std::find_if(record.detectors.begin(),
+                                            record.detectors.end(),
+                                            [&](const DetectorRecord& det_record) { return det_record.name == name; });
+        if(detector_record == record.detectors.end()) {
+            record.detectors.push_back({name, {}, {}});
+            detector_record = std::prev(record.detectors.end());
+        }
+
+        for(const auto& deposit : message->getData()) {
+            auto particle = particle_index.find(deposit.getMCParticle());
+            detector_record->deposits.push_back({to_array(deposit.getGlobalPosition()),
+                                                 static_cast<std::int8_t>(deposit.getType()),
+                                                 deposit.getCharge(),
+                                                 deposit.getEventTime(),
+                                                 particle != particle_index.end() ? particle->second.second : -1});
+        }
+        deposits_cnt_ += message->getData().size();
+    }
+
+    // Write the event to the library
+    (*output_archive_)(true, record);
+    events_cnt_++;
+    LOG(DEBUG) << "Recorded " << record.tracks.size() << " tracks and the deposits in " << record.detectors.size()
+               << " detector(s) to the library";
+}
+
+void DepositionLibraryModule::replay_event(Event* event,
+                                           const EventRecord& record,
+                                           const ROOT::Math::XYZVector& shift) {
+    // Recreate the tracks and restore the links to their parents
+    auto tracks = MessageStorage<MCTrack>::acquire();
+    tracks.reserve(record.tracks.size());
+    for(const auto& track : record.tracks) {
+        tracks.emplace_back(to_point(track.start) + shift,
+                            to_point(track.end) + shift,
+                            track.volume,
+                            track.process_name,
+                            track.process_type,
+                            track.particle_id,
+                            track.energies[0],
+                            track.energies[1],
+                            track.energies[2],
+                            track.energies[3]);
+    }
+    for(size_t i = 0; i < tracks.size(); ++i) {
+        if(record.tracks[i].parent >= 0) {
+            tracks[i].setParent(&tracks[static_cast<size_t>(record.tracks[i].parent)]);
+        }
+    }
+    auto track_message = std::make_shared<MCTrackMessage>(std::move(tracks));
+
+    // The data of the message is stable after construction, the particles can refer to it
+    const auto& message_tracks = track_message->getData();
+    for(const auto& detector_record : record.detectors) {
+        auto detector = detectors_.at(detector_record.name);
+
+        // Recreate the particles in the local coordinates of the detector
+        auto particles = MessageStorage<MCParticle>::acquire();
+        particles.reserve(detector_record.particles.size());
+        for(const auto& particle : detector_record.particles) {
+            auto start = to_point(particle.start) + shift;
+            auto end = to_point(particle.end) + shift;
+            particles.emplace_back(detector->getLocalPosition(start),
+                                   start,
+                                   detector->getLocalPosition(end),
+                                   end,
+                                   particle.particle_id,
+                                   particle.time);
+        }
+        for(size_t i = 0; i < particles.size(); ++i) {
+            const auto& particle = detector_record.particles[i];
+            if(particle.parent >= 0) {
+                particles[i].setParent(&particles[static_cast<size_t>(particle.parent)]);
+            }
+            if(particle.track >= 0) {
+                particles[i].setTrack(&message_tracks[static_cast<size_t>(particle.track)]);
+            }
+        }
+        auto particle_message = std::make_shared<MCParticleMessage>(std::move(particles), detector);
+
+        // Recreate the deposits, discarding those shifted outside of the sensor
+        const auto& message_particles = particle_message->getData();
+        auto deposits = MessageStorage<DepositedCharge>::acquire();
+        deposits.reserve(detector_record.deposits.size());
+        for(const auto& deposit : detector_record.deposits) {
+            auto global_position = to_point(deposit.position) + shift;
+            auto local_position = detector->getLocalPosition(global_position);
+            if(!detector->isWithinSensor(local_position)) {
+                discarded_cnt_++;
+                continue;
+            }
+            deposits.emplace_back(local_position,
+                                  global_position,
+                                  static_cast<CarrierType>(deposit.type),
+                                  deposit.charge,
+                                  deposit.time,
+                                  deposit.particle >= 0 ? &message_particles[static_cast<size_t>(deposit.particle)]
+                                                        : nullptr);
+        }
+        deposits_cnt_ += deposits.size();
+
+        LOG(DEBUG) << "Replaying " << deposits.size() << " deposits and " << message_particles.size()
+                   << " particles in detector " << detector->getName();
+        messenger_->dispatchMessage(this, particle_message, event);
+        messenger_->dispatchMessage(this, std::make_shared<DepositedChargeMessage>(std::move(deposits), detector), event);
+    }
+    messenger_->dispatchMessage(this, track_message, event);
+    events_cnt_++;
+}
+
+void DepositionLibraryModule::finalize() {
+    if(mode_ == LibraryMode::RECORD) {
+        // Mark the end of the library and close the file
+        (*output_archive_)(false);
+        output_archive_.reset();
+        output_file_->close();
+        LOG(STATUS) << "Recorded " << events_cnt_ << " events with " << deposits_cnt_ << " deposits to the library";
+        return;
+    }
+
+    LOG(STATUS) << "Replayed " << events_cnt_ << " events with " << deposits_cnt_ << " deposits from a library of "
+                << library_.size() << " events";
+    if(discarded_cnt_ > 0) {
+        LOG(INFO) << "Discarded " << discarded_cnt_ << " deposits shifted outside of the sensor";
+    }
+}
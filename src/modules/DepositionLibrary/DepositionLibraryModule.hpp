@@ -0,0 +1,184 @@
+/**
+ * @file
+ * @brief Definition of a module to record deposits to a library and to replay them from it
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Math/Point3D.h>
+#include <Math/Vector3D.h>
+
+#include <cereal/archives/portable_binary.hpp>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/Module.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to record the deposited charges of every event to a library and to replay them from it
+     *
+     * In record mode, all DepositedCharge, MCParticle and MCTrack objects of every event are stored in a compact binary
+     * library file. In replay mode, the events of such a library are dispatched again instead of simulating the deposition,
+     * either sequentially or by randomly sampling the library, and optionally shifted by a random offset.
+     */
+    class DepositionLibraryModule : public Module {
+        /**
+         * @brief Mode of the module
+         */
+        enum class LibraryMode {
+            RECORD = 0, ///< Store the deposits of every event in the library
+            REPLAY,     ///< Dispatch the deposits stored in the library
+        };
+
+        /**
+         * @brief Order in which the events of the library are replayed
+         */
+        enum class SamplingMode {
+            SEQUENTIAL = 0, ///< Replay the events in the order they were recorded
+            RANDOM,         ///< Replay randomly selected events of the library
+        };
+
+    public:
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param geo_mgr Pointer to the geometry manager, containing the detectors
+         */
+        DepositionLibraryModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr);
+
+        /**
+         * @brief Open the library file for writing or read all events from it
+         */
+        void init() override;
+
+        /**
+         * @brief Store the deposits of the event in the library or dispatch the deposits of a library event
+         * @param event Pointer to the event
+         */
+        void run(Event* event) override;
+
+        /**
+         * @brief Close the library file and output a summary
+         */
+        void finalize() override;
+
+    private:
+        /**
+         * @brief Compact representation of a MCTrack
+         */
+        struct TrackRecord {
+            std::array<double, 3> start;
+            std::array<double, 3> end;
+            std::string volume;
+            std::string process_name;
+            int process_type;
+            int particle_id;
+            std::array<double, 4> energies;
+            std::int64_t parent;
+
+            template <class Archive> void serialize(Archive& archive) {
+                archive(start, end, volume, process_name, process_type, particle_id, energies, parent);
+            }
+        };
+
+        /**
+         * @brief Compact representation of a MCParticle, only storing global coordinates
+         */
+        struct ParticleRecord {
+            std::array<double, 3> start;
+            std::array<double, 3> end;
+            int particle_id;
+            double time;
+            std::int64_t parent;
+            std::int64_t track;
+
+            template <class Archive> void serialize(Archive& archive) {
+                archive(start, end, particle_id, time, parent, track);
+            }
+        };
+
+        /**
+         * @brief Compact representation of a DepositedCharge, only storing global coordinates
+         */
+        struct DepositRecord {
+            std::array<double, 3> position;
+            std::int8_t type;
+            unsigned int charge;
+            double time;
+            std::int64_t particle;
+
+            template <class Archive> void serialize(Archive& archive) { archive(position, type, charge, time, particle); }
+        };
+
+        /**
+         * @brief All particles and deposits of a single detector in a library event
+         */
+        struct DetectorRecord {
+            std::string name;
+            std::vector<ParticleRecord> particles;
+            std::vector<DepositRecord> deposits;
+
+            template <class Archive> void serialize(Archive& archive) { archive(name, particles, deposits); }
+        };
+
+        /**
+         * @brief Single event of the library
+         */
+        struct EventRecord {
+            std::vector<TrackRecord> tracks;
+            std::vector<DetectorRecord> detectors;
+
+            template <class Archive> void serialize(Archive& archive) { archive(tracks, detectors); }
+        };
+
+        /**
+         * @brief Convert the received messages of an event to a library record and write it to the file
+         * @param event Pointer to the event
+         */
+        void record_event(Event* event);
+
+        /**
+         * @brief Dispatch the messages of a library event, shifted by the given offset
+         * @param event Pointer to the event
+         * @param record Library event to dispatch
+         * @param shift Offset in global coordinates applied to all positions
+         */
+        void replay_event(Event* event, const EventRecord& record, const ROOT::Math::XYZVector& shift);
+
+        Messenger* messenger_;
+        GeometryManager* geo_mgr_;
+
+        LibraryMode mode_;
+        SamplingMode sampling_;
+        ROOT::Math::XYZVector shift_range_;
+
+        // Library file and archive the events are written to in record mode
+        std::unique_ptr<std::ofstream> output_file_;
+        std::unique_ptr<cereal::PortableBinaryOutputArchive> output_archive_;
+
+        // Events read from the library and the detectors they refer to in replay mode
+        std::vector<EventRecord> library_;
+        std::map<std::string, std::shared_ptr<Detector>> detectors_;
+
+        // Statistics
+        std::atomic<unsigned long> events_cnt_{};
+        std::atomic<unsigned long> deposits_cnt_{};
+        std::atomic<unsigned long> discarded_cnt_{};
+    };
+} // namespace allpix
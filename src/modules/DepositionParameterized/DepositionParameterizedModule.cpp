@@ -0,0 +1,252 @@
+/**
+ * @file
+ * @brief Implementation of a module to deposit charges along straight tracks with parameterized energy loss
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "DepositionParameterizedModule.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <utility>
+
+#include <Math/QuantFuncMathCore.h>
+
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+namespace {
+    // Most probable value of the standard Landau distribution
+    constexpr double landau_mpv = -0.22278298;
+} // namespace
+
+DepositionParameterizedModule::DepositionParameterizedModule(Configuration& config,
+                                                             Messenger* messenger,
+                                                             GeometryManager* geo_mgr)
+    : Module(config), messenger_(messenger), geo_mgr_(geo_mgr) {
+    // Enable parallelization of this module if multithreading is enabled
+    enable_parallelization();
+
+    // Set default values for the beam and the charge creation
+    config_.setDefault("beam_direction", ROOT::Math::XYZVector(0, 0, 1));
+    config_.setDefault("beam_size", 0.);
+    config_.setDefault("number_of_particles", 1);
+    config_.setDefault("particle_code", 211);
+    config_.setDefault("max_step_length", Units::get(1.0, "um"));
+    config_.setDefault("charge_creation_energy", Units::get(3.64, "eV"));
+    config_.setDefault("fano_factor", 0.115);
+
+    source_position_ = config_.get<ROOT::Math::XYZPoint>("source_position");
+    beam_direction_ = config_.get<ROOT::Math::XYZVector>("beam_direction");
+    if(beam_direction_.Mag2() <= 0) {
+        throw InvalidValueError(config_, "beam_direction", "beam direction cannot be a null vector");
+    }
+    beam_direction_ = beam_direction_.Unit();
+
+    // Construct two axes perpendicular to the beam to spread the tracks
+    auto helper = std::fabs(beam_direction_.z()) < 0.9 ? ROOT::Math::XYZVector(0, 0, 1) : ROOT::Math::XYZVector(1, 0, 0);
+    beam_axis_u_ = beam_direction_.Cross(helper).Unit();
+    beam_axis_v_ = beam_direction_.Cross(beam_axis_u_);
+
+    beam_size_ = config_.get<double>("beam_size");
+    number_of_particles_ = config_.get<unsigned int>("number_of_particles");
+    particle_code_ = config_.get<int>("particle_code");
+
+    max_step_length_ = config_.get<double>("max_step_length");
+    if(max_step_length_ <= 0) {
+        throw InvalidValueError(config_, "max_step_length", "maximum step length should be positive");
+    }
+    charge_creation_energy_ = config_.get<double>("charge_creation_energy");
+    fano_factor_ = config_.get<double>("fano_factor");
+
+    // Energy loss parameters of silicon: factor K/2 * Z/A * rho of the Landau width and plasma energy
+    xi_per_length_ = Units::get(0.17825, "MeV/cm");
+    auto plasma_energy = Units::get(31.05, "eV");
+    mpv_scale_ = 2 * Units::get(0.51099895, "MeV") / (plasma_energy * plasma_energy);
+
+    // Speed of light to calculate the time of the deposits along the track
+    speed_of_light_ = Units::get(299.792458, "mm/ns");
+}
+
+void DepositionParameterizedModule::init() {
+    detectors_ = geo_mgr_->getDetectors();
+    for(size_t idx = 0; idx < detectors_.size(); ++idx) {
+        detector_indices_[detectors_[idx].get()] = idx;
+    }
+
+    auto min_point = geo_mgr_->getMinimumCoordinate();
+    auto max_point = geo_mgr_->getMaximumCoordinate();
+    for(size_t corner = 0; corner < 8; ++corner) {
+        geometry_corners_.emplace_back((corner & 1) != 0 ? max_point.x() : min_point.x(),
+                                       (corner & 2) != 0 ? max_point.y() : min_point.y(),
+                                       (corner & 4) != 0 ? max_point.z() : min_point.z());
+    }
+
+    // The most probable energy loss of a minimum ionizing particle for the full sensor thickness of every detector
+    for(auto& detector : detectors_) {
+        auto thickness = detector->getModel()->getSensorSize().z();
+        auto xi = xi_per_length_ * thickness;
+        auto mpv = xi * (std::log(mpv_scale_ * xi) + 0.2);
+        LOG(DEBUG) << "Most probable energy loss at normal incidence in detector " << detector->getName() << ": "
+                   << Units::display(mpv, {"keV"});
+    }
+}
+
+void DepositionParameterizedModule::run(Event* event) {
+    // Generate the starting points of all tracks, spread perpendicular to the beam direction
+    std::vector<ROOT::Math::XYZPoint> track_origins;
+    track_origins.reserve(number_of_particles_);
+    for(unsigned int i = 0; i < number_of_particles_; ++i) {
+        auto position = source_position_;
+        if(beam_size_ > 0) {
+            std::normal_distribution<double> beam_profile(0, beam_size_);
+            auto shift_u = beam_profile(event->getRandomEngine());
+            auto shift_v = beam_profile(event->getRandomEngine());
+            position += shift_u * beam_axis_u_ + shift_v * beam_axis_v_;
+        }
+        track_origins.push_back(position);
+    }
+    total_tracks_ += number_of_particles_;
+
+    // Look up the detectors crossed by every track in the spatial index of the geometry, limiting the tracks to the box
+    // enclosing all detectors. Tracks missing a detector do not draw random numbers, such that the deposits are the same as
+    // when intersecting all tracks with all detectors.
+    std::vector<std::vector<size_t>> detector_tracks(detectors_.size());
+    for(size_t track = 0; track < track_origins.size(); ++track) {
+        const auto& origin = track_origins[track];
+        double length = 0;
+        for(auto& corner : geometry_corners_) {
+            length = std::max(length, (corner - origin).R());
+        }
+        for(auto& detector : geo_mgr_->getDetectorsAlong(origin, origin + length * beam_direction_)) {
+            detector_tracks[detector_indices_.at(detector.get())].push_back(track);
+        }
+    }
+
+    for(size_t idx = 0; idx < detectors_.size(); ++idx) {
+        if(detector_tracks[idx].empty()) {
+            continue;
+        }
+        auto& detector = detectors_[idx];
+
+        // Reserve all particles in advance, the deposited charges refer to them
+        auto mcparticles = MessageStorage<MCParticle>::acquire();
+        auto charges = MessageStorage<DepositedCharge>::acquire();
+        mcparticles.reserve(number_of_particles_);
+
+        unsigned int detector_charges = 0;
+        for(auto track : detector_tracks[idx]) {
+            detector_charges +=
+                deposit_track(event, detector, track_origins[track], beam_direction_, mcparticles, charges);
+        }
+        if(mcparticles.empty()) {
+            continue;
+        }
+        total_charges_ += detector_charges;
+        LOG(DEBUG) << "Deposited " << detector_charges << " charges in sensor of detector " << detector->getName();
+
+        // Dispatch the messages to the framework
+        auto deposit_message = std::make_shared<DepositedChargeMessage>(std::move(charges), detector);
+        auto mcparticle_message = std::make_shared<MCParticleMessage>(std::move(mcparticles), detector);
+        messenger_->dispatchMessage(this, deposit_message, event);
+        messenger_->dispatchMessage(this, mcparticle_message, event);
+    }
+}
+
+unsigned int DepositionParameterizedModule::deposit_track(Event* event,
+                                                          const std::shared_ptr<Detector>& detector,
+                                                          const ROOT::Math::XYZPoint& position,
+                                                          const ROOT::Math::XYZVector& direction,
+                                                          std::vector<MCParticle>& particles,
+                                                          std::vector<DepositedCharge>& charges) {
+    auto model = detector->getModel();
+
+    // Transform the track to the local coordinates of the detector
+    auto local_position = detector->getLocalPosition(position);
+    auto local_direction = detector->getLocalPosition(position + direction) - local_position;
+
+    // Intersect the track with the sensor box, parameterized by the distance along the track
+    auto lower = model->getSensorCenter() - model->getSensorSize() / 2.0;
+    auto upper = model->getSensorCenter() + model->getSensorSize() / 2.0;
+    double enter = 0;
+    double exit = std::numeric_limits<double>::max();
+    auto intersect = [&](double pos, double dir, double low, double high) {
+        if(std::fabs(dir) < std::numeric_limits<double>::epsilon()) {
+            return pos >= low && pos <= high;
+        }
+        auto first = (low - pos) / dir;
+        auto second = (high - pos) / dir;
+        enter = std::max(enter, std::min(first, second));
+        exit = std::min(exit, std::max(first, second));
+        return enter < exit;
+    };
+    if(!intersect(local_position.x(), local_direction.x(), lower.x(), upper.x()) ||
+       !intersect(local_position.y(), local_direction.y(), lower.y(), upper.y()) ||
+       !intersect(local_position.z(), local_direction.z(), lower.z(), upper.z())) {
+        return 0;
+    }
+
+    // Create the particle traversing the sensor
+    auto start_local = local_position + enter * local_direction;
+    auto end_local = local_position + exit * local_direction;
+    particles.emplace_back(start_local,
+                           detector->getGlobalPosition(start_local),
+                           end_local,
+                           detector->getGlobalPosition(end_local),
+                           particle_code_,
+                           enter / speed_of_light_);
+    LOG(TRACE) << "Generated MCParticle with start " << Units::display(start_local, {"um", "mm"}) << " and end "
+               << Units::display(end_local, {"um", "mm"}) << " in detector " << detector->getName();
+
+    // Split the path into equal steps and sample the energy loss of every step from the Landau distribution
+    auto length = exit - enter;
+    auto steps = static_cast<unsigned int>(std::ceil(length / max_step_length_));
+    auto step_length = length / steps;
+    unsigned int deposited_charges = 0;
+    for(unsigned int i = 0; i < steps; ++i) {
+        auto distance = enter + (i + 0.5) * step_length;
+        auto edep = sample_energy_loss(event, step_length);
+
+        // Calculate number of electron hole pairs produced, taking into account fluctuations via the Fano factor
+        auto mean_charge = static_cast<unsigned int>(edep / charge_creation_energy_);
+        std::normal_distribution<double> charge_fluctuation(mean_charge, std::sqrt(mean_charge * fano_factor_));
+        auto charge = static_cast<unsigned int>(std::max(charge_fluctuation(event->getRandomEngine()), 0.));
+        if(charge == 0) {
+            continue;
+        }
+
+        auto deposit_local = local_position + distance * local_direction;
+        auto deposit_global = detector->getGlobalPosition(deposit_local);
+        auto time = distance / speed_of_light_;
+        charges.emplace_back(deposit_local, deposit_global, CarrierType::ELECTRON, charge, time, &(particles.back()));
+        charges.emplace_back(deposit_local, deposit_global, CarrierType::HOLE, charge, time, &(particles.back()));
+        deposited_charges += charge;
+    }
+
+    return deposited_charges;
+}
+
+/**
+ * The energy loss follows a Landau distribution with width \f$\xi\f$ proportional to the step length and most probable
+ * value \f$\Delta_p = \xi \left[\ln(2 m_e c^2 \xi / (\hbar\omega_p)^2) + 0.2\right]\f$, valid for minimum ionizing particles
+ * where the density effect saturates. The Landau distribution is stable, the sum of the steps of a track therefore follows
+ * the distribution of the total path length.
+ */
+double DepositionParameterizedModule::sample_energy_loss(Event* event, double length) const {
+    auto xi = xi_per_length_ * length;
+    auto mpv = xi * (std::log(mpv_scale_ * xi) + 0.2);
+
+    auto quantile = std::uniform_real_distribution<double>(std::numeric_limits<double>::min(), 1.)(event->getRandomEngine());
+    auto lambda = ROOT::Math::landau_quantile(quantile, 1.);
+    return std::max(mpv + xi * (lambda - landau_mpv), 0.);
+}
+
+void DepositionParameterizedModule::finalize() {
+    LOG(INFO) << "Deposited total of " << total_charges_ << " charges along " << total_tracks_ << " tracks";
+}
@@ -0,0 +1,118 @@
+/**
+ * @file
+ * @brief Definition of a module to deposit charges along straight tracks with parameterized energy loss
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Math/Point3D.h>
+#include <Math/Vector3D.h>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/Module.hpp"
+#include "objects/DepositedCharge.hpp"
+#include "objects/MCParticle.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to deposit charges along straight tracks through all detectors without a full particle transport
+     *
+     * Straight tracks are generated from a beam and intersected with the sensors of all detectors. The energy loss along
+     * the path through every sensor is sampled in steps from the Landau distribution of a minimum ionizing particle in
+     * silicon and converted to electron-hole pairs.
+     */
+    class DepositionParameterizedModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param geo_mgr Pointer to the geometry manager, containing the detectors
+         */
+        DepositionParameterizedModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr);
+
+        /**
+         * @brief Fetch the detectors and calculate the parameters of the energy loss
+         */
+        void init() override;
+
+        /**
+         * @brief Deposit charge carriers along the tracks of every event
+         * @param event Pointer to the event
+         */
+        void run(Event* event) override;
+
+        /**
+         * @brief Output summary of the deposited charges
+         */
+        void finalize() override;
+
+    private:
+        /**
+         * @brief Deposit the charge carriers along a track through a single detector
+         * @param event Pointer to the event
+         * @param detector Detector to deposit the charges in
+         * @param position Starting position of the track in global coordinates
+         * @param direction Unit direction of the track in global coordinates
+         * @param particles List of particles to add the particle of the track to
+         * @param charges List of deposited charges to add the charges along the track to
+         * @return Number of charges deposited in the detector
+         */
+        unsigned int deposit_track(Event* event,
+                                   const std::shared_ptr<Detector>& detector,
+                                   const ROOT::Math::XYZPoint& position,
+                                   const ROOT::Math::XYZVector& direction,
+                                   std::vector<MCParticle>& particles,
+                                   std::vector<DepositedCharge>& charges);
+
+        /**
+         * @brief Sample the energy lost in a step of the track
+         * @param event Pointer to the event
+         * @param length Length of the step
+         * @return Energy deposited in the step
+         */
+        double sample_energy_loss(Event* event, double length) const;
+
+        Messenger* messenger_;
+        GeometryManager* geo_mgr_;
+
+        std::vector<std::shared_ptr<Detector>> detectors_;
+        std::map<const Detector*, size_t> detector_indices_;
+
+        // Corners of the box enclosing the full geometry, to limit the length of the tracks looked up in the geometry
+        std::vector<ROOT::Math::XYZPoint> geometry_corners_;
+
+        // Parameters of the beam
+        ROOT::Math::XYZPoint source_position_;
+        ROOT::Math::XYZVector beam_direction_;
+        ROOT::Math::XYZVector beam_axis_u_, beam_axis_v_;
+        double beam_size_{};
+        unsigned int number_of_particles_{};
+        int particle_code_{};
+
+        // Parameters of the energy loss and charge creation
+        double max_step_length_{};
+        double xi_per_length_{};
+        double mpv_scale_{};
+        double speed_of_light_{};
+        double charge_creation_energy_{};
+        double fano_factor_{};
+
+        // Statistics
+        std::atomic<unsigned long long> total_charges_{};
+        std::atomic<unsigned long long> total_tracks_{};
+    };
+} // namespace allpix
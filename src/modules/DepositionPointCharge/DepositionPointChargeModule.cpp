@@ -9,6 +9,7 @@
 
 #include "DepositionPointChargeModule.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <string>
 #include <utility>
@@ -81,7 +82,35 @@ void DepositionPointChargeModule::init() {
     }
 
     // Set up the different scan methods
-    if(model_ == DepositionModel::SCAN) {
+    if(model_ == DepositionModel::SCAN && config_.has("scan_grid")) {
+        // Scan the full grid of positions in every event, points require a 3D grid and MIPs only a 2D grid:
+        auto grid = config_.getArray<unsigned int>("scan_grid");
+        if(grid.size() != 3 && !(grid.size() == 2 && type_ == SourceType::MIP)) {
+            throw InvalidValueError(config_, "scan_grid", "expecting the number of positions in x, y and z");
+        }
+        if(type_ == SourceType::MIP) {
+            grid.resize(3);
+            grid[2] = 1;
+        }
+        if(std::find(grid.begin(), grid.end(), 0u) != grid.end()) {
+            throw InvalidValueError(config_, "scan_grid", "number of positions should be strictly positive");
+        }
+
+        voxel_scan_ = ROOT::Math::XYZVector(
+            model->getPixelSize().x() / grid[0], model->getPixelSize().y() / grid[1], model->getSensorSize().z() / grid[2]);
+        scan_positions_.reserve(grid[0] * grid[1] * grid[2]);
+        for(unsigned int z = 0; z < grid[2]; ++z) {
+            for(unsigned int y = 0; y < grid[1]; ++y) {
+                for(unsigned int x = 0; x < grid[0]; ++x) {
+                    scan_positions_.push_back(
+                        ROOT::Math::XYZPoint(voxel_scan_.x() * x, voxel_scan_.y() * y, voxel_scan_.z() * z) +
+                        scan_reference());
+                }
+            }
+        }
+        LOG(INFO) << "Voxel size for scan of pixel volume: " << Units::display(voxel_scan_, {"um", "mm"}) << ", scanning "
+                  << scan_positions_.size() << " positions in every event";
+    } else if(model_ == DepositionModel::SCAN) {
         // Get the config manager and retrieve total number of events:
         ConfigManager* conf_manager = getConfigManager();
         auto events = conf_manager->getGlobalConfiguration().get<unsigned int>("number_of_events");
@@ -110,10 +139,17 @@ void DepositionPointChargeModule::init() {
     }
 }
 
+ROOT::Math::XYZVector DepositionPointChargeModule::scan_reference() const {
+    // Center the volume to be scanned in the center of the sensor,
+    // reference point is lower left corner of one pixel volume
+    auto model = detector_->getModel();
+    return model->getGridSize() / 2.0 -
+           ROOT::Math::XYZVector(model->getPixelSize().x(), model->getPixelSize().y(), model->getSensorSize().z() / 2.0);
+}
+
 void DepositionPointChargeModule::run(unsigned int event) {
 
     ROOT::Math::XYZPoint position;
-    auto model = detector_->getModel();
 
     auto get_position = [&]() {
         if(config_.getArray<double>("position").size() == 2) {
@@ -127,18 +163,15 @@ void DepositionPointChargeModule::run(unsigned int event) {
     if(model_ == DepositionModel::FIXED) {
         // Fixed position as read from the configuration:
         position = get_position();
-    } else if(model_ == DepositionModel::SCAN) {
-        // Center the volume to be scanned in the center of the sensor,
-        // reference point is lower left corner of one pixel volume
-        auto ref =
-            model->getGridSize() / 2.0 -
-            ROOT::Math::XYZVector(model->getPixelSize().x(), model->getPixelSize().y(), model->getSensorSize().z() / 2.0);
+    } else if(model_ == DepositionModel::SCAN && scan_positions_.empty()) {
+        // Position of this event in the scan
+        auto ref = scan_reference();
         LOG(DEBUG) << "Reference: " << ref;
         position = ROOT::Math::XYZPoint(voxel_.x() * ((event - 1) % root_),
                                         voxel_.y() * (((event - 1) / root_) % root_),
                                         voxel_.z() * (((event - 1) / root_ / root_) % root_)) +
                    ref;
-    } else {
+    } else if(model_ == DepositionModel::SPOT) {
         // Calculate random offset from configured position
         auto shift = [&](auto size) {
             double dx = std::normal_distribution<double>(0, size)(random_generator_);
@@ -151,19 +184,42 @@ void DepositionPointChargeModule::run(unsigned int event) {
         position = get_position() + shift(config_.get<double>("spot_size"));
     }
 
-    // Create charge carriers at requested position
-    if(type_ == SourceType::MIP) {
-        DepositLine(position);
+    // Vector of deposited charges and their "MCParticle", the particles are referenced and should not be reallocated
+    auto charges = MessageStorage<DepositedCharge>::acquire();
+    auto mcparticles = MessageStorage<MCParticle>::acquire();
+    mcparticles.reserve(std::max(scan_positions_.size(), size_t(1)));
+
+    // Create charge carriers at requested position, or at all positions of the scan grid
+    auto deposit = [&](const ROOT::Math::XYZPoint& deposit_position) {
+        if(type_ == SourceType::MIP) {
+            DepositLine(deposit_position, charges, mcparticles);
+        } else {
+            DepositPoint(deposit_position, charges, mcparticles);
+        }
+    };
+    if(scan_positions_.empty()) {
+        deposit(position);
     } else {
-        DepositPoint(position);
+        for(const auto& scan_position : scan_positions_) {
+            deposit(scan_position);
+        }
     }
-}
 
-void DepositionPointChargeModule::DepositPoint(const ROOT::Math::XYZPoint& position) {
-    // Vector of deposited charges and their "MCParticle"
-    std::vector<DepositedCharge> charges;
-    std::vector<MCParticle> mcparticles;
+    // Nothing is dispatched if no position is inside the sensor
+    if(mcparticles.empty()) {
+        return;
+    }
 
+    // Dispatch the messages to the framework
+    auto deposit_message = std::make_shared<DepositedChargeMessage>(std::move(charges), detector_);
+    auto mcparticle_message = std::make_shared<MCParticleMessage>(std::move(mcparticles), detector_);
+    messenger_->dispatchMessage(this, deposit_message);
+    messenger_->dispatchMessage(this, mcparticle_message);
+}
+
+void DepositionPointChargeModule::DepositPoint(const ROOT::Math::XYZPoint& position,
+                                               std::vector<DepositedCharge>& charges,
+                                               std::vector<MCParticle>& mcparticles) {
     LOG(DEBUG) << "Position (local coordinates): " << Units::display(position, {"um", "mm"});
     // Cross-check calculated position to be within sensor:
     if(!detector_->isWithinSensor(position)) {
@@ -182,21 +238,13 @@ void DepositionPointChargeModule::DepositPoint(const ROOT::Math::XYZPoint& posit
     charges.emplace_back(position, position_global, CarrierType::HOLE, carriers_, 0., &(mcparticles.back()));
     LOG(DEBUG) << "Deposited " << carriers_ << " charge carriers of both types at global position "
                << Units::display(position_global, {"um", "mm"}) << " in detector " << detector_->getName();
-
-    // Dispatch the messages to the framework
-    auto deposit_message = std::make_shared<DepositedChargeMessage>(std::move(charges), detector_);
-    auto mcparticle_message = std::make_shared<MCParticleMessage>(std::move(mcparticles), detector_);
-    messenger_->dispatchMessage(this, deposit_message);
-    messenger_->dispatchMessage(this, mcparticle_message);
 }
 
-void DepositionPointChargeModule::DepositLine(const ROOT::Math::XYZPoint& position) {
+void DepositionPointChargeModule::DepositLine(const ROOT::Math::XYZPoint& position,
+                                              std::vector<DepositedCharge>& charges,
+                                              std::vector<MCParticle>& mcparticles) {
     auto model = detector_->getModel();
 
-    // Vector of deposited charges and their "MCParticle"
-    std::vector<DepositedCharge> charges;
-    std::vector<MCParticle> mcparticles;
-
     // Cross-check calculated position to be within sensor:
     if(!detector_->isWithinSensor(ROOT::Math::XYZPoint(position.x(), position.y(), 0))) {
         LOG(DEBUG) << "Requested position is outside active sensor volume.";
@@ -225,10 +273,4 @@ void DepositionPointChargeModule::DepositLine(const ROOT::Math::XYZPoint& positi
         LOG(TRACE) << "Deposited " << carriers_ << " charge carriers of both types at global position "
                    << Units::display(position_global, {"um", "mm"}) << " in detector " << detector_->getName();
     }
-
-    // Dispatch the messages to the framework
-    auto deposit_message = std::make_shared<DepositedChargeMessage>(std::move(charges), detector_);
-    auto mcparticle_message = std::make_shared<MCParticleMessage>(std::move(mcparticles), detector_);
-    messenger_->dispatchMessage(this, deposit_message);
-    messenger_->dispatchMessage(this, mcparticle_message);
 }
@@ -8,8 +8,11 @@
  */
 
 #include <string>
+#include <vector>
 
 #include "core/module/Module.hpp"
+#include "objects/DepositedCharge.hpp"
+#include "objects/MCParticle.hpp"
 
 namespace allpix {
     /**
@@ -60,15 +63,29 @@ namespace allpix {
     private:
         /**
          * @brief Helper function to deposit charges at a single point
-         * @param event event number
+         * @param position Position of the deposit in local coordinates
+         * @param charges List of deposited charges to add the charges to
+         * @param mcparticles List of particles to add the particle of the deposit to, should not reallocate
          */
-        void DepositPoint(const ROOT::Math::XYZPoint& position);
+        void DepositPoint(const ROOT::Math::XYZPoint& position,
+                          std::vector<DepositedCharge>& charges,
+                          std::vector<MCParticle>& mcparticles);
 
         /**
          * @brief Helper function to deposit charges along a line
-         * @param event event number
+         * @param position Position of the line in local coordinates, only x and y are used
+         * @param charges List of deposited charges to add the charges to
+         * @param mcparticles List of particles to add the particle of the deposit to, should not reallocate
          */
-        void DepositLine(const ROOT::Math::XYZPoint& position);
+        void DepositLine(const ROOT::Math::XYZPoint& position,
+                         std::vector<DepositedCharge>& charges,
+                         std::vector<MCParticle>& mcparticles);
+
+        /**
+         * @brief Reference point of the scanned volume, the lower left corner of the pixel cell at the center of the sensor
+         * @return Reference point in local coordinates
+         */
+        ROOT::Math::XYZVector scan_reference() const;
 
         std::shared_ptr<Detector> detector_;
         Messenger* messenger_;
@@ -80,5 +97,9 @@ namespace allpix {
         double spot_size_{};
         ROOT::Math::XYZVector voxel_;
         unsigned int root_, carriers_;
+
+        // Positions of the scan deposited together in every event, empty if every event deposits a single position
+        ROOT::Math::XYZVector voxel_scan_;
+        std::vector<ROOT::Math::XYZPoint> scan_positions_;
     };
 } // namespace allpix
@@ -10,6 +10,8 @@
 #include "DetectorHistogrammerModule.hpp"
 
 #include <algorithm>
+#include <array>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <utility>
@@ -19,19 +21,22 @@
 #include "core/utils/log.h"
 
 #include "tools/ROOT.h"
+#include "tools/clustering.h"
 
 using namespace allpix;
 
 DetectorHistogrammerModule::DetectorHistogrammerModule(Configuration& config,
                                                        Messenger* messenger,
                                                        std::shared_ptr<Detector> detector)
-    : Module(config, detector), detector_(std::move(detector)), pixels_message_(nullptr) {
-    // Bind messages
-    messenger->bindSingle(this, &DetectorHistogrammerModule::pixels_message_);
-    messenger->bindSingle(this, &DetectorHistogrammerModule::mcparticle_message_, MsgFlags::REQUIRED);
+    : Module(config, detector), messenger_(messenger), detector_(std::move(detector)) {
+    // Enable parallelization of this module if multithreading is enabled
+    enable_parallelization();
+    // The histograms of every detector can be written in parallel to the ones of other modules
+    enable_parallel_finalization();
 
-    // Seed the random generator with the global seed
-    random_generator_.seed(getRandomSeed());
+    // Bind messages
+    messenger->bindSingle<PixelHitMessage>(this);
+    messenger->bindSingle<MCParticleMessage>(this, MsgFlags::REQUIRED);
 
     auto model = detector_->getModel();
     matching_cut_ = config.get<ROOT::Math::XYVector>("matching_cut", model->getPixelSize() * 3);
@@ -47,38 +52,35 @@ void DetectorHistogrammerModule::init() {
     auto pitch_x = static_cast<double>(Units::convert(model->getPixelSize().x(), "um"));
     auto pitch_y = static_cast<double>(Units::convert(model->getPixelSize().y(), "um"));
 
+    // Calculate the binning of the maps over the full pixel matrix
+    auto map_binning =
+        config_.get<DisplacementVector2D<Cartesian2D<int>>>("map_binning", DisplacementVector2D<Cartesian2D<int>>(1, 1));
+    if(map_binning.x() < 1 || map_binning.y() < 1) {
+        throw InvalidValueError(config_, "map_binning", "number of pixels per bin should be positive");
+    }
+    auto sparse_maps = config_.get<bool>("sparse_maps", false);
+    auto npixels = model->getNPixels();
+    auto map_bins_x = (npixels.x() + map_binning.x() - 1) / map_binning.x();
+    auto map_bins_y = (npixels.y() + map_binning.y() - 1) / map_binning.y();
+    auto map_bins = static_cast<double>(map_bins_x) * static_cast<double>(map_bins_y);
+    if(!sparse_maps && map_bins > 1e6) {
+        LOG(WARNING) << "Maps of the pixel matrix with " << map_bins << " bins create very large histograms." << std::endl
+                     << "Consider combining pixels using the map_binning parameter or enabling sparse_maps.";
+    } else {
+        LOG(DEBUG) << "Pixel map binning: " << map_binning << (sparse_maps ? ", using sparse histograms" : "");
+    }
+
     // Create histogram of hitmap
     LOG(TRACE) << "Creating histograms";
     std::string hit_map_title = "Hitmap for " + detector_->getName() + ";x (pixels);y (pixels);hits";
-    hit_map = new TH2D("hit_map",
-                       hit_map_title.c_str(),
-                       model->getNPixels().x(),
-                       -0.5,
-                       model->getNPixels().x() - 0.5,
-                       model->getNPixels().y(),
-                       -0.5,
-                       model->getNPixels().y() - 0.5);
+    hit_map = std::make_unique<PixelMap>("hit_map", hit_map_title, npixels, map_binning, sparse_maps);
 
     std::string charge_map_title = "Charge map for " + detector_->getName() + ";x (pixels);y (pixels); charge [ke]";
-    charge_map = new TH2D("charge_map",
-                          charge_map_title.c_str(),
-                          model->getNPixels().x(),
-                          -0.5,
-                          model->getNPixels().x() - 0.5,
-                          model->getNPixels().y(),
-                          -0.5,
-                          model->getNPixels().y() - 0.5);
+    charge_map = std::make_unique<PixelMap>("charge_map", charge_map_title, npixels, map_binning, sparse_maps);
 
     // Create histogram of cluster map
     std::string cluster_map_title = "Cluster map for " + detector_->getName() + ";x (pixels);y (pixels); clusters";
-    cluster_map = new TH2D("cluster_map",
-                           cluster_map_title.c_str(),
-                           model->getNPixels().x(),
-                           -0.5,
-                           model->getNPixels().x() - 0.5,
-                           model->getNPixels().y(),
-                           -0.5,
-                           model->getNPixels().y() - 0.5);
+    cluster_map = std::make_unique<PixelMap>("cluster_map", cluster_map_title, npixels, map_binning, sparse_maps);
 
     // Calculate the granularity of in-pixel maps:
     auto inpixel_bins = config_.get<DisplacementVector2D<Cartesian2D<int>>>(
@@ -94,181 +96,194 @@ void DetectorHistogrammerModule::init() {
     // Create histogram of cluster map
     std::string cluster_size_map_title = "Cluster size as function of in-pixel impact position for " + detector_->getName() +
                                          ";x%pitch [#mum];y%pitch [#mum]";
-    cluster_size_map = new TProfile2D(
+    cluster_size_map = std::make_unique<ThreadedHistogram<TProfile2D>>(
         "cluster_size_map", cluster_size_map_title.c_str(), inpixel_bins.x(), 0., pitch_x, inpixel_bins.y(), 0., pitch_y);
 
     std::string cluster_size_x_map_title = "Cluster size in X as function of in-pixel impact position for " +
                                            detector_->getName() + ";x%pitch [#mum];y%pitch [#mum]";
-    cluster_size_x_map = new TProfile2D("cluster_size_x_map",
-                                        cluster_size_x_map_title.c_str(),
-                                        inpixel_bins.x(),
-                                        0.,
-                                        pitch_x,
-                                        inpixel_bins.y(),
-                                        0.,
-                                        pitch_y);
+    cluster_size_x_map = std::make_unique<ThreadedHistogram<TProfile2D>>("cluster_size_x_map",
+                                                                         cluster_size_x_map_title.c_str(),
+                                                                         inpixel_bins.x(),
+                                                                         0.,
+                                                                         pitch_x,
+                                                                         inpixel_bins.y(),
+                                                                         0.,
+                                                                         pitch_y);
 
     std::string cluster_size_y_map_title = "Cluster size in Y as function of in-pixel impact position for " +
                                            detector_->getName() + ";x%pitch [#mum];y%pitch [#mum]";
-    cluster_size_y_map = new TProfile2D("cluster_size_y_map",
-                                        cluster_size_y_map_title.c_str(),
-                                        inpixel_bins.x(),
-                                        0.,
-                                        pitch_x,
-                                        inpixel_bins.y(),
-                                        0.,
-                                        pitch_y);
+    cluster_size_y_map = std::make_unique<ThreadedHistogram<TProfile2D>>("cluster_size_y_map",
+                                                                         cluster_size_y_map_title.c_str(),
+                                                                         inpixel_bins.x(),
+                                                                         0.,
+                                                                         pitch_x,
+                                                                         inpixel_bins.y(),
+                                                                         0.,
+                                                                         pitch_y);
 
     // Charge maps:
     std::string cluster_charge_map_title = "Cluster charge as function of in-pixel impact position for " +
                                            detector_->getName() + ";x%pitch [#mum];y%pitch [#mum];<cluster charge> [ke]";
-    cluster_charge_map = new TProfile2D("cluster_charge_map",
-                                        cluster_charge_map_title.c_str(),
-                                        inpixel_bins.x(),
-                                        0.,
-                                        pitch_x,
-                                        inpixel_bins.y(),
-                                        0.,
-                                        pitch_y);
+    cluster_charge_map = std::make_unique<ThreadedHistogram<TProfile2D>>("cluster_charge_map",
+                                                                         cluster_charge_map_title.c_str(),
+                                                                         inpixel_bins.x(),
+                                                                         0.,
+                                                                         pitch_x,
+                                                                         inpixel_bins.y(),
+                                                                         0.,
+                                                                         pitch_y);
     std::string seed_charge_map_title = "Seed pixel charge as function of in-pixel impact position for " +
                                         detector_->getName() + ";x%pitch [#mum];y%pitch [#mum];<seed pixel charge> [ke]";
-    seed_charge_map = new TProfile2D(
+    seed_charge_map = std::make_unique<ThreadedHistogram<TProfile2D>>(
         "seed_charge_map", seed_charge_map_title.c_str(), inpixel_bins.x(), 0., pitch_x, inpixel_bins.y(), 0., pitch_y);
 
     // Create cluster size plots, preventing a zero-bin histogram by scaling with integer ceiling: (x + y - 1) / y
     std::string cluster_size_title = "Cluster size for " + detector_->getName() + ";cluster size [px];clusters";
-    cluster_size = new TH1D("cluster_size",
-                            cluster_size_title.c_str(),
-                            (model->getNPixels().x() * model->getNPixels().y() + 9) / 10,
-                            0.5,
-                            (model->getNPixels().x() * model->getNPixels().y() + 9) / 10 + 0.5);
+    auto cluster_size_bins = (model->getNPixels().x() * model->getNPixels().y() + 9) / 10;
+    cluster_size = std::make_unique<ThreadedHistogram<TH1D>>(
+        "cluster_size", cluster_size_title.c_str(), cluster_size_bins, 0.5, cluster_size_bins + 0.5);
 
     std::string cluster_size_x_title = "Cluster size X for " + detector_->getName() + ";cluster size x [px];clusters";
-    cluster_size_x = new TH1D(
+    cluster_size_x = std::make_unique<ThreadedHistogram<TH1D>>(
         "cluster_size_x", cluster_size_x_title.c_str(), model->getNPixels().x(), 0.5, model->getNPixels().x() + 0.5);
 
     std::string cluster_size_y_title = "Cluster size Y for " + detector_->getName() + ";cluster size y [px];clusters";
-    cluster_size_y = new TH1D(
+    cluster_size_y = std::make_unique<ThreadedHistogram<TH1D>>(
         "cluster_size_y", cluster_size_y_title.c_str(), model->getNPixels().y(), 0.5, model->getNPixels().y() + 0.5);
 
     // Create event size plot
     std::string event_size_title = "Event size for " + detector_->getName() + ";event size [px];events";
-    event_size = new TH1D("event_size",
-                          event_size_title.c_str(),
-                          model->getNPixels().x() * model->getNPixels().y(),
-                          0.5,
-                          model->getNPixels().x() * model->getNPixels().y() + 0.5);
+    event_size = std::make_unique<ThreadedHistogram<TH1D>>("event_size",
+                                                           event_size_title.c_str(),
+                                                           model->getNPixels().x() * model->getNPixels().y(),
+                                                           0.5,
+                                                           model->getNPixels().x() * model->getNPixels().y() + 0.5);
 
     // Create residual plots
     std::string residual_x_title = "Residual in X for " + detector_->getName() + ";x_{track} - x_{cluster} [#mum];events";
-    residual_x = new TH1D("residual_x", residual_x_title.c_str(), static_cast<int>(12 * pitch_x), -2 * pitch_x, 2 * pitch_x);
+    residual_x = std::make_unique<ThreadedHistogram<TH1D>>(
+        "residual_x", residual_x_title.c_str(), static_cast<int>(12 * pitch_x), -2 * pitch_x, 2 * pitch_x);
     std::string residual_y_title = "Residual in Y for " + detector_->getName() + ";y_{track} - y_{cluster} [#mum];events";
-    residual_y = new TH1D("residual_y", residual_y_title.c_str(), static_cast<int>(12 * pitch_y), -2 * pitch_y, 2 * pitch_y);
+    residual_y = std::make_unique<ThreadedHistogram<TH1D>>(
+        "residual_y", residual_y_title.c_str(), static_cast<int>(12 * pitch_y), -2 * pitch_y, 2 * pitch_y);
 
     // Residual projections
     std::string residual_x_vs_x_title = "Mean absolute deviation of residual in X as function of in-pixel X position for " +
                                         detector_->getName() + ";x%pitch [#mum];MAD(#Deltax) [#mum]";
-    residual_x_vs_x = new TProfile("residual_x_vs_x", residual_x_vs_x_title.c_str(), inpixel_bins.x(), 0., pitch_x);
+    residual_x_vs_x = std::make_unique<ThreadedHistogram<TProfile>>(
+        "residual_x_vs_x", residual_x_vs_x_title.c_str(), inpixel_bins.x(), 0., pitch_x);
     std::string residual_y_vs_y_title = "Mean absolute deviation of residual in Y as function of in-pixel Y position for " +
                                         detector_->getName() + ";y%pitch [#mum];MAD(#Deltay) [#mum]";
-    residual_y_vs_y = new TProfile("residual_y_vs_y", residual_y_vs_y_title.c_str(), inpixel_bins.y(), 0., pitch_y);
+    residual_y_vs_y = std::make_unique<ThreadedHistogram<TProfile>>(
+        "residual_y_vs_y", residual_y_vs_y_title.c_str(), inpixel_bins.y(), 0., pitch_y);
     std::string residual_x_vs_y_title = "Mean absolute deviation of residual in X as function of in-pixel Y position for " +
                                         detector_->getName() + ";y%pitch [#mum];MAD(#Deltax) [#mum]";
-    residual_x_vs_y = new TProfile("residual_x_vs_y", residual_x_vs_y_title.c_str(), inpixel_bins.y(), 0., pitch_y);
+    residual_x_vs_y = std::make_unique<ThreadedHistogram<TProfile>>(
+        "residual_x_vs_y", residual_x_vs_y_title.c_str(), inpixel_bins.y(), 0., pitch_y);
     std::string residual_y_vs_x_title = "Mean absolute deviation of residual in Y as function of in-pixel X position for " +
                                         detector_->getName() + ";x%pitch [#mum];MAD(#Deltay) [#mum]";
-    residual_y_vs_x = new TProfile("residual_y_vs_x", residual_y_vs_x_title.c_str(), inpixel_bins.x(), 0., pitch_x);
+    residual_y_vs_x = std::make_unique<ThreadedHistogram<TProfile>>(
+        "residual_y_vs_x", residual_y_vs_x_title.c_str(), inpixel_bins.x(), 0., pitch_x);
 
     // Residual maps
     std::string residual_map_title = "Mean absolute deviation of residual as function of in-pixel impact position for " +
                                      detector_->getName() +
                                      ";x%pitch [#mum];y%pitch [#mum];MAD(#sqrt{#Deltax^{2}+#Deltay^{2}}) [#mum]";
-    residual_map = new TProfile2D(
+    residual_map = std::make_unique<ThreadedHistogram<TProfile2D>>(
         "residual_map", residual_map_title.c_str(), inpixel_bins.x(), 0., pitch_x, inpixel_bins.y(), 0., pitch_y);
     std::string residual_x_map_title =
         "Mean absolute deviation of residual in X as function of in-pixel impact position for " + detector_->getName() +
         ";x%pitch [#mum];y%pitch [#mum];MAD(#Deltax) [#mum]";
-    residual_x_map = new TProfile2D(
+    residual_x_map = std::make_unique<ThreadedHistogram<TProfile2D>>(
         "residual_x_map", residual_x_map_title.c_str(), inpixel_bins.x(), 0., pitch_x, inpixel_bins.y(), 0., pitch_y);
     std::string residual_y_map_title =
         "Mean absolute deviation of residual in Y as function of in-pixel impact position for " + detector_->getName() +
         ";x%pitch [#mum];y%pitch [#mum];MAD(#Deltay) [#mum]";
-    residual_y_map = new TProfile2D(
+    residual_y_map = std::make_unique<ThreadedHistogram<TProfile2D>>(
         "residual_y_map", residual_y_map_title.c_str(), inpixel_bins.x(), 0., pitch_x, inpixel_bins.y(), 0., pitch_y);
 
     // Efficiency maps:
     std::string efficiency_map_title = "Efficiency as function of in-pixel impact position for " + detector_->getName() +
                                        ";x%pitch [#mum];y%pitch [#mum];efficiency";
-    efficiency_map = new TProfile2D(
+    efficiency_map = std::make_unique<ThreadedHistogram<TProfile2D>>(
         "efficiency_map", efficiency_map_title.c_str(), inpixel_bins.x(), 0, pitch_x, inpixel_bins.y(), 0, pitch_y, 0, 1);
     std::string efficiency_detector_title = "Efficiency of " + detector_->getName() + ";x (pixels);y (pixels);efficiency";
-    efficiency_detector = new TProfile2D("efficiency_detector",
-                                         efficiency_detector_title.c_str(),
-                                         model->getNPixels().x(),
-                                         -0.5,
-                                         model->getNPixels().x() - 0.5,
-                                         model->getNPixels().y(),
-                                         -0.5,
-                                         model->getNPixels().y() - 0.5,
-                                         0,
-                                         1);
+    efficiency_detector = std::make_unique<ThreadedHistogram<TProfile2D>>("efficiency_detector",
+                                                                          efficiency_detector_title.c_str(),
+                                                                          map_bins_x,
+                                                                          -0.5,
+                                                                          map_bins_x * map_binning.x() - 0.5,
+                                                                          map_bins_y,
+                                                                          -0.5,
+                                                                          map_bins_y * map_binning.y() - 0.5,
+                                                                          0,
+                                                                          1);
     // Efficiency projections
     std::string efficiency_vs_x_title =
         "Efficiency as function of in-pixel X position for " + detector_->getName() + ";x%pitch [#mum];efficiency";
-    efficiency_vs_x = new TProfile("efficiency_vs_x", efficiency_vs_x_title.c_str(), inpixel_bins.x(), 0., pitch_x, 0, 1);
+    efficiency_vs_x = std::make_unique<ThreadedHistogram<TProfile>>(
+        "efficiency_vs_x", efficiency_vs_x_title.c_str(), inpixel_bins.x(), 0., pitch_x, 0, 1);
     std::string efficiency_vs_y_title =
         "Efficiency as function of in-pixel Y position for " + detector_->getName() + ";y%pitch [#mum];efficiency";
-    efficiency_vs_y = new TProfile("efficiency_vs_y", efficiency_vs_y_title.c_str(), inpixel_bins.y(), 0., pitch_y, 0, 1);
+    efficiency_vs_y = std::make_unique<ThreadedHistogram<TProfile>>(
+        "efficiency_vs_y", efficiency_vs_y_title.c_str(), inpixel_bins.y(), 0., pitch_y, 0, 1);
 
     // Create number of clusters plot
     std::string n_cluster_title = "Number of clusters for " + detector_->getName() + ";clusters;events";
-    n_cluster = new TH1D("n_cluster",
-                         n_cluster_title.c_str(),
-                         model->getNPixels().x() * model->getNPixels().y(),
-                         0.5,
-                         model->getNPixels().x() * model->getNPixels().y() + 0.5);
+    n_cluster = std::make_unique<ThreadedHistogram<TH1D>>("n_cluster",
+                                                          n_cluster_title.c_str(),
+                                                          model->getNPixels().x() * model->getNPixels().y(),
+                                                          0.5,
+                                                          model->getNPixels().x() * model->getNPixels().y() + 0.5);
 
     // Create cluster charge plot
     auto max_cluster_charge = Units::convert(config_.get<double>("max_cluster_charge", Units::get(50., "ke")), "ke");
     std::string cluster_charge_title = "Cluster charge for " + detector_->getName() + ";cluster charge [ke];clusters";
-    cluster_charge =
-        new TH1D("cluster_charge", cluster_charge_title.c_str(), 1000, 0., static_cast<double>(max_cluster_charge));
+    cluster_charge = std::make_unique<ThreadedHistogram<TH1D>>(
+        "cluster_charge", cluster_charge_title.c_str(), 1000, 0., static_cast<double>(max_cluster_charge));
 }
 
-void DetectorHistogrammerModule::run(unsigned int) {
+void DetectorHistogrammerModule::run(Event* event) {
     using namespace ROOT::Math;
 
+    auto pixels_message = messenger_->fetchMessage<PixelHitMessage>(this, event);
+    auto mcparticle_message = messenger_->fetchMessage<MCParticleMessage>(this, event);
+
     // Check that we actually received pixel hits - we might have none and just received MCParticles!
-    LOG(DEBUG) << "Received " << (pixels_message_ != nullptr ? std::to_string(pixels_message_->getData().size()) : "no")
+    LOG(DEBUG) << "Received " << (pixels_message != nullptr ? std::to_string(pixels_message->getData().size()) : "no")
                << " pixel hits";
-    if(pixels_message_ != nullptr) {
+    if(pixels_message != nullptr) {
+        XYVector event_vector;
 
         // Fill 2D hitmap histogram
-        for(auto& pixel_hit : pixels_message_->getData()) {
+        for(auto& pixel_hit : pixels_message->getData()) {
             auto pixel_idx = pixel_hit.getPixel().getIndex();
 
             // Add pixel
             hit_map->Fill(pixel_idx.x(), pixel_idx.y());
-            charge_map->Fill(pixel_idx.x(), pixel_idx.y(), static_cast<double>(Units::convert(pixel_hit.getSignal(), "ke")));
+            charge_map->Fill(pixel_idx.x(), pixel_idx.y(), pixel_hit.getSignal() / units::ke);
 
-            // Update statistics
-            total_vector_ += pixel_idx;
-            total_hits_ += 1;
+            event_vector += pixel_idx;
         }
+
+        // Update statistics
+        std::lock_guard<std::mutex> lock{stats_mutex_};
+        total_vector_ += event_vector;
+        total_hits_ += pixels_message->getData().size();
     }
 
     // Perform a clustering
-    std::vector<Cluster> clusters = doClustering();
+    std::vector<Cluster> clusters = doClustering(pixels_message);
 
     // Lambda for smearing the Monte Carlo truth position with the track resolution
     auto track_smearing = [&](auto residuals) {
-        double dx = std::normal_distribution<double>(0, residuals.x())(random_generator_);
-        double dy = std::normal_distribution<double>(0, residuals.y())(random_generator_);
+        double dx = std::normal_distribution<double>(0, residuals.x())(event->getRandomEngine());
+        double dy = std::normal_distribution<double>(0, residuals.y())(event->getRandomEngine());
         return DisplacementVector3D<Cartesian3D<double>>(dx, dy, 0);
     };
 
     // Retrieve all MC particles in this detector which are primary particles (not produced within the sensor):
-    auto primary_particles = getPrimaryParticles();
+    auto primary_particles = getPrimaryParticles(mcparticle_message);
     LOG(DEBUG) << "Found " << primary_particles.size() << " primary particles in this event";
 
     // Evaluate the clusters
@@ -282,7 +297,7 @@ void DetectorHistogrammerModule::run(unsigned int) {
         auto clusterPos = clus.getPosition();
         LOG(DEBUG) << "Cluster at coordinates " << clusterPos << " with charge " << Units::display(clus.getCharge(), "ke");
         cluster_map->Fill(clusterPos.x(), clusterPos.y());
-        cluster_charge->Fill(static_cast<double>(Units::convert(clus.getCharge(), "ke")));
+        cluster_charge->Fill(clus.getCharge() / units::ke);
 
         auto cluster_particles = clus.getMCParticles();
         LOG(DEBUG) << "This cluster is connected to " << cluster_particles.size() << " MC particles";
@@ -307,15 +322,14 @@ void DetectorHistogrammerModule::run(unsigned int) {
                                        std::fmod(particlePos.y() + pitch.y() / 2, pitch.y()));
             LOG(TRACE) << "MCParticle in pixel at " << Units::display(inPixelPos, {"mm", "um"});
 
-            auto inPixel_um_x = static_cast<double>(Units::convert(inPixelPos.x(), "um"));
-            auto inPixel_um_y = static_cast<double>(Units::convert(inPixelPos.y(), "um"));
+            auto inPixel_um_x = inPixelPos.x() / units::um;
+            auto inPixel_um_y = inPixelPos.y() / units::um;
             cluster_size_map->Fill(inPixel_um_x, inPixel_um_y, static_cast<double>(clus.getSize()));
             cluster_size_x_map->Fill(inPixel_um_x, inPixel_um_y, clusSizesXY.first);
             cluster_size_y_map->Fill(inPixel_um_x, inPixel_um_y, clusSizesXY.second);
 
             // Charge maps:
-            cluster_charge_map->Fill(
-                inPixel_um_x, inPixel_um_y, static_cast<double>(Units::convert(clus.getCharge(), "ke")));
+            cluster_charge_map->Fill(inPixel_um_x, inPixel_um_y, clus.getCharge() / units::ke);
 
             // Find the nearest pixel
             auto xpixel = static_cast<unsigned int>(std::round(particlePos.x() / pitch.x()));
@@ -324,13 +338,12 @@ void DetectorHistogrammerModule::run(unsigned int) {
             // Retrieve the pixel to which this MCParticle points:
             auto pixel = clus.getPixelHit(xpixel, ypixel);
             if(pixel != nullptr) {
-                seed_charge_map->Fill(
-                    inPixel_um_x, inPixel_um_y, static_cast<double>(Units::convert(pixel->getSignal(), "ke")));
+                seed_charge_map->Fill(inPixel_um_x, inPixel_um_y, pixel->getSignal() / units::ke);
             }
 
             // Calculate residual with cluster position:
-            auto residual_um_x = static_cast<double>(Units::convert(particlePos.x() - clusterPos.x() * pitch.x(), "um"));
-            auto residual_um_y = static_cast<double>(Units::convert(particlePos.y() - clusterPos.y() * pitch.y(), "um"));
+            auto residual_um_x = (particlePos.x() - clusterPos.x() * pitch.x()) / units::um;
+            auto residual_um_y = (particlePos.y() - clusterPos.y() * pitch.y()) / units::um;
             residual_x->Fill(residual_um_x);
             residual_y->Fill(residual_um_y);
             residual_x_vs_x->Fill(inPixel_um_x, std::fabs(residual_um_x));
@@ -354,8 +367,8 @@ void DetectorHistogrammerModule::run(unsigned int) {
         particlePos += track_smearing(track_resolution_);
         auto inPixelPos = XYVector(std::fmod(particlePos.x() + pitch.x() / 2, pitch.x()),
                                    std::fmod(particlePos.y() + pitch.y() / 2, pitch.y()));
-        auto inPixel_um_x = static_cast<double>(Units::convert(inPixelPos.x(), "um"));
-        auto inPixel_um_y = static_cast<double>(Units::convert(inPixelPos.y(), "um"));
+        auto inPixel_um_x = inPixelPos.x() / units::um;
+        auto inPixel_um_y = inPixelPos.y() / units::um;
 
         // Find the nearest pixel
         auto xpixel = static_cast<unsigned int>(std::round(particlePos.x() / pitch.x()));
@@ -379,7 +392,7 @@ void DetectorHistogrammerModule::run(unsigned int) {
     }
 
     // Fill further histograms
-    event_size->Fill(pixels_message_ != nullptr ? static_cast<double>(pixels_message_->getData().size()) : 0.);
+    event_size->Fill(pixels_message != nullptr ? static_cast<double>(pixels_message->getData().size()) : 0.);
     n_cluster->Fill(static_cast<double>(clusters.size()));
 }
 
@@ -390,78 +403,26 @@ void DetectorHistogrammerModule::finalize() {
                   << total_vector_ / static_cast<double>(total_hits_);
     }
 
-    // FIXME Set more useful spacing maximum for cluster size histogram
-    auto xmax = std::ceil(cluster_size->GetBinCenter(cluster_size->FindLastBinAbove()) + 1);
-    cluster_size->GetXaxis()->SetRangeUser(0, xmax);
-    // Set cluster size axis spacing
-    if(static_cast<int>(xmax) < 10) {
-        cluster_size->GetXaxis()->SetNdivisions(static_cast<int>(xmax) + 1, 0, 0, true);
-    }
-
-    xmax = std::ceil(cluster_size_x->GetBinCenter(cluster_size_x->FindLastBinAbove()) + 1);
-    cluster_size_x->GetXaxis()->SetRangeUser(0, xmax);
-    // Set cluster size_x axis spacing
-    if(static_cast<int>(xmax) < 10) {
-        cluster_size_x->GetXaxis()->SetNdivisions(static_cast<int>(xmax) + 1, 0, 0, true);
-    }
-
-    xmax = std::ceil(cluster_size_y->GetBinCenter(cluster_size_y->FindLastBinAbove()) + 1);
-    cluster_size_y->GetXaxis()->SetRangeUser(0, xmax);
-    // Set cluster size_y axis spacing
-    if(static_cast<int>(xmax) < 10) {
-        cluster_size_y->GetXaxis()->SetNdivisions(static_cast<int>(xmax) + 1, 0, 0, true);
-    }
-
-    // FIXME Set more useful spacing maximum for event size histogram
-    xmax = std::ceil(event_size->GetBinCenter(event_size->FindLastBinAbove()) + 1);
-    event_size->GetXaxis()->SetRangeUser(0, xmax);
-    // Set event size axis spacing
-    if(static_cast<int>(xmax) < 10) {
-        event_size->GetXaxis()->SetNdivisions(static_cast<int>(xmax) + 1, 0, 0, true);
-    }
-
-    // FIXME Set more useful spacing maximum for n_cluster histogram
-    xmax = std::ceil(n_cluster->GetBinCenter(n_cluster->FindLastBinAbove()) + 1);
-    n_cluster->GetXaxis()->SetRangeUser(0, xmax);
-    // Set cluster size axis spacing
-    if(static_cast<int>(xmax) < 10) {
-        n_cluster->GetXaxis()->SetNdivisions(static_cast<int>(xmax) + 1, 0, 0, true);
-    }
-
-    // FIXME Set more useful spacing maximum for cluster_charge histogram
-    xmax = std::ceil(cluster_charge->GetBinCenter(cluster_charge->FindLastBinAbove()) + 1);
-    cluster_charge->GetXaxis()->SetRangeUser(0, xmax);
-    // Set cluster size axis spacing
-    if(static_cast<int>(xmax) < 10) {
-        cluster_charge->GetXaxis()->SetNdivisions(static_cast<int>(xmax) + 1, 0, 0, true);
-    }
-
-    // Set default drawing option histogram for hitmap
-    hit_map->SetOption("colz");
-    // Set hit_map axis spacing
-    if(static_cast<int>(hit_map->GetXaxis()->GetXmax()) < 10) {
-        hit_map->GetXaxis()->SetNdivisions(static_cast<int>(hit_map->GetXaxis()->GetXmax()) + 1, 0, 0, true);
-    }
-    if(static_cast<int>(hit_map->GetYaxis()->GetXmax()) < 10) {
-        hit_map->GetYaxis()->SetNdivisions(static_cast<int>(hit_map->GetYaxis()->GetXmax()) + 1, 0, 0, true);
-    }
-
-    charge_map->SetOption("colz");
-    // Set hit_map axis spacing
-    if(static_cast<int>(charge_map->GetXaxis()->GetXmax()) < 10) {
-        charge_map->GetXaxis()->SetNdivisions(static_cast<int>(charge_map->GetXaxis()->GetXmax()) + 1, 0, 0, true);
-    }
-    if(static_cast<int>(charge_map->GetYaxis()->GetXmax()) < 10) {
-        charge_map->GetYaxis()->SetNdivisions(static_cast<int>(charge_map->GetYaxis()->GetXmax()) + 1, 0, 0, true);
-    }
-
-    cluster_map->SetOption("colz");
-    // Set cluster_map axis spacing
-    if(static_cast<int>(cluster_map->GetXaxis()->GetXmax()) < 10) {
-        cluster_map->GetXaxis()->SetNdivisions(static_cast<int>(cluster_map->GetXaxis()->GetXmax()) + 1, 0, 0, true);
-    }
-    if(static_cast<int>(cluster_map->GetYaxis()->GetXmax()) < 10) {
-        cluster_map->GetYaxis()->SetNdivisions(static_cast<int>(cluster_map->GetYaxis()->GetXmax()) + 1, 0, 0, true);
+    // Merge the histograms of all threads
+    auto cluster_size_histogram = cluster_size->merge();
+    auto cluster_size_x_histogram = cluster_size_x->merge();
+    auto cluster_size_y_histogram = cluster_size_y->merge();
+    auto event_size_histogram = event_size->merge();
+    auto n_cluster_histogram = n_cluster->merge();
+    auto cluster_charge_histogram = cluster_charge->merge();
+
+    // Set a useful axis maximum and spacing for the histograms of sizes and counts
+    for(auto* histogram : {cluster_size_histogram,
+                           cluster_size_x_histogram,
+                           cluster_size_y_histogram,
+                           event_size_histogram,
+                           n_cluster_histogram,
+                           cluster_charge_histogram}) {
+        auto xmax = std::ceil(histogram->GetBinCenter(histogram->FindLastBinAbove()) + 1);
+        histogram->GetXaxis()->SetRangeUser(0, xmax);
+        if(static_cast<int>(xmax) < 10) {
+            histogram->GetXaxis()->SetNdivisions(static_cast<int>(xmax) + 1, 0, 0, true);
+        }
     }
 
     // Write histograms
@@ -469,92 +430,67 @@ void DetectorHistogrammerModule::finalize() {
     hit_map->Write();
     charge_map->Write();
     cluster_map->Write();
-    cluster_size_map->Write();
-    cluster_size_x_map->Write();
-    cluster_size_y_map->Write();
-    cluster_size->Write();
-    cluster_size_x->Write();
-    cluster_size_y->Write();
-    event_size->Write();
-    residual_x->Write();
-    residual_y->Write();
-    residual_x_vs_x->Write();
-    residual_y_vs_y->Write();
-    residual_x_vs_y->Write();
-    residual_y_vs_x->Write();
-    residual_map->Write();
-    residual_x_map->Write();
-    residual_y_map->Write();
-    efficiency_vs_x->Write();
-    efficiency_vs_y->Write();
-    efficiency_detector->Write();
-    efficiency_map->Write();
-    n_cluster->Write();
-    cluster_charge->Write();
-    cluster_charge_map->Write();
-    seed_charge_map->Write();
+    cluster_size_map->merge()->Write();
+    cluster_size_x_map->merge()->Write();
+    cluster_size_y_map->merge()->Write();
+    cluster_size_histogram->Write();
+    cluster_size_x_histogram->Write();
+    cluster_size_y_histogram->Write();
+    event_size_histogram->Write();
+    residual_x->merge()->Write();
+    residual_y->merge()->Write();
+    residual_x_vs_x->merge()->Write();
+    residual_y_vs_y->merge()->Write();
+    residual_x_vs_y->merge()->Write();
+    residual_y_vs_x->merge()->Write();
+    residual_map->merge()->Write();
+    residual_x_map->merge()->Write();
+    residual_y_map->merge()->Write();
+    efficiency_vs_x->merge()->Write();
+    efficiency_vs_y->merge()->Write();
+    efficiency_detector->merge()->Write();
+    efficiency_map->merge()->Write();
+    n_cluster_histogram->Write();
+    cluster_charge_histogram->Write();
+    cluster_charge_map->merge()->Write();
+    seed_charge_map->merge()->Write();
 }
 
-std::vector<Cluster> DetectorHistogrammerModule::doClustering() {
+std::vector<Cluster>
+DetectorHistogrammerModule::doClustering(const std::shared_ptr<PixelHitMessage>& pixels_message) const {
     std::vector<Cluster> clusters;
-    std::map<const PixelHit*, bool> usedPixel;
 
-    if(pixels_message_ == nullptr) {
+    if(pixels_message == nullptr) {
         return clusters;
     }
 
-    auto pixel_it = pixels_message_->getData().begin();
-    for(; pixel_it != pixels_message_->getData().end(); pixel_it++) {
-        const PixelHit* pixel_hit = &(*pixel_it);
-
-        // Check if the pixel has been used:
-        if(usedPixel[pixel_hit]) {
-            continue;
-        }
+    // Group all directly or diagonally adjacent pixel hits
+    const auto& pixel_hits = pixels_message->getData();
+    auto groups = cluster_adjacent_pixels(pixel_hits, [](const PixelHit& pixel_hit) { return pixel_hit.getIndex(); });
 
+    for(auto& group : groups) {
         // Create new cluster
-        Cluster cluster(pixel_hit);
-        usedPixel[pixel_hit] = true;
-        LOG(TRACE) << "Creating new cluster with seed: " << pixel_hit->getPixel().getIndex();
-
-        auto touching = [&](const PixelHit* pixel) {
-            auto pxi1 = pixel->getIndex();
-            for(auto& cluster_pixel : cluster.getPixelHits()) {
-
-                auto distance = [](unsigned int lhs, unsigned int rhs) { return (lhs > rhs ? lhs - rhs : rhs - lhs); };
-
-                auto pxi2 = cluster_pixel->getIndex();
-                if(distance(pxi1.x(), pxi2.x()) <= 1 && distance(pxi1.y(), pxi2.y()) <= 1) {
-                    return true;
-                }
-            }
-            return false;
-        };
-
-        // Keep adding pixels to the cluster:
-        for(auto other_pixel = pixel_it + 1; other_pixel != pixels_message_->getData().end(); other_pixel++) {
-            const PixelHit* neighbor = &(*other_pixel);
-
-            // Check if neighbor has been used or if it touches the current cluster:
-            if(usedPixel[neighbor] || !touching(neighbor)) {
-                continue;
-            }
+        const PixelHit* seed = &pixel_hits[group.front()];
+        Cluster cluster(seed);
+        LOG(TRACE) << "Creating new cluster with seed: " << seed->getPixel().getIndex();
 
+        // Add all other pixels in the order they have been found
+        for(auto idx = std::next(group.begin()); idx != group.end(); ++idx) {
+            const PixelHit* neighbor = &pixel_hits[*idx];
             cluster.addPixelHit(neighbor);
             LOG(TRACE) << "Adding pixel: " << neighbor->getPixel().getIndex();
-            usedPixel[neighbor] = true;
-            other_pixel = pixel_it;
         }
         clusters.push_back(cluster);
     }
     return clusters;
 }
 
-std::vector<const MCParticle*> DetectorHistogrammerModule::getPrimaryParticles() const {
+std::vector<const MCParticle*>
+DetectorHistogrammerModule::getPrimaryParticles(const std::shared_ptr<MCParticleMessage>& mcparticle_message) const {
     std::vector<const MCParticle*> primaries;
 
     // Loop over all MCParticles available
-    for(auto& mc_particle : mcparticle_message_->getData()) {
+    for(auto& mc_particle : mcparticle_message->getData()) {
         // Check for possible parents:
         auto parent = mc_particle.getParent();
         if(parent != nullptr) {
@@ -569,3 +505,67 @@ std::vector<const MCParticle*> DetectorHistogrammerModule::getPrimaryParticles()
 
     return primaries;
 }
+
+DetectorHistogrammerModule::PixelMap::PixelMap(const std::string& name,
+                                               const std::string& title,
+                                               const ROOT::Math::DisplacementVector2D<ROOT::Math::Cartesian2D<int>>& npixels,
+                                               const ROOT::Math::DisplacementVector2D<ROOT::Math::Cartesian2D<int>>& binning,
+                                               bool sparse) {
+    // Cover the full matrix, extending the last bin if the number of pixels is not a multiple of the binning
+    auto bins_x = (npixels.x() + binning.x() - 1) / binning.x();
+    auto bins_y = (npixels.y() + binning.y() - 1) / binning.y();
+    auto max_x = bins_x * binning.x() - 0.5;
+    auto max_y = bins_y * binning.y() - 0.5;
+
+    if(!sparse) {
+        dense_ = std::make_unique<ThreadedHistogram<TH2D>>(
+            name.c_str(), title.c_str(), bins_x, -0.5, max_x, bins_y, -0.5, max_y);
+        return;
+    }
+
+    std::array<int, 2> bins{{bins_x, bins_y}};
+    std::array<double, 2> min{{-0.5, -0.5}};
+    std::array<double, 2> max{{max_x, max_y}};
+    // THnSparse does not parse the axis titles from the title of the histogram, split them off
+    std::vector<std::string> titles;
+    size_t prev = 0, pos;
+    while((pos = title.find(';', prev)) != std::string::npos) {
+        titles.push_back(title.substr(prev, pos - prev));
+        prev = pos + 1;
+    }
+    titles.push_back(title.substr(prev));
+
+    sparse_ = std::make_unique<ThreadedHistogram<THnSparseD>>(
+        name.c_str(), titles.front().c_str(), 2, bins.data(), min.data(), max.data());
+    for(size_t axis = 0; axis < 2 && axis + 1 < titles.size(); ++axis) {
+        (*sparse_)->GetAxis(static_cast<int>(axis))->SetTitle(titles[axis + 1].c_str());
+    }
+}
+
+void DetectorHistogrammerModule::PixelMap::Fill(double x, double y, double weight) {
+    if(dense_ != nullptr) {
+        dense_->Fill(x, y, weight);
+    } else {
+        std::array<double, 2> coordinates{{x, y}};
+        sparse_->Fill(coordinates.data(), weight);
+    }
+}
+
+void DetectorHistogrammerModule::PixelMap::Write() {
+    if(sparse_ != nullptr) {
+        sparse_->merge()->Write();
+        return;
+    }
+
+    auto histogram = dense_->merge();
+
+    // Set default drawing option and axis spacing for small matrices
+    histogram->SetOption("colz");
+    if(static_cast<int>(histogram->GetXaxis()->GetXmax()) < 10) {
+        histogram->GetXaxis()->SetNdivisions(static_cast<int>(histogram->GetXaxis()->GetXmax()) + 1, 0, 0, true);
+    }
+    if(static_cast<int>(histogram->GetYaxis()->GetXmax()) < 10) {
+        histogram->GetYaxis()->SetNdivisions(static_cast<int>(histogram->GetYaxis()->GetXmax()) + 1, 0, 0, true);
+    }
+    histogram->Write();
+}
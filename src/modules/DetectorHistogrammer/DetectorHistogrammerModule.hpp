@@ -11,19 +11,23 @@
 #define ALLPIX_MODULE_DETECTOR_HISTOGRAMMER_H
 
 #include <memory>
-
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include <Math/DisplacementVector2D.h>
 #include <TH1I.h>
 #include <TH2I.h>
+#include <THnSparse.h>
 #include <TProfile.h>
 #include <TProfile2D.h>
 
 #include "core/config/Configuration.hpp"
 #include "core/geometry/GeometryManager.hpp"
 #include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
 #include "core/module/Module.hpp"
+#include "core/module/ThreadedHistogram.hpp"
 
 #include "Cluster.hpp"
 #include "objects/PixelHit.hpp"
@@ -32,8 +36,10 @@ namespace allpix {
     /**
      * @ingroup Modules
      * @brief Module to plot the final digitized pixel data
+     * @note This module supports parallelization
      *
-     * Generates a hitmap of all the produced pixel hits, together with a histogram of the cluster size
+     * Generates a hitmap of all the produced pixel hits, together with a histogram of the cluster size. The maps over the
+     * full pixel matrix can be rebinned and stored as sparse histograms for large matrices.
      */
     class DetectorHistogrammerModule : public Module {
     public:
@@ -52,8 +58,9 @@ namespace allpix {
 
         /**
          * @brief Fill the histograms
+         * @param event Pointer to the event to process
          */
-        void run(unsigned int) override;
+        void run(Event* event) override;
 
         /**
          * @brief Write the histograms to the modules file
@@ -61,47 +68,84 @@ namespace allpix {
         void finalize() override;
 
     private:
+        /**
+         * @brief Map over the full pixel matrix, either as dense or as sparse histogram, rebinned by groups of pixels
+         */
+        class PixelMap {
+        public:
+            /**
+             * @brief Book the histogram of the map
+             * @param name Name of the histogram
+             * @param title Title of the histogram, including the titles of the axes separated by semicolons
+             * @param npixels Number of pixels of the matrix in x and y
+             * @param binning Number of pixels in a bin in x and y
+             * @param sparse True if the map is stored as sparse histogram, only allocating the bins which are filled
+             */
+            PixelMap(const std::string& name,
+                     const std::string& title,
+                     const ROOT::Math::DisplacementVector2D<ROOT::Math::Cartesian2D<int>>& npixels,
+                     const ROOT::Math::DisplacementVector2D<ROOT::Math::Cartesian2D<int>>& binning,
+                     bool sparse);
+
+            /**
+             * @brief Fill the histogram of the calling thread
+             * @param x Index of the pixel in x
+             * @param y Index of the pixel in y
+             * @param weight Weight of the entry
+             */
+            void Fill(double x, double y, double weight = 1.);
+
+            /**
+             * @brief Merge the histograms of all threads and write the map to the current directory
+             */
+            void Write();
+
+        private:
+            std::unique_ptr<ThreadedHistogram<TH2D>> dense_;
+            std::unique_ptr<ThreadedHistogram<THnSparseD>> sparse_;
+        };
+
         /**
          * @brief Perform a sparse clustering on the PixelHits
+         * @param pixels_message Message with the pixel hits, or a null pointer if no pixel hits were received
          */
-        std::vector<Cluster> doClustering();
+        std::vector<Cluster> doClustering(const std::shared_ptr<PixelHitMessage>& pixels_message) const;
 
         /**
          * @brief analyze the available MCParticles and return the all particles identified as primary (i.e. that do not have
          * a parent). This might be several particles.
+         * @param mcparticle_message Message with the MC particles
          */
-        std::vector<const MCParticle*> getPrimaryParticles() const;
+        std::vector<const MCParticle*>
+        getPrimaryParticles(const std::shared_ptr<MCParticleMessage>& mcparticle_message) const;
 
+        Messenger* messenger_;
         std::shared_ptr<Detector> detector_;
 
-        // List of pixel hits and MC particles
-        std::shared_ptr<PixelHitMessage> pixels_message_;
-        std::shared_ptr<MCParticleMessage> mcparticle_message_;
-
         // Statistics to compute mean position
         ROOT::Math::XYVector total_vector_{};
         unsigned long total_hits_{};
+        std::mutex stats_mutex_;
 
         // Cut criteria for efficiency measurement:
         ROOT::Math::XYVector matching_cut_{};
 
         // Reference track resolution
         ROOT::Math::XYVector track_resolution_{};
-        std::mt19937_64 random_generator_;
 
         // Histograms to output
-        TH2D *hit_map, *charge_map, *cluster_map;
-        TProfile2D *cluster_size_map, *cluster_size_x_map, *cluster_size_y_map;
-        TProfile2D *cluster_charge_map, *seed_charge_map;
-        TProfile2D *residual_map, *residual_x_map, *residual_y_map;
-        TH1D *residual_x, *residual_y;
-        TProfile *residual_x_vs_x, *residual_y_vs_y, *residual_x_vs_y, *residual_y_vs_x;
-        TProfile2D *efficiency_map, *efficiency_detector;
-        TProfile *efficiency_vs_x, *efficiency_vs_y;
-        TH1D* event_size;
-        TH1D *cluster_size, *cluster_size_x, *cluster_size_y;
-        TH1D* n_cluster;
-        TH1D* cluster_charge;
+        std::unique_ptr<PixelMap> hit_map, charge_map, cluster_map;
+        std::unique_ptr<ThreadedHistogram<TProfile2D>> cluster_size_map, cluster_size_x_map, cluster_size_y_map;
+        std::unique_ptr<ThreadedHistogram<TProfile2D>> cluster_charge_map, seed_charge_map;
+        std::unique_ptr<ThreadedHistogram<TProfile2D>> residual_map, residual_x_map, residual_y_map;
+        std::unique_ptr<ThreadedHistogram<TH1D>> residual_x, residual_y;
+        std::unique_ptr<ThreadedHistogram<TProfile>> residual_x_vs_x, residual_y_vs_y, residual_x_vs_y, residual_y_vs_x;
+        std::unique_ptr<ThreadedHistogram<TProfile2D>> efficiency_map, efficiency_detector;
+        std::unique_ptr<ThreadedHistogram<TProfile>> efficiency_vs_x, efficiency_vs_y;
+        std::unique_ptr<ThreadedHistogram<TH1D>> event_size;
+        std::unique_ptr<ThreadedHistogram<TH1D>> cluster_size, cluster_size_x, cluster_size_y;
+        std::unique_ptr<ThreadedHistogram<TH1D>> n_cluster;
+        std::unique_ptr<ThreadedHistogram<TH1D>> cluster_charge;
     };
 } // namespace allpix
 
@@ -29,6 +29,9 @@ using namespace allpix;
 
 ElectricFieldReaderModule::ElectricFieldReaderModule(Configuration& config, Messenger*, std::shared_ptr<Detector> detector)
     : Module(config, detector), detector_(std::move(detector)) {
+    // Fields of different detectors can be read at the same time
+    enable_parallel_initialization();
+
     // NOTE use voltage as a synonym for bias voltage
     config_.setAlias("bias_voltage", "voltage");
 
@@ -87,20 +90,95 @@ void ElectricFieldReaderModule::init() {
         LOG(DEBUG) << "Electric field starts with offset " << offset << " to pixel boundary";
         std::array<double, 2> field_offset{{model->getPixelSize().x() * offset.x(), model->getPixelSize().y() * offset.y()}};
 
-        auto field_data = read_field(thickness_domain, field_scale);
+        // Select the method to obtain the field between the grid points, defaulting to the nearest grid point:
+        auto interpolation = config_.get<std::string>("interpolation", "nearest");
+        FieldInterpolation field_interpolation;
+        if(interpolation == "nearest") {
+            field_interpolation = FieldInterpolation::NEAREST;
+        } else if(interpolation == "linear") {
+            field_interpolation = FieldInterpolation::LINEAR;
+        } else {
+            throw InvalidValueError(config_, "interpolation", "interpolation should be 'nearest' or 'linear'");
+        }
+        LOG(DEBUG) << "Electric field will be interpolated using method " << interpolation;
+
+        // Select the precision used to store the field grid, defaulting to double precision:
+        auto precision = config_.get<std::string>("field_precision", "double");
+        FieldPrecision field_precision;
+        if(precision == "double") {
+            field_precision = FieldPrecision::DOUBLE;
+        } else if(precision == "float") {
+            field_precision = FieldPrecision::FLOAT;
+        } else if(precision == "int16") {
+            field_precision = FieldPrecision::INT16;
+        } else {
+            throw InvalidValueError(config_, "field_precision", "field precision should be 'double', 'float' or 'int16'");
+        }
+        LOG(DEBUG) << "Electric field will be stored with precision " << precision;
+
+        // Select the mirror symmetry of the field, the file then only contains the positive half or quadrant of the field:
+        auto symmetry = config_.get<std::string>("field_symmetry", "none");
+        FieldSymmetry field_symmetry;
+        if(symmetry == "none") {
+            field_symmetry = FieldSymmetry::NONE;
+        } else if(symmetry == "half_x") {
+            field_symmetry = FieldSymmetry::HALF_X;
+        } else if(symmetry == "half_y") {
+            field_symmetry = FieldSymmetry::HALF_Y;
+        } else if(symmetry == "quarter") {
+            field_symmetry = FieldSymmetry::QUARTER;
+        } else {
+            throw InvalidValueError(
+                config_, "field_symmetry", "field symmetry should be 'none', 'half_x', 'half_y' or 'quarter'");
+        }
+        auto mirror_x = (field_symmetry == FieldSymmetry::HALF_X || field_symmetry == FieldSymmetry::QUARTER);
+        auto mirror_y = (field_symmetry == FieldSymmetry::HALF_Y || field_symmetry == FieldSymmetry::QUARTER);
+        std::array<double, 2> grid_extent{
+            {field_scale[0] / (mirror_x ? 2.0 : 1.0), field_scale[1] / (mirror_y ? 2.0 : 1.0)}};
+        LOG(DEBUG) << "Electric field mesh covers " << Units::display(grid_extent[0], {"um", "mm"}) << " x "
+                   << Units::display(grid_extent[1], {"um", "mm"}) << " using symmetry " << symmetry;
+
+        // Select the memory layout of the field grid, defaulting to a flat array:
+        auto layout = config_.get<std::string>("field_layout", "flat");
+        FieldLayout field_layout;
+        if(layout == "flat") {
+            field_layout = FieldLayout::FLAT;
+        } else if(layout == "tiled") {
+            field_layout = FieldLayout::TILED;
+        } else {
+            throw InvalidValueError(config_, "field_layout", "field layout should be 'flat' or 'tiled'");
+        }
+        LOG(DEBUG) << "Electric field will be stored with layout " << layout;
+
+        // Planes of the grid along z which are reproduced by the interpolation between their neighbors can be dropped:
+        auto z_tolerance = config_.get<double>("field_z_tolerance", 0.);
+        if(z_tolerance < 0) {
+            throw InvalidValueError(config_, "field_z_tolerance", "tolerance cannot be negative");
+        }
+        if(z_tolerance > 0) {
+            LOG(DEBUG) << "Electric field planes along z will be dropped up to a relative deviation of " << z_tolerance;
+        }
 
-        detector_->setElectricFieldGrid(
-            field_data.getData(), field_data.getDimensions(), field_scale, field_offset, thickness_domain);
+        auto field_data = read_field(thickness_domain, grid_extent);
+
+        detector_->setElectricFieldGrid(field_data.getView(),
+                                        field_data.getNumberOfElements(),
+                                        field_data.getDimensions(),
+                                        field_scale,
+                                        field_offset,
+                                        thickness_domain,
+                                        field_interpolation,
+                                        field_precision,
+                                        field_symmetry,
+                                        field_layout,
+                                        z_tolerance);
     } else if(field_model == "constant") {
         LOG(TRACE) << "Adding constant electric field";
         type = FieldType::CONSTANT;
 
         auto field_z = config_.get<double>("bias_voltage") / getDetector()->getModel()->getSensorSize().z();
         LOG(INFO) << "Set constant electric field with magnitude " << Units::display(field_z, {"V/um", "V/mm"});
-        FieldFunction<ROOT::Math::XYZVector> function = [field_z](const ROOT::Math::XYZPoint&) {
-            return ROOT::Math::XYZVector(0, 0, -field_z);
-        };
-        detector_->setElectricFieldFunction(function, thickness_domain, type);
+        detector_->setElectricFieldLinear(ROOT::Math::XYZVector(0, 0, -field_z), 1, 0, thickness_domain, type);
     } else if(field_model == "linear") {
         LOG(TRACE) << "Adding linear electric field";
         type = FieldType::LINEAR;
@@ -110,8 +188,7 @@ void ElectricFieldReaderModule::init() {
 
         LOG(INFO) << "Setting linear electric field from " << Units::display(config_.get<double>("bias_voltage"), "V")
                   << " bias voltage and " << Units::display(depletion_voltage, "V") << " depletion voltage";
-        FieldFunction<ROOT::Math::XYZVector> function = get_linear_field_function(depletion_voltage, thickness_domain);
-        detector_->setElectricFieldFunction(function, thickness_domain, type);
+        set_linear_field(depletion_voltage, thickness_domain);
     } else {
         throw InvalidValueError(config_, "model", "model should be 'linear', 'constant' or 'init'");
     }
@@ -122,9 +199,12 @@ void ElectricFieldReaderModule::init() {
     }
 }
 
-FieldFunction<ROOT::Math::XYZVector>
-ElectricFieldReaderModule::get_linear_field_function(double depletion_voltage, std::pair<double, double> thickness_domain) {
-    LOG(TRACE) << "Calculating function for the linear electric field.";
+/**
+ * The magnitude of the field changes linearly along z and is applied in its closed form, such that the detector evaluates it
+ * inline for every lookup instead of calling a field function.
+ */
+void ElectricFieldReaderModule::set_linear_field(double depletion_voltage, std::pair<double, double> thickness_domain) {
+    LOG(TRACE) << "Calculating the linear electric field.";
     // We always deplete from the implants:
     auto bias_voltage = std::fabs(config_.get<double>("bias_voltage"));
     depletion_voltage = std::fabs(depletion_voltage);
@@ -139,33 +219,36 @@ ElectricFieldReaderModule::get_linear_field_function(double depletion_voltage, s
     }
     LOG(TRACE) << "Effective thickness of the electric field: " << Units::display(eff_thickness, {"um", "mm"});
     LOG(DEBUG) << "Depleting the sensor from the " << (deplete_from_implants ? "implant side." : "back side.");
-    return [bias_voltage, depletion_voltage, direction, eff_thickness, thickness_domain, deplete_from_implants](
-               const ROOT::Math::XYZPoint& pos) {
-        double z_rel = thickness_domain.second - pos.z();
-        double field_z = std::max(0.0,
-                                  (bias_voltage - depletion_voltage) / eff_thickness +
-                                      2 * (depletion_voltage / eff_thickness) *
-                                          (deplete_from_implants ? (1 - z_rel / eff_thickness) : z_rel / eff_thickness));
-        return ROOT::Math::XYZVector(0, 0, (direction ? -1 : 1) * field_z);
-    };
+
+    // The field decreases linearly with the depth from the depleting side, clamped to zero beyond the depleted region
+    auto slope = 2 * depletion_voltage / (eff_thickness * eff_thickness);
+    auto base = (bias_voltage - depletion_voltage) / eff_thickness;
+    auto offset = deplete_from_implants ? base + 2 * depletion_voltage / eff_thickness - slope * thickness_domain.second
+                                        : base + slope * thickness_domain.second;
+    detector_->setElectricFieldLinear(ROOT::Math::XYZVector(0, 0, direction ? -1 : 1),
+                                      offset,
+                                      deplete_from_implants ? slope : -slope,
+                                      thickness_domain,
+                                      FieldType::LINEAR);
 }
 
 /**
  * The field data read from files are shared between module instantiations using the static
  * FieldParser's getByFileName method.
  */
-FieldParser<double> ElectricFieldReaderModule::field_parser_(FieldQuantity::VECTOR);
+FieldParser<double> ElectricFieldReaderModule::field_parser_(FieldQuantity::VECTOR, true);
 FieldData<double> ElectricFieldReaderModule::read_field(std::pair<double, double> thickness_domain,
                                                         std::array<double, 2> field_scale) {
 
     try {
         LOG(TRACE) << "Fetching electric field from mesh file";
 
-        // Get field from file
-        auto field_data = field_parser_.getByFileName(config_.getPath("file_name", true), "V/cm");
+        // Check if electric field matches chip before reading the field data
+        auto file_name = config_.getPath("file_name", true);
+        check_detector_match(field_parser_.getHeaderByFileName(file_name).getSize(), thickness_domain, field_scale);
 
-        // Check if electric field matches chip
-        check_detector_match(field_data.getSize(), thickness_domain, field_scale);
+        // Get field from file
+        auto field_data = field_parser_.getByFileName(file_name, "V/cm", config_.get<bool>("shared_memory", false));
 
         LOG(INFO) << "Set electric field with " << field_data.getDimensions().at(0) << "x"
                   << field_data.getDimensions().at(1) << "x" << field_data.getDimensions().at(2) << " cells";
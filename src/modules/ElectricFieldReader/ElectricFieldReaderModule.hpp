@@ -48,15 +48,15 @@ namespace allpix {
 
         /**
          * @brief Create and apply a linear field
+         * @param depletion_voltage Voltage at which the sensor is fully depleted
          * @param thickness_domain Domain of the thickness where the field is defined
          */
-        FieldFunction<ROOT::Math::XYZVector> get_linear_field_function(double depletion_voltage,
-                                                                       std::pair<double, double> thickness_domain);
+        void set_linear_field(double depletion_voltage, std::pair<double, double> thickness_domain);
 
         /**
          * @brief Read field from a file in init or apf format and apply it
          * @param thickness_domain Domain of the thickness where the field is defined
-         * @param field_scale Scaling parameters for the field size in x and y
+         * @param field_scale Expected extent of the field mesh in x and y, reduced for symmetric fields
          */
         FieldData<double> read_field(std::pair<double, double> thickness_domain, std::array<double, 2> field_scale);
         static FieldParser<double> field_parser_;
@@ -0,0 +1,202 @@
+/**
+ * @file
+ * @brief Implementation of a module building time-ordered readout frames from the hits of consecutive events
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "FrameBuilderModule.hpp"
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <utility>
+
+#include "core/utils/file.h"
+#include "core/utils/log.h"
+#include "core/utils/unit.h"
+#include "objects/PixelHit.hpp"
+
+using namespace allpix;
+
+FrameBuilderModule::FrameBuilderModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector)
+    : Module(config, std::move(detector)), messenger_(messenger) {
+    // NOTE The state of the pixels and frames spans multiple events, so this module is run in the order of the events
+
+    // Set defaults for config variables
+    config_.setDefault<double>("event_interval", Units::get(25.0, "ns"));
+    config_.setDefault<bool>("poisson", false);
+    config_.setDefault<double>("frame_length", Units::get(25.0, "ns"));
+    config_.setDefault<double>("dead_time", 0);
+    config_.setDefault<bool>("paralyzable", false);
+    config_.setDefault<bool>("write_empty_frames", false);
+    config_.setDefault<std::string>("file_name", "frames");
+
+    event_interval_ = config_.get<double>("event_interval");
+    poisson_ = config_.get<bool>("poisson");
+    frame_length_ = config_.get<double>("frame_length");
+    dead_time_ = config_.get<double>("dead_time");
+    paralyzable_ = config_.get<bool>("paralyzable");
+    write_empty_frames_ = config_.get<bool>("write_empty_frames");
+
+    if(event_interval_ < 0) {
+        throw InvalidValueError(config_, "event_interval", "time between events cannot be negative");
+    }
+    if(poisson_ && event_interval_ == 0) {
+        throw InvalidValueError(
+            config_, "event_interval", "mean time between events should be strictly positive if Poisson distributed");
+    }
+    if(frame_length_ <= 0) {
+        throw InvalidValueError(config_, "frame_length", "length of the frames should be strictly positive");
+    }
+    if(dead_time_ < 0) {
+        throw InvalidValueError(config_, "dead_time", "dead time cannot be negative");
+    }
+
+    // Run for every event, also without hits, to advance the time line
+    messenger_->bindSingle<PixelHitMessage>(this, MsgFlags::NONE);
+}
+
+void FrameBuilderModule::init() {
+    output_file_name_ = createOutputFile(allpix::add_file_extension(config_.get<std::string>("file_name"), "txt"));
+    output_file_ = std::make_unique<std::ofstream>(output_file_name_);
+
+    *output_file_ << "# Allpix Squared readout frames of detector " << getDetector()->getName() << " with a length of "
+                  << Units::display(frame_length_, {"ns", "us"}) << '\n'
+                  << "# === frame number, start time [ns], number of hits ===\n"
+                  << "# column, row, time [ns], signal, event number\n\n";
+
+    LOG(INFO) << "Building frames of " << Units::display(frame_length_, {"ns", "us"}) << " from events every "
+              << (poisson_ ? "mean " : "") << Units::display(event_interval_, {"ns", "us", "ms"});
+}
+
+void FrameBuilderModule::run(Event* event) {
+    // Place the event on the time line after the previous one
+    if(first_event_) {
+        first_event_ = false;
+    } else if(poisson_) {
+        event_time_ += std::exponential_distribution<double>(1.0 / event_interval_)(event->getRandomEngine());
+    } else {
+        event_time_ += event_interval_;
+    }
+    LOG(DEBUG) << "Event starts at " << Units::display(event_time_, {"ns", "us", "ms"});
+
+    auto message = messenger_->fetchMessage<PixelHitMessage>(this, event);
+    if(message != nullptr) {
+        for(const auto& hit : message->getData()) {
+            auto time = event_time_ + hit.getTime();
+            // Frames before the end of the processed time may already be written
+            if(time < processed_time_) {
+                LOG_ONCE(WARNING) << "Hit at " << Units::display(time, {"ns", "us"})
+                                  << " arrives before the start of the previous event and cannot be added to its frame";
+                ++late_cnt_;
+                continue;
+            }
+            pending_hits_.emplace(time, FrameHit{hit.getIndex(), time, hit.getSignal(), event->getNumber()});
+        }
+    }
+
+    // No later event can add hits before the start of this event
+    process_hits(event_time_);
+    write_frames(static_cast<uint64_t>(std::floor(event_time_ / frame_length_)));
+    ++events_cnt_;
+}
+
+/**
+ * The hits are processed in the order of their time, such that the dead time of a pixel is determined by the previous hit
+ * of this pixel in any event. Hits arriving within the dead time are discarded and extend the dead time if it is
+ * paralyzable. Pixels are forgotten as soon as their dead time has passed.
+ */
+void FrameBuilderModule::process_hits(double time) {
+    auto hit_it = pending_hits_.begin();
+    for(; hit_it != pending_hits_.end() && hit_it->first < time; ++hit_it) {
+        const auto& hit = hit_it->second;
+
+        auto key = (static_cast<uint64_t>(hit.index.x()) << 32) | hit.index.y();
+        auto dead_it = dead_until_.find(key);
+        if(dead_it != dead_until_.end() && hit.time < dead_it->second) {
+            LOG(TRACE) << "Pixel " << hit.index << " is dead at " << Units::display(hit.time, {"ns", "us"});
+            if(paralyzable_) {
+                dead_it->second = hit.time + dead_time_;
+            }
+            ++dead_cnt_;
+            continue;
+        }
+        if(dead_time_ > 0) {
+            dead_until_[key] = hit.time + dead_time_;
+        }
+
+        // Add the hit to its frame, which cannot have been written yet
+        auto frame = static_cast<uint64_t>(std::floor(hit.time / frame_length_));
+        if(frames_.empty() && !write_empty_frames_) {
+            first_frame_ = frame;
+        }
+        auto offset = frame - first_frame_;
+        if(offset >= frames_.size()) {
+            frames_.resize(offset + 1);
+        }
+        frames_[offset].push_back(hit);
+        ++hits_cnt_;
+    }
+    pending_hits_.erase(pending_hits_.begin(), hit_it);
+    processed_time_ = time;
+
+    // Only keep the pixels which are still dead
+    for(auto dead_it = dead_until_.begin(); dead_it != dead_until_.end();) {
+        if(dead_it->second <= time) {
+            dead_it = dead_until_.erase(dead_it);
+        } else {
+            ++dead_it;
+        }
+    }
+}
+
+void FrameBuilderModule::write_frames(uint64_t end_frame) {
+    if(frames_.empty() && !write_empty_frames_) {
+        first_frame_ = end_frame;
+        return;
+    }
+
+    // Write all frames before the given one, including empty frames only if requested
+    while(first_frame_ < end_frame) {
+        auto frame_start = frame_length_ * static_cast<double>(first_frame_);
+        if(!frames_.empty()) {
+            auto& hits = frames_.front();
+            if(!hits.empty() || write_empty_frames_) {
+                *output_file_ << "=== " << first_frame_ << " " << Units::convert(frame_start, "ns") << " " << hits.size()
+                              << " ===\n";
+                for(const auto& hit : hits) {
+                    *output_file_ << hit.index.x() << " " << hit.index.y() << " " << Units::convert(hit.time, "ns") << " "
+                                  << hit.signal << " " << hit.event << '\n';
+                }
+                ++frames_cnt_;
+            }
+            frames_.pop_front();
+        } else if(write_empty_frames_) {
+            *output_file_ << "=== " << first_frame_ << " " << Units::convert(frame_start, "ns") << " 0 ===\n";
+            ++frames_cnt_;
+        } else {
+            first_frame_ = end_frame;
+            break;
+        }
+        ++first_frame_;
+    }
+}
+
+void FrameBuilderModule::finalize() {
+    // Write all remaining hits, as no further events arrive
+    process_hits(std::numeric_limits<double>::infinity());
+    write_frames(first_frame_ + frames_.size());
+    output_file_->close();
+
+    LOG(STATUS) << "Wrote " << frames_cnt_ << " frames with " << hits_cnt_ << " hits from " << events_cnt_
+                << " events to file:" << std::endl
+                << output_file_name_;
+    if(dead_cnt_ > 0 || late_cnt_ > 0) {
+        LOG(INFO) << "Discarded " << dead_cnt_ << " hits in the dead time of their pixel and " << late_cnt_
+                  << " hits arriving before the start of the previous event";
+    }
+}
@@ -0,0 +1,125 @@
+/**
+ * @file
+ * @brief Definition of a module building time-ordered readout frames from the hits of consecutive events
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_FRAME_BUILDER_MODULE_H
+#define ALLPIX_FRAME_BUILDER_MODULE_H
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/Detector.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/Pixel.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to build time-ordered readout frames of a continuously read out detector
+     *
+     * Every event is placed on a common time line, with a fixed or exponentially distributed time between consecutive
+     * events. The pixel hits of all events are ordered on this time line, the dead time of every pixel is applied across
+     * events, and the hits are written in frames of fixed length as soon as no later event can contribute to them. The
+     * module is run for one event at the time in the order of the event sequence, such that its memory only depends on the
+     * hits and pixels which are active within the dead time and the arrival time of the hits of a single event.
+     */
+    class FrameBuilderModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this detector-specific module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param detector Pointer to the detector for this module instance
+         */
+        FrameBuilderModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector);
+
+        /**
+         * @brief Open the output file for the frames
+         */
+        void init() override;
+
+        /**
+         * @brief Add the hits of the event to the time line and write all frames completed before the start of the event
+         * @param event Pointer to the event
+         */
+        void run(Event* event) override;
+
+        /**
+         * @brief Write the remaining hits and frames and output a summary
+         */
+        void finalize() override;
+
+    private:
+        /**
+         * @brief Hit of a pixel placed on the common time line of all events
+         */
+        struct FrameHit {
+            Pixel::Index index;
+            double time;
+            double signal;
+            unsigned int event;
+        };
+
+        /**
+         * @brief Apply the dead time to all pending hits before the given time and assign them to their frames
+         * @param time Time before which no further hits can arrive
+         */
+        void process_hits(double time);
+
+        /**
+         * @brief Write all frames before the given frame
+         * @param end_frame Number of the first frame which can still receive hits
+         */
+        void write_frames(uint64_t end_frame);
+
+        Messenger* messenger_;
+
+        double event_interval_{};
+        bool poisson_{};
+        double frame_length_{};
+        double dead_time_{};
+        bool paralyzable_{};
+        bool write_empty_frames_{};
+
+        // Start time of the last event on the common time line, and time before which all hits have been processed
+        double event_time_{};
+        double processed_time_{};
+        bool first_event_{true};
+
+        // Hits not yet processed, ordered by their time
+        std::multimap<double, FrameHit> pending_hits_;
+        // Time until which every pixel which recently had a hit is dead
+        std::unordered_map<uint64_t, double> dead_until_;
+        // Ring buffer of the open frames, starting from the frame with the given number
+        std::deque<std::vector<FrameHit>> frames_;
+        uint64_t first_frame_{};
+
+        // Output file with the frames
+        std::string output_file_name_;
+        std::unique_ptr<std::ofstream> output_file_;
+
+        // Statistics
+        unsigned long events_cnt_{};
+        unsigned long frames_cnt_{};
+        unsigned long hits_cnt_{};
+        unsigned long dead_cnt_{};
+        unsigned long late_cnt_{};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_FRAME_BUILDER_MODULE_H */
@@ -10,10 +10,16 @@
 
 #include "GenericPropagationModule.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <cmath>
+#include <deque>
+#include <future>
 #include <limits>
 #include <map>
 #include <memory>
+#include <numeric>
 #include <random>
 #include <sstream>
 #include <string>
@@ -34,13 +40,17 @@
 
 #include "core/config/Configuration.hpp"
 #include "core/messenger/Messenger.hpp"
+#include "core/utils/annotation.h"
 #include "core/utils/file.h"
 #include "core/utils/log.h"
 #include "core/utils/unit.h"
 #include "tools/ROOT.h"
 #include "tools/runge_kutta.h"
+#include "tools/spatial_order.h"
 
 #include "objects/DepositedCharge.hpp"
+#include "objects/PixelCharge.hpp"
+#include "objects/PixelIndexMap.hpp"
 #include "objects/PropagatedCharge.hpp"
 
 using namespace allpix;
@@ -57,10 +67,13 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
     model_ = detector_->getModel();
 
     // Require deposits message for single detector
-    messenger_->bindSingle(this, &GenericPropagationModule::deposits_message_, MsgFlags::REQUIRED);
+    messenger_->bindSingle<DepositedChargeMessage>(this, MsgFlags::REQUIRED);
 
-    // Seed the random generator with the module seed
-    random_generator_.seed(getRandomSeed());
+    // The plots of every detector can be written in parallel to the ones of other modules
+    enable_parallel_finalization();
+
+    // Register the counter for the performance statistics
+    runge_kutta_steps_ = &get_counter("runge_kutta_steps");
 
     // Set default value for config variables
     config_.setDefault<double>("spatial_precision", Units::get(0.25, "nm"));
@@ -69,7 +82,20 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
     config_.setDefault<double>("timestep_max", Units::get(0.5, "ns"));
     config_.setDefault<double>("integration_time", Units::get(25, "ns"));
     config_.setDefault<unsigned int>("charge_per_step", 10);
+    config_.setDefault<unsigned int>("max_charge_per_step", config_.get<unsigned int>("charge_per_step"));
+    config_.setDefault<double>("split_length_scale", Units::get(10.0, "um"));
+    config_.setDefault<unsigned int>("batch_size", 16);
+    config_.setDefault<unsigned int>("sets_per_task", 1024);
+    config_.setDefault<bool>("spatial_sorting", false);
+    config_.setDefault<std::string>("integrator", "rk5");
     config_.setDefault<double>("temperature", 293.15);
+    config_.setDefault<std::string>("mobility_model", "jacoboni");
+    config_.setDefault<double>("doping_concentration", 0);
+    config_.setDefault<size_t>("mobility_table_bins", 0);
+    config_.setDefault<double>("mobility_table_max_field", Units::get(100.0, "kV/cm"));
+    config_.setDefault<bool>("fast_math", false);
+    config_.setDefault<bool>("precompute_velocity", false);
+    config_.setDefault<double>("fluence", 0);
 
     config_.setDefault<bool>("output_linegraphs", false);
     config_.setDefault<bool>("output_animations", false);
@@ -82,6 +108,8 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
     config_.setDefault<double>("output_plots_theta", 0.0f);
     config_.setDefault<double>("output_plots_phi", 0.0f);
     config_.setDefault<bool>("output_plots_lines_at_implants", false);
+    config_.setDefault<size_t>("output_plots_max_lines", 0);
+    config_.setDefault<size_t>("output_plots_max_points", 0);
 
     // Set defaults for charge carrier propagation:
     config_.setDefault<bool>("propagate_electrons", true);
@@ -94,6 +122,20 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
     }
 
     config_.setDefault<bool>("ignore_magnetic_field", false);
+    config_.setDefault<bool>("analytic_propagation", false);
+    config_.setDefault<bool>("charge_cloud", false);
+    config_.setDefault<bool>("pair_carriers", false);
+
+    // By default, propagate until the sensor surface is reached, using the collection volume of SimpleTransfer if stopped
+    config_.setDefault<bool>("stop_at_collection", false);
+    config_.setDefault<double>("collection_depth", Units::get(5.0, "um"));
+    config_.setDefault<bool>("collect_from_implant", false);
+    config_.setDefault<double>("coalesce_time_bin", 0);
+    config_.setDefault<bool>("transfer_charges", false);
+    config_.setDefault<double>("max_depth_distance", Units::get(5.0, "um"));
+    config_.setDefault<uint64_t>("max_steps", 0);
+    config_.setDefault<double>("event_time_budget", 0);
+    config_.setDefault<size_t>("report_slowest_events", 5);
 
     // Copy some variables from configuration to avoid lookups:
     temperature_ = config_.get<double>("temperature");
@@ -103,24 +145,107 @@ GenericPropagationModule::GenericPropagationModule(Configuration& config,
     integration_time_ = config_.get<double>("integration_time");
     target_spatial_precision_ = config_.get<double>("spatial_precision");
     output_plots_ = config_.get<bool>("output_plots");
+    fast_math_ = config_.get<bool>("fast_math");
+    precompute_velocity_ = config_.get<bool>("precompute_velocity");
+    roi_ = RegionOfInterest(config_, *detector_);
     output_linegraphs_ = config_.get<bool>("output_linegraphs");
     output_animations_ = config_.get<bool>("output_animations");
     output_plots_step_ = config_.get<double>("output_plots_step");
     output_plots_lines_at_implants_ = config_.get<bool>("output_plots_lines_at_implants");
+    output_plots_max_lines_ = config_.get<size_t>("output_plots_max_lines");
+    output_plots_max_points_ = config_.get<size_t>("output_plots_max_points");
+    if(output_plots_max_points_ == 1) {
+        throw InvalidValueError(config_, "output_plots_max_points", "drift lines require at least two points");
+    }
+    batch_size_ = config_.get<unsigned int>("batch_size");
+    sets_per_task_ = config_.get<unsigned int>("sets_per_task");
+    spatial_sorting_ = config_.get<bool>("spatial_sorting");
+    pair_carriers_ = config_.get<bool>("pair_carriers");
+    auto integrator = config_.get<std::string>("integrator");
+    std::transform(integrator.begin(), integrator.end(), integrator.begin(), ::tolower);
+    if(integrator == "rk5") {
+        integrator_ = Integrator::RK5;
+    } else if(integrator == "rk4") {
+        integrator_ = Integrator::RK4;
+    } else if(integrator == "euler") {
+        integrator_ = Integrator::EULER;
+    } else {
+        throw InvalidValueError(config_, "integrator", "integrator should be 'rk5', 'rk4' or 'euler'");
+    }
+    charge_per_step_ = config_.getParameter<unsigned int>("charge_per_step");
+    max_charge_per_step_ = config_.get<unsigned int>("max_charge_per_step");
+    split_length_scale_ = config_.get<double>("split_length_scale");
+    if(max_charge_per_step_ < charge_per_step_) {
+        throw InvalidValueError(
+            config_, "max_charge_per_step", "maximum number of charges per set cannot be smaller than 'charge_per_step'");
+    }
+    if(split_length_scale_ <= 0) {
+        throw InvalidValueError(config_, "split_length_scale", "length scale for splitting sets should be positive");
+    }
+    adaptive_grouping_ = (max_charge_per_step_ > charge_per_step_);
+    if(adaptive_grouping_ && config_.get<bool>("output_linegraphs")) {
+        LOG(WARNING) << "Adaptive splitting of sets of charges does not provide drift lines, using fixed sets instead";
+        adaptive_grouping_ = false;
+        max_charge_per_step_ = charge_per_step_;
+    }
+    max_steps_ = config_.get<uint64_t>("max_steps");
+    event_time_budget_ = config_.get<double>("event_time_budget");
+    if(event_time_budget_ < 0) {
+        throw InvalidValueError(config_, "event_time_budget", "wall-clock budget per event cannot be negative");
+    }
+    report_slowest_events_ = config_.get<size_t>("report_slowest_events");
+    propagate_electrons_ = config_.getParameter<bool>("propagate_electrons");
+    propagate_holes_ = config_.getParameter<bool>("propagate_holes");
+    analytic_propagation_ = config_.get<bool>("analytic_propagation");
+    stop_at_collection_ = config_.get<bool>("stop_at_collection");
+    collect_from_implant_ = config_.get<bool>("collect_from_implant");
+    auto collection_depth = config_.get<double>("collection_depth");
+    if(collection_depth < 0) {
+        throw InvalidValueError(config_, "collection_depth", "depth of the collection volume cannot be negative");
+    }
+    collection_plane_z_ = model_->getSensorCenter().z() + model_->getSensorSize().z() / 2.0 - collection_depth;
+    coalesce_time_bin_ = config_.get<double>("coalesce_time_bin");
+    if(coalesce_time_bin_ < 0) {
+        throw InvalidValueError(config_, "coalesce_time_bin", "width of the time bins cannot be negative");
+    }
+    if(coalesce_time_bin_ > 0 && !stop_at_collection_ && !analytic_propagation_) {
+        LOG(WARNING) << "Sets of charges are only coalesced in the collection volume, which requires stop_at_collection";
+    }
+    transfer_charges_ = config_.get<bool>("transfer_charges");
+    max_depth_distance_ = config_.get<double>("max_depth_distance");
+    if(batch_size_ == 0) {
+        throw InvalidValueError(config_, "batch_size", "number of sets of charges per batch should be strictly positive");
+    }
+    if(sets_per_task_ == 0) {
+        throw InvalidValueError(config_, "sets_per_task", "number of sets of charges per task should be strictly positive");
+    }
 
     // Enable parallelization of this module if multithreading is enabled and no per-event output plots are requested:
     if(!(output_animations_ || output_linegraphs_)) {
         enable_parallelization();
     }
 
-    // Parameterization variables from https://doi.org/10.1016/0038-1101(77)90054-5 (section 5.2)
-    electron_Vm_ = Units::get(1.53e9 * std::pow(temperature_, -0.87), "cm/s");
-    electron_Ec_ = Units::get(1.01 * std::pow(temperature_, 1.55), "V/cm");
-    electron_Beta_ = 2.57e-2 * std::pow(temperature_, 0.66);
+    // Create the mobility model and tabulate it for both carrier types if requested
+    mobility_model_ = create_mobility_model(config_, temperature_);
+    mobility_tables_ = create_mobility_tables(config_, mobility_model_.get());
 
-    hole_Vm_ = Units::get(1.62e8 * std::pow(temperature_, -0.52), "cm/s");
-    hole_Ec_ = Units::get(1.24 * std::pow(temperature_, 1.68), "V/cm");
-    hole_Beta_ = 0.46 * std::pow(temperature_, 0.17);
+    // Effective trapping times of electrons and holes, infinite without irradiation
+    auto fluence = config_.get<double>("fluence");
+    if(fluence < 0) {
+        throw InvalidValueError(config_, "fluence", "fluence cannot be negative");
+    }
+    trapping_times_ = effective_trapping_times(fluence, temperature_);
+
+    // Propagate every deposit as a single cloud, which cannot be split or trapped as a whole
+    charge_cloud_ = config_.get<bool>("charge_cloud");
+    if(charge_cloud_ && (std::isfinite(trapping_times_[0]) || std::isfinite(trapping_times_[1]))) {
+        LOG(WARNING) << "Charge clouds cannot be trapped as a whole, propagating sets of charges instead";
+        charge_cloud_ = false;
+    }
+    if(charge_cloud_) {
+        adaptive_grouping_ = false;
+        max_charge_per_step_ = charge_per_step_;
+    }
 
     boltzmann_kT_ = Units::get(8.6173e-5, "eV/K") * temperature_;
 
@@ -136,7 +261,7 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
     // Convert to pixel units if necessary
     if(config_.get<bool>("output_plots_use_pixel_units")) {
         for(auto& deposit_points : output_plot_points_) {
-            for(auto& point : deposit_points.second) {
+            for(auto& point : deposit_points.points) {
                 point.SetX((point.x() / model_->getPixelSize().x()) + 1);
                 point.SetY((point.y() / model_->getPixelSize().y()) + 1);
             }
@@ -151,18 +276,18 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
     unsigned int total_charge = 0;
     unsigned int max_charge = 0;
     for(auto& deposit_points : output_plot_points_) {
-        for(auto& point : deposit_points.second) {
+        for(auto& point : deposit_points.points) {
             minX = std::min(minX, point.x());
             maxX = std::max(maxX, point.x());
 
             minY = std::min(minY, point.y());
             maxY = std::max(maxY, point.y());
         }
-        start_time = std::min(start_time, deposit_points.first.getEventTime());
-        total_charge += deposit_points.first.getCharge();
-        max_charge = std::max(max_charge, deposit_points.first.getCharge());
+        start_time = std::min(start_time, deposit_points.charge.getEventTime());
+        total_charge += deposit_points.charge.getCharge();
+        max_charge = std::max(max_charge, deposit_points.charge.getCharge());
 
-        tot_point_cnt += deposit_points.second.size();
+        tot_point_cnt += deposit_points.frames();
     }
 
     // Compute frame axis sizes if equal scaling is requested
@@ -241,12 +366,13 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
     short current_color = 1;
     for(auto& deposit_points : output_plot_points_) {
         auto line = std::make_unique<TPolyLine3D>();
-        for(auto& point : deposit_points.second) {
+        for(auto& point : deposit_points.points) {
             line->SetNextPoint(point.x(), point.y(), point.z());
         }
         // Plot all lines with at least three points with different color
         if(line->GetN() >= 3) {
-            EColor plot_color = (deposit_points.first.getType() == CarrierType::ELECTRON ? EColor::kAzure : EColor::kOrange);
+            EColor plot_color =
+                (deposit_points.charge.getType() == CarrierType::ELECTRON ? EColor::kAzure : EColor::kOrange);
             current_color = static_cast<short int>(plot_color - 9 + (static_cast<int>(current_color) + 1) % 19);
             line->SetLineColor(current_color);
             line->Draw("same");
@@ -375,23 +501,23 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
 
             // Plot all the required points
             for(auto& deposit_points : output_plot_points_) {
-                auto points = deposit_points.second;
+                const auto& points = deposit_points.points;
 
-                auto diff = static_cast<unsigned long>(std::round((deposit_points.first.getEventTime() - start_time) /
+                auto diff = static_cast<unsigned long>(std::round((deposit_points.charge.getEventTime() - start_time) /
                                                                   config_.get<long double>("output_plots_step")));
                 if(static_cast<long>(plot_idx) - static_cast<long>(diff) < 0) {
                     min_idx_diff = std::min(min_idx_diff, diff - plot_idx);
                     continue;
                 }
                 auto idx = plot_idx - diff;
-                if(idx >= points.size()) {
+                if(idx >= deposit_points.frames()) {
                     continue;
                 }
                 min_idx_diff = 0;
 
                 auto marker = std::make_unique<TPolyMarker3D>();
                 marker->SetMarkerStyle(kFullCircle);
-                marker->SetMarkerSize(static_cast<float>(deposit_points.first.getCharge() *
+                marker->SetMarkerSize(static_cast<float>(deposit_points.charge.getCharge() *
                                                          config_.get<double>("output_animations_marker_size", 1)) /
                                       static_cast<float>(max_charge));
                 auto initial_z_perc = static_cast<int>(
@@ -400,13 +526,15 @@ void GenericPropagationModule::create_output_plots(unsigned int event_num) {
                 if(config_.get<bool>("output_animations_color_markers")) {
                     marker->SetMarkerColor(static_cast<Color_t>(colors[initial_z_perc]->GetNumber()));
                 }
-                marker->SetNextPoint(points[idx].x(), points[idx].y(), points[idx].z());
+                // Lines with reduced sampling show their last sampled point until the next one
+                const auto& point = points[idx / deposit_points.stride];
+                marker->SetNextPoint(point.x(), point.y(), point.z());
                 marker->Draw();
                 markers.push_back(std::move(marker));
 
-                histogram_contour[0]->Fill(points[idx].y(), points[idx].z(), deposit_points.first.getCharge());
-                histogram_contour[1]->Fill(points[idx].x(), points[idx].z(), deposit_points.first.getCharge());
-                histogram_contour[2]->Fill(points[idx].x(), points[idx].y(), deposit_points.first.getCharge());
+                histogram_contour[0]->Fill(point.y(), point.z(), deposit_points.charge.getCharge());
+                histogram_contour[1]->Fill(point.x(), point.z(), deposit_points.charge.getCharge());
+                histogram_contour[2]->Fill(point.x(), point.y(), deposit_points.charge.getCharge());
                 ++point_cnt;
             }
 
@@ -493,14 +621,35 @@ void GenericPropagationModule::init() {
         auto efield = detector->getElectricField(probe_point);
         auto direction = std::signbit(efield.z());
         // Compare with propagated carrier type:
-        if(direction && !config_.get<bool>("propagate_electrons")) {
+        if(direction && !propagate_electrons_) {
             LOG(WARNING) << "Electric field indicates electron collection at implants, but electrons are not propagated!";
         }
-        if(!direction && !config_.get<bool>("propagate_holes")) {
+        if(!direction && !propagate_holes_) {
             LOG(WARNING) << "Electric field indicates hole collection at implants, but holes are not propagated!";
         }
     }
 
+    // Report the mobility model and its tabulation
+    auto mobility_table_bins = config_.get<size_t>("mobility_table_bins");
+    if(mobility_table_bins > 0) {
+        LOG(INFO) << "Tabulated " << config_.get<std::string>("mobility_model") << " mobility model in "
+                  << mobility_table_bins << " bins up to "
+                  << Units::display(config_.get<double>("mobility_table_max_field"), {"V/cm", "kV/cm"});
+    } else {
+        LOG(DEBUG) << "Using " << config_.get<std::string>("mobility_model") << " mobility model";
+    }
+    if(fast_math_) {
+        LOG(INFO) << "Using fast approximations of the mobility and the Ziggurat sampler for the diffusion";
+    }
+    if(roi_.isRestricted()) {
+        LOG(INFO) << "Propagating only charges deposited in the region of interest of " << roi_.describe();
+    }
+
+    if(std::isfinite(trapping_times_[0])) {
+        LOG(INFO) << "Effective trapping time of electrons " << Units::display(trapping_times_[0], {"ps", "ns"})
+                  << " and of holes " << Units::display(trapping_times_[1], {"ps", "ns"});
+    }
+
     // Check for magnetic field
     has_magnetic_field_ = detector->hasMagneticField();
     if(has_magnetic_field_) {
@@ -510,63 +659,192 @@ void GenericPropagationModule::init() {
         } else {
             LOG(DEBUG) << "This detector sees a magnetic field.";
             magnetic_field_ = detector_->getMagneticField();
+            has_magnetic_field_grid_ = detector_->hasMagneticFieldGrid();
+        }
+    }
+
+    // Tabulate the drift velocity of all carrier types on the grid of the electric field
+    if(precompute_velocity_) {
+        if(detector->getElectricFieldType() != FieldType::GRID) {
+            LOG(WARNING) << "Precomputing the drift velocity requires an electric field grid, computing it in every stage "
+                            "instead";
+            precompute_velocity_ = false;
+        } else if(has_magnetic_field_) {
+            LOG(WARNING) << "Precomputing the drift velocity is not possible in a magnetic field, computing it in every "
+                            "stage instead";
+            precompute_velocity_ = false;
+        }
+    }
+    if(precompute_velocity_) {
+        for(auto type : {CarrierType::ELECTRON, CarrierType::HOLE}) {
+            if((type == CarrierType::ELECTRON && !propagate_electrons_) ||
+               (type == CarrierType::HOLE && !propagate_holes_)) {
+                continue;
+            }
+            const double sign = static_cast<int>(type);
+            const auto& mobility = mobility_tables_[type == CarrierType::ELECTRON ? 0 : 1];
+            velocity_fields_[type == CarrierType::ELECTRON ? 0 : 1] =
+                detector_->deriveElectricFieldGrid([sign, &mobility](const ROOT::Math::XYZVector& efield) {
+                    return sign * mobility(std::sqrt(efield.Mag2())) * efield;
+                });
+        }
+        LOG(INFO) << "Looking up the drift velocity from grids precomputed on the electric field grid";
+    }
+
+    if(adaptive_grouping_) {
+        LOG(INFO) << "Splitting sets of up to " << max_charge_per_step_ << " charges into sets of "
+                  << static_cast<unsigned int>(charge_per_step_) << " charges where the field varies on less than "
+                  << Units::display(split_length_scale_, {"um"});
+    }
+
+    if(output_linegraphs_ && (output_plots_max_lines_ > 0 || output_plots_max_points_ > 0)) {
+        LOG(INFO) << "Drawing at most " << output_plots_max_lines_ << " drift lines per event with at most "
+                  << output_plots_max_points_ << " points each, zero meaning unlimited";
+    }
+
+    // Check the collection volume the propagation is stopped in
+    if(stop_at_collection_) {
+        if(collect_from_implant_) {
+            if(detector->getElectricFieldType() == FieldType::LINEAR) {
+                throw ModuleError("Charge collection from implant region should not be used with linear electric fields.");
+            }
+            LOG(INFO) << "Stopping propagation in implants with size "
+                      << Units::display(detector_->getModel()->getImplantSize(), {"um"}) << " and depth "
+                      << Units::display(config_.get<double>("collection_depth"), {"um"});
+        } else {
+            LOG(INFO) << "Stopping propagation at depth "
+                      << Units::display(config_.get<double>("collection_depth"), {"um"}) << " below the implant side";
+        }
+    }
+    if(coalesce_time_bin_ > 0) {
+        LOG(INFO) << "Coalescing collected sets of charges of the same deposit per pixel in time bins of "
+                  << Units::display(coalesce_time_bin_, {"ps", "ns"});
+    }
+
+    if(charge_cloud_) {
+        LOG(INFO) << "Propagating every deposit as a single Gaussian charge cloud";
+    }
+    if(pair_carriers_ && propagate_electrons_ && propagate_holes_) {
+        LOG(INFO) << "Propagating the electrons and holes of every deposit together";
+    }
+
+    // Only create the propagated charges in the fused mode if another module receives them
+    if(transfer_charges_) {
+        output_propagated_ = messenger_->hasReceiver(
+            this, std::make_shared<PropagatedChargeMessage>(std::vector<PropagatedCharge>(), detector_));
+        LOG(INFO) << "Transferring the propagated charges to the nearest pixels directly"
+                  << (output_propagated_ ? ", creating the propagated charges for their receivers" : "");
+    }
+
+    // Tabulate the drift of all carrier types if the field only depends on the depth
+    if(analytic_propagation_) {
+        auto field_type = detector->getElectricFieldType();
+        if(field_type != FieldType::LINEAR && field_type != FieldType::CONSTANT) {
+            LOG(WARNING) << "Analytic propagation requires a linear or constant electric field, integrating the drift "
+                            "instead";
+            analytic_propagation_ = false;
+        } else if(has_magnetic_field_) {
+            LOG(WARNING) << "Analytic propagation is not possible in a magnetic field, integrating the drift instead";
+            analytic_propagation_ = false;
+        } else if(output_linegraphs_) {
+            LOG(WARNING) << "Analytic propagation does not provide drift lines, integrating the drift instead";
+            analytic_propagation_ = false;
+        }
+    }
+    if(analytic_propagation_) {
+        for(auto type : {CarrierType::ELECTRON, CarrierType::HOLE}) {
+            if((type == CarrierType::ELECTRON && !propagate_electrons_) ||
+               (type == CarrierType::HOLE && !propagate_holes_)) {
+                continue;
+            }
+            auto& table = drift_tables_[type == CarrierType::ELECTRON ? 0 : 1];
+            table = build_drift_table(type);
+            if(table.valid) {
+                LOG(INFO) << "Propagating " << type << " analytically using a drift table with " << table.time.size() - 1
+                          << " slices";
+            } else {
+                LOG(WARNING) << "Electric field does not allow analytic propagation of " << type
+                             << ", integrating the drift instead";
+            }
         }
     }
 
     if(output_plots_) {
-        step_length_histo_ = new TH1D("step_length_histo",
-                                      "Step length;length [#mum];integration steps",
-                                      100,
-                                      0,
-                                      static_cast<double>(Units::convert(0.25 * model_->getSensorSize().z(), "um")));
-
-        drift_time_histo_ = new TH1D("drift_time_histo",
-                                     "Drift time;Drift time [ns];charge carriers",
-                                     static_cast<int>(Units::convert(integration_time_, "ns") * 5),
-                                     0,
-                                     static_cast<double>(Units::convert(integration_time_, "ns")));
-
-        uncertainty_histo_ =
-            new TH1D("uncertainty_histo",
-                     "Position uncertainty;uncertainty [nm];integration steps",
-                     100,
-                     0,
-                     static_cast<double>(4 * Units::convert(config_.get<double>("spatial_precision"), "nm")));
-
-        group_size_histo_ = new TH1D("group_size_histo",
-                                     "Charge carrier group size;group size;number of groups trasnported",
-                                     config_.get<int>("charge_per_step") - 1,
-                                     1,
-                                     static_cast<double>(config_.get<unsigned int>("charge_per_step")));
+        step_length_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "step_length_histo",
+            "Step length;length [#mum];integration steps",
+            100,
+            0,
+            static_cast<double>(Units::convert(0.25 * model_->getSensorSize().z(), "um")));
+
+        drift_time_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "drift_time_histo",
+            "Drift time;Drift time [ns];charge carriers",
+            static_cast<int>(Units::convert(integration_time_, "ns") * 5),
+            0,
+            static_cast<double>(Units::convert(integration_time_, "ns")));
+
+        uncertainty_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "uncertainty_histo",
+            "Position uncertainty;uncertainty [nm];integration steps",
+            100,
+            0,
+            static_cast<double>(4 * Units::convert(config_.get<double>("spatial_precision"), "nm")));
+
+        group_size_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "group_size_histo",
+            "Charge carrier group size;group size;number of groups trasnported",
+            static_cast<int>(max_charge_per_step_) - 1,
+            1,
+            static_cast<double>(max_charge_per_step_));
     }
 }
 
-void GenericPropagationModule::run(unsigned int event_num) {
+void GenericPropagationModule::run(Event* event) {
+    // The propagation of the remaining sets of charges is terminated once the wall-clock budget of the event is exceeded
+    auto start_time = std::chrono::steady_clock::now();
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    if(event_time_budget_ > 0) {
+        deadline = start_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                    std::chrono::duration<double>(Units::convert(event_time_budget_, "s")));
+    }
 
-    // Create vector of propagated charges to output
-    std::vector<PropagatedCharge> propagated_charges;
+    auto deposits_message = messenger_->fetchMessage<DepositedChargeMessage>(this, event);
 
-    // Loop over all deposits for propagation
+    // Split all deposits into sets of charges to propagate
     LOG(TRACE) << "Propagating charges in sensor";
-    unsigned int propagated_charges_count = 0;
-    unsigned int step_count = 0;
-    long double total_time = 0;
-    for(auto& deposit : deposits_message_->getData()) {
+    std::vector<ChargeGroup> groups;
+    for(auto& deposit : deposits_message->getData()) {
 
-        if((deposit.getType() == CarrierType::ELECTRON && !config_.get<bool>("propagate_electrons")) ||
-           (deposit.getType() == CarrierType::HOLE && !config_.get<bool>("propagate_holes"))) {
+        if((deposit.getType() == CarrierType::ELECTRON && !propagate_electrons_) ||
+           (deposit.getType() == CarrierType::HOLE && !propagate_holes_)) {
             LOG(DEBUG) << "Skipping charge carriers (" << deposit.getType() << ") on "
                        << Units::display(deposit.getLocalPosition(), {"mm", "um"});
             continue;
         }
 
+        // Skip deposits which cannot reach the region of interest before any integration of their paths
+        if(!roi_.contains(deposit.getLocalPosition())) {
+            ++skipped_deposits_.local();
+            continue;
+        }
+
         // Loop over all charges in the deposit
         unsigned int charges_remaining = deposit.getCharge();
 
         LOG(DEBUG) << "Set of charge carriers (" << deposit.getType() << ") on "
                    << Units::display(deposit.getLocalPosition(), {"mm", "um"});
 
-        auto charge_per_step = config_.get<unsigned int>("charge_per_step");
+        // Use larger sets if they are split during the integration of the drift
+        unsigned int charge_per_step = charge_per_step_;
+        const auto& table = drift_tables_[deposit.getType() == CarrierType::ELECTRON ? 0 : 1];
+        if(adaptive_grouping_ && !(analytic_propagation_ && table.valid)) {
+            charge_per_step = max_charge_per_step_;
+        }
+        // Propagate all charges of the deposit together as a single cloud if requested
+        if(charge_cloud_) {
+            charge_per_step = charges_remaining;
+        }
         while(charges_remaining > 0) {
             // Define number of charges to be propagated and remove charges of this step from the total
             if(charge_per_step > charges_remaining) {
@@ -574,242 +852,1187 @@ void GenericPropagationModule::run(unsigned int event_num) {
             }
             charges_remaining -= charge_per_step;
 
-            // Get position and propagate through sensor
-            auto position = deposit.getLocalPosition();
+            // Every set draws its own seed such that the result does not depend on the order of propagation
+            ChargeGroup group;
+            group.deposit = &deposit;
+            group.charge = charge_per_step;
+            group.seed = event->getRandomNumber();
+            group.position = deposit.getLocalPosition();
+            groups.push_back(group);
+        }
+    }
 
-            // Add point of deposition to the output plots if requested
-            if(output_linegraphs_) {
-                auto global_position = detector_->getGlobalPosition(position);
-                output_plot_points_.emplace_back(
-                    PropagatedCharge(position, global_position, deposit.getType(), charge_per_step, deposit.getEventTime()),
-                    std::vector<ROOT::Math::XYZPoint>());
+    // Add the points of deposition to the output plots if requested, for a random sample of the sets if limited
+    if(output_linegraphs_) {
+        std::vector<size_t> plotted;
+        if(output_plots_max_lines_ > 0 && groups.size() > output_plots_max_lines_) {
+            // Reservoir sampling with an engine seeded from the event, keeping the order of the sets
+            std::mt19937_64 sample_engine(event->getRandomNumber());
+            for(size_t idx = 0; idx < groups.size(); ++idx) {
+                if(plotted.size() < output_plots_max_lines_) {
+                    plotted.push_back(idx);
+                    continue;
+                }
+                auto replace = std::uniform_int_distribution<size_t>(0, idx)(sample_engine);
+                if(replace < output_plots_max_lines_) {
+                    plotted[replace] = idx;
+                }
             }
+            std::sort(plotted.begin(), plotted.end());
+        } else {
+            plotted.resize(groups.size());
+            std::iota(plotted.begin(), plotted.end(), 0);
+        }
 
-            // Propagate a single charge deposit
-            auto prop_pair = propagate(position, deposit.getType());
-            position = prop_pair.first;
+        for(auto idx : plotted) {
+            auto& group = groups[idx];
+            const auto& deposit = *group.deposit;
+            auto global_position = detector_->getGlobalPosition(group.position);
+            output_plot_points_.emplace_back(PropagatedCharge(
+                group.position, global_position, deposit.getType(), group.charge, deposit.getEventTime()));
+            group.plot = true;
+            group.plot_index = output_plot_points_.size() - 1;
+        }
+    }
 
-            LOG(DEBUG) << " Propagated " << charge_per_step << " to " << Units::display(position, {"mm", "um"}) << " in "
-                       << Units::display(prop_pair.second, "ns") << " time";
+    // Propagate the sets of charges along a space-filling curve if requested, such that consecutive sets access the same
+    // regions of the field maps, the propagated charges are still stored in the order of the deposits
+    std::vector<size_t> order(groups.size());
+    if(spatial_sorting_) {
+        order = morton_order(groups, [](const ChargeGroup& group) { return group.position; });
+    } else {
+        std::iota(order.begin(), order.end(), 0);
+    }
+
+    // Propagate all sets of charges grouped by carrier type, split into tasks which can be executed by idle workers. If the
+    // carriers are paired, the electrons and holes of every deposit stay next to each other in the same batches instead
+    std::vector<std::vector<size_t>> selections;
+    if(pair_carriers_) {
+        selections.push_back(std::move(order));
+    } else {
+        for(auto type : {CarrierType::ELECTRON, CarrierType::HOLE}) {
+            std::vector<size_t> pending;
+            for(auto idx : order) {
+                if(groups[idx].deposit->getType() == type) {
+                    pending.push_back(idx);
+                }
+            }
+            selections.push_back(std::move(pending));
+        }
+    }
+    auto& thread_pool = getThreadPool();
+    ThreadPool::TaskGroup task_group;
+    std::vector<std::future<void>> tasks;
+    std::deque<std::deque<ChargeGroup>> split_groups;
+    for(auto& pending : selections) {
+        for(size_t start = 0; start < pending.size(); start += sets_per_task_) {
+            auto end = std::min(start + sets_per_task_, pending.size());
+            std::vector<size_t> task_groups(pending.begin() + static_cast<std::ptrdiff_t>(start),
+                                            pending.begin() + static_cast<std::ptrdiff_t>(end));
+            split_groups.emplace_back();
+            auto& task_splits = split_groups.back();
+            tasks.push_back(thread_pool.submit(task_group, [this, &groups, &task_splits, task_groups, deadline]() {
+                propagate(groups, task_groups, task_splits, deadline);
+            }));
+        }
+    }
+
+    // Help executing the tasks and wait for all tasks of this event to finish
+    thread_pool.wait_for(task_group);
+    for(auto& task : tasks) {
+        task.get();
+    }
+
+    // Add the sets of charges split off during the propagation
+    for(auto& task_splits : split_groups) {
+        groups.insert(groups.end(), task_splits.begin(), task_splits.end());
+    }
+
+    // Create vector of propagated charges to output, which is skipped in the fused mode if they are not received
+    auto create_propagated = !transfer_charges_ || output_propagated_;
+    auto propagated_charges = MessageStorage<PropagatedCharge>::acquire();
+    if(create_propagated) {
+        propagated_charges.reserve(groups.size());
+    }
+
+    // Convert the final positions of all sets of charges to global coordinates at once
+    std::vector<ROOT::Math::XYZPoint> global_positions;
+    if(create_propagated) {
+        std::vector<ROOT::Math::XYZPoint> local_positions;
+        local_positions.reserve(groups.size());
+        for(auto& group : groups) {
+            local_positions.push_back(group.position);
+        }
+        global_positions = detector_->getGlobalPositions(local_positions);
+    }
+
+    // Sets of charges of the same deposit collected at the same pixel in the same time bin, merged into one charge
+    std::map<CoalescingKey, CoalescedCharge> coalesced_charges;
+    const auto& geometry = detector_->getGeometry();
 
+    // In the fused mode, add the charge to its nearest pixel, linking the last propagated charge if these are created
+    PixelIndexMap<std::pair<unsigned int, std::vector<size_t>>> pixel_map;
+    unsigned int transferred_charges_count = 0;
+    auto transfer_charge = [&](const ROOT::Math::XYZPoint& position, unsigned int charge) {
+        if(std::fabs(position.z() - geometry.implantSurface()) > max_depth_distance_) {
+            return;
+        }
+        auto xpixel = geometry.nearestColumn(position.x());
+        auto ypixel = geometry.nearestRow(position.y());
+        if(!geometry.isWithinPixelGrid(xpixel, ypixel) ||
+           (collect_from_implant_ && !geometry.isWithinImplant(position.x(), position.y(), xpixel, ypixel))) {
+            return;
+        }
+
+        auto& pixel_charge = pixel_map[Pixel::Index(static_cast<unsigned int>(xpixel), static_cast<unsigned int>(ypixel))];
+        pixel_charge.first += charge;
+        if(create_propagated) {
+            pixel_charge.second.push_back(propagated_charges.size() - 1);
+        }
+        transferred_charges_count += charge;
+    };
+
+    unsigned int propagated_charges_count = 0;
+    unsigned int step_count = 0;
+    long double total_time = 0;
+    std::array<unsigned int, 6> terminations{};
+    for(size_t idx = 0; idx < groups.size(); ++idx) {
+        auto& group = groups[idx];
+        LOG(DEBUG) << " Propagated " << group.charge << " to " << Units::display(group.position, {"mm", "um"}) << " in "
+                   << Units::display(group.time, "ns") << " time";
+
+        if(coalesce_time_bin_ > 0 && group.termination == Termination::COLLECTED && !(charge_cloud_ && group.variance > 0)) {
+            // Bin the collected set of charges by its pixel and arrival time, accumulating the charge-weighted mean
+            auto event_time = group.deposit->getEventTime() + group.time;
+            auto column = geometry.nearestColumn(group.position.x());
+            auto row = geometry.nearestRow(group.position.y());
+            CoalescingKey key{group.deposit,
+                              column,
+                              row,
+                              geometry.isWithinImplant(group.position.x(), group.position.y(), column, row),
+                              static_cast<long long>(std::floor(event_time / coalesce_time_bin_))};
+            auto& coalesced = coalesced_charges[key];
+            auto weight = static_cast<double>(group.charge);
+            coalesced.position += weight * static_cast<ROOT::Math::XYZVector>(group.position);
+            coalesced.event_time += weight * event_time;
+            coalesced.charge += group.charge;
+        } else if(charge_cloud_ && group.variance > 0) {
+            // Add the charge of the cloud in every pixel cell it covers at the center of the cell
+            for(auto& cell : integrate_cloud(group)) {
+                if(create_propagated) {
+                    propagated_charges.emplace_back(cell.first,
+                                                    detector_->getGlobalPosition(cell.first),
+                                                    group.deposit->getType(),
+                                                    cell.second,
+                                                    group.deposit->getEventTime() + group.time,
+                                                    group.deposit);
+                }
+                if(transfer_charges_) {
+                    transfer_charge(cell.first, cell.second);
+                }
+            }
+        } else {
             // Create a new propagated charge and add it to the list
-            auto global_position = detector_->getGlobalPosition(position);
-            PropagatedCharge propagated_charge(position,
-                                               global_position,
-                                               deposit.getType(),
-                                               charge_per_step,
-                                               deposit.getEventTime() + prop_pair.second,
-                                               &deposit);
+            if(create_propagated) {
+                PropagatedCharge propagated_charge(group.position,
+                                                   global_positions[idx],
+                                                   group.deposit->getType(),
+                                                   group.charge,
+                                                   group.deposit->getEventTime() + group.time,
+                                                   group.deposit);
+
+                propagated_charges.push_back(std::move(propagated_charge));
+            }
+            if(transfer_charges_) {
+                transfer_charge(group.position, group.charge);
+            }
+        }
 
-            propagated_charges.push_back(std::move(propagated_charge));
+        // Update statistical information
+        ++step_count;
+        propagated_charges_count += group.charge;
+        terminations[static_cast<size_t>(group.termination)] += group.charge;
+        total_time += group.charge * group.time;
+        if(output_plots_) {
+            drift_time_histo_->Fill(group.time / units::ns, group.charge);
+            group_size_histo_->Fill(group.charge);
+        }
+    }
 
-            // Update statistical information
-            ++step_count;
-            propagated_charges_count += charge_per_step;
-            total_time += charge_per_step * prop_pair.second;
-            if(output_plots_) {
-                drift_time_histo_->Fill(static_cast<double>(Units::convert(prop_pair.second, "ns")), charge_per_step);
-                group_size_histo_->Fill(charge_per_step);
+    // Add the coalesced sets of charges at their charge-weighted mean position and time
+    if(!coalesced_charges.empty()) {
+        std::vector<ROOT::Math::XYZPoint> coalesced_positions;
+        coalesced_positions.reserve(coalesced_charges.size());
+        for(auto& key_charge : coalesced_charges) {
+            auto& coalesced = key_charge.second;
+            coalesced_positions.emplace_back(coalesced.position / static_cast<double>(coalesced.charge));
+        }
+        std::vector<ROOT::Math::XYZPoint> coalesced_global_positions;
+        if(create_propagated) {
+            coalesced_global_positions = detector_->getGlobalPositions(coalesced_positions);
+        }
+
+        size_t coalesced_idx = 0;
+        for(auto& key_charge : coalesced_charges) {
+            auto& coalesced = key_charge.second;
+            auto* deposit = std::get<0>(key_charge.first);
+            if(create_propagated) {
+                propagated_charges.emplace_back(coalesced_positions[coalesced_idx],
+                                                coalesced_global_positions[coalesced_idx],
+                                                deposit->getType(),
+                                                coalesced.charge,
+                                                coalesced.event_time / static_cast<double>(coalesced.charge),
+                                                deposit);
+            }
+            if(transfer_charges_) {
+                transfer_charge(coalesced_positions[coalesced_idx], coalesced.charge);
             }
+            ++coalesced_idx;
         }
+        LOG(DEBUG) << "Coalesced the collected sets of charges into " << coalesced_charges.size() << " propagated charges";
     }
 
     // Output plots if required
     if(output_linegraphs_) {
-        create_output_plots(event_num);
+        // Remove the drift lines marked during propagation, starting from the last one to keep the indices valid
+        for(auto group = groups.rbegin(); group != groups.rend(); ++group) {
+            if(group->plot && group->remove_plot) {
+                output_plot_points_.erase(output_plot_points_.begin() + static_cast<std::ptrdiff_t>(group->plot_index));
+            }
+        }
+        create_output_plots(event->getNumber());
     }
 
     // Write summary and update statistics
     long double average_time = total_time / std::max(1u, propagated_charges_count);
     LOG(INFO) << "Propagated " << propagated_charges_count << " charges in " << step_count << " steps in average time of "
               << Units::display(average_time, "ns");
-    total_propagated_charges_ += propagated_charges_count;
-    total_steps_ += step_count;
-    total_time_ += total_time;
+    LOG(DEBUG) << "Propagation ended for " << terminations[static_cast<size_t>(Termination::COLLECTED)]
+               << " charges in the collection volume, " << terminations[static_cast<size_t>(Termination::LEFT_SENSOR)]
+               << " at the sensor surface, " << terminations[static_cast<size_t>(Termination::TRAPPED)]
+               << " by trapping and " << terminations[static_cast<size_t>(Termination::INTEGRATION_TIME)]
+               << " at the integration time";
+    if(terminations[static_cast<size_t>(Termination::STEP_LIMIT)] > 0) {
+        LOG(DEBUG) << "Terminated propagation of " << terminations[static_cast<size_t>(Termination::STEP_LIMIT)]
+                   << " charges after the maximum number of " << max_steps_ << " steps";
+    }
+    if(terminations[static_cast<size_t>(Termination::TIME_BUDGET)] > 0) {
+        LOG(WARNING) << "Propagation exceeded the wall-clock budget of " << Units::display(event_time_budget_, {"ms", "s"})
+                     << ", terminated propagation of " << terminations[static_cast<size_t>(Termination::TIME_BUDGET)]
+                     << " charges";
+        ++budget_exceeded_events_.local();
+    }
+    total_propagated_charges_.local() += propagated_charges_count;
+    total_steps_.local() += step_count;
+    auto& total_terminations = total_terminations_.local();
+    for(size_t state = 0; state < terminations.size(); ++state) {
+        total_terminations[state] += terminations[state];
+    }
+    total_time_.local() += total_time;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+
+        // Keep track of the slowest events
+        std::chrono::duration<double> wall_time = std::chrono::steady_clock::now() - start_time;
+        auto slowest = std::make_pair(wall_time.count(), event->getNumber());
+        auto position = std::upper_bound(
+            slowest_events_.begin(), slowest_events_.end(), slowest, [](const auto& lhs, const auto& rhs) {
+                return lhs.first > rhs.first;
+            });
+        if(static_cast<size_t>(position - slowest_events_.begin()) < report_slowest_events_) {
+            slowest_events_.insert(position, slowest);
+            if(slowest_events_.size() > report_slowest_events_) {
+                slowest_events_.pop_back();
+            }
+        }
+    }
 
     // Create a new message with propagated charges
     auto propagated_charge_message = std::make_shared<PropagatedChargeMessage>(std::move(propagated_charges), detector_);
 
+    // Create the pixel charges in the fused mode, linked to the propagated charges stored in their message
+    if(transfer_charges_) {
+        const auto& message_charges = propagated_charge_message->getData();
+        auto pixel_charges = MessageStorage<PixelCharge>::acquire();
+        pixel_charges.reserve(pixel_map.size());
+        auto& unique_pixels = unique_pixels_.local();
+        for(auto& pixel_index_charge : pixel_map) {
+            std::vector<const PropagatedCharge*> linked_charges;
+            linked_charges.reserve(pixel_index_charge.second.second.size());
+            for(auto charge_idx : pixel_index_charge.second.second) {
+                linked_charges.push_back(&message_charges[charge_idx]);
+            }
+
+            auto pixel = detector_->getPixel(pixel_index_charge.first.x(), pixel_index_charge.first.y());
+            pixel_charges.emplace_back(pixel, pixel_index_charge.second.first, linked_charges);
+            unique_pixels.insert(pixel_index_charge.first);
+        }
+        LOG(INFO) << "Transferred " << transferred_charges_count << " charges to " << pixel_map.size() << " pixels";
+        total_transferred_charges_.local() += transferred_charges_count;
+
+        auto pixel_message = std::make_shared<PixelChargeMessage>(std::move(pixel_charges), detector_);
+        messenger_->dispatchMessage(this, pixel_message, event);
+    }
+
     // Dispatch the message with propagated charges
-    messenger_->dispatchMessage(this, propagated_charge_message);
+    if(create_propagated) {
+        messenger_->dispatchMessage(this, propagated_charge_message, event);
+    }
 }
 
+namespace {
+    // Values of a single quantity for all slots of a batch, and a three-dimensional quantity split per coordinate
+    using SlotValues = std::vector<double>;
+    using SlotVectors = std::array<SlotValues, 3>;
+
+    /**
+     * @brief Tableau and step control of the integration methods, the coefficients are known at compile time such that every
+     * method is compiled into its own propagation kernel
+     */
+    template <GenericPropagationModule::Integrator I> struct IntegratorTraits;
+    template <> struct IntegratorTraits<GenericPropagationModule::Integrator::RK5> {
+        static constexpr const ButcherTableau<double, 6>& tableau = butcher::RK5;
+        static constexpr int stages = 6;
+        static constexpr bool adaptive = true;
+    };
+    template <> struct IntegratorTraits<GenericPropagationModule::Integrator::RK4> {
+        static constexpr const ButcherTableau<double, 4>& tableau = butcher::RK4;
+        static constexpr int stages = 4;
+        static constexpr bool adaptive = false;
+    };
+    template <> struct IntegratorTraits<GenericPropagationModule::Integrator::EULER> {
+        static constexpr const ButcherTableau<double, 1>& tableau = butcher::EULER;
+        static constexpr int stages = 1;
+        static constexpr bool adaptive = false;
+    };
+
+    /**
+     * @brief State of all sets of charges propagated together, stored as structure of arrays
+     *
+     * Every slot of the batch holds a single set of charges. All quantities are stored in separate contiguous arrays
+     * indexed by the slot, such that the loops over all slots can be vectorized by the compiler.
+     */
+    template <int S> struct PropagationBatch {
+        explicit PropagationBatch(size_t size)
+            : time(size), last_time(size), timestep(size), mobility(size), trap_time(size), variance(size), sign(size),
+              group(size), carrier(size), next_plot_index(size), steps(size), active(size), random_engines(size) {
+            for(auto* vectors : {&position,
+                                 &last_position,
+                                 &stage_position,
+                                 &step_value,
+                                 &step_estimate,
+                                 &efield,
+                                 &bfield,
+                                 &start_efield}) {
+                for(auto& values : *vectors) {
+                    values.resize(size);
+                }
+            }
+            for(auto& stage : stages) {
+                for(auto& values : stage) {
+                    values.resize(size);
+                }
+            }
+        }
+
+        SlotVectors position, last_position, stage_position, step_value, step_estimate, efield, bfield, start_efield;
+        std::array<SlotVectors, S> stages;
+        SlotValues time, last_time, timestep, mobility, trap_time, variance, sign;
+
+        std::vector<size_t> group;
+        std::vector<size_t> carrier;
+        std::vector<size_t> next_plot_index;
+        std::vector<uint64_t> steps;
+        std::vector<char> active;
+        std::vector<std::mt19937_64> random_engines;
+    };
+} // namespace
+
 /**
  * Propagation is simulated using a parameterization for the electron mobility. This is used to calculate the electron
  * velocity at every point with help of the electric field map of the detector. An Runge-Kutta integration is applied in
- * multiple steps, adding a random diffusion to the propagating charge every step.
+ * multiple steps, adding a random diffusion to the propagating charge every step. Every set of charges keeps its own time
+ * step and random engine, the batch only shares the evaluation of the integration stages. The field lookups are done per
+ * slot, while the mobility, velocity and integration updates are computed in loops over all slots of the batch.
+ */
+void GenericPropagationModule::propagate(std::vector<ChargeGroup>& groups,
+                                         const std::vector<size_t>& pending,
+                                         std::deque<ChargeGroup>& split_groups,
+                                         std::chrono::steady_clock::time_point deadline) {
+    if(pending.empty()) {
+        return;
+    }
+    PROFILER_RANGE("GenericPropagation::propagate");
+
+    // Propagate in a single step the carrier types whose drift has been tabulated, and integrate the drift of all others
+    std::vector<size_t> integrated;
+    std::array<std::vector<size_t>, 2> analytic;
+    for(auto idx : pending) {
+        auto carrier = (groups[idx].deposit->getType() == CarrierType::ELECTRON ? 0 : 1);
+        if(analytic_propagation_ && drift_tables_[carrier].valid) {
+            analytic[carrier].push_back(idx);
+        } else {
+            integrated.push_back(idx);
+        }
+    }
+    for(size_t carrier = 0; carrier < analytic.size(); ++carrier) {
+        if(!analytic[carrier].empty()) {
+            propagate_analytic(groups, analytic[carrier], drift_tables_[carrier]);
+        }
+    }
+    if(integrated.empty()) {
+        return;
+    }
+
+    switch(integrator_) {
+    case Integrator::RK4:
+        propagate_integrated<Integrator::RK4>(groups, integrated, split_groups, deadline);
+        break;
+    case Integrator::EULER:
+        propagate_integrated<Integrator::EULER>(groups, integrated, split_groups, deadline);
+        break;
+    default:
+        propagate_integrated<Integrator::RK5>(groups, integrated, split_groups, deadline);
+        break;
+    }
+}
+
+/**
+ * All stages of the selected integration method are evaluated for every set of charges in every step. Only the adaptive
+ * method adjusts the time step of every set to its error estimate, the fixed-step methods keep the initial time step.
+ * The carrier type is a property of every slot, such that electrons and holes can be propagated in the same batch.
  */
-std::pair<ROOT::Math::XYZPoint, double> GenericPropagationModule::propagate(const ROOT::Math::XYZPoint& pos,
-                                                                            const CarrierType& type) {
-    // Create a runge kutta solver using the electric field as step function
-    Eigen::Vector3d position(pos.x(), pos.y(), pos.z());
+template <GenericPropagationModule::Integrator I>
+void GenericPropagationModule::propagate_integrated(std::vector<ChargeGroup>& groups,
+                                                    const std::vector<size_t>& pending,
+                                                    std::deque<ChargeGroup>& split_groups,
+                                                    std::chrono::steady_clock::time_point deadline) {
+    constexpr const auto& rk_tableau = IntegratorTraits<I>::tableau;
+    constexpr int rk_stages = IntegratorTraits<I>::stages;
+    constexpr bool adaptive = IntegratorTraits<I>::adaptive;
+
+    // Local copies of the parameters of both carrier types, allowing the compiler to keep them in registers
+    const auto& electron_mobility = mobility_tables_[0];
+    const auto& hole_mobility = mobility_tables_[1];
+    const std::array<double, 2> hall_factors{{electron_Hall_, hole_Hall_}};
+    const double kT = boltzmann_kT_;
+    const std::array<double, 3> bfield{{magnetic_field_.x(), magnetic_field_.y(), magnetic_field_.z()}};
+    const double bfield_mag2 = bfield[0] * bfield[0] + bfield[1] * bfield[1] + bfield[2] * bfield[2];
+    const double sensor_edge_z = detector_->getGeometry().sensor_size[2] / 2.0;
+
+    PropagationBatch<rk_stages> batch(std::min(batch_size_, pending.size()));
+    const size_t slots = batch.group.size();
+
+    // Every slot looks up the electric field with its own cursor, reusing the grid values of the last bin on its path
+    std::vector<DetectorFieldCursor<ROOT::Math::XYZVector, 3>> efield_cursors(slots, detector_->getElectricFieldCursor());
+
+    // With precomputed grids, every slot looks up the drift velocity of its carrier type with its own cursor as well
+    std::array<std::vector<DetectorFieldCursor<ROOT::Math::XYZVector, 3>>, 2> velocity_cursors;
+    if(precompute_velocity_) {
+        for(size_t carrier = 0; carrier < velocity_cursors.size(); ++carrier) {
+            velocity_cursors[carrier].assign(
+                slots, DetectorFieldCursor<ROOT::Math::XYZVector, 3>(&velocity_fields_[carrier]));
+        }
+    }
 
-    // Define a lambda function to compute the carrier mobility
+    // Look up the electric field, and the magnetic field if it is not constant, at the given positions of all active slots
+    auto lookup_field = [&](const SlotVectors& pos) {
+        for(size_t slot = 0; slot < slots; ++slot) {
+            ROOT::Math::XYZVector field;
+            if(batch.active[slot]) {
+                field = efield_cursors[slot].get(pos[0][slot], pos[1][slot], pos[2][slot]);
+            }
+            batch.efield[0][slot] = field.x();
+            batch.efield[1][slot] = field.y();
+            batch.efield[2][slot] = field.z();
+        }
+        if(!has_magnetic_field_grid_) {
+            return;
+        }
+        for(size_t slot = 0; slot < slots; ++slot) {
+            ROOT::Math::XYZVector field;
+            if(batch.active[slot]) {
+                field = detector_->getMagneticField(ROOT::Math::XYZPoint(pos[0][slot], pos[1][slot], pos[2][slot]));
+            }
+            batch.bfield[0][slot] = field.x();
+            batch.bfield[1][slot] = field.y();
+            batch.bfield[2][slot] = field.z();
+        }
+    };
+
+    // Look up the precomputed drift velocity at the given positions of all active slots
+    auto lookup_velocity = [&](const SlotVectors& pos, SlotVectors& velocity) {
+        for(size_t slot = 0; slot < slots; ++slot) {
+            ROOT::Math::XYZVector drift;
+            if(batch.active[slot]) {
+                drift = velocity_cursors[batch.carrier[slot]][slot].get(pos[0][slot], pos[1][slot], pos[2][slot]);
+            }
+            velocity[0][slot] = drift.x();
+            velocity[1][slot] = drift.y();
+            velocity[2][slot] = drift.z();
+        }
+    };
+
+    // Compute the carrier mobility from the looked-up electric field for all slots
     // NOTE This function is typically the most frequently executed part of the framework and therefore the bottleneck
-    auto carrier_mobility = [&](double efield_mag) {
-        // Compute carrier mobility from constants and electric field magnitude
-        double numerator, denominator;
-        if(type == CarrierType::ELECTRON) {
-            numerator = electron_Vm_ / electron_Ec_;
-            denominator = std::pow(1. + std::pow(efield_mag / electron_Ec_, electron_Beta_), 1.0 / electron_Beta_);
-        } else {
-            numerator = hole_Vm_ / hole_Ec_;
-            denominator = std::pow(1. + std::pow(efield_mag / hole_Ec_, hole_Beta_), 1.0 / hole_Beta_);
+    auto compute_mobility = [&]() {
+        for(size_t slot = 0; slot < slots; ++slot) {
+            double efield_mag = std::sqrt(batch.efield[0][slot] * batch.efield[0][slot] +
+                                          batch.efield[1][slot] * batch.efield[1][slot] +
+                                          batch.efield[2][slot] * batch.efield[2][slot]);
+            batch.mobility[slot] = (batch.carrier[slot] == 0 ? electron_mobility : hole_mobility)(efield_mag);
         }
-        return numerator / denominator;
     };
 
-    // Define a function to compute the diffusion
-    auto carrier_diffusion = [&](double efield_mag, double timestep) -> Eigen::Vector3d {
-        double diffusion_constant = boltzmann_kT_ * carrier_mobility(efield_mag);
-        double diffusion_std_dev = std::sqrt(2. * diffusion_constant * timestep);
+    // Compute the charge carrier velocity for all slots, with or without magnetic field
+    auto compute_velocity = [&](SlotVectors& velocity) {
+        if(!has_magnetic_field_) {
+            for(size_t dim = 0; dim < 3; ++dim) {
+                for(size_t slot = 0; slot < slots; ++slot) {
+                    velocity[dim][slot] = batch.sign[slot] * batch.mobility[slot] * batch.efield[dim][slot];
+                }
+            }
+            return;
+        }
+
+        for(size_t slot = 0; slot < slots; ++slot) {
+            double ex = batch.efield[0][slot], ey = batch.efield[1][slot], ez = batch.efield[2][slot];
+            double sign = batch.sign[slot];
+            double mob = batch.mobility[slot];
+            double mob_hall = mob * hall_factors[batch.carrier[slot]];
+
+            // Use the magnetic field at the position of the slot if it is not constant in the sensor
+            auto b = bfield;
+            auto b_mag2 = bfield_mag2;
+            if(has_magnetic_field_grid_) {
+                b = {{batch.bfield[0][slot], batch.bfield[1][slot], batch.bfield[2][slot]}};
+                b_mag2 = b[0] * b[0] + b[1] * b[1] + b[2] * b[2];
+            }
 
-        // Compute the independent diffusion in three
-        std::normal_distribution<double> gauss_distribution(0, diffusion_std_dev);
-        Eigen::Vector3d diffusion;
-        for(int i = 0; i < 3; ++i) {
-            diffusion[i] = gauss_distribution(random_generator_);
+            // Cross and dot product of the electric and the magnetic field
+            double exb_x = ey * b[2] - ez * b[1];
+            double exb_y = ez * b[0] - ex * b[2];
+            double exb_z = ex * b[1] - ey * b[0];
+            double edotb = ex * b[0] + ey * b[1] + ez * b[2];
+
+            double rnorm = 1 + mob_hall * mob_hall * b_mag2;
+            double scale = sign * mob / rnorm;
+            velocity[0][slot] = scale * (ex + sign * mob_hall * exb_x + mob_hall * mob_hall * edotb * b[0]);
+            velocity[1][slot] = scale * (ey + sign * mob_hall * exb_y + mob_hall * mob_hall * edotb * b[1]);
+            velocity[2][slot] = scale * (ez + sign * mob_hall * exb_z + mob_hall * mob_hall * edotb * b[2]);
         }
-        return diffusion;
     };
 
-    // Define lambda functions to compute the charge carrier velocity with or without magnetic field
-    std::function<Eigen::Vector3d(double, const Eigen::Vector3d&)> carrier_velocity_noB =
-        [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
-        auto raw_field = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(cur_pos));
-        Eigen::Vector3d efield(raw_field.x(), raw_field.y(), raw_field.z());
+    // Set of charges in a slot, the indices beyond the groups of the event refer to the sets split off in this call
+    auto group_of = [&](size_t slot) -> ChargeGroup& {
+        auto idx = batch.group[slot];
+        return (idx < groups.size() ? groups[idx] : split_groups[idx - groups.size()]);
+    };
 
-        return static_cast<int>(type) * carrier_mobility(efield.norm()) * efield;
+    // Check if the set of charges in a slot should be propagated further
+    auto continue_propagation = [&](size_t slot) {
+        ROOT::Math::XYZPoint position(batch.position[0][slot], batch.position[1][slot], batch.position[2][slot]);
+        return detector_->isWithinSensor(position) && batch.time[slot] < integration_time_ &&
+               batch.time[slot] < batch.trap_time[slot] && !(stop_at_collection_ && is_within_collection_volume(position));
     };
 
-    std::function<Eigen::Vector3d(double, const Eigen::Vector3d&)> carrier_velocity_withB =
-        [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
-        auto raw_field = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(cur_pos));
-        Eigen::Vector3d efield(raw_field.x(), raw_field.y(), raw_field.z());
+    // Without restriction to the implants, steps ending beyond the collection plane do not need to be shortened
+    const bool limit_edge_steps = !stop_at_collection_ || collect_from_implant_;
+
+    // Store the final position and time of the set of charges in a slot and release the slot
+    auto retire_slot = [&](size_t slot) {
+        auto& group = group_of(slot);
+        Eigen::Vector3d position(batch.position[0][slot], batch.position[1][slot], batch.position[2][slot]);
+        Eigen::Vector3d last_position(
+            batch.last_position[0][slot], batch.last_position[1][slot], batch.last_position[2][slot]);
+        auto time = batch.time[slot];
+        auto last_time = batch.last_time[slot];
+
+        // Move trapped carriers back to the position they reached at the time of trapping, unless it is outside the sensor
+        auto trapped = (time >= batch.trap_time[slot]);
+        if(trapped && time > last_time) {
+            auto fraction = (batch.trap_time[slot] - last_time) / (time - last_time);
+            Eigen::Vector3d trap_position = last_position + fraction * (position - last_position);
+            if(detector_->isWithinSensor(trap_position)) {
+                position = trap_position;
+                time = batch.trap_time[slot];
+            } else {
+                trapped = false;
+            }
+        }
+
+        // Find proper final position in the sensor
+        auto left_sensor = !detector_->isWithinSensor(position);
+        if(left_sensor) {
+            auto check_position = position;
+            check_position.z() = last_position.z();
+            if(position.z() > 0 && detector_->isWithinSensor(check_position)) {
+                // Carrier left sensor on the side of the pixel grid, interpolate end point on surface
+                auto z_cur_border = std::fabs(position.z() - sensor_edge_z);
+                auto z_last_border = std::fabs(sensor_edge_z - last_position.z());
+                auto z_total = z_cur_border + z_last_border;
+                position = (z_last_border / z_total) * position + (z_cur_border / z_total) * last_position;
+                time = (z_last_border / z_total) * time + (z_cur_border / z_total) * last_time;
+            } else {
+                // Carrier left sensor on any order border, use last position inside instead
+                position = last_position;
+                time = last_time;
+            }
+        }
 
-        Eigen::Vector3d velocity;
-        Eigen::Vector3d bfield(magnetic_field_.x(), magnetic_field_.y(), magnetic_field_.z());
+        // If requested, remove charge drift lines from plots if they did not reach the implant side within the
+        // integration time:
+        if(output_linegraphs_ && output_plots_lines_at_implants_) {
+            // If drift time is larger than integration time, the charge carriers are trapped or collected at the backside
+            if(time >= integration_time_ || trapped || last_position.z() < -model_->getSensorSize().z() * 0.45) {
+                group.remove_plot = true;
+            }
+        }
 
-        auto mob = carrier_mobility(efield.norm());
-        auto exb = efield.cross(bfield);
+        group.position = static_cast<ROOT::Math::XYZPoint>(position);
+        group.time = time;
+        group.variance = batch.variance[slot];
+        if(stop_at_collection_ && is_within_collection_volume(group.position)) {
+            group.termination = Termination::COLLECTED;
+        } else if(trapped) {
+            group.termination = Termination::TRAPPED;
+        } else {
+            group.termination = (left_sensor ? Termination::LEFT_SENSOR : Termination::INTEGRATION_TIME);
+        }
+        batch.active[slot] = 0;
+    };
 
-        Eigen::Vector3d term1;
-        double hallFactor = (type == CarrierType::ELECTRON ? electron_Hall_ : hole_Hall_);
-        term1 = static_cast<int>(type) * mob * hallFactor * exb;
+    // Load the next pending set of charges into a slot, followed by the sets split off during the propagation. Sets that
+    // cannot be propagated at all are retired directly
+    size_t next_pending = 0, next_split = 0;
+    auto fill_slot = [&](size_t slot) {
+        while(next_pending < pending.size() || next_split < split_groups.size()) {
+            batch.group[slot] = (next_pending < pending.size() ? pending[next_pending++] : groups.size() + next_split++);
+            const auto& group = group_of(slot);
+
+            batch.position[0][slot] = batch.last_position[0][slot] = group.position.x();
+            batch.position[1][slot] = batch.last_position[1][slot] = group.position.y();
+            batch.position[2][slot] = batch.last_position[2][slot] = group.position.z();
+            batch.time[slot] = batch.last_time[slot] = group.time;
+            batch.timestep[slot] = timestep_start_;
+            batch.next_plot_index[slot] = 0;
+            batch.steps[slot] = 0;
+            batch.random_engines[slot].seed(group.seed);
+            batch.carrier[slot] = (group.deposit->getType() == CarrierType::ELECTRON ? 0 : 1);
+            batch.sign[slot] = static_cast<int>(group.deposit->getType());
+            batch.trap_time[slot] =
+                group.time + draw_trapping_time(trapping_times_[batch.carrier[slot]], batch.random_engines[slot]);
+            batch.variance[slot] = group.variance;
+            batch.active[slot] = 1;
+
+            if(continue_propagation(slot)) {
+                return true;
+            }
+            retire_slot(slot);
+        }
+        return false;
+    };
 
-        Eigen::Vector3d term2 = mob * mob * hallFactor * hallFactor * efield.dot(bfield) * bfield;
+    size_t active_slots = 0;
+    for(size_t slot = 0; slot < slots; ++slot) {
+        if(fill_slot(slot)) {
+            ++active_slots;
+        }
+    }
 
-        auto rnorm = 1 + mob * mob * hallFactor * hallFactor * bfield.dot(bfield);
-        return static_cast<int>(type) * mob * (efield + term1 + term2) / rnorm;
+    // Terminate the propagation of all sets of charges which have not finished yet, including the ones not started
+    auto terminate_remaining = [&]() {
+        for(size_t slot = 0; slot < slots; ++slot) {
+            if(batch.active[slot]) {
+                retire_slot(slot);
+                group_of(slot).termination = Termination::TIME_BUDGET;
+            }
+        }
+        for(; next_pending < pending.size(); ++next_pending) {
+            groups[pending[next_pending]].termination = Termination::TIME_BUDGET;
+        }
+        for(; next_split < split_groups.size(); ++next_split) {
+            split_groups[next_split].termination = Termination::TIME_BUDGET;
+        }
+        active_slots = 0;
     };
 
-    // Create the runge kutta solver with an RKF5 tableau, using different velocity calculators depending on the magnetic
-    // field
-    auto runge_kutta = make_runge_kutta(
-        tableau::RK5, (has_magnetic_field_ ? carrier_velocity_withB : carrier_velocity_noB), timestep_start_, position);
-
-    // Continue propagation until the deposit is outside the sensor
-    Eigen::Vector3d last_position = position;
-    double last_time = 0;
-    size_t next_idx = 0;
-    while(detector_->isWithinSensor(static_cast<ROOT::Math::XYZPoint>(position)) &&
-          runge_kutta.getTime() < integration_time_) {
+    // Continue propagation until all sets of charges are outside the sensor
+    const bool has_deadline = (deadline != std::chrono::steady_clock::time_point::max());
+    uint64_t step_count = 0;
+    while(active_slots > 0) {
+        if(has_deadline && std::chrono::steady_clock::now() > deadline) {
+            terminate_remaining();
+            break;
+        }
+
         // Update output plots if necessary (depending on the plot step)
         if(output_linegraphs_) {
-            auto time_idx = static_cast<size_t>(runge_kutta.getTime() / output_plots_step_);
-            while(next_idx <= time_idx) {
-                output_plot_points_.back().second.push_back(static_cast<ROOT::Math::XYZPoint>(position));
-                next_idx = output_plot_points_.back().second.size();
+            for(size_t slot = 0; slot < slots; ++slot) {
+                if(!batch.active[slot] || !group_of(slot).plot) {
+                    continue;
+                }
+                auto& line = output_plot_points_[group_of(slot).plot_index];
+                auto time_idx = static_cast<size_t>(batch.time[slot] / output_plots_step_);
+                while(batch.next_plot_index[slot] <= time_idx) {
+                    line.points.emplace_back(batch.position[0][slot], batch.position[1][slot], batch.position[2][slot]);
+
+                    // Halve the sampling of the line if it reached the maximum number of points
+                    if(output_plots_max_points_ > 0 && line.points.size() >= output_plots_max_points_) {
+                        size_t kept = 0;
+                        for(size_t point = 0; point < line.points.size(); point += 2) {
+                            line.points[kept++] = line.points[point];
+                        }
+                        line.points.resize(kept);
+                        line.stride *= 2;
+                    }
+                    batch.next_plot_index[slot] = line.points.size() * line.stride;
+                }
             }
         }
 
         // Save previous position and time
-        last_position = position;
-        last_time = runge_kutta.getTime();
+        batch.last_position = batch.position;
+        batch.last_time = batch.time;
+
+        // Evaluate all stages of the Runge-Kutta step, every slot uses its own time step
+        for(int stage = 0; stage < rk_stages; ++stage) {
+            for(size_t dim = 0; dim < 3; ++dim) {
+                auto& stage_position = batch.stage_position[dim];
+                stage_position = batch.position[dim];
+                for(int prev = 0; prev < stage; ++prev) {
+                    const double coefficient = rk_tableau(stage, prev);
+                    const auto& slope = batch.stages[static_cast<size_t>(prev)][dim];
+                    for(size_t slot = 0; slot < slots; ++slot) {
+                        stage_position[slot] += batch.timestep[slot] * coefficient * slope[slot];
+                    }
+                }
+            }
+            if(precompute_velocity_) {
+                // A single lookup per stage, the field itself is only needed at the start for the adaptive splitting
+                lookup_velocity(batch.stage_position, batch.stages[static_cast<size_t>(stage)]);
+                if(stage == 0 && adaptive_grouping_) {
+                    lookup_field(batch.stage_position);
+                    batch.start_efield = batch.efield;
+                }
+                continue;
+            }
+            lookup_field(batch.stage_position);
+            if(stage == 0 && adaptive_grouping_) {
+                batch.start_efield = batch.efield;
+            }
+            compute_mobility();
+            compute_velocity(batch.stages[static_cast<size_t>(stage)]);
+        }
 
-        // Execute a Runge Kutta step
-        auto step = runge_kutta.step();
+        // Combine the stages into the step and its error estimate, and execute the step
+        for(size_t dim = 0; dim < 3; ++dim) {
+            auto& value = batch.step_value[dim];
+            auto& estimate = batch.step_estimate[dim];
+            std::fill(value.begin(), value.end(), 0.);
+            std::fill(estimate.begin(), estimate.end(), 0.);
+            for(int stage = 0; stage < rk_stages; ++stage) {
+                const double weight = rk_tableau(rk_stages, stage);
+                const double error_weight = rk_tableau(rk_stages + 1, stage);
+                const auto& slope = batch.stages[static_cast<size_t>(stage)][dim];
+                for(size_t slot = 0; slot < slots; ++slot) {
+                    value[slot] += batch.timestep[slot] * weight * slope[slot];
+                }
+                if(!adaptive) {
+                    continue;
+                }
+                for(size_t slot = 0; slot < slots; ++slot) {
+                    estimate[slot] += batch.timestep[slot] * error_weight * slope[slot];
+                }
+            }
+            for(size_t slot = 0; slot < slots; ++slot) {
+                batch.position[dim][slot] += value[slot];
+            }
+        }
+        for(size_t slot = 0; slot < slots; ++slot) {
+            batch.time[slot] += batch.timestep[slot];
+        }
 
-        // Get the current result and timestep
-        auto timestep = runge_kutta.getTimeStep();
-        position = runge_kutta.getValue();
+        // Get electric field at the new positions and apply the diffusion step
+        lookup_field(batch.position);
+        compute_mobility();
+        for(size_t slot = 0; slot < slots; ++slot) {
+            if(!batch.active[slot]) {
+                continue;
+            }
+            double diffusion_constant = kT * batch.mobility[slot];
 
-        // Get electric field at current position and fall back to empty field if it does not exist
-        auto efield = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(position));
+            // Widen the cloud instead of displacing its centroid if the charges are propagated as a cloud
+            if(charge_cloud_) {
+                batch.variance[slot] += 2. * diffusion_constant * batch.timestep[slot];
+                continue;
+            }
+            double diffusion_std_dev = std::sqrt(2. * diffusion_constant * batch.timestep[slot]);
 
-        // Apply diffusion step
-        auto diffusion = carrier_diffusion(std::sqrt(efield.Mag2()), timestep);
-        position += diffusion;
-        runge_kutta.setValue(position);
+            // Compute the independent diffusion in three
+            auto& random_engine = batch.random_engines[slot];
+            if(fast_math_) {
+                for(size_t dim = 0; dim < 3; ++dim) {
+                    batch.position[dim][slot] += diffusion_std_dev * normal_sampler_(random_engine);
+                }
+            } else {
+                std::normal_distribution<double> gauss_distribution(0, diffusion_std_dev);
+                for(size_t dim = 0; dim < 3; ++dim) {
+                    batch.position[dim][slot] += gauss_distribution(random_engine);
+                }
+            }
+        }
 
-        // Adapt step size to match target precision
-        double uncertainty = step.error.norm();
+        for(size_t slot = 0; slot < slots; ++slot) {
+            if(!batch.active[slot]) {
+                continue;
+            }
+            ++step_count;
+            ++batch.steps[slot];
+
+            // Adapt step size to match target precision
+            double step_length = 0, uncertainty = 0;
+            for(size_t dim = 0; dim < 3; ++dim) {
+                auto error = batch.step_value[dim][slot] - batch.step_estimate[dim][slot];
+                step_length += batch.step_value[dim][slot] * batch.step_value[dim][slot];
+                uncertainty += error * error;
+            }
+            step_length = std::sqrt(step_length);
+            uncertainty = std::sqrt(uncertainty);
 
-        // Update step length histogram
-        if(output_plots_) {
-            step_length_histo_->Fill(static_cast<double>(Units::convert(step.value.norm(), "um")));
-            uncertainty_histo_->Fill(static_cast<double>(Units::convert(step.error.norm(), "nm")));
+            // Update step length histogram, the fixed-step methods do not provide an uncertainty
+            if(output_plots_) {
+                step_length_histo_->Fill(step_length / units::um);
+                if(adaptive) {
+                    uncertainty_histo_->Fill(uncertainty / units::nm);
+                }
+            }
+
+            if(adaptive) {
+                // Lower timestep when reaching the sensor edge
+                auto& timestep = batch.timestep[slot];
+                if(limit_edge_steps &&
+                   std::fabs(sensor_edge_z - batch.position[2][slot]) < 2 * batch.step_value[2][slot]) {
+                    timestep *= 0.75;
+                } else {
+                    if(uncertainty > target_spatial_precision_) {
+                        timestep *= 0.75;
+                    } else if(2 * uncertainty < target_spatial_precision_) {
+                        timestep *= 1.5;
+                    }
+                }
+                // Limit the timestep to certain minimum and maximum step sizes
+                if(timestep > timestep_max_) {
+                    timestep = timestep_max_;
+                } else if(timestep < timestep_min_) {
+                    timestep = timestep_min_;
+                }
+            }
+
+            // Split large sets of charges into sets of the regular size when the field varies on a short length scale,
+            // the split sets continue from the current position with seeds drawn from the engine of the original set
+            auto& group = group_of(slot);
+            if(adaptive_grouping_ && group.charge > charge_per_step_ && continue_propagation(slot)) {
+                double field_change = 0, field = 0;
+                for(size_t dim = 0; dim < 3; ++dim) {
+                    auto change = batch.efield[dim][slot] - batch.start_efield[dim][slot];
+                    field_change += change * change;
+                    field += batch.start_efield[dim][slot] * batch.start_efield[dim][slot];
+                }
+                if(split_length_scale_ * split_length_scale_ * field_change > field * step_length * step_length) {
+                    unsigned int charge_per_split = charge_per_step_;
+                    while(group.charge > charge_per_split) {
+                        ChargeGroup split;
+                        split.deposit = group.deposit;
+                        split.charge = std::min(charge_per_split, group.charge - charge_per_split);
+                        split.seed = batch.random_engines[slot]();
+                        split.position = ROOT::Math::XYZPoint(
+                            batch.position[0][slot], batch.position[1][slot], batch.position[2][slot]);
+                        split.time = batch.time[slot];
+                        group.charge -= split.charge;
+                        split_groups.push_back(split);
+                    }
+                }
+            }
+
+            // Retire the set of charges if it stopped or reached the maximum number of steps and replace it by the next
+            // pending set
+            auto stopped = !continue_propagation(slot);
+            if(stopped || (max_steps_ > 0 && batch.steps[slot] >= max_steps_)) {
+                retire_slot(slot);
+                if(!stopped) {
+                    group.termination = Termination::STEP_LIMIT;
+                }
+                if(!fill_slot(slot)) {
+                    --active_slots;
+                }
+            }
         }
+    }
 
-        // Lower timestep when reaching the sensor edge
-        if(std::fabs(model_->getSensorSize().z() / 2.0 - position.z()) < 2 * step.value.z()) {
-            timestep *= 0.75;
+    *runge_kutta_steps_ += step_count;
+}
+
+/**
+ * The sensor is divided into slices in depth, and the carrier velocity is evaluated at the center of every slice. The drift
+ * time and the integral of the mobility over the drift time are accumulated from the collecting surface to every boundary
+ * of the slices. Slices without electric field cannot be crossed and result in infinite values.
+ */
+GenericPropagationModule::DriftTable GenericPropagationModule::build_drift_table(CarrierType type) const {
+    const size_t slices = 1000;
+    const auto& mobility = mobility_tables_[type == CarrierType::ELECTRON ? 0 : 1];
+
+    DriftTable table;
+    auto center = model_->getSensorCenter();
+    table.slice_thickness = model_->getSensorSize().z() / slices;
+    table.z_min = center.z() - model_->getSensorSize().z() / 2;
+    table.zero_field_mobility = mobility(0);
+
+    // Velocity along the depth and mobility in the center of all slices
+    std::vector<double> velocity(slices), slice_mobility(slices);
+    int direction = 0;
+    for(size_t slice = 0; slice < slices; ++slice) {
+        auto z = table.z_min + (static_cast<double>(slice) + 0.5) * table.slice_thickness;
+        auto efield = detector_->getElectricField(ROOT::Math::XYZPoint(center.x(), center.y(), z));
+        slice_mobility[slice] = mobility(std::sqrt(efield.Mag2()));
+        velocity[slice] = static_cast<int>(type) * slice_mobility[slice] * efield.z();
+
+        // The drift has to point to the same surface everywhere in the sensor
+        if(velocity[slice] != 0) {
+            auto slice_direction = (velocity[slice] > 0 ? 1 : -1);
+            if(direction != 0 && slice_direction != direction) {
+                return table;
+            }
+            direction = slice_direction;
+        }
+    }
+    if(direction == 0) {
+        return table;
+    }
+
+    // Accumulate the drift time and the mobility integral from the collecting surface
+    table.time.assign(slices + 1, 0);
+    table.mobility_integral.assign(slices + 1, 0);
+    for(size_t step = 0; step < slices; ++step) {
+        auto slice = (direction > 0 ? slices - 1 - step : step);
+        auto from = (direction > 0 ? slice + 1 : slice);
+        auto to = (direction > 0 ? slice : slice + 1);
+
+        auto slice_time = (velocity[slice] != 0 ? table.slice_thickness / std::fabs(velocity[slice])
+                                                : std::numeric_limits<double>::infinity());
+        table.time[to] = table.time[from] + slice_time;
+        table.mobility_integral[to] = table.mobility_integral[from] + slice_mobility[slice] * slice_time;
+    }
+    table.collection_z = (direction > 0 ? table.z_min + model_->getSensorSize().z() : table.z_min);
+    table.valid = true;
+    return table;
+}
+
+/**
+ * The drift time and mobility integral at the start and end of the drift are interpolated linearly between the slice
+ * boundaries of the table. The diffusion width follows from the Einstein relation with the mobility integrated over the
+ * drift time. Carriers starting in a region without electric field only diffuse in the sensor plane during the full
+ * integration time.
+ */
+void GenericPropagationModule::propagate_analytic(std::vector<ChargeGroup>& groups,
+                                                  const std::vector<size_t>& pending,
+                                                  const DriftTable& table) const {
+    const auto slices = table.time.size() - 1;
+
+    // Interpolate a tabulated value at the given depth, infinite if any of the neighboring values is infinite
+    auto interpolate = [&](const std::vector<double>& values, double z) {
+        auto position = std::min(std::max((z - table.z_min) / table.slice_thickness, 0.), static_cast<double>(slices));
+        auto slice = std::min(static_cast<size_t>(position), slices - 1);
+        auto fraction = position - static_cast<double>(slice);
+        if(!std::isfinite(values[slice]) || !std::isfinite(values[slice + 1])) {
+            return std::numeric_limits<double>::infinity();
+        }
+        return values[slice] + fraction * (values[slice + 1] - values[slice]);
+    };
+
+    // Find the depth at which the remaining drift time equals the given time
+    auto find_depth = [&](double time) {
+        // Boundaries ordered by increasing time, starting at the collecting surface
+        auto boundary = [&](size_t idx) { return (table.collection_z > table.z_min ? slices - idx : idx); };
+        size_t low = 0, high = slices;
+        while(high - low > 1) {
+            auto mid = (low + high) / 2;
+            if(table.time[boundary(mid)] <= time) {
+                low = mid;
+            } else {
+                high = mid;
+            }
+        }
+        auto time_low = table.time[boundary(low)];
+        auto time_high = table.time[boundary(high)];
+        auto fraction = (std::isfinite(time_high) && time_high > time_low ? (time - time_low) / (time_high - time_low) : 0.);
+        auto z_low = table.z_min + static_cast<double>(boundary(low)) * table.slice_thickness;
+        auto z_high = table.z_min + static_cast<double>(boundary(high)) * table.slice_thickness;
+        return z_low + fraction * (z_high - z_low);
+    };
+
+    for(auto idx : pending) {
+        auto& group = groups[idx];
+        const auto& start = group.position;
+        std::mt19937_64 random_engine(group.seed);
+
+        // The drift ends at the integration time, or earlier if the carriers are trapped
+        auto trapping_time = trapping_times_[group.deposit->getType() == CarrierType::ELECTRON ? 0 : 1];
+        auto trap_time = draw_trapping_time(trapping_time, random_engine);
+        auto time_limit = std::min(integration_time_, trap_time);
+
+        // Drift to the collecting surface if it is reached within the time limit
+        double end_z, time, mobility_integral;
+        auto start_time = interpolate(table.time, start.z());
+        if(!std::isfinite(start_time)) {
+            end_z = start.z();
+            time = time_limit;
+            mobility_integral = table.zero_field_mobility * time_limit;
+        } else if(start_time < time_limit) {
+            end_z = table.collection_z;
+            time = start_time;
+            mobility_integral = interpolate(table.mobility_integral, start.z());
+        } else {
+            end_z = find_depth(start_time - time_limit);
+            time = time_limit;
+            mobility_integral =
+                interpolate(table.mobility_integral, start.z()) - interpolate(table.mobility_integral, end_z);
+        }
+
+        // Apply the diffusion accumulated during the drift in the sensor plane
+        auto diffusion_std_dev = std::sqrt(2. * boltzmann_kT_ * mobility_integral);
+        double diffusion_x, diffusion_y;
+        if(charge_cloud_) {
+            // Keep the centroid of the cloud and store its width instead
+            group.variance = diffusion_std_dev * diffusion_std_dev;
+            diffusion_x = 0;
+            diffusion_y = 0;
+        } else if(fast_math_) {
+            diffusion_x = diffusion_std_dev * normal_sampler_(random_engine);
+            diffusion_y = diffusion_std_dev * normal_sampler_(random_engine);
         } else {
-            if(uncertainty > target_spatial_precision_) {
-                timestep *= 0.75;
-            } else if(2 * uncertainty < target_spatial_precision_) {
-                timestep *= 1.5;
-            }
-        }
-        // Limit the timestep to certain minimum and maximum step sizes
-        if(timestep > timestep_max_) {
-            timestep = timestep_max_;
-        } else if(timestep < timestep_min_) {
-            timestep = timestep_min_;
-        }
-        runge_kutta.setTimeStep(timestep);
-    }
-
-    // Find proper final position in the sensor
-    auto time = runge_kutta.getTime();
-    if(!detector_->isWithinSensor(static_cast<ROOT::Math::XYZPoint>(position))) {
-        auto check_position = position;
-        check_position.z() = last_position.z();
-        if(position.z() > 0 && detector_->isWithinSensor(static_cast<ROOT::Math::XYZPoint>(check_position))) {
-            // Carrier left sensor on the side of the pixel grid, interpolate end point on surface
-            auto z_cur_border = std::fabs(position.z() - model_->getSensorSize().z() / 2.0);
-            auto z_last_border = std::fabs(model_->getSensorSize().z() / 2.0 - last_position.z());
-            auto z_total = z_cur_border + z_last_border;
-            position = (z_last_border / z_total) * position + (z_cur_border / z_total) * last_position;
-            time = (z_last_border / z_total) * time + (z_cur_border / z_total) * last_time;
+            std::normal_distribution<double> gauss_distribution(0, diffusion_std_dev);
+            diffusion_x = gauss_distribution(random_engine);
+            diffusion_y = gauss_distribution(random_engine);
+        }
+
+        group.position = ROOT::Math::XYZPoint(start.x() + diffusion_x, start.y() + diffusion_y, end_z);
+        group.time = time;
+        if(stop_at_collection_ && is_within_collection_volume(group.position)) {
+            group.termination = Termination::COLLECTED;
+        } else if(time < time_limit) {
+            group.termination = Termination::LEFT_SENSOR;
         } else {
-            // Carrier left sensor on any order border, use last position inside instead
-            position = last_position;
-            time = last_time;
+            group.termination = (trap_time < integration_time_ ? Termination::TRAPPED : Termination::INTEGRATION_TIME);
         }
     }
+}
 
-    // If requested, remove charge drift lines from plots if they did not reach the implant side within the integration time:
-    if(output_linegraphs_ && output_plots_lines_at_implants_) {
-        // If drift time is larger than integration time or the charge carriers have been collected at the backside, remove
-        if(time >= integration_time_ || last_position.z() < -model_->getSensorSize().z() * 0.45) {
-            output_plot_points_.pop_back();
+/**
+ * The cloud is integrated over the cells of the pixel grid within four standard deviations of its centroid in the local
+ * frame, where the outermost cells also receive the tails of the distribution. As the cloud is the product of two Gaussian
+ * distributions in x and y, the fraction of every cell is the product of the fractions of its column and its row. The
+ * charges are rounded on the cumulative fractions, such that the charges of all cells add up to the charge of the cloud.
+ */
+std::vector<std::pair<ROOT::Math::XYZPoint, unsigned int>>
+GenericPropagationModule::integrate_cloud(const ChargeGroup& group) const {
+    const auto& geometry = detector_->getGeometry();
+    const double width = std::sqrt(2. * group.variance);
+    const double reach = 4. * std::sqrt(group.variance);
+
+    // Fraction of the cloud in every cell along one axis, the first and the last cell include the tails
+    auto fractions = [&](double center, double pitch, int first, int last) {
+        std::vector<double> values;
+        double lower = 0;
+        for(int idx = first; idx <= last; ++idx) {
+            double upper = (idx == last ? 1. : 0.5 * std::erfc(-((idx + 0.5) * pitch - center) / width));
+            values.push_back(upper - lower);
+            lower = upper;
+        }
+        return values;
+    };
+    auto first_column = geometry.nearestColumn(group.position.x() - reach);
+    auto last_column = geometry.nearestColumn(group.position.x() + reach);
+    auto first_row = geometry.nearestRow(group.position.y() - reach);
+    auto last_row = geometry.nearestRow(group.position.y() + reach);
+    auto column_fractions = fractions(group.position.x(), geometry.pixel_pitch[0], first_column, last_column);
+    auto row_fractions = fractions(group.position.y(), geometry.pixel_pitch[1], first_row, last_row);
+
+    std::vector<std::pair<ROOT::Math::XYZPoint, unsigned int>> cells;
+    double cumulative = 0;
+    unsigned int assigned = 0;
+    for(int column = first_column; column <= last_column; ++column) {
+        for(int row = first_row; row <= last_row; ++row) {
+            cumulative += column_fractions[static_cast<size_t>(column - first_column)] *
+                          row_fractions[static_cast<size_t>(row - first_row)];
+            auto total = static_cast<unsigned int>(
+                std::min(std::lround(cumulative * group.charge), static_cast<long>(group.charge)));
+            if(total > assigned) {
+                cells.emplace_back(ROOT::Math::XYZPoint(column * geometry.pixel_pitch[0],
+                                                        row * geometry.pixel_pitch[1],
+                                                        group.position.z()),
+                                   total - assigned);
+                assigned = total;
+            }
         }
     }
+    return cells;
+}
 
-    // Return the final position of the propagated charge
-    return std::make_pair(static_cast<ROOT::Math::XYZPoint>(position), time);
+bool GenericPropagationModule::is_within_collection_volume(const ROOT::Math::XYZPoint& position) const {
+    return position.z() >= collection_plane_z_ && (!collect_from_implant_ || detector_->isWithinImplant(position));
 }
 
 void GenericPropagationModule::finalize() {
     if(output_plots_) {
-        step_length_histo_->Write();
-        drift_time_histo_->Write();
-        uncertainty_histo_->Write();
-        group_size_histo_->Write();
+        step_length_histo_->merge()->Write();
+        drift_time_histo_->merge()->Write();
+        uncertainty_histo_->merge()->Write();
+        group_size_histo_->merge()->Write();
     }
 
-    long double average_time = total_time_ / std::max(1u, total_propagated_charges_);
-    LOG(INFO) << "Propagated total of " << total_propagated_charges_ << " charges in " << total_steps_
+    // Merge the statistics of all threads
+    auto total_propagated_charges = total_propagated_charges_.merge();
+    auto total_steps = total_steps_.merge();
+    const auto& total_terminations = total_terminations_.merge();
+    auto budget_exceeded_events = budget_exceeded_events_.merge();
+    auto skipped_deposits = skipped_deposits_.merge();
+
+    long double average_time = total_time_.merge() / std::max(1u, total_propagated_charges);
+    LOG(INFO) << "Propagated total of " << total_propagated_charges << " charges in " << total_steps
               << " steps in average time of " << Units::display(average_time, "ns");
+    if(skipped_deposits > 0) {
+        LOG(INFO) << "Skipped " << skipped_deposits << " deposits outside of the region of interest";
+    }
+    if(transfer_charges_) {
+        LOG(INFO) << "Transferred total of " << total_transferred_charges_.merge() << " charges to "
+                  << unique_pixels_.merge().size() << " different pixels";
+    }
+    if(total_steps > 0 && runge_kutta_steps_->load() > 0) {
+        LOG(INFO) << "Integrated the drift with the " << config_.get<std::string>("integrator") << " method in "
+                  << runge_kutta_steps_->load() << " steps, on average "
+                  << static_cast<double>(runge_kutta_steps_->load()) / total_steps << " steps per set of charges";
+    }
+    if(stop_at_collection_ || std::isfinite(trapping_times_[0])) {
+        LOG(INFO) << "Stopped " << total_terminations[static_cast<size_t>(Termination::COLLECTED)]
+                  << " charges in the collection volume, "
+                  << total_terminations[static_cast<size_t>(Termination::LEFT_SENSOR)] << " at the sensor surface, "
+                  << total_terminations[static_cast<size_t>(Termination::TRAPPED)] << " by trapping and "
+                  << total_terminations[static_cast<size_t>(Termination::INTEGRATION_TIME)] << " at the integration time";
+    }
+    if(total_terminations[static_cast<size_t>(Termination::STEP_LIMIT)] > 0) {
+        LOG(WARNING) << "Terminated propagation of " << total_terminations[static_cast<size_t>(Termination::STEP_LIMIT)]
+                     << " charges after the maximum number of " << max_steps_ << " steps";
+    }
+    if(budget_exceeded_events > 0) {
+        LOG(WARNING) << "Exceeded the wall-clock budget of " << Units::display(event_time_budget_, {"ms", "s"}) << " in "
+                     << budget_exceeded_events << " events, terminated propagation of "
+                     << total_terminations[static_cast<size_t>(Termination::TIME_BUDGET)] << " charges";
+    }
+    if(!slowest_events_.empty()) {
+        LOG(INFO) << "Slowest events:";
+        for(const auto& slowest : slowest_events_) {
+            LOG(INFO) << "  event " << slowest.second << " in " << Units::display(slowest.first * units::s, {"ms", "s"});
+        }
+    }
 }
@@ -7,9 +7,19 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <random>
+#include <set>
 #include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include <Math/Point3D.h>
@@ -17,13 +27,22 @@
 #include <TH1D.h>
 
 #include "core/config/Configuration.hpp"
+#include "core/geometry/DetectorField.hpp"
 #include "core/geometry/DetectorModel.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "core/module/Module.hpp"
+#include "core/module/ThreadedAccumulator.hpp"
+#include "core/module/ThreadedHistogram.hpp"
 
 #include "objects/DepositedCharge.hpp"
+#include "objects/PixelCharge.hpp"
 #include "objects/PropagatedCharge.hpp"
 
+#include "tools/fast_math.h"
+#include "tools/mobility.h"
+#include "tools/region_of_interest.h"
+#include "tools/trapping.h"
+
 namespace allpix {
     /**
      * @ingroup Modules
@@ -34,9 +53,20 @@ namespace allpix {
      * combination of drift from a charge mobility parameterization and diffusion using a Gaussian random walk process.
      * Propagation continues until the charge deposits 'leave' the sensitive device. Sets of charges do not interact with
      * each other and are threated fully separate, allowing for a speed-up by propagating the charges in multiple threads.
+     * Within an event, multiple sets of charges are integrated together in batches to allow vectorization of the drift and
+     * diffusion computations.
      */
     class GenericPropagationModule : public Module {
     public:
+        /**
+         * @brief Method used to integrate the drift of the sets of charges
+         */
+        enum class Integrator {
+            RK5 = 0, ///< Runge-Kutta-Fehlberg method with a time step adapted to its error estimate
+            RK4,     ///< Classic fourth-order Runge-Kutta method with a fixed time step
+            EULER,   ///< Euler-Maruyama method with a fixed time step
+        };
+
         /**
          * @brief Constructor for this detector-specific module
          * @param config Configuration object for this module as retrieved from the steering file
@@ -52,8 +82,9 @@ namespace allpix {
 
         /**
          * @brief Propagate all deposited charges through the sensor
+         * @param event Pointer to the event to process
          */
-        void run(unsigned int event_num) override;
+        void run(Event* event) override;
 
         /**
          * @brief Write statistical summary
@@ -72,28 +103,173 @@ namespace allpix {
         void create_output_plots(unsigned int event_num);
 
         /**
-         * @brief Propagate a single set of charges through the sensor
-         * @param pos Position of the deposit in the sensor
-         * @param type Type of the carrier to propagate
-         * @return Pair of the point where the deposit ended after propagation and the time the propagation took
+         * @brief Reason for the propagation of a set of charges to end
+         */
+        enum class Termination {
+            INTEGRATION_TIME = 0, ///< The integration time was exceeded within the sensor
+            LEFT_SENSOR,          ///< The set of charges reached a surface of the sensor
+            COLLECTED,            ///< The set of charges entered the collection volume below the implants
+            TRAPPED,              ///< The set of charges was trapped in the sensor
+            STEP_LIMIT,           ///< The maximum number of steps for a single set of charges was reached
+            TIME_BUDGET,          ///< The wall-clock budget for the propagation of the event was exceeded
+        };
+
+        /**
+         * @brief Single set of charges propagated through the sensor
+         */
+        struct ChargeGroup {
+            const DepositedCharge* deposit{};
+            unsigned int charge{};
+            // Seed for the random engine used for the diffusion of this set
+            uint64_t seed{};
+            // Position of the deposit before and final position after propagation
+            ROOT::Math::XYZPoint position;
+            // Time the propagation took and the reason it ended
+            double time{};
+            Termination termination{};
+            // Variance of the charge cloud in the sensor plane accumulated by the diffusion, if propagated as a cloud
+            double variance{};
+            // Whether the set is drawn, the index of its drift line in the output plots and whether the line should be
+            // removed after propagation
+            bool plot{};
+            size_t plot_index{};
+            bool remove_plot{};
+        };
+
+        /**
+         * @brief Propagate a selection of sets of charges through the sensor
+         * @param groups Sets of charges of the event, the final position and propagation time are stored in these sets
+         * @param pending Indices of the sets of charges to propagate, which can be of both carrier types
+         * @param split_groups Sets of charges split off during the propagation, these are propagated in the same call
+         * @param deadline Point in time after which the propagation of all remaining sets of charges is terminated
+         *
+         * The sets of charges are propagated in batches, where all sets in a batch are advanced in lockstep. Sets are
+         * replaced by the next pending set as soon as they leave the sensor, exceed the integration time or, if requested,
+         * enter the collection volume. Different selections of sets can be propagated concurrently, as every set only
+         * writes to its own entry of the groups.
+         */
+        void propagate(std::vector<ChargeGroup>& groups,
+                       const std::vector<size_t>& pending,
+                       std::deque<ChargeGroup>& split_groups,
+                       std::chrono::steady_clock::time_point deadline);
+
+        /**
+         * @brief Integrate the drift of a selection of sets of charges with the given method
+         * @param groups Sets of charges of the event, the final position and propagation time are stored in these sets
+         * @param pending Indices of the sets of charges to propagate, which can be of both carrier types
+         * @param split_groups Sets of charges split off during the propagation, these are propagated in the same call
+         * @param deadline Point in time after which the propagation of all remaining sets of charges is terminated
+         */
+        template <Integrator I>
+        void propagate_integrated(std::vector<ChargeGroup>& groups,
+                                  const std::vector<size_t>& pending,
+                                  std::deque<ChargeGroup>& split_groups,
+                                  std::chrono::steady_clock::time_point deadline);
+
+        /**
+         * @brief Drift time and integrated mobility from the boundaries of slices in depth to the collecting surface
+         */
+        struct DriftTable {
+            // Depth of the lowest boundary, thickness of the slices and depth of the collecting surface
+            double z_min{}, slice_thickness{}, collection_z{};
+            // Values at all slice boundaries, infinite if the surface cannot be reached from the boundary
+            std::vector<double> time, mobility_integral;
+            // Mobility without electric field, used for carriers in undepleted regions
+            double zero_field_mobility{};
+            bool valid{};
+        };
+
+        /**
+         * @brief Tabulate the drift of a carrier type for electric fields only depending on the depth
+         * @param type Type of the carrier
+         * @return Table of the drift to the collecting surface, invalid if the field is zero or changes its direction
+         */
+        DriftTable build_drift_table(CarrierType type) const;
+
+        /**
+         * @brief Propagate a selection of sets of charges in a single step using the tabulated drift
+         * @param groups Sets of charges of the event, the final position and propagation time are stored in these sets
+         * @param pending Indices of the sets of charges to propagate, all of the carrier type of the table
+         * @param table Drift table of the carrier type
+         *
+         * The carriers drift along the depth to the collecting surface, or until the integration time is reached, and are
+         * displaced in the sensor plane by the diffusion accumulated along the drift path.
+         */
+        void propagate_analytic(std::vector<ChargeGroup>& groups,
+                                const std::vector<size_t>& pending,
+                                const DriftTable& table) const;
+
+        /**
+         * @brief Integrate the Gaussian charge cloud of a propagated set of charges over the pixel cells
+         * @param group Propagated set of charges with the variance of its cloud
+         * @return Local position of the center and charge of every pixel cell receiving a part of the cloud
          */
-        std::pair<ROOT::Math::XYZPoint, double> propagate(const ROOT::Math::XYZPoint& pos, const CarrierType& type);
+        std::vector<std::pair<ROOT::Math::XYZPoint, unsigned int>> integrate_cloud(const ChargeGroup& group) const;
+
+        /**
+         * @brief Check if a position is inside the collection volume, defined by the depth below the implant side
+         * @param position Local position in the sensor
+         * @return True if the position is in the collection volume, and within an implant if this is required
+         */
+        bool is_within_collection_volume(const ROOT::Math::XYZPoint& position) const;
+
+        // Collection volume in which the propagation is stopped if requested
+        bool stop_at_collection_{}, collect_from_implant_{};
+        double collection_plane_z_{};
+
+        // Transfer of the propagated charges to the nearest pixels, creating the propagated charges only if received
+        bool transfer_charges_{}, output_propagated_{true};
+        double max_depth_distance_{};
+
+        // Width of the time bins in which collected sets of charges are coalesced, disabled if zero
+        double coalesce_time_bin_{};
+        // Deposit, column and row of the pixel, whether the charges are within its implant, and the time bin
+        using CoalescingKey = std::tuple<const DepositedCharge*, int, int, bool, long long>;
+        struct CoalescedCharge {
+            ROOT::Math::XYZVector position;
+            double event_time{};
+            unsigned int charge{};
+        };
+
+        // Propagate every deposit as a single Gaussian charge cloud
+        bool charge_cloud_{};
 
-        // Random generator for this module
-        std::mt19937_64 random_generator_;
+        // Tabulated drift for electrons and holes if analytic propagation is used
+        bool analytic_propagation_{};
+        std::array<DriftTable, 2> drift_tables_;
 
         // Local copies of configuration parameters to avoid costly lookup:
         double temperature_{}, timestep_min_{}, timestep_max_{}, timestep_start_{}, integration_time_{},
             target_spatial_precision_{}, output_plots_step_{};
+        size_t batch_size_{}, sets_per_task_{};
+        bool spatial_sorting_{};
+        bool pair_carriers_{};
+        Integrator integrator_{Integrator::RK5};
+        ConfigParameter<unsigned int> charge_per_step_;
+        unsigned int max_charge_per_step_{};
+        double split_length_scale_{};
+        bool adaptive_grouping_{};
+        // Maximum number of steps per set of charges and wall-clock budget per event, unlimited if zero
+        uint64_t max_steps_{};
+        double event_time_budget_{};
+        ConfigParameter<bool> propagate_electrons_, propagate_holes_;
         bool output_plots_{}, output_linegraphs_{}, output_animations_{}, output_plots_lines_at_implants_{};
 
-        // Precalculated values for electron and hole mobility
-        double electron_Vm_;
-        double electron_Ec_;
-        double electron_Beta_;
-        double hole_Vm_;
-        double hole_Ec_;
-        double hole_Beta_;
+        // Mobility model and its tables for electrons and holes
+        std::unique_ptr<MobilityModel> mobility_model_;
+        std::array<MobilityTable, 2> mobility_tables_;
+
+        // Drift velocity of electrons and holes precomputed on the grid of the electric field if requested
+        bool precompute_velocity_{};
+        std::array<DetectorField<ROOT::Math::XYZVector, 3>, 2> velocity_fields_;
+
+        // Fast approximations of the mobility and sampler of the diffusion, shared by all threads
+        bool fast_math_{};
+        fast_math::ZigguratNormal normal_sampler_;
+        RegionOfInterest roi_;
+
+        // Effective trapping times of electrons and holes
+        std::array<double, 2> trapping_times_{};
 
         // Precalculated value for Boltzmann constant:
         double boltzmann_kT_;
@@ -104,22 +280,48 @@ namespace allpix {
 
         // Magnetic field
         bool has_magnetic_field_;
+        bool has_magnetic_field_grid_{false};
         ROOT::Math::XYZVector magnetic_field_;
 
-        // Deposits for the bound detector in this event
-        std::shared_ptr<DepositedChargeMessage> deposits_message_;
-
         // Statistical information
-        unsigned int total_propagated_charges_{};
-        unsigned int total_steps_{};
-        long double total_time_{};
-
-        // List of points to plot to plot for output plots
-        std::vector<std::pair<PropagatedCharge, std::vector<ROOT::Math::XYZPoint>>> output_plot_points_;
-        TH1D* step_length_histo_;
-        TH1D* drift_time_histo_;
-        TH1D* uncertainty_histo_;
-        TH1D* group_size_histo_;
+        ThreadedAccumulator<unsigned int> total_propagated_charges_;
+        ThreadedAccumulator<unsigned int> total_steps_;
+        ThreadedAccumulator<std::array<unsigned int, 6>> total_terminations_;
+        ThreadedAccumulator<unsigned int> budget_exceeded_events_;
+        ThreadedAccumulator<unsigned long long> skipped_deposits_;
+        ThreadedAccumulator<long double> total_time_;
+        ThreadedAccumulator<unsigned int> total_transferred_charges_;
+        ThreadedAccumulator<std::set<Pixel::Index>> unique_pixels_;
+        // Wall-clock time and number of the slowest events, ordered from the slowest
+        std::vector<std::pair<double, unsigned int>> slowest_events_;
+        size_t report_slowest_events_{};
+        std::mutex stats_mutex_;
+        StatisticsCounter* runge_kutta_steps_{};
+
+        /**
+         * @brief Drift line of a set of charges in the output plots, sampled every plot step times the stride
+         */
+        struct DriftLine {
+            DriftLine(PropagatedCharge propagated_charge) : charge(std::move(propagated_charge)) {}
+
+            /**
+             * @brief Number of plot steps covered by the sampled points
+             * @return Number of plot steps
+             */
+            size_t frames() const { return points.empty() ? 0 : (points.size() - 1) * stride + 1; }
+
+            PropagatedCharge charge;
+            std::vector<ROOT::Math::XYZPoint> points;
+            size_t stride{1};
+        };
+
+        // List of points to plot to plot for output plots, and the maximum number of lines and of points per line
+        std::vector<DriftLine> output_plot_points_;
+        size_t output_plots_max_lines_{}, output_plots_max_points_{};
+        std::unique_ptr<ThreadedHistogram<TH1D>> step_length_histo_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> drift_time_histo_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> uncertainty_histo_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> group_size_histo_;
     };
 
 } // namespace allpix
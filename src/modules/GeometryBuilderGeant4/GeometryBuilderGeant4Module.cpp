@@ -14,6 +14,7 @@
 #include <string>
 #include <utility>
 
+#include <G4MTRunManager.hh>
 #include <G4RunManager.hh>
 #include <G4UImanager.hh>
 #include <G4UIterminal.hh>
@@ -85,8 +86,19 @@ void GeometryBuilderGeant4Module::init() {
     SUPPRESS_STREAM(std::cout);
     SUPPRESS_STREAM(G4cout);
 
-    // Create the G4 run manager
+    // Create the G4 run manager, using the multithreaded version if the framework runs events in parallel
+#ifdef G4MULTITHREADED
+    if(config_.get<bool>("_multithreading", false)) {
+        auto run_manager_mt = std::make_unique<G4MTRunManager>();
+        // Events are processed by worker run managers on the framework threads, one Geant4 thread is sufficient
+        run_manager_mt->SetNumberOfThreads(1);
+        run_manager_g4_ = std::move(run_manager_mt);
+    } else {
+        run_manager_g4_ = std::make_unique<G4RunManager>();
+    }
+#else
     run_manager_g4_ = std::make_unique<G4RunManager>();
+#endif
 
     // Release stdout again
     RELEASE_STREAM(std::cout);
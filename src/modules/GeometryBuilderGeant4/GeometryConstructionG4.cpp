@@ -10,16 +10,29 @@
 
 #include "GeometryConstructionG4.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <iomanip>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <utility>
+#include <vector>
+
+#include <unistd.h>
 
 #include <G4Box.hh>
 #include <G4LogicalVolume.hh>
+#include <G4LogicalVolumeStore.hh>
 #include <G4NistManager.hh>
 #include <G4PVDivision.hh>
 #include <G4PVPlacement.hh>
 #include <G4PhysicalVolumeStore.hh>
+#include <G4Region.hh>
 #include <G4Sphere.hh>
 #include <G4StepLimiterPhysics.hh>
 #include <G4SubtractionSolid.hh>
@@ -28,10 +41,18 @@
 #include <G4UnionSolid.hh>
 #include <G4UserLimits.hh>
 #include <G4VSolid.hh>
+#include <G4Version.hh>
 #include <G4VisAttributes.hh>
 
+// Include GDML if Geant4 version has it
+#ifdef Geant4_GDML
+#include <G4GDMLParser.hh>
+#endif
+
 #include "core/geometry/HybridPixelDetectorModel.hpp"
+#include "core/module/ThreadPool.hpp"
 #include "core/module/exceptions.h"
+#include "core/utils/file.h"
 #include "core/utils/log.h"
 #include "tools/ROOT.h"
 #include "tools/geant4.h"
@@ -58,6 +79,19 @@ template <typename T, typename... Args> static std::shared_ptr<T> make_shared_no
  * margin. Finally builds all the individual detectors.
  */
 G4VPhysicalVolume* GeometryConstructionG4::Construct() {
+    share_model_volumes_ = config_.get<bool>("share_model_volumes", false);
+
+    // Load the geometry from the cache if it has been constructed before with the same parameters
+    std::string cache_file_name;
+    if(config_.has("geometry_cache")) {
+        cache_file_name = config_.getPath("geometry_cache") + "_" + geometry_hash() + ".gdml";
+        auto* cached_world = load_geometry_cache(cache_file_name);
+        if(cached_world != nullptr) {
+            build_regions();
+            return cached_world;
+        }
+    }
+
     // Initialize materials
     init_materials();
 
@@ -115,9 +149,17 @@ G4VPhysicalVolume* GeometryConstructionG4::Construct() {
     // Build all the detectors in the world
     build_detectors();
 
+    // Define the regions of the detectors
+    build_regions();
+
     // Check for overlaps:
     check_overlaps();
 
+    // Store the geometry for later runs
+    if(!cache_file_name.empty()) {
+        write_geometry_cache(cache_file_name);
+    }
+
     return world_phys_.get();
 }
 
@@ -181,11 +223,22 @@ void GeometryConstructionG4::init_materials() {
     materials_["solder"] = Solder;
 }
 
+/**
+ * The wrapper and the sensor are always built for every detector, as the sensitive detector of the deposition is bound to
+ * the logical volume of the sensor. The pixel grid, the chip, the support layers and the bump bonds are built per model if
+ * the volumes are shared, and then placed in the wrapper of every detector of this model.
+ */
 void GeometryConstructionG4::build_detectors() {
     // Loop through all detectors and construct them
     std::vector<std::shared_ptr<Detector>> detectors = geo_manager_->getDetectors();
     LOG(TRACE) << "Building " << detectors.size() << " device(s)";
 
+    // Replace the individual bump bonds by a layer of homogeneous material if requested
+    auto homogeneous_bumps = config_.get<bool>("homogeneous_bumps", false);
+
+    // Volumes of the models built so far, only reused if the volumes are shared between the detectors of a model
+    std::map<const DetectorModel*, ModelVolumes> model_volumes;
+
     for(auto& detector : detectors) {
         // Get pointer to the model of the detector
         auto model = detector->getModel();
@@ -248,51 +301,29 @@ void GeometryConstructionG4::build_detectors() {
             nullptr, sensor_pos, sensor_log.get(), "sensor_" + name + "_phys", wrapper_log.get(), false, 0, true);
         detector->setExternalObject("sensor_phys", sensor_phys);
 
-        // Create the pixel box and logical volume
-        auto pixel_box = std::make_shared<G4Box>("pixel_" + name,
-                                                 model->getPixelSize().x() / 2.0,
-                                                 model->getPixelSize().y() / 2.0,
-                                                 model->getSensorSize().z() / 2.0);
-        solids_.push_back(pixel_box);
-        auto pixel_log =
-            make_shared_no_delete<G4LogicalVolume>(pixel_box.get(), materials_["silicon"], "pixel_" + name + "_log");
-        detector->setExternalObject("pixel_log", pixel_log);
-
-        // Create the parameterization for the pixel grid
-        std::shared_ptr<G4VPVParameterisation> pixel_param =
-            std::make_shared<Parameterization2DG4>(model->getNPixels().x(),
-                                                   model->getPixelSize().x(),
-                                                   model->getPixelSize().y(),
-                                                   -model->getGridSize().x() / 2.0,
-                                                   -model->getGridSize().y() / 2.0,
-                                                   0);
-        detector->setExternalObject("pixel_param", pixel_param);
+        // Build the passive volumes of the model, or reuse the ones built for a previous detector of the same model
+        if(share_model_volumes_ && model_volumes.find(model.get()) != model_volumes.end()) {
+            LOG(DEBUG) << " Reusing passive volumes of " << volume_name(*detector);
+        } else {
+            model_volumes[model.get()] = build_model_volumes(model, volume_name(*detector), homogeneous_bumps);
+        }
+        const auto& volumes = model_volumes[model.get()];
+        detector->setExternalObject("pixel_log", volumes.pixel_log);
+        detector->setExternalObject("pixel_param", volumes.pixel_param);
 
         // WARNING: do not place the actual parameterization, only use it if we need it
 
         /* CHIP
          * the chip connected to the bumps bond and the support
          */
-
-        // Construct the chips only if necessary
-        if(model->getChipSize().z() > 1e-9) {
-            // Create the chip box
-            auto chip_box = std::make_shared<G4Box>("chip_" + name,
-                                                    model->getChipSize().x() / 2.0,
-                                                    model->getChipSize().y() / 2.0,
-                                                    model->getChipSize().z() / 2.0);
-            solids_.push_back(chip_box);
-
-            // Create the logical volume for the chip
-            auto chip_log =
-                make_shared_no_delete<G4LogicalVolume>(chip_box.get(), materials_["silicon"], "chip_" + name + "_log");
-            detector->setExternalObject("chip_log", chip_log);
+        if(volumes.chip_log != nullptr) {
+            detector->setExternalObject("chip_log", volumes.chip_log);
 
             // Place the chip
             auto chip_pos = toG4Vector(model->getChipCenter() - model->getGeometricalCenter());
             LOG(DEBUG) << "  - Chip\t\t:\t" << Units::display(chip_pos, {"mm", "um"});
             auto chip_phys = make_shared_no_delete<G4PVPlacement>(
-                nullptr, chip_pos, chip_log.get(), "chip_" + name + "_phys", wrapper_log.get(), false, 0, true);
+                nullptr, chip_pos, volumes.chip_log.get(), "chip_" + name + "_phys", wrapper_log.get(), false, 0, true);
             detector->setExternalObject("chip_phys", chip_phys);
         }
 
@@ -300,96 +331,39 @@ void GeometryConstructionG4::build_detectors() {
          * SUPPORT
          * optional layers of support
          */
-        auto supports_log = std::make_shared<std::vector<std::shared_ptr<G4LogicalVolume>>>();
         auto supports_phys = std::make_shared<std::vector<std::shared_ptr<G4PVPlacement>>>();
-        int support_idx = 0;
-        for(auto& layer : model->getSupportLayers()) {
-            // Create the box containing the support
-            auto support_box = std::make_shared<G4Box>("support_" + name + "_" + std::to_string(support_idx),
-                                                       layer.getSize().x() / 2.0,
-                                                       layer.getSize().y() / 2.0,
-                                                       layer.getSize().z() / 2.0);
-            solids_.push_back(support_box);
-
-            std::shared_ptr<G4VSolid> support_solid = support_box;
-            if(layer.hasHole()) {
-                // NOTE: Double the hole size in the z-direction to ensure no fake surfaces are created
-                auto hole_box = std::make_shared<G4Box>("support_" + name + "_hole_" + std::to_string(support_idx),
-                                                        layer.getHoleSize().x() / 2.0,
-                                                        layer.getHoleSize().y() / 2.0,
-                                                        layer.getHoleSize().z());
-                solids_.push_back(hole_box);
-
-                G4Transform3D transform(G4RotationMatrix(), toG4Vector(layer.getHoleCenter() - layer.getCenter()));
-                auto subtraction_solid =
-                    std::make_shared<G4SubtractionSolid>("support_" + name + "_subtraction_" + std::to_string(support_idx),
-                                                         support_box.get(),
-                                                         hole_box.get(),
-                                                         transform);
-                solids_.push_back(subtraction_solid);
-                support_solid = subtraction_solid;
-            }
-
-            // Create the logical volume for the support
-            auto support_material_iter = materials_.find(layer.getMaterial());
-            if(support_material_iter == materials_.end()) {
-                throw ModuleError("Cannot construct a support layer of material '" + layer.getMaterial() + "'");
-            }
-            auto support_log =
-                make_shared_no_delete<G4LogicalVolume>(support_solid.get(),
-                                                       support_material_iter->second,
-                                                       "support_" + name + "_log_" + std::to_string(support_idx));
-            supports_log->push_back(support_log);
-
+        auto& support_layers = model->getSupportLayers();
+        for(size_t support_idx = 0; support_idx < support_layers.size(); ++support_idx) {
             // Place the support
-            auto support_pos = toG4Vector(layer.getCenter() - model->getGeometricalCenter());
+            auto support_pos = toG4Vector(support_layers[support_idx].getCenter() - model->getGeometricalCenter());
             LOG(DEBUG) << "  - Support\t\t:\t" << Units::display(support_pos, {"mm", "um"});
             auto support_phys =
                 make_shared_no_delete<G4PVPlacement>(nullptr,
                                                      support_pos,
-                                                     support_log.get(),
+                                                     volumes.supports_log->at(support_idx).get(),
                                                      "support_" + name + "_phys_" + std::to_string(support_idx),
                                                      wrapper_log.get(),
                                                      false,
                                                      0,
                                                      true);
             supports_phys->push_back(support_phys);
-
-            ++support_idx;
         }
-        detector->setExternalObject("supports_log", supports_log);
+        detector->setExternalObject("supports_log", volumes.supports_log);
         detector->setExternalObject("supports_phys", supports_phys);
 
-        // Build the bump bonds only for hybrid pixel detectors
-        auto hybrid_model = std::dynamic_pointer_cast<HybridPixelDetectorModel>(model);
-        if(hybrid_model != nullptr) {
-            /* BUMPS
-             * the bump bonds connect the sensor to the readout chip
-             */
-
-            // Get parameters from model
-            auto bump_height = hybrid_model->getBumpHeight();
-            auto bump_sphere_radius = hybrid_model->getBumpSphereRadius();
-            auto bump_cylinder_radius = hybrid_model->getBumpCylinderRadius();
-
-            // Create the volume containing the bumps
-            auto bump_box = std::make_shared<G4Box>("bump_box_" + name,
-                                                    hybrid_model->getSensorSize().x() / 2.0,
-                                                    hybrid_model->getSensorSize().y() / 2.0,
-                                                    bump_height / 2.);
-            solids_.push_back(bump_box);
-
-            // Create the logical wrapper volume
-            auto bumps_wrapper_log =
-                make_shared_no_delete<G4LogicalVolume>(bump_box.get(), world_material_, "bumps_wrapper_" + name + "_log");
-            detector->setExternalObject("bumps_wrapper_log", bumps_wrapper_log);
+        /* BUMPS
+         * the bump bonds connect the sensor to the readout chip
+         */
+        if(volumes.bumps_wrapper_log != nullptr) {
+            detector->setExternalObject("bumps_wrapper_log", volumes.bumps_wrapper_log);
 
             // Place the general bumps volume
+            auto hybrid_model = std::static_pointer_cast<HybridPixelDetectorModel>(model);
             G4ThreeVector bumps_pos = toG4Vector(hybrid_model->getBumpsCenter() - hybrid_model->getGeometricalCenter());
             LOG(DEBUG) << "  - Bumps\t\t:\t" << Units::display(bumps_pos, {"mm", "um"});
             auto bumps_wrapper_phys = make_shared_no_delete<G4PVPlacement>(nullptr,
                                                                            bumps_pos,
-                                                                           bumps_wrapper_log.get(),
+                                                                           volumes.bumps_wrapper_log.get(),
                                                                            "bumps_wrapper_" + name + "_phys",
                                                                            wrapper_log.get(),
                                                                            false,
@@ -397,6 +371,128 @@ void GeometryConstructionG4::build_detectors() {
                                                                            true);
             detector->setExternalObject("bumps_wrapper_phys", bumps_wrapper_phys);
 
+            if(volumes.bumps_cell_log != nullptr) {
+                detector->setExternalObject("bumps_cell_log", volumes.bumps_cell_log);
+                detector->setExternalObject("bumps_param", volumes.bumps_param);
+                detector->setExternalObject("bumps_param_phys", volumes.bumps_param_phys);
+            }
+        }
+
+        // ALERT: NO COVER LAYER YET
+
+        LOG(TRACE) << " Constructed detector " << detector->getName() << " successfully";
+    }
+    if(share_model_volumes_) {
+        LOG(DEBUG) << "Built the passive volumes of " << model_volumes.size() << " model(s) for " << detectors.size()
+                   << " detector(s)";
+    }
+}
+
+/**
+ * The logical volumes are named after the given name of the detector or the model, the parameterized bump bonds are placed
+ * in the logical volume of the bump layer directly. The chip and the bump layer are only built if the model has them.
+ */
+GeometryConstructionG4::ModelVolumes GeometryConstructionG4::build_model_volumes(
+    const std::shared_ptr<DetectorModel>& model, const std::string& name, bool homogeneous_bumps) {
+    ModelVolumes volumes;
+
+    // Create the pixel box and logical volume
+    auto pixel_box = std::make_shared<G4Box>("pixel_" + name,
+                                             model->getPixelSize().x() / 2.0,
+                                             model->getPixelSize().y() / 2.0,
+                                             model->getSensorSize().z() / 2.0);
+    solids_.push_back(pixel_box);
+    volumes.pixel_log =
+        make_shared_no_delete<G4LogicalVolume>(pixel_box.get(), materials_["silicon"], "pixel_" + name + "_log");
+
+    // Create the parameterization for the pixel grid
+    volumes.pixel_param = std::make_shared<Parameterization2DG4>(model->getNPixels().x(),
+                                                                 model->getPixelSize().x(),
+                                                                 model->getPixelSize().y(),
+                                                                 -model->getGridSize().x() / 2.0,
+                                                                 -model->getGridSize().y() / 2.0,
+                                                                 0);
+
+    // Construct the chips only if necessary
+    if(model->getChipSize().z() > 1e-9) {
+        // Create the chip box
+        auto chip_box = std::make_shared<G4Box>("chip_" + name,
+                                                model->getChipSize().x() / 2.0,
+                                                model->getChipSize().y() / 2.0,
+                                                model->getChipSize().z() / 2.0);
+        solids_.push_back(chip_box);
+
+        // Create the logical volume for the chip
+        volumes.chip_log =
+            make_shared_no_delete<G4LogicalVolume>(chip_box.get(), materials_["silicon"], "chip_" + name + "_log");
+    }
+
+    volumes.supports_log = std::make_shared<std::vector<std::shared_ptr<G4LogicalVolume>>>();
+    int support_idx = 0;
+    for(auto& layer : model->getSupportLayers()) {
+        // Create the box containing the support
+        auto support_box = std::make_shared<G4Box>("support_" + name + "_" + std::to_string(support_idx),
+                                                   layer.getSize().x() / 2.0,
+                                                   layer.getSize().y() / 2.0,
+                                                   layer.getSize().z() / 2.0);
+        solids_.push_back(support_box);
+
+        std::shared_ptr<G4VSolid> support_solid = support_box;
+        if(layer.hasHole()) {
+            // NOTE: Double the hole size in the z-direction to ensure no fake surfaces are created
+            auto hole_box = std::make_shared<G4Box>("support_" + name + "_hole_" + std::to_string(support_idx),
+                                                    layer.getHoleSize().x() / 2.0,
+                                                    layer.getHoleSize().y() / 2.0,
+                                                    layer.getHoleSize().z());
+            solids_.push_back(hole_box);
+
+            G4Transform3D transform(G4RotationMatrix(), toG4Vector(layer.getHoleCenter() - layer.getCenter()));
+            auto subtraction_solid =
+                std::make_shared<G4SubtractionSolid>("support_" + name + "_subtraction_" + std::to_string(support_idx),
+                                                     support_box.get(),
+                                                     hole_box.get(),
+                                                     transform);
+            solids_.push_back(subtraction_solid);
+            support_solid = subtraction_solid;
+        }
+
+        // Create the logical volume for the support
+        auto support_material_iter = materials_.find(layer.getMaterial());
+        if(support_material_iter == materials_.end()) {
+            throw ModuleError("Cannot construct a support layer of material '" + layer.getMaterial() + "'");
+        }
+        auto support_log = make_shared_no_delete<G4LogicalVolume>(
+            support_solid.get(), support_material_iter->second, "support_" + name + "_log_" + std::to_string(support_idx));
+        volumes.supports_log->push_back(support_log);
+
+        ++support_idx;
+    }
+
+    // Build the bump bonds only for hybrid pixel detectors
+    auto hybrid_model = std::dynamic_pointer_cast<HybridPixelDetectorModel>(model);
+    if(hybrid_model != nullptr) {
+        // Get parameters from model
+        auto bump_height = hybrid_model->getBumpHeight();
+        auto bump_sphere_radius = hybrid_model->getBumpSphereRadius();
+        auto bump_cylinder_radius = hybrid_model->getBumpCylinderRadius();
+
+        // Create the volume containing the bumps
+        auto bump_box = std::make_shared<G4Box>("bump_box_" + name,
+                                                hybrid_model->getSensorSize().x() / 2.0,
+                                                hybrid_model->getSensorSize().y() / 2.0,
+                                                bump_height / 2.);
+        solids_.push_back(bump_box);
+
+        // Create the logical wrapper volume, filled with a homogeneous mixture of the bump material if requested
+        auto bumps_wrapper_material = world_material_;
+        if(homogeneous_bumps) {
+            bumps_wrapper_material = homogeneous_bump_material(hybrid_model, "bumps_" + name + "_material");
+        }
+        volumes.bumps_wrapper_log = make_shared_no_delete<G4LogicalVolume>(
+            bump_box.get(), bumps_wrapper_material, "bumps_wrapper_" + name + "_log");
+
+        // Place the individual bump bonds in the wrapper
+        if(!homogeneous_bumps) {
             // Create the individual bump solid
             auto bump_sphere = std::make_shared<G4Sphere>(
                 "bumps_" + name + "_sphere", 0, bump_sphere_radius, 0, 360 * CLHEP::deg, 0, 360 * CLHEP::deg);
@@ -408,12 +504,11 @@ void GeometryConstructionG4::build_detectors() {
             solids_.push_back(bump);
 
             // Create the logical volume for the individual bumps
-            auto bumps_cell_log =
+            volumes.bumps_cell_log =
                 make_shared_no_delete<G4LogicalVolume>(bump.get(), materials_["solder"], "bumps_" + name + "_log");
-            detector->setExternalObject("bumps_cell_log", bumps_cell_log);
 
             // Place the bump bonds grid
-            std::shared_ptr<G4VPVParameterisation> bumps_param = std::make_shared<Parameterization2DG4>(
+            volumes.bumps_param = std::make_shared<Parameterization2DG4>(
                 hybrid_model->getNPixels().x(),
                 hybrid_model->getPixelSize().x(),
                 hybrid_model->getPixelSize().y(),
@@ -422,37 +517,313 @@ void GeometryConstructionG4::build_detectors() {
                 -(hybrid_model->getNPixels().y() * hybrid_model->getPixelSize().y()) / 2.0 +
                     (hybrid_model->getBumpsCenter().y() - hybrid_model->getCenter().y()),
                 0);
-            detector->setExternalObject("bumps_param", bumps_param);
 
-            std::shared_ptr<G4PVParameterised> bumps_param_phys =
+            volumes.bumps_param_phys =
                 std::make_shared<ParameterisedG4>("bumps_" + name + "_phys",
-                                                  bumps_cell_log.get(),
-                                                  bumps_wrapper_log.get(),
+                                                  volumes.bumps_cell_log.get(),
+                                                  volumes.bumps_wrapper_log.get(),
                                                   kUndefined,
                                                   hybrid_model->getNPixels().x() * hybrid_model->getNPixels().y(),
-                                                  bumps_param.get(),
+                                                  volumes.bumps_param.get(),
                                                   false);
-            detector->setExternalObject("bumps_param_phys", bumps_param_phys);
         }
+    }
+    return volumes;
+}
 
-        // ALERT: NO COVER LAYER YET
+/**
+ * Models are named after their type, with the number of the model appended if multiple models of the same type exist
+ * because some detectors change parameters of their model. The names are assigned in the order of the detectors, such
+ * that they are identical for the construction and for reading the geometry from the cache.
+ */
+std::string GeometryConstructionG4::volume_name(const Detector& detector) {
+    if(!share_model_volumes_) {
+        return detector.getName();
+    }
+    auto model = detector.getModel();
+    auto name_iter = model_volume_names_.find(model.get());
+    if(name_iter == model_volume_names_.end()) {
+        auto count = std::count_if(model_volume_names_.begin(), model_volume_names_.end(), [&](const auto& model_name) {
+            return model_name.first->getType() == model->getType();
+        });
+        auto name = "model_" + model->getType() + (count == 0 ? "" : "_" + std::to_string(count));
+        name_iter = model_volume_names_.emplace(model.get(), name).first;
+    }
+    return name_iter->second;
+}
 
-        LOG(TRACE) << " Constructed detector " << detector->getName() << " successfully";
+/**
+ * The fraction of the layer filled by the bumps is calculated from the volume of the union of the sphere and the cylinder
+ * of a single bump within the layer, relative to the volume of a pixel cell of the layer. The remaining volume is filled
+ * with the world material, and both are mixed by their mass fractions.
+ */
+G4Material* GeometryConstructionG4::homogeneous_bump_material(const std::shared_ptr<HybridPixelDetectorModel>& model,
+                                                              const std::string& name) {
+    auto height = model->getBumpHeight();
+    auto sphere_radius = model->getBumpSphereRadius();
+    auto cylinder_radius = model->getBumpCylinderRadius();
+
+    // Volume of the sphere within the layer, of the cylinder and of their intersection
+    auto half_height = std::min(sphere_radius, height / 2.);
+    auto sphere_volume = 2. * CLHEP::pi * (sphere_radius * sphere_radius * half_height - std::pow(half_height, 3) / 3.);
+    auto cylinder_volume = CLHEP::pi * cylinder_radius * cylinder_radius * height;
+    auto inner_radius =
+        std::min(cylinder_radius, std::sqrt(std::max(sphere_radius * sphere_radius - height * height / 4., 0.)));
+    auto outer_radius = std::min(cylinder_radius, sphere_radius);
+    auto intersection_volume = CLHEP::pi * height * inner_radius * inner_radius +
+                               4. * CLHEP::pi / 3. *
+                                   (std::pow(sphere_radius * sphere_radius - inner_radius * inner_radius, 1.5) -
+                                    std::pow(sphere_radius * sphere_radius - outer_radius * outer_radius, 1.5));
+
+    auto cell_volume = model->getPixelSize().x() * model->getPixelSize().y() * height;
+    auto fraction = std::min((sphere_volume + cylinder_volume - intersection_volume) / cell_volume, 1.);
+    auto solder_density = fraction * materials_["solder"]->GetDensity();
+    auto world_density = (1 - fraction) * world_material_->GetDensity();
+
+    auto* material = new G4Material(name, solder_density + world_density, 2);
+    material->AddMaterial(materials_["solder"], solder_density / (solder_density + world_density));
+    material->AddMaterial(world_material_, world_density / (solder_density + world_density));
+    LOG(DEBUG) << "Bump bonds fill " << 100 * fraction << "% of the bump layer, homogeneous density is "
+               << (solder_density + world_density) / (CLHEP::g / CLHEP::cm3) << " g/cm3";
+    return material;
+}
+
+/**
+ * Every detector has a region containing its sensor, and a region containing the passive material such as the chip, the
+ * bump bonds and the support layers. The passive region is rooted at the wrapper volume and thus holds all volumes of the
+ * detector except for the sensor, which is the root of its own region. Production cuts and user limits of the regions can
+ * be defined by the modules using them, everything outside of the detectors belongs to the default region of the world.
+ */
+void GeometryConstructionG4::build_regions() {
+    std::map<std::string, std::shared_ptr<G4Region>> model_regions;
+    for(auto& detector : geo_manager_->getDetectors()) {
+        auto wrapper_log = detector->getExternalObject<G4LogicalVolume>("wrapper_log");
+        auto sensor_log = detector->getExternalObject<G4LogicalVolume>("sensor_log");
+        if(wrapper_log == nullptr || sensor_log == nullptr) {
+            throw ModuleError("Detector " + detector->getName() + " has no sensitive device (broken Geant4 geometry)");
+        }
+
+        // A logical volume can only belong to a single region, shared passive volumes thus require a region per model
+        std::shared_ptr<G4Region> passive_region;
+        if(share_model_volumes_) {
+            auto name = volume_name(*detector);
+            auto& model_region = model_regions[name];
+            if(model_region == nullptr) {
+                model_region = make_shared_no_delete<G4Region>(name + "_passive_region");
+            }
+            passive_region = model_region;
+        } else {
+            passive_region = make_shared_no_delete<G4Region>(detector->getName() + "_passive_region");
+        }
+        passive_region->AddRootLogicalVolume(wrapper_log.get());
+        detector->setExternalObject("passive_region", passive_region);
+
+        auto sensor_region = make_shared_no_delete<G4Region>(detector->getName() + "_sensor_region");
+        sensor_region->AddRootLogicalVolume(sensor_log.get());
+        detector->setExternalObject("sensor_region", sensor_region);
+        LOG(TRACE) << "Defined sensor and passive regions for detector " << detector->getName();
     }
 }
 
+/**
+ * Placed volumes are checked against their sisters without modifying any volume, such that they can be checked in parallel
+ * on a pool of worker threads. Parameterised and replicated volumes are moved to every copy while being checked, and are
+ * therefore always checked sequentially before all other volumes. The result is stored in a cache file named after the hash
+ * of the geometry if requested, and read back by later runs instead of checking the geometry again.
+ */
 void GeometryConstructionG4::check_overlaps() {
+    // Reuse the result of a previous check of the same geometry
+    std::string cache_file_name;
+    if(config_.has("overlap_cache")) {
+        cache_file_name = config_.getPath("overlap_cache") + "_" + geometry_hash() + ".overlaps";
+        std::ifstream cache_file(cache_file_name);
+        std::string result;
+        if(cache_file >> result && (result == "pass" || result == "fail")) {
+            if(result == "fail") {
+                LOG(ERROR) << "Overlapping volumes detected in previous check of this geometry.";
+            } else {
+                LOG(INFO) << "No overlapping volumes detected in previous check of this geometry.";
+            }
+            return;
+        }
+    }
+
     G4PhysicalVolumeStore* phys_volume_store = G4PhysicalVolumeStore::GetInstance();
     LOG(DEBUG) << phys_volume_store->size() << " physical volumes are defined";
 
+    auto workers = config_.get<unsigned int>("overlap_check_workers", 1);
+    if(workers == 0) {
+        throw InvalidValueError(config_, "overlap_check_workers", "number of workers should be strictly positive");
+    }
+#ifndef G4MULTITHREADED
+    if(workers > 1) {
+        LOG(WARNING) << "Parallel overlap checks require Geant4 with multithreading support, checking sequentially";
+        workers = 1;
+    }
+#endif
+
     bool overlapFlag = false;
+    std::vector<G4VPhysicalVolume*> placed_volumes;
     for(auto volume : (*phys_volume_store)) {
+        if(workers > 1 && !volume->IsParameterised() && !volume->IsReplicated()) {
+            placed_volumes.push_back(volume);
+            continue;
+        }
         LOG(TRACE) << "Checking overlaps for physical volume \"" << volume->GetName() << "\"";
         overlapFlag = volume->CheckOverlaps(1000, 0., false) || overlapFlag;
     }
+
+    if(!placed_volumes.empty()) {
+        LOG(DEBUG) << "Checking overlaps of " << placed_volumes.size() << " placed volumes with " << workers
+                   << " worker threads";
+        auto init_function = [log_level = Log::getReportingLevel(), log_format = Log::getFormat()]() {
+            Log::setReportingLevel(log_level);
+            Log::setFormat(log_format);
+        };
+        ThreadPool thread_pool(workers, init_function);
+        ThreadPool::TaskGroup group;
+        std::vector<std::future<bool>> tasks;
+        tasks.reserve(placed_volumes.size());
+        for(auto* volume : placed_volumes) {
+            tasks.push_back(thread_pool.submit(group, [volume]() {
+                LOG(TRACE) << "Checking overlaps for physical volume \"" << volume->GetName() << "\"";
+                return volume->CheckOverlaps(1000, 0., false);
+            }));
+        }
+        thread_pool.wait_for(group);
+        for(auto& task : tasks) {
+            overlapFlag = task.get() || overlapFlag;
+        }
+    }
+
     if(overlapFlag) {
         LOG(ERROR) << "Overlapping volumes detected.";
     } else {
         LOG(INFO) << "No overlapping volumes detected.";
     }
+
+    // Store the result for later runs, renaming a temporary file to never leave a partially written cache file
+    if(!cache_file_name.empty()) {
+        auto temporary_file_name = cache_file_name + "." + std::to_string(getpid());
+        {
+            std::ofstream cache_file(temporary_file_name);
+            cache_file << (overlapFlag ? "fail" : "pass") << std::endl;
+        }
+        if(std::rename(temporary_file_name.c_str(), cache_file_name.c_str()) != 0) {
+            LOG(WARNING) << "Could not store result of overlap check in cache " << cache_file_name;
+            std::remove(temporary_file_name.c_str());
+        }
+    }
+}
+
+/**
+ * The hash covers the parameters of the world, the position and orientation of all detectors and the full configuration
+ * of their models, as well as the Geant4 version used to write the cache.
+ */
+std::string GeometryConstructionG4::geometry_hash() const {
+    std::stringstream description;
+    description << std::setprecision(17) << G4VERSION_NUMBER << '\n';
+    for(auto& key :
+        {"world_material", "world_margin_percentage", "world_minimum_margin", "homogeneous_bumps", "share_model_volumes"}) {
+        description << key << '=' << config_.getText(key, "") << '\n';
+    }
+    for(auto& detector : geo_manager_->getDetectors()) {
+        std::vector<double> orientation(9);
+        detector->getOrientation().GetComponents(orientation.begin(), orientation.end());
+        description << detector->getName() << '\n' << detector->getType() << '\n' << detector->getPosition() << '\n';
+        for(auto component : orientation) {
+            description << component << ' ';
+        }
+        description << '\n';
+        for(auto& model_config : detector->getModel()->getConfigurations()) {
+            description << '[' << model_config.getName() << "]\n";
+            for(auto& key_value : model_config.getAll()) {
+                description << key_value.first << '=' << key_value.second << '\n';
+            }
+        }
+    }
+
+    // FNV-1a hash of the description
+    std::uint64_t hash = 14695981039346656037ull;
+    for(auto character : description.str()) {
+        hash = (hash ^ static_cast<unsigned char>(character)) * 1099511628211ull;
+    }
+    std::stringstream hash_string;
+    hash_string << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return hash_string.str();
+}
+
+/**
+ * @throws InvalidValueError If Geant4 has been built without GDML support
+ *
+ * The geometry is read from the GDML file without any overlap checks. The logical volumes of the detectors are looked up by
+ * their name to link them to the detectors again. The parameterization of the pixel matrix, which is only used for the
+ * visualization, is not part of the cache.
+ */
+G4VPhysicalVolume* GeometryConstructionG4::load_geometry_cache(const std::string& file_name) {
+#ifdef Geant4_GDML
+    if(!path_is_file(file_name)) {
+        LOG(INFO) << "No cached Geant4 geometry found, constructing the geometry";
+        return nullptr;
+    }
+
+    LOG(TRACE) << "Reading Geant4 geometry from " << file_name;
+    G4GDMLParser parser;
+    parser.Read(file_name, false);
+    auto* world_phys = parser.GetWorldVolume();
+    world_phys->GetLogicalVolume()->SetVisAttributes(G4VisAttributes::GetInvisible());
+
+    // Link the logical volumes to the detectors
+    auto* volume_store = G4LogicalVolumeStore::GetInstance();
+    auto find_volume = [volume_store](const std::string& name) {
+        auto* volume = volume_store->GetVolume(name, false);
+        return (volume == nullptr ? nullptr : std::shared_ptr<G4LogicalVolume>(volume, [](G4LogicalVolume*) {}));
+    };
+    for(auto& detector : geo_manager_->getDetectors()) {
+        auto name = detector->getName();
+        detector->setExternalObject("wrapper_log", find_volume("wrapper_" + name + "_log"));
+        detector->setExternalObject("sensor_log", find_volume("sensor_" + name + "_log"));
+
+        // The passive volumes are named after the model if they are shared between its detectors
+        name = volume_name(*detector);
+        detector->setExternalObject("chip_log", find_volume("chip_" + name + "_log"));
+        detector->setExternalObject("bumps_wrapper_log", find_volume("bumps_wrapper_" + name + "_log"));
+        detector->setExternalObject("bumps_cell_log", find_volume("bumps_" + name + "_log"));
+
+        auto supports_log = std::make_shared<std::vector<std::shared_ptr<G4LogicalVolume>>>();
+        for(size_t support_idx = 0; support_idx < detector->getModel()->getSupportLayers().size(); ++support_idx) {
+            auto support_log = find_volume("support_" + name + "_log_" + std::to_string(support_idx));
+            if(support_log != nullptr) {
+                supports_log->push_back(support_log);
+            }
+        }
+        detector->setExternalObject("supports_log", supports_log);
+    }
+
+    LOG(INFO) << "Loaded cached Geant4 geometry from " << file_name;
+    return world_phys;
+#else
+    (void)file_name;
+    throw InvalidValueError(config_, "geometry_cache", "Geant4 has been built without GDML support");
+#endif
+}
+
+/**
+ * The geometry is written to a temporary file first, which is renamed afterwards. Concurrent jobs constructing the same
+ * geometry thus never read a partially written cache file.
+ */
+void GeometryConstructionG4::write_geometry_cache(const std::string& file_name) {
+#ifdef Geant4_GDML
+    auto temporary_file_name = file_name + "." + std::to_string(getpid()) + ".gdml";
+    G4GDMLParser parser;
+    parser.Write(temporary_file_name, world_log_.get());
+    if(std::rename(temporary_file_name.c_str(), file_name.c_str()) != 0) {
+        LOG(WARNING) << "Could not store Geant4 geometry in cache " << file_name;
+        std::remove(temporary_file_name.c_str());
+        return;
+    }
+    LOG(INFO) << "Stored Geant4 geometry in cache " << file_name;
+#else
+    (void)file_name;
+#endif
 }
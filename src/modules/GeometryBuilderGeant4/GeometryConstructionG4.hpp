@@ -10,14 +10,21 @@
 #ifndef ALLPIX_MODULE_GEOMETRY_CONSTRUCTION_DETECTOR_CONSTRUCTION_H
 #define ALLPIX_MODULE_GEOMETRY_CONSTRUCTION_DETECTOR_CONSTRUCTION_H
 
+#include <map>
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
+#include "G4LogicalVolume.hh"
 #include "G4Material.hh"
+#include "G4PVParameterised.hh"
+#include "G4VPVParameterisation.hh"
 #include "G4VSolid.hh"
 #include "G4VUserDetectorConstruction.hh"
 
 #include "core/geometry/GeometryManager.hpp"
+#include "core/geometry/HybridPixelDetectorModel.hpp"
 
 namespace allpix {
     /**
@@ -53,13 +60,81 @@ namespace allpix {
         void build_detectors();
 
         /**
-         * @brief Check all placed volumes for overlaps
+         * @brief Logical volumes of the passive parts of a detector model, which can be placed in multiple detectors
+         */
+        struct ModelVolumes {
+            std::shared_ptr<G4LogicalVolume> pixel_log;
+            std::shared_ptr<G4VPVParameterisation> pixel_param;
+            std::shared_ptr<G4LogicalVolume> chip_log;
+            std::shared_ptr<std::vector<std::shared_ptr<G4LogicalVolume>>> supports_log;
+            std::shared_ptr<G4LogicalVolume> bumps_wrapper_log;
+            std::shared_ptr<G4LogicalVolume> bumps_cell_log;
+            std::shared_ptr<G4VPVParameterisation> bumps_param;
+            std::shared_ptr<G4PVParameterised> bumps_param_phys;
+        };
+
+        /**
+         * @brief Build the logical volumes of the pixel grid, the chip, the support layers and the bump bonds of a model
+         * @param model Model of the detector
+         * @param name Name of the detector or of the model the volumes are named after
+         * @param homogeneous_bumps Replace the individual bump bonds by a homogeneous layer
+         * @return Logical volumes of the model, which are not placed yet except for the bump bonds in their layer
+         */
+        ModelVolumes
+        build_model_volumes(const std::shared_ptr<DetectorModel>& model, const std::string& name, bool homogeneous_bumps);
+
+        /**
+         * @brief Get the name of the passive volumes of a detector
+         * @param detector Detector to get the name for
+         * @return Name of the detector, or the name of its model if the volumes are shared between the detectors of a model
+         */
+        std::string volume_name(const Detector& detector);
+
+        /**
+         * @brief Create the material of a homogeneous layer replacing the individual bump bonds of a hybrid detector
+         * @param model Model of the hybrid detector
+         * @param name Name of the material
+         * @return Mixture of the bump material and the world material with the average density of the bump layer
+         */
+        G4Material* homogeneous_bump_material(const std::shared_ptr<HybridPixelDetectorModel>& model,
+                                              const std::string& name);
+
+        /**
+         * @brief Build the Geant4 regions of the sensor and of the passive material of all detectors
+         */
+        void build_regions();
+
+        /**
+         * @brief Check all placed volumes for overlaps, optionally in parallel or using the result of a previous check
          */
         void check_overlaps();
 
+        /**
+         * @brief Calculate a hash of all parameters the geometry is constructed from
+         * @return Hexadecimal representation of the hash
+         */
+        std::string geometry_hash() const;
+
+        /**
+         * @brief Load the geometry from the cache file if it exists
+         * @param file_name Path of the cache file
+         * @return Physical volume representing the world, or a null pointer if the cache file does not exist
+         */
+        G4VPhysicalVolume* load_geometry_cache(const std::string& file_name);
+
+        /**
+         * @brief Store the constructed geometry in the cache file
+         * @param file_name Path of the cache file
+         */
+        void write_geometry_cache(const std::string& file_name);
+
         // List of all materials
         std::map<std::string, G4Material*> materials_;
 
+        // Share the passive volumes between the detectors of a model, which are named after the model
+        bool share_model_volumes_{false};
+        std::map<const DetectorModel*, std::string> model_volume_names_;
+
         // Storage of internal objects
         std::vector<std::shared_ptr<G4VSolid>> solids_;
         G4Material* world_material_{};
@@ -0,0 +1,349 @@
+/**
+ * @file
+ * @brief Implementation of HDF5 writer module
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "HDF5WriterModule.hpp"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/module/exceptions.h"
+#include "core/utils/file.h"
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+// Maximum length of the names of the detectors in the table of detectors
+static constexpr size_t detector_name_length = 64;
+
+HDF5WriterModule::HDF5WriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr)
+    : Module(config), geo_mgr_(geo_mgr) {
+    // Bind to all pixel hits and pixel charges, none of them are required
+    messenger->bindMulti(this, &HDF5WriterModule::pixel_hit_messages_, MsgFlags::NONE);
+    messenger->bindMulti(this, &HDF5WriterModule::pixel_charge_messages_, MsgFlags::NONE);
+}
+
+HDF5WriterModule::~HDF5WriterModule() {
+    // Stop the writer thread and release the file if the module has not been finalized
+    stop_writer();
+    close_file();
+}
+
+void HDF5WriterModule::init() {
+    write_pulses_ = config_.get<bool>("write_pulses", false);
+    chunk_size_ = config_.get<hsize_t>("chunk_size", 16384);
+    if(chunk_size_ == 0) {
+        throw InvalidValueError(config_, "chunk_size", "number of rows per chunk should be strictly positive");
+    }
+    compression_level_ = config_.get<unsigned int>("compression_level", 4);
+    if(compression_level_ > 9) {
+        throw InvalidValueError(config_, "compression_level", "deflate compression level should be between 0 and 9");
+    }
+    shuffle_ = config_.get<bool>("shuffle", true);
+    events_per_batch_ = config_.get<unsigned int>("events_per_batch", 100);
+    if(events_per_batch_ == 0) {
+        throw InvalidValueError(config_, "events_per_batch", "number of events per batch should be strictly positive");
+    }
+
+    // Errors are reported by the return values, do not let the library print them as well
+    H5Eset_auto2(H5E_DEFAULT, nullptr, nullptr);
+
+    output_file_name_ =
+        createOutputFile(allpix::add_file_extension(config_.get<std::string>("file_name", "data"), "h5"), true);
+    file_ = H5Fcreate(output_file_name_.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    if(file_ < 0) {
+        throw ModuleError("Cannot create HDF5 file " + output_file_name_);
+    }
+
+    // Write the table of detectors, the rows of all other datasets refer to the detectors by their index in this table
+    auto detectors = geo_mgr_->getDetectors();
+    std::vector<char> names(detectors.size() * detector_name_length, '\0');
+    for(size_t idx = 0; idx < detectors.size(); ++idx) {
+        auto name = detectors[idx]->getName();
+        if(name.size() >= detector_name_length) {
+            throw ModuleError("Name of detector " + name + " is too long to be stored in the table of detectors");
+        }
+        std::copy(name.begin(), name.end(), names.begin() + static_cast<std::ptrdiff_t>(idx * detector_name_length));
+        detector_indices_[name] = static_cast<uint16_t>(idx);
+    }
+    hid_t name_type = H5Tcopy(H5T_C_S1);
+    H5Tset_size(name_type, detector_name_length);
+    hsize_t detector_count = detectors.size();
+    hid_t space = H5Screate_simple(1, &detector_count, nullptr);
+    hid_t dataset = H5Dcreate2(file_, "detectors", name_type, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    auto status = dataset < 0 ? -1 : H5Dwrite(dataset, name_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, names.data());
+    if(dataset >= 0) {
+        H5Dclose(dataset);
+    }
+    H5Sclose(space);
+    H5Tclose(name_type);
+    if(status < 0) {
+        throw ModuleError("Cannot write the table of detectors to HDF5 file " + output_file_name_);
+    }
+
+    // Create the datasets of all objects with a compound type matching the rows in memory
+    hid_t hit_type = H5Tcreate(H5T_COMPOUND, sizeof(HitRow));
+    H5Tinsert(hit_type, "event", HOFFSET(HitRow, event), H5T_NATIVE_UINT32);
+    H5Tinsert(hit_type, "detector", HOFFSET(HitRow, detector), H5T_NATIVE_UINT16);
+    H5Tinsert(hit_type, "column", HOFFSET(HitRow, column), H5T_NATIVE_UINT32);
+    H5Tinsert(hit_type, "row", HOFFSET(HitRow, row), H5T_NATIVE_UINT32);
+    H5Tinsert(hit_type, "time", HOFFSET(HitRow, time), H5T_NATIVE_DOUBLE);
+    H5Tinsert(hit_type, "signal", HOFFSET(HitRow, signal), H5T_NATIVE_DOUBLE);
+    hits_dataset_ = create_dataset("pixel_hits", hit_type);
+
+    hid_t charge_type = H5Tcreate(H5T_COMPOUND, sizeof(ChargeRow));
+    H5Tinsert(charge_type, "event", HOFFSET(ChargeRow, event), H5T_NATIVE_UINT32);
+    H5Tinsert(charge_type, "detector", HOFFSET(ChargeRow, detector), H5T_NATIVE_UINT16);
+    H5Tinsert(charge_type, "column", HOFFSET(ChargeRow, column), H5T_NATIVE_UINT32);
+    H5Tinsert(charge_type, "row", HOFFSET(ChargeRow, row), H5T_NATIVE_UINT32);
+    H5Tinsert(charge_type, "charge", HOFFSET(ChargeRow, charge), H5T_NATIVE_UINT32);
+    H5Tinsert(charge_type, "pulse_binning", HOFFSET(ChargeRow, pulse_binning), H5T_NATIVE_DOUBLE);
+    H5Tinsert(charge_type, "pulse_offset", HOFFSET(ChargeRow, pulse_offset), H5T_NATIVE_UINT64);
+    H5Tinsert(charge_type, "pulse_length", HOFFSET(ChargeRow, pulse_length), H5T_NATIVE_UINT32);
+    charges_dataset_ = create_dataset("pixel_charges", charge_type);
+
+    if(write_pulses_) {
+        pulses_dataset_ = create_dataset("pulse_samples", H5Tcopy(H5T_NATIVE_DOUBLE));
+    }
+
+    if(compression_level_ > 0) {
+        LOG(INFO) << "Creating datasets with chunks of " << chunk_size_ << " rows compressed with deflate level "
+                  << compression_level_ << (shuffle_ ? " after shuffling" : "");
+    } else {
+        LOG(INFO) << "Creating datasets with chunks of " << chunk_size_ << " rows without compression";
+    }
+
+    // Start the thread writing and compressing the batches in the background if requested
+    asynchronous_ = config_.get<bool>("asynchronous_writing", true);
+    if(asynchronous_) {
+        write_queue_size_ = config_.get<size_t>("write_queue_size", 4);
+        if(write_queue_size_ == 0) {
+            throw InvalidValueError(config_, "write_queue_size", "size of the write queue should be strictly positive");
+        }
+
+        auto log_level = Log::getReportingLevel();
+        auto log_format = Log::getFormat();
+        auto log_section = Log::getSection();
+        writer_thread_ = std::thread([this, log_level, log_format, log_section]() {
+            Log::setReportingLevel(log_level);
+            Log::setFormat(log_format);
+            Log::setSection(log_section);
+            write_loop();
+        });
+    }
+}
+
+HDF5WriterModule::Dataset HDF5WriterModule::create_dataset(const std::string& name, hid_t type) {
+    Dataset dataset;
+    dataset.type = type;
+
+    hsize_t initial_size = 0;
+    hsize_t maximum_size = H5S_UNLIMITED;
+    hid_t space = H5Screate_simple(1, &initial_size, &maximum_size);
+
+    // Extendable datasets have to be chunked, the filters are applied to every chunk separately
+    hid_t properties = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(properties, 1, &chunk_size_);
+    if(compression_level_ > 0) {
+        if(shuffle_) {
+            H5Pset_shuffle(properties);
+        }
+        H5Pset_deflate(properties, compression_level_);
+    }
+
+    dataset.id = H5Dcreate2(file_, name.c_str(), type, space, H5P_DEFAULT, properties, H5P_DEFAULT);
+    H5Pclose(properties);
+    H5Sclose(space);
+    if(dataset.id < 0) {
+        H5Tclose(type);
+        throw ModuleError("Cannot create dataset " + name + " in HDF5 file " + output_file_name_);
+    }
+    return dataset;
+}
+
+/**
+ * The dataset is extended by the number of new rows, after which the new rows are selected as a hyperslab of the file
+ * space and written in a single call. The chunks are compressed by the library while they are written.
+ */
+void HDF5WriterModule::append(Dataset& dataset, const void* data, size_t rows) {
+    if(rows == 0) {
+        return;
+    }
+
+    hsize_t offset = dataset.rows;
+    hsize_t count = rows;
+    hsize_t new_size = offset + count;
+    if(H5Dset_extent(dataset.id, &new_size) < 0) {
+        throw ModuleError("Cannot extend dataset in HDF5 file " + output_file_name_);
+    }
+
+    hid_t file_space = H5Dget_space(dataset.id);
+    hid_t memory_space = H5Screate_simple(1, &count, nullptr);
+    auto status = H5Sselect_hyperslab(file_space, H5S_SELECT_SET, &offset, nullptr, &count, nullptr);
+    if(status >= 0) {
+        status = H5Dwrite(dataset.id, dataset.type, memory_space, file_space, H5P_DEFAULT, data);
+    }
+    H5Sclose(memory_space);
+    H5Sclose(file_space);
+    if(status < 0) {
+        throw ModuleError("Cannot write to dataset in HDF5 file " + output_file_name_);
+    }
+    dataset.rows = new_size;
+}
+
+void HDF5WriterModule::write_batch(const Batch& batch) {
+    LOG(TRACE) << "Writing batch of " << batch.events << " events with " << batch.hits.size() << " pixel hits and "
+               << batch.charges.size() << " pixel charges";
+    append(hits_dataset_, batch.hits.data(), batch.hits.size());
+    append(charges_dataset_, batch.charges.data(), batch.charges.size());
+    if(write_pulses_) {
+        append(pulses_dataset_, batch.pulse_samples.data(), batch.pulse_samples.size());
+    }
+}
+
+/**
+ * The objects are converted to rows directly, such that the messages are released at the end of the event. The offsets of
+ * the pulses refer to the position of the samples in the final dataset, counting all samples queued before.
+ */
+void HDF5WriterModule::run(unsigned int event_num) {
+    for(auto& message : pixel_hit_messages_) {
+        auto detector = detector_indices_.at(message->getDetector()->getName());
+        for(auto& hit : message->getData()) {
+            auto index = hit.getIndex();
+            batch_.hits.push_back({event_num, detector, index.x(), index.y(), hit.getTime(), hit.getSignal()});
+        }
+    }
+
+    for(auto& message : pixel_charge_messages_) {
+        auto detector = detector_indices_.at(message->getDetector()->getName());
+        for(auto& charge : message->getData()) {
+            auto index = charge.getIndex();
+            ChargeRow row{event_num, detector, index.x(), index.y(), charge.getCharge(), 0, 0, 0};
+            if(write_pulses_) {
+                const auto& pulse = charge.getPulse();
+                const auto& samples = pulse.getPulse();
+                row.pulse_binning = pulse.getBinning();
+                row.pulse_offset = pulse_samples_;
+                row.pulse_length = static_cast<uint32_t>(samples.size());
+                batch_.pulse_samples.insert(batch_.pulse_samples.end(), samples.begin(), samples.end());
+                pulse_samples_ += samples.size();
+            }
+            batch_.charges.push_back(row);
+        }
+    }
+
+    pixel_hit_messages_.clear();
+    pixel_charge_messages_.clear();
+
+    ++batch_.events;
+    if(batch_.events >= events_per_batch_) {
+        queue_batch();
+    }
+}
+
+/**
+ * If writing asynchronously, the batch is queued for the writer thread and this method only blocks if the queue is full.
+ * The number of times the queue was full and the time spent waiting for the writer thread are added to the statistics.
+ */
+void HDF5WriterModule::queue_batch() {
+    Batch batch;
+    std::swap(batch, batch_);
+    if(!writer_thread_.joinable()) {
+        write_batch(batch);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    if(write_queue_.size() >= write_queue_size_ && !writer_exception_) {
+        LOG(TRACE) << "Write queue is full, waiting for writer thread";
+        ++write_queue_full_;
+        ScopedTimer timer(write_wait_time_);
+        queue_condition_.wait(lock, [this]() { return write_queue_.size() < write_queue_size_ || writer_exception_; });
+    }
+    if(writer_exception_) {
+        std::rethrow_exception(writer_exception_);
+    }
+    write_queue_.push(std::move(batch));
+    queue_condition_.notify_all();
+}
+
+void HDF5WriterModule::write_loop() {
+    try {
+        while(true) {
+            Batch batch;
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex_);
+                queue_condition_.wait(lock, [this]() { return !write_queue_.empty() || finished_; });
+                if(write_queue_.empty()) {
+                    return;
+                }
+                batch = std::move(write_queue_.front());
+                write_queue_.pop();
+            }
+            queue_condition_.notify_all();
+
+            write_batch(batch);
+        }
+    } catch(...) {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        writer_exception_ = std::current_exception();
+        queue_condition_.notify_all();
+    }
+}
+
+void HDF5WriterModule::stop_writer() {
+    if(!writer_thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        finished_ = true;
+    }
+    queue_condition_.notify_all();
+    writer_thread_.join();
+}
+
+void HDF5WriterModule::close_file() {
+    for(auto* dataset : {&hits_dataset_, &charges_dataset_, &pulses_dataset_}) {
+        if(dataset->id >= 0) {
+            H5Dclose(dataset->id);
+            dataset->id = -1;
+        }
+        if(dataset->type >= 0) {
+            H5Tclose(dataset->type);
+            dataset->type = -1;
+        }
+    }
+    if(file_ >= 0) {
+        H5Fclose(file_);
+        file_ = -1;
+    }
+}
+
+void HDF5WriterModule::finalize() {
+    // Write the last incomplete batch and wait for the writer thread to write all queued batches
+    if(batch_.events > 0) {
+        queue_batch();
+    }
+    LOG(TRACE) << "Waiting for writer thread to write all remaining batches";
+    stop_writer();
+    if(writer_exception_) {
+        std::rethrow_exception(writer_exception_);
+    }
+
+    auto hits = hits_dataset_.rows;
+    auto charges = charges_dataset_.rows;
+    auto samples = pulses_dataset_.rows;
+    close_file();
+
+    LOG(STATUS) << "Wrote " << hits << " pixel hits and " << charges << " pixel charges"
+                << (write_pulses_ ? " with " + std::to_string(samples) + " pulse samples" : "") << " to file "
+                << output_file_name_;
+}
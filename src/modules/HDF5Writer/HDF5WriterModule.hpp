@@ -0,0 +1,199 @@
+/**
+ * @file
+ * @brief Definition of HDF5 writer module
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <hdf5.h>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/PixelCharge.hpp"
+#include "objects/PixelHit.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to write pixel hits, pixel charges and their pulses to HDF5 datasets
+     *
+     * Every object type is stored as a table in a one-dimensional dataset of a compound type, with one row per object
+     * holding the event number and the index of the detector. The datasets are chunked and compressed, and are extended
+     * every time a batch of events has been collected. The batches are written by a separate writer thread, such that the
+     * compression does not delay the simulation of the next events.
+     */
+    class HDF5WriterModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param geo_mgr Pointer to the geometry manager, containing the detectors
+         */
+        HDF5WriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr);
+
+        /**
+         * @brief Stop the writer thread and close the file if the run ended without finalizing the module
+         */
+        ~HDF5WriterModule() override;
+
+        /**
+         * @brief Create the output file, the datasets and the table of detectors
+         */
+        void init() override;
+
+        /**
+         * @brief Add the objects of the event to the current batch and queue the batch for writing when it is full
+         */
+        void run(unsigned int) override;
+
+        /**
+         * @brief Write the remaining events, close the file and report the number of written rows
+         */
+        void finalize() override;
+
+    private:
+        /**
+         * @brief Row of the dataset of the pixel hits
+         */
+        struct HitRow {
+            uint32_t event;
+            uint16_t detector;
+            uint32_t column;
+            uint32_t row;
+            double time;
+            double signal;
+        };
+
+        /**
+         * @brief Row of the dataset of the pixel charges, referring to its samples in the dataset of the pulses
+         */
+        struct ChargeRow {
+            uint32_t event;
+            uint16_t detector;
+            uint32_t column;
+            uint32_t row;
+            uint32_t charge;
+            double pulse_binning;
+            uint64_t pulse_offset;
+            uint32_t pulse_length;
+        };
+
+        /**
+         * @brief Rows of all datasets collected from a number of consecutive events
+         */
+        struct Batch {
+            std::vector<HitRow> hits;
+            std::vector<ChargeRow> charges;
+            std::vector<double> pulse_samples;
+            unsigned int events{};
+        };
+
+        /**
+         * @brief Extendable dataset with its row type and the number of rows written so far
+         */
+        struct Dataset {
+            hid_t id{-1};
+            hid_t type{-1};
+            hsize_t rows{};
+        };
+
+        /**
+         * @brief Create an empty extendable dataset with the configured chunking and compression
+         * @param name Name of the dataset in the file
+         * @param type Type of the rows of the dataset, owned by the dataset afterwards
+         * @return Created dataset
+         */
+        Dataset create_dataset(const std::string& name, hid_t type);
+
+        /**
+         * @brief Extend a dataset and write rows to its end
+         * @param dataset Dataset to append to
+         * @param data Pointer to the rows in memory
+         * @param rows Number of rows to append
+         * @throws ModuleError If the dataset cannot be extended or written
+         */
+        void append(Dataset& dataset, const void* data, size_t rows);
+
+        /**
+         * @brief Write all rows of a batch to the datasets
+         * @param batch Batch to write
+         */
+        void write_batch(const Batch& batch);
+
+        /**
+         * @brief Hand the current batch to the writer thread, waiting if the queue is full, or write it directly
+         */
+        void queue_batch();
+
+        /**
+         * @brief Write the queued batches until the writer is stopped
+         */
+        void write_loop();
+
+        /**
+         * @brief Stop the writer thread after all queued batches have been written
+         */
+        void stop_writer();
+
+        /**
+         * @brief Close all datasets and the file
+         */
+        void close_file();
+
+        GeometryManager* geo_mgr_;
+
+        // Messages of the current event
+        std::vector<std::shared_ptr<PixelHitMessage>> pixel_hit_messages_;
+        std::vector<std::shared_ptr<PixelChargeMessage>> pixel_charge_messages_;
+
+        // Index of every detector in the table of detectors, and whether the pulses of the pixel charges are written
+        bool write_pulses_{};
+        std::map<std::string, uint16_t> detector_indices_;
+
+        // Chunking and compression settings of all datasets
+        hsize_t chunk_size_{};
+        unsigned int compression_level_{};
+        bool shuffle_{};
+
+        // Output file and its datasets
+        std::string output_file_name_;
+        hid_t file_{-1};
+        Dataset hits_dataset_, charges_dataset_, pulses_dataset_;
+
+        // Batch collected from the current events, and the number of pulse samples written or queued for writing
+        unsigned int events_per_batch_{};
+        Batch batch_;
+        uint64_t pulse_samples_{};
+
+        // Queue of batches written by the writer thread, which owns the file while it is running
+        bool asynchronous_{};
+        size_t write_queue_size_{};
+        std::thread writer_thread_;
+        std::queue<Batch> write_queue_;
+        std::mutex queue_mutex_;
+        std::condition_variable queue_condition_;
+        bool finished_{false};
+        std::exception_ptr writer_exception_;
+
+        // Statistics about the back-pressure of the writer thread
+        StatisticsCounter& write_queue_full_{get_counter("write_queue_full")};
+        StatisticsCounter& write_wait_time_{get_counter("write_wait_time_ns")};
+    };
+} // namespace allpix
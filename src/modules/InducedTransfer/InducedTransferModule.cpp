@@ -10,10 +10,12 @@
 #include "InducedTransferModule.hpp"
 
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 #include "core/utils/log.h"
 #include "objects/PixelCharge.hpp"
+#include "objects/PixelIndexMap.hpp"
 
 using namespace allpix;
 using namespace ROOT::Math;
@@ -34,7 +36,7 @@ InducedTransferModule::InducedTransferModule(Configuration& config,
     matrix_ = config_.get<XYVectorInt>("induction_matrix");
 
     // Require propagated deposits for single detector
-    messenger_->bindSingle(this, &InducedTransferModule::propagated_message_, MsgFlags::REQUIRED);
+    messenger_->bindSingle<PropagatedChargeMessage>(this, MsgFlags::REQUIRED);
 }
 
 void InducedTransferModule::init() {
@@ -45,13 +47,19 @@ void InducedTransferModule::init() {
     }
 }
 
-void InducedTransferModule::run(unsigned int) {
+void InducedTransferModule::run(Event* event) {
+    auto propagated_message = messenger_->fetchMessage<PropagatedChargeMessage>(this, event);
+
     // Calculate induced charge by total motion of charge carriers
     LOG(TRACE) << "Calculating induced charge on pixels";
     bool found_electrons = false, found_holes = false;
 
-    std::map<Pixel::Index, std::vector<std::pair<double, const PropagatedCharge*>>> pixel_map;
-    for(auto& propagated_charge : propagated_message_->getData()) {
+    // Weighting potentials at the start point of every deposit, shared by all charges propagated from the same deposit
+    std::unordered_map<const DepositedCharge*, PixelIndexMap<std::pair<bool, double>>> start_potentials;
+    const auto& geometry = detector_->getGeometry();
+
+    PixelIndexMap<std::pair<double, std::vector<const PropagatedCharge*>>> pixel_map;
+    for(auto& propagated_charge : propagated_message->getData()) {
 
         // Make sure both electrons and holes are present in the input data
         if(propagated_charge.getType() == CarrierType::ELECTRON) {
@@ -65,10 +73,11 @@ void InducedTransferModule::run(unsigned int) {
         // Get start and end point by looking at deposited and propagated charge local positions
         auto position_end = propagated_charge.getLocalPosition();
         auto position_start = deposited_charge->getLocalPosition();
+        auto& deposit_potentials = start_potentials[deposited_charge];
 
         // Find the nearest pixel
-        auto xpixel = static_cast<int>(std::round(position_end.x() / model_->getPixelSize().x()));
-        auto ypixel = static_cast<int>(std::round(position_end.y() / model_->getPixelSize().y()));
+        auto xpixel = geometry.nearestColumn(position_end.x());
+        auto ypixel = geometry.nearestRow(position_end.y());
         LOG(TRACE) << "Calculating induced charge from carriers below pixel "
                    << Pixel::Index(static_cast<unsigned int>(xpixel), static_cast<unsigned int>(ypixel)) << ", moved from "
                    << Units::display(position_start, {"um", "mm"}) << " to " << Units::display(position_end, {"um", "mm"})
@@ -78,14 +87,18 @@ void InducedTransferModule::run(unsigned int) {
         for(int x = xpixel - matrix_.x() / 2; x <= xpixel + matrix_.x() / 2; x++) {
             for(int y = ypixel - matrix_.y() / 2; y <= ypixel + matrix_.y() / 2; y++) {
                 // Ignore if out of pixel grid
-                if(x < 0 || x >= model_->getNPixels().x() || y < 0 || y >= model_->getNPixels().y()) {
+                if(!geometry.isWithinPixelGrid(x, y)) {
                     LOG(TRACE) << "Pixel (" << x << "," << y << ") skipped, outside the grid";
                     continue;
                 }
 
                 Pixel::Index pixel_index(static_cast<unsigned int>(x), static_cast<unsigned int>(y));
                 auto ramo_end = detector_->getWeightingPotential(position_end, pixel_index);
-                auto ramo_start = detector_->getWeightingPotential(position_start, pixel_index);
+                auto& start_potential = deposit_potentials[pixel_index];
+                if(!start_potential.first) {
+                    start_potential = {true, detector_->getWeightingPotential(position_start, pixel_index)};
+                }
+                auto ramo_start = start_potential.second;
 
                 // Induced charge on electrode is q_int = q * (phi(x1) - phi(x0))
                 auto induced = propagated_charge.getCharge() * (ramo_end - ramo_start) *
@@ -93,8 +106,10 @@ void InducedTransferModule::run(unsigned int) {
                 LOG(TRACE) << "Pixel " << pixel_index << " dPhi = " << (ramo_end - ramo_start) << ", induced "
                            << propagated_charge.getType() << " q = " << Units::display(induced, "e");
 
-                // Add the pixel the list of hit pixels
-                pixel_map[pixel_index].emplace_back(induced, &propagated_charge);
+                // Add the induced charge to the pixel in the list of hit pixels
+                auto& pixel_charge = pixel_map[pixel_index];
+                pixel_charge.first += induced;
+                pixel_charge.second.emplace_back(&propagated_charge);
             }
         }
     }
@@ -108,23 +123,19 @@ void InducedTransferModule::run(unsigned int) {
 
     // Create pixel charges
     LOG(TRACE) << "Combining charges at same pixel";
-    std::vector<PixelCharge> pixel_charges;
+    auto pixel_charges = MessageStorage<PixelCharge>::acquire();
+    pixel_charges.reserve(pixel_map.size());
     for(auto& pixel_index_charge : pixel_map) {
-        double charge = 0;
-        std::vector<const PropagatedCharge*> prop_charges;
-        for(auto& prop_pair : pixel_index_charge.second) {
-            charge += prop_pair.first;
-            prop_charges.push_back(prop_pair.second);
-        }
+        auto charge = pixel_index_charge.second.first;
 
         // Get pixel object from detector
         auto pixel = detector_->getPixel(pixel_index_charge.first.x(), pixel_index_charge.first.y());
 
-        pixel_charges.emplace_back(pixel, std::round(std::fabs(charge)), prop_charges);
+        pixel_charges.emplace_back(pixel, std::round(std::fabs(charge)), pixel_index_charge.second.second);
         LOG(DEBUG) << "Set of " << charge << " charges combined at " << pixel.getIndex();
     }
 
     // Dispatch message of pixel charges
     auto pixel_message = std::make_shared<PixelChargeMessage>(pixel_charges, detector_);
-    messenger_->dispatchMessage(this, pixel_message);
+    messenger_->dispatchMessage(this, pixel_message, event);
 }
@@ -46,17 +46,15 @@ namespace allpix {
 
         /**
          * @brief Calculation of the individual total induced charge and combination for all pixels
+         * @param event Pointer to the event to process
          */
-        void run(unsigned int) override;
+        void run(Event* event) override;
 
     private:
         Messenger* messenger_;
         std::shared_ptr<Detector> detector_;
         std::shared_ptr<DetectorModel> model_;
 
-        // Message containing the propagated charges
-        std::shared_ptr<PropagatedChargeMessage> propagated_message_;
-
         // Induction matrix size in number of pixels along x and y
         ROOT::Math::DisplacementVector2D<ROOT::Math::Cartesian2D<int>> matrix_;
     };
@@ -271,9 +271,9 @@ void LCIOWriterModule::run(unsigned int eventNb) {
 
     // The detector id is only attached to the message, not the MCParticle, thus we store it here
     auto mcp_to_det_id = std::map<MCParticle const*, unsigned>{};
-    // Multiple pixel hits can be assigned to a single MCParticle, here we store them in a LCIO 'float vector' to create the
-    // Monte Carlo truth cluster
-    auto mcp_to_pixel_data_vec = std::map<MCParticle const*, std::vector<std::vector<float>>>{};
+    // Multiple pixel hits can be assigned to a single MCParticle, here we store the range of their entries in the charge
+    // vector of the detector to create the Monte Carlo truth cluster
+    auto mcp_to_pixel_data_vec = std::map<MCParticle const*, std::vector<std::pair<size_t, size_t>>>{};
 
     if(dump_mc_truth_ == true) {
         // Prepare static Monte-Carlo output setup and their CellIDEncoders which are the same everytime
@@ -290,65 +290,39 @@ void LCIOWriterModule::run(unsigned int eventNb) {
     }
 
     // In LCIO the 'charge vector' is a vector of floats which correspond to hit pixels, depending on the pixel
-    // type in EUTelescope the number of entries per pixel varies
-    std::map<unsigned, std::vector<float>> charges;
+    // type in EUTelescope the number of entries per pixel varies. The vectors are kept to reuse their memory in every event
     for(auto const& det : detector_names_to_id_) {
-        charges[det.second] = std::vector<float>{};
+        charges_[det.second].clear();
     }
 
     // Receive all pixel messages, fill charge vectors
     for(const auto& hit_msg : pixel_messages_) {
         LOG(DEBUG) << hit_msg->getDetector()->getName();
+        unsigned det_id = detector_names_to_id_[hit_msg->getDetector()->getName()];
+        auto& det_charges = charges_[det_id];
         for(const auto& hitdata : hit_msg->getData()) {
-
-            auto this_hit_charge_vec = std::vector<float>{};
-
             LOG(DEBUG) << "X: " << hitdata.getPixel().getIndex().x() << ", Y:" << hitdata.getPixel().getIndex().y()
                        << ", Signal: " << hitdata.getSignal();
 
-            unsigned det_id = detector_names_to_id_[hit_msg->getDetector()->getName()];
-
+            auto hit_begin = det_charges.size();
+            det_charges.push_back(static_cast<float>(hitdata.getPixel().getIndex().x())); // x
+            det_charges.push_back(static_cast<float>(hitdata.getPixel().getIndex().y())); // y
+            det_charges.push_back(static_cast<float>(hitdata.getSignal()));               // signal
             switch(pixel_type_) {
-            case 1:                                                                               // EUTelSimpleSparsePixel
-                charges[det_id].push_back(static_cast<float>(hitdata.getPixel().getIndex().x())); // x
-                charges[det_id].push_back(static_cast<float>(hitdata.getPixel().getIndex().y())); // y
-                charges[det_id].push_back(static_cast<float>(hitdata.getSignal()));               // signal
-                this_hit_charge_vec.push_back(static_cast<float>(hitdata.getPixel().getIndex().x())); // x
-                this_hit_charge_vec.push_back(static_cast<float>(hitdata.getPixel().getIndex().y())); // y
-                this_hit_charge_vec.push_back(static_cast<float>(hitdata.getSignal()));               // signal
+            case 1: // EUTelSimpleSparsePixel
                 break;
             case 2:  // EUTelGenericSparsePixel
             default: // EUTelGenericSparsePixel is default
-                charges[det_id].push_back(static_cast<float>(hitdata.getPixel().getIndex().x())); // x
-                charges[det_id].push_back(static_cast<float>(hitdata.getPixel().getIndex().y())); // y
-                charges[det_id].push_back(static_cast<float>(hitdata.getSignal()));               // signal
-                charges[det_id].push_back(0.0);
-                this_hit_charge_vec.push_back(static_cast<float>(hitdata.getPixel().getIndex().x())); // x
-                this_hit_charge_vec.push_back(static_cast<float>(hitdata.getPixel().getIndex().y())); // y
-                this_hit_charge_vec.push_back(static_cast<float>(hitdata.getSignal()));               // signal
-                this_hit_charge_vec.push_back(0.0);                                                   // time
+                det_charges.push_back(0.0); // time
                 break;
-            case 5:                                                                               // EUTelTimepix3SparsePixel
-                charges[det_id].push_back(static_cast<float>(hitdata.getPixel().getIndex().x())); // x
-                charges[det_id].push_back(static_cast<float>(hitdata.getPixel().getIndex().y())); // y
-                charges[det_id].push_back(static_cast<float>(hitdata.getSignal()));               // signal
-                charges[det_id].push_back(0.0);                                                   // time
-                charges[det_id].push_back(0.0);                                                   // time
-                charges[det_id].push_back(0.0);                                                   // time
-                charges[det_id].push_back(0.0);                                                   // time
-                this_hit_charge_vec.push_back(static_cast<float>(hitdata.getPixel().getIndex().x())); // x
-                this_hit_charge_vec.push_back(static_cast<float>(hitdata.getPixel().getIndex().y())); // y
-                this_hit_charge_vec.push_back(static_cast<float>(hitdata.getSignal()));               // signal
-                this_hit_charge_vec.push_back(0.0);                                                   // time
-                this_hit_charge_vec.push_back(0.0);                                                   // time
-                this_hit_charge_vec.push_back(0.0);                                                   // time
-                this_hit_charge_vec.push_back(0.0);                                                   // time
+            case 5: // EUTelTimepix3SparsePixel
+                det_charges.insert(det_charges.end(), 4, 0.0); // time
                 break;
             }
 
             for(auto const& mcp : hitdata.getMCParticles()) {
                 mcp_to_det_id[mcp] = det_id;
-                mcp_to_pixel_data_vec[mcp].emplace_back(this_hit_charge_vec);
+                mcp_to_pixel_data_vec[mcp].emplace_back(hit_begin, det_charges.size());
             }
         }
     }
@@ -368,9 +342,11 @@ void LCIOWriterModule::run(unsigned int eventNb) {
 
             // Every detected pixel hit which had charge contribution from this MCParticle will be added to the cluster
             std::vector<float> truth_cluster_charge_vec;
-            for(auto const& pixel_hit_charge_vec : mcp_pixel_data_vec_pair.second) {
-                truth_cluster_charge_vec.insert(
-                    std::end(truth_cluster_charge_vec), std::begin(pixel_hit_charge_vec), std::end(pixel_hit_charge_vec));
+            auto const& det_charges = charges_[mcp_to_det_id[mc_particle]];
+            for(auto const& pixel_hit_range : mcp_pixel_data_vec_pair.second) {
+                truth_cluster_charge_vec.insert(std::end(truth_cluster_charge_vec),
+                                                det_charges.begin() + static_cast<std::ptrdiff_t>(pixel_hit_range.first),
+                                                det_charges.begin() + static_cast<std::ptrdiff_t>(pixel_hit_range.second));
             }
 
             mc_tracker_data->setChargeValues(truth_cluster_charge_vec);
@@ -411,7 +387,7 @@ void LCIOWriterModule::run(unsigned int eventNb) {
     for(auto const& det_id_name_pair : detector_names_to_id_) {
         auto det_id = det_id_name_pair.second;
         auto hit = new TrackerDataImpl();
-        hit->setChargeValues(charges[det_id]);
+        hit->setChargeValues(charges_[det_id]);
         auto col_index = detector_ids_to_colllection_index_[det_id];
         (*output_col_encoder_vec[col_index])["sensorID"] = det_id;
         (*output_col_encoder_vec[col_index])["sparsePixelType"] = pixel_type_;
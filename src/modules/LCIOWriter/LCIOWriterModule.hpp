@@ -64,6 +64,9 @@ namespace allpix {
         std::map<std::string, unsigned> detector_names_to_id_;
         std::map<std::string, std::vector<std::string>> collections_to_detectors_map_;
 
+        // Charge vectors of every sensor id, kept between events to reuse their memory
+        std::map<unsigned, std::vector<float>> charges_;
+
         std::shared_ptr<IO::LCWriter> lcWriter_{};
         int pixel_type_;
 
@@ -9,6 +9,8 @@
 
 #include "MagneticFieldReaderModule.hpp"
 
+#include <algorithm>
+#include <array>
 #include <fstream>
 #include <limits>
 #include <memory>
@@ -28,8 +30,15 @@
 
 using namespace allpix;
 
+FieldParser<double> MagneticFieldReaderModule::field_parser_(FieldQuantity::VECTOR);
+
 MagneticFieldReaderModule::MagneticFieldReaderModule(Configuration& config, Messenger*, GeometryManager* geoManager)
-    : Module(config), geometryManager_(geoManager) {}
+    : Module(config), geometryManager_(geoManager) {
+    // Set default values for the cache of the field in the detectors
+    config_.setDefault<ROOT::Math::XYZPoint>("field_center", ROOT::Math::XYZPoint());
+    config_.setDefault<std::string>("field_units", "T");
+    config_.setDefault<ROOT::Math::XYZVector>("detector_field_bins", ROOT::Math::XYZVector(10, 10, 10));
+}
 
 void MagneticFieldReaderModule::init() {
     MagneticFieldType type = MagneticFieldType::NONE;
@@ -49,15 +58,89 @@ void MagneticFieldReaderModule::init() {
         geometryManager_->setMagneticFieldFunction(function, type);
         auto detectors = geometryManager_->getDetectors();
         for(auto& detector : detectors) {
-            // TODO the magnetic field is calculated once for the center position of the detector. This could be extended to
-            // a function enabling a gradient in the magnetic field inside the sensor
             detector->setMagneticField(detector->getOrientation().Inverse() *
                                        geometryManager_->getMagneticField(detector->getPosition()));
             LOG(DEBUG) << "Magnetic field in detector " << detector->getName() << ": "
                        << Units::display(detector->getMagneticField(), {"T", "mT"});
         }
         LOG(INFO) << "Set constant magnetic field: " << Units::display(b_field, {"T", "mT"});
+    } else if(field_model == "mesh") {
+        LOG(TRACE) << "Adding magnetic field from mesh";
+        type = MagneticFieldType::GRID;
+
+        auto field_data =
+            field_parser_.getByFileName(config_.getPath("file_name", true), config_.get<std::string>("field_units"));
+        auto function = get_mesh_function(field_data, config_.get<ROOT::Math::XYZPoint>("field_center"));
+        geometryManager_->setMagneticFieldFunction(function, type);
+
+        // Cache the field in local coordinates for every detector
+        auto bins = config_.get<ROOT::Math::XYZVector>("detector_field_bins");
+        if(bins.x() < 1 || bins.y() < 1 || bins.z() < 1) {
+            throw InvalidValueError(
+                config_, "detector_field_bins", "number of bins needs to be at least one along all axes");
+        }
+        std::array<size_t, 3> detector_bins{
+            {static_cast<size_t>(bins.x()), static_cast<size_t>(bins.y()), static_cast<size_t>(bins.z())}};
+        auto detectors = geometryManager_->getDetectors();
+        for(auto& detector : detectors) {
+            detector->setMagneticFieldGrid(function, detector_bins);
+            LOG(DEBUG) << "Cached magnetic field of detector " << detector->getName() << " in " << detector_bins[0] << "x"
+                       << detector_bins[1] << "x" << detector_bins[2] << " bins, field at sensor center: "
+                       << Units::display(detector->getMagneticField(), {"T", "mT"});
+        }
+
+        auto dimensions = field_data.getDimensions();
+        LOG(INFO) << "Set magnetic field from mesh with " << dimensions[0] << "x" << dimensions[1] << "x" << dimensions[2]
+                  << " bins";
     } else {
-        throw InvalidValueError(config_, "model", "model can currently only be 'constant'");
+        throw InvalidValueError(config_, "model", "model can currently only be 'constant' or 'mesh'");
     }
 }
+
+/**
+ * The field values of the mesh are located at the bin centers and are interpolated trilinearly. Outside the extent of the
+ * mesh the magnetic field vanishes.
+ */
+MagneticFieldFunction MagneticFieldReaderModule::get_mesh_function(const FieldData<double>& field_data,
+                                                                   const ROOT::Math::XYZPoint& center) {
+    auto data = field_data.getData();
+    auto dimensions = field_data.getDimensions();
+    auto size = field_data.getSize();
+    std::array<double, 3> lower{{center.x() - size[0] / 2.0, center.y() - size[1] / 2.0, center.z() - size[2] / 2.0}};
+
+    return [data, dimensions, size, lower](const ROOT::Math::XYZPoint& pos) {
+        std::array<double, 3> point{{pos.x(), pos.y(), pos.z()}};
+        std::array<size_t, 3> strides{{dimensions[1] * dimensions[2], dimensions[2], 1}};
+        std::array<size_t, 3> index{};
+        std::array<double, 3> fraction{};
+        for(size_t i = 0; i < 3; ++i) {
+            auto dist = point[i] - lower[i];
+            if(dist < 0 || dist > size[i]) {
+                return ROOT::Math::XYZVector();
+            }
+            auto max_bin = static_cast<double>(dimensions[i] - 1);
+            auto bin = std::min(std::max(dist * static_cast<double>(dimensions[i]) / size[i] - 0.5, 0.0), max_bin);
+            index[i] = std::min(static_cast<size_t>(bin), (dimensions[i] > 1 ? dimensions[i] - 2 : 0));
+            fraction[i] = bin - static_cast<double>(index[i]);
+            if(dimensions[i] == 1) {
+                strides[i] = 0;
+            }
+        }
+
+        ROOT::Math::XYZVector field;
+        for(size_t corner = 0; corner < 8; ++corner) {
+            double weight = 1;
+            size_t offset = 0;
+            for(size_t i = 0; i < 3; ++i) {
+                auto upper = ((corner >> i) & 1u) != 0;
+                weight *= (upper ? fraction[i] : 1 - fraction[i]);
+                offset += (index[i] + (upper ? 1 : 0)) * strides[i];
+            }
+            if(weight != 0) {
+                field += weight * ROOT::Math::XYZVector(
+                                      (*data)[3 * offset], (*data)[3 * offset + 1], (*data)[3 * offset + 2]);
+            }
+        }
+        return field;
+    };
+}
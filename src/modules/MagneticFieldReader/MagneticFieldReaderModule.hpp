@@ -18,13 +18,16 @@
 
 #include "core/module/Module.hpp"
 
+#include "tools/field_parser.h"
+
 namespace allpix {
     /**
      * @ingroup Modules
      * @brief Module to define magnetic fields
      *
-     * Read the model of the magnetic field from the config during initialization and apply a constant field throughout the
-     * whole volume
+     * Read the model of the magnetic field from the config during initialization and apply either a constant field
+     * throughout the whole volume or a field map in global coordinates. The field map is cached in a local grid for every
+     * detector.
      */
     class MagneticFieldReaderModule : public Module {
     public:
@@ -42,6 +45,18 @@ namespace allpix {
         void init() override;
 
     private:
+        /**
+         * @brief Create a function returning the magnetic field of a mesh at a global position
+         * @param field_data Field data read from the mesh file
+         * @param center Position of the center of the mesh in the global frame
+         * @return Function interpolating the field of the mesh
+         */
+        static MagneticFieldFunction get_mesh_function(const FieldData<double>& field_data,
+                                                       const ROOT::Math::XYZPoint& center);
+
         GeometryManager* geometryManager_;
+
+        // Field parser shared by all instances to read magnetic field maps
+        static FieldParser<double> field_parser_;
     };
 } // namespace allpix
@@ -0,0 +1,134 @@
+/**
+ * @file
+ * @brief Implementation of a module to export the messages of every event to another process
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "MessageExporterModule.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <TBufferFile.h>
+#include <TClass.h>
+#include <TProcessID.h>
+
+#include "core/utils/log.h"
+#include "core/utils/type.h"
+
+#include "objects/Object.hpp"
+#include "objects/objects.h"
+
+using namespace allpix;
+
+MessageExporterModule::MessageExporterModule(Configuration& config, Messenger* messenger, GeometryManager*)
+    : Module(config) {
+    // Bind to all messages
+    messenger->registerListener(this, &MessageExporterModule::receive);
+}
+
+void MessageExporterModule::init() {
+    // Read include and exclude list
+    if(config_.has("include") && config_.has("exclude")) {
+        throw InvalidCombinationError(
+            config_, {"exclude", "include"}, "include and exclude parameter are mutually exclusive");
+    } else if(config_.has("include")) {
+        auto inc_arr = config_.getArray<std::string>("include");
+        include_.insert(inc_arr.begin(), inc_arr.end());
+    } else if(config_.has("exclude")) {
+        auto exc_arr = config_.getArray<std::string>("exclude");
+        exclude_.insert(exc_arr.begin(), exc_arr.end());
+    }
+
+    // Open the stream, for sockets this waits until the importing process accepts the connection
+    try {
+        stream_ = create_record_stream(config_, true);
+    } catch(std::runtime_error& e) {
+        throw ModuleError("Cannot open stream to the importing process: " + std::string(e.what()));
+    }
+}
+
+void MessageExporterModule::receive(std::shared_ptr<BaseMessage> message, std::string message_name) { // NOLINT
+    try {
+        if(message->getObjectCount() == 0) {
+            return;
+        }
+
+        // Remove the allpix prefix
+        std::string class_name = TClass::GetClass(typeid(message->getObject(0)))->GetName();
+        std::string apx_namespace = "allpix::";
+        size_t ap_idx = class_name.find(apx_namespace);
+        if(ap_idx != std::string::npos) {
+            class_name.replace(ap_idx, apx_namespace.size(), "");
+        }
+
+        // Check if this message should be kept
+        if((!include_.empty() && include_.find(class_name) == include_.end()) ||
+           (!exclude_.empty() && exclude_.find(class_name) != exclude_.end())) {
+            LOG(TRACE) << "Message exporter ignored message with object " << class_name
+                       << " because it has been excluded or not explicitly included";
+            return;
+        }
+        event_messages_.emplace_back(std::move(message), std::move(message_name));
+    } catch(MessageWithoutObjectException& e) {
+        const BaseMessage* inst = message.get();
+        LOG(WARNING) << "Message exporter cannot process message of type " << allpix::demangle(typeid(*inst).name())
+                     << " with name " << message_name;
+    }
+}
+
+/**
+ * The record of an event holds the event number and the number of messages, followed by the detector name, the message
+ * name, the object count and the objects for every message. An empty detector name denotes messages not bound to a
+ * detector. The links between the objects are converted to TRef objects for all objects of the event before any of them
+ * is written, the object count of ROOT is reset afterwards as done by the ROOTObjectWriter module.
+ */
+void MessageExporterModule::run(unsigned int event_num) {
+    auto save_id = TProcessID::GetObjectCount();
+    for(auto& message : event_messages_) {
+        for(size_t i = 0; i < message.first->getObjectCount(); ++i) {
+            message.first->getObject(i).petrifyHistory();
+        }
+    }
+
+    TBufferFile buffer(TBuffer::kWrite);
+    buffer.WriteULong64(event_num);
+    buffer.WriteUInt(static_cast<UInt_t>(event_messages_.size()));
+    for(auto& message : event_messages_) {
+        std::string detector_name;
+        if(message.first->getDetector() != nullptr) {
+            detector_name = message.first->getDetector()->getName();
+        }
+        buffer.WriteStdString(&detector_name);
+        buffer.WriteStdString(&message.second);
+
+        auto object_count = message.first->getObjectCount();
+        buffer.WriteUInt(static_cast<UInt_t>(object_count));
+        for(size_t i = 0; i < object_count; ++i) {
+            auto& object = message.first->getObject(i);
+            buffer.WriteObjectAny(&object, object.IsA());
+        }
+        object_count_ += object_count;
+    }
+    event_messages_.clear();
+    TProcessID::SetObjectCount(save_id);
+
+    LOG(TRACE) << "Exporting " << buffer.Length() << " bytes for event " << event_num;
+    try {
+        stream_->write(buffer.Buffer(), static_cast<size_t>(buffer.Length()));
+    } catch(std::runtime_error& e) {
+        throw ModuleError("Cannot export event " + std::to_string(event_num) + ": " + e.what());
+    }
+    byte_count_ += static_cast<unsigned long long>(buffer.Length());
+    ++event_count_;
+}
+
+void MessageExporterModule::finalize() {
+    stream_->close();
+    LOG(STATUS) << "Exported " << object_count_ << " objects in " << event_count_ << " events (" << byte_count_
+                << " bytes)";
+}
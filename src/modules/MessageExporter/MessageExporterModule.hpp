@@ -0,0 +1,80 @@
+/**
+ * @file
+ * @brief Definition of a module to export the messages of every event to another process
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Module.hpp"
+
+#include "tools/record_stream.h"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to stream the objects of every event to another process running the MessageImporter module
+     *
+     * Listens to all objects dispatched in the framework. The messages of every event are serialized together into a
+     * single record, which is written to a shared memory ring buffer or a network connection read by the importing process.
+     */
+    class MessageExporterModule : public Module {
+    public:
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param geo_mgr Pointer to the geometry manager, containing the detectors
+         */
+        MessageExporterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr);
+
+        /**
+         * @brief Receive a single message containing objects of arbitrary type
+         * @param message Message dispatched in the framework
+         * @param name Name of the message
+         */
+        void receive(std::shared_ptr<BaseMessage> message, std::string name);
+
+        /**
+         * @brief Open the stream to the importing process
+         */
+        void init() override;
+
+        /**
+         * @brief Serialize the messages of the event and write them to the stream
+         * @param event_num Number of the event
+         */
+        void run(unsigned int event_num) override;
+
+        /**
+         * @brief Close the stream and output summary of the exported objects
+         */
+        void finalize() override;
+
+    private:
+        // Object names to include or exclude from exporting
+        std::set<std::string> include_;
+        std::set<std::string> exclude_;
+
+        // Stream to the importing process
+        std::unique_ptr<RecordStream> stream_;
+
+        // List of messages received in the current event
+        std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>> event_messages_;
+
+        // Statistics
+        unsigned long object_count_{};
+        unsigned long event_count_{};
+        unsigned long long byte_count_{};
+    };
+} // namespace allpix
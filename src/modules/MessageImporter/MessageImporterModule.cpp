@@ -0,0 +1,177 @@
+/**
+ * @file
+ * @brief Implementation of a module to import the messages of every event from another process
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "MessageImporterModule.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <TBufferFile.h>
+#include <TProcessID.h>
+
+#include "core/utils/log.h"
+#include "core/utils/type.h"
+
+#include "objects/Object.hpp"
+
+using namespace allpix;
+
+MessageImporterModule::MessageImporterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr)
+    : Module(config), messenger_(messenger), geo_mgr_(geo_mgr) {}
+
+/**
+ * Adds lambda function map to convert a vector of generic objects to a templated message containing this particular type of
+ * object from its typeid, restoring the references of the objects in the same way as the ROOTObjectReader module.
+ */
+template <typename T> static void add_creator(MessageImporterModule::MessageCreatorMap& map) {
+    map[typeid(T)] = [&](std::vector<Object*> objects, std::shared_ptr<Detector> detector) {
+        std::vector<T> data;
+        data.reserve(objects.size());
+
+        // Copy the objects to data vector
+        for(auto& object : objects) {
+            data.emplace_back(*static_cast<T*>(object));
+        }
+
+        // Fix the object references (NOTE: we do this after insertion as otherwise the objects could have been relocated)
+        for(size_t i = 0; i < objects.size(); ++i) {
+            auto& prev_obj = *objects[i];
+            auto& new_obj = data[i];
+
+            // Only update the reference for objects that have been referenced before
+            if(prev_obj.TestBit(kIsReferenced)) {
+                auto pid = TProcessID::GetProcessWithUID(&new_obj);
+                if(pid->GetObjectWithID(prev_obj.GetUniqueID()) != &prev_obj) {
+                    LOG(ERROR) << "Duplicate object IDs, cannot correctly resolve previous history!";
+                }
+                prev_obj.ResetBit(kIsReferenced);
+                new_obj.SetBit(kIsReferenced);
+                pid->PutObjectWithID(&new_obj);
+            }
+        }
+
+        if(detector == nullptr) {
+            return std::make_shared<Message<T>>(std::move(data));
+        }
+        return std::make_shared<Message<T>>(std::move(data), detector);
+    };
+}
+
+/**
+ * Uses SFINAE trick to call the add_creator function for all template arguments of a container class. Used to add creators
+ * for every object in a tuple of objects.
+ */
+template <template <typename...> class T, typename... Args>
+static void gen_creator_map_from_tag(MessageImporterModule::MessageCreatorMap& map, type_tag<T<Args...>>) {
+    std::initializer_list<int> value{(add_creator<Args>(map), 0)...};
+    (void)value;
+}
+
+/**
+ * Wrapper function to make the SFINAE trick in \ref gen_creator_map_from_tag work.
+ */
+template <typename T> static MessageImporterModule::MessageCreatorMap gen_creator_map() {
+    MessageImporterModule::MessageCreatorMap ret_map;
+    gen_creator_map_from_tag(ret_map, type_tag<T>());
+    return ret_map;
+}
+
+void MessageImporterModule::init() {
+    // Initialize the call map from the tuple of available objects
+    message_creator_map_ = gen_creator_map<allpix::OBJECTS>();
+
+    // Open the stream, waiting for the exporting process to create it
+    try {
+        stream_ = create_record_stream(config_, false);
+    } catch(std::runtime_error& e) {
+        throw ModuleError("Cannot open stream from the exporting process: " + std::string(e.what()));
+    }
+}
+
+/**
+ * The record is deserialized directly from the memory of the stream, which for shared memory is the ring buffer itself. The
+ * record format is described in the MessageExporter module.
+ */
+void MessageImporterModule::run(unsigned int event_num) {
+    std::pair<const char*, size_t> record;
+    try {
+        record = stream_->read();
+    } catch(std::runtime_error& e) {
+        throw ModuleError("Cannot import event " + std::to_string(event_num) + ": " + e.what());
+    }
+    if(record.first == nullptr) {
+        throw EndOfRunException("Requesting end of run because the exporting process only provided data for " +
+                                std::to_string(event_count_) + " events");
+    }
+
+    // The buffer does not own the memory of the record and only reads from it
+    TBufferFile buffer(TBuffer::kRead, static_cast<Int_t>(record.second), const_cast<char*>(record.first), kFALSE);
+    ULong64_t exported_event = 0;
+    buffer.ReadULong64(exported_event);
+    if(exported_event != event_num) {
+        LOG(DEBUG) << "Importing exported event " << exported_event << " as event " << event_num;
+    }
+
+    UInt_t message_count = 0;
+    buffer.ReadUInt(message_count);
+    std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>> messages;
+    for(UInt_t i = 0; i < message_count; ++i) {
+        std::string detector_name;
+        std::string message_name;
+        buffer.ReadStdString(&detector_name);
+        buffer.ReadStdString(&message_name);
+
+        UInt_t object_count = 0;
+        buffer.ReadUInt(object_count);
+        std::vector<Object*> objects;
+        objects.reserve(object_count);
+        for(UInt_t j = 0; j < object_count; ++j) {
+            objects.push_back(static_cast<Object*>(buffer.ReadObjectAny(Object::Class())));
+        }
+        if(objects.empty()) {
+            continue;
+        }
+
+        // Check if a pointer to a dispatcher method exist
+        auto* first_object = objects.front();
+        auto iter = message_creator_map_.find(typeid(*first_object));
+        if(iter == message_creator_map_.end()) {
+            LOG(INFO) << "Cannot dispatch message with object " << allpix::demangle(typeid(*first_object).name())
+                      << " because it not registered for messaging";
+        } else {
+            auto detector = (detector_name.empty() ? nullptr : geo_mgr_->getDetector(detector_name));
+            messages.emplace_back(iter->second(objects, detector), message_name);
+            object_count_ += objects.size();
+        }
+
+        // The objects have been copied to the message
+        for(auto* object : objects) {
+            delete object;
+        }
+    }
+    stream_->release();
+    ++event_count_;
+
+    // Restore the links between the objects after all objects of the event have been created
+    for(auto& message : messages) {
+        for(Object& object : message.first->getObjectArray()) {
+            object.loadHistory();
+        }
+    }
+
+    // Dispatch the messages
+    for(auto& message : messages) {
+        messenger_->dispatchMessage(this, message.first, message.second);
+    }
+}
+
+void MessageImporterModule::finalize() {
+    LOG(STATUS) << "Imported " << object_count_ << " objects from " << event_count_ << " events";
+}
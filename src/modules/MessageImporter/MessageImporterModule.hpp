@@ -0,0 +1,79 @@
+/**
+ * @file
+ * @brief Definition of a module to import the messages of every event from another process
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <vector>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/GeometryManager.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Module.hpp"
+
+#include "tools/record_stream.h"
+
+// Contains tuple of all defined objects
+#include "objects/objects.h"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to receive the objects of every event from another process running the MessageExporter module
+     *
+     * Reads the record of every event from a shared memory ring buffer or a network connection, converts the objects
+     * back to messages and dispatches them, as if the modules of the exporting process ran in this process.
+     */
+    class MessageImporterModule : public Module {
+    public:
+        using MessageCreatorMap =
+            std::map<std::type_index,
+                     std::function<std::shared_ptr<BaseMessage>(std::vector<Object*>, std::shared_ptr<Detector>)>>;
+
+        /**
+         * @brief Constructor for this unique module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param geo_mgr Pointer to the geometry manager, containing the detectors
+         */
+        MessageImporterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr);
+
+        /**
+         * @brief Open the stream from the exporting process
+         */
+        void init() override;
+
+        /**
+         * @brief Read the record of the next event and dispatch its messages
+         * @param event_num Number of the event
+         */
+        void run(unsigned int event_num) override;
+
+        /**
+         * @brief Output summary of the imported objects
+         */
+        void finalize() override;
+
+    private:
+        Messenger* messenger_;
+        GeometryManager* geo_mgr_;
+
+        // Stream from the exporting process
+        std::unique_ptr<RecordStream> stream_;
+
+        // Internal map to construct a message from the type index of its objects
+        MessageCreatorMap message_creator_map_;
+
+        // Statistics
+        unsigned long object_count_{};
+        unsigned long event_count_{};
+    };
+} // namespace allpix
@@ -0,0 +1,312 @@
+/**
+ * @file
+ * @brief Implementation of a module overlaying background events read from a data file onto every event
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "PileupOverlayModule.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+
+#include <TBranch.h>
+#include <TFile.h>
+#include <TTree.h>
+
+#include "core/module/exceptions.h"
+#include "core/utils/log.h"
+#include "core/utils/unit.h"
+#include "objects/exceptions.h"
+
+using namespace allpix;
+
+PileupOverlayModule::PileupOverlayModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector)
+    : Module(config, std::move(detector)), messenger_(messenger) {
+    // Enable parallelization of this module if multithreading is enabled
+    enable_parallelization();
+
+    // Set defaults for config variables
+    config_.setDefault<std::string>("objects", "DepositedCharge");
+    config_.setDefault<std::string>("branch_name", getDetector()->getName());
+    config_.setDefault<unsigned int>("pool_size", 100);
+    config_.setDefault<double>("pileup_events", 1);
+    config_.setDefault<bool>("poisson", false);
+    config_.setDefaultArray<double>("time_window", {0, 0});
+    config_.setDefault<double>("bunch_spacing", 0);
+
+    auto objects = config_.get<std::string>("objects");
+    if(objects == "DepositedCharge") {
+        level_ = OverlayLevel::DEPOSITED_CHARGE;
+        messenger_->bindSingle<DepositedChargeMessage>(this, MsgFlags::NONE);
+    } else if(objects == "PixelCharge") {
+        level_ = OverlayLevel::PIXEL_CHARGE;
+        messenger_->bindSingle<PixelChargeMessage>(this, MsgFlags::NONE);
+    } else {
+        throw InvalidValueError(
+            config_, "objects", "Invalid objects to overlay, only 'DepositedCharge' and 'PixelCharge' are supported.");
+    }
+
+    poisson_ = config_.get<bool>("poisson");
+    bunch_spacing_ = config_.get<double>("bunch_spacing");
+}
+
+/**
+ * Only the branch of the selected objects for this detector is read from the file. If the file contains more events than
+ * the size of the pool, the events of the pool are selected randomly and read in the order of the file, such that every
+ * basket is only decompressed once. The links between the objects are not kept, as the Monte Carlo particles of the
+ * background are not read.
+ */
+void PileupOverlayModule::init() {
+    pileup_events_ = config_.get<double>("pileup_events");
+    if(pileup_events_ < 0) {
+        throw InvalidValueError(config_, "pileup_events", "number of pile-up events cannot be negative");
+    }
+    if(!poisson_ && pileup_events_ != std::floor(pileup_events_)) {
+        throw InvalidValueError(
+            config_, "pileup_events", "number of pile-up events should be an integer unless Poisson distributed");
+    }
+
+    auto time_window = config_.getArray<double>("time_window");
+    if(time_window.size() != 2 || time_window[0] > time_window[1]) {
+        throw InvalidValueError(config_, "time_window", "time window should be given as start and end time");
+    }
+    time_window_min_ = time_window[0];
+    time_window_max_ = time_window[1];
+    if(bunch_spacing_ < 0) {
+        throw InvalidValueError(config_, "bunch_spacing", "bunch spacing cannot be negative");
+    }
+    if(bunch_spacing_ > 0 && std::ceil(time_window_min_ / bunch_spacing_) > std::floor(time_window_max_ / bunch_spacing_)) {
+        throw InvalidValueError(config_, "bunch_spacing", "time window does not contain any bunch crossing");
+    }
+
+    // Open the tree of the selected objects and only enable the branch of this detector
+    auto tree_name = config_.get<std::string>("objects");
+    auto branch_name = config_.get<std::string>("branch_name");
+    auto file_name = config_.getPathWithExtension("file_name", "root", true);
+    TFile input_file(file_name.c_str());
+    if(input_file.IsZombie()) {
+        throw InvalidValueError(config_, "file_name", "data file cannot be opened");
+    }
+    TTree* tree = nullptr;
+    input_file.GetObject(tree_name.c_str(), tree);
+    if(tree == nullptr) {
+        throw InvalidValueError(config_, "file_name", "data file does not contain a tree of " + tree_name + " objects");
+    }
+    auto* branch = tree->GetBranch(branch_name.c_str());
+    if(branch == nullptr) {
+        throw InvalidValueError(config_, "branch_name", "tree of " + tree_name + " objects does not contain this branch");
+    }
+    // NOTE Passing the number of found branches suppresses the error for branches without sub-branches
+    unsigned int found = 0;
+    tree->SetBranchStatus("*", false);
+    tree->SetBranchStatus(branch_name.c_str(), true, &found);
+    tree->SetBranchStatus((branch_name + ".*").c_str(), true, &found);
+
+    // Select the events of the pool
+    auto entries = static_cast<unsigned long long>(tree->GetEntries());
+    if(entries == 0) {
+        throw InvalidValueError(config_, "file_name", "data file does not contain any events");
+    }
+    std::vector<unsigned long long> selected(entries);
+    std::iota(selected.begin(), selected.end(), 0);
+    auto pool_size = config_.get<unsigned int>("pool_size");
+    if(pool_size == 0) {
+        throw InvalidValueError(config_, "pool_size", "pool of background events cannot be empty");
+    }
+    if(pool_size < entries) {
+        std::mt19937_64 random_engine(getRandomSeed());
+        std::shuffle(selected.begin(), selected.end(), random_engine);
+        selected.resize(pool_size);
+        std::sort(selected.begin(), selected.end());
+    }
+
+    // Read and decode the events of the pool
+    auto* objects = new std::vector<Object*>();
+    branch->SetAddress(&objects);
+    pool_.reserve(selected.size());
+    for(auto entry : selected) {
+        tree->GetEntry(static_cast<Long64_t>(entry));
+
+        BackgroundEvent background;
+        for(auto* object : *objects) {
+            if(level_ == OverlayLevel::DEPOSITED_CHARGE) {
+                auto* deposit = dynamic_cast<DepositedCharge*>(object);
+                if(deposit == nullptr) {
+                    throw ModuleError("Tree contains objects of the wrong type");
+                }
+                background.deposits.push_back({deposit->getLocalPosition(),
+                                               deposit->getGlobalPosition(),
+                                               deposit->getType(),
+                                               deposit->getCharge(),
+                                               deposit->getEventTime()});
+            } else {
+                auto* pixel_charge = dynamic_cast<PixelCharge*>(object);
+                if(pixel_charge == nullptr) {
+                    throw ModuleError("Tree contains objects of the wrong type");
+                }
+                background.pixels.push_back({pixel_charge->getPixel(), pixel_charge->getPulse(), pixel_charge->getCharge()});
+            }
+        }
+        pool_.push_back(std::move(background));
+    }
+    branch->ResetAddress();
+    delete objects;
+    input_file.Close();
+
+    LOG(INFO) << "Read pool of " << pool_.size() << " background events from " << entries << " events in file "
+              << file_name;
+}
+
+void PileupOverlayModule::run(Event* event) {
+    // Draw the background events and their time offsets
+    auto count = static_cast<unsigned int>(pileup_events_);
+    if(poisson_) {
+        count = (pileup_events_ > 0 ? std::poisson_distribution<unsigned int>(pileup_events_)(event->getRandomEngine()) : 0);
+    }
+    std::uniform_int_distribution<size_t> draw(0, pool_.size() - 1);
+    std::vector<std::pair<const BackgroundEvent*, double>> background;
+    background.reserve(count);
+    for(unsigned int i = 0; i < count; ++i) {
+        const auto* background_event = &pool_[draw(event->getRandomEngine())];
+        double offset = time_window_min_;
+        if(bunch_spacing_ > 0) {
+            std::uniform_int_distribution<long> bunch(static_cast<long>(std::ceil(time_window_min_ / bunch_spacing_)),
+                                                      static_cast<long>(std::floor(time_window_max_ / bunch_spacing_)));
+            offset = bunch_spacing_ * static_cast<double>(bunch(event->getRandomEngine()));
+        } else if(time_window_max_ > time_window_min_) {
+            offset = std::uniform_real_distribution<double>(time_window_min_, time_window_max_)(event->getRandomEngine());
+        }
+        LOG(TRACE) << "Overlaying background event with time offset " << Units::display(offset, {"ns", "us"});
+        background.emplace_back(background_event, offset);
+    }
+
+    if(level_ == OverlayLevel::DEPOSITED_CHARGE) {
+        overlay_deposits(event, background);
+    } else {
+        overlay_pixels(event, background);
+    }
+    ++events_cnt_;
+    overlaid_cnt_ += count;
+}
+
+void PileupOverlayModule::overlay_deposits(Event* event,
+                                           const std::vector<std::pair<const BackgroundEvent*, double>>& background) {
+    auto message = messenger_->fetchMessage<DepositedChargeMessage>(this, event);
+
+    auto deposits = MessageStorage<DepositedCharge>::acquire();
+    if(message != nullptr) {
+        deposits.insert(deposits.end(), message->getData().begin(), message->getData().end());
+    }
+    for(const auto& overlay : background) {
+        for(const auto& deposit : overlay.first->deposits) {
+            deposits.emplace_back(deposit.local_position,
+                                  deposit.global_position,
+                                  deposit.type,
+                                  deposit.charge,
+                                  deposit.time + overlay.second);
+        }
+        objects_cnt_ += overlay.first->deposits.size();
+    }
+
+    LOG(DEBUG) << "Overlaid " << background.size() << " background events, dispatching " << deposits.size()
+               << " deposited charges";
+    if(!deposits.empty()) {
+        auto deposits_message = std::make_shared<DepositedChargeMessage>(std::move(deposits), getDetector());
+        messenger_->dispatchMessage(this, deposits_message, event);
+    }
+}
+
+/**
+ * The charges of signal and background at the same pixel are summed. Pulses are shifted by the time offset of the background
+ * event, bins shifted before the start of the event are discarded. If any of the summed pixel charges has no pulse, only
+ * the total charge is kept.
+ */
+void PileupOverlayModule::overlay_pixels(Event* event,
+                                         const std::vector<std::pair<const BackgroundEvent*, double>>& background) {
+    auto message = messenger_->fetchMessage<PixelChargeMessage>(this, event);
+
+    struct MergedPixel {
+        const Pixel* pixel;
+        Pulse pulse;
+        bool pulse_valid;
+        unsigned int charge;
+        std::vector<const PropagatedCharge*> propagated_charges;
+    };
+    std::map<Pixel::Index, MergedPixel> merged;
+    auto add = [&](const Pixel& pixel, const Pulse& pulse, unsigned int charge) -> MergedPixel& {
+        auto iter = merged.find(pixel.getIndex());
+        if(iter == merged.end()) {
+            iter = merged.emplace(pixel.getIndex(), MergedPixel{&pixel, Pulse(), true, 0, {}}).first;
+        }
+        auto& merged_pixel = iter->second;
+        merged_pixel.pulse_valid = merged_pixel.pulse_valid && pulse.isInitialized();
+        if(merged_pixel.pulse_valid) {
+            merged_pixel.pulse += pulse;
+        }
+        merged_pixel.charge += charge;
+        return merged_pixel;
+    };
+
+    if(message != nullptr) {
+        for(const auto& pixel_charge : message->getData()) {
+            auto& merged_pixel = add(pixel_charge.getPixel(), pixel_charge.getPulse(), pixel_charge.getCharge());
+            try {
+                auto propagated_charges = pixel_charge.getPropagatedCharges();
+                merged_pixel.propagated_charges.insert(
+                    merged_pixel.propagated_charges.end(), propagated_charges.begin(), propagated_charges.end());
+            } catch(MissingReferenceException&) {
+                LOG_ONCE(WARNING) << "Propagated charges of the signal are not available, history is not kept";
+            }
+        }
+    }
+    for(const auto& overlay : background) {
+        for(const auto& pixel : overlay.first->pixels) {
+            if(!pixel.pulse.isInitialized() || overlay.second == 0) {
+                add(pixel.pixel, pixel.pulse, pixel.charge);
+                continue;
+            }
+
+            // Shift the pulse by the time offset of the background event
+            Pulse shifted(pixel.pulse.getBinning());
+            const auto& bins = pixel.pulse.getPulse();
+            for(size_t bin = 0; bin < bins.size(); ++bin) {
+                auto time = pixel.pulse.getBinning() * static_cast<double>(bin) + overlay.second;
+                if(time >= 0) {
+                    shifted.addCharge(bins[bin], time);
+                }
+            }
+            add(pixel.pixel, shifted, static_cast<unsigned int>(std::abs(shifted.getCharge())));
+        }
+        objects_cnt_ += overlay.first->pixels.size();
+    }
+
+    auto pixel_charges = MessageStorage<PixelCharge>::acquire();
+    for(auto& merged_pixel : merged) {
+        auto& pixel = merged_pixel.second;
+        if(pixel.pulse_valid) {
+            pixel_charges.emplace_back(*pixel.pixel, std::move(pixel.pulse), pixel.propagated_charges);
+        } else {
+            pixel_charges.emplace_back(*pixel.pixel, pixel.charge, pixel.propagated_charges);
+        }
+    }
+
+    LOG(DEBUG) << "Overlaid " << background.size() << " background events, dispatching " << pixel_charges.size()
+               << " pixel charges";
+    if(!pixel_charges.empty()) {
+        auto pixel_message = std::make_shared<PixelChargeMessage>(std::move(pixel_charges), getDetector());
+        messenger_->dispatchMessage(this, pixel_message, event);
+    }
+}
+
+void PileupOverlayModule::finalize() {
+    LOG(INFO) << "Overlaid " << overlaid_cnt_ << " background events with " << objects_cnt_ << " objects onto "
+              << events_cnt_ << " events";
+}
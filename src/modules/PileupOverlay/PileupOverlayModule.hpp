@@ -0,0 +1,134 @@
+/**
+ * @file
+ * @brief Definition of a module overlaying background events read from a data file onto every event
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_PILEUP_OVERLAY_MODULE_H
+#define ALLPIX_PILEUP_OVERLAY_MODULE_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Math/Point3D.h>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/Detector.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/DepositedCharge.hpp"
+#include "objects/PixelCharge.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to overlay background events stored by the ROOTObjectWriter onto every event
+     * @note This module supports parallelization
+     *
+     * A pool of background events is read from the data file at initialization and kept in memory. For every event, a number
+     * of background events is drawn from the pool, shifted by a random time offset and merged with the DepositedCharge or
+     * PixelCharge objects of the signal.
+     */
+    class PileupOverlayModule : public Module {
+        /**
+         * @brief Level at which the background is overlaid
+         */
+        enum class OverlayLevel {
+            DEPOSITED_CHARGE = 0, ///< Overlay the deposited charges before the propagation
+            PIXEL_CHARGE,         ///< Overlay the charges collected at the pixels
+        };
+
+    public:
+        /**
+         * @brief Constructor for this detector-specific module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param detector Pointer to the detector for this module instance
+         */
+        PileupOverlayModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector);
+
+        /**
+         * @brief Read the pool of background events from the data file
+         */
+        void init() override;
+
+        /**
+         * @brief Overlay randomly drawn background events onto the signal of the event
+         * @param event Pointer to the event
+         */
+        void run(Event* event) override;
+
+        /**
+         * @brief Output a summary of the overlaid background
+         */
+        void finalize() override;
+
+    private:
+        /**
+         * @brief Deposited charge of a background event, without the links to other objects
+         */
+        struct BackgroundDeposit {
+            ROOT::Math::XYZPoint local_position;
+            ROOT::Math::XYZPoint global_position;
+            CarrierType type;
+            unsigned int charge;
+            double time;
+        };
+
+        /**
+         * @brief Charge collected at a pixel in a background event, without the links to other objects
+         */
+        struct BackgroundPixel {
+            Pixel pixel;
+            Pulse pulse;
+            unsigned int charge;
+        };
+
+        /**
+         * @brief Objects of a single background event in the pool
+         */
+        struct BackgroundEvent {
+            std::vector<BackgroundDeposit> deposits;
+            std::vector<BackgroundPixel> pixels;
+        };
+
+        /**
+         * @brief Merge the deposited charges of the signal with the drawn background events and dispatch them
+         * @param event Pointer to the event
+         * @param background Background events to overlay with their time offsets
+         */
+        void overlay_deposits(Event* event, const std::vector<std::pair<const BackgroundEvent*, double>>& background);
+
+        /**
+         * @brief Merge the pixel charges of the signal with the drawn background events and dispatch them
+         * @param event Pointer to the event
+         * @param background Background events to overlay with their time offsets
+         */
+        void overlay_pixels(Event* event, const std::vector<std::pair<const BackgroundEvent*, double>>& background);
+
+        Messenger* messenger_;
+
+        OverlayLevel level_;
+        unsigned int pileup_events_{};
+        bool poisson_{};
+        double time_window_min_{}, time_window_max_{};
+        double bunch_spacing_{};
+
+        // Pool of background events read from the data file
+        std::vector<BackgroundEvent> pool_;
+
+        // Statistics
+        std::atomic<unsigned long> events_cnt_{};
+        std::atomic<unsigned long> overlaid_cnt_{};
+        std::atomic<unsigned long> objects_cnt_{};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_PILEUP_OVERLAY_MODULE_H */
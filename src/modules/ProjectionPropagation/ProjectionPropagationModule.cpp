@@ -6,6 +6,8 @@
 
 #include "ProjectionPropagationModule.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
 #include <limits>
 #include <string>
@@ -34,9 +36,16 @@ ProjectionPropagationModule::ProjectionPropagationModule(Configuration& config,
     config_.setDefault<int>("charge_per_step", 10);
     config_.setDefault<double>("integration_time", Units::get(25, "ns"));
     config_.setDefault<bool>("output_plots", false);
+    config_.setDefault<bool>("fast_math", false);
 
+    charge_per_step_ = config_.get<unsigned int>("charge_per_step");
+    if(charge_per_step_ == 0) {
+        throw InvalidValueError(config_, "charge_per_step", "charge per step should be larger than zero");
+    }
     integration_time_ = config_.get<double>("integration_time");
     output_plots_ = config_.get<bool>("output_plots");
+    fast_math_ = config_.get<bool>("fast_math");
+    roi_ = RegionOfInterest(config_, *detector_);
 
     // Set default for charge carrier propagation:
     config_.setDefault<bool>("propagate_holes", false);
@@ -59,6 +68,10 @@ ProjectionPropagationModule::ProjectionPropagationModule(Configuration& config,
 
     boltzmann_kT_ = Units::get(8.6173e-5, "eV/K") * temperature;
 
+    // Hall factors of the mobility for the Lorentz drift, as in the GenericPropagation module
+    electron_Hall_ = 1.15;
+    hole_Hall_ = 0.9;
+
     config_.setDefault<bool>("ignore_magnetic_field", false);
 }
 
@@ -67,11 +80,10 @@ void ProjectionPropagationModule::init() {
         throw ModuleError("This module should only be used with linear electric fields.");
     }
 
-    if(detector_->hasMagneticField() && !config_.get<bool>("ignore_magnetic_field")) {
-        throw ModuleError("This module should not be used with magnetic fields. Add the option 'ignore_magnetic_field' to "
-                          "the configuration if you would like to continue.");
-    } else if(detector_->hasMagneticField() && config_.get<bool>("ignore_magnetic_field")) {
+    if(detector_->hasMagneticField() && config_.get<bool>("ignore_magnetic_field")) {
         LOG(WARNING) << "A magnetic field is switched on, but is set to be ignored for this module.";
+    } else if(detector_->hasMagneticField()) {
+        lorentz_drift_ = true;
     }
 
     // Find correct top side
@@ -83,12 +95,29 @@ void ProjectionPropagationModule::init() {
         top_z_ *= -1;
     }
 
+    if(roi_.isRestricted()) {
+        LOG(INFO) << "Propagating only charges deposited in the region of interest of " << roi_.describe();
+    }
+
     if(top_z_ < 0) {
         LOG(WARNING)
             << "Selected carriers are not propagated to the implant side, combination of propagated carrier and electric "
                "field is wrong!";
     }
 
+    // Precalculate the values at the top of the sensor and the constants of the drift time for the propagated carrier
+    auto efield_top = detector_->getElectricField(ROOT::Math::XYZPoint(0., 0., top_z_));
+    efield_mag_top_ = std::sqrt(efield_top.Mag2());
+    log_efield_mag_top_ = std::log(efield_mag_top_);
+    mobility_top_ = carrier_mobility(efield_mag_top_);
+    critical_field_ = (propagate_type_ == CarrierType::ELECTRON ? electron_Ec_ : hole_Ec_);
+    zero_field_mobility_ = (propagate_type_ == CarrierType::ELECTRON ? electron_Vm_ / electron_Ec_ : hole_Vm_ / hole_Ec_);
+
+    // Tabulate the lateral shift and the corrections of the diffusion from the Lorentz drift
+    if(lorentz_drift_) {
+        build_lorentz_table();
+    }
+
     if(output_plots_) {
         // Initialize output plot
         drift_time_histo_ = new TH1D("drift_time_histo",
@@ -100,16 +129,29 @@ void ProjectionPropagationModule::init() {
 }
 
 void ProjectionPropagationModule::run(unsigned int) {
+    const auto& deposits = deposits_message_->getData();
+
+    // Reserve the output for all groups of charge carriers of the selected type
+    size_t total_groups = 0;
+    for(auto& deposit : deposits) {
+        if(deposit.getType() == propagate_type_) {
+            total_groups += (deposit.getCharge() + charge_per_step_ - 1) / charge_per_step_;
+        }
+    }
 
     // Create vector of propagated charges to output
-    std::vector<PropagatedCharge> propagated_charges;
+    auto propagated_charges = MessageStorage<PropagatedCharge>::acquire();
+    propagated_charges.reserve(total_groups);
 
     double charge_lost = 0;
     double total_charge = 0;
     double total_projected_charge = 0;
 
+    // Buffer for the diffusion of all groups of charge carriers of one deposit
+    std::vector<double> diffusion;
+
     // Loop over all deposits for propagation
-    for(auto& deposit : deposits_message_->getData()) {
+    for(auto& deposit : deposits) {
 
         auto position = deposit.getLocalPosition();
         auto type = deposit.getType();
@@ -119,43 +161,22 @@ void ProjectionPropagationModule::run(unsigned int) {
             continue;
         }
 
+        // Skip deposits which cannot reach the region of interest before the projection
+        if(!roi_.contains(position)) {
+            ++skipped_deposits_;
+            continue;
+        }
+
         LOG(DEBUG) << "Set of " << deposit.getCharge() << " charge carriers (" << type << ") on "
                    << Units::display(position, {"mm", "um"});
 
-        // Define a lambda function to compute the carrier mobility
-        auto carrier_mobility = [&](double efield_mag) {
-            // Compute carrier mobility from constants and electric field magnitude
-            double numerator, denominator;
-            if(type == CarrierType::ELECTRON) {
-                numerator = electron_Vm_ / electron_Ec_;
-                denominator = std::pow(1. + std::pow(efield_mag / electron_Ec_, electron_Beta_), 1.0 / electron_Beta_);
-            } else {
-                numerator = hole_Vm_ / hole_Ec_;
-                denominator = std::pow(1. + std::pow(efield_mag / hole_Ec_, hole_Beta_), 1.0 / hole_Beta_);
-            }
-            return numerator / denominator;
-        };
-
-        // Get the electric field at the position of the deposited charge and the top of the sensor:
+        // Get the electric field at the position of the deposited charge, the field at the top of the sensor is constant:
         auto efield = detector_->getElectricField(position);
         double efield_mag = std::sqrt(efield.Mag2());
-        auto efield_top = detector_->getElectricField(ROOT::Math::XYZPoint(0., 0., top_z_));
-        double efield_mag_top = std::sqrt(efield_top.Mag2());
 
-        LOG(TRACE) << "Electric field at carrier position / top of the sensor: " << Units::display(efield_mag_top, "V/cm")
+        LOG(TRACE) << "Electric field at carrier position / top of the sensor: " << Units::display(efield_mag_top_, "V/cm")
                    << " , " << Units::display(efield_mag, "V/cm");
 
-        slope_efield_ = (efield_mag_top - efield_mag) / (std::abs(top_z_ - position.z()));
-
-        // Calculate the drift time
-        auto calc_drift_time = [&]() {
-            double Ec = (type == CarrierType::ELECTRON ? electron_Ec_ : hole_Ec_);
-            double zero_mobility = (type == CarrierType::ELECTRON ? electron_Vm_ / electron_Ec_ : hole_Vm_ / hole_Ec_);
-
-            return ((log(efield_mag_top) - log(efield_mag)) / slope_efield_ + std::abs(top_z_ - position.z()) / Ec) /
-                   zero_mobility;
-        };
-
         // Only project if within the depleted region (i.e. efield not zero)
         if(efield_mag < std::numeric_limits<double>::epsilon()) {
             LOG(TRACE) << "Electric field is zero at " << Units::display(position, {"mm", "um"});
@@ -165,43 +186,71 @@ void ProjectionPropagationModule::run(unsigned int) {
         LOG(TRACE) << "Electric field is " << Units::display(efield_mag, "V/cm");
 
         // Assume linear electric field over the sensor:
-        double diffusion_constant = boltzmann_kT_ * (carrier_mobility(efield_mag) + carrier_mobility(efield_mag_top)) / 2.;
+        double diffusion_constant = boltzmann_kT_ * (carrier_mobility(efield_mag) + mobility_top_) / 2.;
 
-        double drift_time = calc_drift_time();
+        // Calculate the drift time
+        auto distance = std::abs(top_z_ - position.z());
+        auto slope_efield = (efield_mag_top_ - efield_mag) / distance;
+        auto log_efield_mag = (fast_math_ ? fast_math::log(efield_mag) : std::log(efield_mag));
+        double drift_time =
+            ((log_efield_mag_top_ - log_efield_mag) / slope_efield + distance / critical_field_) / zero_field_mobility_;
         LOG(TRACE) << "Drift time is " << Units::display(drift_time, "ns");
 
-        if(output_plots_) {
-            drift_time_histo_->Fill(drift_time, deposit.getCharge());
-        }
-
         double diffusion_std_dev = std::sqrt(2. * diffusion_constant * drift_time);
         LOG(TRACE) << "Diffusion width is " << Units::display(diffusion_std_dev, "um");
 
-        double projected_charge = 0;
+        // Correct the drift time and the diffusion for the Lorentz drift and shift the projected position
+        std::array<double, 2> diffusion_widths{{diffusion_std_dev, diffusion_std_dev}};
+        std::array<double, 2> lorentz_shift{};
+        if(lorentz_drift_) {
+            auto slice = get_lorentz_slice(distance);
+            drift_time *= slice.time;
+            diffusion_widths[0] *= std::sqrt(slice.diffusion[0]);
+            diffusion_widths[1] *= std::sqrt(slice.diffusion[1]);
+            lorentz_shift = slice.shift;
+            LOG(TRACE) << "Lorentz drift shifts the carriers by " << Units::display(lorentz_shift[0], {"um", "nm"})
+                       << " in x and " << Units::display(lorentz_shift[1], {"um", "nm"}) << " in y";
+        }
+
+        if(output_plots_) {
+            drift_time_histo_->Fill(drift_time, deposit.getCharge());
+        }
 
         unsigned int charges_remaining = deposit.getCharge();
         total_charge += charges_remaining;
 
-        auto charge_per_step = config_.get<unsigned int>("charge_per_step");
-        while(charges_remaining > 0) {
-            if(charge_per_step > charges_remaining) {
-                charge_per_step = charges_remaining;
+        // Draw the diffusion in x and y of all groups at once, every group uses one pair of the polar method
+        auto groups = (charges_remaining + charge_per_step_ - 1) / charge_per_step_;
+        diffusion.resize(2 * static_cast<size_t>(groups));
+        if(fast_math_) {
+            for(auto& value : diffusion) {
+                value = normal_sampler_(random_generator_);
             }
-            charges_remaining -= charge_per_step;
+        } else {
+            for(auto& value : diffusion) {
+                value = gauss_distribution_(random_generator_);
+            }
+        }
+        for(size_t idx = 0; idx < diffusion.size(); ++idx) {
+            diffusion[idx] *= diffusion_widths[idx % 2];
+        }
 
-            std::normal_distribution<double> gauss_distribution(0, diffusion_std_dev);
-            double diffusion_x = gauss_distribution(random_generator_);
-            double diffusion_y = gauss_distribution(random_generator_);
+        // Only add if within requested integration time:
+        auto event_time = deposit.getEventTime() + drift_time;
+        if(drift_time > integration_time_) {
+            LOG(DEBUG) << "Charge carriers drift time not within integration time: " << Units::display(event_time, "ns");
+            continue;
+        }
 
-            // Find projected position
-            auto local_position = ROOT::Math::XYZPoint(position.x() + diffusion_x, position.y() + diffusion_y, top_z_);
+        double projected_charge = 0;
+        for(size_t group = 0; group < groups; ++group) {
+            auto charge_per_step = std::min(charge_per_step_, charges_remaining);
+            charges_remaining -= charge_per_step;
 
-            // Only add if within requested integration time:
-            auto event_time = deposit.getEventTime() + drift_time;
-            if(drift_time > integration_time_) {
-                LOG(DEBUG) << "Charge carriers drift time not within integration time: " << Units::display(event_time, "ns");
-                continue;
-            }
+            // Find projected position
+            auto local_position = ROOT::Math::XYZPoint(position.x() + lorentz_shift[0] + diffusion[2 * group],
+                                                       position.y() + lorentz_shift[1] + diffusion[2 * group + 1],
+                                                       top_z_);
 
             // Only add if within sensor volume:
             if(!detector_->isWithinSensor(local_position)) {
@@ -236,9 +285,116 @@ void ProjectionPropagationModule::run(unsigned int) {
     messenger_->dispatchMessage(this, propagated_charge_message);
 }
 
+/**
+ * Carrier mobility of the propagated carrier type from constants and electric field magnitude
+ */
+double ProjectionPropagationModule::carrier_mobility(double efield_mag) const {
+    auto power = [this](double base, double exponent) {
+        return (fast_math_ && base > 0 ? fast_math::pow(base, exponent) : std::pow(base, exponent));
+    };
+    double numerator, denominator;
+    if(propagate_type_ == CarrierType::ELECTRON) {
+        numerator = electron_Vm_ / electron_Ec_;
+        denominator = power(1. + power(efield_mag / electron_Ec_, electron_Beta_), 1.0 / electron_Beta_);
+    } else {
+        numerator = hole_Vm_ / hole_Ec_;
+        denominator = power(1. + power(efield_mag / hole_Ec_, hole_Beta_), 1.0 / hole_Beta_);
+    }
+    return numerator / denominator;
+}
+
+/**
+ * The drift is integrated in slices from the top of the sensor to the opposite side in the electric and magnetic field at
+ * the center of the sensor. For an electric field along z, the drift velocity with the Hall mobility \f$\mu_H = r\mu\f$ is
+ * proportional to \f$\vec{E} \pm \mu_H \vec{E} \times \vec{B} + \mu_H^2 (\vec{E} \cdot \vec{B}) \vec{B}\f$ as in the
+ * GenericPropagation module, such that the lateral shift per distance along z only depends on the mobility at the depth. The
+ * diffusion constant in the plane perpendicular to the magnetic field is reduced by \f$1 + \mu_H^2 B^2\f$, while the drift
+ * along z is slowed down. Both are stored as factors relative to the drift without magnetic field, by which the analytic
+ * drift time and diffusion are scaled. The correlation of the diffusion in x and y, which only occurs if the magnetic field
+ * has components along both axes, is neglected.
+ */
+void ProjectionPropagationModule::build_lorentz_table() {
+    auto sign = (propagate_type_ == CarrierType::ELECTRON ? -1.0 : 1.0);
+    auto hall_factor = (propagate_type_ == CarrierType::ELECTRON ? electron_Hall_ : hole_Hall_);
+    auto direction = (top_z_ > 0 ? 1.0 : -1.0);
+    auto center = model_->getSensorCenter();
+
+    // The slices cover the full thickness, the deposits beyond the depleted region are not projected
+    constexpr size_t slices = 100;
+    lorentz_step_ = model_->getSensorSize().z() / slices;
+    lorentz_table_.assign(1, LorentzSlice());
+
+    // Integrated drift time and diffusion variance without magnetic field, and with the Lorentz drift
+    double time_free = 0, time_lorentz = 0;
+    double variance_free = 0;
+    std::array<double, 2> variance_lorentz{};
+    LorentzSlice slice;
+    for(size_t idx = 0; idx < slices; ++idx) {
+        auto z = top_z_ - direction * (static_cast<double>(idx) + 0.5) * lorentz_step_;
+        auto efield_mag = std::sqrt(detector_->getElectricField(ROOT::Math::XYZPoint(center.x(), center.y(), z)).Mag2());
+        if(efield_mag < std::numeric_limits<double>::epsilon()) {
+            break;
+        }
+        auto bfield = detector_->getMagneticField(ROOT::Math::XYZPoint(center.x(), center.y(), z));
+
+        auto mobility = carrier_mobility(efield_mag);
+        auto mobility_hall = hall_factor * mobility;
+        auto hall2 = mobility_hall * mobility_hall;
+        auto rnorm = 1 + hall2 * bfield.Mag2();
+        auto longitudinal = 1 + hall2 * bfield.z() * bfield.z();
+
+        // Lateral shift per distance along z towards the top of the sensor
+        auto step = direction * lorentz_step_ / longitudinal;
+        slice.shift[0] += step * (-sign * mobility_hall * bfield.y() + hall2 * bfield.x() * bfield.z());
+        slice.shift[1] += step * (sign * mobility_hall * bfield.x() + hall2 * bfield.y() * bfield.z());
+
+        // Drift time through the slice and the diffusion variance accumulated in this time
+        auto dt_free = lorentz_step_ / (mobility * efield_mag);
+        auto dt_lorentz = dt_free * rnorm / longitudinal;
+        time_free += dt_free;
+        time_lorentz += dt_lorentz;
+        variance_free += mobility * dt_free;
+        variance_lorentz[0] += mobility * dt_lorentz * (1 + hall2 * bfield.x() * bfield.x()) / rnorm;
+        variance_lorentz[1] += mobility * dt_lorentz * (1 + hall2 * bfield.y() * bfield.y()) / rnorm;
+
+        slice.time = time_lorentz / time_free;
+        slice.diffusion = {{variance_lorentz[0] / variance_free, variance_lorentz[1] / variance_free}};
+        lorentz_table_.push_back(slice);
+    }
+
+    const auto& full = lorentz_table_.back();
+    LOG(INFO) << "Tabulated Lorentz drift of " << (propagate_type_ == CarrierType::ELECTRON ? "electrons" : "holes")
+              << " in " << lorentz_table_.size() - 1 << " slices, shifting by "
+              << Units::display(full.shift[0], {"um", "nm"}) << " in x and " << Units::display(full.shift[1], {"um", "nm"})
+              << " in y across the depleted thickness";
+}
+
+ProjectionPropagationModule::LorentzSlice ProjectionPropagationModule::get_lorentz_slice(double distance) const {
+    auto position = std::max(0.0, distance / lorentz_step_);
+    auto idx = static_cast<size_t>(position);
+    if(idx + 1 >= lorentz_table_.size()) {
+        return lorentz_table_.back();
+    }
+
+    // Interpolate linearly between the slice boundaries
+    auto weight = position - static_cast<double>(idx);
+    const auto& lower = lorentz_table_[idx];
+    const auto& upper = lorentz_table_[idx + 1];
+    LorentzSlice slice;
+    for(size_t axis = 0; axis < 2; ++axis) {
+        slice.shift[axis] = lower.shift[axis] * (1 - weight) + upper.shift[axis] * weight;
+        slice.diffusion[axis] = lower.diffusion[axis] * (1 - weight) + upper.diffusion[axis] * weight;
+    }
+    slice.time = lower.time * (1 - weight) + upper.time * weight;
+    return slice;
+}
+
 void ProjectionPropagationModule::finalize() {
     if(output_plots_) {
         // Write output plot
         drift_time_histo_->Write();
     }
+    if(skipped_deposits_ > 0) {
+        LOG(INFO) << "Skipped " << skipped_deposits_ << " deposits outside of the region of interest";
+    }
 }
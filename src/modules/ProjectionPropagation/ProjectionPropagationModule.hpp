@@ -8,8 +8,10 @@
  * Refer to the User's Manual for more details.
  */
 
+#include <array>
 #include <random>
 #include <string>
+#include <vector>
 
 #include <TH1D.h>
 
@@ -21,6 +23,9 @@
 #include "objects/DepositedCharge.hpp"
 #include "objects/PropagatedCharge.hpp"
 
+#include "tools/fast_math.h"
+#include "tools/region_of_interest.h"
+
 namespace allpix {
     /**
      * @ingroup Modules
@@ -56,16 +61,54 @@ namespace allpix {
         void finalize() override;
 
     private:
+        /**
+         * @brief Calculate the mobility of the propagated charge carriers
+         * @param efield_mag Magnitude of the electric field
+         * @return Mobility of the carriers
+         */
+        double carrier_mobility(double efield_mag) const;
+
+        /**
+         * @brief Corrections for the Lorentz drift of the carriers from a depth to the top of the sensor
+         */
+        struct LorentzSlice {
+            std::array<double, 2> shift{};               ///< Lateral shift in x and y
+            std::array<double, 2> diffusion{{1.0, 1.0}}; ///< Factors of the diffusion variance in x and y
+            double time{1.0};                            ///< Factor of the drift time
+        };
+
+        /**
+         * @brief Tabulate the Lorentz drift in the magnetic field along the thickness of the sensor
+         */
+        void build_lorentz_table();
+
+        /**
+         * @brief Interpolate the tabulated Lorentz drift
+         * @param distance Distance of the deposit to the top of the sensor
+         * @return Corrections for the drift from this distance to the top of the sensor
+         */
+        LorentzSlice get_lorentz_slice(double distance) const;
+
         Messenger* messenger_;
         std::shared_ptr<const Detector> detector_;
         std::shared_ptr<DetectorModel> model_;
 
-        // Random generator for diffusion calculation
+        // Random generator and unit normal distribution for diffusion calculation
         std::mt19937_64 random_generator_;
+        std::normal_distribution<double> gauss_distribution_{0, 1};
+
+        // Fast approximations of the mobility and the drift time and sampler of the diffusion
+        bool fast_math_{};
+        fast_math::ZigguratNormal normal_sampler_;
+
+        // Region of interest of the detector and number of deposits skipped outside of it
+        RegionOfInterest roi_;
+        unsigned long long skipped_deposits_{};
 
         // Config parameters: Check whether plots should be generated
         bool output_plots_;
         double integration_time_{};
+        unsigned int charge_per_step_{};
 
         // Carrier type to be propagated
         CarrierType propagate_type_;
@@ -79,9 +122,20 @@ namespace allpix {
         double electron_Vm_;
         double electron_Ec_;
         double electron_Beta_;
-
-        // Calculated slope of the electric field
-        double slope_efield_;
+        double electron_Hall_{};
+        double hole_Hall_{};
+
+        // Electric field and mobility at the top of the sensor, and constants of the drift time
+        double efield_mag_top_{};
+        double log_efield_mag_top_{};
+        double mobility_top_{};
+        double critical_field_{};
+        double zero_field_mobility_{};
+
+        // Lorentz drift in the magnetic field, tabulated by the distance to the top of the sensor
+        bool lorentz_drift_{};
+        double lorentz_step_{};
+        std::vector<LorentzSlice> lorentz_table_;
 
         // Precalculated value for Boltzmann constant:
         double boltzmann_kT_;
@@ -10,9 +10,13 @@
 #include "PulseTransferModule.hpp"
 #include "core/utils/log.h"
 #include "objects/PixelCharge.hpp"
+#include "objects/PixelIndexMap.hpp"
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <TAxis.h>
 #include <TGraph.h>
@@ -23,18 +27,29 @@ PulseTransferModule::PulseTransferModule(Configuration& config,
                                          Messenger* messenger,
                                          const std::shared_ptr<Detector>& detector)
     : Module(config, detector), detector_(detector), messenger_(messenger) {
-    // Enable parallelization of this module if multithreading is enabled
-    enable_parallelization();
-
     config_.setDefault<bool>("output_pulsegraphs", false);
     config_.setDefault<bool>("output_plots", config_.get<bool>("output_pulsegraphs"));
     config_.setDefault<int>("output_plots_scale", Units::get(30, "ke"));
     config_.setDefault<int>("output_plots_bins", 100);
+    config_.setDefault<unsigned int>("pulsegraphs_max_events", 0);
+    config_.setDefault<unsigned int>("pulsegraphs_event_interval", 1);
+    config_.setDefault<size_t>("pulsegraphs_max_points", 0);
 
     output_plots_ = config_.get<bool>("output_plots");
     output_pulsegraphs_ = config_.get<bool>("output_pulsegraphs");
+    pulsegraphs_max_events_ = config_.get<unsigned int>("pulsegraphs_max_events");
+    pulsegraphs_event_interval_ = config_.get<unsigned int>("pulsegraphs_event_interval");
+    if(pulsegraphs_event_interval_ == 0) {
+        throw InvalidValueError(
+            config_, "pulsegraphs_event_interval", "interval between events should be strictly positive");
+    }
+    pulsegraphs_max_points_ = config_.get<size_t>("pulsegraphs_max_points");
 
-    messenger_->bindSingle(this, &PulseTransferModule::message_, MsgFlags::REQUIRED);
+    // Enable parallelization of this module if multithreading is enabled, the pulse graphs are prepared in parallel and only
+    // their writing is serialized
+    enable_parallelization();
+
+    messenger_->bindSingle<PropagatedChargeMessage>(this, MsgFlags::REQUIRED);
 }
 
 void PulseTransferModule::init() {
@@ -54,104 +69,126 @@ void PulseTransferModule::init() {
     }
 }
 
-void PulseTransferModule::run(unsigned int event_num) {
+void PulseTransferModule::run(Event* event) {
+    auto message = messenger_->fetchMessage<PropagatedChargeMessage>(this, event);
 
     // Create map for all pixels: pulse and propagated charges
-    std::map<Pixel::Index, Pulse> pixel_pulse_map;
-    std::map<Pixel::Index, std::vector<const PropagatedCharge*>> pixel_charge_map;
+    PixelIndexMap<std::pair<Pulse, std::vector<const PropagatedCharge*>>> pixel_map;
+
+    LOG(DEBUG) << "Received " << message->getData().size() << " propagated charge objects.";
 
-    LOG(DEBUG) << "Received " << message_->getData().size() << " propagated charge objects.";
-    for(const auto& propagated_charge : message_->getData()) {
+    // Only write the pulse graphs of every n-th event, up to the maximum number of events
+    auto event_offset = event->getNumber() - 1;
+    bool write_graphs = output_pulsegraphs_ && event_offset % pulsegraphs_event_interval_ == 0;
+    if(pulsegraphs_max_events_ > 0 && event_offset / pulsegraphs_event_interval_ >= pulsegraphs_max_events_) {
+        write_graphs = false;
+    }
+    for(const auto& propagated_charge : message->getData()) {
         for(auto& pulse : propagated_charge.getPulses()) {
-            auto pixel_index = pulse.first;
+            auto& pixel = pixel_map[pulse.first];
 
             // Accumulate all pulses from input message data:
-            pixel_pulse_map[pixel_index] += pulse.second;
+            pixel.first += pulse.second;
 
-            auto px = pixel_charge_map[pixel_index];
-            // For each pulse, store the corresponding propagated charges to preserve history:
-            if(std::find(px.begin(), px.end(), &propagated_charge) == px.end()) {
-                pixel_charge_map[pixel_index].emplace_back(&propagated_charge);
-            }
+            // For each pulse, store the corresponding propagated charges to preserve history. The pulses of a propagated
+            // charge belong to different pixels, such that every propagated charge is only added once to every pixel:
+            pixel.second.emplace_back(&propagated_charge);
         }
     }
 
     // Create vector of pixel pulses to return for this detector
-    std::vector<PixelCharge> pixel_charges;
+    auto pixel_charges = MessageStorage<PixelCharge>::acquire();
+    pixel_charges.reserve(pixel_map.size());
     Pulse total_pulse;
-    for(auto& pixel_index_pulse : pixel_pulse_map) {
+    for(auto& pixel_index_pulse : pixel_map) {
         auto index = pixel_index_pulse.first;
-        auto pulse = pixel_index_pulse.second;
+        auto& pulse = pixel_index_pulse.second.first;
+        auto& propagated_charges = pixel_index_pulse.second.second;
 
         // Sum all pulses for informational output:
         total_pulse += pulse;
 
         // Fill pixel charge histogram
         if(output_plots_) {
+            std::lock_guard<std::mutex> lock(histogram_mutex_);
             h_induced_pixel_charge_->Fill(pulse.getCharge() / 1e3);
         }
 
         // Fill a graphs with the individual pixel pulses:
-        if(output_pulsegraphs_) {
-            auto step = pulse.getBinning();
-            auto pulse_vec = pulse.getPulse();
-            LOG(TRACE) << "Preparing pulse for pixel " << index << ", " << pulse_vec.size() << " bins of "
-                       << Units::display(step, {"ps", "ns"})
-                       << ", total charge: " << Units::display(pixel_index_pulse.second.getCharge(), "e");
-
-            // Generate x-axis:
-            std::vector<double> time(pulse_vec.size());
-            // clang-format off
-            std::generate(time.begin(), time.end(), [n = 0.0, step]() mutable {  auto now = n; n += step; return now; });
-            // clang-format on
-
-            std::string name =
-                "pulse_ev" + std::to_string(event_num) + "_px" + std::to_string(index.x()) + "-" + std::to_string(index.y());
-            auto pulse_graph = new TGraph(static_cast<int>(pulse_vec.size()), &time[0], &pulse_vec[0]);
-            pulse_graph->GetXaxis()->SetTitle("t [ns]");
-            pulse_graph->GetYaxis()->SetTitle("Q_{ind} [e]");
-            pulse_graph->SetTitle(("Induced charge in pixel (" + std::to_string(index.x()) + "," +
-                                   std::to_string(index.y()) +
-                                   "), Q_{tot} = " + std::to_string(pixel_index_pulse.second.getCharge()) + " e")
-                                      .c_str());
-            getROOTDirectory()->WriteTObject(pulse_graph, name.c_str());
-
-            // Generate graphs of integrated charge over time:
-            std::vector<double> charge_vec;
-            double charge = 0;
-            for(const auto& bin : pulse_vec) {
-                charge += bin;
-                charge_vec.push_back(charge);
-            }
-
-            name = "charge_ev" + std::to_string(event_num) + "_px" + std::to_string(index.x()) + "-" +
-                   std::to_string(index.y());
-            auto charge_graph = new TGraph(static_cast<int>(charge_vec.size()), &time[0], &charge_vec[0]);
-            charge_graph->GetXaxis()->SetTitle("t [ns]");
-            charge_graph->GetYaxis()->SetTitle("Q_{tot} [e]");
-            charge_graph->SetTitle(("Accumulated induced charge in pixel (" + std::to_string(index.x()) + "," +
-                                    std::to_string(index.y()) +
-                                    "), Q_{tot} = " + std::to_string(pixel_index_pulse.second.getCharge()) + " e")
-                                       .c_str());
-            getROOTDirectory()->WriteTObject(charge_graph, name.c_str());
+        if(write_graphs) {
+            write_pulse_graphs(event, index, pulse);
         }
-        LOG(DEBUG) << "Charge on pixel " << index << " has " << pixel_charge_map[index].size() << " ancestors";
+        LOG(DEBUG) << "Charge on pixel " << index << " has " << propagated_charges.size() << " ancestors";
 
         // Store the pulse:
-        pixel_charges.emplace_back(detector_->getPixel(index), std::move(pulse), pixel_charge_map[index]);
+        pixel_charges.emplace_back(detector_->getPixel(index), std::move(pulse), propagated_charges);
     }
 
     // Create a new message with pixel pulses and dispatch:
     auto pixel_charge_message = std::make_shared<PixelChargeMessage>(std::move(pixel_charges), detector_);
-    messenger_->dispatchMessage(this, pixel_charge_message);
+    messenger_->dispatchMessage(this, pixel_charge_message, event);
 
     // Fill pixel charge histogram
     if(output_plots_) {
+        std::lock_guard<std::mutex> lock(histogram_mutex_);
         h_total_induced_charge_->Fill(total_pulse.getCharge() / 1e3);
     }
 
     LOG(INFO) << "Total charge induced on all pixels: " << Units::display(total_pulse.getCharge(), "e");
 }
+/**
+ * The graphs of the induced current and the accumulated charge are created by the calling worker, which can prepare the
+ * graphs of several events at the same time. Only the writing to the module directory is serialized. If the pulse has more
+ * bins than the maximum number of points, consecutive bins are merged such that the current graph shows the charge induced
+ * in the merged time step and the accumulated charge stays exact at every point.
+ */
+void PulseTransferModule::write_pulse_graphs(Event* event, const Pixel::Index& index, const Pulse& pulse) {
+    const auto& pulse_vec = pulse.getPulse();
+    size_t merged_bins = 1;
+    if(pulsegraphs_max_points_ > 0 && pulse_vec.size() > pulsegraphs_max_points_) {
+        merged_bins = (pulse_vec.size() + pulsegraphs_max_points_ - 1) / pulsegraphs_max_points_;
+    }
+    auto step = pulse.getBinning() * static_cast<double>(merged_bins);
+    LOG(TRACE) << "Preparing pulse for pixel " << index << ", " << pulse_vec.size() << " bins of "
+               << Units::display(pulse.getBinning(), {"ps", "ns"}) << " merged into steps of "
+               << Units::display(step, {"ps", "ns"}) << ", total charge: " << Units::display(pulse.getCharge(), "e");
+
+    // Generate x-axis and the merged current and accumulated charge:
+    std::vector<double> time, current_vec, charge_vec;
+    double charge = 0;
+    for(size_t bin = 0; bin < pulse_vec.size(); bin += merged_bins) {
+        auto merged_end = std::min(bin + merged_bins, pulse_vec.size());
+        double current = 0;
+        for(size_t merged = bin; merged < merged_end; ++merged) {
+            current += pulse_vec[merged];
+        }
+        charge += current;
+        time.push_back(static_cast<double>(time.size()) * step);
+        current_vec.push_back(current);
+        charge_vec.push_back(charge);
+    }
+
+    std::string pixel_name = std::to_string(index.x()) + "-" + std::to_string(index.y());
+    std::string pixel_title = "(" + std::to_string(index.x()) + "," + std::to_string(index.y()) +
+                              "), Q_{tot} = " + std::to_string(pulse.getCharge()) + " e";
+
+    auto pulse_graph = std::make_unique<TGraph>(static_cast<int>(time.size()), time.data(), current_vec.data());
+    pulse_graph->GetXaxis()->SetTitle("t [ns]");
+    pulse_graph->GetYaxis()->SetTitle("Q_{ind} [e]");
+    pulse_graph->SetTitle(("Induced charge in pixel " + pixel_title).c_str());
+
+    // Generate graphs of integrated charge over time:
+    auto charge_graph = std::make_unique<TGraph>(static_cast<int>(time.size()), time.data(), charge_vec.data());
+    charge_graph->GetXaxis()->SetTitle("t [ns]");
+    charge_graph->GetYaxis()->SetTitle("Q_{tot} [e]");
+    charge_graph->SetTitle(("Accumulated induced charge in pixel " + pixel_title).c_str());
+
+    std::lock_guard<std::mutex> lock(graph_mutex_);
+    getROOTDirectory()->WriteTObject(
+        pulse_graph.get(), ("pulse_ev" + std::to_string(event->getNumber()) + "_px" + pixel_name).c_str());
+    getROOTDirectory()->WriteTObject(
+        charge_graph.get(), ("charge_ev" + std::to_string(event->getNumber()) + "_px" + pixel_name).c_str());
+}
 
 void PulseTransferModule::finalize() {
 
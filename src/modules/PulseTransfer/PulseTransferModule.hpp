@@ -7,6 +7,7 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <mutex>
 #include <string>
 
 #include "core/config/Configuration.hpp"
@@ -43,8 +44,9 @@ namespace allpix {
 
         /**
          * @brief Combine pulses from propagated charges and transfer them to the pixels
+         * @param event Pointer to the event to process
          */
-        void run(unsigned int) override;
+        void run(Event* event) override;
 
         /**
          * @brief Finalize and write optional histograms
@@ -52,14 +54,25 @@ namespace allpix {
         void finalize() override;
 
     private:
+        /**
+         * @brief Write the graphs of the induced current and the accumulated charge of a pixel
+         * @param event Pointer to the event the pulse belongs to
+         * @param index Index of the pixel
+         * @param pulse Pulse induced on the pixel
+         */
+        void write_pulse_graphs(Event* event, const Pixel::Index& index, const Pulse& pulse);
+
         bool output_plots_{}, output_pulsegraphs_{};
+        unsigned int pulsegraphs_max_events_{}, pulsegraphs_event_interval_{};
+        size_t pulsegraphs_max_points_{};
 
         // General module members
         std::shared_ptr<Detector> detector_;
         Messenger* messenger_;
-        std::shared_ptr<PropagatedChargeMessage> message_;
 
         // Output histograms
+        std::mutex histogram_mutex_;
         TH1D *h_total_induced_charge_{}, *h_induced_pixel_charge_{};
+        std::mutex graph_mutex_;
     };
 } // namespace allpix
@@ -331,7 +331,8 @@ void RCEWriterModule::init() {
     // For each detector name, initialize an instance of SensorData
     int det_index = 0;
     for(const auto& detector_name : detector_names) {
-        auto& sensor = sensors_[detector_name];
+        auto& sensor = sensors_[geo_mgr_->getDetector(detector_name)];
+        sensor.nhits_ = 0;
 
         LOG(TRACE) << "Sensor " << det_index << ", detector " << detector_name;
 
@@ -369,15 +370,20 @@ void RCEWriterModule::run(unsigned int event_id) {
     event_tree_->Fill();
     LOG(TRACE) << "Wrote global event data";
 
-    // reset all per-sensor trees
-    for(auto& item : sensors_) {
-        item.second.nhits_ = 0;
-    }
-
-    // Loop over the pixel hit messages
+    // Loop over the pixel hit messages, only sensors with hits have to be updated
     for(const auto& hit_msg : pixel_hit_messages_) {
+        if(hit_msg->getData().empty()) {
+            continue;
+        }
         const auto& detector_name = hit_msg->getDetector()->getName();
-        auto& sensor = sensors_[detector_name];
+        auto sensor_it = sensors_.find(hit_msg->getDetector());
+        if(sensor_it == sensors_.end()) {
+            continue;
+        }
+        auto& sensor = sensor_it->second;
+        if(sensor.nhits_ == 0) {
+            sensors_with_hits_.push_back(&sensor);
+        }
 
         // Loop over all the hits
         for(const auto& hit : hit_msg->getData()) {
@@ -402,11 +408,18 @@ void RCEWriterModule::run(unsigned int event_id) {
         }
     }
 
-    // Loop over all the detectors to fill all corresponding sensor trees
+    // Fill all sensor trees, the entries of all trees belong to the same event as the entry of the event tree. Empty
+    // sensors only store the number of hits, their arrays have no elements.
     for(auto& item : sensors_) {
         item.second.tree->Fill();
-        LOG(TRACE) << "Wrote sensor event data for " << item.first;
     }
+    LOG(TRACE) << "Wrote sensor event data for " << sensors_with_hits_.size() << " sensors with hits";
+
+    // Reset the sensors with hits for the next event
+    for(auto* sensor : sensors_with_hits_) {
+        sensor->nhits_ = 0;
+    }
+    sensors_with_hits_.clear();
 }
 
 void RCEWriterModule::finalize() {
@@ -8,7 +8,9 @@
  */
 
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <TFile.h>
 #include <TTree.h>
@@ -74,8 +76,10 @@ namespace allpix {
             Int_t timing_[kMaxHits];
             Int_t hit_in_cluster_[kMaxHits];
         };
-        // The map from detector names to the respective sensor_data struct
-        std::map<std::string, sensor_data> sensors_;
+        // The map from detectors to the respective sensor_data struct
+        std::map<std::shared_ptr<const Detector>, sensor_data> sensors_;
+        // Sensors with hits in the current event, to be reset after filling the trees
+        std::vector<sensor_data*> sensors_with_hits_;
 
         // Relevant information for the Event tree
         ULong64_t timestamp_;
@@ -17,7 +17,9 @@
 #include <TKey.h>
 #include <TObjArray.h>
 #include <TProcessID.h>
+#include <TROOT.h>
 #include <TTree.h>
+#include <TTreeCacheUnzip.h>
 
 #include "core/messenger/Messenger.hpp"
 #include "core/utils/file.h"
@@ -46,16 +48,17 @@ ROOTObjectReaderModule::~ROOTObjectReaderModule() {
 
 /**
  * Adds lambda function map to convert a vector of generic objects to a templated message containing this particular type of
- * object from its typeid.
+ * object from its typeid. The contents of the objects read by ROOT are moved into a list recycled from earlier messages,
+ * as ROOT replaces the objects when reading the next entry anyway.
  */
 template <typename T> static void add_creator(ROOTObjectReaderModule::MessageCreatorMap& map) {
-    map[typeid(T)] = [&](std::vector<Object*> objects, std::shared_ptr<Detector> detector) {
-        std::vector<T> data;
+    map[typeid(T)] = [](std::vector<Object*>& objects, std::shared_ptr<Detector> detector) {
+        auto data = MessageStorage<T>::acquire();
         data.reserve(objects.size());
 
-        // Copy the objects to data vector
+        // Move the objects to data vector, the base object with its unique identifier and status bits is copied
         for(auto& object : objects) {
-            data.emplace_back(*static_cast<T*>(object));
+            data.emplace_back(std::move(*static_cast<T*>(object)));
         }
 
         // Fix the object references (NOTE: we do this after insertion as otherwise the objects could have been relocated)
@@ -113,6 +116,21 @@ void ROOTObjectReaderModule::init() {
         auto exc_arr = config_.getArray<std::string>("exclude");
         exclude_.insert(exc_arr.begin(), exc_arr.end());
     }
+    if(config_.has("detectors")) {
+        auto det_arr = config_.getArray<std::string>("detectors");
+        detectors_.insert(det_arr.begin(), det_arr.end());
+    }
+
+    // Decompress the baskets of the upcoming events in the background if requested
+    if(config_.get<bool>("parallel_unzip", false)) {
+#ifdef R__USE_IMT
+        ROOT::EnableImplicitMT();
+        TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kEnable);
+        LOG(DEBUG) << "Decompressing events in the background using " << ROOT::GetImplicitMTPoolSize() << " thread(s)";
+#else
+        LOG(WARNING) << "ROOT has been built without implicit multithreading, events are decompressed when read";
+#endif
+    }
 
     // Initialize the call map from the tuple of available objects
     message_creator_map_ = gen_creator_map<allpix::OBJECTS>();
@@ -194,12 +212,35 @@ void ROOTObjectReaderModule::init() {
                      << " - this might lead to unexpected behavior.";
     }
 
+    auto cache_size = config_.get<long long>("cache_size", 32 * 1024 * 1024);
+
     // Loop over all found trees
     for(auto& tree : trees_) {
+        // Enable the read-ahead cache, which is filled with the branches in use only
+        tree->SetCacheSize(cache_size);
+
         // Loop over the list of branches and create the set of receiver objects
         TObjArray* branches = tree->GetListOfBranches();
         for(int i = 0; i < branches->GetEntries(); i++) {
             auto* branch = static_cast<TBranch*>(branches->At(i));
+            std::string branch_name = branch->GetName();
+
+            // Disable reading of the branch and all its sub-branches if its detector has not been selected
+            if(!detectors_.empty()) {
+                auto detector_name = branch_name.substr(0, branch_name.find('_'));
+                if(detectors_.find(detector_name) == detectors_.end()) {
+                    LOG(TRACE) << "Disabling branch " << branch_name << " of tree " << tree->GetName()
+                               << " because its detector has not been selected";
+                    // NOTE Passing the number of found branches suppresses the error for branches without sub-branches
+                    unsigned int found = 0;
+                    tree->SetBranchStatus(branch_name.c_str(), false, &found);
+                    tree->SetBranchStatus((branch_name + ".*").c_str(), false, &found);
+                    continue;
+                }
+            }
+            if(cache_size > 0) {
+                tree->AddBranchToCache(branch, true);
+            }
 
             // Add a new vector of objects and bind it to the branch
             message_info message_inf;
@@ -209,7 +250,6 @@ void ROOTObjectReaderModule::init() {
 
             // Fill the rest of the message information
             // FIXME: we want to index this in a different way
-            std::string branch_name = branch->GetName();
             auto split = allpix::split<std::string>(branch_name, "_");
 
             // Fetch information from the tree name
@@ -250,6 +290,11 @@ void ROOTObjectReaderModule::init() {
                 }
             }
         }
+
+        // The branches to cache are known, no need to learn them from the first entries
+        if(cache_size > 0) {
+            tree->StopCacheLearningPhase();
+        }
     }
 }
 
@@ -265,7 +310,8 @@ void ROOTObjectReaderModule::run(unsigned int event_num) {
     LOG(TRACE) << "Building messages from stored objects";
 
     // Loop through all branches
-    for(const auto& message_inf : message_info_array_) {
+    std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>> messages;
+    for(auto& message_inf : message_info_array_) {
         auto objects = message_inf.objects;
 
         // Skip empty objects in current event
@@ -273,31 +319,40 @@ void ROOTObjectReaderModule::run(unsigned int event_num) {
             continue;
         }
 
-        // Check if a pointer to a dispatcher method exist
-        auto first_object = (*objects)[0];
-        auto iter = message_creator_map_.find(typeid(*first_object));
-        if(iter == message_creator_map_.end()) {
-            LOG(INFO) << "Cannot dispatch message with object " << allpix::demangle(typeid(*first_object).name())
-                      << " because it not registered for messaging";
-            continue;
+        // Check if a pointer to a dispatcher method exist, the type of the objects is the same for all entries of a branch
+        if(message_inf.creator == nullptr) {
+            auto first_object = (*objects)[0];
+            auto iter = message_creator_map_.find(typeid(*first_object));
+            if(iter == message_creator_map_.end()) {
+                LOG(INFO) << "Cannot dispatch message with object " << allpix::demangle(typeid(*first_object).name())
+                          << " because it not registered for messaging";
+                continue;
+            }
+            message_inf.creator = &iter->second;
         }
 
         // Update statistics
         read_cnt_ += objects->size();
 
         // Create a message
-        std::shared_ptr<BaseMessage> message = iter->second(*objects, message_inf.detector);
+        messages.emplace_back((*message_inf.creator)(*objects, message_inf.detector), message_inf.name);
+    }
 
-        // Dispatch the message
-        messenger_->dispatchMessage(this, message, message_inf.name);
+    // Restore the links between the objects after all objects of the event have been created
+    for(auto& message : messages) {
+        for(Object& object : message.first->getObjectArray()) {
+            object.loadHistory();
+        }
+    }
+
+    // Dispatch the messages
+    for(auto& message : messages) {
+        messenger_->dispatchMessage(this, message.first, message.second);
     }
 }
 
 void ROOTObjectReaderModule::finalize() {
-    int branch_count = 0;
-    for(auto& tree : trees_) {
-        branch_count += tree->GetListOfBranches()->GetEntries();
-    }
+    auto branch_count = message_info_array_.size();
 
     // Print statistics
     LOG(INFO) << "Read " << read_cnt_ << " objects from " << branch_count << " branches";
@@ -32,9 +32,8 @@ namespace allpix {
      */
     class ROOTObjectReaderModule : public Module {
     public:
-        using MessageCreatorMap =
-            std::map<std::type_index,
-                     std::function<std::shared_ptr<BaseMessage>(std::vector<Object*>, std::shared_ptr<Detector>)>>;
+        using MessageCreator = std::function<std::shared_ptr<BaseMessage>(std::vector<Object*>&, std::shared_ptr<Detector>)>;
+        using MessageCreatorMap = std::map<std::type_index, MessageCreator>;
 
         /**
          * @brief Constructor for this unique module
@@ -74,12 +73,17 @@ namespace allpix {
             std::vector<Object*>* objects;
             std::shared_ptr<Detector> detector;
             std::string name;
+            // Creator of the message for the type of objects in the branch, looked up with the first object read
+            const MessageCreator* creator{};
         };
 
         // Object names to include or exclude from reading
         std::set<std::string> include_;
         std::set<std::string> exclude_;
 
+        // Names of the detectors to read the objects for (all detectors if empty)
+        std::set<std::string> detectors_;
+
         // File containing the objects
         std::unique_ptr<TFile> input_file_;
 
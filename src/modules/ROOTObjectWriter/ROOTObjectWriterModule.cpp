@@ -9,12 +9,18 @@
 
 #include "ROOTObjectWriterModule.hpp"
 
+#include <algorithm>
 #include <fstream>
+#include <mutex>
 #include <string>
 #include <utility>
 
+#include <Compression.h>
+#include <RVersion.h>
 #include <TBranchElement.h>
 #include <TClass.h>
+#include <TProcessID.h>
+#include <TROOT.h>
 
 #include "core/config/ConfigReader.hpp"
 #include "core/utils/file.h"
@@ -26,6 +32,86 @@
 
 using namespace allpix;
 
+// Names of the columns written in columnar mode for an object, empty if the object type is not supported
+static std::vector<std::string> column_names(const Object& object) {
+    auto point = [](const std::string& name) { return std::vector<std::string>{name + "_x", name + "_y", name + "_z"}; };
+    auto join = [](std::vector<std::vector<std::string>> lists) {
+        std::vector<std::string> names;
+        for(auto& list : lists) {
+            names.insert(names.end(), list.begin(), list.end());
+        }
+        return names;
+    };
+
+    if(dynamic_cast<const SensorCharge*>(&object) != nullptr) {
+        return join({point("local"), point("global"), {"type", "charge", "time"}});
+    } else if(dynamic_cast<const PixelCharge*>(&object) != nullptr) {
+        return {"pixel_x", "pixel_y", "charge"};
+    } else if(dynamic_cast<const PixelHit*>(&object) != nullptr) {
+        return {"pixel_x", "pixel_y", "signal", "time"};
+    } else if(dynamic_cast<const MCParticle*>(&object) != nullptr) {
+        return join({point("local_start"),
+                     point("global_start"),
+                     point("local_end"),
+                     point("global_end"),
+                     {"particle_id", "time"}});
+    } else if(dynamic_cast<const MCTrack*>(&object) != nullptr) {
+        return join({point("start"),
+                     point("end"),
+                     {"particle_id",
+                      "creation_process_type",
+                      "kinetic_energy_initial",
+                      "total_energy_initial",
+                      "kinetic_energy_final",
+                      "total_energy_final"}});
+    }
+    return {};
+}
+
+// Append the properties of an object to the columns, in the order given by column_names
+static void append_columns(const Object& object, std::vector<std::vector<double>>& columns) {
+    size_t column = 0;
+    auto add = [&](double value) { columns[column++].push_back(value); };
+    auto add_point = [&](const ROOT::Math::XYZPoint& point) {
+        add(point.x());
+        add(point.y());
+        add(point.z());
+    };
+
+    if(const auto* charge = dynamic_cast<const SensorCharge*>(&object)) {
+        add_point(charge->getLocalPosition());
+        add_point(charge->getGlobalPosition());
+        add(static_cast<double>(charge->getType()));
+        add(charge->getCharge());
+        add(charge->getEventTime());
+    } else if(const auto* pixel_charge = dynamic_cast<const PixelCharge*>(&object)) {
+        add(pixel_charge->getIndex().x());
+        add(pixel_charge->getIndex().y());
+        add(pixel_charge->getCharge());
+    } else if(const auto* pixel_hit = dynamic_cast<const PixelHit*>(&object)) {
+        add(pixel_hit->getIndex().x());
+        add(pixel_hit->getIndex().y());
+        add(pixel_hit->getSignal());
+        add(pixel_hit->getTime());
+    } else if(const auto* particle = dynamic_cast<const MCParticle*>(&object)) {
+        add_point(particle->getLocalStartPoint());
+        add_point(particle->getGlobalStartPoint());
+        add_point(particle->getLocalEndPoint());
+        add_point(particle->getGlobalEndPoint());
+        add(particle->getParticleID());
+        add(particle->getTime());
+    } else if(const auto* track = dynamic_cast<const MCTrack*>(&object)) {
+        add_point(track->getStartPoint());
+        add_point(track->getEndPoint());
+        add(track->getParticleID());
+        add(track->getCreationProcessType());
+        add(track->getKineticEnergyInitial());
+        add(track->getTotalEnergyInitial());
+        add(track->getKineticEnergyFinal());
+        add(track->getTotalEnergyFinal());
+    }
+}
+
 ROOTObjectWriterModule::ROOTObjectWriterModule(Configuration& config, Messenger* messenger, GeometryManager* geo_mgr)
     : Module(config), geo_mgr_(geo_mgr) {
     // Bind to all messages
@@ -35,10 +121,140 @@ ROOTObjectWriterModule::ROOTObjectWriterModule(Configuration& config, Messenger*
  * @note Objects cannot be stored in smart pointers due to internal ROOT logic
  */
 ROOTObjectWriterModule::~ROOTObjectWriterModule() {
+    // Stop the writer threads if the module has not been finalized
+    stop_writer(main_output_);
+    for(auto& split_output : split_outputs_) {
+        stop_writer(*split_output.second);
+    }
+
     // Delete all object pointers
-    for(auto& index_data : write_list_) {
+    for(auto& index_data : main_output_.write_list) {
         delete index_data.second;
     }
+    for(auto& split_output : split_outputs_) {
+        for(auto& index_data : split_output.second->write_list) {
+            delete index_data.second;
+        }
+    }
+}
+
+std::string ROOTObjectWriterModule::class_name(const Object& object) {
+    // Remove the allpix prefix
+    std::string class_name = TClass::GetClass(typeid(object))->GetName();
+    std::string apx_namespace = "allpix::";
+    size_t ap_idx = class_name.find(apx_namespace);
+    if(ap_idx != std::string::npos) {
+        class_name.replace(ap_idx, apx_namespace.size(), "");
+    }
+    return class_name;
+}
+
+/**
+ * Messages of a type always hold objects of the same class, such that the object name only has to be determined for the
+ * first message of every type. Messages without objects cannot be resolved, for which a null pointer is returned.
+ */
+const ROOTObjectWriterModule::TypeRoute* ROOTObjectWriterModule::get_type_route(BaseMessage& message) {
+    auto route = type_routes_.find(typeid(message));
+    if(route != type_routes_.end()) {
+        return &route->second;
+    }
+    if(message.getObjectCount() == 0) {
+        return nullptr;
+    }
+    TypeRoute new_route;
+    new_route.class_name = class_name(message.getObject(0));
+    new_route.selected = is_selected(new_route.class_name);
+
+    // Resolve the prescale of the objects and their role in the trigger
+    auto prescale = prescales_.find(new_route.class_name);
+    if(prescale != prescales_.end()) {
+        new_route.prescale = prescale->second;
+    }
+    if(!trigger_objects_.empty()) {
+        new_route.trigger = (trigger_objects_.find(new_route.class_name) != trigger_objects_.end());
+        if(triggered_objects_.empty()) {
+            new_route.triggered = !new_route.trigger;
+        } else {
+            new_route.triggered = (triggered_objects_.find(new_route.class_name) != triggered_objects_.end());
+        }
+    }
+    return &type_routes_.emplace(typeid(message), std::move(new_route)).first->second;
+}
+
+bool ROOTObjectWriterModule::is_selected(const std::string& class_name) const {
+    return (include_.empty() || include_.find(class_name) != include_.end()) &&
+           (exclude_.empty() || exclude_.find(class_name) == exclude_.end());
+}
+
+/**
+ * Objects with a prescale of n are only kept in the first event and every n-th event after it. An event is triggered if it
+ * contains at least one object of the trigger objects, without a trigger the triggered objects are removed. If no triggered
+ * objects are given, all objects except the trigger objects themselves are only written in triggered events. Removed
+ * messages are released right away, the trees are still filled with empty entries to keep the event indexing.
+ */
+void ROOTObjectWriterModule::apply_prescales(MessageList& messages, unsigned int event_num) {
+    // Get the route of every message, messages without objects are not written anyway
+    std::vector<const TypeRoute*> routes;
+    routes.reserve(messages.size());
+    bool triggered = false;
+    for(auto& message : messages) {
+        const TypeRoute* route = nullptr;
+        try {
+            if(message.first->getObjectCount() > 0) {
+                route = get_type_route(*message.first);
+            }
+        } catch(MessageWithoutObjectException&) {
+        }
+        triggered = triggered || (route != nullptr && route->trigger);
+        routes.push_back(route);
+    }
+
+    MessageList selected;
+    selected.reserve(messages.size());
+    for(size_t idx = 0; idx < messages.size(); ++idx) {
+        const auto* route = routes[idx];
+        if(route != nullptr) {
+            bool keep = (route->prescale <= 1 || (event_num - 1) % route->prescale == 0);
+            if(!triggered && route->triggered) {
+                keep = false;
+            }
+            if(!keep) {
+                LOG(TRACE) << "ROOT object writer skipped message with object " << route->class_name << " in event "
+                           << event_num;
+                skipped_cnt_ += messages[idx].first->getObjectCount();
+                continue;
+            }
+        }
+        selected.push_back(std::move(messages[idx]));
+    }
+    messages.swap(selected);
+}
+
+void ROOTObjectWriterModule::set_compression(TFile* file) {
+    if(config_.has("compression_algorithm")) {
+        auto algorithm = config_.get<std::string>("compression_algorithm");
+        std::transform(algorithm.begin(), algorithm.end(), algorithm.begin(), ::tolower);
+        if(algorithm == "zlib") {
+            file->SetCompressionAlgorithm(ROOT::kZLIB);
+        } else if(algorithm == "lzma") {
+            file->SetCompressionAlgorithm(ROOT::kLZMA);
+        } else if(algorithm == "lz4") {
+            file->SetCompressionAlgorithm(ROOT::kLZ4);
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 20, 0)
+        } else if(algorithm == "zstd") {
+            file->SetCompressionAlgorithm(ROOT::RCompressionSetting::EAlgorithm::kZSTD);
+#endif
+        } else {
+            throw InvalidValueError(config_, "compression_algorithm", "unknown or unsupported compression algorithm");
+        }
+    }
+    if(config_.has("compression_level")) {
+        auto level = config_.get<int>("compression_level");
+        if(level < 0 || level > 9) {
+            throw InvalidValueError(config_, "compression_level", "compression level should be between 0 and 9");
+        }
+        file->SetCompressionLevel(level);
+    }
 }
 
 void ROOTObjectWriterModule::init() {
@@ -47,6 +263,33 @@ void ROOTObjectWriterModule::init() {
         createOutputFile(allpix::add_file_extension(config_.get<std::string>("file_name", "data"), "root"), true);
     output_file_ = std::make_unique<TFile>(output_file_name_.c_str(), "RECREATE");
     output_file_->cd();
+    main_output_.file = output_file_.get();
+    main_output_.name = output_file_name_;
+
+    // Set the compression of the output file if requested
+    set_compression(output_file_.get());
+
+    // Read the output mode and the size of the buffers of the branches
+    auto mode = config_.get<std::string>("output_mode", "objects");
+    if(mode == "columnar") {
+        columnar_ = true;
+    } else if(mode != "objects") {
+        throw InvalidValueError(config_, "output_mode", "output mode should be either 'objects' or 'columnar'");
+    }
+    basket_size_ = config_.get<int>("basket_size", 32000);
+    if(basket_size_ <= 0) {
+        throw InvalidValueError(config_, "basket_size", "basket size should be strictly positive");
+    }
+
+    // Read if the objects are split over separate files
+    auto split_files = config_.get<std::string>("split_files", "none");
+    if(split_files == "detector") {
+        split_by_detector_ = true;
+    } else if(split_files == "object") {
+        split_by_object_ = true;
+    } else if(split_files != "none") {
+        throw InvalidValueError(config_, "split_files", "split of the files should be 'none', 'detector' or 'object'");
+    }
 
     // Read include and exclude list
     if(config_.has("include") && config_.has("exclude")) {
@@ -58,100 +301,254 @@ void ROOTObjectWriterModule::init() {
         auto exc_arr = config_.getArray<std::string>("exclude");
         exclude_.insert(exc_arr.begin(), exc_arr.end());
     }
+
+    // Read the prescales of the object names
+    if(config_.has("prescale")) {
+        for(auto& entry : config_.getMatrix<std::string>("prescale")) {
+            if(entry.size() != 2) {
+                throw InvalidValueError(config_, "prescale", "every entry should consist of an object name and a prescale");
+            }
+            int prescale = 0;
+            try {
+                prescale = allpix::from_string<int>(entry[1]);
+            } catch(std::invalid_argument&) {
+            }
+            if(prescale <= 0) {
+                throw InvalidValueError(
+                    config_, "prescale", "prescale of " + entry[0] + " should be a strictly positive integer");
+            }
+            prescales_[entry[0]] = static_cast<unsigned int>(prescale);
+            LOG(DEBUG) << "Writing objects of " << entry[0] << " only every " << prescale << " events";
+        }
+    }
+
+    // Read the objects triggering an event and the objects only written in triggered events
+    if(config_.has("trigger_objects")) {
+        auto trigger_arr = config_.getArray<std::string>("trigger_objects");
+        trigger_objects_.insert(trigger_arr.begin(), trigger_arr.end());
+        if(config_.has("triggered_objects")) {
+            auto triggered_arr = config_.getArray<std::string>("triggered_objects");
+            triggered_objects_.insert(triggered_arr.begin(), triggered_arr.end());
+        }
+    } else if(config_.has("triggered_objects")) {
+        throw InvalidValueError(config_, "triggered_objects", "objects can only be triggered if trigger_objects is set");
+    }
+
+    // Start the thread writing the events in the background if requested
+    asynchronous_ = config_.get<bool>("asynchronous_writing", true);
+    if(asynchronous_) {
+        write_queue_size_ = config_.get<size_t>("write_queue_size", 4);
+        if(write_queue_size_ == 0) {
+            throw InvalidValueError(config_, "write_queue_size", "size of the write queue should be strictly positive");
+        }
+
+        // The objects are streamed while the next events are simulated, so ROOT has to protect its global state
+        ROOT::EnableThreadSafety();
+        if(!split_by_detector_ && !split_by_object_) {
+            start_writer(main_output_);
+        }
+    }
 }
 
+void ROOTObjectWriterModule::start_writer(OutputFile& output) {
+    auto log_level = Log::getReportingLevel();
+    auto log_format = Log::getFormat();
+    auto log_section = Log::getSection();
+    output.writer_thread = std::thread([this, &output, log_level, log_format, log_section]() {
+        Log::setReportingLevel(log_level);
+        Log::setFormat(log_format);
+        Log::setSection(log_section);
+        write_loop(output);
+    });
+}
+
+/**
+ * The messages are only processed when the event is written, which might happen on the writer thread. Until then they are
+ * kept alive to ensure the objects they contain remain valid.
+ */
 void ROOTObjectWriterModule::receive(std::shared_ptr<BaseMessage> message, std::string message_name) { // NOLINT
+    event_messages_.emplace_back(std::move(message), std::move(message_name));
+}
+
+/**
+ * Files are created when the first message for them is received. The new file is marked as having written all previous
+ * events, such that its trees are pre-filled with empty events and all files share the same event indexing.
+ */
+ROOTObjectWriterModule::OutputFile* ROOTObjectWriterModule::get_split_file(const std::shared_ptr<BaseMessage>& message) {
+    std::string key;
     try {
-        const BaseMessage* inst = message.get();
-        std::string name_str = " without a name";
-        if(!message_name.empty()) {
-            name_str = " named " + message_name;
+        auto* route = get_type_route(*message);
+        if(route == nullptr || !route->selected) {
+            return nullptr;
         }
-        LOG(TRACE) << "ROOT object writer received " << allpix::demangle(typeid(*inst).name()) << name_str;
-
-        // Get the detector name
-        std::string detector_name;
-        if(message->getDetector() != nullptr) {
-            detector_name = message->getDetector()->getName();
+        if(split_by_object_) {
+            key = route->class_name;
+        } else {
+            key = (message->getDetector() != nullptr ? message->getDetector()->getName() : "global");
         }
+    } catch(MessageWithoutObjectException&) {
+        return nullptr;
+    }
 
-        // Read the object
-        auto object_array = message->getObjectArray();
-        if(!object_array.empty()) {
-            keep_messages_.push_back(message);
+    auto iter = split_outputs_.find(key);
+    if(iter != split_outputs_.end()) {
+        return iter->second.get();
+    }
 
-            const Object& first_object = object_array[0];
-            std::type_index type_idx = typeid(first_object);
+    auto base_name = config_.get<std::string>("file_name", "data");
+    auto file_name = createOutputFile(allpix::add_file_extension(base_name + "_" + key, "root"), true);
+    LOG(DEBUG) << "Creating data file " << file_name << " for objects of " << key;
+    split_files_.push_back(std::make_unique<TFile>(file_name.c_str(), "RECREATE"));
+    set_compression(split_files_.back().get());
+
+    auto output = std::make_unique<OutputFile>();
+    output->file = split_files_.back().get();
+    output->name = file_name;
+    output->last_event = static_cast<unsigned int>(event_numbers_.size());
+    auto* output_ptr = output.get();
+    split_outputs_.emplace(key, std::move(output));
+    if(asynchronous_) {
+        start_writer(*output_ptr);
+    }
+    return output_ptr;
+}
 
-            // Create a new branch of the correct type if this message was not received before
-            auto index_tuple = std::make_tuple(type_idx, detector_name, message_name);
-            if(write_list_.find(index_tuple) == write_list_.end()) {
+/**
+ * The branch of a message is only looked up when a message with the same type, detector and name is first received. The
+ * returned slot points into the write list or the column list, which are never erased from while the file is written.
+ */
+ROOTObjectWriterModule::Slot ROOTObjectWriterModule::create_slot(OutputFile& output,
+                                                                 BaseMessage& message,
+                                                                 const std::string& message_name) {
+    // Get the detector name
+    std::string detector_name;
+    if(message.getDetector() != nullptr) {
+        detector_name = message.getDetector()->getName();
+    }
 
-                auto* cls = TClass::GetClass(typeid(first_object));
+    const Object& first_object = message.getObject(0);
+    std::type_index type_idx = typeid(first_object);
+    auto index_tuple = std::make_tuple(type_idx, detector_name, message_name);
+    auto* cls = TClass::GetClass(typeid(first_object));
+    auto class_name = ROOTObjectWriterModule::class_name(first_object);
+
+    // Check if this message should be kept
+    if(!is_selected(class_name)) {
+        LOG(TRACE) << "ROOT object writer ignores messages with object " << allpix::demangle(typeid(message).name())
+                   << " because it has been excluded or not explicitly included";
+        return Slot();
+    }
 
-                // Remove the allpix prefix
-                std::string class_name = cls->GetName();
-                std::string apx_namespace = "allpix::";
-                size_t ap_idx = class_name.find(apx_namespace);
-                if(ap_idx != std::string::npos) {
-                    class_name.replace(ap_idx, apx_namespace.size(), "");
-                }
+    // Check if the object can be written as columns
+    auto names = (columnar_ ? column_names(first_object) : std::vector<std::string>());
+    if(columnar_ && names.empty()) {
+        LOG(WARNING) << "ROOT object writer cannot write objects of type " << class_name
+                     << " in columnar mode, ignoring message";
+        return Slot();
+    }
 
-                // Check if this message should be kept
-                if((!include_.empty() && include_.find(class_name) == include_.end()) ||
-                   (!exclude_.empty() && exclude_.find(class_name) != exclude_.end())) {
-                    LOG(TRACE) << "ROOT object writer ignored message with object " << allpix::demangle(typeid(*inst).name())
-                               << " because it has been excluded or not explicitly included";
-                    return;
-                }
+    auto& trees = output.trees;
+    auto new_tree = (trees.find(class_name) == trees.end());
+    if(new_tree) {
+        // Create new tree
+        output.file->cd();
+        trees.emplace(class_name,
+                      std::make_unique<TTree>(class_name.c_str(), (std::string("Tree of ") + class_name).c_str()));
+    }
 
-                // Add vector of objects to write to the write list
-                write_list_[index_tuple] = new std::vector<Object*>();
-                auto addr = &write_list_[index_tuple];
-
-                auto new_tree = (trees_.find(class_name) == trees_.end());
-                if(new_tree) {
-                    // Create new tree
-                    output_file_->cd();
-                    trees_.emplace(
-                        class_name,
-                        std::make_unique<TTree>(class_name.c_str(), (std::string("Tree of ") + class_name).c_str()));
-                }
+    std::string branch_name = detector_name.empty() ? "global" : detector_name;
+    if(!message_name.empty()) {
+        branch_name += "_";
+        branch_name += message_name;
+    }
 
-                std::string branch_name = detector_name.empty() ? "global" : detector_name;
-                if(!message_name.empty()) {
-                    branch_name += "_";
-                    branch_name += message_name;
-                }
+    Slot slot;
+    std::vector<TBranch*> branches;
+    if(columnar_) {
+        // Add a branch with a flat array per column, the columns are never resized after creation
+        auto& columns = output.column_list[index_tuple];
+        columns.resize(names.size());
+        for(size_t i = 0; i < names.size(); ++i) {
+            branches.push_back(trees[class_name]->Branch((branch_name + "_" + names[i]).c_str(), &columns[i], basket_size_));
+        }
+        slot.columns = &columns;
+    } else {
+        // Add vector of objects to write to the write list
+        output.write_list[index_tuple] = new std::vector<Object*>();
+        auto addr = &output.write_list[index_tuple];
+
+        auto class_type = std::string("std::vector<") + cls->GetName() + "*>";
+        branches.push_back(trees[class_name]->Bronch(branch_name.c_str(), class_type.c_str(), addr, basket_size_));
+        slot.objects = output.write_list[index_tuple];
+    }
 
-                trees_[class_name]->Bronch(
-                    branch_name.c_str(), (std::string("std::vector<") + cls->GetName() + "*>").c_str(), addr);
-
-                // Prefill new tree or new branch with empty records for all events that were missed since the start
-                if(last_event_ > 0) {
-                    if(new_tree) {
-                        LOG(DEBUG) << "Pre-filling new tree of " << class_name << " with " << last_event_ << " empty events";
-                        for(unsigned int i = 0; i < last_event_; ++i) {
-                            trees_[class_name]->Fill();
-                        }
-                    } else {
-                        LOG(DEBUG) << "Pre-filling new branch " << branch_name << " of " << class_name << " with "
-                                   << last_event_ << " empty events";
-                        auto* branch = trees_[class_name]->GetBranch(branch_name.c_str());
-                        for(unsigned int i = 0; i < last_event_; ++i) {
-                            branch->Fill();
-                        }
-                    }
+    // Prefill new tree or new branch with empty records for all events that were missed since the start
+    if(output.last_event > 0) {
+        if(new_tree) {
+            LOG(DEBUG) << "Pre-filling new tree of " << class_name << " with " << output.last_event << " empty events";
+            for(unsigned int i = 0; i < output.last_event; ++i) {
+                trees[class_name]->Fill();
+            }
+        } else {
+            LOG(DEBUG) << "Pre-filling new branch " << branch_name << " of " << class_name << " with "
+                       << output.last_event << " empty events";
+            for(auto* branch : branches) {
+                for(unsigned int i = 0; i < output.last_event; ++i) {
+                    branch->Fill();
                 }
             }
+        }
+    }
+    return slot;
+}
 
-            // Fill the branch vector
-            for(Object& object : object_array) {
+size_t ROOTObjectWriterModule::RouteKeyHash::operator()(const RouteKey& key) const {
+    auto hash = std::get<0>(key).hash_code();
+    hash ^= std::hash<const Detector*>()(std::get<1>(key)) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    hash ^= std::hash<std::string>()(std::get<2>(key)) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+void ROOTObjectWriterModule::write_message(OutputFile& output,
+                                           const std::shared_ptr<BaseMessage>& message,
+                                           const std::string& message_name) {
+    try {
+        const BaseMessage* inst = message.get();
+        LOG(TRACE) << "ROOT object writer received " << allpix::demangle(typeid(*inst).name())
+                   << (message_name.empty() ? std::string(" without a name") : " named " + message_name);
+
+        auto object_count = message->getObjectCount();
+        if(object_count == 0) {
+            return;
+        }
+
+        // Find the slot of the message, which is only created when its type, detector and name are first received
+        RouteKey key(typeid(*inst), message->getDetector().get(), message_name);
+        auto slot_iter = output.slots.find(key);
+        if(slot_iter == output.slots.end()) {
+            slot_iter = output.slots.emplace(std::move(key), create_slot(output, *message, message_name)).first;
+        }
+        const auto& slot = slot_iter->second;
+
+        // Fill the branch vector or columns
+        if(slot.columns != nullptr) {
+            for(size_t i = 0; i < object_count; ++i) {
+                ++write_cnt_;
+                append_columns(message->getObject(i), *slot.columns);
+            }
+        } else if(slot.objects != nullptr) {
+            // The links of split files are converted when the event is distributed over the files
+            bool petrify = (!split_by_detector_ && !split_by_object_);
+            slot.objects->reserve(slot.objects->size() + object_count);
+            for(size_t i = 0; i < object_count; ++i) {
+                auto& object = message->getObject(i);
                 ++write_cnt_;
-                write_list_[index_tuple]->push_back(&object);
+                if(petrify) {
+                    object.petrifyHistory();
+                }
+                slot.objects->push_back(&object);
             }
         }
-
     } catch(MessageWithoutObjectException& e) {
         const BaseMessage* inst = message.get();
         LOG(WARNING) << "ROOT object writer cannot process message of type" << allpix::demangle(typeid(*inst).name())
@@ -159,36 +556,203 @@ void ROOTObjectWriterModule::receive(std::shared_ptr<BaseMessage> message, std::
     }
 }
 
-void ROOTObjectWriterModule::run(unsigned int event) {
-    LOG(TRACE) << "Writing new objects to tree";
-    output_file_->cd();
+/**
+ * If the objects are split over separate files, the messages of the event are distributed over the files, and every file
+ * receives an event even without messages such that the trees of all files are filled for every event. The links between
+ * the objects are converted here for all files together, as the unique identifiers of the referenced objects are shared.
+ */
+void ROOTObjectWriterModule::run(unsigned int event_num) {
+    MessageList messages;
+    messages.swap(event_messages_);
 
-    // Save last event number for trees created later
-    last_event_ = event;
+    // Drop the objects not written in this event because of their prescale or a missing trigger
+    if(!prescales_.empty() || !trigger_objects_.empty()) {
+        apply_prescales(messages, event_num);
+    }
+
+    if(!split_by_detector_ && !split_by_object_) {
+        queue_event(main_output_, std::move(messages));
+        return;
+    }
+
+    std::map<OutputFile*, MessageList> file_messages;
+    for(auto& split_output : split_outputs_) {
+        file_messages[split_output.second.get()];
+    }
+    auto save_id = TProcessID::GetObjectCount();
+    for(auto& message : messages) {
+        auto* output = get_split_file(message.first);
+        if(output == nullptr) {
+            continue;
+        }
+        if(!columnar_) {
+            for(Object& object : message.first->getObjectArray()) {
+                object.petrifyHistory();
+            }
+        }
+        file_messages[output].push_back(std::move(message));
+    }
+    TProcessID::SetObjectCount(save_id);
+    event_numbers_.push_back(event_num);
+
+    for(auto& output_messages : file_messages) {
+        queue_event(*output_messages.first, std::move(output_messages.second));
+    }
+}
+
+/**
+ * If writing asynchronously, the event is queued for the writer thread and this method only blocks if the queue is full.
+ * The number of times the queue was full and the time spent waiting for the writer thread are added to the statistics.
+ */
+void ROOTObjectWriterModule::queue_event(OutputFile& output, MessageList messages) {
+    if(!output.writer_thread.joinable()) {
+        write_event(output, messages);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(output.queue_mutex);
+    if(output.write_queue.size() >= write_queue_size_ && !output.writer_exception) {
+        LOG(TRACE) << "Write queue is full, waiting for writer thread";
+        ++write_queue_full_;
+        ScopedTimer timer(write_wait_time_);
+        output.queue_condition.wait(
+            lock, [this, &output]() { return output.write_queue.size() < write_queue_size_ || output.writer_exception; });
+    }
+    if(output.writer_exception) {
+        std::rethrow_exception(output.writer_exception);
+    }
+    output.write_queue.push(std::move(messages));
+    output.queue_condition.notify_all();
+}
+
+/**
+ * The links between the objects are only converted to TRef objects here if the objects are written to a single file. The
+ * object count of ROOT is reset after every event, such that the unique identifiers of the referenced objects restart for
+ * every event.
+ */
+void ROOTObjectWriterModule::write_event(OutputFile& output, MessageList& messages) {
+    auto save_id = TProcessID::GetObjectCount();
+    for(auto& message : messages) {
+        write_message(output, message.first, message.second);
+    }
+
+    LOG(TRACE) << "Writing new objects to tree";
+    output.file->cd();
 
     // Fill the tree with the current received messages
-    for(auto& tree : trees_) {
+    for(auto& tree : output.trees) {
         tree.second->Fill();
     }
 
+    // Save number of written events for trees created later
+    ++output.last_event;
+
     // Clear the current message list
-    for(auto& index_data : write_list_) {
+    for(auto& index_data : output.write_list) {
         index_data.second->clear();
     }
-    // Clear the messages we have to keep because they contain the internal pointers
-    keep_messages_.clear();
+    for(auto& index_columns : output.column_list) {
+        for(auto& column : index_columns.second) {
+            column.clear();
+        }
+    }
+    // Release the messages, which contain the objects referred to by the write list
+    messages.clear();
+
+    // Reset object count for the next event
+    if(!split_by_detector_ && !split_by_object_) {
+        TProcessID::SetObjectCount(save_id);
+    }
+}
+
+void ROOTObjectWriterModule::write_loop(OutputFile& output) {
+    try {
+        while(true) {
+            MessageList messages;
+            {
+                std::unique_lock<std::mutex> lock(output.queue_mutex);
+                output.queue_condition.wait(lock, [&output]() { return !output.write_queue.empty() || output.finished; });
+                if(output.write_queue.empty()) {
+                    return;
+                }
+                messages = std::move(output.write_queue.front());
+                output.write_queue.pop();
+            }
+            output.queue_condition.notify_all();
+
+            write_event(output, messages);
+        }
+    } catch(...) {
+        std::lock_guard<std::mutex> lock(output.queue_mutex);
+        output.writer_exception = std::current_exception();
+        output.queue_condition.notify_all();
+    }
+}
+
+void ROOTObjectWriterModule::stop_writer(OutputFile& output) {
+    if(!output.writer_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(output.queue_mutex);
+        output.finished = true;
+    }
+    output.queue_condition.notify_all();
+    output.writer_thread.join();
 }
 
 void ROOTObjectWriterModule::finalize() {
+    // Write all queued events before storing the remaining information
+    LOG(TRACE) << "Waiting for writer threads to write all remaining events";
+    stop_writer(main_output_);
+    for(auto& split_output : split_outputs_) {
+        stop_writer(*split_output.second);
+    }
+    if(main_output_.writer_exception) {
+        std::rethrow_exception(main_output_.writer_exception);
+    }
+    for(auto& split_output : split_outputs_) {
+        if(split_output.second->writer_exception) {
+            std::rethrow_exception(split_output.second->writer_exception);
+        }
+    }
+
     LOG(TRACE) << "Writing objects to file";
     output_file_->cd();
 
     int branch_count = 0;
-    for(auto& tree : trees_) {
+    for(auto& tree : main_output_.trees) {
         // Update statistics
         branch_count += tree.second->GetListOfBranches()->GetEntries();
     }
 
+    // Tie the separate files together with an index tree holding the trees of all files as friends
+    std::unique_ptr<TTree> index_tree;
+    if(split_by_detector_ || split_by_object_) {
+        index_tree = std::make_unique<TTree>("Index", "Index of the events in the separate data files");
+        unsigned int event_number = 0;
+        index_tree->Branch("event", &event_number);
+        for(auto number : event_numbers_) {
+            event_number = number;
+            index_tree->Fill();
+        }
+        index_tree->ResetBranchAddresses();
+
+        for(auto& split_output : split_outputs_) {
+            auto& output = *split_output.second;
+            output.file->cd();
+            for(auto& tree : output.trees) {
+                branch_count += tree.second->GetListOfBranches()->GetEntries();
+                // Friends of objects split by type are named after the type, otherwise after the detector and the type
+                auto alias = (split_by_object_ ? tree.first : split_output.first + "_" + tree.first);
+                index_tree->AddFriend(tree.second.get(), alias.c_str());
+            }
+            output.file->Write();
+            LOG(INFO) << "Wrote objects of " << split_output.first << " to file " << output.name;
+        }
+        output_file_->cd();
+    }
+
     // Create main config directory
     TDirectory* config_dir = output_file_->mkdir("config");
     config_dir->cd();
@@ -268,6 +832,9 @@ void ROOTObjectWriterModule::finalize() {
     output_file_->Write();
 
     // Print statistics
+    if(skipped_cnt_ > 0) {
+        LOG(INFO) << "Skipped " << skipped_cnt_ << " objects because of their prescale or a missing trigger";
+    }
     LOG(STATUS) << "Wrote " << write_cnt_ << " objects to " << branch_count << " branches in file:" << std::endl
                 << output_file_name_;
 }
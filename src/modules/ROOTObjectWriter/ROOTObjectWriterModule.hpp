@@ -7,8 +7,19 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <atomic>
+#include <condition_variable>
+#include <exception>
 #include <map>
+#include <mutex>
+#include <queue>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <TFile.h>
 #include <TTree.h>
@@ -25,7 +36,9 @@ namespace allpix {
      *
      * Listens to all objects dispatched in the framework. Creates a tree as soon as a new type of object is encountered and
      * saves the data in those objects to tree for every event. The tree name is the class name of the object. A separate
-     * branch is created for every combination of detector name and message name that outputs this object.
+     * branch is created for every combination of detector name and message name that outputs this object. In columnar mode
+     * the objects are not stored themselves, instead every property of the objects is stored in a separate branch holding
+     * a flat array of numbers per event.
      */
     class ROOTObjectWriterModule : public Module {
     public:
@@ -65,28 +78,197 @@ namespace allpix {
         void finalize() override;
 
     private:
+        using MessageList = std::vector<std::pair<std::shared_ptr<BaseMessage>, std::string>>;
+        using ObjectIndex = std::tuple<std::type_index, std::string, std::string>;
+        using RouteKey = std::tuple<std::type_index, const Detector*, std::string>;
+
+        /**
+         * @brief Hash of the type, the detector and the name of a message
+         */
+        struct RouteKeyHash {
+            size_t operator()(const RouteKey& key) const;
+        };
+
+        /**
+         * @brief Object name and selection of a type of message, resolved when the type is first received
+         */
+        struct TypeRoute {
+            std::string class_name;
+            bool selected{false};
+            unsigned int prescale{1};
+            bool trigger{false};
+            bool triggered{false};
+        };
+
+        /**
+         * @brief Objects or columns of the branch the objects of a message are added to, both null if they are not written
+         */
+        struct Slot {
+            std::vector<Object*>* objects{nullptr};
+            std::vector<std::vector<double>>* columns{nullptr};
+        };
+
+        /**
+         * @brief Data file with its trees, filled by its own writer thread when writing asynchronously
+         */
+        struct OutputFile {
+            TFile* file{nullptr};
+            std::string name;
+
+            // Number of events written
+            unsigned int last_event{0};
+
+            // List of trees that are stored in data file
+            std::map<std::string, std::unique_ptr<TTree>> trees;
+
+            // List of objects of a particular type, bound to a specific detector and having a particular name
+            std::map<ObjectIndex, std::vector<Object*>*> write_list;
+            // List of columns for a particular type of object, bound to a specific detector and having a particular name
+            std::map<ObjectIndex, std::vector<std::vector<double>>> column_list;
+            // Slot of every combination of message type, detector and message name received so far
+            std::unordered_map<RouteKey, Slot, RouteKeyHash> slots;
+
+            // Queue of events to be written by the writer thread, which owns the trees while it is running
+            std::thread writer_thread;
+            std::queue<MessageList> write_queue;
+            std::mutex queue_mutex;
+            std::condition_variable queue_condition;
+            bool finished{false};
+            std::exception_ptr writer_exception;
+        };
+
+        /**
+         * @brief Get the class name of an object without the allpix prefix
+         * @param object Object to get the class name of
+         * @return Name of the class
+         */
+        static std::string class_name(const Object& object);
+
+        /**
+         * @brief Check if objects of a class should be written according to the include and exclude lists
+         * @param class_name Name of the class without the allpix prefix
+         * @return True if the objects should be written, false otherwise
+         */
+        bool is_selected(const std::string& class_name) const;
+
+        /**
+         * @brief Get the object name, the selection and the prescale of the objects of a message
+         * @param message Message received in the event
+         * @return Route of the type of the message, or a null pointer if it cannot be resolved because it has no objects
+         */
+        const TypeRoute* get_type_route(BaseMessage& message);
+
+        /**
+         * @brief Remove the messages of an event whose objects are not written because of their prescale or the trigger
+         * @param messages List of messages of the event
+         * @param event_num Number of the event
+         */
+        void apply_prescales(MessageList& messages, unsigned int event_num);
+
+        /**
+         * @brief Set the compression of a data file as configured
+         * @param file File to configure
+         */
+        void set_compression(TFile* file);
+
+        /**
+         * @brief Get the data file the objects of a message are written to, creating it if it does not exist yet
+         * @param message Message received in the event
+         * @return Data file for the objects of the message, or a null pointer if they are not written
+         */
+        OutputFile* get_split_file(const std::shared_ptr<BaseMessage>& message);
+
+        /**
+         * @brief Start the writer thread of a data file
+         * @param output File to write asynchronously
+         */
+        void start_writer(OutputFile& output);
+
+        /**
+         * @brief Pass the messages of an event to the writer of a data file, waiting if its queue is full
+         * @param output File to write the messages to
+         * @param messages List of messages of the event
+         */
+        void queue_event(OutputFile& output, MessageList messages);
+
+        /**
+         * @brief Add the objects of a message to the branches of the current event, creating new branches if needed
+         * @param output File to write the objects to
+         * @param message Message received in the event
+         * @param message_name Name of the message
+         */
+        void write_message(OutputFile& output, const std::shared_ptr<BaseMessage>& message, const std::string& message_name);
+
+        /**
+         * @brief Create the branch for the objects of a message which is received for the first time
+         * @param output File to write the objects to
+         * @param message First message with this type, detector and name, holding at least one object
+         * @param message_name Name of the message
+         * @return Slot of the branch, which is empty if the objects are not written
+         */
+        Slot create_slot(OutputFile& output, BaseMessage& message, const std::string& message_name);
+
+        /**
+         * @brief Fill the trees with all messages received in a single event
+         * @param output File to write the event to
+         * @param messages List of messages of the event, released after writing
+         */
+        void write_event(OutputFile& output, MessageList& messages);
+
+        /**
+         * @brief Write the queued events until the writer is stopped, executed by the writer thread
+         * @param output File written by the thread
+         */
+        void write_loop(OutputFile& output);
+
+        /**
+         * @brief Write the remaining queued events and stop the writer thread (if running)
+         * @param output File written by the thread
+         */
+        void stop_writer(OutputFile& output);
+
         GeometryManager* geo_mgr_;
 
+        // Write flat arrays of the object properties instead of the objects
+        bool columnar_{false};
+        int basket_size_{};
+
         // Object names to include or exclude from writing
         std::set<std::string> include_;
         std::set<std::string> exclude_;
 
-        // Output data file to write
+        // Object names written only for every n-th event, and object names written only in events with a trigger object
+        std::map<std::string, unsigned int> prescales_;
+        std::set<std::string> trigger_objects_;
+        std::set<std::string> triggered_objects_;
+
+        // Output data file to write, holding the objects unless they are split over separate files
         std::unique_ptr<TFile> output_file_;
         std::string output_file_name_{};
+        OutputFile main_output_;
+
+        // Separate data files for every detector or object type, the files are declared first to close them last
+        bool split_by_detector_{false};
+        bool split_by_object_{false};
+        std::vector<std::unique_ptr<TFile>> split_files_;
+        std::map<std::string, std::unique_ptr<OutputFile>> split_outputs_;
+        std::vector<unsigned int> event_numbers_;
 
-        // Last event processed
-        unsigned int last_event_{0};
+        // List of messages received in the current event
+        MessageList event_messages_;
+        // Route of every message type received so far, only used when distributing the events
+        std::unordered_map<std::type_index, TypeRoute> type_routes_;
 
-        // List of trees that are stored in data file
-        std::map<std::string, std::unique_ptr<TTree>> trees_;
+        // Write the events on a writer thread per data file
+        bool asynchronous_{false};
+        size_t write_queue_size_{};
 
-        // List of messages to keep so they can be stored in the tree
-        std::vector<std::shared_ptr<BaseMessage>> keep_messages_;
-        // List of objects of a particular type, bound to a specific detector and having a particular name
-        std::map<std::tuple<std::type_index, std::string, std::string>, std::vector<Object*>*> write_list_;
+        // Statistics about the back-pressure of the writer thread
+        StatisticsCounter& write_queue_full_{get_counter("write_queue_full")};
+        StatisticsCounter& write_wait_time_{get_counter("write_wait_time_ns")};
 
         // Statistical information about number of objects
-        unsigned long write_cnt_{};
+        std::atomic<unsigned long> write_cnt_{};
+        unsigned long skipped_cnt_{};
     };
 } // namespace allpix
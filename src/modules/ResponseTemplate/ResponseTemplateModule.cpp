@@ -0,0 +1,371 @@
+/**
+ * @file
+ * @brief Implementation of a module to build a pixel response template and to transfer deposits to pixels using it
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include "ResponseTemplateModule.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+
+#include <cereal/archives/portable_binary.hpp>
+#include <cereal/types/array.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+
+#include "core/utils/file.h"
+#include "core/utils/log.h"
+#include "objects/PixelCharge.hpp"
+#include "objects/PixelIndexMap.hpp"
+#include "objects/PropagatedCharge.hpp"
+#include "objects/exceptions.h"
+#include "tools/ROOT.h"
+
+using namespace allpix;
+
+namespace {
+    // Identifier and version of the template format written at the start of every file
+    const std::string template_magic = "Allpix Squared response template";
+    constexpr std::uint32_t template_version = 1;
+} // namespace
+
+ResponseTemplateModule::ResponseTemplateModule(Configuration& config,
+                                               Messenger* messenger,
+                                               std::shared_ptr<Detector> detector)
+    : Module(config, detector), detector_(std::move(detector)), messenger_(messenger) {
+    using XYVectorInt = ROOT::Math::DisplacementVector2D<ROOT::Math::Cartesian2D<int>>;
+    using XYZVectorInt = ROOT::Math::DisplacementVector3D<ROOT::Math::Cartesian3D<int>>;
+
+    // Save detector model
+    model_ = detector_->getModel();
+    sensor_lower_z_ = model_->getSensorCenter().z() - model_->getSensorSize().z() / 2.0;
+
+    // Set default values for the template
+    config_.setDefault("file_name", "response_" + detector_->getName());
+    config_.setDefault<XYZVectorInt>("template_bins", XYZVectorInt(10, 10, 10));
+    config_.setDefault<XYVectorInt>("template_matrix", XYVectorInt(3, 3));
+
+    // Read the mode of the module
+    auto mode = config_.get<std::string>("mode");
+    std::transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
+    if(mode == "build") {
+        mode_ = TemplateMode::BUILD;
+    } else if(mode == "apply") {
+        mode_ = TemplateMode::APPLY;
+    } else {
+        throw InvalidValueError(config_, "mode", "Invalid template mode, only 'build' and 'apply' are supported.");
+    }
+
+    // Building the template requires the pixel charges created from the deposits by the full simulation chain
+    messenger_->bindSingle<DepositedChargeMessage>(this, MsgFlags::REQUIRED);
+    if(mode_ == TemplateMode::BUILD) {
+        messenger_->bindSingle<PixelChargeMessage>(this, MsgFlags::REQUIRED);
+    }
+
+    // The template is only modified while holding a lock, which allows to process multiple events at the same time
+    enable_parallelization();
+}
+
+void ResponseTemplateModule::init() {
+    using XYVectorInt = ROOT::Math::DisplacementVector2D<ROOT::Math::Cartesian2D<int>>;
+    using XYZVectorInt = ROOT::Math::DisplacementVector3D<ROOT::Math::Cartesian3D<int>>;
+
+    if(mode_ == TemplateMode::BUILD) {
+        auto bins = config_.get<XYZVectorInt>("template_bins");
+        if(bins.x() <= 0 || bins.y() <= 0 || bins.z() <= 0) {
+            throw InvalidValueError(config_, "template_bins", "number of bins should be strictly positive");
+        }
+        auto matrix = config_.get<XYVectorInt>("template_matrix");
+        if(matrix.x() <= 0 || matrix.y() <= 0 || matrix.x() % 2 == 0 || matrix.y() % 2 == 0) {
+            throw InvalidValueError(config_, "template_matrix", "Odd number of pixels in x and y required.");
+        }
+
+        // Prepare an empty template for the geometry of this detector
+        template_.pixel_size = {{model_->getPixelSize().x(), model_->getPixelSize().y()}};
+        template_.thickness = model_->getSensorSize().z();
+        template_.bins = {{bins.x(), bins.y(), bins.z()}};
+        template_.matrix = {{matrix.x(), matrix.y()}};
+        matrix_size_ = static_cast<size_t>(matrix.x() * matrix.y());
+        auto template_bins = 2 * static_cast<size_t>(bins.x() * bins.y() * bins.z());
+        template_.counts.assign(template_bins, 0);
+        fraction_sums_.assign(template_bins * matrix_size_, 0);
+        fraction_squares_.assign(template_bins * matrix_size_, 0);
+
+        // Create the template file already, such that an invalid path is detected before the simulation
+        file_name_ = createOutputFile(allpix::add_file_extension(config_.get<std::string>("file_name"), "apr"), true);
+        LOG(STATUS) << "Building response template of " << bins << " bins and " << matrix << " pixels in file "
+                    << file_name_;
+        return;
+    }
+
+    // Read the template
+    file_name_ = config_.getPathWithExtension("file_name", "apr", true);
+    std::ifstream file(file_name_, std::ios::in | std::ios::binary);
+    if(!file.good()) {
+        throw InvalidValueError(config_, "file_name", "cannot open response template file");
+    }
+    try {
+        cereal::PortableBinaryInputArchive archive(file);
+        std::string magic;
+        std::uint32_t version = 0;
+        archive(magic, version);
+        if(magic != template_magic || version != template_version) {
+            throw InvalidValueError(config_, "file_name", "file is not a response template of a supported version");
+        }
+        archive(template_);
+    } catch(cereal::Exception& e) {
+        throw InvalidValueError(
+            config_, "file_name", "response template is truncated or corrupted: " + std::string(e.what()));
+    }
+
+    // Check that the template is consistent and was built for the geometry of this detector
+    matrix_size_ = static_cast<size_t>(template_.matrix[0] * template_.matrix[1]);
+    auto template_bins = 2 * static_cast<size_t>(template_.bins[0] * template_.bins[1] * template_.bins[2]);
+    if(template_.counts.size() != template_bins || template_.means.size() != template_bins * matrix_size_ ||
+       template_.spreads.size() != template_bins * matrix_size_) {
+        throw InvalidValueError(config_, "file_name", "response template is inconsistent");
+    }
+    auto matches = [](double lhs, double rhs) { return std::fabs(lhs - rhs) <= 1e-9 * std::fabs(rhs); };
+    if(!matches(template_.pixel_size[0], model_->getPixelSize().x()) ||
+       !matches(template_.pixel_size[1], model_->getPixelSize().y()) ||
+       !matches(template_.thickness, model_->getSensorSize().z())) {
+        throw InvalidValueError(
+            config_, "file_name", "response template was built for a different pixel size or sensor thickness");
+    }
+
+    auto empty_bins = std::count(template_.counts.begin(), template_.counts.end(), 0);
+    LOG(STATUS) << "Read response template of " << template_.bins[0] << "x" << template_.bins[1] << "x"
+                << template_.bins[2] << " bins and " << template_.matrix[0] << "x" << template_.matrix[1]
+                << " pixels from file " << file_name_;
+    if(empty_bins > 0) {
+        LOG(WARNING) << empty_bins << " of " << template_bins
+                     << " bins of the response template do not contain any deposit, deposits in these bins are ignored";
+    }
+}
+
+void ResponseTemplateModule::run(Event* event) {
+    if(mode_ == TemplateMode::BUILD) {
+        build_template(event);
+    } else {
+        apply_template(event);
+    }
+}
+
+/**
+ * The deposit is located in the pixel with the closest center. The bins divide the pixel cell along x and y and the full
+ * sensor thickness along z, positions outside are attributed to the closest bin. Electrons and holes use separate bins.
+ */
+size_t ResponseTemplateModule::template_bin(const DepositedCharge& deposit, int& pixel_x, int& pixel_y) const {
+    auto position = deposit.getLocalPosition();
+    auto scaled_x = position.x() / template_.pixel_size[0];
+    auto scaled_y = position.y() / template_.pixel_size[1];
+    pixel_x = static_cast<int>(std::lround(scaled_x));
+    pixel_y = static_cast<int>(std::lround(scaled_y));
+
+    auto bin = [](double fraction, int bins) {
+        return static_cast<size_t>(std::min(std::max(static_cast<int>(std::floor(fraction * bins)), 0), bins - 1));
+    };
+    auto bin_x = bin(scaled_x - pixel_x + 0.5, template_.bins[0]);
+    auto bin_y = bin(scaled_y - pixel_y + 0.5, template_.bins[1]);
+    auto bin_z = bin((position.z() - sensor_lower_z_) / template_.thickness, template_.bins[2]);
+    auto type = (deposit.getType() == CarrierType::ELECTRON ? 0u : 1u);
+
+    auto bins_x = static_cast<size_t>(template_.bins[0]);
+    auto bins_y = static_cast<size_t>(template_.bins[1]);
+    auto bins_z = static_cast<size_t>(template_.bins[2]);
+    return ((type * bins_x + bin_x) * bins_y + bin_y) * bins_z + bin_z;
+}
+
+/**
+ * The charge of a propagated charge is attributed to a pixel if the pixel charge refers to it. Propagated charges with
+ * induced pulses only contribute the charge induced on the respective pixel.
+ */
+void ResponseTemplateModule::build_template(Event* event) {
+    auto deposits_message = messenger_->fetchMessage<DepositedChargeMessage>(this, event);
+    auto pixel_message = messenger_->fetchMessage<PixelChargeMessage>(this, event);
+
+    // Collect the charge of every deposit collected by every pixel
+    std::map<const DepositedCharge*, std::map<std::pair<int, int>, double>> contributions;
+    try {
+        for(const auto& pixel_charge : pixel_message->getData()) {
+            auto index = pixel_charge.getIndex();
+            for(const auto* propagated_charge : pixel_charge.getPropagatedCharges()) {
+                const auto& pulses = propagated_charge->getPulses();
+                double charge = propagated_charge->getCharge();
+                if(!pulses.empty()) {
+                    auto pulse = pulses.find(index);
+                    charge = (pulse == pulses.end() ? 0. : std::fabs(pulse->second.getCharge()));
+                }
+                auto& pixel = contributions[propagated_charge->getDepositedCharge()];
+                pixel[{static_cast<int>(index.x()), static_cast<int>(index.y())}] += charge;
+            }
+        }
+    } catch(MissingReferenceException& e) {
+        throw ModuleError("Building the response template requires the full history of the pixel charges: " +
+                          std::string(e.what()));
+    }
+
+    // Add the fractions of the charge of every deposit to the template, also for deposits not collected by any pixel
+    std::lock_guard<std::mutex> lock(template_mutex_);
+    for(const auto& deposit : deposits_message->getData()) {
+        if(deposit.getCharge() == 0) {
+            continue;
+        }
+
+        int pixel_x = 0, pixel_y = 0;
+        auto bin = template_bin(deposit, pixel_x, pixel_y);
+        template_.counts[bin]++;
+        deposits_cnt_++;
+        charge_cnt_ += deposit.getCharge();
+
+        auto deposit_contributions = contributions.find(&deposit);
+        if(deposit_contributions == contributions.end()) {
+            continue;
+        }
+        for(const auto& contribution : deposit_contributions->second) {
+            auto offset_x = contribution.first.first - pixel_x + template_.matrix[0] / 2;
+            auto offset_y = contribution.first.second - pixel_y + template_.matrix[1] / 2;
+            if(offset_x < 0 || offset_y < 0 || offset_x >= template_.matrix[0] || offset_y >= template_.matrix[1]) {
+                missing_cnt_++;
+                continue;
+            }
+
+            auto entry = bin * matrix_size_ + static_cast<size_t>(offset_x * template_.matrix[1] + offset_y);
+            auto fraction = contribution.second / deposit.getCharge();
+            fraction_sums_[entry] += fraction;
+            fraction_squares_[entry] += fraction * fraction;
+        }
+    }
+}
+
+/**
+ * The fraction collected by every pixel of the matrix is drawn from a normal distribution with the mean and spread of the
+ * template bin, limited to the range from zero to one. Every non-zero charge is represented by a propagated charge at the
+ * center of the pixel, which refers to the deposit and is used as history of the pixel charge.
+ */
+void ResponseTemplateModule::apply_template(Event* event) {
+    auto deposits_message = messenger_->fetchMessage<DepositedChargeMessage>(this, event);
+
+    auto number_of_pixels = model_->getNPixels();
+    std::normal_distribution<double> gauss(0, 1);
+
+    auto propagated_charges = MessageStorage<PropagatedCharge>::acquire();
+    PixelIndexMap<std::pair<unsigned int, std::vector<size_t>>> pixels;
+    for(const auto& deposit : deposits_message->getData()) {
+        int pixel_x = 0, pixel_y = 0;
+        auto bin = template_bin(deposit, pixel_x, pixel_y);
+        if(template_.counts[bin] == 0) {
+            missing_cnt_++;
+            continue;
+        }
+        deposits_cnt_++;
+
+        for(size_t offset = 0; offset < matrix_size_; ++offset) {
+            auto entry = bin * matrix_size_ + offset;
+            auto fraction = template_.means[entry];
+            if(template_.spreads[entry] > 0) {
+                fraction += template_.spreads[entry] * gauss(event->getRandomEngine());
+            }
+            auto charge = static_cast<unsigned int>(std::lround(std::min(std::max(fraction, 0.), 1.) * deposit.getCharge()));
+            if(charge == 0) {
+                continue;
+            }
+
+            auto x = pixel_x + static_cast<int>(offset) / template_.matrix[1] - template_.matrix[0] / 2;
+            auto y = pixel_y + static_cast<int>(offset) % template_.matrix[1] - template_.matrix[1] / 2;
+            if(x < 0 || y < 0 || x >= number_of_pixels.x() || y >= number_of_pixels.y()) {
+                continue;
+            }
+
+            Pixel::Index index(static_cast<unsigned int>(x), static_cast<unsigned int>(y));
+            auto local_position = detector_->getPixel(index).getLocalCenter();
+            propagated_charges.emplace_back(local_position,
+                                            detector_->getGlobalPosition(local_position),
+                                            deposit.getType(),
+                                            charge,
+                                            deposit.getEventTime(),
+                                            &deposit);
+            auto& pixel = pixels[index];
+            pixel.first += charge;
+            pixel.second.push_back(propagated_charges.size() - 1);
+            charge_cnt_ += charge;
+        }
+    }
+
+    // Dispatch the propagated charges first, such that the pixel charges can refer to them
+    auto propagated_charge_message = std::make_shared<PropagatedChargeMessage>(std::move(propagated_charges), detector_);
+    messenger_->dispatchMessage(this, propagated_charge_message, event);
+
+    const auto& dispatched_charges = propagated_charge_message->getData();
+    auto pixel_charges = MessageStorage<PixelCharge>::acquire();
+    pixel_charges.reserve(pixels.size());
+    for(auto& pixel_index_charge : pixels) {
+        std::vector<const PropagatedCharge*> history;
+        history.reserve(pixel_index_charge.second.second.size());
+        for(auto idx : pixel_index_charge.second.second) {
+            history.push_back(&dispatched_charges[idx]);
+        }
+
+        LOG(DEBUG) << "Set of " << pixel_index_charge.second.first << " charges on pixel " << pixel_index_charge.first;
+        pixel_charges.emplace_back(
+            detector_->getPixel(pixel_index_charge.first), pixel_index_charge.second.first, std::move(history));
+    }
+
+    auto pixel_charge_message = std::make_shared<PixelChargeMessage>(std::move(pixel_charges), detector_);
+    messenger_->dispatchMessage(this, pixel_charge_message, event);
+}
+
+void ResponseTemplateModule::finalize() {
+    if(mode_ == TemplateMode::APPLY) {
+        LOG(STATUS) << "Transferred " << deposits_cnt_ << " deposits with the response template, in total "
+                    << Units::display(static_cast<double>(charge_cnt_), "e") << " collected by the pixels";
+        if(missing_cnt_ > 0) {
+            LOG(WARNING) << missing_cnt_ << " deposits in bins of the response template without entries were ignored";
+        }
+        return;
+    }
+
+    // Calculate the mean and spread of the fractions of every bin
+    template_.means.assign(fraction_sums_.size(), 0);
+    template_.spreads.assign(fraction_sums_.size(), 0);
+    for(size_t entry = 0; entry < fraction_sums_.size(); ++entry) {
+        auto count = static_cast<double>(template_.counts[entry / matrix_size_]);
+        if(count == 0) {
+            continue;
+        }
+        auto mean = fraction_sums_[entry] / count;
+        template_.means[entry] = mean;
+        template_.spreads[entry] = std::sqrt(std::max(fraction_squares_[entry] / count - mean * mean, 0.));
+    }
+
+    // Write the template
+    std::ofstream file(file_name_, std::ios::out | std::ios::binary);
+    if(!file.good()) {
+        throw ModuleError("Cannot open response template file '" + file_name_ + "' for writing");
+    }
+    {
+        cereal::PortableBinaryOutputArchive archive(file);
+        archive(template_magic, template_version);
+        archive(template_);
+    }
+
+    auto empty_bins = std::count(template_.counts.begin(), template_.counts.end(), 0);
+    LOG(STATUS) << "Wrote response template built from " << deposits_cnt_ << " deposits with "
+                << Units::display(static_cast<double>(charge_cnt_), "e") << " to file " << file_name_;
+    if(empty_bins > 0) {
+        LOG(INFO) << empty_bins << " of " << template_.counts.size() << " bins of the response template contain no deposit";
+    }
+    if(missing_cnt_ > 0) {
+        LOG(WARNING) << missing_cnt_
+                     << " contributions to pixels outside of the template matrix were ignored, consider a larger matrix";
+    }
+}
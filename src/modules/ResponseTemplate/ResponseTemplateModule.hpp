@@ -0,0 +1,135 @@
+/**
+ * @file
+ * @brief Definition of a module to build a pixel response template and to transfer deposits to pixels using it
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <Math/DisplacementVector2D.h>
+#include <Math/DisplacementVector3D.h>
+
+#include "core/config/Configuration.hpp"
+#include "core/geometry/DetectorModel.hpp"
+#include "core/messenger/Messenger.hpp"
+#include "core/module/Event.hpp"
+#include "core/module/Module.hpp"
+
+#include "objects/DepositedCharge.hpp"
+
+namespace allpix {
+    /**
+     * @ingroup Modules
+     * @brief Module to replace the propagation and transfer of charge carriers by sampling from a pixel response template
+     *
+     * In build mode, the module receives the deposited charges and the pixel charges produced from them by a full
+     * propagation and transfer chain, and records the fraction of the charge of every deposit collected by every pixel of
+     * a matrix around the pixel of the deposit. The mean and spread of the fractions are stored per carrier type and per
+     * bin of the position of the deposit within the pixel cell and the sensor depth. In apply mode, the charge of every
+     * deposit is distributed to the pixels by sampling fractions from the template instead of propagating the carriers.
+     */
+    class ResponseTemplateModule : public Module {
+        /**
+         * @brief Mode of the module
+         */
+        enum class TemplateMode {
+            BUILD = 0, ///< Record the response of the full simulation chain in the template
+            APPLY,     ///< Transfer the deposits to the pixels by sampling from the template
+        };
+
+    public:
+        /**
+         * @brief Constructor for this detector-specific module
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param detector Pointer to the detector for this module instance
+         */
+        ResponseTemplateModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector);
+
+        /**
+         * @brief Prepare an empty template or read the template from its file
+         */
+        void init() override;
+
+        /**
+         * @brief Record the response of the deposits of the event or transfer them to the pixels
+         * @param event Pointer to the event
+         */
+        void run(Event* event) override;
+
+        /**
+         * @brief Write the template to its file and output a summary
+         */
+        void finalize() override;
+
+    private:
+        /**
+         * @brief Response of the pixels to deposits, with the geometry it was built for
+         */
+        struct ResponseTemplate {
+            std::array<double, 2> pixel_size;
+            double thickness;
+            std::array<std::int32_t, 3> bins;
+            std::array<std::int32_t, 2> matrix;
+            // Number of deposits per carrier type and bin, and mean and spread of the fraction of their charge collected by
+            // every pixel of the matrix
+            std::vector<std::uint64_t> counts;
+            std::vector<double> means;
+            std::vector<double> spreads;
+
+            template <class Archive> void serialize(Archive& archive) {
+                archive(pixel_size, thickness, bins, matrix, counts, means, spreads);
+            }
+        };
+
+        /**
+         * @brief Record the fractions of the charge of the deposits collected by every pixel
+         * @param event Pointer to the event
+         */
+        void build_template(Event* event);
+
+        /**
+         * @brief Distribute the charge of the deposits to the pixels by sampling from the template and dispatch the results
+         * @param event Pointer to the event
+         */
+        void apply_template(Event* event);
+
+        /**
+         * @brief Find the template bin of a deposit and the pixel the deposit is located in
+         * @param deposit Deposited charge
+         * @param pixel_x Index of the pixel along x, can be outside of the pixel grid
+         * @param pixel_y Index of the pixel along y, can be outside of the pixel grid
+         * @return Index of the bin, including the carrier type
+         */
+        size_t template_bin(const DepositedCharge& deposit, int& pixel_x, int& pixel_y) const;
+
+        std::shared_ptr<Detector> detector_;
+        std::shared_ptr<DetectorModel> model_;
+        Messenger* messenger_;
+
+        TemplateMode mode_;
+        std::string file_name_;
+        double sensor_lower_z_{};
+        ResponseTemplate template_;
+        size_t matrix_size_{};
+
+        // Sums of the fractions and the squared fractions while building the template
+        std::mutex template_mutex_;
+        std::vector<double> fraction_sums_;
+        std::vector<double> fraction_squares_;
+
+        // Statistics
+        std::atomic<unsigned long> deposits_cnt_{};
+        std::atomic<unsigned long> missing_cnt_{};
+        std::atomic<unsigned long long> charge_cnt_{};
+    };
+} // namespace allpix
@@ -24,11 +24,29 @@
 #include "tools/ROOT.h"
 
 #include "objects/PixelCharge.hpp"
+#include "objects/PixelIndexMap.hpp"
 
 using namespace allpix;
 
 SimpleTransferModule::SimpleTransferModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector)
-    : Module(config, detector), messenger_(messenger), detector_(std::move(detector)) {
+    : Module(config, std::move(detector)), messenger_(messenger) {
+    configure();
+
+    // Require propagated deposits for single detector
+    messenger->bindSingle<PropagatedChargeMessage>(this, MsgFlags::REQUIRED);
+}
+
+SimpleTransferModule::SimpleTransferModule(Configuration& config,
+                                           Messenger* messenger,
+                                           std::vector<std::shared_ptr<Detector>> detectors)
+    : Module(config, std::move(detectors)), messenger_(messenger) {
+    configure();
+
+    // Receive the propagated deposits of all detectors of this instance
+    messenger->bindMulti<PropagatedChargeMessage>(this, MsgFlags::REQUIRED);
+}
+
+void SimpleTransferModule::configure() {
     // Enable parallelization of this module if multithreading is enabled
     enable_parallelization();
 
@@ -43,49 +61,73 @@ SimpleTransferModule::SimpleTransferModule(Configuration& config, Messenger* mes
     config_.setDefault<double>("output_plots_step", Units::get(0.1, "ns"));
     config_.setDefault<double>("output_plots_range", Units::get(100, "ns"));
 
-    // Save detector model
-    model_ = detector_->getModel();
-
-    // Cache flag for output plots:
+    // Cache flag for output plots and parameters used for every propagated charge:
     output_plots_ = config_.get<bool>("output_plots");
-
-    // Require propagated deposits for single detector
-    messenger->bindSingle(this, &SimpleTransferModule::propagated_message_, MsgFlags::REQUIRED);
+    max_depth_distance_ = config_.getParameter<double>("max_depth_distance");
+    collect_from_implant_ = config_.getParameter<bool>("collect_from_implant");
 }
 
 void SimpleTransferModule::init() {
-
-    if(config_.get<bool>("collect_from_implant")) {
-        if(detector_->getElectricFieldType() == FieldType::LINEAR) {
-            throw ModuleError("Charge collection from implant region should not be used with linear electric fields.");
-        } else {
-            auto model = detector_->getModel();
-            LOG(INFO) << "Collecting charges from implants with size " << Units::display(model->getImplantSize(), {"um"});
+    for(auto& detector : getDetectors()) {
+        auto model = detector->getModel();
+        if(collect_from_implant_) {
+            if(detector->getElectricFieldType() == FieldType::LINEAR) {
+                throw ModuleError("Charge collection from implant region should not be used with linear electric fields.");
+            } else {
+                LOG(INFO) << "Collecting charges from implants with size "
+                          << Units::display(model->getImplantSize(), {"um"});
+            }
         }
+        transfer_detectors_[detector->getName()] = detector;
+    }
+    if(getDetector() == nullptr) {
+        LOG(INFO) << "Transferring charges of " << transfer_detectors_.size() << " detectors in a single instance";
     }
 
     if(output_plots_) {
         auto time_bins =
             static_cast<int>(config_.get<double>("output_plots_range") / config_.get<double>("output_plots_step"));
-        drift_time_histo = new TH1D("drift_time_histo",
-                                    "Charge carrier arrival time;t[ns];charge carriers",
-                                    time_bins,
-                                    0.,
-                                    config_.get<double>("output_plots_range"));
+        drift_time_histo_ = std::make_unique<ThreadedHistogram<TH1D>>("drift_time_histo",
+                                                                      "Charge carrier arrival time;t[ns];charge carriers",
+                                                                      time_bins,
+                                                                      0.,
+                                                                      config_.get<double>("output_plots_range"));
     }
 }
 
-void SimpleTransferModule::run(unsigned int) {
+void SimpleTransferModule::run(Event* event) {
+    // Single detector instances look up their only detector directly
+    if(getDetector() != nullptr) {
+        auto propagated_message = messenger_->fetchMessage<PropagatedChargeMessage>(this, event);
+        transfer(event, *propagated_message, getDetector());
+        return;
+    }
+
+    // Transfer the charges of every detector with propagated charges in this event
+    for(auto& propagated_message : messenger_->fetchMultiMessage<PropagatedChargeMessage>(this, event)) {
+        auto detector = transfer_detectors_.find(propagated_message->getDetector()->getName());
+        if(detector == transfer_detectors_.end()) {
+            continue;
+        }
+        transfer(event, *propagated_message, detector->second);
+    }
+}
+
+void SimpleTransferModule::transfer(Event* event,
+                                    const PropagatedChargeMessage& propagated_message,
+                                    const std::shared_ptr<Detector>& detector) {
+    // The flattened geometry avoids the virtual getters of the model for every propagated charge
+    const auto& geometry = detector->getGeometry();
+
     // Find corresponding pixels for all propagated charges
-    LOG(TRACE) << "Transferring charges to pixels";
+    LOG(TRACE) << "Transferring charges to pixels of detector " << detector->getName();
     unsigned int transferred_charges_count = 0;
-    std::map<Pixel::Index, std::vector<const PropagatedCharge*>> pixel_map;
-    for(auto& propagated_charge : propagated_message_->getData()) {
+    PixelIndexMap<std::pair<unsigned int, std::vector<const PropagatedCharge*>>> pixel_map;
+    for(auto& propagated_charge : propagated_message.getData()) {
         auto position = propagated_charge.getLocalPosition();
         // Ignore if outside depth range of implant
         // FIXME This logic should be improved
-        if(std::fabs(position.z() - (model_->getSensorCenter().z() + model_->getSensorSize().z() / 2.0)) >
-           config_.get<double>("max_depth_distance")) {
+        if(std::fabs(position.z() - geometry.implantSurface()) > max_depth_distance_) {
             LOG(DEBUG) << "Skipping set of " << propagated_charge.getCharge() << " propagated charges at "
                        << Units::display(propagated_charge.getLocalPosition(), {"mm", "um"})
                        << " because their local position is not in implant range";
@@ -93,19 +135,19 @@ void SimpleTransferModule::run(unsigned int) {
         }
 
         // Find the nearest pixel
-        auto xpixel = static_cast<int>(std::round(position.x() / model_->getPixelSize().x()));
-        auto ypixel = static_cast<int>(std::round(position.y() / model_->getPixelSize().y()));
+        auto xpixel = geometry.nearestColumn(position.x());
+        auto ypixel = geometry.nearestRow(position.y());
 
         // Ignore if out of pixel grid
-        if(xpixel < 0 || xpixel >= model_->getNPixels().x() || ypixel < 0 || ypixel >= model_->getNPixels().y()) {
+        if(!geometry.isWithinPixelGrid(xpixel, ypixel)) {
             LOG(DEBUG) << "Skipping set of " << propagated_charge.getCharge() << " propagated charges at "
                        << Units::display(propagated_charge.getLocalPosition(), {"mm", "um"})
                        << " because their nearest pixel (" << xpixel << "," << ypixel << ") is outside the grid";
             continue;
         }
 
-        // Ignore if outside the implant region:
-        if(config_.get<bool>("collect_from_implant") && !detector_->isWithinImplant(position)) {
+        // Ignore if outside the implant region, using the offset from the center of the nearest pixel
+        if(collect_from_implant_ && !geometry.isWithinImplant(position.x(), position.y(), xpixel, ypixel)) {
             LOG(DEBUG) << "Skipping set of " << propagated_charge.getCharge() << " propagated charges at "
                        << Units::display(propagated_charge.getLocalPosition(), {"mm", "um"})
                        << " because it is outside the pixel implant.";
@@ -115,52 +157,55 @@ void SimpleTransferModule::run(unsigned int) {
         Pixel::Index pixel_index(static_cast<unsigned int>(xpixel), static_cast<unsigned int>(ypixel));
 
         // Update statistics
-        unique_pixels_.insert(pixel_index);
         transferred_charges_count += propagated_charge.getCharge();
 
         if(output_plots_) {
-            drift_time_histo->Fill(propagated_charge.getEventTime(), propagated_charge.getCharge());
+            drift_time_histo_->Fill(propagated_charge.getEventTime(), propagated_charge.getCharge());
         }
 
         LOG(DEBUG) << "Set of " << propagated_charge.getCharge() << " propagated charges at "
                    << Units::display(propagated_charge.getLocalPosition(), {"mm", "um"}) << " brought to pixel "
                    << pixel_index;
 
-        // Add the pixel the list of hit pixels
-        pixel_map[pixel_index].emplace_back(&propagated_charge);
+        // Add the charge to the pixel in the list of hit pixels
+        auto& pixel_charge = pixel_map[pixel_index];
+        pixel_charge.first += propagated_charge.getCharge();
+        pixel_charge.second.emplace_back(&propagated_charge);
     }
 
     // Create pixel charges
     LOG(TRACE) << "Combining charges at same pixel";
-    std::vector<PixelCharge> pixel_charges;
+    auto pixel_charges = MessageStorage<PixelCharge>::acquire();
+    pixel_charges.reserve(pixel_map.size());
     for(auto& pixel_index_charge : pixel_map) {
-        unsigned int charge = 0;
-        for(auto& propagated_charge : pixel_index_charge.second) {
-            charge += propagated_charge->getCharge();
-        }
+        auto charge = pixel_index_charge.second.first;
 
         // Get pixel object from detector
-        auto pixel = detector_->getPixel(pixel_index_charge.first.x(), pixel_index_charge.first.y());
+        auto pixel = detector->getPixel(pixel_index_charge.first.x(), pixel_index_charge.first.y());
 
-        pixel_charges.emplace_back(pixel, charge, pixel_index_charge.second);
+        pixel_charges.emplace_back(pixel, charge, pixel_index_charge.second.second);
         LOG(DEBUG) << "Set of " << charge << " charges combined at " << pixel.getIndex();
     }
 
     // Writing summary and update statistics
     LOG(INFO) << "Transferred " << transferred_charges_count << " charges to " << pixel_map.size() << " pixels";
-    total_transferred_charges_ += transferred_charges_count;
+    total_transferred_charges_.local() += transferred_charges_count;
+    auto& unique_pixels = unique_pixels_.local();
+    for(auto& pixel_index_charge : pixel_map) {
+        unique_pixels.emplace(detector.get(), pixel_index_charge.first);
+    }
 
     // Dispatch message of pixel charges
-    auto pixel_message = std::make_shared<PixelChargeMessage>(pixel_charges, detector_);
-    messenger_->dispatchMessage(this, pixel_message);
+    auto pixel_message = std::make_shared<PixelChargeMessage>(pixel_charges, detector);
+    messenger_->dispatchMessage(this, pixel_message, event);
 }
 
 void SimpleTransferModule::finalize() {
     // Print statistics
-    LOG(INFO) << "Transferred total of " << total_transferred_charges_ << " charges to " << unique_pixels_.size()
-              << " different pixels";
+    LOG(INFO) << "Transferred total of " << total_transferred_charges_.merge() << " charges to "
+              << unique_pixels_.merge().size() << " different pixels";
 
     if(output_plots_) {
-        drift_time_histo->Write();
+        drift_time_histo_->merge()->Write();
     }
 }
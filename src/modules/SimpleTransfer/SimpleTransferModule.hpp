@@ -9,15 +9,21 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include <Math/DisplacementVector2D.h>
+#include <Math/Vector2D.h>
 #include <TH1D.h>
 
 #include "core/config/Configuration.hpp"
 #include "core/geometry/GeometryManager.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "core/module/Module.hpp"
+#include "core/module/ThreadedAccumulator.hpp"
+#include "core/module/ThreadedHistogram.hpp"
 
 #include "objects/Pixel.hpp"
 #include "objects/PixelCharge.hpp"
@@ -32,6 +38,9 @@ namespace allpix {
      * This module does a simple direct mapping from propagated charges to the nearest pixel in the grid. It only considers
      * propagated charges within a certain distance from the implants and within the pixel grid, charges in the rest of the
      * sensor are ignored. The module combines all the propagated charges to a set of charges at a specific pixel.
+     *
+     * The module can be instantiated once for all of its detectors with the multi_detector parameter, in which case the
+     * geometry of every detector is cached in the single instantiation and a message is dispatched per detector.
      */
     class SimpleTransferModule : public Module {
     public:
@@ -43,6 +52,14 @@ namespace allpix {
          */
         SimpleTransferModule(Configuration& config, Messenger* messenger, std::shared_ptr<Detector> detector);
 
+        /**
+         * @brief Constructor for a single instance of this module for multiple detectors
+         * @param config Configuration object for this module as retrieved from the steering file
+         * @param messenger Pointer to the messenger object to allow binding to messages on the bus
+         * @param detectors Pointers to all detectors of this module instance
+         */
+        SimpleTransferModule(Configuration& config, Messenger* messenger, std::vector<std::shared_ptr<Detector>> detectors);
+
         /**
          * @brief Initialize - check for field configuration and implants
          */
@@ -50,8 +67,9 @@ namespace allpix {
 
         /**
          * @brief Transfer the propagated charges to the pixels
+         * @param event Pointer to the event to process
          */
-        void run(unsigned int) override;
+        void run(Event* event) override;
 
         /**
          * @brief Display statistical summary
@@ -59,20 +77,37 @@ namespace allpix {
         void finalize() override;
 
     private:
-        Messenger* messenger_;
-        std::shared_ptr<Detector> detector_;
-        std::shared_ptr<DetectorModel> model_;
+        /**
+         * @brief Set the defaults and cache the parameters of the configuration, shared by both constructors
+         */
+        void configure();
 
-        // Message containing the propagated charges
-        std::shared_ptr<PropagatedChargeMessage> propagated_message_;
+        /**
+         * @brief Transfer the propagated charges of a single detector to its pixels and dispatch them
+         * @param event Pointer to the event to process
+         * @param propagated_message Message with the propagated charges of the detector
+         * @param detector Detector of the propagated charges
+         */
+        void transfer(Event* event,
+                      const PropagatedChargeMessage& propagated_message,
+                      const std::shared_ptr<Detector>& detector);
 
-        TH1D* drift_time_histo;
+        Messenger* messenger_;
+
+        std::unique_ptr<ThreadedHistogram<TH1D>> drift_time_histo_;
 
         // Flag whether to store output plots:
         bool output_plots_{};
 
+        // Configuration parameters used for every propagated charge:
+        ConfigParameter<double> max_depth_distance_;
+        ConfigParameter<bool> collect_from_implant_;
+
+        // All detectors of this instance by the name of the detector
+        std::map<std::string, std::shared_ptr<Detector>> transfer_detectors_;
+
         // Statistical information
-        unsigned int total_transferred_charges_{};
-        std::set<Pixel::Index> unique_pixels_;
+        ThreadedAccumulator<unsigned int> total_transferred_charges_;
+        ThreadedAccumulator<std::set<std::pair<const Detector*, Pixel::Index>>> unique_pixels_;
     };
 } // namespace allpix
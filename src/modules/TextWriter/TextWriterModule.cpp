@@ -27,6 +27,9 @@
 using namespace allpix;
 
 TextWriterModule::TextWriterModule(Configuration& config, Messenger* messenger, GeometryManager*) : Module(config) {
+    // Buffer a large block of output in user space before writing it to the file
+    config_.setDefault<size_t>("buffer_size", 1 << 20);
+
     // Bind to all messages
     messenger->registerListener(this, &TextWriterModule::receive);
 }
@@ -44,9 +47,16 @@ void TextWriterModule::init() {
     // Create output file
     output_file_name_ =
         createOutputFile(allpix::add_file_extension(config_.get<std::string>("file_name", "data"), "txt"), true);
-    output_file_ = std::make_unique<std::ofstream>(output_file_name_);
 
-    *output_file_ << "# Allpix Squared ASCII data - https://cern.ch/allpix-squared" << std::endl << std::endl;
+    // The buffer has to be installed before the file is opened to take effect
+    output_buffer_.resize(config_.get<size_t>("buffer_size"));
+    output_file_ = std::make_unique<std::ofstream>();
+    if(!output_buffer_.empty()) {
+        output_file_->rdbuf()->pubsetbuf(output_buffer_.data(), static_cast<std::streamsize>(output_buffer_.size()));
+    }
+    output_file_->open(output_file_name_);
+
+    *output_file_ << "# Allpix Squared ASCII data - https://cern.ch/allpix-squared\n\n";
 
     // Read include and exclude list
     if(config_.has("include") && config_.has("exclude")) {
@@ -60,38 +70,36 @@ void TextWriterModule::init() {
     }
 }
 
+/**
+ * Messages of a type always hold objects of the same class, such that the include and exclude lists are only checked for
+ * the first message of every type.
+ */
 void TextWriterModule::receive(std::shared_ptr<BaseMessage> message, std::string message_name) { // NOLINT
     try {
         const BaseMessage* inst = message.get();
-        std::string name_str = " without a name";
-        if(!message_name.empty()) {
-            name_str = " named " + message_name;
-        }
-        LOG(TRACE) << "Text writer received " << allpix::demangle(typeid(*inst).name()) << name_str;
-
-        // Get the detector name
-        std::string detector_name;
-        if(message->getDetector() != nullptr) {
-            detector_name = message->getDetector()->getName();
-        }
+        LOG(TRACE) << "Text writer received " << allpix::demangle(typeid(*inst).name())
+                   << (message_name.empty() ? std::string(" without a name") : " named " + message_name);
 
         // Read the object
-        auto object_array = message->getObjectArray();
-        if(!object_array.empty()) {
-            const Object& first_object = object_array[0];
-            auto* cls = TClass::GetClass(typeid(first_object));
-
-            // Remove the allpix prefix
-            std::string class_name = cls->GetName();
-            std::string apx_namespace = "allpix::";
-            size_t ap_idx = class_name.find(apx_namespace);
-            if(ap_idx != std::string::npos) {
-                class_name.replace(ap_idx, apx_namespace.size(), "");
+        if(message->getObjectCount() > 0) {
+            auto selected = selected_types_.find(typeid(*inst));
+            if(selected == selected_types_.end()) {
+                auto* cls = TClass::GetClass(typeid(message->getObject(0)));
+
+                // Remove the allpix prefix
+                std::string class_name = cls->GetName();
+                std::string apx_namespace = "allpix::";
+                size_t ap_idx = class_name.find(apx_namespace);
+                if(ap_idx != std::string::npos) {
+                    class_name.replace(ap_idx, apx_namespace.size(), "");
+                }
+
+                // Check if messages of this type should be kept
+                bool keep = (include_.empty() || include_.find(class_name) != include_.end()) &&
+                            (exclude_.empty() || exclude_.find(class_name) == exclude_.end());
+                selected = selected_types_.emplace(typeid(*inst), keep).first;
             }
-
-            // Check if this message should be kept
-            if((!include_.empty() && include_.find(class_name) == include_.end()) ||
-               (!exclude_.empty() && exclude_.find(class_name) != exclude_.end())) {
+            if(!selected->second) {
                 LOG(TRACE) << "Text writer ignored message with object " << allpix::demangle(typeid(*inst).name())
                            << " because it has been excluded or not explicitly included";
                 return;
@@ -111,19 +119,19 @@ void TextWriterModule::receive(std::shared_ptr<BaseMessage> message, std::string
 void TextWriterModule::run(unsigned int event_num) {
     LOG(TRACE) << "Writing new objects to text file";
 
-    // Print the current event:
-    *output_file_ << "=== " << event_num << " ===" << std::endl;
+    // Print the current event, lines are not flushed to only write to the file when the buffer is full:
+    *output_file_ << "=== " << event_num << " ===\n";
 
     for(auto& message : keep_messages_) {
         // Print the current detector:
         if(message->getDetector() != nullptr) {
-            *output_file_ << "--- " << message->getDetector()->getName() << " ---" << std::endl;
+            *output_file_ << "--- " << message->getDetector()->getName() << " ---\n";
         } else {
-            *output_file_ << "--- <global> ---" << std::endl;
+            *output_file_ << "--- <global> ---\n";
         }
-        for(auto& object : message->getObjectArray()) {
+        for(size_t i = 0; i < message->getObjectCount(); ++i) {
             // Print the object's ASCII representation:
-            *output_file_ << object << std::endl;
+            *output_file_ << message->getObject(i) << '\n';
             write_cnt_++;
         }
         msg_cnt_++;
@@ -10,6 +10,9 @@
 #include <fstream>
 #include <map>
 #include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
 
 #include "core/config/Configuration.hpp"
 #include "core/geometry/GeometryManager.hpp"
@@ -64,9 +67,13 @@ namespace allpix {
         // Object names to include or exclude from writing
         std::set<std::string> include_;
         std::set<std::string> exclude_;
+        // Selection of every message type received so far
+        std::unordered_map<std::type_index, bool> selected_types_;
 
         // Output data file to write
         std::string output_file_name_{};
+        // Buffer of the output stream, declared before the stream to outlive it
+        std::vector<char> output_buffer_;
         std::unique_ptr<std::ofstream> output_file_;
 
         // List of messages to keep so they can be stored in the tree
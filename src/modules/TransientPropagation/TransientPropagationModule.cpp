@@ -9,22 +9,47 @@
 
 #include "TransientPropagationModule.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <future>
+#include <limits>
 #include <map>
 #include <memory>
+#include <numeric>
 #include <random>
+#include <sstream>
 #include <string>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 #include <Eigen/Core>
 
+#include "core/utils/annotation.h"
 #include "core/utils/log.h"
 #include "objects/PixelCharge.hpp"
+#include "objects/PixelIndexMap.hpp"
 #include "objects/PropagatedCharge.hpp"
 #include "tools/runge_kutta.h"
+#include "tools/spatial_order.h"
 
 using namespace allpix;
 using namespace ROOT::Math;
 
+namespace {
+    /**
+     * @brief Result of a task propagating a range of sets of charges
+     */
+    struct TaskResult {
+        // Propagated charges in the order the sets were propagated in
+        std::vector<PropagatedCharge> charges;
+        // Pulses accumulated over all sets of the task and the positions of the contributing sets in the list of all sets,
+        // only filled if the pulses are accumulated per event
+        PixelIndexMap<std::pair<Pulse, std::vector<size_t>>> pulses;
+    };
+} // namespace
+
 TransientPropagationModule::TransientPropagationModule(Configuration& config,
                                                        Messenger* messenger,
                                                        std::shared_ptr<Detector> detector)
@@ -38,40 +63,77 @@ TransientPropagationModule::TransientPropagationModule(Configuration& config,
     model_ = detector_->getModel();
 
     // Require deposits message for single detector:
-    messenger_->bindSingle(this, &TransientPropagationModule::deposits_message_, MsgFlags::REQUIRED);
-
-    // Seed the random generator with the module seed
-    random_generator_.seed(getRandomSeed());
+    messenger_->bindSingle<DepositedChargeMessage>(this, MsgFlags::REQUIRED);
 
     // Set default value for config variables
     config_.setDefault<double>("timestep", Units::get(0.01, "ns"));
     config_.setDefault<double>("integration_time", Units::get(25, "ns"));
     config_.setDefault<unsigned int>("charge_per_step", 10);
+    config_.setDefault<unsigned int>("sets_per_task", 64);
+    config_.setDefault<bool>("spatial_sorting", false);
+    config_.setDefault<bool>("accumulate_pulses", false);
+    config_.setDefault<std::string>("integrator", "rk5");
     config_.setDefault<double>("temperature", 293.15);
+    config_.setDefault<std::string>("mobility_model", "jacoboni");
+    config_.setDefault<double>("doping_concentration", 0);
+    config_.setDefault<size_t>("mobility_table_bins", 0);
+    config_.setDefault<double>("mobility_table_max_field", Units::get(100.0, "kV/cm"));
+    config_.setDefault<bool>("fast_math", false);
+    config_.setDefault<double>("fluence", 0);
     config_.setDefault<bool>("output_plots", false);
     config_.setDefault<XYVectorInt>("induction_matrix", XYVectorInt(3, 3));
     config_.setDefault<bool>("ignore_magnetic_field", false);
+    config_.setDefault<double>("induction_threshold", 0);
+    config_.setDefault<bool>("use_weighting_field", false);
 
     // Copy some variables from configuration to avoid lookups:
     temperature_ = config_.get<double>("temperature");
     timestep_ = config_.get<double>("timestep");
     integration_time_ = config_.get<double>("integration_time");
+    charge_per_step_ = config_.getParameter<unsigned int>("charge_per_step");
+    sets_per_task_ = config_.get<unsigned int>("sets_per_task");
+    if(sets_per_task_ == 0) {
+        throw InvalidValueError(config_, "sets_per_task", "number of sets of charges per task should be strictly positive");
+    }
+    spatial_sorting_ = config_.get<bool>("spatial_sorting");
+    accumulate_pulses_ = config_.get<bool>("accumulate_pulses");
+    auto integrator = config_.get<std::string>("integrator");
+    std::transform(integrator.begin(), integrator.end(), integrator.begin(), ::tolower);
+    if(integrator == "rk5") {
+        integrator_ = Integrator::RK5;
+    } else if(integrator == "rk4") {
+        integrator_ = Integrator::RK4;
+    } else if(integrator == "euler") {
+        integrator_ = Integrator::EULER;
+    } else {
+        throw InvalidValueError(config_, "integrator", "integrator should be 'rk5', 'rk4' or 'euler'");
+    }
+    integration_steps_ = &get_counter("integration_steps");
     matrix_ = config_.get<XYVectorInt>("induction_matrix");
+    induction_threshold_ = config_.get<double>("induction_threshold");
+    use_weighting_field_ = config_.get<bool>("use_weighting_field");
+    if(induction_threshold_ < 0) {
+        throw InvalidValueError(config_, "induction_threshold", "threshold of the potential change cannot be negative");
+    }
 
     if(matrix_.x() % 2 == 0 || matrix_.y() % 2 == 0) {
         throw InvalidValueError(config_, "induction_matrix", "Odd number of pixels in x and y required.");
     }
 
     output_plots_ = config_.get<bool>("output_plots");
+    fast_math_ = config_.get<bool>("fast_math");
+    roi_ = RegionOfInterest(config_, *detector_);
 
-    // Parameterization variables from https://doi.org/10.1016/0038-1101(77)90054-5 (section 5.2)
-    electron_Vm_ = Units::get(1.53e9 * std::pow(temperature_, -0.87), "cm/s");
-    electron_Ec_ = Units::get(1.01 * std::pow(temperature_, 1.55), "V/cm");
-    electron_Beta_ = 2.57e-2 * std::pow(temperature_, 0.66);
+    // Create the mobility model and tabulate it for both carrier types if requested
+    mobility_model_ = create_mobility_model(config_, temperature_);
+    mobility_tables_ = create_mobility_tables(config_, mobility_model_.get());
 
-    hole_Vm_ = Units::get(1.62e8 * std::pow(temperature_, -0.52), "cm/s");
-    hole_Ec_ = Units::get(1.24 * std::pow(temperature_, 1.68), "V/cm");
-    hole_Beta_ = 0.46 * std::pow(temperature_, 0.17);
+    // Effective trapping times of electrons and holes, infinite without irradiation
+    auto fluence = config_.get<double>("fluence");
+    if(fluence < 0) {
+        throw InvalidValueError(config_, "fluence", "fluence cannot be negative");
+    }
+    trapping_times_ = effective_trapping_times(fluence, temperature_);
 
     boltzmann_kT_ = Units::get(8.6173e-5, "eV/K") * temperature_;
 
@@ -98,6 +160,49 @@ void TransientPropagationModule::init() {
         throw ModuleError("This module cannot be used with linear electric fields.");
     }
 
+    // The weighting field is only available if derived from the potential by the WeightingPotentialReader
+    if(use_weighting_field_) {
+        if(detector_->hasWeightingField()) {
+            LOG(INFO) << "Calculating the induced charge from the weighting field";
+        } else {
+            LOG(WARNING) << "This detector does not have a weighting field, calculating the induced charge from the "
+                            "weighting potential instead";
+            use_weighting_field_ = false;
+        }
+    }
+
+    // Report the mobility model and its tabulation
+    auto mobility_table_bins = config_.get<size_t>("mobility_table_bins");
+    if(mobility_table_bins > 0) {
+        LOG(INFO) << "Tabulated " << config_.get<std::string>("mobility_model") << " mobility model in "
+                  << mobility_table_bins << " bins up to "
+                  << Units::display(config_.get<double>("mobility_table_max_field"), {"V/cm", "kV/cm"});
+    } else {
+        LOG(DEBUG) << "Using " << config_.get<std::string>("mobility_model") << " mobility model";
+    }
+    if(fast_math_) {
+        LOG(INFO) << "Using fast approximations of the mobility and the Ziggurat sampler for the diffusion";
+    }
+    if(roi_.isRestricted()) {
+        LOG(INFO) << "Propagating only charges deposited in the region of interest of " << roi_.describe();
+    }
+
+    if(std::isfinite(trapping_times_[0])) {
+        LOG(INFO) << "Effective trapping time of electrons " << Units::display(trapping_times_[0], {"ps", "ns"})
+                  << " and of holes " << Units::display(trapping_times_[1], {"ps", "ns"});
+    }
+
+    // Estimate the maximum gradients of the weighting potential to prune the induction matrix
+    if(induction_threshold_ > 0) {
+        ramo_gradients_ = calculate_ramo_gradients();
+        std::stringstream gradients;
+        for(size_t ring = 0; ring < ramo_gradients_.size(); ++ring) {
+            gradients << (ring == 0 ? "" : ", ") << ramo_gradients_[ring] * Units::get(1.0, "um");
+        }
+        LOG(INFO) << "Maximum weighting potential gradients per ring of the induction matrix: " << gradients.str()
+                  << " per um";
+    }
+
     // Check for magnetic field
     has_magnetic_field_ = detector->hasMagneticField();
     if(has_magnetic_field_) {
@@ -107,53 +212,64 @@ void TransientPropagationModule::init() {
         } else {
             LOG(DEBUG) << "This detector sees a magnetic field.";
             magnetic_field_ = detector_->getMagneticField();
+            has_magnetic_field_grid_ = detector_->hasMagneticFieldGrid();
         }
     }
 
     if(output_plots_) {
-        potential_difference_ =
-            new TH1D("potential_difference",
-                     "Weighting potential difference between two steps;#left|#Delta#phi_{w}#right| [a.u.];events",
-                     500,
-                     0,
-                     1);
-        induced_charge_histo_ = new TH1D("induced_charge_histo",
-                                         "Induced charge per time, all pixels;Drift time [ns];charge [e]",
-                                         static_cast<int>(integration_time_ / timestep_),
-                                         0,
-                                         static_cast<double>(Units::convert(integration_time_, "ns")));
-        induced_charge_e_histo_ = new TH1D("induced_charge_e_histo",
-                                           "Induced charge per time, electrons only, all pixels;Drift time [ns];charge [e]",
-                                           static_cast<int>(integration_time_ / timestep_),
-                                           0,
-                                           static_cast<double>(Units::convert(integration_time_, "ns")));
-        induced_charge_h_histo_ = new TH1D("induced_charge_h_histo",
-                                           "Induced charge per time, holes only, all pixels;Drift time [ns];charge [e]",
-                                           static_cast<int>(integration_time_ / timestep_),
-                                           0,
-                                           static_cast<double>(Units::convert(integration_time_, "ns")));
-        step_length_histo_ = new TH1D("step_length_histo",
-                                      "Step length;length [#mum];integration steps",
-                                      100,
-                                      0,
-                                      static_cast<double>(Units::convert(0.25 * model_->getSensorSize().z(), "um")));
-
-        drift_time_histo_ = new TH1D("drift_time_histo",
-                                     "Drift time;Drift time [ns];charge carriers",
-                                     static_cast<int>(Units::convert(integration_time_, "ns") * 5),
-                                     0,
-                                     static_cast<double>(Units::convert(integration_time_, "ns")));
+        potential_difference_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "potential_difference",
+            "Weighting potential difference between two steps;#left|#Delta#phi_{w}#right| [a.u.];events",
+            500,
+            0,
+            1);
+        induced_charge_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "induced_charge_histo",
+            "Induced charge per time, all pixels;Drift time [ns];charge [e]",
+            static_cast<int>(integration_time_ / timestep_),
+            0,
+            static_cast<double>(Units::convert(integration_time_, "ns")));
+        induced_charge_e_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "induced_charge_e_histo",
+            "Induced charge per time, electrons only, all pixels;Drift time [ns];charge [e]",
+            static_cast<int>(integration_time_ / timestep_),
+            0,
+            static_cast<double>(Units::convert(integration_time_, "ns")));
+        induced_charge_h_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "induced_charge_h_histo",
+            "Induced charge per time, holes only, all pixels;Drift time [ns];charge [e]",
+            static_cast<int>(integration_time_ / timestep_),
+            0,
+            static_cast<double>(Units::convert(integration_time_, "ns")));
+        step_length_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "step_length_histo",
+            "Step length;length [#mum];integration steps",
+            100,
+            0,
+            static_cast<double>(Units::convert(0.25 * model_->getSensorSize().z(), "um")));
+
+        drift_time_histo_ = std::make_unique<ThreadedHistogram<TH1D>>(
+            "drift_time_histo",
+            "Drift time;Drift time [ns];charge carriers",
+            static_cast<int>(Units::convert(integration_time_, "ns") * 5),
+            0,
+            static_cast<double>(Units::convert(integration_time_, "ns")));
     }
 }
 
-void TransientPropagationModule::run(unsigned int) {
+void TransientPropagationModule::run(Event* event) {
+    auto deposits_message = messenger_->fetchMessage<DepositedChargeMessage>(this, event);
 
-    // Create vector of propagated charges to output
-    std::vector<PropagatedCharge> propagated_charges;
-
-    // Loop over all deposits for propagation
+    // Split all deposits into sets of charges to propagate
     LOG(TRACE) << "Propagating charges in sensor";
-    for(auto& deposit : deposits_message_->getData()) {
+    std::vector<std::pair<const DepositedCharge*, unsigned int>> charge_sets;
+    for(auto& deposit : deposits_message->getData()) {
+
+        // Skip deposits which cannot reach the region of interest before any integration of their paths
+        if(!roi_.contains(deposit.getLocalPosition())) {
+            ++skipped_deposits_;
+            continue;
+        }
 
         // Loop over all charges in the deposit
         unsigned int charges_remaining = deposit.getCharge();
@@ -161,76 +277,197 @@ void TransientPropagationModule::run(unsigned int) {
         LOG(DEBUG) << "Set of charge carriers (" << deposit.getType() << ") on "
                    << Units::display(deposit.getLocalPosition(), {"mm", "um"});
 
-        auto charge_per_step = config_.get<unsigned int>("charge_per_step");
+        unsigned int charge_per_step = charge_per_step_;
         while(charges_remaining > 0) {
             // Define number of charges to be propagated and remove charges of this step from the total
             if(charge_per_step > charges_remaining) {
                 charge_per_step = charges_remaining;
             }
             charges_remaining -= charge_per_step;
+            charge_sets.emplace_back(&deposit, charge_per_step);
+        }
+    }
 
-            // Get position and propagate through sensor
-            auto position = deposit.getLocalPosition();
+    // Propagate the sets of charges along a space-filling curve if requested, such that consecutive sets access the same
+    // regions of the field maps
+    std::vector<size_t> order(charge_sets.size());
+    if(spatial_sorting_) {
+        order = morton_order(charge_sets, [](const std::pair<const DepositedCharge*, unsigned int>& charge_set) {
+            return charge_set.first->getLocalPosition();
+        });
+    } else {
+        std::iota(order.begin(), order.end(), 0);
+    }
+
+    // Propagate a range of sets of charges, every set uses its own random engine such that the result does not depend on
+    // the number of tasks, the worker executing them or the order of the sets
+    auto propagate_sets = [this, event, &charge_sets, &order](size_t start, size_t end) {
+        PROFILER_RANGE("TransientPropagation::propagate_sets");
+        TaskResult result;
+        result.charges.reserve(end - start);
+        for(size_t pos = start; pos < end; ++pos) {
+            auto idx = order[pos];
+            const auto& deposit = *charge_sets[idx].first;
+            auto charge = charge_sets[idx].second;
+            auto random_engine = getRandomStream(event, idx);
 
             // Propagate a single charge deposit
             std::map<Pixel::Index, Pulse> px_map;
-            auto prop_pair = propagate(position, deposit.getType(), charge_per_step, px_map);
+            auto prop_pair = propagate(deposit.getLocalPosition(), deposit.getType(), charge, px_map, random_engine);
+
+            // Add the induced pulses to the pulses of the task instead of storing them with the propagated charge
+            if(accumulate_pulses_) {
+                for(auto& pulse : px_map) {
+                    auto& pixel = result.pulses[pulse.first];
+                    pixel.first += pulse.second;
+                    pixel.second.push_back(idx);
+                }
+                px_map.clear();
+            }
 
             // Create a new propagated charge and add it to the list
             auto global_position = detector_->getGlobalPosition(prop_pair.first);
             PropagatedCharge propagated_charge(prop_pair.first,
                                                global_position,
                                                deposit.getType(),
-                                               px_map,
+                                               std::move(px_map),
                                                deposit.getEventTime() + prop_pair.second,
                                                &deposit);
 
-            LOG(DEBUG) << " Propagated " << charge_per_step << " to " << Units::display(prop_pair.first, {"mm", "um"})
-                       << " in " << Units::display(prop_pair.second, "ns") << " time, induced "
+            LOG(DEBUG) << " Propagated " << charge << " to " << Units::display(prop_pair.first, {"mm", "um"}) << " in "
+                       << Units::display(prop_pair.second, "ns") << " time, induced "
                        << Units::display(propagated_charge.getCharge(), {"e"});
 
-            propagated_charges.push_back(std::move(propagated_charge));
+            result.charges.push_back(std::move(propagated_charge));
 
             if(output_plots_) {
-                drift_time_histo_->Fill(static_cast<double>(Units::convert(prop_pair.second, "ns")), charge_per_step);
+                drift_time_histo_->Fill(prop_pair.second / units::ns, charge);
             }
         }
+        return result;
+    };
+
+    // Submit the sets of charges in tasks which can be executed by idle workers, and help executing them
+    auto& thread_pool = getThreadPool();
+    ThreadPool::TaskGroup task_group;
+    std::vector<std::future<TaskResult>> tasks;
+    for(size_t start = 0; start < charge_sets.size(); start += sets_per_task_) {
+        auto end = std::min(start + sets_per_task_, charge_sets.size());
+        tasks.push_back(thread_pool.submit(task_group, propagate_sets, start, end));
+    }
+    thread_pool.wait_for(task_group);
+
+    // Merge the propagated charges of all tasks, in the order of the deposits also if the sets were sorted, and the pulses
+    // of all tasks into a single buffer for the event
+    auto propagated_charges = MessageStorage<PropagatedCharge>::acquire();
+    propagated_charges.reserve(charge_sets.size());
+    PixelIndexMap<std::pair<Pulse, std::vector<size_t>>> event_pulses;
+    std::vector<PropagatedCharge> sorted_charges;
+    if(spatial_sorting_) {
+        sorted_charges.reserve(charge_sets.size());
+    }
+    for(auto& task : tasks) {
+        auto result = task.get();
+        for(auto& propagated_charge : result.charges) {
+            (spatial_sorting_ ? sorted_charges : propagated_charges).push_back(std::move(propagated_charge));
+        }
+        for(auto& pulse : result.pulses) {
+            auto& pixel = event_pulses[pulse.first];
+            pixel.first += pulse.second.first;
+            pixel.second.insert(pixel.second.end(), pulse.second.second.begin(), pulse.second.second.end());
+        }
+    }
+    if(spatial_sorting_) {
+        std::vector<size_t> positions(order.size());
+        for(size_t pos = 0; pos < order.size(); ++pos) {
+            positions[order[pos]] = pos;
+        }
+        for(auto pos : positions) {
+            propagated_charges.push_back(std::move(sorted_charges[pos]));
+        }
     }
 
     // Create a new message with propagated charges
     auto propagated_charge_message = std::make_shared<PropagatedChargeMessage>(std::move(propagated_charges), detector_);
 
     // Dispatch the message with propagated charges
-    messenger_->dispatchMessage(this, propagated_charge_message);
+    messenger_->dispatchMessage(this, propagated_charge_message, event);
+
+    if(!accumulate_pulses_) {
+        return;
+    }
+
+    // Create the pixel charges from the accumulated pulses, referring to the propagated charges of the dispatched message
+    const auto& dispatched_charges = propagated_charge_message->getData();
+    auto pixel_charges = MessageStorage<PixelCharge>::acquire();
+    pixel_charges.reserve(event_pulses.size());
+    double total_charge = 0;
+    for(auto& pixel_index_pulse : event_pulses) {
+        auto& pulse = pixel_index_pulse.second.first;
+        auto& sets = pixel_index_pulse.second.second;
+
+        // Store the history in the order of the deposits, the tasks do not cover consecutive sets if they were sorted
+        std::sort(sets.begin(), sets.end());
+        std::vector<const PropagatedCharge*> history;
+        history.reserve(sets.size());
+        for(auto idx : sets) {
+            history.push_back(&dispatched_charges[idx]);
+        }
+
+        total_charge += pulse.getCharge();
+        LOG(DEBUG) << "Charge on pixel " << pixel_index_pulse.first << " has " << history.size() << " ancestors";
+        pixel_charges.emplace_back(detector_->getPixel(pixel_index_pulse.first), std::move(pulse), std::move(history));
+    }
+
+    // Dispatch the message with the pixel charges of the event
+    auto pixel_charge_message = std::make_shared<PixelChargeMessage>(std::move(pixel_charges), detector_);
+    messenger_->dispatchMessage(this, pixel_charge_message, event);
+
+    LOG(INFO) << "Total charge induced on all pixels: " << Units::display(total_charge, "e");
 }
 
 /**
- * Propagation is simulated using a parameterization for the electron mobility. This is used to calculate the electron
- * velocity at every point with help of the electric field map of the detector. A Runge-Kutta integration is applied in
- * multiple steps, adding a random diffusion to the propagating charge every step.
+ * The integration method is selected once per set of charges, every method is compiled into its own propagation kernel
+ * with the coefficients of its tableau known at compile time.
  */
 std::pair<ROOT::Math::XYZPoint, double> TransientPropagationModule::propagate(const ROOT::Math::XYZPoint& pos,
                                                                               const CarrierType& type,
                                                                               const unsigned int charge,
-                                                                              std::map<Pixel::Index, Pulse>& pixel_map) {
+                                                                              std::map<Pixel::Index, Pulse>& pixel_map,
+                                                                              CounterRandomEngine& random_generator) {
+    switch(integrator_) {
+    case Integrator::RK4:
+        return propagate_integrated(butcher::RK4, pos, type, charge, pixel_map, random_generator);
+    case Integrator::EULER:
+        return propagate_integrated(butcher::EULER, pos, type, charge, pixel_map, random_generator);
+    default:
+        return propagate_integrated(butcher::RK5, pos, type, charge, pixel_map, random_generator);
+    }
+}
+
+/**
+ * Propagation is simulated using a parameterization for the electron mobility. This is used to calculate the electron
+ * velocity at every point with help of the electric field map of the detector. A Runge-Kutta integration is applied in
+ * multiple steps, adding a random diffusion to the propagating charge every step.
+ */
+template <typename Tableau>
+std::pair<ROOT::Math::XYZPoint, double>
+TransientPropagationModule::propagate_integrated(const Tableau& tableau,
+                                                 const ROOT::Math::XYZPoint& pos,
+                                                 const CarrierType& type,
+                                                 const unsigned int charge,
+                                                 std::map<Pixel::Index, Pulse>& pixel_map,
+                                                 CounterRandomEngine& random_generator) {
 
     // Create a runge kutta solver using the electric field as step function
     Eigen::Vector3d position(pos.x(), pos.y(), pos.z());
 
-    // Define a lambda function to compute the carrier mobility
+    // Flattened geometry of the detector, read in every step instead of the virtual getters of the model
+    const auto& geometry = detector_->getGeometry();
+
+    // Mobility of the carrier type as function of the electric field magnitude
     // NOTE This function is typically the most frequently executed part of the framework and therefore the bottleneck
-    auto carrier_mobility = [&](double efield_mag) {
-        // Compute carrier mobility from constants and electric field magnitude
-        double numerator, denominator;
-        if(type == CarrierType::ELECTRON) {
-            numerator = electron_Vm_ / electron_Ec_;
-            denominator = std::pow(1. + std::pow(efield_mag / electron_Ec_, electron_Beta_), 1.0 / electron_Beta_);
-        } else {
-            numerator = hole_Vm_ / hole_Ec_;
-            denominator = std::pow(1. + std::pow(efield_mag / hole_Ec_, hole_Beta_), 1.0 / hole_Beta_);
-        }
-        return numerator / denominator;
-    };
+    const auto& carrier_mobility = mobility_tables_[type == CarrierType::ELECTRON ? 0 : 1];
 
     // Define a function to compute the diffusion
     auto carrier_diffusion = [&](double efield_mag, double timestep) -> Eigen::Vector3d {
@@ -238,30 +475,35 @@ std::pair<ROOT::Math::XYZPoint, double> TransientPropagationModule::propagate(co
         double diffusion_std_dev = std::sqrt(2. * diffusion_constant * timestep);
 
         // Compute the independent diffusion in three
-        std::normal_distribution<double> gauss_distribution(0, diffusion_std_dev);
         Eigen::Vector3d diffusion;
+        if(fast_math_) {
+            for(int i = 0; i < 3; ++i) {
+                diffusion[i] = diffusion_std_dev * normal_sampler_(random_generator);
+            }
+            return diffusion;
+        }
+        std::normal_distribution<double> gauss_distribution(0, diffusion_std_dev);
         for(int i = 0; i < 3; ++i) {
-            diffusion[i] = gauss_distribution(random_generator_);
+            diffusion[i] = gauss_distribution(random_generator);
         }
         return diffusion;
     };
 
-    // Define lambda functions to compute the charge carrier velocity with or without magnetic field
-    std::function<Eigen::Vector3d(double, const Eigen::Vector3d&)> carrier_velocity_noB =
-        [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
-        auto raw_field = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(cur_pos));
-        Eigen::Vector3d efield(raw_field.x(), raw_field.y(), raw_field.z());
-
-        return static_cast<int>(type) * carrier_mobility(efield.norm()) * efield;
-    };
+    // Look up the electric field along the path of this set of charges, reusing the grid values of the last bin
+    auto efield_cursor = detector_->getElectricFieldCursor();
 
-    std::function<Eigen::Vector3d(double, const Eigen::Vector3d&)> carrier_velocity_withB =
-        [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
-        auto raw_field = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(cur_pos));
+    // Define a lambda function to compute the charge carrier velocity with or without magnetic field
+    // NOTE The lambda is passed to the Runge-Kutta solver with its own type such that it can be inlined in every stage
+    auto carrier_velocity = [&](double, const Eigen::Vector3d& cur_pos) -> Eigen::Vector3d {
+        auto raw_field = efield_cursor.get(cur_pos);
         Eigen::Vector3d efield(raw_field.x(), raw_field.y(), raw_field.z());
 
-        Eigen::Vector3d velocity;
-        Eigen::Vector3d bfield(magnetic_field_.x(), magnetic_field_.y(), magnetic_field_.z());
+        if(!has_magnetic_field_) {
+            return static_cast<int>(type) * carrier_mobility(efield.norm()) * efield;
+        }
+
+        auto raw_bfield = (has_magnetic_field_grid_ ? detector_->getMagneticField(cur_pos) : magnetic_field_);
+        Eigen::Vector3d bfield(raw_bfield.x(), raw_bfield.y(), raw_bfield.z());
 
         auto mob = carrier_mobility(efield.norm());
         auto exb = efield.cross(bfield);
@@ -276,16 +518,28 @@ std::pair<ROOT::Math::XYZPoint, double> TransientPropagationModule::propagate(co
         return static_cast<int>(type) * mob * (efield + term1 + term2) / rnorm;
     };
 
-    // Create the runge kutta solver with an RKF5 tableau
-    auto runge_kutta = make_runge_kutta(
-        tableau::RK5, (has_magnetic_field_ ? carrier_velocity_withB : carrier_velocity_noB), timestep_, position);
+    // Create the runge kutta solver with the tableau of the selected method
+    auto runge_kutta = make_runge_kutta(tableau, carrier_velocity, timestep_, position);
+
+    // Weighting potentials of the induction matrix at the current and previous position, the potentials of the previous
+    // step are reused if the matrix did not move or change its size
+    std::vector<double> ramo, last_ramo;
+    std::tuple<int, int, int, int> ramo_origin{std::numeric_limits<int>::min(), std::numeric_limits<int>::min(), 0, 0};
 
-    // Continue propagation until the deposit is outside the sensor
+    // Weighting fields of the induction matrix at the midpoint of the step if the induced charge is calculated from them
+    std::vector<ROOT::Math::XYZVector> ramo_field;
+
+    // Draw the time after which the charges are trapped and stop inducing a signal
+    auto trap_time = draw_trapping_time(trapping_times_[type == CarrierType::ELECTRON ? 0 : 1], random_generator);
+
+    // Continue propagation until the deposit is outside the sensor or trapped
     Eigen::Vector3d last_position = position;
     bool within_sensor = true;
-    while(within_sensor && runge_kutta.getTime() < integration_time_) {
+    uint64_t step_count = 0;
+    while(within_sensor && runge_kutta.getTime() < integration_time_ && runge_kutta.getTime() < trap_time) {
         // Save previous position and time
         last_position = position;
+        ++step_count;
 
         // Execute a Runge Kutta step
         auto step = runge_kutta.step();
@@ -294,7 +548,7 @@ std::pair<ROOT::Math::XYZPoint, double> TransientPropagationModule::propagate(co
         position = runge_kutta.getValue();
 
         // Get electric field at current position and fall back to empty field if it does not exist
-        auto efield = detector_->getElectricField(static_cast<ROOT::Math::XYZPoint>(position));
+        auto efield = efield_cursor.get(position);
 
         // Apply diffusion step
         auto diffusion = carrier_diffusion(std::sqrt(efield.Mag2()), timestep_);
@@ -307,14 +561,14 @@ std::pair<ROOT::Math::XYZPoint, double> TransientPropagationModule::propagate(co
         }
 
         // Check for overshooting outside the sensor and correct for it:
-        if(!detector_->isWithinSensor(static_cast<ROOT::Math::XYZPoint>(position))) {
+        if(!detector_->isWithinSensor(position)) {
             LOG(TRACE) << "Carrier outside sensor: " << Units::display(static_cast<ROOT::Math::XYZPoint>(position), {"nm"});
             // within_sensor = false;
 
             auto check_position = position;
             check_position.z() = last_position.z();
             // Correct for position in z by interpolation to increase precision:
-            if(detector_->isWithinSensor(static_cast<ROOT::Math::XYZPoint>(check_position))) {
+            if(detector_->isWithinSensor(check_position)) {
                 // FIXME this currently depends in the direction of the drift
                 if(position.z() > 0 && type == CarrierType::HOLE) {
                     LOG(DEBUG) << "Not stopping carrier " << type << " at "
@@ -327,8 +581,8 @@ std::pair<ROOT::Math::XYZPoint, double> TransientPropagationModule::propagate(co
                 }
 
                 // Carrier left sensor on top or bottom surface, interpolate
-                auto z_cur_border = std::fabs(position.z() - model_->getSensorSize().z() / 2.0);
-                auto z_last_border = std::fabs(model_->getSensorSize().z() / 2.0 - last_position.z());
+                auto z_cur_border = std::fabs(position.z() - geometry.sensor_size[2] / 2.0);
+                auto z_last_border = std::fabs(geometry.sensor_size[2] / 2.0 - last_position.z());
                 auto z_total = z_cur_border + z_last_border;
                 position = (z_last_border / z_total) * position + (z_cur_border / z_total) * last_position;
                 LOG(TRACE) << "Moved carrier to: " << Units::display(static_cast<ROOT::Math::XYZPoint>(position), {"nm"});
@@ -338,39 +592,88 @@ std::pair<ROOT::Math::XYZPoint, double> TransientPropagationModule::propagate(co
         }
 
         // Find the nearest pixel
-        auto xpixel = static_cast<int>(std::round(position.x() / model_->getPixelSize().x()));
-        auto ypixel = static_cast<int>(std::round(position.y() / model_->getPixelSize().y()));
+        auto xpixel = geometry.nearestColumn(position.x());
+        auto ypixel = geometry.nearestRow(position.y());
         LOG(TRACE) << "Moving carriers below pixel "
                    << Pixel::Index(static_cast<unsigned int>(xpixel), static_cast<unsigned int>(ypixel)) << " from "
                    << Units::display(static_cast<ROOT::Math::XYZPoint>(last_position), {"um", "mm"}) << " to "
                    << Units::display(static_cast<ROOT::Math::XYZPoint>(position), {"um", "mm"}) << ", "
                    << Units::display(runge_kutta.getTime(), "ns");
 
+        // Only keep the rings of the induction matrix around the nearest pixel for which the change of the weighting
+        // potential over this step can exceed the threshold
+        auto ring_x = matrix_.x() / 2;
+        auto ring_y = matrix_.y() / 2;
+        if(induction_threshold_ > 0) {
+            auto step_length = (position - last_position).norm();
+            int rings = static_cast<int>(ramo_gradients_.size()) - 1;
+            while(rings > 0 && ramo_gradients_[static_cast<size_t>(rings)] * step_length < induction_threshold_) {
+                --rings;
+            }
+            ring_x = std::min(ring_x, rings);
+            ring_y = std::min(ring_y, rings);
+        }
+
+        // Retrieve the weighting potentials of all NxN pixels at once:
+        auto x_first = xpixel - ring_x;
+        auto y_first = ypixel - ring_y;
+        auto matrix_size_x = static_cast<size_t>(2 * ring_x + 1);
+        auto matrix_size_y = static_cast<size_t>(2 * ring_y + 1);
+        Eigen::Vector3d displacement = position - last_position;
+        if(use_weighting_field_) {
+            // The induced current q v.E_w is integrated over the step using the weighting field at its midpoint
+            Eigen::Vector3d midpoint = last_position + displacement / 2;
+            detector_->getWeightingField(ROOT::Math::XYZPoint(midpoint.x(), midpoint.y(), midpoint.z()),
+                                         x_first,
+                                         y_first,
+                                         matrix_size_x,
+                                         matrix_size_y,
+                                         ramo_field);
+        } else {
+            if(ramo_origin == std::make_tuple(x_first, y_first, ring_x, ring_y)) {
+                std::swap(ramo, last_ramo);
+            } else {
+                detector_->getWeightingPotential(last_position, x_first, y_first, matrix_size_x, matrix_size_y, last_ramo);
+            }
+            detector_->getWeightingPotential(position, x_first, y_first, matrix_size_x, matrix_size_y, ramo);
+            ramo_origin = std::make_tuple(x_first, y_first, ring_x, ring_y);
+        }
+
         // Loop over NxN pixels:
-        for(int x = xpixel - matrix_.x() / 2; x <= xpixel + matrix_.x() / 2; x++) {
-            for(int y = ypixel - matrix_.y() / 2; y <= ypixel + matrix_.y() / 2; y++) {
+        for(auto x = x_first; x < x_first + static_cast<int>(matrix_size_x); x++) {
+            for(auto y = y_first; y < y_first + static_cast<int>(matrix_size_y); y++) {
                 // Ignore if out of pixel grid
-                if(x < 0 || x >= model_->getNPixels().x() || y < 0 || y >= model_->getNPixels().y()) {
+                if(!geometry.isWithinPixelGrid(x, y)) {
                     LOG(TRACE) << "Pixel (" << x << "," << y << ") skipped, outside the grid";
                     continue;
                 }
 
                 Pixel::Index pixel_index(static_cast<unsigned int>(x), static_cast<unsigned int>(y));
-                auto ramo = detector_->getWeightingPotential(static_cast<ROOT::Math::XYZPoint>(position), pixel_index);
-                auto last_ramo =
-                    detector_->getWeightingPotential(static_cast<ROOT::Math::XYZPoint>(last_position), pixel_index);
+                auto matrix_index = static_cast<size_t>(x - x_first) * matrix_size_y + static_cast<size_t>(y - y_first);
+                double ramo_diff = 0;
+                if(use_weighting_field_) {
+                    // The weighting field is the negative gradient of the potential
+                    const auto& field = ramo_field[matrix_index];
+                    ramo_diff =
+                        -(field.x() * displacement.x() + field.y() * displacement.y() + field.z() * displacement.z());
+                } else {
+                    ramo_diff = ramo[matrix_index] - last_ramo[matrix_index];
+                }
 
                 // Induced charge on electrode is q_int = q * (phi(x1) - phi(x0))
-                auto induced = charge * (ramo - last_ramo) * (-static_cast<std::underlying_type<CarrierType>::type>(type));
-                LOG(TRACE) << "Pixel " << pixel_index << " dPhi = " << (ramo - last_ramo) << ", induced " << type
+                auto induced = charge * ramo_diff * (-static_cast<std::underlying_type<CarrierType>::type>(type));
+                LOG(TRACE) << "Pixel " << pixel_index << " dPhi = " << ramo_diff << ", induced " << type
                            << " q = " << Units::display(induced, "e");
 
-                // Create pulse if it doesn't exist. Store induced charge in the returned pulse iterator
-                auto pixel_map_iterator = pixel_map.emplace(pixel_index, Pulse(timestep_));
-                pixel_map_iterator.first->second.addCharge(induced, runge_kutta.getTime());
+                // Create pulse if it doesn't exist and store the induced charge, without constructing a temporary pulse
+                auto pixel_map_iterator = pixel_map.find(pixel_index);
+                if(pixel_map_iterator == pixel_map.end()) {
+                    pixel_map_iterator = pixel_map.emplace(pixel_index, Pulse(timestep_)).first;
+                }
+                pixel_map_iterator->second.addCharge(induced, runge_kutta.getTime());
 
                 if(output_plots_) {
-                    potential_difference_->Fill(std::fabs(ramo - last_ramo));
+                    potential_difference_->Fill(std::fabs(ramo_diff));
                     induced_charge_histo_->Fill(runge_kutta.getTime(), induced);
                     if(type == CarrierType::ELECTRON) {
                         induced_charge_e_histo_->Fill(runge_kutta.getTime(), induced);
@@ -382,17 +685,92 @@ std::pair<ROOT::Math::XYZPoint, double> TransientPropagationModule::propagate(co
         }
     }
 
+    *integration_steps_ += step_count;
+    ++propagated_sets_;
+    if(within_sensor && runge_kutta.getTime() >= trap_time && trap_time < integration_time_) {
+        trapped_charges_ += charge;
+    }
+
     // Return the final position of the propagated charge
     return std::make_pair(static_cast<ROOT::Math::XYZPoint>(position), runge_kutta.getTime());
 }
 
+/**
+ * The weighting potential of the matrix around the pixel at the origin is sampled on a regular grid within the cell of this
+ * pixel and over the full sensor thickness. The gradient is estimated at every sample from the differences to the next
+ * samples along all axes, and the maximum is taken for every ring of pixels at the same Chebyshev distance from the center
+ * of the matrix. The estimate can miss narrow peaks of the gradient between the samples, which is acceptable as the
+ * threshold is only used to neglect pixels with small induced signals.
+ */
+std::vector<double> TransientPropagationModule::calculate_ramo_gradients() const {
+    const int rings = std::max(matrix_.x(), matrix_.y()) / 2;
+    const auto size = static_cast<size_t>(2 * rings + 1);
+    const std::array<size_t, 3> samples{{11, 11, 101}};
+    const std::array<double, 3> spacing{{model_->getPixelSize().x() / static_cast<double>(samples[0] - 1),
+                                         model_->getPixelSize().y() / static_cast<double>(samples[1] - 1),
+                                         model_->getSensorSize().z() / static_cast<double>(samples[2] - 1)}};
+    const ROOT::Math::XYZPoint origin(-model_->getPixelSize().x() / 2,
+                                      -model_->getPixelSize().y() / 2,
+                                      model_->getSensorCenter().z() - model_->getSensorSize().z() / 2);
+
+    // Sample the potentials of all pixels of the matrix, stored by sample index first
+    auto sample_index = [&](size_t i, size_t j, size_t k) { return (i * samples[1] + j) * samples[2] + k; };
+    std::vector<std::vector<double>> potentials(samples[0] * samples[1] * samples[2]);
+    for(size_t i = 0; i < samples[0]; ++i) {
+        for(size_t j = 0; j < samples[1]; ++j) {
+            for(size_t k = 0; k < samples[2]; ++k) {
+                ROOT::Math::XYZPoint position(origin.x() + static_cast<double>(i) * spacing[0],
+                                              origin.y() + static_cast<double>(j) * spacing[1],
+                                              origin.z() + static_cast<double>(k) * spacing[2]);
+                detector_->getWeightingPotential(position, -rings, -rings, size, size, potentials[sample_index(i, j, k)]);
+            }
+        }
+    }
+
+    std::vector<double> gradients(static_cast<size_t>(rings) + 1, 0.);
+    for(size_t i = 0; i + 1 < samples[0]; ++i) {
+        for(size_t j = 0; j + 1 < samples[1]; ++j) {
+            for(size_t k = 0; k + 1 < samples[2]; ++k) {
+                const auto& potential = potentials[sample_index(i, j, k)];
+                const auto& next_x = potentials[sample_index(i + 1, j, k)];
+                const auto& next_y = potentials[sample_index(i, j + 1, k)];
+                const auto& next_z = potentials[sample_index(i, j, k + 1)];
+                for(size_t pixel = 0; pixel < potential.size(); ++pixel) {
+                    auto gradient_x = (next_x[pixel] - potential[pixel]) / spacing[0];
+                    auto gradient_y = (next_y[pixel] - potential[pixel]) / spacing[1];
+                    auto gradient_z = (next_z[pixel] - potential[pixel]) / spacing[2];
+                    auto gradient = std::sqrt(gradient_x * gradient_x + gradient_y * gradient_y + gradient_z * gradient_z);
+                    auto offset_x = std::abs(static_cast<int>(pixel / size) - rings);
+                    auto offset_y = std::abs(static_cast<int>(pixel % size) - rings);
+                    auto& maximum = gradients[static_cast<size_t>(std::max(offset_x, offset_y))];
+                    maximum = std::max(maximum, gradient);
+                }
+            }
+        }
+    }
+    return gradients;
+}
+
 void TransientPropagationModule::finalize() {
     if(output_plots_) {
-        potential_difference_->Write();
-        step_length_histo_->Write();
-        drift_time_histo_->Write();
-        induced_charge_histo_->Write();
-        induced_charge_e_histo_->Write();
-        induced_charge_h_histo_->Write();
+        potential_difference_->merge()->Write();
+        step_length_histo_->merge()->Write();
+        drift_time_histo_->merge()->Write();
+        induced_charge_histo_->merge()->Write();
+        induced_charge_e_histo_->merge()->Write();
+        induced_charge_h_histo_->merge()->Write();
+    }
+
+    if(propagated_sets_ > 0) {
+        LOG(INFO) << "Integrated the drift of " << propagated_sets_ << " sets of charges with the "
+                  << config_.get<std::string>("integrator") << " method in " << integration_steps_->load()
+                  << " steps, on average " << static_cast<double>(integration_steps_->load()) / propagated_sets_
+                  << " steps per set";
+    }
+    if(std::isfinite(trapping_times_[0])) {
+        LOG(INFO) << "Propagation of " << trapped_charges_ << " charges ended by trapping";
+    }
+    if(skipped_deposits_ > 0) {
+        LOG(INFO) << "Skipped " << skipped_deposits_ << " deposits outside of the region of interest";
     }
 }
@@ -7,7 +7,12 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <random>
 #include <string>
+#include <vector>
 
 #include <Math/DisplacementVector2D.h>
 #include <Math/Point3D.h>
@@ -17,10 +22,15 @@
 #include "core/geometry/DetectorModel.hpp"
 #include "core/messenger/Messenger.hpp"
 #include "core/module/Module.hpp"
+#include "core/module/ThreadedHistogram.hpp"
 
 #include "objects/DepositedCharge.hpp"
 #include "objects/Pulse.hpp"
 #include "tools/ROOT.h"
+#include "tools/fast_math.h"
+#include "tools/mobility.h"
+#include "tools/region_of_interest.h"
+#include "tools/trapping.h"
 
 namespace allpix {
     /**
@@ -49,8 +59,9 @@ namespace allpix {
 
         /**
          * @brief Propagate all deposited charges through the sensor
+         * @param event Pointer to the event to process
          */
-        void run(unsigned int) override;
+        void run(Event* event) override;
 
         /**
          * @brief Write statistical summary and histograms
@@ -62,7 +73,6 @@ namespace allpix {
         std::shared_ptr<const Detector> detector_;
         Messenger* messenger_;
         std::shared_ptr<DetectorModel> model_;
-        std::shared_ptr<DepositedChargeMessage> deposits_message_;
 
         /**
          * @brief Propagate a single set of charges through the sensor
@@ -71,28 +81,83 @@ namespace allpix {
          * @param charge    Total charge of the observed charge carrier set
          * @param pixel_map Map of surrounding pixels and their induced pulses. Provided as reference to store simulation
          *                  result in
+         * @param random_generator Random engine of this set of charges
          * @return          Pair of the point where the deposit ended after propagation and the time the propagation took
          */
         std::pair<ROOT::Math::XYZPoint, double> propagate(const ROOT::Math::XYZPoint& pos,
                                                           const CarrierType& type,
                                                           const unsigned int charge,
-                                                          std::map<Pixel::Index, Pulse>& pixel_map);
+                                                          std::map<Pixel::Index, Pulse>& pixel_map,
+                                                          CounterRandomEngine& random_generator);
 
-        // Random generator for this module
-        std::mt19937_64 random_generator_;
+        /**
+         * @brief Propagate a single set of charges through the sensor, integrating the drift with the given tableau
+         * @param tableau Compile-time Runge-Kutta tableau of the integration method
+         * @param pos       Position of the deposit in the sensor
+         * @param type      Type of the carrier to propagate
+         * @param charge    Total charge of the observed charge carrier set
+         * @param pixel_map Map of surrounding pixels and their induced pulses
+         * @param random_generator Random engine of this set of charges
+         * @return          Pair of the point where the deposit ended after propagation and the time the propagation took
+         */
+        template <typename Tableau>
+        std::pair<ROOT::Math::XYZPoint, double> propagate_integrated(const Tableau& tableau,
+                                                                     const ROOT::Math::XYZPoint& pos,
+                                                                     const CarrierType& type,
+                                                                     const unsigned int charge,
+                                                                     std::map<Pixel::Index, Pulse>& pixel_map,
+                                                                     CounterRandomEngine& random_generator);
+
+        /**
+         * @brief Estimate the maximum gradient of the weighting potential for the rings of the induction matrix
+         * @return Maximum gradient magnitude for every Chebyshev distance of a pixel from the nearest pixel of the carrier
+         */
+        std::vector<double> calculate_ramo_gradients() const;
+
+        /**
+         * @brief Method used to integrate the drift of the sets of charges, all with the fixed time step
+         */
+        enum class Integrator {
+            RK5 = 0, ///< Runge-Kutta-Fehlberg method
+            RK4,     ///< Classic fourth-order Runge-Kutta method
+            EULER,   ///< Euler-Maruyama method
+        };
 
         // Local copies of configuration parameters to avoid costly lookup:
         double temperature_{}, timestep_{}, integration_time_{};
         bool output_plots_{};
+        ConfigParameter<unsigned int> charge_per_step_;
+        size_t sets_per_task_{};
+        bool spatial_sorting_{};
+        bool accumulate_pulses_{};
+        Integrator integrator_{Integrator::RK5};
         ROOT::Math::DisplacementVector2D<ROOT::Math::Cartesian2D<int>> matrix_;
 
-        // Precalculated values for electron and hole mobility
-        double electron_Vm_;
-        double electron_Ec_;
-        double electron_Beta_;
-        double hole_Vm_;
-        double hole_Ec_;
-        double hole_Beta_;
+        // Threshold of the weighting potential change below which pixels of the induction matrix are skipped, and the
+        // maximum gradient of the weighting potential for every ring of the matrix
+        double induction_threshold_{};
+        std::vector<double> ramo_gradients_;
+
+        // Calculate the induced charge from the weighting field instead of the weighting potential difference
+        bool use_weighting_field_{};
+
+        // Mobility model and its tables for electrons and holes
+        std::unique_ptr<MobilityModel> mobility_model_;
+        std::array<MobilityTable, 2> mobility_tables_;
+
+        // Fast approximations of the mobility and sampler of the diffusion, shared by all threads
+        bool fast_math_{};
+        fast_math::ZigguratNormal normal_sampler_;
+        RegionOfInterest roi_;
+
+        // Effective trapping times of electrons and holes and the number of trapped charges
+        std::array<double, 2> trapping_times_{};
+        std::atomic<unsigned long long> trapped_charges_{};
+
+        // Number of integration steps and of propagated sets of charges
+        StatisticsCounter* integration_steps_{};
+        std::atomic<unsigned long long> propagated_sets_{};
+        std::atomic<unsigned long long> skipped_deposits_{};
 
         // Precalculated value for Boltzmann constant:
         double boltzmann_kT_;
@@ -103,11 +168,13 @@ namespace allpix {
 
         // Magnetic field
         bool has_magnetic_field_;
+        bool has_magnetic_field_grid_{false};
         ROOT::Math::XYZVector magnetic_field_;
 
         // Output plots
-        TH1D *potential_difference_, *induced_charge_histo_, *induced_charge_e_histo_, *induced_charge_h_histo_;
-        TH1D* step_length_histo_;
-        TH1D* drift_time_histo_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> potential_difference_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> induced_charge_histo_, induced_charge_e_histo_, induced_charge_h_histo_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> step_length_histo_;
+        std::unique_ptr<ThreadedHistogram<TH1D>> drift_time_histo_;
     };
 } // namespace allpix
@@ -51,6 +51,12 @@ VisualizationGeant4Module::VisualizationGeant4Module(Configuration& config, Mess
     config_.setDefault("accumulate", true);
     config_.setDefault("simple_view", true);
 
+    // Bound the memory of accumulated events, keeping the Geant4 default of 100 events
+    config_.setDefault("accumulate_max_events", 100);
+    config_.setDefault("accumulate_window", 0u);
+    config_.setDefault("trajectories_mode", "rich");
+    config_.setDefault("trajectories_max_points", 0u);
+
     // Check mode
     auto mode = config_.get<std::string>("mode");
     if(mode != "gui" && mode != "terminal" && mode != "none") {
@@ -196,8 +202,15 @@ void VisualizationGeant4Module::set_visualization_settings() {
     // Accumulate all events if requested
     auto accumulate = config_.get<bool>("accumulate");
     if(accumulate) {
-        UI->ApplyCommand("/vis/scene/endOfEventAction accumulate");
+        // Limit the number of events kept by Geant4, negative numbers keep all events
+        UI->ApplyCommand("/vis/scene/endOfEventAction accumulate " +
+                         std::to_string(config_.get<int>("accumulate_max_events")));
         UI->ApplyCommand("/vis/scene/endOfRunAction accumulate");
+
+        accumulate_window_ = config_.get<unsigned int>("accumulate_window");
+        if(accumulate_window_ > 0) {
+            LOG(INFO) << "Clearing the accumulated trajectories every " << accumulate_window_ << " events";
+        }
     } else {
         UI->ApplyCommand("/vis/scene/endOfEventAction refresh");
         UI->ApplyCommand("/vis/scene/endOfRunAction refresh");
@@ -206,12 +219,34 @@ void VisualizationGeant4Module::set_visualization_settings() {
     // Display trajectories if specified
     auto display_trajectories = config_.get<bool>("display_trajectories", true);
     if(display_trajectories) {
-        // Add smooth trajectories
-        UI->ApplyCommand("/vis/scene/add/trajectories smooth rich");
+        // Add trajectories with the requested amount of points: smooth trajectories add auxiliary points along curved steps
+        // and rich trajectories store additional information for every point
+        auto traj_mode = config_.get<std::string>("trajectories_mode");
+        std::string store_trajectory;
+        if(traj_mode == "rich") {
+            UI->ApplyCommand("/vis/scene/add/trajectories smooth rich");
+            store_trajectory = "2";
+        } else if(traj_mode == "smooth") {
+            UI->ApplyCommand("/vis/scene/add/trajectories smooth");
+            store_trajectory = "2";
+        } else if(traj_mode == "basic") {
+            UI->ApplyCommand("/vis/scene/add/trajectories");
+            store_trajectory = "1";
+        } else {
+            throw InvalidValueError(config_, "trajectories_mode", "only 'rich', 'smooth' or 'basic' are supported");
+        }
 
         // Store trajectories if accumulating
         if(accumulate) {
-            UI->ApplyCommand("/tracking/storeTrajectory 2");
+            UI->ApplyCommand("/tracking/storeTrajectory " + store_trajectory);
+        }
+
+        // Do not draw trajectories with more points than allowed, such as low-energy particles curling in magnetic fields
+        auto max_points = config_.get<unsigned int>("trajectories_max_points");
+        if(max_points > 0) {
+            UI->ApplyCommand("/vis/filtering/trajectories/create/attributeFilter allpixPoints");
+            UI->ApplyCommand("/vis/filtering/trajectories/allpixPoints/setAttribute NTP");
+            UI->ApplyCommand("/vis/filtering/trajectories/allpixPoints/addInterval 0 " + std::to_string(max_points));
         }
 
         // Hide trajectories inside the detectors
@@ -416,6 +451,11 @@ void VisualizationGeant4Module::run(unsigned int) {
         vis_manager_g4_->GetCurrentViewer()->ShowView();
         std::this_thread::sleep_for(
             std::chrono::nanoseconds(config_.get<unsigned long>("accumulate_time_step", Units::get(100ul, "ms"))));
+    } else if(accumulate_window_ > 0 && ++accumulated_events_ >= accumulate_window_) {
+        // Start a new window of accumulated events by removing the trajectories drawn so far
+        LOG(DEBUG) << "Clearing the trajectories of the last " << accumulated_events_ << " events";
+        G4UImanager::GetUIpointer()->ApplyCommand("/vis/viewer/clearTransients");
+        accumulated_events_ = 0;
     }
 }
 
@@ -77,6 +77,10 @@ namespace allpix {
         // Check if we did run successfully, used to apply workaround in destructor if needed
         bool has_run_;
 
+        // Number of events after which the accumulated trajectories are cleared, and events accumulated since
+        unsigned int accumulate_window_{};
+        unsigned int accumulated_events_{};
+
         // Own the Geant4 visualization manager
         std::unique_ptr<G4VisManager> vis_manager_g4_;
 
@@ -9,6 +9,7 @@
 
 #include "WeightingPotentialReaderModule.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <limits>
@@ -17,6 +18,7 @@
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <TH2F.h>
 
@@ -31,6 +33,8 @@ WeightingPotentialReaderModule::WeightingPotentialReaderModule(Configuration& co
                                                                Messenger*,
                                                                std::shared_ptr<Detector> detector)
     : Module(config, detector), detector_(std::move(detector)) {
+    // Fields of different detectors can be read at the same time
+    enable_parallel_initialization();
 
     // NOTE Backwards-compatibility: interpret both "init" and "apf" as "mesh":
     auto model = config_.get<std::string>("model");
@@ -48,22 +52,127 @@ void WeightingPotentialReaderModule::init() {
     auto sensor_max_z = model->getSensorCenter().z() + model->getSensorSize().z() / 2.0;
     auto thickness_domain = std::make_pair(sensor_max_z - model->getSensorSize().z(), sensor_max_z);
 
+    // Select the method to obtain the potential between the grid points, defaulting to the nearest grid point for field
+    // maps and to linear interpolation for tabulated potentials:
+    auto interpolation = config_.get<std::string>("interpolation", field_model == "mesh" ? "nearest" : "linear");
+    FieldInterpolation field_interpolation;
+    if(interpolation == "nearest") {
+        field_interpolation = FieldInterpolation::NEAREST;
+    } else if(interpolation == "linear") {
+        field_interpolation = FieldInterpolation::LINEAR;
+    } else {
+        throw InvalidValueError(config_, "interpolation", "interpolation should be 'nearest' or 'linear'");
+    }
+
+    // Select the precision used to store the potential grid, defaulting to double precision:
+    auto precision = config_.get<std::string>("field_precision", "double");
+    FieldPrecision field_precision;
+    if(precision == "double") {
+        field_precision = FieldPrecision::DOUBLE;
+    } else if(precision == "float") {
+        field_precision = FieldPrecision::FLOAT;
+    } else if(precision == "int16") {
+        field_precision = FieldPrecision::INT16;
+    } else {
+        throw InvalidValueError(config_, "field_precision", "field precision should be 'double', 'float' or 'int16'");
+    }
+
+    // Select the mirror symmetry of the potential, the grid then only covers the positive half or quadrant of the potential:
+    auto symmetry = config_.get<std::string>("field_symmetry", "none");
+    FieldSymmetry field_symmetry;
+    if(symmetry == "none") {
+        field_symmetry = FieldSymmetry::NONE;
+    } else if(symmetry == "half_x") {
+        field_symmetry = FieldSymmetry::HALF_X;
+    } else if(symmetry == "half_y") {
+        field_symmetry = FieldSymmetry::HALF_Y;
+    } else if(symmetry == "quarter") {
+        field_symmetry = FieldSymmetry::QUARTER;
+    } else {
+        throw InvalidValueError(
+            config_, "field_symmetry", "field symmetry should be 'none', 'half_x', 'half_y' or 'quarter'");
+    }
+    // Select the memory layout of the potential grid, defaulting to a flat array:
+    auto layout = config_.get<std::string>("field_layout", "flat");
+    FieldLayout field_layout;
+    if(layout == "flat") {
+        field_layout = FieldLayout::FLAT;
+    } else if(layout == "tiled") {
+        field_layout = FieldLayout::TILED;
+    } else {
+        throw InvalidValueError(config_, "field_layout", "field layout should be 'flat' or 'tiled'");
+    }
+
+    // The weighting field can only be derived from potentials defined by a grid
+    auto compute_weighting_field = config_.get<bool>("compute_weighting_field", false);
+    if(compute_weighting_field && field_model == "pad" && !config_.get<bool>("tabulate", false)) {
+        LOG(WARNING) << "Weighting field can only be derived from a weighting potential grid, enable 'tabulate' to "
+                        "compute it for the pad potential";
+        compute_weighting_field = false;
+    }
+
+    std::array<double, 2> mirror_factor{
+        {field_symmetry == FieldSymmetry::HALF_X || field_symmetry == FieldSymmetry::QUARTER ? 2.0 : 1.0,
+         field_symmetry == FieldSymmetry::HALF_Y || field_symmetry == FieldSymmetry::QUARTER ? 2.0 : 1.0}};
+
     // Calculate the potential depending on the configuration
     if(field_model == "mesh") {
-        auto field_data = read_field(thickness_domain);
+        LOG(DEBUG) << "Weighting potential will be interpolated using method " << interpolation;
+        LOG(DEBUG) << "Weighting potential will be stored with precision " << precision << " and layout " << layout
+                   << " using symmetry " << symmetry;
+
+        // Planes of the grid along z which are reproduced by the interpolation between their neighbors can be dropped:
+        auto z_tolerance = config_.get<double>("field_z_tolerance", 0.);
+        if(z_tolerance < 0) {
+            throw InvalidValueError(config_, "field_z_tolerance", "tolerance cannot be negative");
+        }
+        if(z_tolerance > 0) {
+            LOG(DEBUG) << "Weighting potential planes along z will be dropped up to a relative deviation of " << z_tolerance;
+        }
 
-        detector_->setWeightingPotentialGrid(field_data.getData(),
+        auto field_data = read_field(thickness_domain, mirror_factor);
+
+        // The potential map of a symmetric potential only covers the positive half or quadrant of its full extent
+        auto size = field_data.getSize();
+        std::array<double, 2> scales{{size[0] * mirror_factor[0], size[1] * mirror_factor[1]}};
+        detector_->setWeightingPotentialGrid(field_data.getView(),
+                                             field_data.getNumberOfElements(),
                                              field_data.getDimensions(),
-                                             std::array<double, 2>{{field_data.getSize()[0], field_data.getSize()[1]}},
+                                             scales,
                                              std::array<double, 2>{{0, 0}},
-                                             thickness_domain);
+                                             thickness_domain,
+                                             field_interpolation,
+                                             field_precision,
+                                             field_symmetry,
+                                             field_layout,
+                                             z_tolerance);
+        if(compute_weighting_field) {
+            derive_weighting_field(field_data.getDimensions(),
+                                   scales,
+                                   thickness_domain,
+                                   field_interpolation,
+                                   field_precision,
+                                   field_symmetry,
+                                   field_layout);
+        }
     } else if(field_model == "pad") {
         LOG(TRACE) << "Adding weighting potential from pad in plane condenser";
 
         // Get pixel implant size from the detector model:
         auto implant = model->getImplantSize();
         auto function = get_pad_potential_function(implant, thickness_domain);
-        detector_->setWeightingPotentialFunction(function, thickness_domain, FieldType::CUSTOM);
+        if(config_.get<bool>("tabulate", false)) {
+            LOG(DEBUG) << "Tabulated weighting potential will be interpolated using method " << interpolation;
+            tabulate_potential(function,
+                               thickness_domain,
+                               field_interpolation,
+                               field_precision,
+                               field_symmetry,
+                               field_layout,
+                               compute_weighting_field);
+        } else {
+            detector_->setWeightingPotentialFunction(function, thickness_domain, FieldType::CUSTOM);
+        }
     } else {
         throw InvalidValueError(config_, "model", "model should be 'init' or `pad`");
     }
@@ -115,6 +224,189 @@ WeightingPotentialReaderModule::get_pad_potential_function(const ROOT::Math::XYV
     };
 }
 
+/**
+ * The potential is sampled at the centers of the bins of a grid spanning the configured area around the reference pixel and
+ * the full thickness domain. As the pad potential is symmetric in x and y, only one quadrant of the grid is calculated. The
+ * accuracy of the table is estimated by comparing it to the analytic potential halfway between neighboring grid points.
+ */
+void WeightingPotentialReaderModule::tabulate_potential(const FieldFunction<double>& function,
+                                                        std::pair<double, double> thickness_domain,
+                                                        FieldInterpolation interpolation,
+                                                        FieldPrecision precision,
+                                                        FieldSymmetry symmetry,
+                                                        FieldLayout layout,
+                                                        bool compute_field) {
+    using XYZVectorInt = ROOT::Math::DisplacementVector3D<ROOT::Math::Cartesian3D<int>>;
+
+    auto model = detector_->getModel();
+    auto size = config_.get<ROOT::Math::XYVector>(
+        "tabulation_size", ROOT::Math::XYVector(5 * model->getPixelSize().x(), 5 * model->getPixelSize().y()));
+    auto bins = config_.get<XYZVectorInt>("tabulation_bins", XYZVectorInt(50, 50, 50));
+    if(size.x() <= 0 || size.y() <= 0) {
+        throw InvalidValueError(config_, "tabulation_size", "tabulation size needs to be positive");
+    }
+    if(bins.x() <= 0 || bins.y() <= 0 || bins.z() <= 0) {
+        throw InvalidValueError(config_, "tabulation_bins", "number of bins needs to be positive");
+    }
+    auto mirror_x = (symmetry == FieldSymmetry::HALF_X || symmetry == FieldSymmetry::QUARTER);
+    auto mirror_y = (symmetry == FieldSymmetry::HALF_Y || symmetry == FieldSymmetry::QUARTER);
+    if((mirror_x && bins.x() % 2 != 0) || (mirror_y && bins.y() % 2 != 0)) {
+        throw InvalidValueError(config_, "tabulation_bins", "number of bins needs to be even along mirrored axes");
+    }
+
+    std::array<size_t, 3> dimensions{
+        {static_cast<size_t>(bins.x()), static_cast<size_t>(bins.y()), static_cast<size_t>(bins.z())}};
+    auto thickness = thickness_domain.second - thickness_domain.first;
+    auto bin_center = [&](size_t bin, size_t axis) {
+        auto extent = (axis == 0 ? size.x() : (axis == 1 ? size.y() : thickness));
+        auto start = (axis == 2 ? thickness_domain.first : -extent / 2.0);
+        return start + (static_cast<double>(bin) + 0.5) * extent / static_cast<double>(dimensions[axis]);
+    };
+
+    // Fill one quadrant of the grid and mirror the values to the other quadrants
+    LOG(INFO) << "Tabulating pad weighting potential with " << dimensions[0] << "x" << dimensions[1] << "x"
+              << dimensions[2] << " bins";
+    // For symmetric potentials only the bins with positive x or y along the mirrored axes are stored
+    std::array<size_t, 3> stored{
+        {mirror_x ? dimensions[0] / 2 : dimensions[0], mirror_y ? dimensions[1] / 2 : dimensions[1], dimensions[2]}};
+    auto potential = std::make_shared<std::vector<double>>(stored[0] * stored[1] * stored[2]);
+    auto store = [&](size_t x, size_t y, size_t z, double value) {
+        auto x_first = dimensions[0] - stored[0];
+        auto y_first = dimensions[1] - stored[1];
+        if(x >= x_first && y >= y_first) {
+            (*potential)[((x - x_first) * stored[1] + (y - y_first)) * stored[2] + z] = value;
+        }
+    };
+    for(size_t x = 0; x < (dimensions[0] + 1) / 2; ++x) {
+        LOG_PROGRESS(INFO, "tabulating") << "Tabulating weighting potential: " << 100 * 2 * x / dimensions[0] << "%";
+        for(size_t y = 0; y < (dimensions[1] + 1) / 2; ++y) {
+            for(size_t z = 0; z < dimensions[2]; ++z) {
+                auto value = function(ROOT::Math::XYZPoint(bin_center(x, 0), bin_center(y, 1), bin_center(z, 2)));
+                auto x_mirror = dimensions[0] - 1 - x;
+                auto y_mirror = dimensions[1] - 1 - y;
+                store(x, y, z, value);
+                store(x_mirror, y, z, value);
+                store(x, y_mirror, z, value);
+                store(x_mirror, y_mirror, z, value);
+            }
+        }
+    }
+    LOG_PROGRESS(INFO, "tabulating") << "Tabulating weighting potential: done ";
+    LOG(DEBUG) << "Storing " << stored[0] << "x" << stored[1] << "x" << stored[2] << " bins of the tabulated potential";
+
+    detector_->setWeightingPotentialGrid(potential,
+                                         stored,
+                                         std::array<double, 2>{{size.x(), size.y()}},
+                                         std::array<double, 2>{{0, 0}},
+                                         thickness_domain,
+                                         interpolation,
+                                         precision,
+                                         symmetry,
+                                         layout);
+    if(compute_field) {
+        derive_weighting_field(stored,
+                               std::array<double, 2>{{size.x(), size.y()}},
+                               thickness_domain,
+                               interpolation,
+                               precision,
+                               symmetry,
+                               layout);
+    }
+
+    // Estimate the error of the table halfway between grid points, limiting the number of samples along every axis
+    double max_error = 0;
+    std::array<size_t, 3> samples{};
+    for(size_t axis = 0; axis < 3; ++axis) {
+        samples[axis] = std::min<size_t>(std::max<size_t>(dimensions[axis], 2) - 1, 25);
+    }
+    for(size_t i = 0; i < samples[0]; ++i) {
+        for(size_t j = 0; j < samples[1]; ++j) {
+            for(size_t k = 0; k < samples[2]; ++k) {
+                // Select the sample point between two neighboring bin centers, or the bin center for single bins
+                auto between = [&](size_t sample, size_t axis) {
+                    auto bin = sample * (std::max<size_t>(dimensions[axis], 2) - 1) / samples[axis];
+                    return dimensions[axis] == 1 ? bin_center(0, axis)
+                                                 : (bin_center(bin, axis) + bin_center(bin + 1, axis)) / 2.0;
+                };
+                ROOT::Math::XYZPoint pos(between(i, 0), between(j, 1), between(k, 2));
+                auto error = std::fabs(detector_->getWeightingPotential(pos, Pixel::Index(0, 0)) - function(pos));
+                max_error = std::max(max_error, error);
+            }
+        }
+    }
+    LOG(INFO) << "Tabulated pad weighting potential in area of " << Units::display(size, {"um", "mm"})
+              << ", maximum deviation from analytic potential is " << max_error;
+}
+
+/**
+ * The weighting field is the negative gradient of the potential. It is estimated at the centers of the stored bins from the
+ * central differences of the potential between the neighboring bin centers, and from one-sided differences at the borders
+ * of the grid. The potential is looked up from the detector, such that the mirroring of symmetric potentials is taken into
+ * account for the bins next to the mirror planes. Along axes with a single bin, the field component is zero.
+ */
+void WeightingPotentialReaderModule::derive_weighting_field(std::array<size_t, 3> dimensions,
+                                                            std::array<double, 2> scales,
+                                                            std::pair<double, double> thickness_domain,
+                                                            FieldInterpolation interpolation,
+                                                            FieldPrecision precision,
+                                                            FieldSymmetry symmetry,
+                                                            FieldLayout layout) {
+    auto mirror_x = (symmetry == FieldSymmetry::HALF_X || symmetry == FieldSymmetry::QUARTER);
+    auto mirror_y = (symmetry == FieldSymmetry::HALF_Y || symmetry == FieldSymmetry::QUARTER);
+
+    // Bins of the full grid, of which only the ones with positive x or y are stored along mirrored axes
+    std::array<size_t, 3> full{{mirror_x ? 2 * dimensions[0] : dimensions[0],
+                                mirror_y ? 2 * dimensions[1] : dimensions[1],
+                                dimensions[2]}};
+    std::array<double, 3> start{{-scales[0] / 2, -scales[1] / 2, thickness_domain.first}};
+    std::array<double, 3> spacing{{scales[0] / static_cast<double>(full[0]),
+                                   scales[1] / static_cast<double>(full[1]),
+                                   (thickness_domain.second - thickness_domain.first) / static_cast<double>(full[2])}};
+    auto potential = [&](const std::array<size_t, 3>& bin) {
+        ROOT::Math::XYZPoint pos(start[0] + (static_cast<double>(bin[0]) + 0.5) * spacing[0],
+                                 start[1] + (static_cast<double>(bin[1]) + 0.5) * spacing[1],
+                                 start[2] + (static_cast<double>(bin[2]) + 0.5) * spacing[2]);
+        return detector_->getWeightingPotential(pos, Pixel::Index(0, 0));
+    };
+
+    auto field = std::make_shared<std::vector<double>>(3 * dimensions[0] * dimensions[1] * dimensions[2]);
+    for(size_t i = 0; i < dimensions[0]; ++i) {
+        for(size_t j = 0; j < dimensions[1]; ++j) {
+            for(size_t k = 0; k < dimensions[2]; ++k) {
+                std::array<size_t, 3> bin{{i + full[0] - dimensions[0], j + full[1] - dimensions[1], k}};
+                auto index = ((i * dimensions[1] + j) * dimensions[2] + k) * 3;
+                for(size_t axis = 0; axis < 3; ++axis) {
+                    if(full[axis] == 1) {
+                        continue;
+                    }
+                    auto lower = bin;
+                    auto upper = bin;
+                    if(lower[axis] > 0) {
+                        --lower[axis];
+                    }
+                    if(upper[axis] + 1 < full[axis]) {
+                        ++upper[axis];
+                    }
+                    (*field)[index + axis] = -(potential(upper) - potential(lower)) /
+                                             (static_cast<double>(upper[axis] - lower[axis]) * spacing[axis]);
+                }
+            }
+        }
+    }
+
+    detector_->setWeightingFieldGrid(field,
+                                     dimensions,
+                                     scales,
+                                     std::array<double, 2>{{0, 0}},
+                                     thickness_domain,
+                                     interpolation,
+                                     precision,
+                                     symmetry,
+                                     layout);
+    LOG(INFO) << "Derived weighting field from the weighting potential with " << dimensions[0] << "x" << dimensions[1]
+              << "x" << dimensions[2] << " cells";
+}
+
 void WeightingPotentialReaderModule::create_output_plots() {
     LOG(TRACE) << "Creating output plots";
 
@@ -196,44 +488,51 @@ void WeightingPotentialReaderModule::create_output_plots() {
  * The field data read from files are shared between module instantiations
  * using the static FieldParser's getByFileName method.
  */
-FieldParser<double> WeightingPotentialReaderModule::field_parser_(FieldQuantity::SCALAR);
-FieldData<double> WeightingPotentialReaderModule::read_field(std::pair<double, double> thickness_domain) {
+FieldParser<double> WeightingPotentialReaderModule::field_parser_(FieldQuantity::SCALAR, true);
+FieldData<double> WeightingPotentialReaderModule::read_field(std::pair<double, double> thickness_domain,
+                                                             std::array<double, 2> mirror_factor) {
     using namespace ROOT::Math;
 
     try {
         LOG(TRACE) << "Fetching weighting potential from init file";
 
-        // Get field from file
-        auto field_data = field_parser_.getByFileName(config_.getPath("file_name", true));
-
-        // Check maximum/minimum values of the potential:
-        auto elements = std::minmax_element(field_data.getData()->begin(), field_data.getData()->end());
-        if(*elements.first < 0 || *elements.second > 1) {
-            throw InvalidValueError(config_,
-                                    "file_name",
-                                    "Unphysical weighting potential detected, found " + std::to_string(*elements.first) +
-                                        " < phi < " + std::to_string(*elements.second) + ", expected 0 < phi < 1");
-        }
+        // Check the header of the file before reading the field data
+        auto file_name = config_.getPath("file_name", true);
+        auto header = field_parser_.getHeaderByFileName(file_name);
 
         // Check that we actually have a three-dimensional potential field, otherwise we get very unphysical results in
         // neighboring pixels along the "missing" dimension:
-        if(field_data.getDimensionality() < 3) {
+        if(header.getDimensionality() < 3) {
             // check if wrong dimensionality should be ignored
             if(config_.get<bool>("ignore_field_dimensions", false)) {
-                LOG(WARNING) << "Weighting potential with " << std::to_string(field_data.getDimensionality())
+                LOG(WARNING) << "Weighting potential with " << std::to_string(header.getDimensionality())
                              << " dimensions detected, requiring three-dimensional scalar field - this might lead to "
                                 "unexpected behavior.";
             } else {
                 throw InvalidValueError(config_,
                                         "file_name",
-                                        "Weighting potential with " + std::to_string(field_data.getDimensionality()) +
+                                        "Weighting potential with " + std::to_string(header.getDimensionality()) +
                                             " dimensions detected, requiring three-dimensional scalar field - this might "
                                             "lead to unexpected behavior.");
             }
         }
 
         // Check if weigthing potential matches chip
-        check_detector_match(field_data.getSize(), thickness_domain);
+        auto size = header.getSize();
+        check_detector_match({{size[0] * mirror_factor[0], size[1] * mirror_factor[1], size[2]}}, thickness_domain);
+
+        // Get field from file
+        auto field_data = field_parser_.getByFileName(file_name, std::string(), config_.get<bool>("shared_memory", false));
+
+        // Check maximum/minimum values of the potential:
+        auto data = field_data.getView();
+        auto elements = std::minmax_element(data.get(), data.get() + field_data.getNumberOfElements());
+        if(*elements.first < 0 || *elements.second > 1) {
+            throw InvalidValueError(config_,
+                                    "file_name",
+                                    "Unphysical weighting potential detected, found " + std::to_string(*elements.first) +
+                                        " < phi < " + std::to_string(*elements.second) + ", expected 0 < phi < 1");
+        }
 
         LOG(INFO) << "Set weighting field with " << field_data.getDimensions()[0] << "x" << field_data.getDimensions()[1]
                   << "x" << field_data.getDimensions()[2] << " cells";
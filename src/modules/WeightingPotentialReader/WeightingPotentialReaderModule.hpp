@@ -7,6 +7,7 @@
  * Intergovernmental Organization or submit itself to any jurisdiction.
  */
 
+#include <array>
 #include <map>
 #include <memory>
 #include <string>
@@ -49,11 +50,48 @@ namespace allpix {
         FieldFunction<double> get_pad_potential_function(const ROOT::Math::XYVector& implant,
                                                          std::pair<double, double> thickness_domain);
 
+        /**
+         * @brief Sample the weighting potential function onto a grid and apply the grid to the detector
+         * @param function Function of the weighting potential to sample
+         * @param thickness_domain Domain of the thickness where the field is defined
+         * @param interpolation Method used to obtain the potential between the grid points
+         * @param precision Precision used to store the tabulated potential
+         * @param symmetry Mirror symmetry of the potential, only the reduced domain is tabulated
+         * @param layout Memory layout used to store the tabulated potential
+         * @param compute_field Derive the weighting field from the tabulated potential
+         */
+        void tabulate_potential(const FieldFunction<double>& function,
+                                std::pair<double, double> thickness_domain,
+                                FieldInterpolation interpolation,
+                                FieldPrecision precision,
+                                FieldSymmetry symmetry,
+                                FieldLayout layout,
+                                bool compute_field);
+
+        /**
+         * @brief Derive the weighting field from the weighting potential grid of the detector and apply it
+         * @param dimensions Dimensions of the stored potential grid
+         * @param scales Full extent of the potential in x and y
+         * @param thickness_domain Domain of the thickness where the field is defined
+         * @param interpolation Method used to obtain the field between the grid points
+         * @param precision Precision used to store the field
+         * @param symmetry Mirror symmetry of the potential, the field grid covers the same reduced domain
+         * @param layout Memory layout used to store the field
+         */
+        void derive_weighting_field(std::array<size_t, 3> dimensions,
+                                    std::array<double, 2> scales,
+                                    std::pair<double, double> thickness_domain,
+                                    FieldInterpolation interpolation,
+                                    FieldPrecision precision,
+                                    FieldSymmetry symmetry,
+                                    FieldLayout layout);
+
         /**
          * @brief Read pre-calculated field from file and apply it
          * @param thickness_domain Domain of the thickness where the field is defined
+         * @param mirror_factor Ratio between the full extent of the potential and the extent of the file in x and y
          */
-        FieldData<double> read_field(std::pair<double, double> thickness_domain);
+        FieldData<double> read_field(std::pair<double, double> thickness_domain, std::array<double, 2> mirror_factor);
         static FieldParser<double> field_parser_;
 
         /**
@@ -9,6 +9,8 @@
 
 #include "DepositedCharge.hpp"
 
+#include <TBuffer.h>
+
 #include "exceptions.h"
 
 using namespace allpix;
@@ -26,10 +28,10 @@ DepositedCharge::DepositedCharge(ROOT::Math::XYZPoint local_position,
 /**
  * @throws MissingReferenceException If the pointed object is not in scope
  *
- * Object is stored as TRef and can only be accessed if pointed object is in scope
+ * Object is linked by pointer and can only be accessed if pointed object is in scope
  */
 const MCParticle* DepositedCharge::getMCParticle() const {
-    auto mc_particle = dynamic_cast<MCParticle*>(mc_particle_.GetObject());
+    auto mc_particle = mc_particle_.get();
     if(mc_particle == nullptr) {
         throw MissingReferenceException(typeid(*this), typeid(MCParticle));
     }
@@ -37,10 +39,40 @@ const MCParticle* DepositedCharge::getMCParticle() const {
 }
 
 void DepositedCharge::setMCParticle(const MCParticle* mc_particle) {
-    mc_particle_ = const_cast<MCParticle*>(mc_particle); // NOLINT
+    mc_particle_ = PointerWrapper<MCParticle>(truth_particle(mc_particle));
+}
+
+void DepositedCharge::loadHistory() {
+    mc_particle_.load();
+}
+
+void DepositedCharge::petrifyHistory() {
+    mc_particle_.store();
 }
 
 void DepositedCharge::print(std::ostream& out) const {
     out << "--- Deposited charge information\n";
     SensorCharge::print(out);
 }
+
+/**
+ * Versions before the custom streamer are read with the streamer info stored in the file.
+ */
+void DepositedCharge::Streamer(TBuffer& buffer) {
+    if(buffer.IsReading()) {
+        UInt_t start = 0, count = 0;
+        auto version = buffer.ReadVersion(&start, &count);
+        if(version < 4) {
+            buffer.ReadClassBuffer(DepositedCharge::Class(), this, version, start, count);
+            return;
+        }
+        SensorCharge::Streamer(buffer);
+        mc_particle_.Streamer(buffer);
+        buffer.CheckByteCount(start, count, DepositedCharge::Class());
+    } else {
+        auto count = buffer.WriteVersion(DepositedCharge::Class(), kTRUE);
+        SensorCharge::Streamer(buffer);
+        mc_particle_.Streamer(buffer);
+        buffer.SetByteCount(count, kTRUE);
+    }
+}
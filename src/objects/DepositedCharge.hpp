@@ -10,7 +10,6 @@
 #ifndef ALLPIX_DEPOSITED_CHARGE_H
 #define ALLPIX_DEPOSITED_CHARGE_H
 
-#include <TRef.h>
 
 #include "MCParticle.hpp"
 #include "SensorCharge.hpp"
@@ -53,6 +52,15 @@ namespace allpix {
          */
         void setMCParticle(const MCParticle* mc_particle);
 
+        /**
+         * @brief Restore the links to other objects after reading from file
+         */
+        void loadHistory() override;
+        /**
+         * @brief Convert the links to other objects to persistent references before writing to file
+         */
+        void petrifyHistory() override;
+
         /**
          * @brief Print an ASCII representation of DepositedCharge to the given stream
          * @param out Stream to print to
@@ -62,14 +70,14 @@ namespace allpix {
         /**
          * @brief ROOT class definition
          */
-        ClassDefOverride(DepositedCharge, 2);
+        ClassDefOverride(DepositedCharge, 4);
         /**
          * @brief Default constructor for ROOT I/O
          */
         DepositedCharge() = default;
 
     private:
-        TRef mc_particle_;
+        PointerWrapper<MCParticle> mc_particle_;
     };
 
     /**
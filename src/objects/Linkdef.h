@@ -17,13 +17,23 @@
 #pragma link C++ class allpix::Object + ;
 #pragma link C++ class allpix::MCTrack + ;
 #pragma link C++ class allpix::MCParticle + ;
-#pragma link C++ class allpix::SensorCharge + ;
-#pragma link C++ class allpix::PropagatedCharge + ;
-#pragma link C++ class allpix::DepositedCharge + ;
+// Classes written in large numbers use custom streamers, implemented together with the classes
+#pragma link C++ class allpix::SensorCharge - ;
+#pragma link C++ class allpix::PropagatedCharge - ;
+#pragma link C++ class allpix::DepositedCharge - ;
 #pragma link C++ class allpix::Pixel + ;
 #pragma link C++ class allpix::PixelCharge + ;
 #pragma link C++ class allpix::PixelHit + ;
-#pragma link C++ class allpix::Pulse + ;
+#pragma link C++ class allpix::Pulse - ;
+
+// Links between objects
+#pragma link C++ class allpix::Object::PointerWrapper < allpix::MCTrack> + ;
+#pragma link C++ class allpix::Object::PointerWrapper < allpix::MCParticle> + ;
+#pragma link C++ class allpix::Object::PointerWrapper < allpix::DepositedCharge> + ;
+#pragma link C++ class allpix::Object::PointerWrapper < allpix::PropagatedCharge> + ;
+#pragma link C++ class allpix::Object::PointerWrapper < allpix::PixelCharge> + ;
+#pragma link C++ class std::vector < allpix::Object::PointerWrapper < allpix::MCParticle>> + ;
+#pragma link C++ class std::vector < allpix::Object::PointerWrapper < allpix::PropagatedCharge>> + ;
 
 // Vector of Object for internal storage
 #pragma link C++ class std::vector < allpix::Object*> + ;
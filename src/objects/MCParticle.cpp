@@ -48,25 +48,35 @@ double MCParticle::getTime() const {
 }
 
 void MCParticle::setParent(const MCParticle* mc_particle) {
-    parent_ = const_cast<MCParticle*>(mc_particle); // NOLINT
+    parent_ = PointerWrapper<MCParticle>(mc_particle);
 }
 
 /**
- * Object is stored as TRef and can only be accessed if pointed object is in scope
+ * Object is linked by pointer and can only be accessed if pointed object is in scope
  */
 const MCParticle* MCParticle::getParent() const {
-    return dynamic_cast<MCParticle*>(parent_.GetObject());
+    return parent_.get();
 }
 
 void MCParticle::setTrack(const MCTrack* mc_track) {
-    track_ = const_cast<MCTrack*>(mc_track); // NOLINT
+    track_ = PointerWrapper<MCTrack>(mc_track);
 }
 
 /**
- * Object is stored as TRef and can only be accessed if pointed object is in scope
+ * Object is linked by pointer and can only be accessed if pointed object is in scope
  */
 const MCTrack* MCParticle::getTrack() const {
-    return dynamic_cast<MCTrack*>(track_.GetObject());
+    return track_.get();
+}
+
+void MCParticle::loadHistory() {
+    parent_.load();
+    track_.load();
+}
+
+void MCParticle::petrifyHistory() {
+    parent_.store();
+    track_.store();
 }
 
 void MCParticle::print(std::ostream& out) const {
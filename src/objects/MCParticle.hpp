@@ -11,7 +11,6 @@
 #define ALLPIX_MC_PARTICLE_H
 
 #include <Math/Point3D.h>
-#include <TRef.h>
 
 #include "MCTrack.hpp"
 #include "Object.hpp"
@@ -102,12 +101,21 @@ namespace allpix {
         /**
          * @brief ROOT class definition
          */
-        ClassDefOverride(MCParticle, 6);
+        ClassDefOverride(MCParticle, 7);
         /**
          * @brief Default constructor for ROOT I/O
          */
         MCParticle() = default;
 
+        /**
+         * @brief Restore the links to other objects after reading from file
+         */
+        void loadHistory() override;
+        /**
+         * @brief Convert the links to other objects to persistent references before writing to file
+         */
+        void petrifyHistory() override;
+
         /**
          * @brief Print an ASCII representation of MCParticle to the given stream
          * @param out Stream to print to
@@ -123,8 +131,8 @@ namespace allpix {
         int particle_id_{};
         double time_{};
 
-        TRef parent_;
-        TRef track_;
+        PointerWrapper<MCParticle> parent_;
+        PointerWrapper<MCTrack> track_;
     };
 
     /**
@@ -71,14 +71,22 @@ std::string MCTrack::getCreationProcessName() const {
 }
 
 /**
- * Object is stored as TRef and can only be accessed if pointed object is in scope
+ * Object is linked by pointer and can only be accessed if pointed object is in scope
  */
 const MCTrack* MCTrack::getParent() const {
-    return dynamic_cast<MCTrack*>(parent_.GetObject());
+    return parent_.get();
 }
 
 void MCTrack::setParent(const MCTrack* mc_track) {
-    parent_ = const_cast<MCTrack*>(mc_track); // NOLINT
+    parent_ = PointerWrapper<MCTrack>(mc_track);
+}
+
+void MCTrack::loadHistory() {
+    parent_.load();
+}
+
+void MCTrack::petrifyHistory() {
+    parent_.store();
 }
 
 void MCTrack::print(std::ostream& out) const {
@@ -112,7 +120,7 @@ void MCTrack::print(std::ostream& out) const {
         << std::setw(small_gap) << " MeV | " << std::left << std::setw(big_gap) << "Final total energy: " << std::right
         << std::setw(med_gap) << final_tot_E_ << std::setw(small_gap) << " MeV   \n";
     if(parent != nullptr) {
-        out << "Linked parent: " << parent_.GetObject() << '\n';
+        out << "Linked parent: " << parent << '\n';
     } else {
         out << "Linked parent: <nullptr>\n";
     }
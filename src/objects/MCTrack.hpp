@@ -11,7 +11,6 @@
 #define ALLPIX_MC_TRACK_H
 
 #include <Math/Point3D.h>
-#include <TRef.h>
 
 #include "Object.hpp"
 
@@ -120,6 +119,15 @@ namespace allpix {
          */
         void setParent(const MCTrack* mc_track);
 
+        /**
+         * @brief Restore the links to other objects after reading from file
+         */
+        void loadHistory() override;
+        /**
+         * @brief Convert the links to other objects to persistent references before writing to file
+         */
+        void petrifyHistory() override;
+
         /**
          * @brief Print an ASCII representation of MCTrack to the given stream
          * @param out Stream to print to
@@ -129,7 +137,7 @@ namespace allpix {
         /**
          * @brief ROOT class definition
          */
-        ClassDefOverride(MCTrack, 2);
+        ClassDefOverride(MCTrack, 3);
         /**
          * @brief Default constructor for ROOT I/O
          */
@@ -150,7 +158,7 @@ namespace allpix {
         double initial_tot_E_{};
         double final_tot_E_{};
 
-        TRef parent_;
+        PointerWrapper<MCTrack> parent_;
     };
 
     /**
@@ -9,16 +9,42 @@
 
 #include "Object.hpp"
 
+#include <atomic>
+
+#include "MCParticle.hpp"
+
 using namespace allpix;
 
-std::ostream& allpix::operator<<(std::ostream& out, const Object& obj) {
-    obj.print(out);
-    return out;
+namespace {
+    std::atomic<Object::MCTruth> mc_truth_level{Object::MCTruth::FULL};
+} // namespace
+
+void Object::setMCTruth(MCTruth level) {
+    mc_truth_level = level;
+}
+
+Object::MCTruth Object::getMCTruth() {
+    return mc_truth_level;
 }
 
-bool operator<(const TRef& ref1, const TRef& ref2) {
-    if(ref1.GetPID() == ref2.GetPID()) {
-        return ref1.GetUniqueID() < ref2.GetUniqueID();
+/**
+ * Secondary particles are replaced by the primary particle at the top of their chain of parents, which only works if the
+ * parents are set before the particle is referred to.
+ */
+const MCParticle* Object::truth_particle(const MCParticle* mc_particle) {
+    auto level = getMCTruth();
+    if(level == MCTruth::NONE) {
+        return nullptr;
     }
-    return ref1.GetPID() < ref2.GetPID();
+    if(level == MCTruth::PRIMARIES) {
+        while(mc_particle != nullptr && mc_particle->getParent() != nullptr) {
+            mc_particle = mc_particle->getParent();
+        }
+    }
+    return mc_particle;
+}
+
+std::ostream& allpix::operator<<(std::ostream& out, const Object& obj) {
+    obj.print(out);
+    return out;
 }
@@ -16,12 +16,14 @@
 #define ALLPIX_OBJECT_H
 
 #include <iostream>
+#include <vector>
 
 #include <TObject.h>
 #include <TRef.h>
 
 namespace allpix {
     template <typename T> class Message;
+    class MCParticle;
 
     /**
      * @ingroup Objects
@@ -31,6 +33,28 @@ namespace allpix {
     public:
         friend std::ostream& operator<<(std::ostream& out, const allpix::Object& obj);
 
+        /**
+         * @brief Level of Monte Carlo truth stored in the history of newly created objects
+         */
+        enum class MCTruth {
+            NONE = 0,  ///< No references to other objects
+            PRIMARIES, ///< Only references to the primary Monte Carlo particles the object originates from
+            FULL,      ///< References to all objects the object is created from
+        };
+
+        /**
+         * @brief Set the level of Monte Carlo truth stored by all objects created afterwards
+         * @param level Level of Monte Carlo truth
+         * @warning Should only be changed before the events are processed, such that all objects use the same level
+         */
+        static void setMCTruth(MCTruth level);
+
+        /**
+         * @brief Get the level of Monte Carlo truth stored by newly created objects
+         * @return Level of Monte Carlo truth
+         */
+        static MCTruth getMCTruth();
+
         /**
          * @brief Required default constructor
          */
@@ -56,12 +80,100 @@ namespace allpix {
         Object& operator=(Object&&) = default;
         /// @}
 
+        /**
+         * @brief Link to another object of the same event
+         *
+         * While processing events the link is a plain pointer, which is only valid while the linked object is in scope. The
+         * pointer is only converted to a persistent TRef by \ref Object::petrifyHistory before the object is written to
+         * file and restored by \ref Object::loadHistory after it has been read. Events can therefore be processed
+         * concurrently, as creating and following links does not access the global ROOT object table.
+         */
+        template <class T> class PointerWrapper {
+        public:
+            /**
+             * @brief Construct an empty link
+             */
+            PointerWrapper() = default;
+
+            /**
+             * @brief Construct a link to an object
+             * @param obj Object to link to
+             */
+            explicit PointerWrapper(const T* obj) : ptr_(const_cast<T*>(obj)) {} // NOLINT
+
+            /**
+             * @brief Get the linked object
+             * @return Pointer to the linked object or null pointer if no object is linked
+             */
+            const T* get() const { return ptr_; }
+
+            /**
+             * @brief Store the link to the linked object in the persistent reference
+             */
+            void store() { ref_ = ptr_; }
+
+            /**
+             * @brief Load the link to the linked object from the persistent reference
+             */
+            void load() { ptr_ = dynamic_cast<T*>(ref_.GetObject()); }
+
+            /**
+             * @brief ROOT class definition
+             */
+            ClassDef(PointerWrapper, 1); // NOLINT
+
+        private:
+            T* ptr_{}; //! transient pointer used while processing events
+            TRef ref_;
+        };
+
+        /**
+         * @brief Restore the pointers to other objects from the persistent references after reading this object from file
+         * @warning Should only be called after all objects of the event have been read, as it accesses the global ROOT
+         *          object table
+         */
+        virtual void loadHistory() {}
+
+        /**
+         * @brief Convert the pointers to other objects to persistent references before writing this object to file
+         * @warning Should only be called by output modules, as it accesses the global ROOT object table
+         */
+        virtual void petrifyHistory() {}
+
         /**
          * @brief ROOT class definition
          */
         ClassDefOverride(Object, 2);
 
     protected:
+        /**
+         * @brief Select the Monte Carlo particle to refer to at the current level of Monte Carlo truth
+         * @param mc_particle Monte Carlo particle the object originates from
+         * @return The particle itself for the full truth, its primary ancestor for the primaries and nothing otherwise
+         */
+        static const MCParticle* truth_particle(const MCParticle* mc_particle);
+
+        /**
+         * @brief Resolve a list of links to the linked objects, such that the getters can return them without any lookup
+         * @param links Links to resolve
+         * @param objects List filled with the linked objects, left empty if any of the linked objects is not in scope
+         *
+         * The getters of the linked objects can detect links to objects out of scope by comparing the number of resolved
+         * objects with the number of links. The list should be resolved again whenever the links are changed or loaded.
+         */
+        template <class T>
+        static void resolve_links(const std::vector<PointerWrapper<T>>& links, std::vector<const T*>& objects) {
+            objects.clear();
+            objects.reserve(links.size());
+            for(auto& link : links) {
+                if(link.get() == nullptr) {
+                    objects.clear();
+                    return;
+                }
+                objects.push_back(link.get());
+            }
+        }
+
         /**
          * @brief Print an ASCII representation of this Object to the given stream
          * @param out Stream to print to
@@ -87,12 +199,4 @@ namespace allpix {
     std::ostream& operator<<(std::ostream& out, const allpix::Object& obj);
 } // namespace allpix
 
-/**
- * @brief Missing comparison operator for TRef (to filter out unique)
- * @param ref1 First TRef
- * @param ref2 Second TRef
- * @return bool Returns true if first TRef should be ordered before second TRef
- */
-bool operator<(const TRef& ref1, const TRef& ref2);
-
 #endif /* ALLPIX_OBJECT_H */
@@ -16,17 +16,7 @@ using namespace allpix;
 
 PixelCharge::PixelCharge(Pixel pixel, unsigned int charge, const std::vector<const PropagatedCharge*>& propagated_charges)
     : pixel_(std::move(pixel)), charge_(charge) {
-    // Unique set of MC particles
-    std::set<TRef> unique_particles;
-    // Store all propagated charges and their MC particles
-    for(auto& propagated_charge : propagated_charges) {
-        propagated_charges_.push_back(const_cast<PropagatedCharge*>(propagated_charge)); // NOLINT
-        unique_particles.insert(propagated_charge->mc_particle_);
-    }
-    // Store the MC particle references
-    for(auto& mc_particle : unique_particles) {
-        mc_particles_.push_back(mc_particle);
-    }
+    set_history(propagated_charges);
 
     // No pulse provided, set full charge in first bin:
     pulse_.addCharge(charge, 0);
@@ -34,8 +24,36 @@ PixelCharge::PixelCharge(Pixel pixel, unsigned int charge, const std::vector<con
 
 // WARNING PixelCharge always returns a positive "collected" charge...
 PixelCharge::PixelCharge(Pixel pixel, Pulse pulse, const std::vector<const PropagatedCharge*>& propagated_charges)
-    : PixelCharge(std::move(pixel), static_cast<unsigned int>(std::abs(pulse.getCharge())), propagated_charges) {
-    pulse_ = std::move(pulse);
+    : pixel_(std::move(pixel)), charge_(static_cast<unsigned int>(std::abs(pulse.getCharge()))), pulse_(std::move(pulse)) {
+    set_history(propagated_charges);
+}
+
+void PixelCharge::set_history(const std::vector<const PropagatedCharge*>& propagated_charges) {
+    auto level = getMCTruth();
+    if(level == MCTruth::NONE) {
+        return;
+    }
+
+    // Unique set of MC particles
+    std::set<const MCParticle*> unique_particles;
+    // Store all propagated charges if the full history is requested, and their MC particles
+    if(level == MCTruth::FULL) {
+        propagated_charges_.reserve(propagated_charges.size());
+    }
+    for(auto& propagated_charge : propagated_charges) {
+        if(level == MCTruth::FULL) {
+            propagated_charges_.emplace_back(propagated_charge);
+        }
+        unique_particles.insert(truth_particle(propagated_charge->mc_particle_.get()));
+    }
+    // Store the MC particle references
+    mc_particles_.reserve(unique_particles.size());
+    for(auto& mc_particle : unique_particles) {
+        mc_particles_.emplace_back(mc_particle);
+    }
+
+    resolve_links(propagated_charges_, resolved_propagated_charges_);
+    resolve_links(mc_particles_, resolved_mc_particles_);
 }
 
 const Pixel& PixelCharge::getPixel() const {
@@ -57,18 +75,13 @@ const Pulse& PixelCharge::getPulse() const {
 /**
  * @throws MissingReferenceException If the pointed object is not in scope
  *
- * Objects are stored as vector of TRef and can only be accessed if pointed objects are in scope
+ * Objects are linked by pointers and can only be accessed if pointed objects are in scope
  */
-std::vector<const PropagatedCharge*> PixelCharge::getPropagatedCharges() const {
-    // FIXME: This is not very efficient unfortunately
-    std::vector<const PropagatedCharge*> propagated_charges;
-    for(auto& propagated_charge : propagated_charges_) {
-        if(!propagated_charge.IsValid() || propagated_charge.GetObject() == nullptr) {
-            throw MissingReferenceException(typeid(*this), typeid(PropagatedCharge));
-        }
-        propagated_charges.emplace_back(dynamic_cast<PropagatedCharge*>(propagated_charge.GetObject()));
+const std::vector<const PropagatedCharge*>& PixelCharge::getPropagatedCharges() const {
+    if(resolved_propagated_charges_.size() != propagated_charges_.size()) {
+        throw MissingReferenceException(typeid(*this), typeid(PropagatedCharge));
     }
-    return propagated_charges;
+    return resolved_propagated_charges_;
 }
 
 /**
@@ -76,18 +89,32 @@ std::vector<const PropagatedCharge*> PixelCharge::getPropagatedCharges() const {
  *
  * MCParticles can only be fetched if the full history of objects are in scope and stored
  */
-std::vector<const MCParticle*> PixelCharge::getMCParticles() const {
+const std::vector<const MCParticle*>& PixelCharge::getMCParticles() const {
+    if(resolved_mc_particles_.size() != mc_particles_.size()) {
+        throw MissingReferenceException(typeid(*this), typeid(MCParticle));
+    }
+    return resolved_mc_particles_;
+}
 
-    std::vector<const MCParticle*> mc_particles;
+void PixelCharge::loadHistory() {
+    for(auto& propagated_charge : propagated_charges_) {
+        propagated_charge.load();
+    }
     for(auto& mc_particle : mc_particles_) {
-        if(!mc_particle.IsValid() || mc_particle.GetObject() == nullptr) {
-            throw MissingReferenceException(typeid(*this), typeid(MCParticle));
-        }
-        mc_particles.emplace_back(dynamic_cast<MCParticle*>(mc_particle.GetObject()));
+        mc_particle.load();
     }
 
-    // Return as a vector of mc particles
-    return mc_particles;
+    resolve_links(propagated_charges_, resolved_propagated_charges_);
+    resolve_links(mc_particles_, resolved_mc_particles_);
+}
+
+void PixelCharge::petrifyHistory() {
+    for(auto& propagated_charge : propagated_charges_) {
+        propagated_charge.store();
+    }
+    for(auto& mc_particle : mc_particles_) {
+        mc_particle.store();
+    }
 }
 
 void PixelCharge::print(std::ostream& out) const {
@@ -11,7 +11,6 @@
 #define ALLPIX_PIXEL_CHARGE_H
 
 #include <Math/DisplacementVector2D.h>
-#include <TRef.h>
 #include <algorithm>
 
 #include "MCParticle.hpp"
@@ -67,14 +66,14 @@ namespace allpix {
 
         /**
          * @brief Get related propagated charges
-         * @return Possible set of pointers to propagated charges
+         * @return Possible set of pointers to propagated charges, resolved when the links have been created or loaded
          */
-        std::vector<const PropagatedCharge*> getPropagatedCharges() const;
+        const std::vector<const PropagatedCharge*>& getPropagatedCharges() const;
         /**
          * @brief Get the Monte-Carlo particles resulting in this pixel hit
-         * @return List of all related Monte-Carlo particles
+         * @return List of all related Monte-Carlo particles, resolved when the links have been created or loaded
          */
-        std::vector<const MCParticle*> getMCParticles() const;
+        const std::vector<const MCParticle*>& getMCParticles() const;
 
         /**
          *  @brief Get recoded charge pulse
@@ -82,6 +81,15 @@ namespace allpix {
          */
         const Pulse& getPulse() const;
 
+        /**
+         * @brief Restore the links to other objects after reading from file
+         */
+        void loadHistory() override;
+        /**
+         * @brief Convert the links to other objects to persistent references before writing to file
+         */
+        void petrifyHistory() override;
+
         /**
          * @brief Print an ASCII representation of PixelCharge to the given stream
          * @param out Stream to print to
@@ -91,19 +99,29 @@ namespace allpix {
         /**
          * @brief ROOT class definition
          */
-        ClassDefOverride(PixelCharge, 6);
+        ClassDefOverride(PixelCharge, 7);
         /**
          * @brief Default constructor for ROOT I/O
          */
         PixelCharge() = default;
 
     private:
+        /**
+         * @brief Store the links to the propagated charges and their unique Monte-Carlo particles
+         * @param propagated_charges Pointers to the related propagated charges
+         */
+        void set_history(const std::vector<const PropagatedCharge*>& propagated_charges);
+
         Pixel pixel_;
         unsigned int charge_{};
         Pulse pulse_{};
 
-        std::vector<TRef> propagated_charges_;
-        std::vector<TRef> mc_particles_;
+        std::vector<PointerWrapper<PropagatedCharge>> propagated_charges_;
+        std::vector<PointerWrapper<MCParticle>> mc_particles_;
+
+        // Linked objects resolved from the links above, to return them without allocating a new list on every call
+        std::vector<const PropagatedCharge*> resolved_propagated_charges_; //!
+        std::vector<const MCParticle*> resolved_mc_particles_;             //!
     };
 
     /**
@@ -19,16 +19,24 @@ using namespace allpix;
 
 PixelHit::PixelHit(Pixel pixel, double time, double signal, const PixelCharge* pixel_charge)
     : pixel_(std::move(pixel)), time_(time), signal_(signal) {
-    pixel_charge_ = const_cast<PixelCharge*>(pixel_charge); // NOLINT
+    if(getMCTruth() == MCTruth::FULL) {
+        pixel_charge_ = PointerWrapper<PixelCharge>(pixel_charge);
+    }
+    if(pixel_charge == nullptr || getMCTruth() == MCTruth::NONE) {
+        return;
+    }
+
     // Get the unique set of MC particles
-    std::set<TRef> unique_particles;
+    std::set<const MCParticle*> unique_particles;
     for(auto& mc_particle : pixel_charge->mc_particles_) {
-        unique_particles.insert(mc_particle);
+        unique_particles.insert(truth_particle(mc_particle.get()));
     }
     // Store the MC particle references
+    mc_particles_.reserve(unique_particles.size());
     for(auto& mc_particle : unique_particles) {
-        mc_particles_.push_back(mc_particle);
+        mc_particles_.emplace_back(mc_particle);
     }
+    resolve_links(mc_particles_, resolved_mc_particles_);
 }
 
 const Pixel& PixelHit::getPixel() const {
@@ -42,10 +50,10 @@ Pixel::Index PixelHit::getIndex() const {
 /**
  * @throws MissingReferenceException If the pointed object is not in scope
  *
- * Object is stored as TRef and can only be accessed if pointed object is in scope
+ * Object is linked by pointer and can only be accessed if pointed object is in scope
  */
 const PixelCharge* PixelHit::getPixelCharge() const {
-    auto pixel_charge = dynamic_cast<PixelCharge*>(pixel_charge_.GetObject());
+    auto pixel_charge = pixel_charge_.get();
     if(pixel_charge == nullptr) {
         throw MissingReferenceException(typeid(*this), typeid(PixelCharge));
     }
@@ -57,18 +65,11 @@ const PixelCharge* PixelHit::getPixelCharge() const {
  *
  * MCParticles can only be fetched if the full history of objects are in scope and stored
  */
-std::vector<const MCParticle*> PixelHit::getMCParticles() const {
-
-    std::vector<const MCParticle*> mc_particles;
-    for(auto& mc_particle : mc_particles_) {
-        if(!mc_particle.IsValid() || mc_particle.GetObject() == nullptr) {
-            throw MissingReferenceException(typeid(*this), typeid(MCParticle));
-        }
-        mc_particles.emplace_back(dynamic_cast<MCParticle*>(mc_particle.GetObject()));
+const std::vector<const MCParticle*>& PixelHit::getMCParticles() const {
+    if(resolved_mc_particles_.size() != mc_particles_.size()) {
+        throw MissingReferenceException(typeid(*this), typeid(MCParticle));
     }
-
-    // Return as a vector of mc particles
-    return mc_particles;
+    return resolved_mc_particles_;
 }
 
 /**
@@ -78,12 +79,7 @@ std::vector<const MCParticle*> PixelHit::getMCParticles() const {
  */
 std::vector<const MCParticle*> PixelHit::getPrimaryMCParticles() const {
     std::vector<const MCParticle*> primary_particles;
-    for(auto& mc_particle : mc_particles_) {
-        if(!mc_particle.IsValid() || mc_particle.GetObject() == nullptr) {
-            throw MissingReferenceException(typeid(*this), typeid(MCParticle));
-        }
-        auto particle = dynamic_cast<MCParticle*>(mc_particle.GetObject());
-
+    for(auto& particle : getMCParticles()) {
         // Check for possible parents:
         if(particle->getParent() != nullptr) {
             continue;
@@ -95,6 +91,21 @@ std::vector<const MCParticle*> PixelHit::getPrimaryMCParticles() const {
     return primary_particles;
 }
 
+void PixelHit::loadHistory() {
+    pixel_charge_.load();
+    for(auto& mc_particle : mc_particles_) {
+        mc_particle.load();
+    }
+    resolve_links(mc_particles_, resolved_mc_particles_);
+}
+
+void PixelHit::petrifyHistory() {
+    pixel_charge_.store();
+    for(auto& mc_particle : mc_particles_) {
+        mc_particle.store();
+    }
+}
+
 void PixelHit::print(std::ostream& out) const {
     out << "PixelHit " << this->getIndex().X() << ", " << this->getIndex().Y() << ", " << this->getSignal() << ", "
         << this->getTime();
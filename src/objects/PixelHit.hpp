@@ -12,7 +12,6 @@
 
 #include <Math/DisplacementVector2D.h>
 
-#include <TRef.h>
 
 #include "MCParticle.hpp"
 #include "Object.hpp"
@@ -64,15 +63,24 @@ namespace allpix {
         const PixelCharge* getPixelCharge() const;
         /**
          * @brief Get the Monte-Carlo particles resulting in this pixel hit
-         * @return List of all related Monte-Carlo particles
+         * @return List of all related Monte-Carlo particles, resolved when the links have been created or loaded
          */
-        std::vector<const MCParticle*> getMCParticles() const;
+        const std::vector<const MCParticle*>& getMCParticles() const;
         /**
          * @brief Get all primary Monte-Carlo particles resulting in this pixel hit. A particle is considered primary if it
          * has no parent particle set.
          * @return List of all related primary Monte-Carlo particles
          */
         std::vector<const MCParticle*> getPrimaryMCParticles() const;
+        /**
+         * @brief Restore the links to other objects after reading from file
+         */
+        void loadHistory() override;
+        /**
+         * @brief Convert the links to other objects to persistent references before writing to file
+         */
+        void petrifyHistory() override;
+
         /**
          * @brief Print an ASCII representation of PixelHit to the given stream
          * @param out Stream to print to
@@ -82,7 +90,7 @@ namespace allpix {
         /**
          * @brief ROOT class definition
          */
-        ClassDefOverride(PixelHit, 4);
+        ClassDefOverride(PixelHit, 5);
         /**
          * @brief Default constructor for ROOT I/O
          */
@@ -93,8 +101,11 @@ namespace allpix {
         double time_{};
         double signal_{};
 
-        TRef pixel_charge_;
-        std::vector<TRef> mc_particles_;
+        PointerWrapper<PixelCharge> pixel_charge_;
+        std::vector<PointerWrapper<MCParticle>> mc_particles_;
+
+        // Linked objects resolved from the links above, to return them without allocating a new list on every call
+        std::vector<const MCParticle*> resolved_mc_particles_; //!
     };
 
     /**
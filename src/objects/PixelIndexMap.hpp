@@ -0,0 +1,153 @@
+/**
+ * @file
+ * @brief Definition of a map from pixel indices to arbitrary values, optimized for the accumulation per event
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_PIXEL_INDEX_MAP_H
+#define ALLPIX_PIXEL_INDEX_MAP_H
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Pixel.hpp"
+
+namespace allpix {
+    /**
+     * @brief Map from pixel indices to values, replacing a std::map for the accumulation of values per pixel in an event
+     *
+     * The values are stored contiguously in insertion order and located through an open-addressing hash table of the pixel
+     * indices packed into a single integer. Iterating over the map visits the pixels in the same order as a std::map using
+     * the pixel index comparison, i.e. sorted by column and then by row, to keep the output of the modules unchanged. The
+     * values are sorted lazily when the iteration starts, such that references to values are invalidated by iterating.
+     */
+    template <typename T> class PixelIndexMap {
+    public:
+        using value_type = std::pair<Pixel::Index, T>;
+        using iterator = typename std::vector<value_type>::iterator;
+        using const_iterator = typename std::vector<value_type>::const_iterator;
+
+        /**
+         * @brief Get the value of a pixel, inserting a default constructed value if the pixel is not in the map yet
+         * @param index Index of the pixel
+         * @return Reference to the value, valid until the next insertion or iteration
+         */
+        T& operator[](const Pixel::Index& index) {
+            if(2 * (entries_.size() + 1) > slots_.size()) {
+                rebuild_slots(std::max<size_t>(16, 2 * slots_.size()));
+            }
+
+            auto key = pack(index);
+            auto mask = slots_.size() - 1;
+            for(size_t slot = hash(key) & mask;; slot = (slot + 1) & mask) {
+                auto entry = slots_[slot];
+                if(entry == 0) {
+                    // Insert the new pixel, the map stays sorted if the pixels are inserted in ascending order
+                    sorted_ = sorted_ && (entries_.empty() || pack(entries_.back().first) < key);
+                    entries_.emplace_back(index, T());
+                    slots_[slot] = static_cast<uint32_t>(entries_.size());
+                    return entries_.back().second;
+                }
+                if(pack(entries_[entry - 1].first) == key) {
+                    return entries_[entry - 1].second;
+                }
+            }
+        }
+
+        /**
+         * @brief Get the number of pixels in the map
+         * @return Number of pixels
+         */
+        size_t size() const { return entries_.size(); }
+
+        /**
+         * @brief Check if the map does not contain any pixel
+         * @return True if the map is empty, false otherwise
+         */
+        bool empty() const { return entries_.empty(); }
+
+        /**
+         * @brief Remove all pixels from the map, keeping the allocated memory for reuse
+         */
+        void clear() {
+            entries_.clear();
+            std::fill(slots_.begin(), slots_.end(), 0);
+            sorted_ = true;
+        }
+
+        /// @{
+        /**
+         * @brief Iterate over the pixels and their values sorted by pixel index
+         */
+        iterator begin() {
+            sort_entries();
+            return entries_.begin();
+        }
+        iterator end() { return entries_.end(); }
+        const_iterator begin() const {
+            sort_entries();
+            return entries_.cbegin();
+        }
+        const_iterator end() const { return entries_.cend(); }
+        /// @}
+
+    private:
+        /**
+         * @brief Pack a pixel index into a single integer with the same order as the pixel index comparison
+         */
+        static uint64_t pack(const Pixel::Index& index) {
+            return (static_cast<uint64_t>(index.x()) << 32) | static_cast<uint64_t>(index.y());
+        }
+
+        /**
+         * @brief Mix all bits of the packed index, as neighbouring pixels only differ in the lowest bits of each half
+         */
+        static size_t hash(uint64_t key) {
+            key ^= key >> 33;
+            key *= 0xff51afd7ed558ccdULL;
+            key ^= key >> 33;
+            return static_cast<size_t>(key);
+        }
+
+        /**
+         * @brief Sort the values by pixel index if they have not been inserted in order
+         */
+        void sort_entries() const {
+            if(sorted_) {
+                return;
+            }
+            std::sort(entries_.begin(), entries_.end(), [](const value_type& lhs, const value_type& rhs) {
+                return pack(lhs.first) < pack(rhs.first);
+            });
+            sorted_ = true;
+            rebuild_slots(slots_.size());
+        }
+
+        /**
+         * @brief Rebuild the hash table with the given number of slots, which should be a power of two
+         */
+        void rebuild_slots(size_t capacity) const {
+            slots_.assign(capacity, 0);
+            auto mask = capacity - 1;
+            for(size_t i = 0; i < entries_.size(); ++i) {
+                auto slot = hash(pack(entries_[i].first)) & mask;
+                while(slots_[slot] != 0) {
+                    slot = (slot + 1) & mask;
+                }
+                slots_[slot] = static_cast<uint32_t>(i + 1);
+            }
+        }
+
+        // Values in insertion order (or sorted by pixel index after iterating) and hash table of their positions plus one
+        mutable std::vector<value_type> entries_;
+        mutable std::vector<uint32_t> slots_;
+        mutable bool sorted_{true};
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_PIXEL_INDEX_MAP_H */
@@ -11,6 +11,8 @@
 
 #include "PropagatedCharge.hpp"
 
+#include <TBuffer.h>
+
 #include "exceptions.h"
 
 using namespace allpix;
@@ -22,9 +24,11 @@ PropagatedCharge::PropagatedCharge(ROOT::Math::XYZPoint local_position,
                                    double event_time,
                                    const DepositedCharge* deposited_charge)
     : SensorCharge(std::move(local_position), std::move(global_position), type, charge, event_time) {
-    deposited_charge_ = const_cast<DepositedCharge*>(deposited_charge); // NOLINT
+    if(getMCTruth() == MCTruth::FULL) {
+        deposited_charge_ = PointerWrapper<DepositedCharge>(deposited_charge);
+    }
     if(deposited_charge != nullptr) {
-        mc_particle_ = deposited_charge->mc_particle_;
+        mc_particle_ = PointerWrapper<MCParticle>(truth_particle(deposited_charge->mc_particle_.get()));
     }
 }
 
@@ -51,10 +55,10 @@ PropagatedCharge::PropagatedCharge(ROOT::Math::XYZPoint local_position,
 /**
  * @throws MissingReferenceException If the pointed object is not in scope
  *
- * Object is stored as TRef and can only be accessed if pointed object is in scope
+ * Object is linked by pointer and can only be accessed if pointed object is in scope
  */
 const DepositedCharge* PropagatedCharge::getDepositedCharge() const {
-    auto deposited_charge = dynamic_cast<DepositedCharge*>(deposited_charge_.GetObject());
+    auto deposited_charge = deposited_charge_.get();
     if(deposited_charge == nullptr) {
         throw MissingReferenceException(typeid(*this), typeid(DepositedCharge));
     }
@@ -64,21 +68,73 @@ const DepositedCharge* PropagatedCharge::getDepositedCharge() const {
 /**
  * @throws MissingReferenceException If the pointed object is not in scope
  *
- * Object is stored as TRef and can only be accessed if pointed object is in scope
+ * Object is linked by pointer and can only be accessed if pointed object is in scope
  */
 const MCParticle* PropagatedCharge::getMCParticle() const {
-    auto mc_particle = dynamic_cast<MCParticle*>(mc_particle_.GetObject());
+    auto mc_particle = mc_particle_.get();
     if(mc_particle == nullptr) {
         throw MissingReferenceException(typeid(*this), typeid(MCParticle));
     }
     return mc_particle;
 }
 
-std::map<Pixel::Index, Pulse> PropagatedCharge::getPulses() const {
+const std::map<Pixel::Index, Pulse>& PropagatedCharge::getPulses() const {
     return pulses_;
 }
 
+void PropagatedCharge::loadHistory() {
+    deposited_charge_.load();
+    mc_particle_.load();
+}
+
+void PropagatedCharge::petrifyHistory() {
+    deposited_charge_.store();
+    mc_particle_.store();
+}
+
 void PropagatedCharge::print(std::ostream& out) const {
     out << "--- Propagated charge information\n";
     SensorCharge::print(out);
 }
+
+/**
+ * The pulses are written as a list of pixel indices each followed by its pulse, instead of streaming the map with a version
+ * and byte count for every index. Versions before this format are read with the streamer info stored in the file.
+ */
+void PropagatedCharge::Streamer(TBuffer& buffer) {
+    if(buffer.IsReading()) {
+        UInt_t start = 0, count = 0;
+        auto version = buffer.ReadVersion(&start, &count);
+        if(version < 6) {
+            buffer.ReadClassBuffer(PropagatedCharge::Class(), this, version, start, count);
+            return;
+        }
+        SensorCharge::Streamer(buffer);
+        deposited_charge_.Streamer(buffer);
+        mc_particle_.Streamer(buffer);
+        UInt_t pulses = 0;
+        buffer >> pulses;
+        pulses_.clear();
+        for(UInt_t i = 0; i < pulses; ++i) {
+            UInt_t x = 0, y = 0;
+            buffer >> x;
+            buffer >> y;
+            Pulse pulse;
+            pulse.Streamer(buffer);
+            pulses_.emplace_hint(pulses_.end(), Pixel::Index(x, y), std::move(pulse));
+        }
+        buffer.CheckByteCount(start, count, PropagatedCharge::Class());
+    } else {
+        auto count = buffer.WriteVersion(PropagatedCharge::Class(), kTRUE);
+        SensorCharge::Streamer(buffer);
+        deposited_charge_.Streamer(buffer);
+        mc_particle_.Streamer(buffer);
+        buffer << static_cast<UInt_t>(pulses_.size());
+        for(auto& pulse : pulses_) {
+            buffer << pulse.first.x();
+            buffer << pulse.first.y();
+            pulse.second.Streamer(buffer);
+        }
+        buffer.SetByteCount(count, kTRUE);
+    }
+}
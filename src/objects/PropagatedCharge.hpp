@@ -73,9 +73,18 @@ namespace allpix {
 
         /**
          * @brief Get related induced pulses
-         * @return Map with induced pulses if available
+         * @return Reference to the map with induced pulses if available
          */
-        std::map<Pixel::Index, Pulse> getPulses() const;
+        const std::map<Pixel::Index, Pulse>& getPulses() const;
+
+        /**
+         * @brief Restore the links to other objects after reading from file
+         */
+        void loadHistory() override;
+        /**
+         * @brief Convert the links to other objects to persistent references before writing to file
+         */
+        void petrifyHistory() override;
 
         /**
          * @brief Print an ASCII representation of PropagatedCharge to the given stream
@@ -86,15 +95,15 @@ namespace allpix {
         /**
          * @brief ROOT class definition
          */
-        ClassDefOverride(PropagatedCharge, 4);
+        ClassDefOverride(PropagatedCharge, 6);
         /**
          * @brief Default constructor for ROOT I/O
          */
         PropagatedCharge() = default;
 
     private:
-        TRef deposited_charge_;
-        TRef mc_particle_{nullptr};
+        PointerWrapper<DepositedCharge> deposited_charge_;
+        PointerWrapper<MCParticle> mc_particle_;
         std::map<Pixel::Index, Pulse> pulses_;
     };
 
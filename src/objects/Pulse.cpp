@@ -12,6 +12,10 @@
 
 #include <cmath>
 #include <numeric>
+#include <stdexcept>
+#include <utility>
+
+#include <TBuffer.h>
 
 using namespace allpix;
 
@@ -25,7 +29,7 @@ void Pulse::addCharge(double charge, double time) {
     if(bin >= pulse_.size()) {
         pulse_.resize(bin + 1);
     }
-    pulse_.at(bin) += charge;
+    pulse_[bin] += charge;
 }
 
 int Pulse::getCharge() const {
@@ -41,8 +45,12 @@ double Pulse::getBinning() const {
     return bin_;
 }
 
+bool Pulse::isInitialized() const {
+    return initialized_;
+}
+
 Pulse& Pulse::operator+=(const Pulse& rhs) {
-    auto rhs_pulse = rhs.getPulse();
+    const auto& rhs_pulse = rhs.getPulse();
 
     // Allow to initialize uninitialized pulse
     if(!this->initialized_) {
@@ -61,9 +69,77 @@ Pulse& Pulse::operator+=(const Pulse& rhs) {
     }
 
     // Add up the individual bins:
+    auto* lhs_bins = this->pulse_.data();
+    const auto* rhs_bins = rhs_pulse.data();
     for(size_t bin = 0; bin < rhs_pulse.size(); bin++) {
-        this->pulse_.at(bin) += rhs_pulse.at(bin);
+        lhs_bins[bin] += rhs_bins[bin];
     }
 
     return *this;
 }
+
+/**
+ * Only the runs of non-zero bins are written, each as its first bin and length followed by the bins as a single array. Most
+ * bins of induced pulses are zero, in particular before the arrival of the charges and in the outer pixels of the induction
+ * matrix, such that only a small fraction of the bins is stored. Runs are only split at more than two consecutive zero bins,
+ * where omitting the bins saves more than writing another run. The total number of bins is stored as well to restore the
+ * dense pulse when reading. Versions before this format are read with the streamer info stored in the file, or as a single
+ * array for version 3.
+ */
+void Pulse::Streamer(TBuffer& buffer) {
+    if(buffer.IsReading()) {
+        UInt_t start = 0, count = 0;
+        auto version = buffer.ReadVersion(&start, &count);
+        if(version < 3) {
+            buffer.ReadClassBuffer(Pulse::Class(), this, version, start, count);
+            return;
+        }
+        UInt_t bins = 0;
+        buffer >> bins;
+        pulse_.assign(bins, 0.);
+        if(version < 4) {
+            buffer.ReadFastArray(pulse_.data(), static_cast<Int_t>(bins));
+        } else {
+            UInt_t runs = 0;
+            buffer >> runs;
+            for(UInt_t run = 0; run < runs; ++run) {
+                UInt_t first = 0, length = 0;
+                buffer >> first;
+                buffer >> length;
+                if(static_cast<size_t>(first) + length > bins) {
+                    throw std::out_of_range("run of pulse bins exceeds the length of the pulse");
+                }
+                buffer.ReadFastArray(pulse_.data() + first, static_cast<Int_t>(length));
+            }
+        }
+        buffer >> bin_;
+        buffer >> initialized_;
+        buffer.CheckByteCount(start, count, Pulse::Class());
+    } else {
+        // Find the runs of non-zero bins, merging runs separated by at most two zero bins
+        constexpr size_t max_zero_bins = 2;
+        std::vector<std::pair<UInt_t, UInt_t>> runs;
+        for(size_t bin = 0; bin < pulse_.size(); ++bin) {
+            if(pulse_[bin] == 0.) {
+                continue;
+            }
+            if(!runs.empty() && bin - (runs.back().first + runs.back().second) <= max_zero_bins) {
+                runs.back().second = static_cast<UInt_t>(bin + 1 - runs.back().first);
+            } else {
+                runs.emplace_back(static_cast<UInt_t>(bin), 1);
+            }
+        }
+
+        auto count = buffer.WriteVersion(Pulse::Class(), kTRUE);
+        buffer << static_cast<UInt_t>(pulse_.size());
+        buffer << static_cast<UInt_t>(runs.size());
+        for(auto& run : runs) {
+            buffer << run.first;
+            buffer << run.second;
+            buffer.WriteFastArray(pulse_.data() + run.first, static_cast<Int_t>(run.second));
+        }
+        buffer << bin_;
+        buffer << initialized_;
+        buffer.SetByteCount(count, kTRUE);
+    }
+}
@@ -57,6 +57,12 @@ namespace allpix {
          */
         double getBinning() const;
 
+        /**
+         * @brief Check if the pulse has been constructed with a time binning
+         * @return True if the pulse has a binning, false if all charge is stored in the first bin
+         */
+        bool isInitialized() const;
+
         /**
          * @brief compound assignment operator to sum different pulses
          * @throws IncompatibleDatatypesException If the binning of the pulses does not match
@@ -66,7 +72,7 @@ namespace allpix {
         /**
          * @brief Default constructor for ROOT I/O
          */
-        ClassDef(Pulse, 2);
+        ClassDef(Pulse, 4);
 
     private:
         std::vector<double> pulse_;
@@ -9,8 +9,25 @@
 
 #include "SensorCharge.hpp"
 
+#include <TBuffer.h>
+
 using namespace allpix;
 
+namespace {
+    void write_point(TBuffer& buffer, const ROOT::Math::XYZPoint& point) {
+        buffer << point.x();
+        buffer << point.y();
+        buffer << point.z();
+    }
+    void read_point(TBuffer& buffer, ROOT::Math::XYZPoint& point) {
+        Double_t x = 0, y = 0, z = 0;
+        buffer >> x;
+        buffer >> y;
+        buffer >> z;
+        point.SetCoordinates(x, y, z);
+    }
+} // namespace
+
 SensorCharge::SensorCharge(ROOT::Math::XYZPoint local_position,
                            ROOT::Math::XYZPoint global_position,
                            CarrierType type,
@@ -46,3 +63,36 @@ void SensorCharge::print(std::ostream& out) const {
         << "Global Position: (" << global_position_.X() << ", " << global_position_.Y() << ", " << global_position_.Z()
         << ") mm\n";
 }
+
+/**
+ * The positions are written as plain coordinates instead of streaming every point as an object with its own version and
+ * byte count. Versions before this format are read with the streamer info stored in the file.
+ */
+void SensorCharge::Streamer(TBuffer& buffer) {
+    if(buffer.IsReading()) {
+        UInt_t start = 0, count = 0;
+        auto version = buffer.ReadVersion(&start, &count);
+        if(version < 3) {
+            buffer.ReadClassBuffer(SensorCharge::Class(), this, version, start, count);
+            return;
+        }
+        Object::Streamer(buffer);
+        read_point(buffer, local_position_);
+        read_point(buffer, global_position_);
+        Char_t type = 0;
+        buffer >> type;
+        type_ = static_cast<CarrierType>(type);
+        buffer >> charge_;
+        buffer >> event_time_;
+        buffer.CheckByteCount(start, count, SensorCharge::Class());
+    } else {
+        auto count = buffer.WriteVersion(SensorCharge::Class(), kTRUE);
+        Object::Streamer(buffer);
+        write_point(buffer, local_position_);
+        write_point(buffer, global_position_);
+        buffer << static_cast<Char_t>(type_);
+        buffer << charge_;
+        buffer << event_time_;
+        buffer.SetByteCount(count, kTRUE);
+    }
+}
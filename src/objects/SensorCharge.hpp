@@ -81,7 +81,7 @@ namespace allpix {
         /**
          * @brief ROOT class definition
          */
-        ClassDefOverride(SensorCharge, 2);
+        ClassDefOverride(SensorCharge, 3);
         /**
          * @brief Default constructor for ROOT I/O
          */
@@ -0,0 +1,96 @@
+/**
+ * @file
+ * @brief Utility to group objects on a pixel grid into clusters of adjacent pixels
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_CLUSTERING_H
+#define ALLPIX_CLUSTERING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace allpix {
+
+    /**
+     * @brief Group objects on a pixel grid into clusters of directly or diagonally adjacent pixels
+     * @param objects List of objects to cluster, for example pixel hits
+     * @param get_index Function returning the pixel index of an object, the index should provide x() and y() accessors
+     * @return List of clusters, every cluster given as the positions of its objects in the input list
+     *
+     * A cluster is seeded by the first object in the input list which is not yet part of another cluster. The cluster is
+     * then grown by repeatedly adding the first object in the input list which is adjacent to any object of the cluster,
+     * where objects on the same pixel are also considered adjacent. The positions in every cluster are returned in the
+     * order the objects are added, the seed being the first element. The neighbours are found using a hash map of the
+     * occupied pixels, and the candidates to add are kept sorted in a priority queue, such that the complexity is
+     * O(N log N) in the number of objects.
+     */
+    template <typename T, typename F>
+    std::vector<std::vector<size_t>> cluster_adjacent_pixels(const std::vector<T>& objects, F get_index) {
+        auto key = [](uint64_t x, uint64_t y) { return (x << 32) | y; };
+
+        // Build map of all occupied pixels to the objects on these pixels
+        std::unordered_map<uint64_t, std::vector<size_t>> grid;
+        grid.reserve(objects.size());
+        for(size_t idx = 0; idx < objects.size(); ++idx) {
+            auto index = get_index(objects[idx]);
+            grid[key(index.x(), index.y())].push_back(idx);
+        }
+
+        std::vector<char> used(objects.size(), 0);
+        std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> candidates;
+
+        // Add all unused objects on the pixel of the given object and its eight neighbours as candidates
+        auto add_neighbours = [&](size_t idx) {
+            auto index = get_index(objects[idx]);
+            uint64_t x = index.x();
+            uint64_t y = index.y();
+            for(uint64_t nx = (x == 0 ? 0 : x - 1); nx <= x + 1; ++nx) {
+                for(uint64_t ny = (y == 0 ? 0 : y - 1); ny <= y + 1; ++ny) {
+                    auto pixel = grid.find(key(nx, ny));
+                    if(pixel == grid.end()) {
+                        continue;
+                    }
+                    for(auto neighbour : pixel->second) {
+                        if(!used[neighbour]) {
+                            candidates.push(neighbour);
+                        }
+                    }
+                }
+            }
+        };
+
+        std::vector<std::vector<size_t>> clusters;
+        for(size_t seed = 0; seed < objects.size(); ++seed) {
+            if(used[seed]) {
+                continue;
+            }
+
+            // Create new cluster from the seed and keep adding the first adjacent object
+            used[seed] = 1;
+            clusters.emplace_back(1, seed);
+            add_neighbours(seed);
+            while(!candidates.empty()) {
+                auto idx = candidates.top();
+                candidates.pop();
+                if(used[idx]) {
+                    continue;
+                }
+
+                used[idx] = 1;
+                clusters.back().push_back(idx);
+                add_neighbours(idx);
+            }
+        }
+        return clusters;
+    }
+} // namespace allpix
+
+#endif /* ALLPIX_CLUSTERING_H */
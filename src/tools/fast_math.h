@@ -0,0 +1,196 @@
+/**
+ * @file
+ * @brief Fast approximations of elementary functions and a fast sampler of the normal distribution
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * The approximations avoid the special case handling of the standard library and consist of a fixed sequence of
+ * arithmetic operations and bit manipulations without branches, such that the compiler can inline and vectorize them. They
+ * are only defined for finite arguments in the documented ranges, which are the ones occurring in the propagation of
+ * charge carriers. The relative error bounds are given for these ranges.
+ */
+
+#ifndef ALLPIX_FAST_MATH_H
+#define ALLPIX_FAST_MATH_H
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace allpix {
+    namespace fast_math {
+        /**
+         * @brief Fast approximation of the base-2 logarithm
+         * @param x Positive normal floating point number
+         * @return Base-2 logarithm of the argument, with an absolute error below 1e-9
+         *
+         * The argument is decomposed into its binary exponent and a mantissa \f$m \in [\sqrt{1/2}, \sqrt{2})\f$. The natural
+         * logarithm of the mantissa is computed from the series of \f$2 \operatorname{artanh}(t)\f$ in
+         * \f$t = (m - 1) / (m + 1)\f$ up to the ninth order, with \f$|t| < 0.172\f$.
+         */
+        inline double log2(double x) {
+            uint64_t bits;
+            std::memcpy(&bits, &x, sizeof(bits));
+
+            // Exponent of the argument, shifted by one if the mantissa is above sqrt(2)
+            constexpr uint64_t sqrt2_mantissa = 0x6a09e667f3bcdULL;
+            const uint64_t mantissa_bits = bits & 0xfffffffffffffULL;
+            const uint64_t above = (sqrt2_mantissa - mantissa_bits) >> 63;
+            const auto exponent = static_cast<int64_t>((bits >> 52) & 0x7ff) - 1023 + static_cast<int64_t>(above);
+
+            // Mantissa scaled to [sqrt(1/2), sqrt(2))
+            bits = mantissa_bits | ((1023 - above) << 52);
+            double mantissa;
+            std::memcpy(&mantissa, &bits, sizeof(mantissa));
+
+            const double t = (mantissa - 1.) / (mantissa + 1.);
+            const double t2 = t * t;
+            const double series = t * (2. + t2 * (2. / 3 + t2 * (2. / 5 + t2 * (2. / 7 + t2 * (2. / 9)))));
+            return static_cast<double>(exponent) + series * 1.4426950408889634;
+        }
+
+        /**
+         * @brief Fast approximation of the base-2 exponential
+         * @param x Exponent with a magnitude below 1000
+         * @return Two raised to the power of the argument, with a relative error below 1e-9
+         *
+         * The argument is split into the nearest integer, which is inserted as binary exponent, and a remainder
+         * \f$|f| \leq 1/2\f$, for which \f$e^{f \ln 2}\f$ is computed from the Taylor series up to the eighth order.
+         */
+        inline double exp2(double x) {
+            // Round to the nearest integer by adding and subtracting 1.5 * 2^52, which avoids the call to std::nearbyint
+            constexpr double round_shift = 6755399441055744.;
+            const double rounded = (x + round_shift) - round_shift;
+            const double f = (x - rounded) * 0.6931471805599453;
+            // Horner scheme of the Taylor series, from the eighth order down
+            constexpr std::array<double, 8> coefficients{
+                {1. / 5040, 1. / 720, 1. / 120, 1. / 24, 1. / 6, 1. / 2, 1., 1.}};
+            double series = 1. / 40320;
+            for(auto coefficient : coefficients) {
+                series = series * f + coefficient;
+            }
+
+            uint64_t bits = static_cast<uint64_t>(static_cast<int64_t>(rounded) + 1023) << 52;
+            double scale;
+            std::memcpy(&scale, &bits, sizeof(scale));
+            return series * scale;
+        }
+
+        /**
+         * @brief Fast approximation of the natural logarithm
+         * @param x Positive normal floating point number
+         * @return Natural logarithm of the argument, with an absolute error below 1e-9
+         */
+        inline double log(double x) { return fast_math::log2(x) * 0.6931471805599453; }
+
+        /**
+         * @brief Fast approximation of the exponential function
+         * @param x Exponent with a magnitude below 690
+         * @return Euler's number raised to the power of the argument, with a relative error below 2e-9
+         */
+        inline double exp(double x) { return fast_math::exp2(x * 1.4426950408889634); }
+
+        /**
+         * @brief Fast approximation of the power function for positive bases
+         * @param base Positive normal floating point number
+         * @param exponent Exponent of the power
+         * @return Base raised to the power of the exponent
+         *
+         * The power is computed as \f$2^{y \log_2 x}\f$. The relative error is below \f$10^{-9} (1 + |y|)\f$ as long as
+         * \f$|y \log_2 x| < 1000\f$, which amounts to a relative error below 1e-8 for the exponents of the mobility
+         * parameterizations.
+         */
+        inline double pow(double base, double exponent) { return fast_math::exp2(exponent * fast_math::log2(base)); }
+
+        /**
+         * @brief Sampler of the standard normal distribution using the Ziggurat method
+         *
+         * The Ziggurat method by G. Marsaglia and W. W. Tsang, https://doi.org/10.18637/jss.v005.i08, covers the density
+         * with 256 horizontal layers of equal area. Every sample draws a single 64 bit random number, of which eight bits
+         * select the layer, one bit the sign and 53 bits the position within the layer. In about 99% of the cases the
+         * position lies within the part of the layer fully below the density and is returned directly, only the remaining
+         * cases require the evaluation of the density or sampling from the tail. The layout of the layers follows
+         * J. A. Doornik, "An Improved Ziggurat Method to Generate Normal Random Samples" (2005).
+         *
+         * The samples follow the normal distribution exactly up to the floating point precision of the tables, but the
+         * sequence differs from the one of std::normal_distribution with the same random engine. The tables are computed on
+         * construction, such that an instance should be reused. Sampling does not modify the instance and can be done by
+         * multiple threads concurrently. The random engine should deliver uniformly distributed 64 bit numbers, as
+         * std::mt19937_64 and the CounterRandomEngine do.
+         */
+        class ZigguratNormal {
+        public:
+            /**
+             * @brief Compute the widths of the layers and the density at their boundaries
+             */
+            ZigguratNormal() {
+                // Tail boundary and area of every layer for 256 layers
+                constexpr double tail = 3.6541528853610088;
+                constexpr double area = 4.92867323399e-3;
+
+                x_[0] = area / density(tail);
+                x_[1] = tail;
+                for(size_t i = 2; i < layers; ++i) {
+                    x_[i] = std::sqrt(-2. * std::log(area / x_[i - 1] + density(x_[i - 1])));
+                }
+                x_[layers] = 0;
+
+                for(size_t i = 0; i <= layers; ++i) {
+                    f_[i] = density(x_[i]);
+                }
+            }
+
+            /**
+             * @brief Draw a sample from the standard normal distribution
+             * @param engine Random engine delivering uniformly distributed 64 bit numbers
+             * @return Normally distributed sample with zero mean and unit standard deviation
+             */
+            template <typename Engine> double operator()(Engine& engine) const {
+                static_assert(Engine::min() == 0 && Engine::max() == std::numeric_limits<uint64_t>::max(),
+                              "random engine should deliver 64 bit numbers");
+                while(true) {
+                    const uint64_t bits = engine();
+                    const auto layer = static_cast<size_t>(bits & (layers - 1));
+                    const double sign = ((bits & layers) != 0 ? -1. : 1.);
+                    const double value = uniform(bits) * x_[layer];
+
+                    // Point within the part of the layer below the density of the next layer
+                    if(value < x_[layer + 1]) {
+                        return sign * value;
+                    }
+
+                    // Point in the tail beyond the base layer
+                    if(layer == 0) {
+                        double a, b;
+                        do {
+                            a = -std::log(1. - uniform(engine())) / x_[1];
+                            b = -std::log(1. - uniform(engine()));
+                        } while(2. * b < a * a);
+                        return sign * (x_[1] + a);
+                    }
+
+                    // Point in the wedge at the edge of the layer, compare with the density
+                    const double height = f_[layer] + uniform(engine()) * (f_[layer + 1] - f_[layer]);
+                    if(height < density(value)) {
+                        return sign * value;
+                    }
+                }
+            }
+
+        private:
+            static constexpr size_t layers = 256;
+
+            static double density(double x) { return std::exp(-0.5 * x * x); }
+            static double uniform(uint64_t bits) { return static_cast<double>(bits >> 11) / 9007199254740992.; }
+
+            std::array<double, layers + 1> x_{};
+            std::array<double, layers + 1> f_{};
+        };
+    } // namespace fast_math
+} // namespace allpix
+
+#endif /* ALLPIX_FAST_MATH_H */
@@ -0,0 +1,205 @@
+/**
+ * @file
+ * @brief Fast Fourier transform of complex sequences and linear convolution of real sequences
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_FFT_H
+#define ALLPIX_FFT_H
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace allpix {
+    /**
+     * @brief Plan of the fast Fourier transform of complex sequences with a fixed power-of-two length
+     *
+     * The bit reversal permutation and the twiddle factors are computed once when the plan is created, such that every
+     * transform only consists of the iterative radix-2 butterflies. A plan is not modified by a transform and can be used by
+     * multiple threads concurrently.
+     */
+    class FFTPlan {
+    public:
+        /**
+         * @brief Prepare the transform of sequences of the given length
+         * @param size Length of the sequences, should be a power of two
+         * @throws std::runtime_error If the length is not a power of two
+         */
+        explicit FFTPlan(size_t size) : size_(size) {
+            if(size == 0 || (size & (size - 1)) != 0) {
+                throw std::runtime_error("length of the transform should be a power of two but is " +
+                                            std::to_string(size));
+            }
+
+            // Pairs of indices swapped by the bit reversal permutation
+            for(size_t i = 1, j = 0; i < size; ++i) {
+                auto bit = size >> 1;
+                for(; (j & bit) != 0; bit >>= 1) {
+                    j ^= bit;
+                }
+                j ^= bit;
+                if(i < j) {
+                    swaps_.emplace_back(i, j);
+                }
+            }
+
+            // Twiddle factors of the forward transform
+            twiddles_.resize(size / 2);
+            for(size_t k = 0; k < size / 2; ++k) {
+                auto angle = -2. * M_PI * static_cast<double>(k) / static_cast<double>(size);
+                twiddles_[k] = std::complex<double>(std::cos(angle), std::sin(angle));
+            }
+        }
+
+        /**
+         * @brief Get the length of the transformed sequences
+         * @return Length of the sequences
+         */
+        size_t getSize() const { return size_; }
+
+        /**
+         * @brief Get the smallest length supported by a plan which is not shorter than the given length
+         * @param length Minimum length
+         * @return Smallest power of two not smaller than the minimum length
+         */
+        static size_t getSize(size_t length) {
+            size_t size = 1;
+            while(size < length) {
+                size <<= 1;
+            }
+            return size;
+        }
+
+        /**
+         * @brief Compute the discrete Fourier transform of a sequence in place
+         * @param data Sequence of the length of the plan
+         */
+        void forward(std::complex<double>* data) const { transform(data, false); }
+
+        /**
+         * @brief Compute the inverse discrete Fourier transform of a sequence in place, including the normalization
+         * @param data Sequence of the length of the plan
+         */
+        void inverse(std::complex<double>* data) const {
+            transform(data, true);
+            const double norm = 1. / static_cast<double>(size_);
+            for(size_t i = 0; i < size_; ++i) {
+                data[i] *= norm;
+            }
+        }
+
+    private:
+        void transform(std::complex<double>* data, bool inverse) const {
+            for(const auto& swap : swaps_) {
+                std::swap(data[swap.first], data[swap.second]);
+            }
+            for(size_t length = 2; length <= size_; length <<= 1) {
+                const auto half = length / 2;
+                const auto stride = size_ / length;
+                for(size_t start = 0; start < size_; start += length) {
+                    for(size_t k = 0; k < half; ++k) {
+                        auto twiddle = (inverse ? std::conj(twiddles_[k * stride]) : twiddles_[k * stride]);
+                        auto even = data[start + k];
+                        auto odd = data[start + k + half] * twiddle;
+                        data[start + k] = even + odd;
+                        data[start + k + half] = even - odd;
+                    }
+                }
+            }
+        }
+
+        size_t size_;
+        std::vector<std::pair<size_t, size_t>> swaps_;
+        std::vector<std::complex<double>> twiddles_;
+    };
+
+    /**
+     * @brief Linear convolution of real sequences with a fixed kernel, using the transform of the kernel for all sequences
+     *
+     * The convolution is computed as the product of the transforms of the sequence and the kernel, zero-padded to avoid the
+     * circular wrap-around. Two real sequences are convolved with a single complex transform by passing them as real and
+     * imaginary part: since the kernel is real, the real and imaginary part of the result are the convolutions of the two
+     * sequences. The cost per sequence is proportional to \f$N \log N\f$ instead of \f$N^2\f$ for the direct convolution.
+     */
+    class FFTConvolution {
+    public:
+        /**
+         * @brief Prepare the convolution with a kernel
+         * @param kernel Values of the kernel
+         * @param length Number of values of the convolved sequences and of the results, longer sequences are truncated
+         */
+        FFTConvolution(const std::vector<double>& kernel, size_t length)
+            : length_(length), plan_(FFTPlan::getSize(length + std::min(kernel.size(), length))),
+              spectrum_(plan_.getSize()) {
+            // Only the values of the kernel within the result length contribute
+            for(size_t i = 0; i < std::min(kernel.size(), length); ++i) {
+                spectrum_[i] = kernel[i];
+            }
+            plan_.forward(spectrum_.data());
+        }
+
+        /**
+         * @brief Get the number of values of the results
+         * @return Length of the results
+         */
+        size_t getLength() const { return length_; }
+
+        /**
+         * @brief Convolve one or two sequences with the kernel
+         * @param first First sequence
+         * @param second Second sequence, or a null pointer to only convolve the first sequence
+         * @param first_result Convolution of the first sequence with the kernel, truncated to the result length
+         * @param second_result Convolution of the second sequence with the kernel, not used without second sequence
+         *
+         * Every thread uses its own buffer for the transform, such that an instance can be used by multiple threads.
+         */
+        void convolve(const std::vector<double>& first,
+                      const std::vector<double>* second,
+                      std::vector<double>& first_result,
+                      std::vector<double>& second_result) const {
+            thread_local std::vector<std::complex<double>> buffer;
+            buffer.assign(plan_.getSize(), std::complex<double>());
+            for(size_t i = 0; i < std::min(first.size(), length_); ++i) {
+                buffer[i].real(first[i]);
+            }
+            if(second != nullptr) {
+                for(size_t i = 0; i < std::min(second->size(), length_); ++i) {
+                    buffer[i].imag((*second)[i]);
+                }
+            }
+
+            plan_.forward(buffer.data());
+            for(size_t i = 0; i < buffer.size(); ++i) {
+                buffer[i] *= spectrum_[i];
+            }
+            plan_.inverse(buffer.data());
+
+            first_result.resize(length_);
+            for(size_t i = 0; i < length_; ++i) {
+                first_result[i] = buffer[i].real();
+            }
+            if(second != nullptr) {
+                second_result.resize(length_);
+                for(size_t i = 0; i < length_; ++i) {
+                    second_result[i] = buffer[i].imag();
+                }
+            }
+        }
+
+    private:
+        size_t length_;
+        FFTPlan plan_;
+        std::vector<std::complex<double>> spectrum_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_FFT_H */
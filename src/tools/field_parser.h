@@ -11,10 +11,33 @@
 #define ALLPIX_FIELD_PARSER_H
 
 #include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "core/utils/annotation.h"
 #include "core/utils/file.h"
 #include "core/utils/log.h"
 #include "core/utils/unit.h"
@@ -30,6 +53,9 @@
 // Mime type version for APF files
 #define APF_MIME_TYPE_VERSION 1
 
+// Format version for memory-mapped field files
+#define MAPPED_FIELD_FORMAT_VERSION 1
+
 namespace allpix {
 
     /**
@@ -48,8 +74,48 @@ namespace allpix {
         UNKNOWN = 0, ///< Unknown file format
         INIT,        ///< Leagcy file format, values stored in plain-text ASCII
         APF,         ///< Binary Allpix Squared format serialized using the cereal library
+        MAPPED,      ///< Binary Allpix Squared format with aligned raw field data, memory-mapped when read
     };
 
+    /**
+     * @brief Header of memory-mapped field files
+     *
+     * The header is followed by the human readable description of the field and the raw field data in native byte order.
+     * The field data starts at an offset aligned to the size of a cache line, such that it can be accessed directly from the
+     * memory mapping of the file.
+     */
+    struct MappedFieldHeader {
+        char magic[8];               ///< Identifier of the file format
+        std::uint32_t byte_order;    ///< Known constant to detect files written with a different byte order
+        std::uint32_t version;       ///< Version of the file format
+        std::uint64_t quantity;      ///< Number of field components per field position
+        std::uint64_t dimensions[3]; ///< Number of bins in each dimension
+        double size[3];              ///< Physical extent of the field in each dimension in internal units
+        std::uint64_t header_length; ///< Length of the human readable description following this header
+        std::uint64_t data_offset;   ///< Offset of the field data from the beginning of the file
+    };
+
+    /**
+     * @brief Identifier at the beginning of memory-mapped field files
+     */
+    constexpr char mapped_field_magic[8] = {'A', 'P', 'S', 'Q', 'F', 'L', 'D', '\0'};
+    /**
+     * @brief Byte order marker of memory-mapped field files
+     */
+    constexpr std::uint32_t mapped_field_byte_order = 0x01020304;
+    /**
+     * @brief Alignment of the field data in memory-mapped field files
+     */
+    constexpr std::uint64_t mapped_field_alignment = 64;
+
+    /**
+     * @brief Directory of the shared memory in which converted fields are shared between processes
+     */
+    constexpr const char* shared_field_directory = "/dev/shm";
+
+    template <typename T> class FieldParser;
+    template <typename T> class FieldWriter;
+
     /**
      * Class to hold raw, three-dimensional field data with N components, containing
      * * The actual field data as shared pointer to vector
@@ -74,7 +140,26 @@ namespace allpix {
                   std::array<size_t, 3> dimensions,
                   std::array<T, 3> size,
                   std::shared_ptr<std::vector<T>> data)
-            : header_(std::move(header)), dimensions_(dimensions), size_(size), data_(std::move(data)){};
+            : header_(std::move(header)), dimensions_(dimensions), size_(size), data_(std::move(data)) {
+            view_ = std::shared_ptr<const T>(data_, data_->data());
+            elements_ = data_->size();
+        };
+
+        /**
+         * @brief Constructor for field data referring to externally owned memory, e.g. a memory-mapped file
+         * @param header     Human readable header string to identify file content, program version used for generation etc.
+         * @param dimensions Number of bins of the field in each coordinate
+         * @param size       Physical extent of the field in each dimension, given in internal units
+         * @param view       Shared pointer to the first element of the flat field data, owning the memory
+         * @param elements   Number of elements of the flat field data
+         */
+        FieldData(std::string header,
+                  std::array<size_t, 3> dimensions,
+                  std::array<T, 3> size,
+                  std::shared_ptr<const T> view,
+                  size_t elements)
+            : header_(std::move(header)), dimensions_(dimensions), size_(size), view_(std::move(view)),
+              elements_(elements){};
 
         /**
          * @brief Function to obtain the header (human readbale content description) of the field data
@@ -97,8 +182,26 @@ namespace allpix {
         /**
          * @brief Member to access the actual field data
          * @return shared pointer to the flat vector of field data
+         * @warning For field data referring to externally owned memory, this creates a copy of the full field data
+         */
+        std::shared_ptr<std::vector<T>> getData() const {
+            if(!data_ && view_) {
+                return std::make_shared<std::vector<T>>(view_.get(), view_.get() + elements_);
+            }
+            return data_;
+        }
+
+        /**
+         * @brief Member to access the field data without copying it
+         * @return shared pointer to the first element of the flat field data
          */
-        std::shared_ptr<std::vector<T>> getData() const { return data_; }
+        std::shared_ptr<const T> getView() const { return view_; }
+
+        /**
+         * @brief Member to get the number of elements of the flat field data
+         * @return number of elements
+         */
+        size_t getNumberOfElements() const { return elements_; }
 
         /**
          * @brief get the dimensionality of the configured field in the x-y plane, e.g whether it is defined in 1D, 2D or 3D.
@@ -116,8 +219,11 @@ namespace allpix {
         std::array<size_t, 3> dimensions_{};
         std::array<T, 3> size_{};
         std::shared_ptr<std::vector<T>> data_;
+        std::shared_ptr<const T> view_;
+        size_t elements_{};
 
         friend class cereal::access;
+        template <typename U> friend class FieldParser;
 
         // Versioned serialization function:
         template <class Archive> void serialize(Archive& archive, std::uint32_t const version) {
@@ -126,11 +232,22 @@ namespace allpix {
                 throw std::runtime_error("unknown format version " + std::to_string(version));
             }
 
+            // Copy data referring to external memory before serializing it:
+            if(!data_ && view_) {
+                data_ = getData();
+            }
+
             // (De-) Serialize the data:
             archive(header_);
             archive(dimensions_);
             archive(size_);
             archive(data_);
+
+            // Update the view on the data after deserializing it:
+            if(data_) {
+                view_ = std::shared_ptr<const T>(data_, data_->data());
+                elements_ = data_->size();
+            }
         }
     };
 } // namespace allpix
@@ -158,8 +275,9 @@ namespace allpix {
      * @brief Class to parse Allpix Squared field data from files
      *
      * This class can be used to deserialize and parse FieldData objects from files of different format. The FieldData
-     * objects read from file are cached, and a cache hit will be returned when trying to re-read a file with the same
-     * canoncial path.
+     * objects read from file are cached by all parsers of the same type, and a cache hit will be returned when trying to
+     * re-read a file with the same canonical path and units. Identical fields read from different files share their values.
+     * The cache does not keep the field values alive, they are released once no FieldData object refers to them anymore.
      */
     template <typename T = double> class FieldParser {
     public:
@@ -167,8 +285,10 @@ namespace allpix {
          * Construct a FieldParser
          * @param quantity Quantity of individual field points, vector (three values per point) or scalar (one value per
          * point)
+         * @param cache_init_files Store fields read from INIT files in binary files next to them and reuse these later
          */
-        explicit FieldParser(const FieldQuantity quantity) {
+        explicit FieldParser(const FieldQuantity quantity, bool cache_init_files = false)
+            : cache_init_files_(cache_init_files) {
             // Store quantity: vector or scalar field:
             N_ = static_cast<std::underlying_type<FieldQuantity>::type>(quantity);
         };
@@ -178,21 +298,285 @@ namespace allpix {
          * @brief Parse a file and retrieve the field data.
          * @param file_name  File name (as canonical path) of the input file to be parsed
          * @param units      Optional units to convert the field from after reading from file. Only used by some formats.
+         * @param shared_memory Share the field converted to the memory-mapped format with all processes on the same node
          * @return           Field data object read from file or internal cache
          *
          * The type of the field data file to be read is deducted automatically from the file content
          */
-        FieldData<T> getByFileName(const std::string& file_name, const std::string& units = std::string()) {
-            // Search in cache (NOTE: the path reached here is always a canonical name)
-            auto iter = field_map_.find(file_name);
-            if(iter != field_map_.end()) {
+        FieldData<T>
+        getByFileName(const std::string& file_name, const std::string& units = std::string(), bool shared_memory = false) {
+            PROFILER_RANGE("FieldParser::getByFileName");
+            // Search in cache (NOTE: the path reached here is always a canonical name), the key includes the units and the
+            // quantity as the same file can be parsed differently
+            auto key = file_name + '\n' + units + '\n' + std::to_string(N_);
+            auto& cache = get_cache();
+            auto find_cached = [&](FieldData<T>& field_data) {
+                auto iter = cache.files.find(key);
+                if(iter == cache.files.end() || !restore(*iter->second, field_data)) {
+                    return false;
+                }
                 LOG(INFO) << "Using cached field data";
-                return iter->second;
+                return true;
+            };
+
+            // Only one thread parses a given file, other threads requesting the same file wait for the result
+            FieldData<T> field_data;
+            std::shared_ptr<std::mutex> file_mutex;
+            {
+                std::lock_guard<std::mutex> lock(cache.mutex);
+                if(find_cached(field_data)) {
+                    return field_data;
+                }
+                auto& mutex = cache.file_mutexes[key];
+                if(mutex == nullptr) {
+                    mutex = std::make_shared<std::mutex>();
+                }
+                file_mutex = mutex;
+            }
+            std::lock_guard<std::mutex> file_lock(*file_mutex);
+            {
+                std::lock_guard<std::mutex> lock(cache.mutex);
+                if(find_cached(field_data)) {
+                    return field_data;
+                }
             }
 
+            field_data = (shared_memory ? parse_shared_file(file_name, units) : parse_file(file_name, units));
+            auto hash = hash_field(field_data);
+
+            // Share the field data with an identical field already loaded from a different file or with different units
+            std::lock_guard<std::mutex> lock(cache.mutex);
+            evict_unused(cache);
+            std::shared_ptr<CachedField> entry;
+            auto range = cache.contents.equal_range(hash);
+            for(auto iter = range.first; iter != range.second; ++iter) {
+                FieldData<T> existing;
+                if(restore(*iter->second, existing) && is_identical(existing, field_data)) {
+                    LOG(INFO) << "Sharing identical field data already loaded from another file";
+                    entry = iter->second;
+                    field_data = existing;
+                    break;
+                }
+            }
+            if(entry == nullptr) {
+                entry = std::make_shared<CachedField>();
+                entry->header = field_data.header_;
+                entry->dimensions = field_data.dimensions_;
+                entry->size = field_data.size_;
+                entry->data = field_data.data_;
+                entry->view = field_data.view_;
+                entry->elements = field_data.elements_;
+                cache.contents.emplace(hash, entry);
+            }
+
+            // Store the parsed field data for further reference:
+            cache.files[key] = entry;
+            return field_data;
+        }
+
+        /**
+         * @brief Read the header of a file without reading the field data
+         * @param file_name  File name (as canonical path) of the input file
+         * @return           Field data object with the header, the dimensions, the size and the number of elements of the
+         *                   field, but without any field data
+         *
+         * Only the beginning of the file is read, independent of the size of the field. This allows to check the field
+         * against the detector before reading it. The type of the file is deducted automatically from the file content,
+         * the size of fields in INIT files is interpreted as micrometers as when parsing the full file. The quantity of the
+         * field in INIT files is only checked against the first line of field data.
+         */
+        FieldData<T> getHeaderByFileName(const std::string& file_name) const {
+            FieldData<T> field_data;
+            switch(guess_file_type(file_name)) {
+            case FileType::MAPPED:
+                field_data = read_mapped_header(file_name);
+                break;
+            case FileType::APF:
+                field_data = read_apf_header(file_name);
+                break;
+            default:
+                field_data = read_init_header(file_name);
+                break;
+            }
+
+            // Check that we have the right number of vector entries
+            auto dimensions = field_data.getDimensions();
+            if(field_data.getNumberOfElements() != dimensions[0] * dimensions[1] * dimensions[2] * N_) {
+                throw std::runtime_error("invalid data");
+            }
+            return field_data;
+        }
+
+        /**
+         * @brief Read the field data of an INIT file block by block, without holding the full file or field in memory
+         * @param file_name  File name (as canonical path) of the input file
+         * @param units      Units the field is provided in
+         * @param block_size Number of bytes of the file read at once, the lines of every block are parsed in parallel
+         * @param store      Function storing a field value at the given index of the flat field array as stored in
+         *                   FieldData objects, called concurrently from multiple threads
+         * @return           Field data object with the header of the file, but without any field data
+         *
+         * The fields read are not cached, every call reads the full file again.
+         */
+        template <typename F>
+        FieldData<T>
+        readInitFileInBlocks(const std::string& file_name, const std::string& units, size_t block_size, const F& store) {
+            std::ifstream file(file_name, std::ios::binary);
+            if(!file) {
+                throw std::runtime_error("cannot open file");
+            }
+            std::string file_units;
+            auto field_data = read_init_header(file, file_units);
+            check_unit_match(file_units, units);
+            LOG(TRACE) << "Header of file " << file_name << " is " << std::endl << field_data.getHeader();
+
+            auto dimensions = field_data.getDimensions();
+            auto vertices = dimensions[0] * dimensions[1] * dimensions[2];
+            auto unit_factor = Units::get(1.0, units);
+
+            // Read blocks of full lines, keeping the incomplete last line for the next block
+            size_t total = 0;
+            std::string block, remainder;
+            while(file) {
+                block.swap(remainder);
+                auto offset = block.size();
+                block.resize(offset + block_size);
+                file.read(&block[offset], static_cast<std::streamsize>(block_size));
+                block.resize(offset + static_cast<size_t>(file.gcount()));
+
+                remainder.clear();
+                if(file) {
+                    auto line_end = block.rfind('\n');
+                    if(line_end == std::string::npos) {
+                        throw std::runtime_error("line of field data longer than block size");
+                    }
+                    remainder.assign(block, line_end + 1, std::string::npos);
+                    block.resize(line_end + 1);
+                }
+
+                total += parse_init_data(block.data(), block.data() + block.size(), dimensions, unit_factor, store);
+                auto progress = std::min<size_t>(100, 100 * total / std::max<size_t>(vertices, 1));
+                LOG_PROGRESS(INFO, "read_init") << "Reading field data: " << progress << "%";
+            }
+            LOG_PROGRESS(INFO, "read_init") << "Reading field data: finished.";
+
+            if(total < vertices) {
+                throw std::runtime_error("unexpected end of file");
+            } else if(total > vertices) {
+                LOG(WARNING) << "Field file contains " << total << " vertices, but only " << vertices << " are expected";
+            }
+            return field_data;
+        }
+
+    private:
+        /**
+         * @brief Field data in the cache, referring to the field values without owning them
+         */
+        struct CachedField {
+            std::string header;
+            std::array<size_t, 3> dimensions{};
+            std::array<T, 3> size{};
+            std::weak_ptr<std::vector<T>> data;
+            std::weak_ptr<const T> view;
+            size_t elements{};
+        };
+
+        /**
+         * @brief Cache of field data shared by all field parsers of the same type
+         *
+         * The field data is cached by file name as well as by a hash of its content. The cache does not own the field
+         * values, they are released as soon as the last user of the field data releases it and the entry is evicted.
+         */
+        struct FieldCache {
+            std::mutex mutex;
+            std::map<std::string, std::shared_ptr<CachedField>> files;
+            std::multimap<std::uint64_t, std::shared_ptr<CachedField>> contents;
+            std::map<std::string, std::shared_ptr<std::mutex>> file_mutexes;
+        };
+
+        /**
+         * @brief Function to access the process-wide field cache
+         * @return Reference to the cache
+         */
+        static FieldCache& get_cache() {
+            static FieldCache cache;
+            return cache;
+        }
+
+        /**
+         * @brief Function to restore field data from a cache entry if its values are still in use
+         * @param entry Cache entry to restore the field data from
+         * @param field_data Field data object to restore
+         * @return True if the field data has been restored, false if the values have been released
+         */
+        static bool restore(const CachedField& entry, FieldData<T>& field_data) {
+            auto view = entry.view.lock();
+            if(view == nullptr) {
+                return false;
+            }
+            field_data = FieldData<T>(entry.header, entry.dimensions, entry.size, std::move(view), entry.elements);
+            field_data.data_ = entry.data.lock();
+            return true;
+        }
+
+        /**
+         * @brief Function to remove all cache entries whose field values have been released
+         * @param cache Cache to clean, the mutex of the cache needs to be held by the caller
+         */
+        static void evict_unused(FieldCache& cache) {
+            for(auto iter = cache.files.begin(); iter != cache.files.end();) {
+                iter = (iter->second->view.expired() ? cache.files.erase(iter) : std::next(iter));
+            }
+            for(auto iter = cache.contents.begin(); iter != cache.contents.end();) {
+                iter = (iter->second->view.expired() ? cache.contents.erase(iter) : std::next(iter));
+            }
+            // Mutexes of files not parsed at the moment are only referenced by the cache
+            for(auto iter = cache.file_mutexes.begin(); iter != cache.file_mutexes.end();) {
+                iter = (iter->second.use_count() == 1 ? cache.file_mutexes.erase(iter) : std::next(iter));
+            }
+        }
+
+        /**
+         * @brief Function to calculate the FNV-1a hash of the binning, the extent and the values of field data
+         * @param field_data Field data to calculate the hash for
+         * @return Hash of the field data
+         */
+        static std::uint64_t hash_field(const FieldData<T>& field_data) {
+            std::uint64_t hash = 14695981039346656037ull;
+            auto add = [&hash](const void* data, size_t length) {
+                const auto* bytes = static_cast<const unsigned char*>(data);
+                for(size_t i = 0; i < length; ++i) {
+                    hash = (hash ^ bytes[i]) * 1099511628211ull;
+                }
+            };
+            add(field_data.dimensions_.data(), sizeof(field_data.dimensions_));
+            add(field_data.size_.data(), sizeof(field_data.size_));
+            add(field_data.view_.get(), field_data.elements_ * sizeof(T));
+            return hash;
+        }
+
+        /**
+         * @brief Function to check if two field data objects have the same binning, extent and values
+         * @param lhs First field data object
+         * @param rhs Second field data object
+         * @return True if the field data is identical, false otherwise
+         */
+        static bool is_identical(const FieldData<T>& lhs, const FieldData<T>& rhs) {
+            return lhs.dimensions_ == rhs.dimensions_ && lhs.size_ == rhs.size_ && lhs.elements_ == rhs.elements_ &&
+                   std::equal(lhs.view_.get(), lhs.view_.get() + lhs.elements_, rhs.view_.get());
+        }
+
+        /**
+         * @brief Function to parse a field data file of any of the supported formats
+         * @param file_name File name (as canonical path) of the input file to be parsed
+         * @param units Optional units to convert the field from after reading from file
+         * @return Field data object read from file
+         */
+        FieldData<T> parse_file(const std::string& file_name, const std::string& units) {
             // Deduce the file format
             auto file_type = guess_file_type(file_name);
-            LOG(DEBUG) << "Assuming file type \"" << (file_type == FileType::APF ? "APF" : "INIT") << "\"";
+            LOG(DEBUG) << "Assuming file type \""
+                       << (file_type == FileType::MAPPED ? "MAPPED" : file_type == FileType::APF ? "APF" : "INIT") << "\"";
 
             switch(file_type) {
             case FileType::INIT:
@@ -206,20 +590,118 @@ namespace allpix {
                     LOG(DEBUG) << "Units will be ignored, APF file content is interpreted in internal units.";
                 }
                 return parse_apf_file(file_name);
+            case FileType::MAPPED:
+                if(!units.empty()) {
+                    LOG(DEBUG) << "Units will be ignored, mapped file content is interpreted in internal units.";
+                }
+                return parse_mapped_file(file_name);
             default:
                 throw std::runtime_error("unknown file format");
             }
         }
 
-    private:
+        /**
+         * @brief Function to read a field data file through a copy in the memory-mapped format placed in shared memory
+         * @param file_name File name (as canonical path) of the input file to be parsed
+         * @param units Optional units to convert the field from after reading from file
+         * @return Field data object referring to the copy in shared memory
+         *
+         * The copy is named after a hash of the path, the size and the modification time of the file together with the
+         * units and the field quantity, such that it is replaced if the file changes. The first process locking the copy
+         * parses the file and stores the copy, while all other processes wait for it and map the copy directly. The copies
+         * are kept after the end of the run, until they are removed or the node is restarted.
+         */
+        FieldData<T> parse_shared_file(const std::string& file_name, const std::string& units) {
+            struct stat file_stat {};
+            if(::stat(file_name.c_str(), &file_stat) != 0) {
+                throw std::runtime_error("cannot open file");
+            }
+            if(guess_file_type(file_name) == FileType::MAPPED) {
+                // Mapped files are already shared between processes through the page cache
+                return parse_file(file_name, units);
+            }
+            if(!path_is_directory(shared_field_directory)) {
+                LOG(WARNING) << "Shared memory directory " << shared_field_directory << " not available, reading field "
+                             << "without sharing it with other processes";
+                return parse_file(file_name, units);
+            }
+
+            // Use FNV-1a to hash the identity of the file together with the conversion of the values
+            std::uint64_t hash = 14695981039346656037ull;
+            auto add = [&hash](const std::string& data) {
+                for(auto ch : data) {
+                    hash = (hash ^ static_cast<unsigned char>(ch)) * 1099511628211ull;
+                }
+            };
+            add(file_name + "/" + std::to_string(file_stat.st_size) + "/" + std::to_string(file_stat.st_mtime));
+            add(units + "/" + std::to_string(N_));
+            std::ostringstream shared_name_stream;
+            shared_name_stream << shared_field_directory << "/allpix-field-" << std::hex << std::setw(16)
+                               << std::setfill('0') << hash << ".apfm";
+            auto shared_name = shared_name_stream.str();
+
+            // Only one process converts the field, all others wait for the lock and use the stored copy
+            auto lock_fd = ::open((shared_name + ".lock").c_str(), O_RDWR | O_CREAT, 0666);
+            if(lock_fd < 0 || ::flock(lock_fd, LOCK_EX) != 0) {
+                if(lock_fd >= 0) {
+                    ::close(lock_fd);
+                }
+                LOG(WARNING) << "Cannot lock shared field " << shared_name << ", reading field without sharing it";
+                return parse_file(file_name, units);
+            }
+            struct FileLock {
+                int fd;
+                ~FileLock() {
+                    ::flock(fd, LOCK_UN);
+                    ::close(fd);
+                }
+            } lock{lock_fd};
+
+            if(path_is_file(shared_name)) {
+                try {
+                    auto field_data = parse_mapped_file(shared_name);
+                    LOG(INFO) << "Using field data from shared memory " << shared_name;
+                    return field_data;
+                } catch(std::exception& e) {
+                    LOG(WARNING) << "Replacing invalid shared field " << shared_name << ": " << e.what();
+                }
+            }
+
+            // Store the copy under a temporary name first, such that it only appears once it is complete
+            auto field_data = parse_file(file_name, units);
+            auto temporary_name = shared_name + "." + std::to_string(::getpid()) + ".tmp";
+            try {
+                FieldWriter<T>(static_cast<FieldQuantity>(N_)).writeFile(field_data, temporary_name, FileType::MAPPED);
+            } catch(std::exception& e) {
+                LOG(WARNING) << "Cannot store field in shared memory " << shared_name << ": " << e.what();
+                std::remove(temporary_name.c_str());
+                return field_data;
+            }
+            if(std::rename(temporary_name.c_str(), shared_name.c_str()) != 0) {
+                LOG(WARNING) << "Cannot store field in shared memory " << shared_name;
+                std::remove(temporary_name.c_str());
+                return field_data;
+            }
+            LOG(INFO) << "Stored field data in shared memory " << shared_name;
+
+            // Refer to the shared copy instead of the private one to only hold the field once on the node
+            return parse_mapped_file(shared_name);
+        }
+
         /**
          * @brief Function to guess the type of a field data file
          * @param path Path to the file to be tested
          * @return Type of the file
          *
-         * This function checks if the file contains binary data to interpret it as APF formator INIT format otherwise.
+         * This function checks for the identifier of memory-mapped field files first. Otherwise, it checks if the file
+         * contains binary data to interpret it as APF format or INIT format otherwise.
          */
         FileType guess_file_type(const std::string& path) const {
+            std::ifstream file(path, std::ios::binary);
+            char magic[sizeof(mapped_field_magic)] = {};
+            if(file.read(magic, sizeof(magic)) && std::memcmp(magic, mapped_field_magic, sizeof(magic)) == 0) {
+                return FileType::MAPPED;
+            }
             return (file_is_binary(path) ? FileType::APF : FileType::INIT);
         }
 
@@ -248,6 +730,178 @@ namespace allpix {
             return field_data;
         }
 
+        /**
+         * @brief Function to read the header of an APF file. The header, the dimensions and the size are serialized before
+         * the field data, followed by the number of elements of the field data, such that reading can stop there.
+         * @param file_name  File name (as canonical path) of the input file
+         */
+        FieldData<T> read_apf_header(const std::string& file_name) const {
+            std::ifstream file(file_name, std::ios::binary);
+            FieldData<T> field_data;
+            try {
+                cereal::PortableBinaryInputArchive archive(file);
+                // Same layout as the serialization of the field data, starting with the class version
+                std::uint32_t version = 0;
+                archive(version);
+                if(version != APF_MIME_TYPE_VERSION) {
+                    throw std::runtime_error("unknown format version " + std::to_string(version));
+                }
+                archive(field_data.header_);
+                archive(field_data.dimensions_);
+                archive(field_data.size_);
+                // Identifier of the shared pointer followed by the size of the vector
+                std::uint32_t pointer_id = 0;
+                cereal::size_type elements = 0;
+                archive(pointer_id);
+                archive(cereal::make_size_tag(elements));
+                field_data.elements_ = static_cast<size_t>(elements);
+            } catch(cereal::Exception& e) {
+                throw std::runtime_error("invalid data or unexpected end of file");
+            }
+            return field_data;
+        }
+
+        /**
+         * @brief Function to read the header of a memory-mapped field file, without mapping the field data
+         * @param file_name  File name (as canonical path) of the input file
+         */
+        FieldData<T> read_mapped_header(const std::string& file_name) const {
+            std::ifstream file(file_name, std::ios::binary);
+            MappedFieldHeader header{};
+            if(!file.read(reinterpret_cast<char*>(&header), sizeof(header))) { // NOLINT
+                throw std::runtime_error("invalid data or unexpected end of file");
+            }
+            if(header.byte_order != mapped_field_byte_order) {
+                throw std::runtime_error("file written with incompatible byte order");
+            }
+            if(header.version != MAPPED_FIELD_FORMAT_VERSION) {
+                throw std::runtime_error("unknown format version " + std::to_string(header.version));
+            }
+            if(header.quantity != N_) {
+                throw std::runtime_error("invalid field quantity");
+            }
+
+            std::string description(header.header_length, '\0');
+            if(!file.read(&description[0], static_cast<std::streamsize>(description.size()))) {
+                throw std::runtime_error("invalid data or unexpected end of file");
+            }
+            FieldData<T> field_data;
+            field_data.header_ = std::move(description);
+            field_data.dimensions_ = {{header.dimensions[0], header.dimensions[1], header.dimensions[2]}};
+            field_data.size_ = {{header.size[0], header.size[1], header.size[2]}};
+            field_data.elements_ = header.dimensions[0] * header.dimensions[1] * header.dimensions[2] * N_;
+            return field_data;
+        }
+
+        /**
+         * @brief Function to read the header of an INIT file, without parsing the field data following it
+         * @param file_name  File name (as canonical path) of the input file
+         */
+        FieldData<T> read_init_header(const std::string& file_name) const {
+            std::ifstream file(file_name, std::ios::binary);
+            if(!file) {
+                throw std::runtime_error("cannot open file");
+            }
+            std::string file_units;
+            return read_init_header(file, file_units);
+        }
+
+        /**
+         * @brief Function to read the header of an INIT file from a stream
+         * @param file       Input stream positioned at the beginning of the file, positioned at the beginning of the field
+         *                   data afterwards
+         * @param file_units Units stated in the header
+         */
+        FieldData<T> read_init_header(std::istream& file, std::string& file_units) const {
+            std::string header, content, token;
+            std::getline(file, header);
+            // The header following the first line consists of nineteen tokens, independent of their distribution on lines
+            for(size_t i = 0; i < 19 && file >> token; ++i) {
+                content += token + ' ';
+            }
+            auto data_start = file.tellg();
+
+            const char* ptr = content.c_str();
+            FieldData<T> field_data;
+            parse_init_header(ptr, content.c_str() + content.size(), file_units, field_data.dimensions_, field_data.size_);
+            field_data.header_ = header;
+
+            // Every line of field data holds the indices of the bin followed by the field components
+            std::getline(file, token);
+            while(std::getline(file, token) && allpix::trim(token).empty()) {
+            }
+            std::istringstream first_line(token);
+            size_t columns = 0;
+            while(first_line >> token) {
+                ++columns;
+            }
+            if(columns != 3 + N_) {
+                throw std::runtime_error("invalid data");
+            }
+            field_data.elements_ = field_data.dimensions_[0] * field_data.dimensions_[1] * field_data.dimensions_[2] * N_;
+
+            file.clear();
+            file.seekg(data_start);
+            return field_data;
+        }
+
+        /**
+         * @brief Function to read FieldData from a memory-mapped field file. The file is mapped read-only and shared, such
+         * that the field data is only held once in the page cache for all processes reading the same file. No units are
+         * converted, all values are stored in framework-internal base units.
+         * @param file_name  File name (as canonical path) of the input file to be parsed
+         */
+        FieldData<T> parse_mapped_file(const std::string& file_name) {
+            auto fd = ::open(file_name.c_str(), O_RDONLY);
+            if(fd < 0) {
+                throw std::runtime_error("cannot open file");
+            }
+            struct stat file_stat {};
+            if(::fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(MappedFieldHeader)) {
+                ::close(fd);
+                throw std::runtime_error("invalid data or unexpected end of file");
+            }
+            auto file_size = static_cast<size_t>(file_stat.st_size);
+            void* address = ::mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+            // The mapping stays valid after closing the file descriptor
+            ::close(fd);
+            if(address == MAP_FAILED) { // NOLINT
+                throw std::runtime_error("cannot map file into memory");
+            }
+            std::shared_ptr<const char> mapping(static_cast<const char*>(address), [file_size](const char* ptr) {
+                ::munmap(const_cast<char*>(ptr), file_size); // NOLINT
+            });
+
+            // Check the header
+            MappedFieldHeader header{};
+            std::memcpy(&header, mapping.get(), sizeof(header));
+            if(header.byte_order != mapped_field_byte_order) {
+                throw std::runtime_error("file written with incompatible byte order");
+            }
+            if(header.version != MAPPED_FIELD_FORMAT_VERSION) {
+                throw std::runtime_error("unknown format version " + std::to_string(header.version));
+            }
+            if(header.quantity != N_) {
+                throw std::runtime_error("invalid field quantity");
+            }
+            auto elements = header.dimensions[0] * header.dimensions[1] * header.dimensions[2] * N_;
+            if(header.data_offset % alignof(T) != 0 || header.data_offset < sizeof(header) + header.header_length ||
+               header.data_offset + elements * sizeof(T) > file_size) {
+                throw std::runtime_error("invalid data or unexpected end of file");
+            }
+
+            std::string description(mapping.get() + sizeof(header), header.header_length);
+            LOG(TRACE) << "Header of file " << file_name << " is " << std::endl << description;
+
+            // Refer to the field data in the mapping, keeping the mapping alive as long as the data is used
+            std::shared_ptr<const T> view(mapping, reinterpret_cast<const T*>(mapping.get() + header.data_offset));
+            std::array<size_t, 3> dimensions{{header.dimensions[0], header.dimensions[1], header.dimensions[2]}};
+            std::array<T, 3> size{{header.size[0], header.size[1], header.size[2]}};
+            FieldData<T> field_data(std::move(description), dimensions, size, std::move(view), elements);
+
+            return field_data;
+        }
+
         /**
          * @brief Helper function to compare potential units defined in the INIT file against the ones provided:
          * @param file_units Unit string read from the file
@@ -277,81 +931,296 @@ namespace allpix {
          * interpreted as micrometers.
          * @param file_name  File name (as canonical path) of the input file to be parsed
          * @param units      Units to convert the values of the field data from
+         *
+         * The file is read into memory at once and the field data is parsed in parallel chunks of full lines. If caching is
+         * enabled, the parsed field is stored in an APF file next to the INIT file, which is named after a hash of the file
+         * content and the requested units. Later calls for the same file content read this binary file instead.
          */
         FieldData<T> parse_init_file(const std::string& file_name, const std::string& units) {
             // Load file
-            std::ifstream file(file_name);
-            std::string header;
-            std::getline(file, header);
+            std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+            if(!file) {
+                throw std::runtime_error("cannot open file");
+            }
+            std::string content(static_cast<size_t>(file.tellg()), '\0');
+            file.seekg(0);
+            file.read(&content[0], static_cast<std::streamsize>(content.size()));
+            if(file.fail()) {
+                throw std::runtime_error("cannot read file");
+            }
+
+            // Read the field from the binary cache if it has been stored before
+            std::string cache_file_name;
+            if(cache_init_files_) {
+                cache_file_name = get_cache_file_name(file_name, content, units);
+                if(path_is_file(cache_file_name)) {
+                    try {
+                        auto field_data = parse_apf_file(cache_file_name);
+                        LOG(INFO) << "Using binary field cache " << cache_file_name;
+                        return field_data;
+                    } catch(std::exception& e) {
+                        LOG(WARNING) << "Ignoring invalid binary field cache " << cache_file_name << ": " << e.what();
+                    }
+                }
+            }
+
+            auto line_end = content.find('\n');
+            std::string header = content.substr(0, line_end);
             LOG(TRACE) << "Header of file " << file_name << " is " << std::endl << header;
 
             // Read the header
-            std::string tmp;
-            // WARNING the usage of this field as storage for the field units differs from the original INIT format!
-            file >> tmp;
-            check_unit_match(allpix::trim(tmp), units);
-            file >> tmp;               // ignore cluster length
-            file >> tmp >> tmp >> tmp; // ignore the incident pion direction
-            file >> tmp >> tmp >> tmp; // ignore the magnetic field (specify separately)
-            double thickness, xpixsz, ypixsz;
-            file >> thickness >> xpixsz >> ypixsz;
-            thickness = Units::get(thickness, "um");
-            xpixsz = Units::get(xpixsz, "um");
-            ypixsz = Units::get(ypixsz, "um");
-            file >> tmp >> tmp >> tmp >> tmp; // ignore temperature, flux, rhe (?) and new_drde (?)
-            size_t xsize, ysize, zsize;
-            file >> xsize >> ysize >> zsize;
-            file >> tmp;
+            const char* ptr = content.c_str() + std::min(line_end, content.size());
+            const char* end = content.c_str() + content.size();
+            std::string file_units;
+            std::array<size_t, 3> dimensions{};
+            std::array<T, 3> size{};
+            parse_init_header(ptr, end, file_units, dimensions, size);
+            check_unit_match(file_units, units);
 
-            if(file.fail()) {
-                throw std::runtime_error("invalid data or unexpected end of file");
-            }
             auto field = std::make_shared<std::vector<double>>();
-            auto vertices = xsize * ysize * zsize;
+            auto vertices = dimensions[0] * dimensions[1] * dimensions[2];
             field->resize(vertices * N_);
 
-            // Loop through all the field data
-            for(size_t i = 0; i < vertices; ++i) {
-                if(i % (vertices / 100) == 0) {
-                    LOG_PROGRESS(INFO, "read_init") << "Reading field data: " << (100 * i / vertices) << "%";
-                }
+            LOG(DEBUG) << "Parsing field data with " << vertices << " vertices";
+            auto total = parse_init_data(
+                ptr, end, dimensions, Units::get(1.0, units), [&](size_t index, double value) { (*field)[index] = value; });
+            if(total < vertices) {
+                throw std::runtime_error("unexpected end of file");
+            } else if(total > vertices) {
+                LOG(WARNING) << "Field file contains " << total << " vertices, but only " << vertices << " are expected";
+            }
+            LOG(INFO) << "Read field data with " << vertices << " vertices";
 
-                if(file.eof()) {
-                    throw std::runtime_error("unexpected end of file");
-                }
+            FieldData<T> field_data(header, dimensions, size, field);
+
+            // Store the parsed field data in the binary cache, not being able to write it is not an error
+            if(cache_init_files_) {
+                write_cache_file(field_data, cache_file_name);
+            }
 
-                // Get index of field
-                size_t xind, yind, zind;
-                file >> xind >> yind >> zind;
+            return field_data;
+        }
 
-                if(file.fail() || xind > xsize || yind > ysize || zind > zsize) {
-                    throw std::runtime_error("invalid data");
+        /**
+         * @brief Helper function to parse the field data of an INIT file, split into chunks of full lines parsed in parallel
+         * @param ptr Beginning of the field data
+         * @param end End of the field data, should be at the end of a line
+         * @param dimensions Number of bins of the field in each dimension
+         * @param unit_factor Factor to convert the field values into internal units
+         * @param store Function storing a field value at the given index of the flat field array, called concurrently
+         * @return Number of vertices parsed
+         */
+        template <typename F>
+        size_t parse_init_data(
+            const char* ptr, const char* end, std::array<size_t, 3> dimensions, double unit_factor, const F& store) const {
+            auto xsize = dimensions[0];
+            auto ysize = dimensions[1];
+            auto zsize = dimensions[2];
+
+            // Split the field data into chunks of full lines to be parsed in parallel
+            std::vector<const char*> chunks{ptr};
+            auto threads = std::max(1u, std::thread::hardware_concurrency());
+            auto chunk_size = std::max<size_t>(static_cast<size_t>(end - ptr) / threads, 1 << 24);
+            while(static_cast<size_t>(end - chunks.back()) > chunk_size) {
+                auto chunk_end = std::find(chunks.back() + chunk_size, end, '\n');
+                if(chunk_end == end) {
+                    break;
                 }
-                xind--;
-                yind--;
-                zind--;
+                chunks.push_back(chunk_end + 1);
+            }
+            chunks.push_back(end);
 
-                // Loop through components of field
-                for(size_t j = 0; j < N_; ++j) {
-                    double input;
-                    file >> input;
+            std::vector<size_t> parsed(chunks.size() - 1, 0);
+            std::vector<std::exception_ptr> errors(chunks.size() - 1);
+            auto parse_chunk = [&](size_t chunk) {
+                try {
+                    const char* chunk_ptr = chunks[chunk];
+                    while(skip_whitespace(chunk_ptr, chunks[chunk + 1]) != chunks[chunk + 1]) {
+                        // Get index of field
+                        auto xind = parse_number<size_t>(chunk_ptr, chunks[chunk + 1]);
+                        auto yind = parse_number<size_t>(chunk_ptr, chunks[chunk + 1]);
+                        auto zind = parse_number<size_t>(chunk_ptr, chunks[chunk + 1]);
+                        if(xind == 0 || yind == 0 || zind == 0 || xind > xsize || yind > ysize || zind > zsize) {
+                            throw std::runtime_error("invalid data");
+                        }
+                        xind--;
+                        yind--;
+                        zind--;
 
-                    // Set the field at a position
-                    (*field)[xind * ysize * zsize * N_ + yind * zsize * N_ + zind * N_ + j] = Units::get(input, units);
+                        // Loop through components of field and set the field at a position
+                        auto offset = xind * ysize * zsize * N_ + yind * zsize * N_ + zind * N_;
+                        for(size_t j = 0; j < N_; ++j) {
+                            store(offset + j, parse_number<double>(chunk_ptr, chunks[chunk + 1]) * unit_factor);
+                        }
+                        ++parsed[chunk];
+                    }
+                } catch(...) {
+                    errors[chunk] = std::current_exception();
+                }
+            };
+            std::vector<std::thread> workers;
+            for(size_t chunk = 1; chunk < chunks.size() - 1; ++chunk) {
+                workers.emplace_back(parse_chunk, chunk);
+            }
+            parse_chunk(0);
+            for(auto& worker : workers) {
+                worker.join();
+            }
+            for(auto& error : errors) {
+                if(error) {
+                    std::rethrow_exception(error);
                 }
             }
-            LOG_PROGRESS(INFO, "read_init") << "Reading field data: finished.";
 
-            FieldData<T> field_data(
-                header, std::array<size_t, 3>{{xsize, ysize, zsize}}, std::array<T, 3>{{xpixsz, ypixsz, thickness}}, field);
+            return std::accumulate(parsed.begin(), parsed.end(), size_t(0));
+        }
 
-            // Store the parsed field data for further reference:
-            field_map_[file_name] = field_data;
-            return field_data;
+        /**
+         * @brief Helper function to parse the header of an INIT file following its first line
+         * @param ptr Position after the first line, updated to the beginning of the field data
+         * @param end End of the buffer
+         * @param file_units Units stated in the header
+         * @param dimensions Number of bins of the field in each dimension
+         * @param size Physical extent of the field in each dimension, converted from micrometers
+         */
+        static void parse_init_header(const char*& ptr,
+                                      const char* end,
+                                      std::string& file_units,
+                                      std::array<size_t, 3>& dimensions,
+                                      std::array<T, 3>& size) {
+            // WARNING the usage of this field as storage for the field units differs from the original INIT format!
+            file_units = allpix::trim(next_token(ptr, end));
+            for(size_t i = 0; i < 7; ++i) {
+                // ignore cluster length, the incident pion direction and the magnetic field (specify separately)
+                next_token(ptr, end);
+            }
+            auto thickness = Units::get(parse_number<double>(ptr, end), "um");
+            auto xpixsz = Units::get(parse_number<double>(ptr, end), "um");
+            auto ypixsz = Units::get(parse_number<double>(ptr, end), "um");
+            for(size_t i = 0; i < 4; ++i) {
+                // ignore temperature, flux, rhe (?) and new_drde (?)
+                next_token(ptr, end);
+            }
+            auto xsize = parse_number<size_t>(ptr, end);
+            auto ysize = parse_number<size_t>(ptr, end);
+            auto zsize = parse_number<size_t>(ptr, end);
+            next_token(ptr, end);
+
+            dimensions = {{xsize, ysize, zsize}};
+            size = {{xpixsz, ypixsz, thickness}};
+        }
+
+        /**
+         * @brief Helper function to advance to the next non-whitespace character
+         * @param ptr Current position in the buffer, updated to the next non-whitespace character
+         * @param end End of the buffer
+         * @return Position of the next non-whitespace character or the end of the buffer
+         */
+        static const char* skip_whitespace(const char*& ptr, const char* end) {
+            while(ptr != end && std::isspace(static_cast<unsigned char>(*ptr))) {
+                ++ptr;
+            }
+            return ptr;
+        }
+
+        /**
+         * @brief Helper function to read the next whitespace-separated token from a buffer
+         * @param ptr Current position in the buffer, updated to the end of the token
+         * @param end End of the buffer
+         * @return Token read from the buffer
+         * @throws std::runtime_error If the buffer does not contain any more tokens
+         */
+        static std::string next_token(const char*& ptr, const char* end) {
+            auto begin = skip_whitespace(ptr, end);
+            if(begin == end) {
+                throw std::runtime_error("invalid data or unexpected end of file");
+            }
+            while(ptr != end && !std::isspace(static_cast<unsigned char>(*ptr))) {
+                ++ptr;
+            }
+            return std::string(begin, ptr);
+        }
+
+        /**
+         * @brief Helper function to parse the next number from a buffer without copying it
+         * @param ptr Current position in the buffer, updated to the end of the number
+         * @param end End of the buffer, which needs to be followed by whitespace or a null character
+         * @return Parsed number
+         * @throws std::runtime_error If the next token is not a number
+         */
+        template <typename N> static N parse_number(const char*& ptr, const char* end) {
+            if(skip_whitespace(ptr, end) == end) {
+                throw std::runtime_error("invalid data or unexpected end of file");
+            }
+            char* number_end = nullptr;
+            N value;
+            if(std::is_integral<N>::value) {
+                value = static_cast<N>(std::strtoull(ptr, &number_end, 10));
+            } else {
+                value = static_cast<N>(std::strtod(ptr, &number_end));
+            }
+            if(number_end == ptr || (number_end != end && !std::isspace(static_cast<unsigned char>(*number_end)))) {
+                throw std::runtime_error("invalid data");
+            }
+            ptr = number_end;
+            return value;
+        }
+
+        /**
+         * @brief Helper function to obtain the name of the binary cache file of an INIT file
+         * @param file_name File name of the INIT file
+         * @param content   Full content of the INIT file
+         * @param units     Units the field values are converted from
+         * @return File name of the binary cache file
+         */
+        std::string get_cache_file_name(const std::string& file_name, const std::string& content, const std::string& units) {
+            // Use FNV-1a to hash the file content together with the conversion of the values
+            std::uint64_t hash = 14695981039346656037ull;
+            auto add = [&hash](const std::string& data) {
+                for(auto ch : data) {
+                    hash = (hash ^ static_cast<unsigned char>(ch)) * 1099511628211ull;
+                }
+            };
+            add(content);
+            add(units + "/" + std::to_string(N_));
+
+            std::ostringstream cache_file_name;
+            cache_file_name << file_name << "." << std::hex << std::setw(16) << std::setfill('0') << hash << ".apf";
+            return cache_file_name.str();
+        }
+
+        /**
+         * @brief Helper function to store field data in a binary cache file
+         * @param field_data      Field data object to store
+         * @param cache_file_name File name of the binary cache file
+         *
+         * The cache file is written to a temporary file first and moved to its final name afterwards, such that concurrent
+         * processes never read a partially written cache file.
+         */
+        void write_cache_file(const FieldData<T>& field_data, const std::string& cache_file_name) {
+            auto temporary_file_name = cache_file_name + "." + std::to_string(::getpid()) + ".tmp";
+            {
+                std::ofstream file(temporary_file_name, std::ios::binary);
+                if(file) {
+                    cereal::PortableBinaryOutputArchive archive(file);
+                    archive(field_data);
+                }
+                if(!file) {
+                    LOG(DEBUG) << "Cannot write binary field cache " << cache_file_name;
+                    std::remove(temporary_file_name.c_str());
+                    return;
+                }
+            }
+            if(std::rename(temporary_file_name.c_str(), cache_file_name.c_str()) != 0) {
+                LOG(DEBUG) << "Cannot write binary field cache " << cache_file_name;
+                std::remove(temporary_file_name.c_str());
+                return;
+            }
+            LOG(INFO) << "Stored binary field cache " << cache_file_name;
         }
 
         size_t N_;
-        std::map<std::string, FieldData<T>> field_map_;
+        bool cache_init_files_;
     };
 
     /**
@@ -385,7 +1254,7 @@ namespace allpix {
                        const FileType& file_type,
                        const std::string& units = std::string()) {
             auto dimensions = field_data.getDimensions();
-            if(field_data.getData()->size() != N_ * dimensions[0] * dimensions[1] * dimensions[2]) {
+            if(field_data.getNumberOfElements() != N_ * dimensions[0] * dimensions[1] * dimensions[2]) {
                 throw std::runtime_error("invalid field dimensions");
             }
 
@@ -402,11 +1271,93 @@ namespace allpix {
                 }
                 write_apf_file(field_data, file_name);
                 break;
+            case FileType::MAPPED:
+                if(!units.empty()) {
+                    LOG(WARNING) << "Units will be ignored, mapped file content is written in internal units.";
+                }
+                write_mapped_file(field_data, file_name);
+                break;
             default:
                 throw std::runtime_error("unknown file format");
             }
         }
 
+        /**
+         * @brief Write a field to a memory-mappable file slice by slice, without holding the full field in memory
+         * @param header         Human readable description of the field
+         * @param dimensions     Number of bins of the field in x, y and z
+         * @param size           Physical extent of the field in x, y and z
+         * @param file_name      File name (as canonical path) of the output file to be created
+         * @param slice_function Function returning the values of the slice with the given x index, ordered as in the flat
+         *                       field array. The slices are requested in order of increasing index.
+         */
+        void writeMappedFile(const std::string& header,
+                             std::array<size_t, 3> dimensions,
+                             std::array<T, 3> size,
+                             const std::string& file_name,
+                             const std::function<std::vector<T>(size_t)>& slice_function) {
+            std::ofstream file(file_name, std::ios::binary);
+            write_mapped_header(file, header, dimensions, size);
+
+            auto slice_elements = N_ * dimensions[1] * dimensions[2];
+            for(size_t x = 0; x < dimensions[0]; ++x) {
+                auto slice = slice_function(x);
+                if(slice.size() != slice_elements) {
+                    throw std::runtime_error("invalid field dimensions");
+                }
+                file.write(reinterpret_cast<const char*>(slice.data()),
+                           static_cast<std::streamsize>(slice.size() * sizeof(T)));
+                if(file.fail()) {
+                    throw std::runtime_error("cannot write field data to file");
+                }
+            }
+        }
+
+        /**
+         * @brief Create a binary field file of the full size with the header of the field, to be filled with the field
+         * values afterwards
+         * @param field_data Field data object providing the header, dimensions and size, the field data itself is not used
+         * @param file_name  File name (as canonical path) of the output file to be created
+         * @param file_type  Type of file (file format) to be produced, either APF or MAPPED
+         * @return Offset of the field data from the beginning of the file
+         *
+         * The field values have to be stored as consecutive values of type T at the returned offset, in native byte order
+         * for MAPPED files and in little endian byte order for APF files.
+         */
+        std::uint64_t createFile(const FieldData<T>& field_data, const std::string& file_name, const FileType& file_type) {
+            auto dimensions = field_data.getDimensions();
+            auto elements = N_ * dimensions[0] * dimensions[1] * dimensions[2];
+
+            std::ofstream file(file_name, std::ios::binary);
+            if(file_type == FileType::MAPPED) {
+                write_mapped_header(file, field_data.getHeader(), dimensions, field_data.getSize());
+            } else if(file_type == FileType::APF) {
+                // Same layout as the serialization of the field data with cereal, up to the values of the field
+                cereal::PortableBinaryOutputArchive archive(file);
+                archive(static_cast<std::uint32_t>(APF_MIME_TYPE_VERSION));
+                archive(field_data.getHeader());
+                archive(dimensions);
+                archive(field_data.getSize());
+                // Identifier of the first shared pointer in the archive followed by the size of the vector
+                archive(static_cast<std::uint32_t>(cereal::detail::msb_32bit | 1));
+                archive(cereal::make_size_tag(static_cast<cereal::size_type>(elements)));
+            } else {
+                throw std::runtime_error("unknown file format");
+            }
+            file.flush();
+            auto data_offset = static_cast<std::uint64_t>(file.tellp());
+            if(file.fail()) {
+                throw std::runtime_error("cannot write field header to file");
+            }
+            file.close();
+
+            // Extend the file to its full size, the field values are initialized to zero
+            if(::truncate(file_name.c_str(), static_cast<off_t>(data_offset + elements * sizeof(T))) != 0) {
+                throw std::runtime_error("cannot resize file");
+            }
+            return data_offset;
+        }
+
     private:
         /**
          * @brief Function to serialize FieldData into an APF file, using the cereal library. This does not convert any
@@ -423,6 +1374,55 @@ namespace allpix {
             archive(field_data);
         }
 
+        /**
+         * @brief Function to write FieldData into a file which can be memory-mapped when reading. This does not convert any
+         * units, all values are stored in framework-internal base units.
+         * @param field_data Field data object to store
+         * @param file_name  File name (as canonical path) of the output file to be created
+         */
+        void write_mapped_file(const FieldData<T>& field_data, const std::string& file_name) {
+            std::ofstream file(file_name, std::ios::binary);
+            write_mapped_header(file, field_data.getHeader(), field_data.getDimensions(), field_data.getSize());
+            file.write(reinterpret_cast<const char*>(field_data.getView().get()),
+                       static_cast<std::streamsize>(field_data.getNumberOfElements() * sizeof(T)));
+
+            if(file.fail()) {
+                throw std::runtime_error("cannot write field data to file");
+            }
+        }
+
+        /**
+         * @brief Function to write the header of a memory-mappable file, including the padding up to the field data
+         * @param file        Output file stream to write to
+         * @param description Human readable description of the field
+         * @param dimensions  Number of bins of the field in x, y and z
+         * @param size        Physical extent of the field in x, y and z
+         */
+        void write_mapped_header(std::ofstream& file,
+                                 const std::string& description,
+                                 std::array<size_t, 3> dimensions,
+                                 std::array<T, 3> size) {
+            MappedFieldHeader header{};
+            std::memcpy(header.magic, mapped_field_magic, sizeof(header.magic));
+            header.byte_order = mapped_field_byte_order;
+            header.version = MAPPED_FIELD_FORMAT_VERSION;
+            header.quantity = N_;
+            for(size_t i = 0; i < 3; ++i) {
+                header.dimensions[i] = dimensions[i];
+                header.size[i] = static_cast<double>(size[i]);
+            }
+            header.header_length = description.size();
+            // Align the start of the field data
+            auto data_offset = sizeof(header) + description.size();
+            header.data_offset =
+                (data_offset + mapped_field_alignment - 1) / mapped_field_alignment * mapped_field_alignment;
+
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(description.data(), static_cast<std::streamsize>(description.size()));
+            std::vector<char> padding(header.data_offset - data_offset, '\0');
+            file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        }
+
         /**
          * @brief Function to write FieldData objects out to INIT-formatted ASCII files. Values are converted from the
          * framework-internal base units in which the data is stored in FieldData into the units provided by the units
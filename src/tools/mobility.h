@@ -0,0 +1,286 @@
+/**
+ * @file
+ * @brief Charge carrier mobility models and their tabulation over the electric field
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_MOBILITY_H
+#define ALLPIX_MOBILITY_H
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/config/Configuration.hpp"
+#include "core/config/exceptions.h"
+#include "core/utils/unit.h"
+#include "objects/SensorCharge.hpp"
+#include "tools/fast_math.h"
+
+namespace allpix {
+
+    /**
+     * @brief Model of the charge carrier mobility in silicon as function of the electric field magnitude
+     */
+    class MobilityModel {
+    public:
+        /**
+         * @brief Virtual destructor
+         */
+        virtual ~MobilityModel() = default;
+
+        /**
+         * @brief Mobility of a charge carrier type
+         * @param type Type of the charge carrier
+         * @param efield_mag Magnitude of the electric field
+         * @return Mobility of the charge carrier
+         */
+        virtual double operator()(CarrierType type, double efield_mag) const = 0;
+
+        /**
+         * @brief Evaluate the field dependence with the fast approximations of the elementary functions
+         * @param fast_math True to use the approximations in \ref fast_math, with a relative error below 1e-8
+         */
+        void setFastMath(bool fast_math) { fast_math_ = fast_math; }
+
+    protected:
+        bool fast_math_{};
+    };
+
+    /**
+     * @brief Mobility saturating at high fields with a constant low-field mobility, as used by the Jacoboni and Canali
+     * parameterizations
+     *
+     * The mobility is calculated as \f$\mu(E) = \mu_0 / (1 + (E / E_c)^\beta)^{1 / \beta}\f$ with the low-field mobility
+     * \f$\mu_0 = v_m / E_c\f$, defined separately for electrons and holes.
+     */
+    class SaturatedMobility : public MobilityModel {
+    public:
+        double operator()(CarrierType type, double efield_mag) const override {
+            if(type == CarrierType::ELECTRON) {
+                return saturate(electron_Vm_, electron_Ec_, electron_Beta_, efield_mag);
+            }
+            return saturate(hole_Vm_, hole_Ec_, hole_Beta_, efield_mag);
+        }
+
+    protected:
+        /**
+         * @brief Saturated mobility for the given parameters
+         * @param vm Saturation velocity
+         * @param ec Critical field
+         * @param beta Exponent of the saturation
+         * @param efield_mag Magnitude of the electric field
+         * @return Mobility of the charge carrier
+         */
+        double saturate(double vm, double ec, double beta, double efield_mag) const {
+            // The approximation of the power is only defined for positive bases
+            if(fast_math_ && efield_mag > 0) {
+                return vm / ec / fast_math::pow(1. + fast_math::pow(efield_mag / ec, beta), 1.0 / beta);
+            }
+            return vm / ec / std::pow(1. + std::pow(efield_mag / ec, beta), 1.0 / beta);
+        }
+
+        double electron_Vm_{}, electron_Ec_{}, electron_Beta_{};
+        double hole_Vm_{}, hole_Ec_{}, hole_Beta_{};
+    };
+
+    /**
+     * @brief Mobility parameterization by C. Jacoboni et al., https://doi.org/10.1016/0038-1101(77)90054-5 (section 5.2)
+     */
+    class JacoboniMobility : public SaturatedMobility {
+    public:
+        /**
+         * @brief Construct the parameterization at the given temperature
+         * @param temperature Temperature of the sensor
+         */
+        explicit JacoboniMobility(double temperature) {
+            electron_Vm_ = Units::get(1.53e9 * std::pow(temperature, -0.87), "cm/s");
+            electron_Ec_ = Units::get(1.01 * std::pow(temperature, 1.55), "V/cm");
+            electron_Beta_ = 2.57e-2 * std::pow(temperature, 0.66);
+
+            hole_Vm_ = Units::get(1.62e8 * std::pow(temperature, -0.52), "cm/s");
+            hole_Ec_ = Units::get(1.24 * std::pow(temperature, 1.68), "V/cm");
+            hole_Beta_ = 0.46 * std::pow(temperature, 0.17);
+        }
+    };
+
+    /**
+     * @brief Mobility parameterization by C. Canali et al., https://doi.org/10.1109/T-ED.1975.18267, with the saturation
+     * velocities and exponents scaled relative to 300K and a lattice mobility limited by phonon scattering
+     */
+    class CanaliMobility : public SaturatedMobility {
+    public:
+        /**
+         * @brief Construct the parameterization at the given temperature
+         * @param temperature Temperature of the sensor
+         */
+        explicit CanaliMobility(double temperature)
+            : CanaliMobility(temperature,
+                             Units::get(1417 * std::pow(temperature / 300, -2.5), "cm*cm/V/s"),
+                             Units::get(470.5 * std::pow(temperature / 300, -2.2), "cm*cm/V/s")) {}
+
+    protected:
+        /**
+         * @brief Construct the parameterization with the given low-field mobilities
+         * @param temperature Temperature of the sensor
+         * @param electron_mobility Low-field mobility of electrons
+         * @param hole_mobility Low-field mobility of holes
+         */
+        CanaliMobility(double temperature, double electron_mobility, double hole_mobility) {
+            electron_Vm_ = Units::get(1.07e7 * std::pow(temperature / 300, -0.87), "cm/s");
+            electron_Ec_ = electron_Vm_ / electron_mobility;
+            electron_Beta_ = 1.109 * std::pow(temperature / 300, 0.66);
+
+            hole_Vm_ = Units::get(8.37e6 * std::pow(temperature / 300, -0.52), "cm/s");
+            hole_Ec_ = hole_Vm_ / hole_mobility;
+            hole_Beta_ = 1.213 * std::pow(temperature / 300, 0.17);
+        }
+    };
+
+    /**
+     * @brief Doping dependent low-field mobility by G. Masetti et al., https://doi.org/10.1109/T-ED.1983.21207, saturating
+     * at high fields as in the Canali parameterization
+     *
+     * The parameters for phosphorus-doped silicon are used for electrons and the ones for boron-doped silicon for holes.
+     */
+    class MasettiMobility : public CanaliMobility {
+    public:
+        /**
+         * @brief Construct the parameterization at the given temperature and doping concentration
+         * @param temperature Temperature of the sensor
+         * @param doping Magnitude of the doping concentration
+         */
+        MasettiMobility(double temperature, double doping)
+            : CanaliMobility(temperature,
+                             masetti(1417 * std::pow(temperature / 300, -2.5),
+                                     doping,
+                                     {52.2, 52.2, 43.4, 0, 9.68e16, 3.43e20, 0.68, 2.0}),
+                             masetti(470.5 * std::pow(temperature / 300, -2.2),
+                                     doping,
+                                     {44.9, 0, 29.0, 9.23e16, 2.23e17, 6.1e20, 0.719, 2.0})) {}
+
+    private:
+        /**
+         * @brief Low-field mobility reduced by the scattering on ionized impurities
+         * @param lattice_mobility Lattice mobility without doping in cm^2/Vs
+         * @param doping Doping concentration in internal units
+         * @param p Parameters mu_min1, mu_min2, mu_1 in cm^2/Vs, P_c, C_r and C_s in cm^-3 and the exponents alpha and beta
+         * @return Low-field mobility in internal units
+         */
+        static double masetti(double lattice_mobility, double doping, const std::array<double, 8>& p) {
+            auto concentration = std::fabs(doping) / Units::get(1.0, "/cm/cm/cm");
+            auto mobility = lattice_mobility;
+            if(concentration > 0) {
+                mobility = p[0] * std::exp(-p[3] / concentration) +
+                           (lattice_mobility - p[1]) / (1 + std::pow(concentration / p[4], p[6])) -
+                           p[2] / (1 + std::pow(p[5] / concentration, p[7]));
+            }
+            return Units::get(mobility, "cm*cm/V/s");
+        }
+    };
+
+    /**
+     * @brief Mobility of a single charge carrier type, interpolated in a table over the electric field magnitude
+     *
+     * The mobility is tabulated in bins of equal width up to a maximum field. Fields beyond the table and tables without
+     * bins evaluate the mobility model directly.
+     */
+    class MobilityTable {
+    public:
+        /**
+         * @brief Construct a table without bins
+         */
+        MobilityTable() = default;
+
+        /**
+         * @brief Tabulate the mobility of a carrier type
+         * @param model Mobility model, should outlive the table
+         * @param type Type of the charge carrier
+         * @param max_field Electric field magnitude up to which the mobility is tabulated
+         * @param bins Number of bins of the table, the model is evaluated directly if zero
+         */
+        MobilityTable(const MobilityModel* model, CarrierType type, double max_field, size_t bins)
+            : model_(model), type_(type), bins_(static_cast<double>(bins)) {
+            if(bins == 0) {
+                return;
+            }
+            inverse_bin_width_ = bins_ / max_field;
+            values_.reserve(bins + 1);
+            for(size_t bin = 0; bin <= bins; ++bin) {
+                values_.push_back((*model_)(type_, static_cast<double>(bin) / inverse_bin_width_));
+            }
+        }
+
+        /**
+         * @brief Mobility at the given electric field magnitude
+         * @param efield_mag Magnitude of the electric field
+         * @return Mobility of the charge carrier
+         */
+        double operator()(double efield_mag) const {
+            auto position = efield_mag * inverse_bin_width_;
+            if(!(position < bins_)) {
+                return (*model_)(type_, efield_mag);
+            }
+            auto bin = static_cast<size_t>(position);
+            auto fraction = position - static_cast<double>(bin);
+            return values_[bin] + fraction * (values_[bin + 1] - values_[bin]);
+        }
+
+    private:
+        const MobilityModel* model_{};
+        CarrierType type_{CarrierType::ELECTRON};
+        double bins_{};
+        double inverse_bin_width_{};
+        std::vector<double> values_;
+    };
+
+    /**
+     * @brief Create the mobility model selected in the configuration
+     * @param config Configuration with the name of the model in the key "mobility_model", the doping concentration in
+     * the key "doping_concentration" and the switch for the fast approximations in the key "fast_math"
+     * @param temperature Temperature of the sensor
+     * @return Mobility model
+     */
+    inline std::unique_ptr<MobilityModel> create_mobility_model(const Configuration& config, double temperature) {
+        auto name = config.get<std::string>("mobility_model");
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        std::unique_ptr<MobilityModel> model;
+        if(name == "jacoboni") {
+            model = std::make_unique<JacoboniMobility>(temperature);
+        } else if(name == "canali") {
+            model = std::make_unique<CanaliMobility>(temperature);
+        } else if(name == "masetti") {
+            model = std::make_unique<MasettiMobility>(temperature, config.get<double>("doping_concentration"));
+        } else {
+            throw InvalidValueError(config, "mobility_model", "model should be 'jacoboni', 'canali' or 'masetti'");
+        }
+        model->setFastMath(config.get<bool>("fast_math", false));
+        return model;
+    }
+
+    /**
+     * @brief Tabulate the mobility model for electrons and holes as selected in the configuration
+     * @param config Configuration with the number of bins in the key "mobility_table_bins" and the maximum field in the key
+     * "mobility_table_max_field"
+     * @param model Mobility model to tabulate, should outlive the tables
+     * @return Tables for electrons and holes, in this order
+     */
+    inline std::array<MobilityTable, 2> create_mobility_tables(const Configuration& config, const MobilityModel* model) {
+        auto bins = config.get<size_t>("mobility_table_bins");
+        auto max_field = config.get<double>("mobility_table_max_field");
+        if(bins > 0 && max_field <= 0) {
+            throw InvalidValueError(config, "mobility_table_max_field", "maximum field of the table should be positive");
+        }
+        return {{MobilityTable(model, CarrierType::ELECTRON, max_field, bins),
+                 MobilityTable(model, CarrierType::HOLE, max_field, bins)}};
+    }
+} // namespace allpix
+
+#endif /* ALLPIX_MOBILITY_H */
@@ -0,0 +1,495 @@
+/**
+ * @file
+ * @brief Streams of binary records between processes, through a shared memory ring buffer or a network socket
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_RECORD_STREAM_H
+#define ALLPIX_RECORD_STREAM_H
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "core/config/Configuration.hpp"
+#include "core/config/exceptions.h"
+#include "core/utils/unit.h"
+
+namespace allpix {
+
+    /**
+     * @brief Ordered stream of binary records, written by a single process and read by a single other process
+     *
+     * All methods throw a std::runtime_error if the stream fails or the other process does not respond in time.
+     */
+    class RecordStream {
+    public:
+        /**
+         * @brief Virtual destructor
+         */
+        virtual ~RecordStream() = default;
+
+        /**
+         * @brief Append a record to the stream, waiting until the reader made enough space if needed
+         * @param data Pointer to the data of the record
+         * @param size Size of the record in bytes
+         */
+        virtual void write(const char* data, size_t size) = 0;
+
+        /**
+         * @brief Get the next record of the stream, waiting until it is written if needed
+         * @return Pointer to the data of the record and its size, null pointer if the writer has closed the stream
+         *
+         * The record is valid until \ref release is called, which should be done before reading the next record.
+         */
+        virtual std::pair<const char*, size_t> read() = 0;
+
+        /**
+         * @brief Release the last record obtained by \ref read
+         */
+        virtual void release() = 0;
+
+        /**
+         * @brief Signal the reader that no further records will be written
+         */
+        virtual void close() = 0;
+
+    protected:
+        using clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Wait until a condition is fulfilled, yielding first and sleeping for longer waits
+         * @param condition Function returning true when the wait is over
+         * @param timeout Maximum time to wait
+         * @param what Description of what is waited for, used in the error message
+         */
+        template <typename F> static void wait_for(F condition, std::chrono::nanoseconds timeout, const char* what) {
+            auto deadline = clock::now() + timeout;
+            for(unsigned int attempt = 0; !condition(); ++attempt) {
+                if(clock::now() > deadline) {
+                    throw std::runtime_error(std::string("timed out waiting for ") + what);
+                }
+                if(attempt < 1024) {
+                    std::this_thread::yield();
+                } else {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+            }
+        }
+
+        /**
+         * @brief Round a size up to the alignment of the records
+         * @param size Size in bytes
+         * @return Aligned size in bytes
+         */
+        static size_t align(size_t size) { return (size + 7) / 8 * 8; }
+    };
+
+    /**
+     * @brief Record stream through a ring buffer in a named POSIX shared memory segment on the local machine
+     *
+     * The writer creates the segment, replacing any leftover segment of the same name, while the reader opens it, waiting
+     * until it has been created. The name of the segment is removed as soon as the reader has opened it, the memory is
+     * released when both processes have finished. Records are read in place without copying them out of the ring buffer.
+     * Every record is preceded by its size and never wraps around the end of the buffer.
+     */
+    class SharedMemoryStream : public RecordStream {
+    public:
+        /**
+         * @brief Create or open the shared memory segment
+         * @param name Name of the segment, without the leading slash
+         * @param writer True to create the segment as writer, false to open it as reader
+         * @param capacity Size of the ring buffer in bytes, only used by the writer
+         * @param timeout Maximum time to wait for the other process
+         */
+        SharedMemoryStream(const std::string& name, bool writer, size_t capacity, std::chrono::nanoseconds timeout)
+            : name_("/" + name), timeout_(timeout) {
+            static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "lock-free atomics are required to share them between processes");
+
+            int fd = -1;
+            if(writer) {
+                capacity = align(capacity);
+                if(capacity < header_size) {
+                    throw std::runtime_error("buffer size too small");
+                }
+                ::shm_unlink(name_.c_str());
+                fd = ::shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+                if(fd < 0 || ::ftruncate(fd, static_cast<off_t>(header_size + capacity)) != 0) {
+                    auto error = std::string(std::strerror(errno));
+                    if(fd >= 0) {
+                        ::close(fd);
+                    }
+                    throw std::runtime_error("cannot create shared memory segment " + name_ + ": " + error);
+                }
+                size_ = header_size + capacity;
+            } else {
+                wait_for([&]() { return (fd = ::shm_open(name_.c_str(), O_RDWR, 0)) >= 0; }, timeout_, "shared memory");
+                // The writer might not have set the size of the segment yet
+                struct stat status {};
+                wait_for([&]() { return ::fstat(fd, &status) == 0 && status.st_size > static_cast<off_t>(header_size); },
+                         timeout_,
+                         "shared memory");
+                size_ = static_cast<size_t>(status.st_size);
+            }
+
+            auto* address = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if(address == MAP_FAILED) { // NOLINT
+                throw std::runtime_error("cannot map shared memory segment " + name_ + ": " + std::strerror(errno));
+            }
+            address_ = static_cast<char*>(address);
+
+            if(writer) {
+                header_ = new(address_) Header();
+                header_->capacity = size_ - header_size;
+                header_->magic.store(magic, std::memory_order_release);
+            } else {
+                header_ = reinterpret_cast<Header*>(address_); // NOLINT
+                wait_for([&]() { return header_->magic.load(std::memory_order_acquire) == magic; },
+                         timeout_,
+                         "shared memory");
+                ::shm_unlink(name_.c_str());
+            }
+            capacity_ = header_->capacity;
+            data_ = address_ + header_size;
+        }
+
+        /// @{
+        /**
+         * @brief Copying or moving the stream is not allowed
+         */
+        SharedMemoryStream(const SharedMemoryStream&) = delete;
+        SharedMemoryStream& operator=(const SharedMemoryStream&) = delete;
+        SharedMemoryStream(SharedMemoryStream&&) = delete;
+        SharedMemoryStream& operator=(SharedMemoryStream&&) = delete;
+        /// @}
+
+        /**
+         * @brief Unmap the shared memory segment
+         */
+        ~SharedMemoryStream() override { ::munmap(address_, size_); }
+
+        void write(const char* data, size_t size) override {
+            auto needed = sizeof(uint64_t) + align(size);
+            if(needed > capacity_) {
+                throw std::runtime_error("record of " + std::to_string(size) + " bytes larger than the buffer");
+            }
+
+            // Skip the end of the buffer if the record does not fit before it
+            auto head = header_->head.load(std::memory_order_relaxed);
+            auto contiguous = capacity_ - head % capacity_;
+            auto skip = (contiguous < needed ? contiguous : 0);
+            wait_for([&]() { return head + skip + needed - header_->tail.load(std::memory_order_acquire) <= capacity_; },
+                     timeout_,
+                     "space in the shared memory buffer");
+            if(skip > 0) {
+                store_size(head, wrap_marker);
+                head += skip;
+            }
+
+            store_size(head, size);
+            std::memcpy(data_ + head % capacity_ + sizeof(uint64_t), data, size);
+            header_->head.store(head + needed, std::memory_order_release);
+        }
+
+        std::pair<const char*, size_t> read() override {
+            auto tail = header_->tail.load(std::memory_order_relaxed);
+            while(true) {
+                // Check for the end of the stream before the last records, such that these are never missed
+                wait_for(
+                    [&]() {
+                        return header_->closed.load(std::memory_order_acquire) != 0 ||
+                               header_->head.load(std::memory_order_acquire) != tail;
+                    },
+                    timeout_,
+                    "data in the shared memory buffer");
+                if(header_->head.load(std::memory_order_acquire) == tail) {
+                    return {nullptr, 0};
+                }
+
+                uint64_t size = 0;
+                std::memcpy(&size, data_ + tail % capacity_, sizeof(size));
+                if(size == wrap_marker) {
+                    tail += capacity_ - tail % capacity_;
+                    header_->tail.store(tail, std::memory_order_release);
+                    continue;
+                }
+                pending_ = sizeof(uint64_t) + align(size);
+                return {data_ + tail % capacity_ + sizeof(uint64_t), size};
+            }
+        }
+
+        void release() override {
+            header_->tail.fetch_add(pending_, std::memory_order_release);
+            pending_ = 0;
+        }
+
+        void close() override { header_->closed.store(1, std::memory_order_release); }
+
+    private:
+        /**
+         * @brief Header at the beginning of the segment, with the positions of reader and writer on separate cache lines
+         *
+         * The positions count all bytes ever written and read, the position in the buffer is their remainder with the
+         * capacity.
+         */
+        struct Header {
+            std::atomic<uint64_t> magic{};
+            uint64_t capacity{};
+            std::atomic<uint64_t> closed{};
+            alignas(64) std::atomic<uint64_t> head{};
+            alignas(64) std::atomic<uint64_t> tail{};
+        };
+        static constexpr size_t header_size = 256;
+        static constexpr uint64_t magic = 0x4150585245434f52; // "APXRECOR"
+        static constexpr uint64_t wrap_marker = UINT64_MAX;
+
+        void store_size(uint64_t position, uint64_t size) {
+            std::memcpy(data_ + position % capacity_, &size, sizeof(size));
+        }
+
+        std::string name_;
+        std::chrono::nanoseconds timeout_;
+        char* address_{};
+        size_t size_{};
+        Header* header_{};
+        char* data_{};
+        uint64_t capacity_{};
+        uint64_t pending_{};
+    };
+
+    /**
+     * @brief Record stream through a TCP connection, to stream records between machines
+     *
+     * The reader listens on a port and accepts a single connection, which is opened by the writer. Every record is
+     * preceded by its size in network byte order. Records are received into a buffer owned by the stream.
+     */
+    class SocketStream : public RecordStream {
+    public:
+        /**
+         * @brief Connect to the reader or accept the connection of the writer
+         * @param host Host name or address of the reader, only used by the writer
+         * @param port Port the reader listens on
+         * @param writer True to connect as writer, false to listen as reader
+         * @param timeout Maximum time to wait for the other process
+         */
+        SocketStream(const std::string& host, unsigned int port, bool writer, std::chrono::nanoseconds timeout)
+            : timeout_(timeout) {
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            if(!writer) {
+                hints.ai_flags = AI_PASSIVE;
+            }
+            addrinfo* addresses = nullptr;
+            auto port_str = std::to_string(port);
+            auto status = ::getaddrinfo(writer ? host.c_str() : nullptr, port_str.c_str(), &hints, &addresses);
+            if(status != 0) {
+                throw std::runtime_error("cannot resolve address " + host + ": " + ::gai_strerror(status));
+            }
+
+            if(writer) {
+                // Retry until the reader listens
+                wait_for(
+                    [&]() {
+                        for(auto* address = addresses; address != nullptr; address = address->ai_next) {
+                            socket_ = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+                            if(socket_ >= 0 && ::connect(socket_, address->ai_addr, address->ai_addrlen) == 0) {
+                                return true;
+                            }
+                            ::close(socket_);
+                            socket_ = -1;
+                        }
+                        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                        return false;
+                    },
+                    timeout_,
+                    "connection to " + host + ":" + port_str);
+                ::freeaddrinfo(addresses);
+                int flag = 1;
+                ::setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+            } else {
+                int listener = ::socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol);
+                int flag = 1;
+                ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+                if(listener < 0 || ::bind(listener, addresses->ai_addr, addresses->ai_addrlen) != 0 ||
+                   ::listen(listener, 1) != 0) {
+                    auto error = std::string(std::strerror(errno));
+                    ::freeaddrinfo(addresses);
+                    ::close(listener);
+                    throw std::runtime_error("cannot listen on port " + port_str + ": " + error);
+                }
+                ::freeaddrinfo(addresses);
+                pollfd request{listener, POLLIN, 0};
+                auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(timeout_).count();
+                if(::poll(&request, 1, static_cast<int>(milliseconds)) <= 0 ||
+                   (socket_ = ::accept(listener, nullptr, nullptr)) < 0) {
+                    ::close(listener);
+                    throw std::runtime_error("timed out waiting for connection on port " + port_str);
+                }
+                ::close(listener);
+            }
+        }
+
+        /// @{
+        /**
+         * @brief Copying or moving the stream is not allowed
+         */
+        SocketStream(const SocketStream&) = delete;
+        SocketStream& operator=(const SocketStream&) = delete;
+        SocketStream(SocketStream&&) = delete;
+        SocketStream& operator=(SocketStream&&) = delete;
+        /// @}
+
+        /**
+         * @brief Close the connection
+         */
+        ~SocketStream() override {
+            if(socket_ >= 0) {
+                ::close(socket_);
+            }
+        }
+
+        void write(const char* data, size_t size) override {
+            char prefix[sizeof(uint64_t)];
+            for(size_t i = 0; i < sizeof(prefix); ++i) {
+                prefix[i] = static_cast<char>((static_cast<uint64_t>(size) >> (8 * (sizeof(prefix) - 1 - i))) & 0xff);
+            }
+            send_all(prefix, sizeof(prefix));
+            send_all(data, size);
+        }
+
+        std::pair<const char*, size_t> read() override {
+            unsigned char prefix[sizeof(uint64_t)];
+            if(!receive_all(reinterpret_cast<char*>(prefix), sizeof(prefix), true)) { // NOLINT
+                return {nullptr, 0};
+            }
+            uint64_t size = 0;
+            for(auto byte : prefix) {
+                size = (size << 8) | byte;
+            }
+            buffer_.resize(size);
+            receive_all(buffer_.data(), size, false);
+            return {buffer_.data(), size};
+        }
+
+        void release() override {}
+
+        void close() override {
+            if(socket_ >= 0) {
+                ::shutdown(socket_, SHUT_WR);
+            }
+        }
+
+    private:
+        /**
+         * @brief Wait for a condition, with a description composed at runtime
+         */
+        template <typename F> void wait_for(F condition, std::chrono::nanoseconds timeout, const std::string& what) {
+            RecordStream::wait_for(condition, timeout, what.c_str());
+        }
+
+        void send_all(const char* data, size_t size) {
+            while(size > 0) {
+#ifdef MSG_NOSIGNAL
+                auto sent = ::send(socket_, data, size, MSG_NOSIGNAL);
+#else
+                auto sent = ::send(socket_, data, size, 0);
+#endif
+                if(sent < 0 && errno == EINTR) {
+                    continue;
+                }
+                if(sent <= 0) {
+                    throw std::runtime_error(std::string("connection lost: ") + std::strerror(errno));
+                }
+                data += sent;
+                size -= static_cast<size_t>(sent);
+            }
+        }
+
+        bool receive_all(char* data, size_t size, bool allow_end) {
+            auto deadline = clock::now() + timeout_;
+            bool first = true;
+            while(size > 0) {
+                pollfd request{socket_, POLLIN, 0};
+                auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now()).count();
+                auto ready = (milliseconds > 0 ? ::poll(&request, 1, static_cast<int>(milliseconds)) : 0);
+                if(ready < 0 && errno == EINTR) {
+                    continue;
+                }
+                if(ready <= 0) {
+                    throw std::runtime_error("timed out waiting for data on the connection");
+                }
+                auto received = ::recv(socket_, data, size, 0);
+                if(received < 0 && errno == EINTR) {
+                    continue;
+                }
+                if(received == 0 && first && allow_end) {
+                    return false;
+                }
+                if(received <= 0) {
+                    throw std::runtime_error("connection lost");
+                }
+                first = false;
+                data += received;
+                size -= static_cast<size_t>(received);
+            }
+            return true;
+        }
+
+        std::chrono::nanoseconds timeout_;
+        int socket_{-1};
+        std::vector<char> buffer_;
+    };
+
+    /**
+     * @brief Create the record stream selected in the configuration
+     * @param config Configuration with the transport in the key "transport", either "shared_memory" with the keys
+     * "segment_name" and "buffer_size" or "socket" with the keys "host" and "port", and the key "timeout"
+     * @param writer True to create the writing end of the stream, false for the reading end
+     * @return Record stream
+     * @throws std::runtime_error If the stream cannot be opened
+     */
+    inline std::unique_ptr<RecordStream> create_record_stream(const Configuration& config, bool writer) {
+        auto timeout = std::chrono::nanoseconds(config.get<unsigned long>("timeout", Units::get(60ul, "s")));
+        auto transport = config.get<std::string>("transport", "shared_memory");
+        std::transform(transport.begin(), transport.end(), transport.begin(), ::tolower);
+        if(transport == "shared_memory") {
+            return std::make_unique<SharedMemoryStream>(config.get<std::string>("segment_name", "allpix"),
+                                                        writer,
+                                                        config.get<size_t>("buffer_size", 64 * 1024 * 1024),
+                                                        timeout);
+        }
+        if(transport == "socket") {
+            return std::make_unique<SocketStream>(
+                config.get<std::string>("host", "localhost"), config.get<unsigned int>("port"), writer, timeout);
+        }
+        throw InvalidValueError(config, "transport", "transport should be 'shared_memory' or 'socket'");
+    }
+} // namespace allpix
+
+#endif /* ALLPIX_RECORD_STREAM_H */
@@ -0,0 +1,140 @@
+/**
+ * @file
+ * @brief Region of interest of a detector, to skip deposited charges which cannot reach the read out pixels
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_REGION_OF_INTEREST_H
+#define ALLPIX_REGION_OF_INTEREST_H
+
+#include <cmath>
+#include <sstream>
+#include <string>
+
+#include <Math/Point3D.h>
+
+#include "core/config/Configuration.hpp"
+#include "core/config/exceptions.h"
+#include "core/geometry/Detector.hpp"
+#include "core/utils/unit.h"
+#include "objects/Pixel.hpp"
+#include "tools/ROOT.h"
+
+namespace allpix {
+
+    /**
+     * @brief Lateral region of a detector whose deposited charges are propagated
+     *
+     * The region is given by an inclusive window of pixel indices, optionally restricted to the implants of the pixels, and
+     * extended laterally by a margin accounting for the distance the charge carriers can move by diffusion and by a
+     * lateral drift. Deposited charges outside of the region are not propagated, which saves the integration of their
+     * paths if large parts of the sensor are not read out, for example guard rings or the area outside the pixel matrix.
+     * The region is defined by the following parameters of the configuration:
+     * - `roi_pixel_min` and `roi_pixel_max`: first and last pixel index of the window in x and y, defaulting to the full
+     *   pixel matrix if only one of them is given
+     * - `roi_implants_only`: only keep charges above or below the implants of the pixels, defaults to false
+     * - `roi_margin`: lateral distance around the window and the implants within which charges are kept, defaults to zero
+     *
+     * Without any of these parameters, the region covers the full detector and all charges are kept.
+     */
+    class RegionOfInterest {
+    public:
+        /**
+         * @brief Region covering the full detector
+         */
+        RegionOfInterest() = default;
+
+        /**
+         * @brief Construct the region of a detector from the configuration of a module
+         * @param config Configuration of the module
+         * @param detector Detector of the module instantiation
+         */
+        RegionOfInterest(const Configuration& config, const Detector& detector) {
+            window_ = (config.has("roi_pixel_min") || config.has("roi_pixel_max"));
+            implants_only_ = config.get<bool>("roi_implants_only", false);
+            margin_ = config.get<double>("roi_margin", 0.);
+            if(margin_ < 0) {
+                throw InvalidValueError(config, "roi_margin", "margin cannot be negative");
+            }
+
+            auto model = detector.getModel();
+            pixel_size_ = model->getPixelSize();
+            implant_size_ = model->getImplantSize();
+
+            if(window_) {
+                auto npixels = model->getNPixels();
+                pixel_min_ = config.get<Pixel::Index>("roi_pixel_min", Pixel::Index(0, 0));
+                pixel_max_ = config.get<Pixel::Index>("roi_pixel_max", Pixel::Index(npixels.x() - 1, npixels.y() - 1));
+                if(pixel_min_.x() > pixel_max_.x() || pixel_min_.y() > pixel_max_.y()) {
+                    throw InvalidValueError(config, "roi_pixel_max", "last pixel of the region is before the first pixel");
+                }
+
+                // Pixels are centered at the multiples of the pitch in the local frame
+                x_min_ = (pixel_min_.x() - 0.5) * pixel_size_.x() - margin_;
+                x_max_ = (pixel_max_.x() + 0.5) * pixel_size_.x() + margin_;
+                y_min_ = (pixel_min_.y() - 0.5) * pixel_size_.y() - margin_;
+                y_max_ = (pixel_max_.y() + 0.5) * pixel_size_.y() + margin_;
+            }
+        }
+
+        /**
+         * @brief Check if the region is restricted, such that charges can be skipped
+         * @return True if the region does not cover the full detector
+         */
+        bool isRestricted() const { return window_ || implants_only_; }
+
+        /**
+         * @brief Check if a charge deposited at a position should be propagated
+         * @param local_pos Position in the local frame of the detector
+         * @return True if the position is within the region including its margin
+         */
+        bool contains(const ROOT::Math::XYZPoint& local_pos) const {
+            if(window_ && (local_pos.x() < x_min_ || local_pos.x() > x_max_ || local_pos.y() < y_min_ ||
+                           local_pos.y() > y_max_)) {
+                return false;
+            }
+            if(implants_only_) {
+                // Distance to the center of the closest pixel
+                auto x_offset = local_pos.x() - pixel_size_.x() * std::round(local_pos.x() / pixel_size_.x());
+                auto y_offset = local_pos.y() - pixel_size_.y() * std::round(local_pos.y() / pixel_size_.y());
+                return std::fabs(x_offset) <= std::fabs(implant_size_.x()) / 2 + margin_ &&
+                       std::fabs(y_offset) <= std::fabs(implant_size_.y()) / 2 + margin_;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Describe the region for the log
+         * @return Human-readable description of the region
+         */
+        std::string describe() const {
+            std::stringstream description;
+            if(window_) {
+                description << "pixels " << pixel_min_ << " to " << pixel_max_;
+            } else {
+                description << "all pixels";
+            }
+            if(implants_only_) {
+                description << ", only at the implants";
+            }
+            description << " with a margin of " << Units::display(margin_, {"um", "mm"});
+            return description.str();
+        }
+
+    private:
+        bool window_{};
+        bool implants_only_{};
+        double margin_{};
+
+        Pixel::Index pixel_min_, pixel_max_;
+        double x_min_{}, x_max_{}, y_min_{}, y_max_{};
+
+        ROOT::Math::XYVector pixel_size_;
+        ROOT::Math::XYVector implant_size_;
+    };
+} // namespace allpix
+
+#endif /* ALLPIX_REGION_OF_INTEREST_H */
@@ -10,21 +10,59 @@
 #ifndef ALLPIX_RUNGE_KUTTA_H
 #define ALLPIX_RUNGE_KUTTA_H
 
+#include <array>
 #include <functional>
+#include <type_traits>
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 
 namespace allpix {
 
+    /**
+     * @brief Runge-Kutta tableau with coefficients known at compile time
+     *
+     * Uses the same layout as the tableaus in \ref allpix::tableau: the first S rows contain the coefficients of the stages,
+     * row S the weights of the solution and row S + 1 the weights of the error estimate. As the tableau is a literal type,
+     * the coefficients of the tableaus in \ref allpix::butcher can be folded into the integration steps by the compiler.
+     */
+    template <typename T, int S> struct ButcherTableau {
+        /**
+         * @brief Access a coefficient of the tableau
+         * @param row Row of the coefficient
+         * @param col Column of the coefficient
+         * @return Value of the coefficient
+         */
+        constexpr T operator()(int row, int col) const {
+            return coefficients[static_cast<size_t>(row)][static_cast<size_t>(col)];
+        }
+
+        std::array<std::array<T, S>, S + 2> coefficients;
+    };
+
+    /**
+     * @brief Type-erased stepping function used by default for the Runge-Kutta integration
+     */
+    template <typename T, int D>
+    using RungeKuttaStepFunction = std::function<Eigen::Matrix<T, D, 1>(T, Eigen::Matrix<T, D, 1>)>;
+
     /**
      * @brief Class to perform arbitrary Runge-Kutta integration
      *
      * Class can be provided a Runge-Kutta tableau (optionally with an error function), together with the dimension of the
      * equations and a step function to integrate a step of the equation. Both the result, error and timestep can be
      * retrieved and changed during the integration.
+     *
+     * By default the step function is stored as std::function and the tableau as Eigen matrix. Providing the type of the
+     * callable and a \ref ButcherTableau instead removes the indirect call of every stage, allowing the compiler to inline
+     * the step function and to unroll the stages (see \ref make_runge_kutta).
      */
-    template <typename T, int S, int D = 3> class RungeKutta {
+    template <typename T,
+              int S,
+              int D = 3,
+              typename F = RungeKuttaStepFunction<T, D>,
+              typename Tableau = Eigen::Matrix<T, S + 2, S>>
+    class RungeKutta {
     public:
         /**
          * @brief Utility type to return both the value and the error at every step
@@ -39,7 +77,7 @@ namespace allpix {
         /**
          * @brief Stepping function to integrate a single step of the equations
          */
-        using StepFunction = std::function<Eigen::Matrix<T, D, 1>(T, Eigen::Matrix<T, D, 1>)>;
+        using StepFunction = F;
 
         /**
          * @brief Construct a Runge-Kutta integrator
@@ -49,7 +87,7 @@ namespace allpix {
          * @param initial_y Start values of the vector to perform integration on
          * @param initial_t Initial time at the start of the integration
          */
-        RungeKutta(Eigen::Matrix<T, S + 2, S> tableau,
+        RungeKutta(Tableau tableau,
                    StepFunction function,
                    T step_size,
                    Eigen::Matrix<T, D, 1> initial_y,
@@ -111,7 +149,7 @@ namespace allpix {
                 T tt = t_;
                 for(int j = 0; j < i; ++j) {
                     yt += h_ * tableau_(i, j) * k.row(j);
-                    tt += tableau_(i, j);
+                    tt += h_ * tableau_(i, j);
                 }
                 k.row(i) = function_(tt, yt);
 
@@ -148,7 +186,7 @@ namespace allpix {
         }
 
     private:
-        const Eigen::Matrix<T, S + 2, S> tableau_;
+        const Tableau tableau_;
         StepFunction function_;
         // Step size
         T h_;
@@ -163,6 +201,14 @@ namespace allpix {
 
     // clang-format off
     namespace tableau {
+        /**
+         * @brief Explicit Euler method, the Euler-Maruyama method if combined with a diffusion step
+         * @warning Without error function
+         */
+        static const auto EULER((Eigen::Matrix<double, 3, 1>() <<
+            0,
+            1,
+            0).finished());
         /**
          * @brief Kutta's third order method
          * @warning Without error function
@@ -197,6 +243,53 @@ namespace allpix {
             16.0/135, 0, 6656.0/12825, 28561.0/56430, -9.0/50, 2.0/55,
             25.0/216, 0, 1408.0/2565, 2197.0/4104, -1.0/5, 0).finished());
     }
+
+    /**
+     * @brief Runge-Kutta tableaus with compile-time coefficients, equivalent to the tableaus in \ref allpix::tableau
+     */
+    namespace butcher {
+        /**
+         * @brief Explicit Euler method, the Euler-Maruyama method if combined with a diffusion step
+         * @warning Without error function
+         */
+        constexpr ButcherTableau<double, 1> EULER{{{
+            {{0}},
+            {{1}},
+            {{0}}}}};
+        /**
+         * @brief Kutta's third order method
+         * @warning Without error function
+         */
+        constexpr ButcherTableau<double, 3> RK3{{{
+            {{0, 0, 0}},
+            {{1.0/2, 0, 0}},
+            {{-1, 2, 0}},
+            {{1.0/6, 2.0/3, 1.0/6}},
+            {{0, 0, 0}}}}};
+        /**
+         * @brief Classic original Runge-Kutta method
+         * @warning Without error function
+         */
+        constexpr ButcherTableau<double, 4> RK4{{{
+            {{0, 0, 0, 0}},
+            {{1.0/2, 0, 0, 0}},
+            {{0, 1.0/2, 0, 0}},
+            {{0, 0, 1, 0}},
+            {{1.0/6, 1.0/3, 1.0/3, 1.0/6}},
+            {{0, 0, 0, 0}}}}};
+        /**
+         * @brief Runge-Kutta-Fehlberg method
+         */
+        constexpr ButcherTableau<double, 6> RK5{{{
+            {{0, 0, 0, 0, 0, 0}},
+            {{1.0/4, 0, 0, 0, 0, 0}},
+            {{3.0/32, 9.0/32, 0, 0, 0, 0}},
+            {{1932.0/2197, -7200.0/2197, 7296.0/2197, 0, 0, 0}},
+            {{439.0/216, -8, 3680.0/513, -845.0/4104, 0, 0}},
+            {{-8.0/27, 2, -3544.0/2565, 1859.0/4104, -11.0/40, 0}},
+            {{16.0/135, 0, 6656.0/12825, 28561.0/56430, -9.0/50, 2.0/55}},
+            {{25.0/216, 0, 1408.0/2565, 2197.0/4104, -1.0/5, 0}}}}};
+    }
     // clang-format on
 
     /**
@@ -209,6 +302,20 @@ namespace allpix {
     RungeKutta<T, S, D> make_runge_kutta(const Eigen::Matrix<T, S + 2, S>& tableau, Args&&... args) {
         return RungeKutta<T, S, D>(tableau, std::forward<Args>(args)...);
     }
+
+    /**
+     * @brief Utility function to create RungeKutta class with a compile-time tableau and an inlinable step function
+     * @param tableau One of the possible compile-time Runge-Kutta tableaus (see \ref allpix::butcher)
+     * @param function Step function to perform integration, stored with its own type instead of as std::function
+     * @param args Other forwarded arguments to the \ref RungeKutta::RungeKutta constructor
+     * @return Instantiation of \ref RungeKutta class with the forwarded arguments
+     */
+    template <typename T, int S, int D = 3, typename F, class... Args>
+    RungeKutta<T, S, D, typename std::decay<F>::type, ButcherTableau<T, S>>
+    make_runge_kutta(const ButcherTableau<T, S>& tableau, F&& function, Args&&... args) {
+        return RungeKutta<T, S, D, typename std::decay<F>::type, ButcherTableau<T, S>>(
+            tableau, std::forward<F>(function), std::forward<Args>(args)...);
+    }
 } // namespace allpix
 
 #endif /* ALLPIX_RUNGE_KUTTA_H */
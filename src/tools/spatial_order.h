@@ -0,0 +1,91 @@
+/**
+ * @file
+ * @brief Utility to order positions along a space-filling curve for a better locality of field lookups
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_SPATIAL_ORDER_H
+#define ALLPIX_SPATIAL_ORDER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace allpix {
+
+    /**
+     * @brief Spread the lowest 21 bits of a value such that two zero bits are located between every pair of bits
+     * @param value Value to spread
+     * @return Spread value, to be interleaved with the spread values of the two other coordinates
+     */
+    inline uint64_t spread_morton_bits(uint64_t value) {
+        value &= 0x1fffff;
+        value = (value | value << 32) & 0x1f00000000ffff;
+        value = (value | value << 16) & 0x1f0000ff0000ff;
+        value = (value | value << 8) & 0x100f00f00f00f00f;
+        value = (value | value << 4) & 0x10c30c30c30c30c3;
+        value = (value | value << 2) & 0x1249249249249249;
+        return value;
+    }
+
+    /**
+     * @brief Order objects by the Morton code of their position, a space-filling curve through the bounding box of all
+     * positions
+     * @param objects List of objects to order
+     * @param get_position Function returning the position of an object, the position should provide x(), y() and z()
+     * @return Positions of the objects in the input list, in the order along the curve
+     *
+     * Objects which are close along the curve are also close in space, such that consecutive objects access the same
+     * regions of a field map. Every coordinate is quantized to 21 bits within the bounding box. Objects with the same code
+     * keep the order of the input list, the result therefore only depends on the positions.
+     */
+    template <typename T, typename F> std::vector<size_t> morton_order(const std::vector<T>& objects, F get_position) {
+        std::vector<size_t> order(objects.size());
+        std::iota(order.begin(), order.end(), 0);
+        if(objects.size() < 2) {
+            return order;
+        }
+
+        // Find the bounding box of all positions
+        auto first = get_position(objects.front());
+        double lower[3] = {first.x(), first.y(), first.z()};
+        double upper[3] = {first.x(), first.y(), first.z()};
+        for(const auto& object : objects) {
+            auto position = get_position(object);
+            double coordinates[3] = {position.x(), position.y(), position.z()};
+            for(size_t i = 0; i < 3; ++i) {
+                lower[i] = std::min(lower[i], coordinates[i]);
+                upper[i] = std::max(upper[i], coordinates[i]);
+            }
+        }
+
+        // Calculate the code of every object by interleaving the bits of its quantized coordinates
+        std::vector<std::pair<uint64_t, size_t>> codes;
+        codes.reserve(objects.size());
+        for(size_t idx = 0; idx < objects.size(); ++idx) {
+            auto position = get_position(objects[idx]);
+            double coordinates[3] = {position.x(), position.y(), position.z()};
+            uint64_t code = 0;
+            for(size_t i = 0; i < 3; ++i) {
+                auto range = upper[i] - lower[i];
+                auto quantized = range > 0 ? static_cast<uint64_t>((coordinates[i] - lower[i]) / range * 0x1fffff) : 0;
+                code |= spread_morton_bits(quantized) << i;
+            }
+            codes.emplace_back(code, idx);
+        }
+        std::sort(codes.begin(), codes.end());
+
+        for(size_t idx = 0; idx < codes.size(); ++idx) {
+            order[idx] = codes[idx].second;
+        }
+        return order;
+    }
+} // namespace allpix
+
+#endif /* ALLPIX_SPATIAL_ORDER_H */
@@ -0,0 +1,58 @@
+/**
+ * @file
+ * @brief Effective trapping of charge carriers in irradiated silicon
+ * @copyright Copyright (c) 2017-2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#ifndef ALLPIX_TRAPPING_H
+#define ALLPIX_TRAPPING_H
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "core/utils/unit.h"
+
+namespace allpix {
+
+    /**
+     * @brief Effective trapping times of electrons and holes in silicon irradiated to the given fluence
+     * @param fluence 1 MeV neutron equivalent fluence
+     * @param temperature Temperature of the sensor
+     * @return Effective trapping times of electrons and holes, in this order, infinite for fluences of zero
+     *
+     * The inverse trapping time is proportional to the fluence, \f$1 / \tau = \beta(T) \Phi_{eq}\f$, with the trapping
+     * coefficients \f$\beta\f$ measured by G. Kramberger et al., https://doi.org/10.1016/S0168-9002(01)01263-3, scaled
+     * from their reference temperature of 263K.
+     */
+    inline std::array<double, 2> effective_trapping_times(double fluence, double temperature) {
+        if(!(fluence > 0)) {
+            return {{std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()}};
+        }
+        auto electron_beta = Units::get(5.6e-16 * std::pow(temperature / 263, -0.86), "cm*cm/ns");
+        auto hole_beta = Units::get(7.7e-16 * std::pow(temperature / 263, -1.52), "cm*cm/ns");
+        return {{1. / (electron_beta * fluence), 1. / (hole_beta * fluence)}};
+    }
+
+    /**
+     * @brief Draw the time after which a set of charge carriers is trapped
+     * @param trapping_time Effective trapping time of the carrier type
+     * @param random_engine Random engine to draw from, not used if the trapping time is infinite
+     * @return Time until the carriers are trapped, infinite if they are never trapped
+     *
+     * As the survival probability decays exponentially with the time, drawing the trapping time once is equivalent to a
+     * survival check in every step of the propagation, while the propagation of trapped carriers can be ended directly.
+     */
+    template <typename RandomEngine> double draw_trapping_time(double trapping_time, RandomEngine& random_engine) {
+        if(!std::isfinite(trapping_time)) {
+            return std::numeric_limits<double>::infinity();
+        }
+        return std::exponential_distribution<double>(1. / trapping_time)(random_engine);
+    }
+} // namespace allpix
+
+#endif /* ALLPIX_TRAPPING_H */
@@ -20,12 +20,13 @@ template <typename T> static void print_info(allpix::FieldData<T> field_data, si
               << std::endl;
     std::cout << "Dimensions: " << field_data.getDimensions()[0] << " x " << field_data.getDimensions()[1] << " x "
               << field_data.getDimensions()[2] << " cells" << std::endl;
-    std::cout << "Field vector with " << field_data.getData()->size() << " entries" << std::endl;
+    std::cout << "Field vector with " << field_data.getNumberOfElements() << " entries" << std::endl;
 
     if(n > 0) {
         std::cout << "First " << n << " entries of field data:" << std::endl;
-        for(size_t i = 0; i < field_data.getData()->size() && i < n; i++) {
-            std::cout << Units::display(field_data.getData()->at(i), units) << " ";
+        auto data = field_data.getView();
+        for(size_t i = 0; i < field_data.getNumberOfElements() && i < n; i++) {
+            std::cout << Units::display(data.get()[i], units) << " ";
         }
         std::cout << std::endl;
     }
@@ -89,14 +90,15 @@ int main(int argc, const char* argv[]) {
 
     for(auto& file_input : file_names) {
         std::cout << "FILE:       " << file_input << std::endl;
+        // Only read the header of the file unless field values are requested
+        auto read_file = [&](FieldQuantity quantity) {
+            FieldParser<double> field_parser(quantity);
+            return (n > 0 ? field_parser.getByFileName(file_input) : field_parser.getHeaderByFileName(file_input));
+        };
         try {
-            FieldParser<double> field_parser(FieldQuantity::VECTOR);
-            auto field_data = field_parser.getByFileName(file_input);
-            print_info(field_data, n, units);
+            print_info(read_file(FieldQuantity::VECTOR), n, units);
         } catch(std::runtime_error& e) {
-            FieldParser<double> field_parser(FieldQuantity::SCALAR);
-            auto field_data = field_parser.getByFileName(file_input);
-            print_info(field_data, n, units);
+            print_info(read_file(FieldQuantity::SCALAR), n, units);
         } catch(std::exception& e) {
             LOG(FATAL) << "Fatal internal error" << std::endl << e.what() << std::endl << "Cannot continue.";
             return_code = 127;
@@ -4,15 +4,77 @@
  */
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <string>
+#include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "core/utils/file.h"
 #include "core/utils/log.h"
 #include "tools/field_parser.h"
 #include "tools/units.h"
 
 using namespace allpix;
 
+/**
+ * @brief Convert an INIT file into an APF or MAPPED file block by block, storing the values directly in the output file
+ * @param quantity    Quantity of the field
+ * @param file_input  Input field file in the INIT format
+ * @param file_output Output field file
+ * @param format_to   File format of the output file
+ * @param units       Units the field is provided in
+ * @param block_size  Number of bytes of the input file read at once
+ *
+ * The output file is mapped into memory, such that neither the input file nor the field have to fit into memory.
+ */
+static void convert_in_blocks(FieldQuantity quantity,
+                              const std::string& file_input,
+                              const std::string& file_output,
+                              FileType format_to,
+                              const std::string& units,
+                              size_t block_size) {
+    FieldParser<double> field_parser(quantity);
+    auto header = field_parser.getHeaderByFileName(file_input);
+
+    LOG(STATUS) << "Creating output file " << file_output;
+    FieldWriter<double> field_writer(quantity);
+    auto data_offset = field_writer.createFile(header, file_output, format_to);
+    auto file_size = static_cast<size_t>(data_offset + header.getNumberOfElements() * sizeof(double));
+
+    // Map the output file into memory, modified pages are written back to the file by the kernel
+    int fd = ::open(file_output.c_str(), O_RDWR);
+    if(fd < 0) {
+        throw std::runtime_error("cannot open output file");
+    }
+    void* address = ::mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(address == MAP_FAILED) { // NOLINT
+        throw std::runtime_error("cannot map output file into memory");
+    }
+    std::shared_ptr<char> mapping(static_cast<char*>(address), [file_size](char* ptr) { ::munmap(ptr, file_size); });
+
+    // APF files store the values in little endian byte order, memory-mapped files in native byte order
+    auto* data = reinterpret_cast<std::uint8_t*>(mapping.get() + data_offset); // NOLINT
+    bool swap_bytes = (format_to == FileType::APF && !cereal::portable_binary_detail::is_little_endian());
+
+    LOG(STATUS) << "Converting input file " << file_input << " in blocks of " << (block_size >> 20) << " MB";
+    field_parser.readInitFileInBlocks(file_input, units, block_size, [&](size_t index, double value) {
+        auto* ptr = data + index * sizeof(double);
+        std::memcpy(ptr, &value, sizeof(double));
+        if(swap_bytes) {
+            cereal::portable_binary_detail::swap_bytes<sizeof(double)>(ptr);
+        }
+    });
+
+    if(::msync(mapping.get(), file_size, MS_SYNC) != 0) {
+        throw std::runtime_error("cannot write field data to file");
+    }
+}
+
 /**
  * @brief Main function running the application
  */
@@ -38,6 +100,7 @@ int main(int argc, const char* argv[]) {
     std::string file_output;
     std::string units;
     bool scalar = false;
+    size_t block_size = 256;
     for(int i = 1; i < argc; i++) {
         if(strcmp(argv[i], "-h") == 0) {
             print_help = true;
@@ -51,13 +114,18 @@ int main(int argc, const char* argv[]) {
         } else if(strcmp(argv[i], "--to") == 0 && (i + 1 < argc)) {
             std::string format = std::string(argv[++i]);
             std::transform(format.begin(), format.end(), format.begin(), ::tolower);
-            format_to = (format == "init" ? FileType::INIT : format == "apf" ? FileType::APF : FileType::UNKNOWN);
+            format_to = (format == "init"     ? FileType::INIT
+                         : format == "apf"    ? FileType::APF
+                         : format == "mapped" ? FileType::MAPPED
+                                              : FileType::UNKNOWN);
         } else if(strcmp(argv[i], "--input") == 0 && (i + 1 < argc)) {
             file_input = std::string(argv[++i]);
         } else if(strcmp(argv[i], "--output") == 0 && (i + 1 < argc)) {
             file_output = std::string(argv[++i]);
         } else if(strcmp(argv[i], "--units") == 0 && (i + 1 < argc)) {
             units = std::string(argv[++i]);
+        } else if(strcmp(argv[i], "--block_size") == 0 && (i + 1 < argc)) {
+            block_size = static_cast<size_t>(std::atoi(argv[++i]));
         } else if(strcmp(argv[i], "--scalar") == 0) {
             scalar = true;
         } else {
@@ -74,12 +142,14 @@ int main(int argc, const char* argv[]) {
         std::cout << "Usage: field_converter <parameters>" << std::endl;
         std::cout << std::endl;
         std::cout << "Parameters (all mandatory):" << std::endl;
-        std::cout << "  --to <format>    file format of the output file" << std::endl;
+        std::cout << "  --to <format>    file format of the output file (init, apf or mapped)" << std::endl;
         std::cout << "  --input <file>   input field file" << std::endl;
         std::cout << "  --output <file>  output field file" << std::endl;
         std::cout << "  --units <units>  units the field is provided in" << std::endl << std::endl;
         std::cout << "Options:" << std::endl;
         std::cout << "  --scalar         Convert scalar field. Default is vector field" << std::endl;
+        std::cout << "  --block_size <N> Convert INIT files to APF or mapped files in blocks of N MB, parsed" << std::endl;
+        std::cout << "                   in parallel. Zero reads the full file at once. Default is 256 MB" << std::endl;
         std::cout << std::endl;
         std::cout << "For more help, please see <https://cern.ch/allpix-squared>" << std::endl;
         return return_code;
@@ -88,6 +158,12 @@ int main(int argc, const char* argv[]) {
     try {
         FieldQuantity quantity = (scalar ? FieldQuantity::SCALAR : FieldQuantity::VECTOR);
 
+        // Stream INIT files into binary formats, which allow to store the values at their final position directly
+        if(block_size > 0 && !file_is_binary(file_input) && (format_to == FileType::APF || format_to == FileType::MAPPED)) {
+            convert_in_blocks(quantity, file_input, file_output, format_to, units, block_size << 20);
+            return return_code;
+        }
+
         FieldParser<double> field_parser(quantity);
         LOG(STATUS) << "Reading input file from " << file_input;
         auto field_data = field_parser.getByFileName(file_input, units);
@@ -0,0 +1,416 @@
+/**
+ * @file
+ * @brief Microbenchmarks of the hot paths of the framework core
+ *
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Math/Point3D.h>
+#include <Math/Vector3D.h>
+
+#include "core/config/ConfigReader.hpp"
+#include "core/config/Configuration.hpp"
+#include "core/geometry/Detector.hpp"
+#include "core/geometry/HybridPixelDetectorModel.hpp"
+#include "core/utils/log.h"
+#include "tools/runge_kutta.h"
+
+using namespace allpix;
+
+namespace {
+    /**
+     * @brief Single benchmark: the function executes the measured operation the requested number of times
+     */
+    struct Benchmark {
+        std::string name;
+        std::function<void(size_t)> function;
+    };
+
+    /**
+     * @brief Result of a single benchmark, the time is given per iteration
+     */
+    struct Result {
+        std::string name;
+        size_t iterations;
+        double real_time;
+    };
+
+    // Sink for results of the benchmarked operations to prevent the compiler from removing the measured code
+    volatile double sink;
+
+    /**
+     * @brief Run a benchmark repeatedly, increasing the number of iterations until the minimal time is reached
+     */
+    Result run_benchmark(const Benchmark& benchmark, double min_time) {
+        size_t iterations = 1;
+        while(true) {
+            auto start = std::chrono::steady_clock::now();
+            benchmark.function(iterations);
+            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if(elapsed >= min_time || iterations >= (static_cast<size_t>(1) << 40)) {
+                return {benchmark.name, iterations, elapsed * 1e9 / static_cast<double>(iterations)};
+            }
+
+            // Estimate the number of iterations needed, but do not grow by more than a factor ten at once
+            auto factor = (elapsed > 0 ? 1.4 * min_time / elapsed : 10.);
+            iterations = static_cast<size_t>(static_cast<double>(iterations) * std::min(std::max(factor, 2.), 10.));
+        }
+    }
+
+    /**
+     * @brief Create a detector with a generic hybrid pixel model, dimensions are given in the framework units (mm)
+     */
+    std::shared_ptr<Detector> create_detector() {
+        std::stringstream model_stream;
+        model_stream << "number_of_pixels = 256 256\n"
+                     << "pixel_size = 0.055 0.055\n"
+                     << "sensor_thickness = 0.3\n"
+                     << "chip_thickness = 0.7\n"
+                     << "bump_cylinder_radius = 0.0075\n"
+                     << "bump_height = 0.02\n";
+        ConfigReader reader(model_stream, "benchmark.conf");
+        auto model = std::make_shared<HybridPixelDetectorModel>("benchmark", reader);
+        return std::make_shared<Detector>("benchmark", model, ROOT::Math::XYZPoint(), ROOT::Math::Rotation3D());
+    }
+
+    /**
+     * @brief Thickness domain covering the full sensor of the detector
+     */
+    std::pair<double, double> sensor_domain(const Detector& detector) {
+        auto model = detector.getModel();
+        auto center = model->getSensorCenter().z();
+        auto thickness = model->getSensorSize().z();
+        return {center - thickness / 2.0, center + thickness / 2.0};
+    }
+
+    /**
+     * @brief Generate random positions within the sensor of the detector, reproducible between runs
+     */
+    std::vector<ROOT::Math::XYZPoint> random_positions(const Detector& detector, size_t count) {
+        auto model = detector.getModel();
+        auto size = model->getSensorSize();
+        auto center = model->getSensorCenter();
+
+        std::mt19937_64 engine(42);
+        std::uniform_real_distribution<double> uniform(-0.5, 0.5);
+        std::vector<ROOT::Math::XYZPoint> positions;
+        positions.reserve(count);
+        for(size_t i = 0; i < count; ++i) {
+            positions.emplace_back(center.x() + uniform(engine) * size.x(),
+                                   center.y() + uniform(engine) * size.y(),
+                                   center.z() + uniform(engine) * size.z());
+        }
+        return positions;
+    }
+
+    /**
+     * @brief Create a field grid of a single pixel with the requested number of bins and components per bin
+     */
+    std::shared_ptr<std::vector<double>> create_grid(std::array<size_t, 3> dimensions, size_t components) {
+        auto grid = std::make_shared<std::vector<double>>(dimensions[0] * dimensions[1] * dimensions[2] * components);
+        for(size_t i = 0; i < grid->size(); ++i) {
+            (*grid)[i] = static_cast<double>(i % 1000) * 1e-3;
+        }
+        return grid;
+    }
+
+    /**
+     * @brief Benchmarks of the electric field lookup for the different field types
+     */
+    void add_electric_field_benchmarks(std::vector<Benchmark>& benchmarks) {
+        auto positions = std::make_shared<std::vector<ROOT::Math::XYZPoint>>();
+
+        auto make_benchmark = [positions](std::shared_ptr<Detector> detector) {
+            if(positions->empty()) {
+                *positions = random_positions(*detector, 4096);
+            }
+            return [positions, detector](size_t iterations) {
+                double sum = 0;
+                for(size_t i = 0; i < iterations; ++i) {
+                    sum += detector->getElectricField((*positions)[i % positions->size()]).z();
+                }
+                sink = sum;
+            };
+        };
+
+        for(auto interpolation : {FieldInterpolation::NEAREST, FieldInterpolation::LINEAR}) {
+            auto detector = create_detector();
+            auto pitch = detector->getModel()->getPixelSize();
+            detector->setElectricFieldGrid(create_grid({{50, 50, 100}}, 3),
+                                           {{50, 50, 100}},
+                                           {{pitch.x(), pitch.y()}},
+                                           {{0, 0}},
+                                           sensor_domain(*detector),
+                                           interpolation);
+            auto name = std::string("DetectorField/Grid/") +
+                        (interpolation == FieldInterpolation::NEAREST ? "Nearest" : "Linear");
+            benchmarks.push_back({name, make_benchmark(detector)});
+        }
+
+        auto linear = create_detector();
+        auto domain = sensor_domain(*linear);
+        linear->setElectricFieldFunction(
+            [domain](const ROOT::Math::XYZPoint& pos) {
+                return ROOT::Math::XYZVector(0, 0, 1e-4 * (pos.z() - domain.first) + 1e-5);
+            },
+            domain,
+            FieldType::LINEAR);
+        benchmarks.push_back({"DetectorField/LinearFunction", make_benchmark(linear)});
+
+        auto closed_form = create_detector();
+        closed_form->setElectricFieldLinear(
+            ROOT::Math::XYZVector(0, 0, 1), 1e-5 - 1e-4 * domain.first, 1e-4, domain, FieldType::LINEAR);
+        benchmarks.push_back({"DetectorField/Linear", make_benchmark(closed_form)});
+
+        auto custom = create_detector();
+        custom->setElectricFieldFunction(
+            [](const ROOT::Math::XYZPoint& pos) {
+                return ROOT::Math::XYZVector(1e-6 * pos.x(), 1e-6 * pos.y(), 1e-4 * std::exp(-pos.z()));
+            },
+            sensor_domain(*custom),
+            FieldType::CUSTOM);
+        benchmarks.push_back({"DetectorField/Custom", make_benchmark(custom)});
+    }
+
+    /**
+     * @brief Benchmarks of the weighting potential lookup for a single pixel and for an induction matrix
+     */
+    void add_weighting_potential_benchmarks(std::vector<Benchmark>& benchmarks) {
+        auto detector = create_detector();
+        auto pitch = detector->getModel()->getPixelSize();
+        auto pixels = detector->getModel()->getNPixels();
+        detector->setWeightingPotentialGrid(create_grid({{150, 150, 100}}, 1),
+                                            {{150, 150, 100}},
+                                            {{3 * pitch.x(), 3 * pitch.y()}},
+                                            {{0, 0}},
+                                            sensor_domain(*detector),
+                                            FieldInterpolation::LINEAR);
+        auto positions = std::make_shared<std::vector<ROOT::Math::XYZPoint>>(random_positions(*detector, 4096));
+
+        benchmarks.push_back({"Detector/getWeightingPotential/Single", [detector, positions, pitch, pixels](size_t it) {
+                                  double sum = 0;
+                                  for(size_t i = 0; i < it; ++i) {
+                                      auto& pos = (*positions)[i % positions->size()];
+                                      auto x = std::min(static_cast<int>(std::lround(pos.x() / pitch.x())), pixels.x() - 1);
+                                      auto y = std::min(static_cast<int>(std::lround(pos.y() / pitch.y())), pixels.y() - 1);
+                                      Pixel::Index reference(static_cast<unsigned int>(std::max(x, 0)),
+                                                             static_cast<unsigned int>(std::max(y, 0)));
+                                      sum += detector->getWeightingPotential(pos, reference);
+                                  }
+                                  sink = sum;
+                              }});
+
+        benchmarks.push_back({"Detector/getWeightingPotential/Matrix3x3", [detector, positions, pitch](size_t it) {
+                                  double sum = 0;
+                                  std::vector<double> potentials;
+                                  for(size_t i = 0; i < it; ++i) {
+                                      auto& pos = (*positions)[i % positions->size()];
+                                      auto x = static_cast<int>(std::lround(pos.x() / pitch.x()));
+                                      auto y = static_cast<int>(std::lround(pos.y() / pitch.y()));
+                                      detector->getWeightingPotential(pos, x - 1, y - 1, 3, 3, potentials);
+                                      sum += potentials[4];
+                                  }
+                                  sink = sum;
+                              }});
+    }
+
+    /**
+     * @brief Benchmarks of a single Runge-Kutta step, using a type-erased and an inlinable step function
+     */
+    void add_runge_kutta_benchmarks(std::vector<Benchmark>& benchmarks) {
+        auto velocity = [](double, const Eigen::Vector3d& pos) -> Eigen::Vector3d {
+            Eigen::Vector3d efield(1e-6 * pos.x(), 1e-6 * pos.y(), 1e-4 + 1e-5 * pos.z());
+            auto mobility = 1.0 / (1.0 + efield.norm() * 1e3);
+            return -mobility * efield;
+        };
+
+        benchmarks.push_back({"RungeKutta/step/StdFunction", [velocity](size_t iterations) {
+                                  auto runge_kutta = make_runge_kutta(tableau::RK5,
+                                                                      RungeKuttaStepFunction<double, 3>(velocity),
+                                                                      0.01,
+                                                                      Eigen::Vector3d(0, 0, 0));
+                                  double sum = 0;
+                                  for(size_t i = 0; i < iterations; ++i) {
+                                      sum += runge_kutta.step().error.z();
+                                  }
+                                  sink = sum;
+                              }});
+
+        benchmarks.push_back({"RungeKutta/step/Inlined", [velocity](size_t iterations) {
+                                  auto runge_kutta =
+                                      make_runge_kutta(butcher::RK5, velocity, 0.01, Eigen::Vector3d(0, 0, 0));
+                                  double sum = 0;
+                                  for(size_t i = 0; i < iterations; ++i) {
+                                      sum += runge_kutta.step().error.z();
+                                  }
+                                  sink = sum;
+                              }});
+    }
+
+    /**
+     * @brief Benchmarks of the parameter lookup in configurations, including the conversion from the stored string
+     */
+    void add_configuration_benchmarks(std::vector<Benchmark>& benchmarks) {
+        auto config = std::make_shared<Configuration>("benchmark");
+        config->set<double>("temperature", 293.15);
+        config->set<ROOT::Math::XYZVector>("position", {1., 2., 3.});
+        config->setArray<double>("thresholds", {1., 2., 3., 4., 5., 6., 7., 8.});
+
+        benchmarks.push_back({"Configuration/get/Double", [config](size_t iterations) {
+                                  double sum = 0;
+                                  for(size_t i = 0; i < iterations; ++i) {
+                                      sum += config->get<double>("temperature");
+                                  }
+                                  sink = sum;
+                              }});
+        benchmarks.push_back({"Configuration/get/Default", [config](size_t iterations) {
+                                  double sum = 0;
+                                  for(size_t i = 0; i < iterations; ++i) {
+                                      sum += config->get<double>("not_existing", 1.);
+                                  }
+                                  sink = sum;
+                              }});
+        benchmarks.push_back({"Configuration/get/Vector", [config](size_t iterations) {
+                                  double sum = 0;
+                                  for(size_t i = 0; i < iterations; ++i) {
+                                      sum += config->get<ROOT::Math::XYZVector>("position").z();
+                                  }
+                                  sink = sum;
+                              }});
+        benchmarks.push_back({"Configuration/getArray/Double", [config](size_t iterations) {
+                                  double sum = 0;
+                                  for(size_t i = 0; i < iterations; ++i) {
+                                      sum += config->getArray<double>("thresholds").back();
+                                  }
+                                  sink = sum;
+                              }});
+    }
+
+    /**
+     * @brief Write the results in the JSON format used by Google Benchmark, such that existing tooling can compare runs
+     */
+    void write_json(std::ostream& out, const std::vector<Result>& results) {
+        auto now = std::time(nullptr);
+        std::tm tm{};
+        localtime_r(&now, &tm);
+
+        out << "{\n";
+        out << "  \"context\": {\n";
+        out << "    \"date\": \"" << std::put_time(&tm, "%Y-%m-%dT%H:%M:%S") << "\",\n";
+        out << "    \"executable\": \"allpix_benchmarks\",\n";
+        out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+        out << "    \"allpix_version\": \"" << ALLPIX_PROJECT_VERSION << "\"\n";
+        out << "  },\n";
+        out << "  \"benchmarks\": [\n";
+        for(size_t i = 0; i < results.size(); ++i) {
+            out << "    {\n";
+            out << "      \"name\": \"" << results[i].name << "\",\n";
+            out << "      \"run_type\": \"iteration\",\n";
+            out << "      \"iterations\": " << results[i].iterations << ",\n";
+            out << "      \"real_time\": " << std::setprecision(6) << results[i].real_time << ",\n";
+            out << "      \"cpu_time\": " << std::setprecision(6) << results[i].real_time << ",\n";
+            out << "      \"time_unit\": \"ns\"\n";
+            out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n";
+        out << "}\n";
+    }
+
+    void print_help() {
+        std::cout << "Usage: allpix_benchmarks [OPTIONS]" << std::endl;
+        std::cout << "Run the microbenchmarks of the Allpix Squared core" << std::endl;
+        std::cout << "  -o <file>       write the results as JSON to the file" << std::endl;
+        std::cout << "  -f <filter>     only run benchmarks whose name contains the filter" << std::endl;
+        std::cout << "  -t <seconds>    minimal time per benchmark (defaults to 0.5)" << std::endl;
+        std::cout << "  -l              list the available benchmarks" << std::endl;
+        std::cout << "  -h              print this help text" << std::endl;
+    }
+} // namespace
+
+int main(int argc, char* argv[]) {
+    // Only report problems of the framework when running the benchmarks
+    Log::addStream(std::cerr);
+    Log::setReportingLevel(LogLevel::WARNING);
+
+    std::string output_file;
+    std::string filter;
+    double min_time = 0.5;
+    bool list = false;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-h") == 0) {
+            print_help();
+            return 0;
+        } else if(strcmp(argv[i], "-o") == 0 && (i + 1 < argc)) {
+            output_file = std::string(argv[++i]);
+        } else if(strcmp(argv[i], "-f") == 0 && (i + 1 < argc)) {
+            filter = std::string(argv[++i]);
+        } else if(strcmp(argv[i], "-t") == 0 && (i + 1 < argc)) {
+            min_time = std::stod(argv[++i]);
+        } else if(strcmp(argv[i], "-l") == 0) {
+            list = true;
+        } else {
+            std::cerr << "Unrecognized command line argument \"" << argv[i] << "\"" << std::endl;
+            print_help();
+            return 1;
+        }
+    }
+
+    std::vector<Benchmark> benchmarks;
+    try {
+        add_electric_field_benchmarks(benchmarks);
+        add_weighting_potential_benchmarks(benchmarks);
+        add_runge_kutta_benchmarks(benchmarks);
+        add_configuration_benchmarks(benchmarks);
+    } catch(std::exception& e) {
+        std::cerr << "Setting up the benchmarks failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::vector<Result> results;
+    for(auto& benchmark : benchmarks) {
+        if(!filter.empty() && benchmark.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        if(list) {
+            std::cout << benchmark.name << std::endl;
+            continue;
+        }
+
+        auto result = run_benchmark(benchmark, min_time);
+        std::cout << std::left << std::setw(48) << result.name << std::right << std::setw(14) << std::fixed
+                  << std::setprecision(2) << result.real_time << " ns" << std::setw(14) << result.iterations << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+        results.push_back(result);
+    }
+
+    if(!output_file.empty()) {
+        std::ofstream file(output_file);
+        if(!file) {
+            std::cerr << "Cannot write results to file \"" << output_file << "\"" << std::endl;
+            return 1;
+        }
+        write_json(file, results);
+    }
+    return 0;
+}
@@ -0,0 +1,75 @@
+#!/bin/bash
+# Measure the event rate and the output rate of the readers and writers on recorded message streams at several occupancies.
+# The message streams are simulated once per occupancy and written with the ROOTObjectWriter. Every reader and writer is
+# then benchmarked on its own, reading the recorded stream with the ROOTObjectReader, such that the measurement does not
+# include the cost of the simulation. The benchmark mode of the executable reports the steady-state events/s and the output
+# rate of every module, which are collected in a table.
+#
+# Usage: run_io_benchmarks.sh <output directory> <executable> [particles per event...]
+# The occupancies default to 1, 10 and 100 particles per event.
+
+ABSOLUTE_PATH="$( cd "$( dirname "${BASH_SOURCE}" )" && pwd )"
+
+if [ "$#" -lt 2 ]; then
+    echo "Usage: $0 <output directory> <executable> [particles per event...]"
+    exit 1
+fi
+OUTPUT=$1
+EXECUTABLE=$2
+shift 2
+OCCUPANCIES=${@:-1 10 100}
+
+# The recorded streams hold the warm-up and timed events of every benchmark
+WARMUP_EVENTS=100
+BENCHMARK_EVENTS=1000
+MODULES="ROOTObjectReader ROOTObjectWriter LCIOWriter CorryvreckanWriter RCEWriter TextWriter"
+
+rm -rf $OUTPUT
+mkdir -p $OUTPUT
+cd $OUTPUT
+
+TABLE="PARTICLES|MODULE|EVENTS/S|OUTPUT\n"
+for n in $OCCUPANCIES; do
+    mkdir -p particles_$n
+    ( cd particles_$n && $EXECUTABLE -c $ABSOLUTE_PATH/generate.conf -o detectors_file=$ABSOLUTE_PATH/detector.conf \
+        -o number_of_events=$((WARMUP_EVENTS + BENCHMARK_EVENTS)) -o DepositionGeant4.number_of_particles=$n \
+        > generate.txt 2>&1 )
+    if [ $? -ne 0 ]; then
+        echo "Simulation of the stream with $n particles per event failed, see $OUTPUT/particles_$n/generate.txt"
+        tail -n 20 particles_$n/generate.txt
+        exit 1
+    fi
+    STREAM=$(pwd)/particles_$n/output/stream.root
+
+    for module in $MODULES; do
+        mkdir -p particles_$n/$module
+        # The reader is benchmarked on its own, every writer reads the stream with the reader in front
+        {
+            echo "[Allpix]"
+            echo "detectors_file = \"$ABSOLUTE_PATH/detector.conf\""
+            echo "random_seed = 1"
+            echo "[ROOTObjectReader]"
+            echo "file_name = \"$STREAM\""
+            if [ "$module" != "ROOTObjectReader" ]; then
+                echo "[$module]"
+            fi
+        } > particles_$n/$module/benchmark.conf
+        ( cd particles_$n/$module && $EXECUTABLE -c benchmark.conf --benchmark $BENCHMARK_EVENTS \
+            --warmup $WARMUP_EVENTS > log.txt 2>&1 )
+        if [ $? -ne 0 ]; then
+            echo "Benchmark of $module with $n particles per event failed, see $OUTPUT/particles_$n/$module/log.txt"
+            continue
+        fi
+
+        LINE=$(grep " Module $module took" particles_$n/$module/log.txt | tail -n 1)
+        RATE=$(echo "$LINE" | sed 's/.*(\([0-9.e+]*\) events\/s).*/\1/')
+        if [[ "$LINE" == *" at "* ]]; then
+            BYTES=$(echo "$LINE" | sed 's/.* at \([^ ]*\/s\).*/\1/')
+        else
+            BYTES="-"
+        fi
+        TABLE="$TABLE$n|$module|$RATE|$BYTES\n"
+    done
+done
+
+echo -e "$TABLE" | column -t -s "|"
@@ -0,0 +1,343 @@
+/**
+ * @file
+ * @brief Tool comparing the distributions of two simulations with statistical tests, to validate approximate simulations
+ * against a reference simulation
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <TBranch.h>
+#include <TFile.h>
+#include <TH1D.h>
+#include <TMath.h>
+#include <TTree.h>
+
+#include "core/utils/log.h"
+#include "objects/MCParticle.hpp"
+#include "objects/PixelCharge.hpp"
+#include "objects/PixelHit.hpp"
+#include "objects/PropagatedCharge.hpp"
+
+using namespace allpix;
+
+namespace {
+    // Samples of every compared distribution, by the name of the distribution
+    using Samples = std::map<std::string, std::vector<double>>;
+
+    /**
+     * @brief Branch of the objects of a single detector in a file written by the ROOTObjectWriter, read event by event
+     */
+    template <typename T> class ObjectBranch {
+    public:
+        /**
+         * @brief Find the branch of a detector in the tree of an object type
+         * @param file File to read from
+         * @param tree_name Name of the tree of the object type
+         * @param detector Name of the detector
+         */
+        ObjectBranch(TFile* file, const std::string& tree_name, const std::string& detector) {
+            auto* tree = dynamic_cast<TTree*>(file->Get(tree_name.c_str()));
+            if(tree != nullptr) {
+                branch_ = tree->FindBranch(detector.c_str());
+            }
+            if(branch_ != nullptr) {
+                branch_->SetObject(&objects_);
+            }
+        }
+
+        /// @{
+        /**
+         * @brief Copying or moving the branch is not allowed, as ROOT refers to the list of objects
+         */
+        ObjectBranch(const ObjectBranch&) = delete;
+        ObjectBranch& operator=(const ObjectBranch&) = delete;
+        ObjectBranch(ObjectBranch&&) = delete;
+        ObjectBranch& operator=(ObjectBranch&&) = delete;
+        /// @}
+
+        /**
+         * @brief Delete the objects of the last event
+         */
+        ~ObjectBranch() { release(); }
+
+        /**
+         * @brief Check if the branch exists in the file
+         * @return True if the branch exists, false otherwise
+         */
+        bool valid() const { return branch_ != nullptr; }
+
+        /**
+         * @brief Get the number of events in the branch
+         * @return Number of events
+         */
+        Long64_t entries() const { return branch_ == nullptr ? 0 : branch_->GetEntries(); }
+
+        /**
+         * @brief Read the objects of an event
+         * @param entry Index of the event in the branch
+         * @return List of objects in the event
+         */
+        const std::vector<T*>& read(Long64_t entry) {
+            release();
+            branch_->GetEntry(entry);
+            return objects_;
+        }
+
+    private:
+        void release() {
+            for(auto* object : objects_) {
+                delete object;
+            }
+            objects_.clear();
+        }
+
+        TBranch* branch_{};
+        std::vector<T*> objects_;
+    };
+
+    /**
+     * @brief Read the samples of all distributions of a detector from a file
+     * @param file_name Name of the file written by the ROOTObjectWriter
+     * @param detector Name of the detector
+     * @return Samples of the distributions available in the file
+     *
+     * The cluster size and the residuals are calculated from all pixel hits of an event as a single cluster, as in the
+     * constructComparisonTree macro. The residuals compare the center of gravity of the hits with the average of the start
+     * and end points of the Monte Carlo particles.
+     */
+    Samples read_samples(const std::string& file_name, const std::string& detector) {
+        std::unique_ptr<TFile> file(TFile::Open(file_name.c_str(), "READ"));
+        if(file == nullptr || file->IsZombie()) {
+            throw std::invalid_argument("cannot open file '" + file_name + "'");
+        }
+
+        ObjectBranch<PixelHit> hits(file.get(), "PixelHit", detector);
+        ObjectBranch<PixelCharge> pixel_charges(file.get(), "PixelCharge", detector);
+        ObjectBranch<PropagatedCharge> propagated_charges(file.get(), "PropagatedCharge", detector);
+        ObjectBranch<MCParticle> particles(file.get(), "MCParticle", detector);
+
+        Samples samples;
+        for(Long64_t entry = 0; entry < hits.entries(); ++entry) {
+            const auto& event_hits = hits.read(entry);
+            samples["cluster_size"].push_back(static_cast<double>(event_hits.size()));
+
+            double total_signal = 0;
+            double center_x = 0, center_y = 0;
+            for(const auto* hit : event_hits) {
+                total_signal += hit->getSignal();
+                center_x += hit->getPixel().getLocalCenter().x() * hit->getSignal();
+                center_y += hit->getPixel().getLocalCenter().y() * hit->getSignal();
+            }
+            samples["total_signal"].push_back(total_signal);
+
+            if(particles.valid() && total_signal != 0) {
+                const auto& event_particles = particles.read(entry);
+                if(!event_particles.empty()) {
+                    double track_x = 0, track_y = 0;
+                    for(const auto* particle : event_particles) {
+                        track_x += (particle->getLocalStartPoint().x() + particle->getLocalEndPoint().x()) / 2.0;
+                        track_y += (particle->getLocalStartPoint().y() + particle->getLocalEndPoint().y()) / 2.0;
+                    }
+                    auto count = static_cast<double>(event_particles.size());
+                    samples["residual_x"].push_back(track_x / count - center_x / total_signal);
+                    samples["residual_y"].push_back(track_y / count - center_y / total_signal);
+                }
+            }
+        }
+        for(Long64_t entry = 0; entry < pixel_charges.entries(); ++entry) {
+            double total_charge = 0;
+            for(const auto* pixel_charge : pixel_charges.read(entry)) {
+                total_charge += pixel_charge->getCharge();
+            }
+            samples["total_charge"].push_back(total_charge);
+        }
+        for(Long64_t entry = 0; entry < propagated_charges.entries(); ++entry) {
+            for(const auto* propagated_charge : propagated_charges.read(entry)) {
+                samples["arrival_time"].push_back(propagated_charge->getEventTime());
+            }
+        }
+        return samples;
+    }
+
+    /**
+     * @brief Result of the comparison of a distribution
+     */
+    struct Comparison {
+        double ks_probability{};
+        double chi2_probability{};
+    };
+
+    /**
+     * @brief Compare the samples of a distribution with the Kolmogorov-Smirnov test and a binned chi-square test
+     * @param name Name of the distribution
+     * @param reference Samples of the reference simulation
+     * @param candidate Samples of the simulation to validate
+     * @param bins Number of bins of the histograms for the chi-square test
+     * @param output File to write the histograms to, or nullptr
+     * @return Probabilities of both tests
+     */
+    Comparison compare(const std::string& name,
+                       std::vector<double> reference,
+                       std::vector<double> candidate,
+                       int bins,
+                       TFile* output) {
+        std::sort(reference.begin(), reference.end());
+        std::sort(candidate.begin(), candidate.end());
+
+        Comparison comparison;
+        comparison.ks_probability = TMath::KolmogorovTest(static_cast<Int_t>(reference.size()),
+                                                          reference.data(),
+                                                          static_cast<Int_t>(candidate.size()),
+                                                          candidate.data(),
+                                                          "");
+
+        // Bin both samples in the same range, extended such that the largest value is not in the overflow bin
+        auto lower = std::min(reference.front(), candidate.front());
+        auto upper = std::max(reference.back(), candidate.back());
+        auto margin = (upper > lower ? (upper - lower) * 1e-6 : 0.5);
+        TH1D reference_histogram(
+            (name + "_reference").c_str(), (name + " reference").c_str(), bins, lower - margin, upper + margin);
+        TH1D candidate_histogram(
+            (name + "_candidate").c_str(), (name + " candidate").c_str(), bins, lower - margin, upper + margin);
+        reference_histogram.SetDirectory(nullptr);
+        candidate_histogram.SetDirectory(nullptr);
+        for(auto value : reference) {
+            reference_histogram.Fill(value);
+        }
+        for(auto value : candidate) {
+            candidate_histogram.Fill(value);
+        }
+        comparison.chi2_probability = reference_histogram.Chi2Test(&candidate_histogram, "UU");
+
+        if(output != nullptr) {
+            output->WriteTObject(&reference_histogram);
+            output->WriteTObject(&candidate_histogram);
+        }
+        return comparison;
+    }
+} // namespace
+
+/**
+ * @brief Main function running the application
+ */
+int main(int argc, const char* argv[]) {
+
+    // Add cout as the default logging stream
+    Log::addStream(std::cout);
+
+    // If no arguments are provided, print the help:
+    bool print_help = false;
+    int return_code = 0;
+    if(argc == 1) {
+        print_help = true;
+        return_code = 1;
+    }
+
+    // Parse arguments
+    std::vector<std::string> file_names;
+    std::string detector;
+    std::string output_file_name;
+    double alpha = 0.01;
+    int bins = 100;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-h") == 0) {
+            print_help = true;
+        } else if(strcmp(argv[i], "-v") == 0 && (i + 1 < argc)) {
+            try {
+                LogLevel log_level = Log::getLevelFromString(std::string(argv[++i]));
+                Log::setReportingLevel(log_level);
+            } catch(std::invalid_argument& e) {
+                LOG(ERROR) << "Invalid verbosity level \"" << std::string(argv[i]) << "\", ignoring overwrite";
+            }
+        } else if(strcmp(argv[i], "-d") == 0 && (i + 1 < argc)) {
+            detector = std::string(argv[++i]);
+        } else if(strcmp(argv[i], "-a") == 0 && (i + 1 < argc)) {
+            alpha = std::atof(argv[++i]);
+        } else if(strcmp(argv[i], "-b") == 0 && (i + 1 < argc)) {
+            bins = std::atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-o") == 0 && (i + 1 < argc)) {
+            output_file_name = std::string(argv[++i]);
+        } else {
+            file_names.emplace_back(std::string(argv[i]));
+        }
+    }
+    if(!print_help && (file_names.size() != 2 || detector.empty() || bins <= 0)) {
+        LOG(ERROR) << "Two input files, a detector and a positive number of bins are required";
+        print_help = true;
+        return_code = 1;
+    }
+
+    // Print help if requested or no arguments given
+    if(print_help) {
+        std::cout << "Allpix Squared Distribution Comparison Tool" << std::endl;
+        std::cout << std::endl;
+        std::cout << "Usage: allpix_compare -d <detector> [OPTIONS] <reference file> <candidate file>" << std::endl;
+        std::cout << std::endl;
+        std::cout << "Options:" << std::endl;
+        std::cout << "  -d <detector>    name of the detector to compare the distributions of" << std::endl;
+        std::cout << "  -a <alpha>       minimum probability of both tests to accept a distribution (default 0.01)"
+                  << std::endl;
+        std::cout << "  -b <bins>        number of bins for the chi-square test (default 100)" << std::endl;
+        std::cout << "  -o <file>        ROOT file to write the histograms of both simulations to" << std::endl;
+        std::cout << "  -v <level>       verbosity level, overwriting the global level" << std::endl;
+        std::cout << std::endl;
+        std::cout << "For more help, please see <https://cern.ch/allpix-squared>" << std::endl;
+        return return_code;
+    }
+
+    try {
+        auto reference = read_samples(file_names[0], detector);
+        auto candidate = read_samples(file_names[1], detector);
+
+        std::unique_ptr<TFile> output;
+        if(!output_file_name.empty()) {
+            output = std::make_unique<TFile>(output_file_name.c_str(), "RECREATE");
+        }
+
+        size_t failed = 0, compared = 0;
+        for(auto& distribution : reference) {
+            auto candidate_samples = candidate.find(distribution.first);
+            if(distribution.second.empty() || candidate_samples == candidate.end() || candidate_samples->second.empty()) {
+                LOG(WARNING) << "Distribution " << distribution.first << " is not available in both files, skipping it";
+                continue;
+            }
+
+            auto comparison =
+                compare(distribution.first, distribution.second, candidate_samples->second, bins, output.get());
+            auto passed = (comparison.ks_probability >= alpha && comparison.chi2_probability >= alpha);
+            ++compared;
+            if(!passed) {
+                ++failed;
+            }
+            std::cout << std::left << std::setw(16) << distribution.first << " KS p = " << std::setw(12)
+                      << comparison.ks_probability << " chi2 p = " << std::setw(12) << comparison.chi2_probability
+                      << (passed ? "PASS" : "FAIL") << std::endl;
+        }
+
+        if(compared == 0) {
+            LOG(ERROR) << "No distribution of detector " << detector << " found in both files";
+            return 1;
+        }
+        std::cout << (failed == 0 ? "PASS" : "FAIL") << ": " << (compared - failed) << " of " << compared
+                  << " distributions compatible at alpha = " << alpha << std::endl;
+        return_code = (failed == 0 ? 0 : 1);
+    } catch(std::exception& e) {
+        LOG(FATAL) << "Fatal internal error" << std::endl << e.what() << std::endl << "Cannot continue.";
+        return_code = 127;
+    }
+
+    return return_code;
+}
@@ -0,0 +1,391 @@
+/**
+ * @file
+ * @brief Tool merging the output files of the ROOTObjectWriter written by the shards of a run split into event ranges
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <TChain.h>
+#include <TClass.h>
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TKey.h>
+#include <TROOT.h>
+#include <TTree.h>
+
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+namespace {
+    // Keys of the global configuration which are expected to differ between the shards of a run
+    const std::set<std::string> shard_keys{"first_event",
+                                           "number_of_events",
+                                           "split_events_by_rank",
+                                           "output_directory",
+                                           "log_file",
+                                           "checkpoint_file",
+                                           "resume_from_checkpoint",
+                                           "statistics_file",
+                                           "metrics_file",
+                                           "trace_file"};
+
+    /**
+     * @brief Metadata of a single shard, read from the configuration stored in its output file
+     */
+    struct Shard {
+        std::string file_name;
+        unsigned long long first_event{1};
+        unsigned long long number_of_events{};
+        std::string random_seed;
+        // Values of all configuration keys by the path of the key in the configuration directory
+        std::map<std::string, std::string> configuration;
+        // Names of the trees in the top directory of the file
+        std::vector<std::string> trees;
+    };
+
+    /**
+     * @brief Read all configuration values stored as strings in a directory and its subdirectories
+     * @param directory Directory to read from
+     * @param prefix Path of the directory, prepended to the names of the keys
+     * @param values Map to add the values to
+     */
+    void read_configuration(TDirectory* directory, const std::string& prefix, std::map<std::string, std::string>& values) {
+        for(auto* object : *directory->GetListOfKeys()) {
+            auto* key = static_cast<TKey*>(object);
+            auto* cls = TClass::GetClass(key->GetClassName());
+            auto path = prefix + "/" + key->GetName();
+            if(cls != nullptr && cls->InheritsFrom(TDirectory::Class())) {
+                read_configuration(directory->GetDirectory(key->GetName()), path, values);
+            } else if(std::string(key->GetClassName()) == "string") {
+                std::unique_ptr<std::string> value(static_cast<std::string*>(key->ReadObjectAny(cls)));
+                if(value != nullptr) {
+                    values[path] = *value;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Open a shard and read its metadata
+     * @param file_name Name of the output file of the shard
+     * @return Metadata of the shard
+     * @throws std::runtime_error If the file cannot be opened or does not contain the configuration of the run
+     */
+    Shard read_shard(const std::string& file_name) {
+        std::unique_ptr<TFile> file(TFile::Open(file_name.c_str(), "READ"));
+        if(file == nullptr || file->IsZombie()) {
+            throw std::runtime_error("cannot open file " + file_name);
+        }
+        auto* config_dir = file->GetDirectory("config");
+        if(config_dir == nullptr) {
+            throw std::runtime_error("file " + file_name + " does not contain the configuration of the run");
+        }
+
+        Shard shard;
+        shard.file_name = file_name;
+        read_configuration(config_dir, "config", shard.configuration);
+
+        auto global = [&](const std::string& key) -> const std::string* {
+            auto iter = shard.configuration.find("config/Allpix/" + key);
+            return iter != shard.configuration.end() ? &iter->second : nullptr;
+        };
+        if(global("number_of_events") == nullptr || global("random_seed") == nullptr) {
+            throw std::runtime_error("file " + file_name + " does not contain the number of events and the random seed");
+        }
+        shard.number_of_events = std::stoull(*global("number_of_events"));
+        shard.random_seed = *global("random_seed");
+        if(global("first_event") != nullptr) {
+            shard.first_event = std::stoull(*global("first_event"));
+        }
+
+        for(auto* object : *file->GetListOfKeys()) {
+            auto* key = static_cast<TKey*>(object);
+            auto* cls = TClass::GetClass(key->GetClassName());
+            if(cls != nullptr && cls->InheritsFrom(TTree::Class()) &&
+               std::find(shard.trees.begin(), shard.trees.end(), key->GetName()) == shard.trees.end()) {
+                shard.trees.emplace_back(key->GetName());
+            }
+        }
+        return shard;
+    }
+
+    /**
+     * @brief Read the metadata of all shards in parallel, as opening hundreds of files is dominated by latency
+     * @param file_names Names of the output files of the shards
+     * @param threads Number of threads to open the files with
+     * @return Metadata of the shards in the order of the file names
+     */
+    std::vector<Shard> read_shards(const std::vector<std::string>& file_names, unsigned int threads) {
+        std::vector<Shard> shards(file_names.size());
+        std::atomic<size_t> next{0};
+        std::exception_ptr exception;
+        std::mutex exception_mutex;
+
+        auto worker = [&]() {
+            for(size_t index = next++; index < file_names.size(); index = next++) {
+                try {
+                    shards[index] = read_shard(file_names[index]);
+                } catch(...) {
+                    std::lock_guard<std::mutex> lock(exception_mutex);
+                    if(!exception) {
+                        exception = std::current_exception();
+                    }
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        for(unsigned int i = 1; i < std::min<size_t>(threads, file_names.size()); ++i) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for(auto& thread : workers) {
+            thread.join();
+        }
+
+        if(exception) {
+            std::rethrow_exception(exception);
+        }
+        return shards;
+    }
+
+    /**
+     * @brief Check that the shards belong to the same run and cover a contiguous range of events without overlaps
+     * @param shards Shards sorted by their first event
+     * @return Number of configuration values differing between the shards
+     * @throws std::runtime_error If the shards cannot be merged
+     */
+    size_t validate_shards(const std::vector<Shard>& shards) {
+        auto& first = shards.front();
+        for(size_t i = 1; i < shards.size(); ++i) {
+            auto& previous = shards[i - 1];
+            auto& shard = shards[i];
+            if(shard.random_seed != first.random_seed) {
+                throw std::runtime_error("file " + shard.file_name + " uses random seed " + shard.random_seed +
+                                         " instead of " + first.random_seed + " of file " + first.file_name);
+            }
+            auto expected = previous.first_event + previous.number_of_events;
+            if(shard.first_event < expected) {
+                throw std::runtime_error("events of file " + shard.file_name + " starting at event " +
+                                         std::to_string(shard.first_event) + " overlap with file " + previous.file_name);
+            }
+            if(shard.first_event > expected) {
+                throw std::runtime_error("events " + std::to_string(expected) + " to " +
+                                         std::to_string(shard.first_event - 1) + " are missing between files " +
+                                         previous.file_name + " and " + shard.file_name);
+            }
+            if(shard.trees != first.trees) {
+                throw std::runtime_error("file " + shard.file_name + " does not contain the same object types as file " +
+                                         first.file_name);
+            }
+        }
+
+        // Configuration values other than the event range should be identical, as only a single copy is kept
+        size_t differences = 0;
+        for(auto& shard : shards) {
+            for(auto& key_value : shard.configuration) {
+                auto slash = key_value.first.rfind('/');
+                if(key_value.first.compare(0, 14, "config/Allpix/") == 0 &&
+                   shard_keys.find(key_value.first.substr(slash + 1)) != shard_keys.end()) {
+                    continue;
+                }
+                auto reference = first.configuration.find(key_value.first);
+                if(reference == first.configuration.end()) {
+                    LOG(WARNING) << "Configuration key " << key_value.first << " of file " << shard.file_name
+                                 << " is not set in file " << first.file_name;
+                    ++differences;
+                } else if(reference->second != key_value.second) {
+                    LOG(WARNING) << "Configuration key " << key_value.first << " of file " << shard.file_name << " is "
+                                 << key_value.second << " instead of " << reference->second << " in file "
+                                 << first.file_name;
+                    ++differences;
+                }
+            }
+        }
+        return differences;
+    }
+
+    /**
+     * @brief Copy all objects of a directory and its subdirectories
+     * @param source Directory to copy from
+     * @param target Directory to copy to
+     */
+    void copy_directory(TDirectory* source, TDirectory* target) {
+        for(auto* object : *source->GetListOfKeys()) {
+            auto* key = static_cast<TKey*>(object);
+            auto* cls = TClass::GetClass(key->GetClassName());
+            if(cls == nullptr) {
+                LOG(WARNING) << "Unknown class " << key->GetClassName() << " of object " << key->GetName()
+                             << ", skipping it";
+                continue;
+            }
+            if(cls->InheritsFrom(TDirectory::Class())) {
+                copy_directory(source->GetDirectory(key->GetName()), target->mkdir(key->GetName()));
+                continue;
+            }
+            auto* value = key->ReadObjectAny(cls);
+            target->WriteObjectAny(value, cls, key->GetName());
+            cls->Destructor(value);
+        }
+    }
+} // namespace
+
+/**
+ * @brief Main function running the application
+ */
+int main(int argc, const char* argv[]) {
+
+    // Add cout as the default logging stream
+    Log::addStream(std::cout);
+
+    // If no arguments are provided, print the help:
+    bool print_help = false;
+    int return_code = 0;
+    if(argc == 1) {
+        print_help = true;
+        return_code = 1;
+    }
+
+    // Parse arguments
+    std::vector<std::string> file_names;
+    std::string output_file_name;
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    int compression = -1;
+    bool force = false;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-h") == 0) {
+            print_help = true;
+        } else if(strcmp(argv[i], "-v") == 0 && (i + 1 < argc)) {
+            try {
+                LogLevel log_level = Log::getLevelFromString(std::string(argv[++i]));
+                Log::setReportingLevel(log_level);
+            } catch(std::invalid_argument& e) {
+                LOG(ERROR) << "Invalid verbosity level \"" << std::string(argv[i]) << "\", ignoring overwrite";
+            }
+        } else if(strcmp(argv[i], "-o") == 0 && (i + 1 < argc)) {
+            output_file_name = std::string(argv[++i]);
+        } else if(strcmp(argv[i], "-j") == 0 && (i + 1 < argc)) {
+            threads = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+        } else if(strcmp(argv[i], "-c") == 0 && (i + 1 < argc)) {
+            compression = std::atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-f") == 0) {
+            force = true;
+        } else {
+            file_names.emplace_back(std::string(argv[i]));
+        }
+    }
+    if(!print_help && (file_names.empty() || output_file_name.empty())) {
+        LOG(ERROR) << "An output file and at least one input file are required";
+        print_help = true;
+        return_code = 1;
+    }
+
+    // Print help if requested or no arguments given
+    if(print_help) {
+        std::cout << "Allpix Squared Output Merging Tool" << std::endl;
+        std::cout << std::endl;
+        std::cout << "Usage: allpix_merge -o <output file> [OPTIONS] <input files>" << std::endl;
+        std::cout << std::endl;
+        std::cout << "Options:" << std::endl;
+        std::cout << "  -o <file>        ROOT file to write the merged output to" << std::endl;
+        std::cout << "  -j <threads>     number of threads to read and recompress the files with (default all cores)"
+                  << std::endl;
+        std::cout << "  -c <setting>     recompress the objects with this ROOT compression setting instead of copying the "
+                     "compressed data"
+                  << std::endl;
+        std::cout << "  -f               merge even if configuration values other than the event range differ" << std::endl;
+        std::cout << "  -v <level>       verbosity level, overwriting the global level" << std::endl;
+        std::cout << std::endl;
+        std::cout << "For more help, please see <https://cern.ch/allpix-squared>" << std::endl;
+        return return_code;
+    }
+
+    try {
+        // Read and validate the metadata of all shards, ordered by their first event
+        ROOT::EnableThreadSafety();
+        auto shards = read_shards(file_names, threads);
+        std::sort(shards.begin(), shards.end(), [](const Shard& a, const Shard& b) {
+            return a.first_event < b.first_event;
+        });
+        auto differences = validate_shards(shards);
+        if(differences > 0 && !force) {
+            LOG(ERROR) << differences << " configuration value(s) differ between the files, use -f to merge nevertheless";
+            return 1;
+        }
+        auto first_event = shards.front().first_event;
+        auto number_of_events = shards.back().first_event + shards.back().number_of_events - first_event;
+        LOG(STATUS) << "Merging events " << first_event << " to " << (first_event + number_of_events - 1) << " of "
+                    << shards.size() << " file(s) with " << shards.front().trees.size() << " object type(s)";
+
+        // Compress the baskets of the merged trees in parallel if they are recompressed
+        if(compression >= 0 && threads > 1) {
+            ROOT::EnableImplicitMT(threads);
+        }
+
+        std::unique_ptr<TFile> output(TFile::Open(output_file_name.c_str(), "RECREATE"));
+        if(output == nullptr || output->IsZombie()) {
+            throw std::runtime_error("cannot create output file " + output_file_name);
+        }
+        if(compression >= 0) {
+            output->SetCompressionSettings(compression);
+        }
+
+        // Concatenate the trees, copying the compressed baskets unless the data is recompressed
+        for(auto& tree_name : shards.front().trees) {
+            TChain chain(tree_name.c_str());
+            for(auto& shard : shards) {
+                chain.Add(shard.file_name.c_str());
+            }
+            output->cd();
+            auto* tree = chain.CloneTree(-1, compression >= 0 ? "" : "fast");
+            if(tree == nullptr) {
+                throw std::runtime_error("cannot merge the trees of " + tree_name);
+            }
+            tree->Write("", TObject::kOverwrite);
+            LOG(INFO) << "Merged " << tree->GetEntries() << " events of " << tree_name;
+            delete tree;
+        }
+
+        // Keep a single copy of the configuration and of the geometry, updating the event range to the merged run
+        std::unique_ptr<TFile> first_file(TFile::Open(shards.front().file_name.c_str(), "READ"));
+        for(const auto* directory : {"config", "detectors", "models"}) {
+            auto* source = first_file->GetDirectory(directory);
+            if(source != nullptr) {
+                copy_directory(source, output->mkdir(directory));
+            }
+        }
+        auto* global_dir = output->GetDirectory("config/Allpix");
+        if(global_dir != nullptr) {
+            auto first_event_text = std::to_string(first_event);
+            auto number_of_events_text = std::to_string(number_of_events);
+            global_dir->WriteObject(&first_event_text, "first_event", "WriteDelete");
+            global_dir->WriteObject(&number_of_events_text, "number_of_events", "WriteDelete");
+        }
+
+        output->Write();
+        output->Close();
+        LOG(STATUS) << "Wrote " << number_of_events << " events to file " << output_file_name;
+    } catch(std::exception& e) {
+        LOG(FATAL) << "Fatal internal error" << std::endl << e.what() << std::endl << "Cannot continue.";
+        return_code = 127;
+    }
+
+    return return_code;
+}
@@ -0,0 +1,442 @@
+/**
+ * @file
+ * @brief Tool comparing the performance statistics of repeated runs of two versions of a simulation
+ * @copyright Copyright (c) 2020 CERN and the Allpix Squared authors.
+ * This software is distributed under the terms of the MIT License, copied verbatim in the file "LICENSE.md".
+ * In applying this license, CERN does not waive the privileges and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <TMath.h>
+
+#include "core/utils/log.h"
+
+using namespace allpix;
+
+namespace {
+    /**
+     * @brief Value of a JSON document, as far as needed to read the statistics files written by the framework
+     */
+    struct JsonValue {
+        double number{};
+        std::string string;
+        std::vector<JsonValue> array;
+        std::vector<std::pair<std::string, JsonValue>> members;
+
+        /**
+         * @brief Find a member of an object
+         * @param key Name of the member
+         * @return Pointer to the member, nullptr if the object has no member with this name
+         */
+        const JsonValue* find(const std::string& key) const {
+            for(auto& member : members) {
+                if(member.first == key) {
+                    return &member.second;
+                }
+            }
+            return nullptr;
+        }
+    };
+
+    /**
+     * @brief Recursive descent parser for JSON documents
+     */
+    class JsonParser {
+    public:
+        /**
+         * @brief Construct the parser for a document
+         * @param text Text of the document
+         */
+        explicit JsonParser(std::string text) : text_(std::move(text)) {}
+
+        /**
+         * @brief Parse the full document
+         * @return Value of the document
+         * @throws std::runtime_error If the document is not valid
+         */
+        JsonValue parse() {
+            auto value = parse_value();
+            skip_space();
+            if(position_ != text_.size()) {
+                fail("unexpected trailing characters");
+            }
+            return value;
+        }
+
+    private:
+        void fail(const std::string& reason) const {
+            throw std::runtime_error("invalid JSON at character " + std::to_string(position_) + ": " + reason);
+        }
+
+        void skip_space() {
+            while(position_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[position_])) != 0) {
+                ++position_;
+            }
+        }
+
+        void expect(char character) {
+            skip_space();
+            if(position_ >= text_.size() || text_[position_] != character) {
+                fail(std::string("expected '") + character + "'");
+            }
+            ++position_;
+        }
+
+        bool accept(char character) {
+            skip_space();
+            if(position_ < text_.size() && text_[position_] == character) {
+                ++position_;
+                return true;
+            }
+            return false;
+        }
+
+        std::string parse_string() {
+            expect('"');
+            std::string result;
+            while(position_ < text_.size() && text_[position_] != '"') {
+                if(text_[position_] == '\\' && position_ + 1 < text_.size()) {
+                    ++position_;
+                }
+                result += text_[position_++];
+            }
+            expect('"');
+            return result;
+        }
+
+        JsonValue parse_value() {
+            JsonValue value;
+            skip_space();
+            if(position_ >= text_.size()) {
+                fail("unexpected end of document");
+            }
+            if(accept('{')) {
+                if(!accept('}')) {
+                    do {
+                        skip_space();
+                        auto key = parse_string();
+                        expect(':');
+                        value.members.emplace_back(key, parse_value());
+                    } while(accept(','));
+                    expect('}');
+                }
+            } else if(accept('[')) {
+                if(!accept(']')) {
+                    do {
+                        value.array.push_back(parse_value());
+                    } while(accept(','));
+                    expect(']');
+                }
+            } else if(text_[position_] == '"') {
+                value.string = parse_string();
+            } else {
+                // Numbers and the literals true, false and null
+                auto end = text_.find_first_of(",]} \t\r\n", position_);
+                auto token = text_.substr(position_, end - position_);
+                position_ = (end == std::string::npos ? text_.size() : end);
+                if(token == "true" || token == "false" || token == "null") {
+                    value.number = (token == "true" ? 1 : 0);
+                } else {
+                    char* token_end = nullptr;
+                    value.number = std::strtod(token.c_str(), &token_end);
+                    if(token.empty() || *token_end != '\0') {
+                        fail("invalid number '" + token + "'");
+                    }
+                }
+            }
+            return value;
+        }
+
+        std::string text_;
+        size_t position_{};
+    };
+
+    /**
+     * @brief Performance statistics of a single run
+     */
+    struct RunStatistics {
+        double total_time{};
+        double events{};
+        double peak_memory{};
+        double time_to_first_event{};
+        // Execution time per module instantiation, in the order of execution
+        std::vector<std::pair<std::string, double>> module_times;
+    };
+
+    /**
+     * @brief Read the statistics file of a run
+     * @param file_name Path of the statistics file written by the framework
+     * @return Statistics of the run
+     */
+    RunStatistics read_statistics(const std::string& file_name) {
+        std::ifstream file(file_name);
+        if(!file) {
+            throw std::runtime_error("cannot open statistics file " + file_name);
+        }
+        std::stringstream text;
+        text << file.rdbuf();
+        auto document = JsonParser(text.str()).parse();
+
+        RunStatistics statistics;
+        auto number = [&](const JsonValue& object, const std::string& key) {
+            const auto* value = object.find(key);
+            return value == nullptr ? std::nan("") : value->number;
+        };
+        statistics.total_time = number(document, "total_time");
+        statistics.events = number(document, "events");
+        statistics.peak_memory = number(document, "peak_resident_memory");
+        statistics.time_to_first_event = number(document, "time_to_first_event");
+        if(std::isnan(statistics.total_time)) {
+            throw std::runtime_error("file " + file_name + " is not a statistics file");
+        }
+        const auto* modules = document.find("modules");
+        if(modules != nullptr) {
+            for(auto& module : modules->array) {
+                const auto* name = module.find("name");
+                if(name != nullptr) {
+                    statistics.module_times.emplace_back(name->string, number(module, "execution_time"));
+                }
+            }
+        }
+        return statistics;
+    }
+
+    /**
+     * @brief Comparison of a quantity between the repeated runs of the reference and the candidate
+     */
+    struct Comparison {
+        double reference_mean{};
+        double candidate_mean{};
+        double relative_change{};
+        // Probability of the observed difference if both means are equal, not a number if it cannot be calculated
+        double probability{};
+    };
+
+    /**
+     * @brief Compare the values of a quantity with Welch's t-test
+     * @param reference Values of the quantity in the reference runs
+     * @param candidate Values of the quantity in the candidate runs
+     * @return Comparison of the means, the probability requires at least two runs of both versions
+     */
+    Comparison compare(const std::vector<double>& reference, const std::vector<double>& candidate) {
+        auto mean_variance = [](const std::vector<double>& values) {
+            double mean = 0;
+            for(auto value : values) {
+                mean += value / static_cast<double>(values.size());
+            }
+            double variance = 0;
+            for(auto value : values) {
+                variance += (value - mean) * (value - mean);
+            }
+            variance = (values.size() > 1 ? variance / static_cast<double>(values.size() - 1) : 0);
+            return std::make_pair(mean, variance);
+        };
+
+        Comparison comparison;
+        auto ref = mean_variance(reference);
+        auto cand = mean_variance(candidate);
+        comparison.reference_mean = ref.first;
+        comparison.candidate_mean = cand.first;
+        comparison.relative_change = (ref.first != 0 ? cand.first / ref.first - 1 : std::nan(""));
+        comparison.probability = std::nan("");
+        if(reference.size() < 2 || candidate.size() < 2) {
+            return comparison;
+        }
+
+        auto ref_error = ref.second / static_cast<double>(reference.size());
+        auto cand_error = cand.second / static_cast<double>(candidate.size());
+        if(ref_error + cand_error == 0) {
+            comparison.probability = (ref.first == cand.first ? 1 : 0);
+            return comparison;
+        }
+        auto t = (cand.first - ref.first) / std::sqrt(ref_error + cand_error);
+        auto ndf = (ref_error + cand_error) * (ref_error + cand_error) /
+                   (ref_error * ref_error / static_cast<double>(reference.size() - 1) +
+                    cand_error * cand_error / static_cast<double>(candidate.size() - 1));
+        comparison.probability = 2 * (1 - TMath::StudentI(std::fabs(t), ndf));
+        return comparison;
+    }
+
+    /**
+     * @brief Print a row of the comparison table
+     * @param name Name of the compared quantity
+     * @param comparison Comparison of the quantity
+     * @param alpha Probability below which a change is significant, marked by an asterisk
+     */
+    void print_row(const std::string& name, const Comparison& comparison, double alpha) {
+        std::cout << std::left << std::setw(48) << name << std::right << std::setw(14) << comparison.reference_mean
+                  << std::setw(14) << comparison.candidate_mean << std::setw(10) << std::fixed << std::setprecision(1)
+                  << comparison.relative_change * 100 << "%" << std::setw(10) << std::setprecision(4);
+        if(std::isnan(comparison.probability)) {
+            std::cout << "-";
+        } else {
+            std::cout << comparison.probability;
+        }
+        std::cout << std::defaultfloat << std::setprecision(6) << (comparison.probability < alpha ? "  *" : "") << std::endl;
+    }
+} // namespace
+
+/**
+ * @brief Main function running the application
+ */
+int main(int argc, const char* argv[]) {
+
+    // Add cout as the default logging stream
+    Log::addStream(std::cout);
+
+    // If no arguments are provided, print the help:
+    bool print_help = false;
+    int return_code = 0;
+    if(argc == 1) {
+        print_help = true;
+        return_code = 1;
+    }
+
+    // Parse arguments
+    std::vector<std::string> reference_files;
+    std::vector<std::string> candidate_files;
+    double alpha = 0.05;
+    double tolerance = 0.05;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-h") == 0) {
+            print_help = true;
+        } else if(strcmp(argv[i], "-v") == 0 && (i + 1 < argc)) {
+            try {
+                LogLevel log_level = Log::getLevelFromString(std::string(argv[++i]));
+                Log::setReportingLevel(log_level);
+            } catch(std::invalid_argument& e) {
+                LOG(ERROR) << "Invalid verbosity level \"" << std::string(argv[i]) << "\", ignoring overwrite";
+            }
+        } else if(strcmp(argv[i], "-r") == 0 && (i + 1 < argc)) {
+            reference_files.emplace_back(std::string(argv[++i]));
+        } else if(strcmp(argv[i], "-a") == 0 && (i + 1 < argc)) {
+            alpha = std::atof(argv[++i]);
+        } else if(strcmp(argv[i], "-t") == 0 && (i + 1 < argc)) {
+            tolerance = std::atof(argv[++i]);
+        } else {
+            candidate_files.emplace_back(std::string(argv[i]));
+        }
+    }
+    if(!print_help && (reference_files.empty() || candidate_files.empty())) {
+        LOG(ERROR) << "At least one reference and one candidate statistics file are required";
+        print_help = true;
+        return_code = 1;
+    }
+
+    // Print help if requested or no arguments given
+    if(print_help) {
+        std::cout << "Allpix Squared Performance Statistics Comparison Tool" << std::endl;
+        std::cout << std::endl;
+        std::cout << "Usage: allpix_compare_statistics [OPTIONS] -r <reference file> [-r <reference file> ...] "
+                     "<candidate file> [<candidate file> ...]"
+                  << std::endl;
+        std::cout << std::endl;
+        std::cout << "Options:" << std::endl;
+        std::cout << "  -r <file>        statistics file of a run of the reference version, repeated for every run"
+                  << std::endl;
+        std::cout << "  -a <alpha>       probability below which a change is significant (default 0.05)" << std::endl;
+        std::cout << "  -t <tolerance>   relative increase of the run time and memory to accept (default 0.05)"
+                  << std::endl;
+        std::cout << "  -v <level>       verbosity level, overwriting the global level" << std::endl;
+        std::cout << std::endl;
+        std::cout << "For more help, please see <https://cern.ch/allpix-squared>" << std::endl;
+        return return_code;
+    }
+
+    try {
+        std::vector<RunStatistics> reference, candidate;
+        for(auto& file_name : reference_files) {
+            reference.push_back(read_statistics(file_name));
+        }
+        for(auto& file_name : candidate_files) {
+            candidate.push_back(read_statistics(file_name));
+        }
+
+        // Collect the values of a quantity over all runs, skipping runs where it is not available
+        auto collect = [](const std::vector<RunStatistics>& runs, double (*get)(const RunStatistics&)) {
+            std::vector<double> values;
+            for(auto& run : runs) {
+                auto value = get(run);
+                if(!std::isnan(value)) {
+                    values.push_back(value);
+                }
+            }
+            return values;
+        };
+
+        std::cout << std::left << std::setw(48) << "" << std::right << std::setw(14) << "reference" << std::setw(14)
+                  << "candidate" << std::setw(11) << "change" << std::setw(10) << "p" << std::endl;
+
+        // Compare the execution time of every module instantiation of the reference runs
+        auto module_times = [](const std::vector<RunStatistics>& runs, const std::string& name) {
+            std::vector<double> times;
+            for(auto& run : runs) {
+                for(auto& module_time : run.module_times) {
+                    if(module_time.first == name) {
+                        times.push_back(module_time.second);
+                    }
+                }
+            }
+            return times;
+        };
+        for(auto& module : reference.front().module_times) {
+            auto reference_times = module_times(reference, module.first);
+            auto candidate_times = module_times(candidate, module.first);
+            if(candidate_times.empty()) {
+                LOG(WARNING) << "Module " << module.first << " is not available in the candidate runs, skipping it";
+                continue;
+            }
+            print_row(module.first + " [s]", compare(reference_times, candidate_times), alpha);
+        }
+
+        // Compare the quantities of the full runs, which decide if the candidate is accepted
+        auto time = compare(collect(reference, [](const RunStatistics& run) { return run.total_time; }),
+                            collect(candidate, [](const RunStatistics& run) { return run.total_time; }));
+        print_row("total time [s]", time, alpha);
+        auto rate = compare(collect(reference, [](const RunStatistics& run) { return run.events / run.total_time; }),
+                            collect(candidate, [](const RunStatistics& run) { return run.events / run.total_time; }));
+        print_row("event rate [Hz]", rate, alpha);
+        auto reference_memory = collect(reference, [](const RunStatistics& run) { return run.peak_memory / 1024 / 1024; });
+        auto candidate_memory = collect(candidate, [](const RunStatistics& run) { return run.peak_memory / 1024 / 1024; });
+        Comparison memory;
+        if(!reference_memory.empty() && !candidate_memory.empty()) {
+            memory = compare(reference_memory, candidate_memory);
+            print_row("peak resident memory [MiB]", memory, alpha);
+        }
+        auto reference_startup = collect(reference, [](const RunStatistics& run) { return run.time_to_first_event; });
+        auto candidate_startup = collect(candidate, [](const RunStatistics& run) { return run.time_to_first_event; });
+        if(!reference_startup.empty() && !candidate_startup.empty()) {
+            print_row("time to first event [s]", compare(reference_startup, candidate_startup), alpha);
+        }
+
+        // Reject the candidate if the time or memory increases by more than the tolerance, significantly if repeated
+        auto rejected = [&](const Comparison& comparison) {
+            return comparison.relative_change > tolerance && !(comparison.probability >= alpha);
+        };
+        bool accepted = !rejected(time) && !rejected(memory);
+        std::cout << (accepted ? "PASS" : "FAIL") << ": run time changed by " << std::fixed << std::setprecision(1)
+                  << time.relative_change * 100 << "% and peak memory by " << memory.relative_change * 100
+                  << "% with a tolerance of " << tolerance * 100 << "%" << std::endl;
+        return_code = (accepted ? 0 : 1);
+    } catch(std::exception& e) {
+        LOG(FATAL) << "Fatal internal error" << std::endl << e.what() << std::endl << "Cannot continue.";
+        return_code = 127;
+    }
+
+    return return_code;
+}
@@ -1,11 +1,13 @@
 #include "DFISEParser.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cctype>
 #include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <fstream>
 #include <iostream>
-#include <regex>
 #include <set>
 #include <string>
 #include "TFile.h"
@@ -16,17 +18,214 @@
 
 using namespace mesh_converter;
 
-std::map<std::string, std::vector<Point>> mesh_converter::read_grid(const std::string& file_name, bool mesh_tree) {
-    std::ifstream file(file_name);
-    if(!file) {
-        throw std::runtime_error("file cannot be accessed");
+namespace {
+    /**
+     * @brief Read the full file into memory
+     * @param file_name Name of the file to read
+     * @return Buffer with the content of the file
+     *
+     * Reading the file in a single call is considerably faster than reading it line by line from a stream
+     */
+    std::string read_file(const std::string& file_name) {
+        std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+        if(!file) {
+            throw std::runtime_error("file cannot be accessed");
+        }
+
+        auto size = file.tellg();
+        std::string buffer(static_cast<size_t>(size), '\0');
+        file.seekg(0, std::ios::beg);
+        if(!file.read(&buffer[0], size)) {
+            throw std::runtime_error("file cannot be read");
+        }
+        return buffer;
+    }
+
+    /**
+     * @brief Check if a character is whitespace, using the same set of characters as allpix::trim
+     */
+    inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v'; }
+
+    /**
+     * @brief Reader of the trimmed lines of a buffer
+     */
+    class LineReader {
+    public:
+        explicit LineReader(const std::string& buffer) : begin_(buffer.data()), pos_(begin_), end_(begin_ + buffer.size()) {}
+
+        /**
+         * @brief Fetch the next line with leading and trailing whitespace removed
+         * @param line String to assign the line to, its memory is reused between the lines
+         * @return True if a line was read, false if the end of the buffer was reached
+         */
+        bool next(std::string& line) {
+            if(pos_ == end_) {
+                return false;
+            }
+
+            const auto* eol = static_cast<const char*>(std::memchr(pos_, '\n', static_cast<size_t>(end_ - pos_)));
+            if(eol == nullptr) {
+                eol = end_;
+            }
+
+            const auto* first = pos_;
+            const auto* last = eol;
+            while(first < last && is_space(*first)) {
+                ++first;
+            }
+            while(last > first && is_space(*(last - 1))) {
+                --last;
+            }
+            line.assign(first, last);
+
+            pos_ = (eol == end_ ? end_ : eol + 1);
+            return true;
+        }
+
+        /**
+         * @brief Get the parsing progress
+         * @return Percentage of the buffer read
+         */
+        long long progress() const { return (end_ == begin_ ? 100 : 100 * (pos_ - begin_) / (end_ - begin_)); }
+
+    private:
+        const char* begin_;
+        const char* pos_;
+        const char* end_;
+    };
+
+    /**
+     * @brief Parse a section header of the form "Name {" or "Name (data) {"
+     * @param line Trimmed line to parse
+     * @param name Name of the section
+     * @param data Data of the section, empty for headers without data
+     * @return True if the line is a section header
+     */
+    bool parse_section_header(const std::string& line, std::string& name, std::string& data) {
+        size_t pos = 0;
+        while(pos < line.size() && std::isalpha(static_cast<unsigned char>(line[pos]))) {
+            ++pos;
+        }
+        if(pos == 0 || pos + 2 > line.size() || line[pos] != ' ') {
+            return false;
+        }
+        name = line.substr(0, pos);
+
+        // Simple header without data
+        if(line.compare(pos, std::string::npos, " {") == 0) {
+            data.clear();
+            return true;
+        }
+
+        // Header with data enclosed in parentheses, which should not contain whitespace
+        if(line[pos + 1] != '(' || line.size() < pos + 6 || line.compare(line.size() - 3, 3, ") {") != 0) {
+            return false;
+        }
+        data = line.substr(pos + 2, line.size() - pos - 5);
+        return !data.empty() && std::none_of(data.begin(), data.end(), is_space);
+    }
+
+    /**
+     * @brief Parse a key-value pair of the form "key = value"
+     * @param line Trimmed line to parse
+     * @param key Key of the pair
+     * @param value Trimmed value of the pair
+     * @return True if the line is a key-value pair
+     */
+    bool parse_key_value(const std::string& line, std::string& key, std::string& value) {
+        size_t pos = 0;
+        while(pos < line.size() && std::isalpha(static_cast<unsigned char>(line[pos]))) {
+            ++pos;
+        }
+        auto key_end = pos;
+        while(pos < line.size() && is_space(line[pos])) {
+            ++pos;
+        }
+        if(key_end == 0 || pos == key_end || pos >= line.size() || line[pos] != '=') {
+            return false;
+        }
+        ++pos;
+        auto value_begin = pos;
+        while(pos < line.size() && is_space(line[pos])) {
+            ++pos;
+        }
+        if(pos == value_begin || pos == line.size()) {
+            return false;
+        }
+
+        key = line.substr(0, key_end);
+        value = line.substr(pos);
+        return true;
     }
 
-    // Get the total number of lines to parse and reset file to the start:
-    auto num_lines = std::count(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>(), '\n');
-    file.clear();
-    file.seekg(0, std::ios::beg);
-    LOG(DEBUG) << "Grid file contains " << num_lines << " lines to parse";
+    /**
+     * @brief Parse the region name from a validity value of the form [ "region" ]
+     * @param value Validity value to parse
+     * @param region Name of the region
+     * @return True if the value specifies exactly one region
+     */
+    bool parse_validity(const std::string& value, std::string& region) {
+        if(value.size() < 5 || value.front() != '[' || value.back() != ']' || !is_space(value[1]) ||
+           !is_space(value[value.size() - 2])) {
+            return false;
+        }
+        auto inner = allpix::trim(value.substr(1, value.size() - 2));
+        if(inner.size() < 3 || inner.front() != '"' || inner.back() != '"') {
+            return false;
+        }
+        auto name = inner.substr(1, inner.size() - 2);
+        if(name.empty() || !std::all_of(name.begin(), name.end(), [](char c) {
+               return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-' || c == '.';
+           })) {
+            return false;
+        }
+        region = name;
+        return true;
+    }
+
+    /**
+     * @brief Parse all numbers of a line, stopping at the first token which is not a number
+     * @param line Line to parse
+     * @param numbers Vector to store the numbers in, its memory is reused between the lines
+     */
+    void parse_numbers(const std::string& line, std::vector<double>& numbers) {
+        numbers.clear();
+        const char* pos = line.c_str();
+        while(true) {
+            char* end = nullptr;
+            auto number = std::strtod(pos, &end);
+            if(end == pos) {
+                break;
+            }
+            numbers.push_back(number);
+            pos = end;
+        }
+    }
+
+    /**
+     * @brief Parse all integers of a line, stopping at the first token which is not an integer
+     * @param line Line to parse
+     * @param numbers Vector to store the integers in, its memory is reused between the lines
+     */
+    void parse_integers(const std::string& line, std::vector<long>& numbers) {
+        numbers.clear();
+        const char* pos = line.c_str();
+        while(true) {
+            char* end = nullptr;
+            auto number = std::strtol(pos, &end, 10);
+            if(end == pos) {
+                break;
+            }
+            numbers.push_back(number);
+            pos = end;
+        }
+    }
+} // namespace
+
+std::map<std::string, std::vector<Point>> mesh_converter::read_grid(const std::string& file_name, bool mesh_tree) {
+    auto buffer = read_file(file_name);
+    LOG(DEBUG) << "Grid file contains " << buffer.size() << " bytes to parse";
+    LineReader reader(buffer);
 
     DFSection main_section = DFSection::HEADER;
     DFSection sub_section = DFSection::NONE;
@@ -49,29 +248,28 @@ std::map<std::string, std::vector<Point>> mesh_converter::read_grid(const std::s
     long unsigned int data_count = 0;
     bool in_data_block = false;
     long long num_lines_parsed = 0;
-    while(!file.eof()) {
-        std::string line;
-        std::getline(file, line);
-
+    std::string line, header_string, header_data, key, value;
+    std::vector<double> numbers;
+    std::vector<long> indices;
+    while(reader.next(line)) {
         // Log the parsing progress:
         if(num_lines_parsed % 1000 == 0) {
-            LOG_PROGRESS(INFO, "gridlines") << "Parsing grid file: " << (100 * num_lines_parsed / num_lines) << "%";
+            LOG_PROGRESS(INFO, "gridlines") << "Parsing grid file: " << reader.progress() << "%";
         }
         num_lines_parsed++;
 
-        line = allpix::trim(line);
         if(line.empty()) {
             continue;
         }
 
         // Check if line with begin of section
         if(line.find('{') != std::string::npos) {
-            // Search for new simple headers
-            auto base_regex = std::regex("([a-zA-Z]+) \\{");
-            std::smatch base_match;
-            if(std::regex_match(line, base_match, base_regex) && base_match.ready()) {
-                auto header_string = base_match[1].str();
+            if(!parse_section_header(line, header_string, header_data)) {
+                continue;
+            }
 
+            // Search for new simple headers
+            if(header_data.empty()) {
                 if(header_string == "Info") {
                     main_section = DFSection::INFO;
                 } else if(header_string == "Data") {
@@ -83,14 +281,8 @@ std::map<std::string, std::vector<Point>> mesh_converter::read_grid(const std::s
                         main_section = DFSection::IGNORED;
                     }
                 }
-            }
-
-            // Search for headers with data
-            base_regex = std::regex("([a-zA-Z]+) \\((\\S+)\\) \\{");
-            if(std::regex_match(line, base_match, base_regex) && base_match.ready()) {
-                auto header_string = base_match[1].str();
-                auto header_data = base_match[2].str();
-
+            } else {
+                // Search for headers with data
                 if(header_string == "Region") {
                     main_section = DFSection::REGION;
                     region = header_data.substr(1, header_data.size() - 2);
@@ -165,12 +357,7 @@ std::map<std::string, std::vector<Point>> mesh_converter::read_grid(const std::s
 
         // Look for key data pairs
         if(line.find('=') != std::string::npos) {
-            auto base_regex = std::regex("([a-zA-Z]+)\\s+=\\s+([\\S ]+)");
-            std::smatch base_match;
-            if(std::regex_match(line, base_match, base_regex) && base_match.ready()) {
-                auto key = base_match[1].str();
-                auto value = allpix::trim(base_match[2].str());
-
+            if(parse_key_value(line, key, value)) {
                 // Filter correct electric field type
                 if(main_section == DFSection::INFO) {
                     if(key == "dimension" && (std::stoul(value) != 3 && std::stoul(value) != 2)) {
@@ -185,7 +372,6 @@ std::map<std::string, std::vector<Point>> mesh_converter::read_grid(const std::s
         }
 
         // Handle data
-        std::stringstream sstr(line);
         switch(main_section) {
         case DFSection::HEADER:
             if(line != "DF-ISE text") {
@@ -195,11 +381,15 @@ std::map<std::string, std::vector<Point>> mesh_converter::read_grid(const std::s
             break;
         case DFSection::VERTICES: {
             // Read vertex points
+            parse_numbers(line, numbers);
             if(dimension == 3) {
                 point.x = -1.0;
                 point.y = -1.0;
                 point.z = -1.0;
-                while(sstr >> point.x >> point.y >> point.z) {
+                for(size_t i = 0; i + 3 <= numbers.size(); i += 3) {
+                    point.x = numbers[i];
+                    point.y = numbers[i + 1];
+                    point.z = numbers[i + 2];
                     vertices.push_back(point);
                     tree->Fill();
                 }
@@ -208,7 +398,9 @@ std::map<std::string, std::vector<Point>> mesh_converter::read_grid(const std::s
                 point.x = -1.0;
                 point.y = -1.0;
                 point.z = -1.0;
-                while(sstr >> point.y >> point.z) {
+                for(size_t i = 0; i + 2 <= numbers.size(); i += 2) {
+                    point.y = numbers[i];
+                    point.z = numbers[i + 1];
                     vertices.push_back(point);
                     tree->Fill();
                 }
@@ -216,22 +408,25 @@ std::map<std::string, std::vector<Point>> mesh_converter::read_grid(const std::s
         } break;
         case DFSection::EDGES: {
             // Read edges
-            std::pair<long unsigned int, long unsigned int> edge;
-            while(sstr >> edge.first >> edge.second) {
-                if(edge.first >= vertices.size() || edge.second >= vertices.size()) {
+            parse_integers(line, indices);
+            for(size_t i = 0; i + 2 <= indices.size(); i += 2) {
+                if(indices[i] < 0 || indices[i + 1] < 0 || static_cast<size_t>(indices[i]) >= vertices.size() ||
+                   static_cast<size_t>(indices[i + 1]) >= vertices.size()) {
                     throw std::runtime_error("vertex index is higher than number of vertices");
                 }
-                edges.push_back(edge);
+                edges.emplace_back(indices[i], indices[i + 1]);
             }
         } break;
         case DFSection::FACES: {
             // Get vertex indices for every face
-            size_t n;
-            sstr >> n;
+            parse_integers(line, indices);
+            if(indices.empty() || indices.front() < 0 || indices.size() < static_cast<size_t>(indices.front()) + 1) {
+                throw std::runtime_error("incorrect number of edges for face");
+            }
+            auto n = static_cast<size_t>(indices.front());
             std::vector<long unsigned int> face;
             for(size_t i = 0; i < n; ++i) {
-                long edge_idx;
-                sstr >> edge_idx;
+                long edge_idx = indices[i + 1];
 
                 bool swap = false;
                 if(edge_idx < 0) {
@@ -269,8 +464,11 @@ std::map<std::string, std::vector<Point>> mesh_converter::read_grid(const std::s
             faces.push_back(face);
         } break;
         case DFSection::ELEMENTS: {
-            int k;
-            sstr >> k;
+            parse_integers(line, indices);
+            if(indices.empty()) {
+                throw std::runtime_error("missing element type");
+            }
+            auto k = static_cast<int>(indices.front());
             std::vector<long unsigned int> element;
 
             size_t size = 0;
@@ -303,9 +501,11 @@ std::map<std::string, std::vector<Point>> mesh_converter::read_grid(const std::s
                 throw std::runtime_error("element type " + std::to_string(k) + " is not supported");
             }
 
+            if(indices.size() < size + 1) {
+                throw std::runtime_error("incorrect number of indices for element type " + std::to_string(k));
+            }
             for(size_t i = 0; i < size; ++i) {
-                long element_idx;
-                sstr >> element_idx;
+                long element_idx = indices[i + 1];
 
                 bool reverse = false;
                 if(element_idx < 0) {
@@ -343,12 +543,12 @@ std::map<std::string, std::vector<Point>> mesh_converter::read_grid(const std::s
             if(sub_section != DFSection::ELEMENTS) {
                 continue;
             }
-            long unsigned int elem_idx;
-            while(sstr >> elem_idx) {
-                if(elem_idx >= elements.size()) {
+            parse_integers(line, indices);
+            for(auto index : indices) {
+                if(index < 0 || static_cast<size_t>(index) >= elements.size()) {
                     throw std::runtime_error("element index is higher than number of elements");
                 }
-
+                auto elem_idx = static_cast<size_t>(index);
                 regions_vertices[region].insert(
                     regions_vertices[region].end(), elements[elem_idx].begin(), elements[elem_idx].end());
             }
@@ -391,16 +591,9 @@ std::map<std::string, std::vector<Point>> mesh_converter::read_grid(const std::s
 
 std::map<std::string, std::map<std::string, std::vector<Point>>>
 mesh_converter::read_electric_field(const std::string& file_name) {
-    std::ifstream file(file_name);
-    if(!file) {
-        throw std::runtime_error("file cannot be accessed");
-    }
-
-    // Get the total number of lines to parse and reset file to the start:
-    auto num_lines = std::count(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>(), '\n');
-    file.clear();
-    file.seekg(0, std::ios::beg);
-    LOG(DEBUG) << "Field data file contains " << num_lines << " lines to parse";
+    auto buffer = read_file(file_name);
+    LOG(DEBUG) << "Field data file contains " << buffer.size() << " bytes to parse";
+    LineReader reader(buffer);
 
     DFSection main_section = DFSection::HEADER;
     DFSection sub_section = DFSection::NONE;
@@ -415,14 +608,12 @@ mesh_converter::read_electric_field(const std::string& file_name) {
     long unsigned int data_count = 0;
     bool in_data_block = false;
     long long num_lines_parsed = 0;
-    while(!file.eof()) {
-        std::string line;
-        std::getline(file, line);
-        line = allpix::trim(line);
-
+    std::string line, header_string, header_data, key, value;
+    std::vector<double> numbers;
+    while(reader.next(line)) {
         // Log the parsing progress:
         if(num_lines_parsed % 1000 == 0) {
-            LOG_PROGRESS(INFO, "fieldlines") << "Parsing field data file: " << (100 * num_lines_parsed / num_lines) << "%";
+            LOG_PROGRESS(INFO, "fieldlines") << "Parsing field data file: " << reader.progress() << "%";
         }
         num_lines_parsed++;
 
@@ -432,11 +623,12 @@ mesh_converter::read_electric_field(const std::string& file_name) {
 
         // Check if line with begin of section
         if(line.find('{') != std::string::npos) {
+            if(!parse_section_header(line, header_string, header_data)) {
+                continue;
+            }
+
             // Search for new simple headers
-            auto base_regex = std::regex("([a-zA-Z]+) \\{");
-            std::smatch base_match;
-            if(std::regex_match(line, base_match, base_regex) && base_match.ready()) {
-                auto header_string = base_match[1].str();
+            if(header_data.empty()) {
                 LOG(TRACE) << "Opening section " << header_string;
 
                 if(header_string == "Info") {
@@ -450,14 +642,8 @@ mesh_converter::read_electric_field(const std::string& file_name) {
                         main_section = DFSection::IGNORED;
                     }
                 }
-            }
-
-            // Search for headers with data
-            base_regex = std::regex("([a-zA-Z]+) \\((\\S+)\\) \\{");
-            if(std::regex_match(line, base_match, base_regex) && base_match.ready()) {
-                auto header_string = base_match[1].str();
-                auto header_data = base_match[2].str();
-
+            } else {
+                // Search for headers with data
                 if(header_string == "Dataset") {
                     std::string data_type = header_data.substr(1, header_data.size() - 2);
                     LOG(DEBUG) << "Opening dataset of type " << data_type;
@@ -493,19 +679,10 @@ mesh_converter::read_electric_field(const std::string& file_name) {
 
         // Look for key data pairs
         if(line.find('=') != std::string::npos) {
-            auto base_regex = std::regex("([a-zA-Z]+)\\s+=\\s+([\\S ]+)");
-            std::smatch base_match;
-            if(std::regex_match(line, base_match, base_regex) && base_match.ready()) {
-                auto key = base_match[1].str();
-                auto value = allpix::trim(base_match[2].str());
-
-                // Regular expression for matching validity region:
-                base_regex = std::regex("\\[\\s+\"([-\\w\\.]+)\"\\s+\\]");
+            if(parse_key_value(line, key, value)) {
                 if(key == "validity") {
                     // Ignore any electric field valid for multiple regions
-                    if(std::regex_match(value, base_match, base_regex) && base_match.ready()) {
-                        region = base_match[1].str();
-                    } else {
+                    if(!parse_validity(value, region)) {
                         LOG(INFO) << "Could not determine validity region for string \"" << value << "\", ignoring.";
                         main_section = DFSection::IGNORED;
                     }
@@ -687,11 +864,8 @@ mesh_converter::read_electric_field(const std::string& file_name) {
             main_section == DFSection::DOPING_CONCENTRATION || main_section == DFSection::DONOR_CONCENTRATION ||
             main_section == DFSection::ACCEPTOR_CONCENTRATION) &&
            sub_section == DFSection::VALUES) {
-            std::stringstream sstr(line);
-            double num;
-            while(sstr >> num) {
-                region_electric_field_num.push_back(num);
-            }
+            parse_numbers(line, numbers);
+            region_electric_field_num.insert(region_electric_field_num.end(), numbers.begin(), numbers.end());
         }
     }
     LOG_PROGRESS(INFO, "fieldlines") << "Parsing field data file: done.";
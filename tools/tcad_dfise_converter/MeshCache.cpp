@@ -0,0 +1,176 @@
+#include "MeshCache.hpp"
+
+#include <array>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+using namespace mesh_converter;
+
+namespace {
+    // Identifier and version of the cache format, caches of other versions are ignored
+    constexpr std::array<char, 8> cache_magic{{'A', 'P', 'X', 'M', 'E', 'S', 'H', 'C'}};
+    constexpr uint32_t cache_version = 1;
+
+    template <typename T> void write_value(std::ofstream& file, const T& value) {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T> bool read_value(std::ifstream& file, T& value) {
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    void write_string(std::ofstream& file, const std::string& str) {
+        write_value<uint64_t>(file, str.size());
+        file.write(str.data(), static_cast<std::streamsize>(str.size()));
+    }
+
+    bool read_string(std::ifstream& file, std::string& str) {
+        uint64_t size = 0;
+        if(!read_value(file, size)) {
+            return false;
+        }
+        str.resize(size);
+        return static_cast<bool>(file.read(&str[0], static_cast<std::streamsize>(size)));
+    }
+
+    // The coordinates of all points are written as a single block of doubles
+    void write_points(std::ofstream& file, const std::vector<Point>& points) {
+        std::vector<double> values;
+        values.reserve(3 * points.size());
+        for(const auto& point : points) {
+            values.push_back(point.x);
+            values.push_back(point.y);
+            values.push_back(point.z);
+        }
+        write_value<uint64_t>(file, points.size());
+        file.write(reinterpret_cast<const char*>(values.data()),
+                   static_cast<std::streamsize>(values.size() * sizeof(double)));
+    }
+
+    bool read_points(std::ifstream& file, std::vector<Point>& points) {
+        uint64_t size = 0;
+        if(!read_value(file, size)) {
+            return false;
+        }
+        std::vector<double> values(3 * size);
+        auto bytes = static_cast<std::streamsize>(values.size() * sizeof(double));
+        if(!file.read(reinterpret_cast<char*>(values.data()), bytes)) {
+            return false;
+        }
+        points.clear();
+        points.reserve(size);
+        for(size_t i = 0; i < size; ++i) {
+            points.emplace_back(values[3 * i], values[3 * i + 1], values[3 * i + 2]);
+        }
+        return true;
+    }
+} // namespace
+
+uint64_t mesh_converter::hash_file(const std::string& file_name) {
+    std::ifstream file(file_name, std::ios::binary);
+    if(!file.good()) {
+        throw std::runtime_error("file cannot be read");
+    }
+
+    // FNV-1a over all bytes of the file, read in large blocks
+    uint64_t hash = 14695981039346656037ULL;
+    std::vector<char> buffer(1 << 20);
+    while(file) {
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        auto count = static_cast<size_t>(file.gcount());
+        for(size_t i = 0; i < count; ++i) {
+            hash ^= static_cast<unsigned char>(buffer[i]);
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+bool mesh_converter::read_mesh_cache(
+    const std::string& file_name, uint64_t grid_hash, uint64_t data_hash, RegionGrid& grid, RegionFields& fields) {
+    std::ifstream file(file_name, std::ios::binary);
+    if(!file.good()) {
+        return false;
+    }
+
+    // Check the format and the hashes of the files the cache was created from
+    std::array<char, 8> magic{};
+    uint32_t version = 0;
+    uint64_t cached_grid_hash = 0, cached_data_hash = 0;
+    if(!file.read(magic.data(), static_cast<std::streamsize>(magic.size())) || magic != cache_magic ||
+       !read_value(file, version) || version != cache_version || !read_value(file, cached_grid_hash) ||
+       !read_value(file, cached_data_hash) || cached_grid_hash != grid_hash || cached_data_hash != data_hash) {
+        return false;
+    }
+
+    RegionGrid cached_grid;
+    uint64_t regions = 0;
+    if(!read_value(file, regions)) {
+        return false;
+    }
+    for(uint64_t region = 0; region < regions; ++region) {
+        std::string name;
+        if(!read_string(file, name) || !read_points(file, cached_grid[name])) {
+            return false;
+        }
+    }
+
+    RegionFields cached_fields;
+    if(!read_value(file, regions)) {
+        return false;
+    }
+    for(uint64_t region = 0; region < regions; ++region) {
+        std::string name;
+        uint64_t observables = 0;
+        if(!read_string(file, name) || !read_value(file, observables)) {
+            return false;
+        }
+        for(uint64_t observable = 0; observable < observables; ++observable) {
+            std::string observable_name;
+            if(!read_string(file, observable_name) || !read_points(file, cached_fields[name][observable_name])) {
+                return false;
+            }
+        }
+    }
+
+    grid = std::move(cached_grid);
+    fields = std::move(cached_fields);
+    return true;
+}
+
+void mesh_converter::write_mesh_cache(const std::string& file_name,
+                                      uint64_t grid_hash,
+                                      uint64_t data_hash,
+                                      const RegionGrid& grid,
+                                      const RegionFields& fields) {
+    std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+    if(!file.good()) {
+        throw std::runtime_error("cache file cannot be written");
+    }
+
+    file.write(cache_magic.data(), static_cast<std::streamsize>(cache_magic.size()));
+    write_value(file, cache_version);
+    write_value(file, grid_hash);
+    write_value(file, data_hash);
+
+    write_value<uint64_t>(file, grid.size());
+    for(const auto& region : grid) {
+        write_string(file, region.first);
+        write_points(file, region.second);
+    }
+
+    write_value<uint64_t>(file, fields.size());
+    for(const auto& region : fields) {
+        write_string(file, region.first);
+        write_value<uint64_t>(file, region.second.size());
+        for(const auto& observable : region.second) {
+            write_string(file, observable.first);
+            write_points(file, observable.second);
+        }
+    }
+
+    if(!file.good()) {
+        throw std::runtime_error("cache file cannot be written");
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "DFISEParser.hpp"
+
+namespace mesh_converter {
+
+    // Grid points per region as read from the DF-ISE grid file
+    using RegionGrid = std::map<std::string, std::vector<Point>>;
+
+    // Observables per region as read from the DF-ISE data file
+    using RegionFields = std::map<std::string, std::map<std::string, std::vector<Point>>>;
+
+    /**
+     * @brief Compute the 64 bit FNV-1a hash of the content of a file
+     * @param file_name Name of the file to hash
+     * @return Hash of the file content
+     * @throws std::runtime_error If the file cannot be read
+     */
+    uint64_t hash_file(const std::string& file_name);
+
+    /**
+     * @brief Read the parsed grid and observables of all regions from a cache file
+     * @param file_name Name of the cache file
+     * @param grid_hash Hash of the grid file the cache should have been created from
+     * @param data_hash Hash of the data file the cache should have been created from
+     * @param grid Grid points of all regions, filled if the cache is valid
+     * @param fields Observables of all regions, filled if the cache is valid
+     * @return True if the cache exists and was created from files with the given hashes, false otherwise
+     */
+    bool read_mesh_cache(
+        const std::string& file_name, uint64_t grid_hash, uint64_t data_hash, RegionGrid& grid, RegionFields& fields);
+
+    /**
+     * @brief Write the parsed grid and observables of all regions to a cache file
+     * @param file_name Name of the cache file
+     * @param grid_hash Hash of the grid file the mesh was parsed from
+     * @param data_hash Hash of the data file the observables were parsed from
+     * @param grid Grid points of all regions
+     * @param fields Observables of all regions
+     * @throws std::runtime_error If the cache file cannot be written
+     */
+    void write_mesh_cache(const std::string& file_name,
+                          uint64_t grid_hash,
+                          uint64_t data_hash,
+                          const RegionGrid& grid,
+                          const RegionFields& fields);
+} // namespace mesh_converter
+
+#endif
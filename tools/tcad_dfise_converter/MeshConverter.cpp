@@ -26,6 +26,7 @@
 #include "tools/units.h"
 
 #include "DFISEParser.hpp"
+#include "MeshCache.hpp"
 #include "MeshElement.hpp"
 #include "ThreadPool.hpp"
 #include "combinations/combinations.h"
@@ -153,8 +154,13 @@ int main(int argc, char** argv) {
     auto regions = config.getArray<std::string>("region", {"bulk"});
     auto observable = config.get<std::string>("observable", "ElectricField");
 
-    const auto radius_step = config.get<double>("radius_step", 0.5);
+    const auto initial_neighbors = config.get<unsigned int>("initial_neighbors", 10);
     const auto max_radius = config.get<double>("max_radius", 50);
+    const auto reuse_element = config.get<bool>("reuse_element", true);
+    if(config.has("initial_radius") || config.has("radius_step")) {
+        LOG(WARNING) << "Parameters initial_radius and radius_step are not used anymore, the neighbor search is steered "
+                        "via initial_neighbors and max_radius";
+    }
 
     const auto volume_cut = config.get<double>("volume_cut", 10e-9);
 
@@ -178,6 +184,7 @@ int main(int argc, char** argv) {
     }
 
     const auto mesh_tree = config.get<bool>("mesh_tree", false);
+    const auto mesh_cache = config.get<bool>("mesh_cache", false);
 
     // NOTE: this stream should be available for the duration of the logging
     std::ofstream log_file;
@@ -194,11 +201,36 @@ int main(int argc, char** argv) {
     auto start = std::chrono::system_clock::now();
 
     std::string grid_file = file_prefix + ".grd";
-    LOG(STATUS) << "Reading mesh grid from grid file \"" << grid_file << "\"";
+    std::string data_file = file_prefix + ".dat";
+
+    // Read the parsed grid and observables of all regions from the cache if it was created from the same files. The mesh
+    // tree is only created when parsing the grid file, so the cache is not read if it is requested.
+    RegionGrid region_grid;
+    RegionFields region_fields;
+    std::string cache_file = file_prefix + ".mesh_cache";
+    uint64_t grid_hash = 0, data_hash = 0;
+    bool hashed = false, cached = false;
+    if(mesh_cache) {
+        try {
+            grid_hash = hash_file(grid_file);
+            data_hash = hash_file(data_file);
+            hashed = true;
+            cached = !mesh_tree && read_mesh_cache(cache_file, grid_hash, data_hash, region_grid, region_fields);
+        } catch(std::runtime_error& e) {
+            LOG(WARNING) << "Cannot compute hashes of the input files, not using the mesh cache: " << e.what();
+        }
+    }
+    if(cached) {
+        LOG(STATUS) << "Reading mesh grid and observables from cache file \"" << cache_file << "\"";
+    } else {
+        LOG(STATUS) << "Reading mesh grid from grid file \"" << grid_file << "\"";
+    }
 
     std::vector<Point> points;
     try {
-        auto region_grid = read_grid(grid_file, mesh_tree);
+        if(!cached) {
+            region_grid = read_grid(grid_file, mesh_tree);
+        }
         LOG(INFO) << "Grid sizes for all regions:";
         for(auto& reg : region_grid) {
             LOG(INFO) << "\t" << std::left << std::setw(25) << reg.first << " " << reg.second.size();
@@ -223,12 +255,15 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    std::string data_file = file_prefix + ".dat";
-    LOG(STATUS) << "Reading electric field from data file \"" << data_file << "\"";
+    if(!cached) {
+        LOG(STATUS) << "Reading electric field from data file \"" << data_file << "\"";
+    }
 
     std::vector<Point> field;
     try {
-        auto region_fields = read_electric_field(data_file);
+        if(!cached) {
+            region_fields = read_electric_field(data_file);
+        }
         LOG(INFO) << "Field sizes for all regions and observables:";
         for(auto& reg : region_fields) {
             LOG(INFO) << " " << reg.first << ":";
@@ -258,6 +293,16 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    // Store the parsed grid and observables of all regions for later runs on the same files
+    if(hashed && !cached) {
+        try {
+            write_mesh_cache(cache_file, grid_hash, data_hash, region_grid, region_fields);
+            LOG(STATUS) << "Parsed mesh written to cache file \"" << cache_file << "\"";
+        } catch(std::runtime_error& e) {
+            LOG(WARNING) << "Failed to write mesh cache file \"" << cache_file << "\": " << e.what();
+        }
+    }
+
     if(points.size() != field.size()) {
         LOG(FATAL) << "Field and grid file do not match, found " << points.size() << " and " << field.size()
                    << " data points, respectively.";
@@ -335,9 +380,13 @@ int main(int argc, char** argv) {
     const double zstep = (maxz - minz) / static_cast<double>(divisions.z());
     const double cell_volume = xstep * ystep * zstep;
 
-    // Using the minimal cell dimension as initial search radius for the point cloud:
-    const auto initial_radius = config.get<double>("initial_radius", std::min({xstep, ystep, zstep}));
-    LOG(INFO) << "Using initial neighbor search radius of " << initial_radius;
+    const unsigned int element_vertices = (dimension == 3 ? 4 : 3);
+    if(initial_neighbors < element_vertices) {
+        LOG(FATAL) << "Parameter initial_neighbors has to be at least " << element_vertices << " to form a mesh element";
+        allpix::Log::finish();
+        return 1;
+    }
+    LOG(INFO) << "Using initial number of " << initial_neighbors << " nearest neighbors for the element search";
 
     if(rot.at(0) != "x" || rot.at(1) != "y" || rot.at(2) != "z") {
         LOG(STATUS) << "TCAD mesh (x,y,z) coords. transformation into: (" << rot.at(0) << "," << rot.at(1) << ","
@@ -387,56 +436,61 @@ int main(int argc, char** argv) {
         // New mesh slice
         std::vector<Point> new_mesh;
 
+        // Vertices of the element found for the previous point of this slice
+        std::vector<unsigned int> last_element;
+        std::vector<unsigned int> results;
+        std::vector<double> distances;
+
         double z = minz + zstep / 2.0;
         for(int k = 0; k < divisions.z(); ++k) {
             // New mesh vertex and field
             Point q(dimension == 2 ? -1 : x, y, z), e;
             bool valid = false;
 
-            size_t prev_neighbours = 0;
-            double radius = initial_radius;
+            // Neighboring points of the regular grid are often located in the same mesh element, try the last one first
+            if(reuse_element && !last_element.empty()) {
+                Combination previous(&points, &field, q, volume_cut);
+                if(previous(last_element.begin(), last_element.end())) {
+                    LOG(DEBUG) << "Reusing mesh element of the previous point";
+                    e = previous.result();
+                    valid = true;
+                }
+            }
 
-            while(radius < max_radius) {
-                LOG(DEBUG) << "Search radius: " << radius;
-                // Calling octree neighbours search and sorting the results list with the closest neighbours first
-                std::vector<unsigned int> results;
-                octree.radiusNeighbors<unibn::L2Distance<Point>>(q, radius, results);
+            auto neighbors = initial_neighbors;
+            while(!valid) {
+                // Calling octree k-nearest neighbors search, the results are ordered with the closest neighbors first. This
+                // drastically reduces the number of permutations required to find a valid mesh element and also ensures
+                // that this is the one with the smallest volume.
+                octree.knnNeighbors<unibn::L2Distance<Point>>(q, neighbors, results, distances);
+                auto found = results.size();
+
+                // Only consider neighbors within the maximum radius, the distances are squared
+                auto within = std::lower_bound(distances.begin(), distances.end(), max_radius * max_radius);
+                results.resize(static_cast<size_t>(within - distances.begin()));
                 LOG(DEBUG) << "Number of vertices found: " << results.size();
 
-                // If after a radius step no new neighbours are found, go to the next radius step
-                if(results.size() <= prev_neighbours || results.empty()) {
-                    prev_neighbours = results.size();
-                    LOG(DEBUG) << "No (new) neighbour found with radius " << radius << ". Increasing search radius.";
-                    radius = radius + radius_step;
-                    continue;
+                // If we have less than N close neighbors, no full mesh element can be formed
+                if(results.size() >= element_vertices) {
+                    // Finding tetrahedrons by checking all combinations of N elements, starting with closest to reference
+                    auto res = for_each_combination(results.begin(),
+                                                    results.begin() + element_vertices,
+                                                    results.end(),
+                                                    Combination(&points, &field, q, volume_cut));
+                    valid = res.valid();
+                    if(valid) {
+                        e = res.result();
+                        last_element = res.indices();
+                        break;
+                    }
                 }
 
-                // If we have less than N close neighbors, no full mesh element can be formed. Increase radius.
-                if(results.size() < (dimension == 3 ? 4 : 3)) {
-                    LOG(DEBUG) << "Incomplete mesh element found for radius " << radius << ", increasing radius";
-                    radius = radius + radius_step;
-                    continue;
-                }
-
-                // Sort by lowest distance first, this drastically reduces the number of permutations required to find a
-                // valid mesh element and also ensures that this is the one with the smallest volume.
-                std::sort(results.begin(), results.end(), [&](unsigned int a, unsigned int b) {
-                    return unibn::L2Distance<Point>::compute(points[a], q) < unibn::L2Distance<Point>::compute(points[b], q);
-                });
-
-                // Finding tetrahedrons by checking all combinations of N elements, starting with closest to reference point
-                auto res = for_each_combination(results.begin(),
-                                                results.begin() + (dimension == 3 ? 4 : 3),
-                                                results.end(),
-                                                Combination(&points, &field, q, volume_cut));
-                valid = res.valid();
-                if(valid) {
-                    e = res.result();
+                // Stop if all points within the maximum radius have been tried already
+                if(found < neighbors || results.size() < found) {
                     break;
                 }
-
-                radius = radius + radius_step;
-                LOG(DEBUG) << "All combinations tried. Increasing search radius to " << radius;
+                neighbors *= 2;
+                LOG(DEBUG) << "All combinations tried. Increasing number of neighbors to " << neighbors;
             }
 
             if(!valid) {
@@ -1,6 +1,7 @@
 #include <Eigen/Eigen>
 #include <array>
 #include <utility>
+#include <vector>
 
 #include "core/utils/log.h"
 
@@ -89,6 +90,7 @@ namespace mesh_converter {
 
         std::array<Point, 4> grid_elements;
         std::array<Point, 4> field_elements;
+        std::vector<unsigned int> indices_;
 
     public:
         /**
@@ -115,6 +117,7 @@ namespace mesh_converter {
             // Dimensionality is number of iterator elements minus one:
             size_t dimensions = static_cast<size_t>(end - begin) - 1;
             size_t idx = 0;
+            auto first = begin;
             for(; begin < end; begin++) {
                 grid_elements[idx] = (*grid_)[*begin];
                 field_elements[idx++] = (*field_)[*begin];
@@ -126,6 +129,7 @@ namespace mesh_converter {
             if(valid_) {
                 LOG(DEBUG) << element.print(reference_);
                 result_ = element.getObservable(reference_);
+                indices_.assign(first, end);
             }
 
             return valid_; // Don't break out of the loop if element is invalid
@@ -143,6 +147,12 @@ namespace mesh_converter {
          * @return Interpolated result from valid mesh element
          */
         Point result() const { return result_; }
+
+        /**
+         * @brief Member to retrieve the indices of the mesh points forming the valid mesh element
+         * @return Indices of the vertices of the valid mesh element, empty if no valid element was found
+         */
+        const std::vector<unsigned int>& indices() const { return indices_; }
     };
 
 } // namespace mesh_converter
@@ -1,4 +1,6 @@
+#include <array>
 #include <csignal>
+#include <deque>
 #include <fstream>
 
 #include "core/config/ConfigReader.hpp"
@@ -63,6 +65,8 @@ int main(int argc, char** argv) {
             print_help = true;
         } else if(strcmp(argv[i], "--init") == 0) {
             file_type = allpix::FileType::INIT;
+        } else if(strcmp(argv[i], "--mapped") == 0) {
+            file_type = allpix::FileType::MAPPED;
         } else if(strcmp(argv[i], "--binning") == 0 && (i + 1 < argc)) {
             binning = allpix::from_string<XYZVectorInt>(std::string(argv[++i]));
         } else if(strcmp(argv[i], "--matrix") == 0 && (i + 1 < argc)) {
@@ -102,6 +106,9 @@ int main(int argc, char** argv) {
         std::cout << "\t --output  <file name>   Name of the file the potential should be stored in" << std::endl;
         std::cout << "\t --init                  Switch to enable writing the potential in the INIT format instead of APF"
                   << std::endl;
+        std::cout << "\t --mapped                Switch to enable writing the potential in the memory-mappable format, "
+                     "which is written while the potential is generated"
+                  << std::endl;
         std::cout << "\t -v <level>              verbosity level (default reporiting level is INFO)" << std::endl;
         std::cout << "\t -h                      print this help text" << std::endl;
 
@@ -137,7 +144,8 @@ int main(int argc, char** argv) {
 
     // Output file path:
     std::string output_file_name =
-        output_file_prefix + "_weightingpotential" + (file_type == allpix::FileType::INIT ? ".init" : ".apf");
+        output_file_prefix + "_weightingpotential" +
+        (file_type == allpix::FileType::INIT ? ".init" : file_type == allpix::FileType::MAPPED ? ".mapped" : ".apf");
 
     LOG(INFO) << "Field size: " << allpix::Units::display(fieldsize, {"um", "mm"});
     LOG(INFO) << "Binning: " << binning.x() << " " << binning.y() << " " << binning.z();
@@ -147,50 +155,70 @@ int main(int argc, char** argv) {
     // Start potential generation on many threads:
     auto num_threads = std::max(std::thread::hardware_concurrency(), 1u);
     LOG(STATUS) << "Starting weighting potential generation with " << num_threads << " threads.";
-    auto weighting_potential = std::make_shared<std::vector<double>>();
+
+    // Prepare header and auxiliary information:
+    std::string header = "Allpix Squared " + std::string(ALLPIX_PROJECT_VERSION) + " Weighting Potential Generator";
+    std::array<double, 3> size{{fieldsize.x(), fieldsize.y(), fieldsize.z()}};
+    std::array<size_t, 3> gridsize{{binning.x(), binning.y(), binning.z()}};
+
+    // The arguments of the series expansion only depend on z, calculate them once for every z-slice of the grid. The first
+    // argument belongs to the leading term, followed by the pairs of arguments of all terms of the series.
+    constexpr size_t series_terms = 100;
+    constexpr size_t series_arguments = 2 * series_terms + 1;
+    std::vector<double> arguments;
+    arguments.reserve(binning.z() * series_arguments);
+    for(size_t index_z = 1; index_z <= binning.z(); index_z++) {
+        auto z = fieldsize.z() / static_cast<double>(binning.z()) * static_cast<double>(index_z) - fieldsize.z() / 2;
+
+        // Transform into coordinate system with sensor between d/2 < z < -d/2:
+        auto d = thickness_domain.second - thickness_domain.first;
+        auto local_z = -z + thickness_domain.second;
+
+        arguments.push_back(local_z);
+        for(size_t n = 1; n <= series_terms; n++) {
+            arguments.push_back(2 * static_cast<double>(n) * d - local_z);
+            arguments.push_back(2 * static_cast<double>(n) * d + local_z);
+        }
+    }
 
     auto generate_section = [&](size_t index_x) {
         allpix::Log::setReportingLevel(log_level);
 
-        auto potential = [implant, thickness_domain](const ROOT::Math::XYZPoint& pos) {
-            // Calculate values of the "f" function
-            auto f = [implant](double x, double y, double u) {
-                // Calculate arctan fractions
-                auto arctan = [](double a, double b, double c) {
-                    return std::atan(a * b / c / std::sqrt(a * a + b * b + c * c));
-                };
-
-                // Shift the x and y coordinates by plus/minus half the implant size:
-                double x1 = x - implant.x() / 2;
-                double x2 = x + implant.x() / 2;
-                double y1 = y - implant.y() / 2;
-                double y2 = y + implant.y() / 2;
-
-                // Calculate arctan sum and return
-                return arctan(x1, y1, u) + arctan(x2, y2, u) - arctan(x1, y2, u) - arctan(x2, y1, u);
-            };
-
-            // Transform into coordinate system with sensor between d/2 < z < -d/2:
-            auto d = thickness_domain.second - thickness_domain.first;
-            auto local_z = -pos.z() + thickness_domain.second;
+        std::vector<double> slice;
+        slice.reserve(binning.y() * binning.z());
 
-            // Calculate the series expansion
-            double sum = 0;
-            for(int n = 1; n <= 100; n++) {
-                sum += f(pos.x(), pos.y(), 2 * n * d - local_z) - f(pos.x(), pos.y(), 2 * n * d + local_z);
-            }
+        auto x = fieldsize.x() / static_cast<double>(binning.x()) * static_cast<double>(index_x) - fieldsize.x() / 2;
+        for(size_t index_y = 1; index_y <= binning.y(); index_y++) {
+            auto y = fieldsize.y() / static_cast<double>(binning.y()) * static_cast<double>(index_y) - fieldsize.y() / 2;
+
+            // Shift the x and y coordinates by plus/minus half the implant size. The products and squared sums of the
+            // corner coordinates are the same for all terms along z.
+            double x1 = x - implant.x() / 2;
+            double x2 = x + implant.x() / 2;
+            double y1 = y - implant.y() / 2;
+            double y2 = y + implant.y() / 2;
+            const std::array<double, 4> products{{x1 * y1, x2 * y2, x1 * y2, x2 * y1}};
+            const std::array<double, 4> squares{
+                {x1 * x1 + y1 * y1, x2 * x2 + y2 * y2, x1 * x1 + y2 * y2, x2 * x2 + y1 * y1}};
+
+            // Calculate values of the "f" function as arctan sum
+            auto f = [&products, &squares](double u) {
+                auto u2 = u * u;
+                return std::atan(products[0] / u / std::sqrt(squares[0] + u2)) +
+                       std::atan(products[1] / u / std::sqrt(squares[1] + u2)) -
+                       std::atan(products[2] / u / std::sqrt(squares[2] + u2)) -
+                       std::atan(products[3] / u / std::sqrt(squares[3] + u2));
+            };
 
-            return (1 / (2 * M_PI) * (f(pos.x(), pos.y(), local_z) - sum));
-        };
+            for(size_t index_z = 0; index_z < binning.z(); index_z++) {
+                const auto* args = &arguments[index_z * series_arguments];
 
-        std::vector<double> slice;
-        for(size_t index_y = 1; index_y <= binning.y(); index_y++) {
-            for(size_t index_z = 1; index_z <= binning.z(); index_z++) {
-                auto pos = ROOT::Math::XYZPoint(
-                    fieldsize.x() / static_cast<double>(binning.x()) * static_cast<double>(index_x) - fieldsize.x() / 2,
-                    fieldsize.y() / static_cast<double>(binning.y()) * static_cast<double>(index_y) - fieldsize.y() / 2,
-                    fieldsize.z() / static_cast<double>(binning.z()) * static_cast<double>(index_z) - fieldsize.z() / 2);
-                slice.push_back(potential(pos));
+                // Calculate the series expansion
+                double sum = 0;
+                for(size_t n = 0; n < series_terms; n++) {
+                    sum += f(args[2 * n + 1]) - f(args[2 * n + 2]);
+                }
+                slice.push_back(1 / (2 * M_PI) * (f(args[0]) - sum));
             }
         }
         return slice;
@@ -206,22 +234,43 @@ int main(int argc, char** argv) {
         };
 
         ThreadPool pool(num_threads, init_function);
-        std::vector<std::future<std::vector<double>>> wp_futures;
 
-        // Loop over x coordinate, add tasks for each coorinate to the queue
-        for(size_t x = 1; x <= binning.x(); x++) {
-            wp_futures.push_back(pool.submit(generate_section, x));
-        }
+        // Only keep a limited number of slices in flight, such that the memory does not grow with the size of the grid
+        std::deque<std::future<std::vector<double>>> wp_futures;
+        size_t next_slice = 1;
+        size_t max_slices = 4 * static_cast<size_t>(num_threads);
+        auto get_slice = [&](size_t index) {
+            while(next_slice <= binning.x() && wp_futures.size() < max_slices) {
+                wp_futures.push_back(pool.submit(generate_section, next_slice++));
+            }
+            auto slice = wp_futures.front().get();
+            wp_futures.pop_front();
+            LOG_PROGRESS(INFO, "generation") << "Generating potential: " << (100 * index / binning.x()) << "%";
+            return slice;
+        };
+
+        allpix::FieldWriter<double> field_writer(allpix::FieldQuantity::SCALAR);
+        if(file_type == allpix::FileType::MAPPED) {
+            // Write the slices to the file as soon as they are available
+            field_writer.writeMappedFile(header, gridsize, size, output_file_name, get_slice);
+            LOG_PROGRESS(INFO, "generation") << "Generating potential: 100%";
+        } else {
+            // Merge the slices, the serialized formats require the full field
+            auto weighting_potential = std::make_shared<std::vector<double>>();
+            weighting_potential->reserve(binning.x() * binning.y() * binning.z());
+            for(size_t x = 0; x < binning.x(); x++) {
+                auto slice = get_slice(x);
+                weighting_potential->insert(weighting_potential->end(), slice.begin(), slice.end());
+            }
+            LOG_PROGRESS(INFO, "generation") << "Generating potential: 100%";
 
-        // Merge the result vectors:
-        unsigned int slices_done = 0;
-        for(auto& wp_future : wp_futures) {
-            auto slice = wp_future.get();
-            weighting_potential->insert(weighting_potential->end(), slice.begin(), slice.end());
-            LOG_PROGRESS(INFO, "generation") << "Generating potential: " << (100 * slices_done / wp_futures.size()) << "%";
-            slices_done++;
+            auto end = std::chrono::system_clock::now();
+            auto elapsed_seconds = std::chrono::duration_cast<std::chrono::seconds>(end - start).count();
+            LOG(INFO) << "Weighting potential generated in " << elapsed_seconds << " seconds.";
+
+            allpix::FieldData<double> field_data(header, gridsize, size, weighting_potential);
+            field_writer.writeFile(field_data, output_file_name, file_type);
         }
-        LOG_PROGRESS(INFO, "generation") << "Generating potential: 100%";
         pool.destroy();
     } catch(std::runtime_error& e) {
         LOG(FATAL) << "Failed to generate weighting potential:\n" << e.what();
@@ -231,19 +280,6 @@ int main(int argc, char** argv) {
 
     auto end = std::chrono::system_clock::now();
     auto elapsed_seconds = std::chrono::duration_cast<std::chrono::seconds>(end - start).count();
-    LOG(INFO) << "Weighting potential generated in " << elapsed_seconds << " seconds.";
-
-    // Prepare header and auxiliary information:
-    std::string header = "Allpix Squared " + std::string(ALLPIX_PROJECT_VERSION) + " Weighting Potential Generator";
-    std::array<double, 3> size{{fieldsize.x(), fieldsize.y(), fieldsize.z()}};
-    std::array<size_t, 3> gridsize{{binning.x(), binning.y(), binning.z()}};
-
-    allpix::FieldData<double> field_data(header, gridsize, size, weighting_potential);
-    allpix::FieldWriter<double> field_writer(allpix::FieldQuantity::SCALAR);
-    field_writer.writeFile(field_data, output_file_name, file_type);
-
-    end = std::chrono::system_clock::now();
-    elapsed_seconds = std::chrono::duration_cast<std::chrono::seconds>(end - start).count();
     LOG(STATUS) << "Generation completed in " << elapsed_seconds << " seconds.";
 
     allpix::Log::finish();